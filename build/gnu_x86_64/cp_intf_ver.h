@@ -0,0 +1 @@
+#define OO_CP_INTF_VER d130a827f54d96b9932aa2382457b715
@@ -0,0 +1 @@
+#define EFCH_INTF_VER  "61fbf3b2600c5310915f72f998ccc11d"
@@ -0,0 +1 @@
+#define OO_UK_INTF_VER  "48054f8658f8d4292c0761707766aab7"
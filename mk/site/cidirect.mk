@@ -0,0 +1,8 @@
+# SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause
+# X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc.
+lib_ver   := 0
+lib_name  := cidirect
+lib_where := lib/transport/direct
+CIDIRECT_LIB		:= $(MMakeGenerateLibTarget)
+CIDIRECT_LIB_DEPEND	:= $(MMakeGenerateLibDepend)
+LINK_CIDIRECT_LIB	:= $(MMakeGenerateLibLink)
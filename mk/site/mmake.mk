@@ -27,6 +27,7 @@ include $(TOPPATH)/mk/site/ciul.mk
 include $(TOPPATH)/mk/site/ciip.mk
 include $(TOPPATH)/mk/site/cplane.mk
 include $(TOPPATH)/mk/site/citpcommon.mk
+include $(TOPPATH)/mk/site/cidirect.mk
 include $(TOPPATH)/mk/site/libs.mk
 endif
 include $(TOPPATH)/mk/middle.mk
@@ -338,6 +338,20 @@ int efch_capabilities_op(struct efch_capabilities_in* in,
     get_from_nic_flags(nic, NIC_FLAG_RX_FILTER_MAC_IP4_PROTO, out);
     break;
 
+  /* Fragment chaining relies on consecutive descriptors with SOP/CONT
+   * flagged events, so it needs a descriptor-based receive queue. */
+  case EF_VI_CAP_RX_CHAINED_FRAMES:
+    if( nic->devtype.arch == EFHW_ARCH_EF10 ||
+        nic->devtype.arch == EFHW_ARCH_EF100 ) {
+      out->support_rc = 0;
+      out->val = 1;
+    }
+    else {
+      out->support_rc = -EOPNOTSUPP;
+      out->val = 0;
+    }
+    break;
+
   default:
     out->support_rc = -ENOSYS;
     out->val = 0;
@@ -605,6 +605,18 @@ efch_vi_rm_rsops(efch_resource_t* rs, ci_resource_table_t* rt,
       rc = efch_vi_design_parameters(virs, op);
       break;
 
+    case CI_RSOP_VI_GET_IRQ: {
+      uint32_t irq = 0;
+      rc = efrm_vi_get_irq(virs, &irq);
+      op->u.vi_get_irq.out_irq = irq;
+      *copy_out = 1;
+      break;
+    }
+
+    case CI_RSOP_VI_IRQ_AFFINITY:
+      rc = efrm_vi_irq_affinity(virs, op->u.vi_irq_affinity.cpu);
+      break;
+
     default:
       rc = efch_filter_list_op_add(rs->rs_base, efrm_vi_get_pd(virs),
                                    &rs->vi.fl, op, copy_out, 0u, -1);
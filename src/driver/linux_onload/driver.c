@@ -102,6 +102,13 @@ MODULE_PARM_DESC(oof_shared_steal_thresh,
                  "the filter to persist even when a new wildcard socket needs "
                  "the filter.");
 
+module_param(oof_mcast_mac_aggregation, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(oof_mcast_mac_aggregation,
+                 "Number of multicast filters on a local port beyond which "
+                 "further group subscriptions share filters on the multicast "
+                 "MAC address, on hwports supporting multicast replication.  "
+                 "Set to 0 to disable.");
+
 module_param(oof_all_ports_required, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(oof_all_ports_required, 
                  "When set Onload will generate an error if it is unable to "
@@ -425,6 +432,11 @@ long oo_fop_unlocked_ioctl(struct file* filp, unsigned cmd, unsigned long arg)
       goto cleanup_out;
     }
 
+  /* We are entering the kernel anyway, so drain the slow-path command
+   * ring for free; this is what lets user level moderate its doorbells. */
+  if( priv->thr != NULL )
+    efab_slowpath_ring_drain(priv->thr);
+
   /* Do the operation itself */
   rc = op->handler(priv, local_p);
 
@@ -399,6 +399,7 @@ static void oo_epoll2_wait(struct oo_epoll_private *priv,
 #endif
         if( ci_netif_may_poll(ni) &&
             ci_netif_need_poll_spinning(ni, now_frc) &&
+            ci_netif_poll_uncontended(ni) &&
             ci_netif_trylock(ni) ) {
           ci_netif_poll(ni);
           ci_netif_unlock(ni);
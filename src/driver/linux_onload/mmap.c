@@ -450,8 +450,16 @@ static int tcp_helper_rm_mmap_pkts(tcp_helper_resource_t* trs,
   ci_netif* ni;
   ci_netif_state* ns;
   uint64_t bufid = map_id - CI_NETIF_MMAP_ID_PKTS;
+  unsigned long set_bytes = CI_CFG_PKT_BUF_SIZE * PKTS_PER_SET;
+  uint64_t n_sets = bytes / set_bytes;
+  uint64_t id;
 
-  if( bytes != CI_CFG_PKT_BUF_SIZE * PKTS_PER_SET )
+  if( bytes == 0 || bytes % set_bytes != 0 )
+    return -EINVAL;
+  /* A mapping spanning several sets is the attach-time premap (see
+   * ci_netif_pkt_premap()), and always starts at set 0; faults within it
+   * are resolved per-set by tcp_helper_rm_nopage_pkts(). */
+  if( n_sets > 1 && bufid != 0 )
     return -EINVAL;
 
   ni = &trs->netif;
@@ -459,19 +467,25 @@ static int tcp_helper_rm_mmap_pkts(tcp_helper_resource_t* trs,
   ci_assert(ns);
 
   /* Reserve space for packet buffers */
-  if( bufid > ni->packets->sets_max || ni->pkt_bufs[bufid] == NULL ) {
-    OO_DEBUG_ERR(ci_log("%s: %u BAD bufset_id=0x%"PRIx64"", __FUNCTION__,
-                        trs->id, bufid));
-    return -EINVAL;
-  }
+  for( id = bufid; id < bufid + n_sets; ++id ) {
+    if( id > ni->packets->sets_max || ni->pkt_bufs[id] == NULL ) {
+      OO_DEBUG_ERR(ci_log("%s: %u BAD bufset_id=0x%"PRIx64"", __FUNCTION__,
+                          trs->id, id));
+      return -EINVAL;
+    }
 #ifdef OO_DO_HUGE_PAGES
-  if( oo_iobufset_get_hugetlb_page(ni->pkt_bufs[bufid]) ) {
-    OO_DEBUG_ERR(ci_log("%s: [%d] WARNING mmapping huge page from bufset=0x%"
-                        PRIx64 " will split it", __func__, trs->id, bufid));
-  }
+    if( oo_iobufset_get_hugetlb_page(ni->pkt_bufs[id]) ) {
+      if( n_sets > 1 )
+        /* Premapping would split every huge page; make the caller fall
+         * back to per-hugepage mappings via OO_IOC_PKT_BUF_MMAP. */
+        return -EINVAL;
+      OO_DEBUG_ERR(ci_log("%s: [%d] WARNING mmapping huge page from bufset=0x%"
+                          PRIx64 " will split it", __func__, trs->id, id));
+    }
 #endif
+  }
 
-  if( oo_iobufset_npages(ni->pkt_bufs[bufid]) == 1 ) {
+  if( n_sets == 1 && oo_iobufset_npages(ni->pkt_bufs[bufid]) == 1 ) {
     /* Avoid nopage handler, mmap it all at once */
     return vm_insert_page(vma, vma->vm_start, ni->pkt_bufs[bufid]->pages[0]);
   }
@@ -1,11 +1,35 @@
 /* SPDX-License-Identifier: GPL-2.0 */
 /* X-SPDX-Copyright-Text: (c) Copyright 2021 Xilinx, Inc. */
 
+#include <linux/topology.h>
+#include <linux/workqueue.h>
+
 #include <onload/debug.h>
 #include <onload/oo_shmbuf.h>
 
 
-int oo_shmbuf_alloc(struct oo_shmbuf* sh, int order, int max, int init_num)
+static long oo_shmbuf_vmalloc_fn(void* arg)
+{
+  return (long)(uintptr_t)vmalloc_user(*(unsigned long*)arg);
+}
+
+/* Allocate a chunk, from the requested NUMA node if there is one.  vmalloc
+ * populates its pages from the node of the executing CPU, so run the
+ * allocation on a CPU of the target node. */
+static void* oo_shmbuf_vmalloc(struct oo_shmbuf* sh, unsigned long size)
+{
+  if( sh->numa_node >= 0 && sh->numa_node < MAX_NUMNODES &&
+      node_online(sh->numa_node) ) {
+    int cpu = cpumask_any_and(cpumask_of_node(sh->numa_node),
+                              cpu_online_mask);
+    if( cpu < nr_cpu_ids )
+      return (void*)(uintptr_t)work_on_cpu(cpu, oo_shmbuf_vmalloc_fn, &size);
+  }
+  return vmalloc_user(size);
+}
+
+int oo_shmbuf_alloc(struct oo_shmbuf* sh, int order, int max, int init_num,
+                    int numa_node)
 {
   int i;
 
@@ -13,13 +37,15 @@ int oo_shmbuf_alloc(struct oo_shmbuf* sh, int order, int max, int init_num)
   sh->order = order;
   sh->num = init_num;
   sh->init_num = init_num;
+  sh->numa_node = numa_node;
   mutex_init(&sh->lock);
 
   sh->addrs = kzalloc(sizeof(sh->addrs[0]) * max, GFP_KERNEL);
   if( sh->addrs == NULL )
     return -ENOMEM;
 
-  sh->addrs[0] = vmalloc_user((unsigned long)init_num << PAGE_SHIFT << order);
+  sh->addrs[0] = oo_shmbuf_vmalloc(sh,
+                          (unsigned long)init_num << PAGE_SHIFT << order);
   if( sh->addrs[0] == 0 ) {
     ci_log("%s: failed to allocate a virtually-continuous buffer of size %ld",
            __func__, (unsigned long)init_num << PAGE_SHIFT << order);
@@ -58,7 +84,7 @@ int oo_shmbuf_add(struct oo_shmbuf* sh)
   i = sh->num;
   /* Fixme implement locking */
 
-  sh->addrs[i] = vmalloc_user(PAGE_SIZE << sh->order);
+  sh->addrs[i] = oo_shmbuf_vmalloc(sh, PAGE_SIZE << sh->order);
   if( sh->addrs[i] == 0 ) {
     mutex_unlock(&sh->lock);
     return -ENOMEM;
@@ -123,6 +123,7 @@ int oo_timesync_ctor(struct oo_timesync *oo_ts)
   /* Set to zero to prevent smoothing when first set */
   oo_ts->smoothed_ticks = 0;
   oo_ts->smoothed_ns = 0;
+  oo_ts->max_error_ns = 0;
   oo_ts->generation_count = 0;
   oo_ts->update_jiffies = jiffies - 1;
 
@@ -158,6 +159,7 @@ static int timesync_smooth_i = 0;
 void oo_timesync_update(struct oo_timesync *oo_ts)
 {
   ci_uint64 frc, ticks, ns;
+  ci_uint64 predicted_ns, err_ns;
   struct timespec64 mono_ts, wall_ts;
   int use_this_sample = 1;
 
@@ -225,6 +227,19 @@ void oo_timesync_update(struct oo_timesync *oo_ts)
          */
         ci_assert_le(ns, TEN_SECOND_IN_NS);
 
+        /* Maintain a bound on the error of frc->wall-clock conversions
+         * made from this page: how far a conversion of this interval
+         * using the previous rate estimate lands from the new system
+         * clock sample.  Decayed so old outliers age out.
+         */
+        if( oo_timesync_cpu_khz != 0 ) {
+          predicted_ns = ticks * 1000000 / oo_timesync_cpu_khz;
+          err_ns = predicted_ns > ns ? predicted_ns - ns : ns - predicted_ns;
+          oo_ts->max_error_ns -= oo_ts->max_error_ns >> 2;
+          if( err_ns > oo_ts->max_error_ns )
+            oo_ts->max_error_ns = err_ns;
+        }
+
         oo_ts->smoothed_ticks += ticks;
         oo_ts->smoothed_ticks -=
           timesync_smooth_tick_samples[timesync_smooth_i];
@@ -2185,6 +2185,25 @@ int efrm_filter_query(struct efrm_client *client, int filter_id, int *rxq,
 EXPORT_SYMBOL(efrm_filter_query);
 
 
+/* Read back the hardware match count for [filter_id].  Returns -EOPNOTSUPP
+ * when the NIC keeps no such counter; the read is a control-path query with
+ * no datapath cost. */
+int efrm_filter_query_hits(struct efrm_client *client, int filter_id,
+                           uint64_t *hits)
+{
+	struct efhw_nic *efhw_nic = efrm_client_get_nic(client);
+	struct efhw_filter_info info = {.rxq = -1, .hw_id = -1, .flags = 0};
+	int rc = efhw_nic_filter_query(efhw_nic, filter_id, &info);
+	if (rc < 0)
+		return rc;
+	if (!(info.flags & EFHW_FILTER_F_HITS_VALID))
+		return -EOPNOTSUPP;
+	*hits = info.hits;
+	return 0;
+}
+EXPORT_SYMBOL(efrm_filter_query_hits);
+
+
 int efrm_filter_block_kernel(struct efrm_client *client, int flags, bool block)
 {
 	struct efhw_nic *efhw_nic = efrm_client_get_nic(client);
@@ -148,6 +148,7 @@ EFRM_TASK_HAS_CPUMASK		member	struct_task_struct	cpus_mask	include/linux/sched.h
 
 EFRM_HAVE_LOWCASE_PDE_DATA symbol pde_data include/linux/proc_fs.h
 EFRM_HAVE_NETIF_RX_NI symbol netif_rx_ni include/linux/netdevice.h
+EFRM_HAVE_NETIF_RECEIVE_SKB_LIST symbol netif_receive_skb_list include/linux/netdevice.h
 
 EFRM_HAVE_MODULE_MUTEX		symbol	module_mutex	include/linux/module.h
 EFRM_HAVE_ITER_UBUF symbol ITER_UBUF include/linux/uio.h
@@ -15,8 +15,14 @@ struct efab_af_xdp_offsets_ring
   int64_t producer;
   int64_t consumer;
   int64_t desc;
+  int64_t flags;
 };
 
+/* Value of [flags] when the kernel socket was bound without
+ * XDP_USE_NEED_WAKEUP; consumers must then assume that a wakeup is always
+ * needed. */
+#define EFAB_AF_XDP_NO_RING_FLAGS -1
+
 struct efab_af_xdp_offsets_rings
 {
   struct efab_af_xdp_offsets_ring rx;
@@ -429,6 +429,32 @@ oo_remap_vmalloc_range_partial(struct vm_area_struct *vma, unsigned long uaddr,
 #define ci_netif_rx_non_irq netif_rx
 #endif /* EFRM_HAVE_NETIF_RX_NI */
 
+/* Hand a batch of skbs to the kernel stack from non-interrupt context in a
+ * single entry, amortising the per-call RX overheads. */
+#ifdef EFRM_HAVE_NETIF_RECEIVE_SKB_LIST
+/* linux >= 4.19 */
+static inline void ci_netif_receive_skb_batch(struct sk_buff** skbs, int n)
+{
+  struct list_head list;
+  int i;
+
+  INIT_LIST_HEAD(&list);
+  for( i = 0; i < n; ++i )
+    list_add_tail(&skbs[i]->list, &list);
+  local_bh_disable();
+  netif_receive_skb_list(&list);
+  local_bh_enable();
+}
+#else
+static inline void ci_netif_receive_skb_batch(struct sk_buff** skbs, int n)
+{
+  int i;
+
+  for( i = 0; i < n; ++i )
+    ci_netif_rx_non_irq(skbs[i]);
+}
+#endif /* EFRM_HAVE_NETIF_RECEIVE_SKB_LIST */
+
 #ifndef EFRM_HAVE_VM_FLAGS_SET
 /* Linux < 6.3 */
 static inline void vm_flags_set(struct vm_area_struct *vma, vm_flags_t flags)
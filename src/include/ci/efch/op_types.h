@@ -215,6 +215,8 @@ typedef struct ci_resource_op_s {
 # define                CI_RSOP_RXQ_REFRESH             0x8B
 # define                CI_RSOP_FILTER_QUERY            0x8C
 # define                CI_RSOP_VI_DESIGN_PARAMETERS    0x8D
+# define                CI_RSOP_VI_GET_IRQ              0x8E
+# define                CI_RSOP_VI_IRQ_AFFINITY         0x8F
 
   union {
     struct {
@@ -330,6 +332,12 @@ typedef struct ci_resource_op_s {
       uint64_t          data_ptr; /* struct efab_nic_design_parameters */
       uint64_t          data_len;
     } design_parameters;
+    struct {
+      uint32_t          out_irq;
+    } vi_get_irq;
+    struct {
+      int32_t           cpu;
+    } vi_irq_affinity;
   } u CI_ALIGN(8);
 } ci_resource_op_t;
 
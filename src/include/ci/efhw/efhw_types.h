@@ -161,6 +161,11 @@ struct efhw_filter_info {
 	int rxq;
 	int hw_id;
 	int flags;
+	/* Number of packets the hardware has matched against this filter.
+	 * Only meaningful when flags has EFHW_FILTER_F_HITS_VALID set;
+	 * NICs whose firmware exposes no per-filter match counter leave
+	 * it unset. */
+	uint64_t hits;
 };
 
 /**********************************************************************
@@ -201,6 +206,9 @@ struct efx_filter_spec;
 #define EFHW_PD_NON_EXC_TOKEN 0xFFFFFFFF
 
 #define EFHW_FILTER_F_IS_EXCL 0x0004
+/* Set in efhw_filter_info::flags by filter_query when the backend was able
+ * to report a per-filter match count in efhw_filter_info::hits. */
+#define EFHW_FILTER_F_HITS_VALID 0x0008
 
 /*--------------------------------------------------------------------
  *
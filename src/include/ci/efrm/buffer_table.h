@@ -80,6 +80,12 @@ struct efrm_bt_manager {
 	/* Block with some free entries */
 	struct efhw_buffer_table_block *btm_block;
 
+	/* Hardware-allocated blocks with no entries in use, retained so
+	 * that re-registration does not pay the chunk alloc/free MCDI
+	 * round-trips again.  Linked via btb_next; protected by btm_lock. */
+	struct efhw_buffer_table_block *btm_cached_blocks;
+	int btm_cached_n;
+
 	/* Owner for all buftable entries we manage */
 	int owner;
 
@@ -286,6 +286,16 @@ extern void efrm_vi_get_dev_name(struct efrm_vi *virs, char* name);
 
 extern int efrm_vi_get_channel(struct efrm_vi *);
 
+/* Report the absolute IRQ number servicing this VI's event queue.  Only
+ * meaningful on architectures where efrm manages the interrupt itself;
+ * returns -EOPNOTSUPP where wakeups are handled by the net driver. */
+extern int efrm_vi_get_irq(struct efrm_vi *, uint32_t *irq_out);
+
+/* Steer the interrupt servicing this VI's event queue to the given CPU.
+ * The affinity applies to the whole vector, and so affects any other VIs
+ * sharing it. */
+extern int efrm_vi_irq_affinity(struct efrm_vi *, int cpu);
+
 extern int efrm_vi_set_get_vi_instance(struct efrm_vi *);
 
 extern int efrm_vi_af_xdp_kick(struct efrm_vi *vi);
@@ -64,6 +64,13 @@ efrm_vi_set_get_base(struct efrm_vi_set *);
 extern int
 efrm_vi_set_get_rss_context(struct efrm_vi_set *, unsigned rss_id);
 
+extern int
+efrm_vi_set_rss_rebalance(struct efrm_vi_set *, const uint32_t *weights,
+			  int n_weights);
+
+extern int
+efrm_vi_set_reset(struct efrm_vi_set *);
+
 extern struct efrm_resource *
 efrm_vi_set_to_resource(struct efrm_vi_set *);
 
@@ -78,6 +78,14 @@
 #endif
 #endif
 
+/* This should match with UL-only header onload/extensions.h */
+#ifndef ONLOAD_TCP_RX_STEER
+#define ONLOAD_TCP_RX_STEER  47430
+#endif
+#ifndef ONLOAD_UDP_RX_MAILBOXES
+#define ONLOAD_UDP_RX_MAILBOXES  47431
+#endif
+
 
 /**********************************************************************
  ************************* Version management *************************
@@ -411,6 +419,10 @@ typedef struct {
   ci_int32      sack_blocks;
   ci_uint32     ack,seq;         /* ACK and SEQ values in host endian */
   ci_uint32     hash;            /* hash for l/r addr/port */
+  ci_int32      hint_idx;        /* rx_flow_hint slot to refresh on
+                                    delivery, or -1 (EF_RX_FLOW_HINT) */
+  ci_int32      nic_hint_idx;    /* rx_nic_flow_hint slot to refresh on
+                                    delivery, or -1 */
 } ciip_tcp_rx_pkt;
 
 
@@ -437,6 +449,10 @@ typedef struct {
 #else
 # define NI_OPTS(ni)  ((ni)->state->opts)
 #endif
+/* Read-only cache-line-packed image of hot-path options; see
+ * struct ci_netif_hot_opts. */
+#define NI_HOT_OPTS(ni)  ((ni)->hot_opts)
+
 #define NI_IPID(ni)  (&(ni)->state->ipid)
 
 #ifdef __KERNEL__
@@ -450,6 +466,7 @@ typedef struct {
 
 
 extern void ci_netif_config_opts_rangecheck(ci_netif_config_opts* opts) CI_HF;
+extern void ci_netif_hot_opts_init(ci_netif* ni) CI_HF;
 extern void ci_netif_config_opts_getenv(ci_netif_config_opts* opts) CI_HF;
 extern void ci_netif_config_opts_set_derived(ci_netif_config_opts* opts) CI_HF;
 extern void ci_netif_config_opts_defaults(ci_netif_config_opts* opts) CI_HF;
@@ -482,6 +499,7 @@ extern int  ci_netif_poll_intf_future(ci_netif*, int intf_i, ci_uint64 now_frc)
 extern int  ci_netif_poll_n(ci_netif*, int max_evs) CI_HF;
 #define     ci_netif_poll(ni)  ci_netif_poll_n((ni), NI_OPTS(ni).evs_per_poll)
 extern void ci_netif_loopback_pkts_send(ci_netif* ni) CI_HF;
+extern void ci_netif_loopback_deliver(ci_netif* ni) CI_HF;
 
 #if CI_CFG_WANT_BPF_NATIVE
 #ifdef __KERNEL__
@@ -493,6 +511,47 @@ extern int  ci_netif_evq_poll_k(ci_netif* ni, int intf_i);
 #endif
 #endif
 
+#ifndef __KERNEL__
+/* Process-wide early RX filter (see onload_rx_prefilter_set()).  [fn]
+ * returns non-zero to drop the packet before protocol processing.  Only
+ * polls performed by the installing process run the filter. */
+typedef int (*oo_rx_prefilter_fn)(void* arg, const void* frame,
+                                  int frame_len);
+extern void oo_rx_prefilter_set(oo_rx_prefilter_fn fn, void* arg) CI_HF;
+
+/* A/B feed arbiter (onload_feed_arbiter_set()).  The extractor returns 0
+ * and fills *seq_out for feed packets, non-zero for everything else. */
+typedef int (*oo_feed_seq_fn)(void* arg, const void* frame, int frame_len,
+                              ci_uint64* seq_out);
+extern void oo_feed_arbiter_set(oo_feed_seq_fn fn, void* arg) CI_HF;
+extern void oo_feed_arbiter_get_stats(ci_uint64* wins, int n_arms,
+                                      ci_uint64* dups,
+                                      ci_uint64* gaps) CI_HF;
+
+/* Memory watermark notifications (onload_socket_watermarks_set()).
+ * Callers must hold the stack lock. */
+ci_inline void ci_sock_mem_watermark_register(ci_netif* ni, ci_sock_cmn* s)
+{
+  struct oo_p_dllink_state link = oo_p_dllink_sb(ni, &s->b, &s->wm_link);
+  if( oo_p_dllink_is_empty(ni, link) ) {
+    oo_p_dllink_add_tail(ni,
+                         oo_p_dllink_ptr(ni, &ni->state->mem_watermark_socks),
+                         link);
+    ++ni->state->mem_watermark_n;
+  }
+}
+
+ci_inline void ci_sock_mem_watermark_unregister(ci_netif* ni, ci_sock_cmn* s)
+{
+  struct oo_p_dllink_state link = oo_p_dllink_sb(ni, &s->b, &s->wm_link);
+  if( ! oo_p_dllink_is_empty(ni, link) ) {
+    oo_p_dllink_del_init(ni, link);
+    ci_assert_gt(ni->state->mem_watermark_n, 0);
+    --ni->state->mem_watermark_n;
+  }
+}
+#endif
+
 extern void ci_netif_tx_pkt_complete(ci_netif*, struct ci_netif_poll_state*,
                                      ci_ip_pkt_fmt*);
 /* Fake TX complete function called when a packet was deferred because of
@@ -513,8 +572,25 @@ ci_inline void ci_netif_send(ci_netif* ni, ci_ip_pkt_fmt* pkt)
   pkt->flags |= CI_PKT_FLAG_TX_PENDING;
   __ci_netif_send(ni, pkt);
 }
+extern void ci_netif_tx_pacing_timeout(ci_netif* netif) CI_HF;
 extern bool ci_netif_send_immediate(ci_netif* netif, ci_ip_pkt_fmt* pkt,
                                     const struct ef_vi_tx_extra* extra) CI_HF;
+
+#ifndef __KERNEL__
+/* Doorbell batching for sendmmsg() and EF_POLL_TX_DOORBELL_BATCH: while
+ * [ci_tx_batching] is non-zero, ci_netif_send() initialises DMA
+ * descriptors without ringing the doorbell and records the interface in
+ * [ci_tx_batch_pending]; ci_netif_tx_batch_flush() then rings each
+ * pending doorbell once.  Deferral is bounded: after CI_TX_BATCH_LIMIT
+ * deferred sends, counted in [ci_tx_batch_n], the batch flushes itself.
+ * Thread-local, so concurrent senders on other threads are unaffected. */
+#define CI_TX_BATCH_LIMIT  64u
+extern __thread unsigned ci_tx_batching;
+extern __thread unsigned ci_tx_batch_pending;
+extern __thread unsigned ci_tx_batch_n;
+extern __thread ci_netif* ci_tx_batch_ni;
+extern void ci_netif_tx_batch_flush(ci_netif* netif) CI_HF;
+#endif
 extern int ci_netif_rx_post(ci_netif* netif, int nic_index, ef_vi* vi) CI_HF;
 extern int  ci_netif_set_rxq_limit(ci_netif*) CI_HF;
 #ifdef __KERNEL__
@@ -522,6 +598,13 @@ extern int  ci_netif_init_fill_rx_rings(ci_netif*) CI_HF;
 #endif
 extern ci_uint64 ci_netif_purge_deferred_socket_list(ci_netif* ni) CI_HF;
 extern void ci_netif_merge_atomic_counters(ci_netif* ni) CI_HF;
+#ifndef __KERNEL__
+/* Enqueue an (op, arg) request on the shared-memory slow-path command
+ * ring.  Returns -EAGAIN if the ring is full; callers fall back to the
+ * equivalent synchronous ioctl. */
+extern int ci_netif_slowpath_req(ci_netif* ni, ci_uint32 op,
+                                 ci_uint32 arg) CI_HF;
+#endif
 extern void ci_netif_mem_pressure_pkt_pool_fill(ci_netif*) CI_HF;
 extern int  ci_netif_mem_pressure_try_exit(ci_netif*) CI_HF;
 
@@ -547,6 +630,10 @@ extern void ci_netif_dump_extra(ci_netif* ni) CI_HF;
 extern void ci_netif_dump_extra_to_logger(ci_netif* ni,
                                           oo_dump_log_fn_t logger,
                                           void *log_arg) CI_HF;
+extern void ci_netif_dump_tuning_advice(ci_netif* ni) CI_HF;
+extern void ci_netif_dump_tuning_advice_to_logger(ci_netif* ni,
+                                                  oo_dump_log_fn_t logger,
+                                                  void *log_arg) CI_HF;
 extern void ci_netif_dump_sockets(ci_netif* ni) CI_HF;
 extern void ci_netif_dump_sockets_to_logger(ci_netif* ni,
                                             oo_dump_log_fn_t logger,
@@ -563,6 +650,74 @@ extern void ci_netif_config_opts_dump(ci_netif_config_opts* opts,
                                       void* log_arg) CI_HF;
 extern void ci_stack_time_dump(ci_netif* ni, oo_dump_log_fn_t logger,
                                void* log_arg) CI_HF;
+#ifndef __KERNEL__
+extern void oo_stats_export_attach(ci_netif* ni) CI_HF;
+extern void oo_stats_export_refresh(ci_netif* ni) CI_HF;
+#endif
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+extern void ci_netif_dump_flight_recorder_to_logger(ci_netif* ni,
+                                                    oo_dump_log_fn_t logger,
+                                                    void* log_arg) CI_HF;
+
+/* Flight recorder event codes.  Keep fr_event_names[] in netif_debug.c in
+ * step with this list. */
+#define CI_FR_EV_POLL           1  /* arg16=kernel?, arg32=events handled */
+#define CI_FR_EV_TCP_RX_DROP    2  /* arg16=payload len, arg32=seq */
+#define CI_FR_EV_TCP_RX_BAD_SEQ 3  /* arg16=sock id, arg32=seq */
+#define CI_FR_EV_LOCK_CONTEND   4  /* arg32=lock word (low bits) */
+
+/* Append a record to the stack's flight recorder.  Safe to call from any
+ * context, locked or not: the slot is claimed with a single atomic add and
+ * the record body is written without synchronisation, so a reader that
+ * races with the ring wrapping may see a torn record.  That is fine for a
+ * diagnostic trace, and keeps the cost down to a handful of instructions
+ * so the recorder can stay enabled in production. */
+ci_inline void ci_netif_fr_log(ci_netif* ni, ci_uint16 event,
+                               ci_uint16 arg16, ci_uint32 arg32)
+{
+  ci_uint32 i = ci_atomic_xadd(&ni->state->fr_wr, 1);
+  ci_fr_record* r =
+    &ni->state->fr_ring[i & (CI_CFG_FLIGHT_RECORDER_ENTRIES - 1)];
+  r->event = event;
+  r->arg16 = arg16;
+  r->arg32 = arg32;
+  ci_frc64(&r->frc);
+}
+#else
+# define ci_netif_fr_log(ni, event, arg16, arg32)  do {} while( 0 )
+#endif
+
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+extern void ci_netif_dump_drops_to_logger(ci_netif* ni,
+                                          oo_dump_log_fn_t logger,
+                                          void* log_arg) CI_HF;
+
+/* Record a sampled copy of a dropped frame's headers in the per-reason
+ * drop ring.  Called from the RX drop sites with the stack lock held, so
+ * plain stores suffice; the reader (stackdump) tolerates a torn sample on
+ * a running stack. */
+ci_inline void ci_netif_drop_sample(ci_netif* ni, int reason, int intf_i,
+                                    const void* frame, int frame_len)
+{
+  ci_drop_ring* ring = &ni->state->drop_rings[reason];
+  ci_drop_sample* s = &ring->sample[ring->wr];
+  int n = CI_MIN(frame_len, CI_DROP_SAMPLE_BYTES);
+
+  ci_assert_lt(reason, CI_DROP_REASON_MAX);
+  ci_frc64(&s->frc);
+  s->frame_len = frame_len > 0 ? frame_len : 0;
+  s->intf_i = intf_i;
+  if( n > 0 )
+    memcpy(s->data, frame, n);
+  if( n < CI_DROP_SAMPLE_BYTES )
+    memset(s->data + CI_MAX(n, 0), 0, CI_DROP_SAMPLE_BYTES - CI_MAX(n, 0));
+  ring->wr = (ring->wr + 1) % CI_CFG_DROP_SAMPLES_PER_REASON;
+  ++ring->n;
+}
+#else
+# define ci_netif_drop_sample(ni, reason, intf_i, frame, frame_len) \
+  do {} while( 0 )
+#endif
 extern void ci_netif_pkt_dump_all(ci_netif* ni) CI_HF;
 extern void ci_netif_pkt_queue_dump(ci_netif* ni, ci_ip_pkt_queue* q,
                                     int is_recv, int dump) CI_HF;
@@ -671,6 +826,7 @@ extern ci_ip_pkt_fmt* ci_netif_pkt_alloc_slow(ci_netif*, int flags) CI_HF;
 extern int ci_netif_pkt_try_to_free(ci_netif* ni, int desperation,
                                     int stop_once_freed_n) CI_HF;
 extern void ci_netif_try_to_reap(ci_netif* ni, int stop_once_freed_n) CI_HF;
+extern void ci_netif_udp_reasm_flush(ci_netif* ni) CI_HF;
 extern void ci_netif_rxq_low_on_recv(ci_netif*, ci_sock_cmn*,
                                      int bytes_freed) CI_HF;
 
@@ -885,8 +1041,16 @@ void ci_pkt_init_from_ipcache_len(ci_ip_pkt_fmt *pkt,
     ci_assert_equal(ipcache->ether_type, CI_ETHERTYPE_IP);
   }
   oo_tx_pkt_layout_update(pkt, ipcache->ether_offset);
-  memcpy(oo_tx_ether_hdr(pkt), ci_ip_cache_ether_hdr(ipcache),
-         header_len + oo_tx_ether_hdr_size(pkt));
+  if( header_len == sizeof(ci_ip4_hdr) + sizeof(ci_tcp_hdr) &&
+      oo_tx_ether_hdr_size(pkt) == ETH_HLEN )
+    /* Common case: IPv4 TCP with no VLAN tag.  The compile-time size lets
+     * the compiler emit straight-line wide stores rather than a call to
+     * memcpy() with a runtime length. */
+    memcpy(oo_tx_ether_hdr(pkt), ci_ip_cache_ether_hdr(ipcache),
+           ETH_HLEN + sizeof(ci_ip4_hdr) + sizeof(ci_tcp_hdr));
+  else
+    memcpy(oo_tx_ether_hdr(pkt), ci_ip_cache_ether_hdr(ipcache),
+           header_len + oo_tx_ether_hdr_size(pkt));
   if( !ipcache_is_ipv6(ipcache) ) {
     ci_assert_equal(CI_IP4_IHL(oo_tx_ip_hdr(pkt)), sizeof(ci_ip4_hdr));
     ci_assert_equal(oo_tx_ether_type_get(pkt), CI_ETHERTYPE_IP);
@@ -958,6 +1122,9 @@ extern int ci_udp_getsockopt(citp_socket* ep, ci_fd_t fd, int level,
 extern int ci_udp_setsockopt(citp_socket* ep, ci_fd_t fd, int level,
 		     int optname, const void*optval, socklen_t optlen) CI_HF;
 extern int ci_udp_ioctl(citp_socket*, ci_fd_t, int request, void* arg) CI_HF;
+extern int ci_udp_mcast_join_batch(citp_socket* ep, ci_fd_t fd,
+                                   ci_ifid_t ifindex, const ci_uint32* maddrs,
+                                   int count) CI_HF;
 #endif
 
 /* Send/recv called from within kernel & user-library, so outside above #if */
@@ -966,6 +1133,22 @@ extern int ci_udp_sendmsg(ci_udp_iomsg_args *a,
 extern int ci_udp_recvmsg(ci_udp_iomsg_args *a, ci_msghdr*,
                           int flags) CI_HF;
 
+#ifndef __KERNEL__
+/* Maximum number of destinations for a single ci_udp_fanout_send() call. */
+#define CI_UDP_FANOUT_SEND_MAX  64
+
+/* Send one datagram to [n_dests] destinations, copying the payload out of
+ * user memory once and sharing the payload packet buffers between the
+ * clones by reference.  Returns the payload length on success, -EOPNOTSUPP
+ * if the datagram or socket state cannot take the fanout fast path (the
+ * caller should fall back to one sendmsg per destination), or other
+ * -errno. */
+extern int ci_udp_fanout_send(ci_udp_iomsg_args* a, const ci_msghdr* msg,
+                              int flags, const ci_addr_t* daddrs,
+                              const ci_uint16* dports_be16,
+                              int n_dests) CI_HF;
+#endif
+
 extern void ci_udp_set_no_unicast(citp_socket* ep) CI_HF;
 
 #ifdef __KERNEL__
@@ -988,10 +1171,12 @@ typedef enum {
 
 #ifndef __KERNEL__
 struct mmsghdr;
-extern int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg, 
-                           unsigned int vlen, int flags, 
+extern int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
+                           unsigned int vlen, int flags,
                            const struct timespec* timeout
                            CI_KERNEL_ARG(ci_addr_spc_t addr_spc)) CI_HF;
+extern int ci_udp_sendmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
+                           unsigned int vlen, int flags) CI_HF;
 
 struct onload_zc_mmsg;
 extern int ci_tcp_zc_send(ci_netif* ni, ci_tcp_state* ts, 
@@ -1012,6 +1197,13 @@ ci_tcp_ds_fill_headers(ci_netif* ni, ci_tcp_state* ts, unsigned flags,
                        int* tcp_seq_offset_out, int* ip_len_offset_out);
 extern int ci_tcp_ds_done(ci_netif* ni, ci_tcp_state* ts,
                           const ci_iovec *iov, int iovlen, int flags);
+struct onload_zc_iovec;
+extern int ci_tcp_ds_done_zc(ci_netif* ni, ci_tcp_state* ts,
+                             const struct onload_zc_iovec* iov, int iovlen,
+                             int flags);
+
+extern int ci_tcp_splice(ci_netif* ni, ci_tcp_state* ts_in,
+                         ci_tcp_state* ts_out, int len);
 
 extern int
 ci_netif_raw_send(ci_netif* ni, int intf_i,
@@ -1029,6 +1221,7 @@ extern void ci_udp_state_try_free(ci_netif*, ci_udp_state*) CI_HF;
 extern int ci_udp_csum_correct(ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp) CI_HF;
 
 extern void ci_udp_sendmsg_send_async_q(ci_netif*, ci_udp_state*) CI_HF;
+extern void ci_udp_sendmsg_drain_staged(ci_netif*) CI_HF;
 extern void ci_udp_perform_deferred_socket_work(ci_netif*, ci_udp_state*)CI_HF;
 extern int ci_udp_try_to_free_pkts(ci_netif*, ci_udp_state*,
                                     int desperation) CI_HF;
@@ -1437,6 +1630,7 @@ ci_inline bool ci_tcp_plugin_tcp_app_packet(const ci_ip_pkt_fmt* pkt)
 }
 
 extern ci_tcp_state* ci_tcp_get_state_buf(ci_netif*) CI_HF;
+extern void ci_tcp_state_pool_refill(ci_netif*) CI_HF;
 #if ! defined(__KERNEL__) && CI_CFG_FD_CACHING
 extern ci_tcp_state* ci_tcp_get_state_buf_from_cache(ci_netif*, int pid) CI_HF;
 #endif
@@ -1519,6 +1713,9 @@ extern void ci_tcp_set_sndbuf_from_sndbuf_pkts(ci_netif* ni, ci_tcp_state* ts);
 extern int
 ci_tcp_use_mac_filter_listen(ci_netif* ni, ci_sock_cmn* s, ci_ifid_t ifindex);
 
+extern int
+ci_tcp_use_mac_filter_active(ci_netif* ni, ci_sock_cmn* s, ci_ifid_t ifindex);
+
 #ifndef __KERNEL__
 extern int
 ci_tcp_can_set_filter_in_ul(ci_netif *ni, ci_sock_cmn* s);
@@ -1527,6 +1724,25 @@ ci_tcp_can_set_filter_in_ul(ci_netif *ni, ci_sock_cmn* s);
 extern int
 ci_tcp_sock_set_stack_filter(ci_netif *ni, ci_sock_cmn* s);
 
+#if CI_CFG_TCP_SOCK_TELEMETRY
+/* Append an entry to the socket's telemetry ring.  Caller holds the stack
+ * lock, which serialises writers; readers are lock-free. */
+ci_inline void ci_tcp_telem_record(ci_tcp_state* ts, ci_uint32 ev,
+                                   ci_uint32 val)
+{
+  oo_tcp_telem_entry* e =
+    &ts->telem.ring[ts->telem.wr % CI_CFG_TCP_TELEM_RING_LEN];
+  ci_frc64(&e->frc);
+  e->ev = ev;
+  e->val = val;
+  /* Make the entry visible before publishing it. */
+  ci_wmb();
+  ++ts->telem.wr;
+}
+#else
+# define ci_tcp_telem_record(ts, ev, val)  do{}while(0)
+#endif
+
 extern void
 ci_tcp_sock_clear_stack_filter(ci_netif *ni, ci_tcp_state* ts);
 
@@ -1539,6 +1755,10 @@ ci_tcp_offload_get_stream_id(ci_netif* ni, ci_tcp_state* ts, int intf_i);
 
 extern void ci_tcp_prev_seq_remember(ci_netif*, ci_tcp_state*);
 extern ci_uint32 ci_tcp_prev_seq_lookup(ci_netif*, const ci_tcp_state*);
+extern ci_uint32 ci_tcp_prev_seq_lookup_tuple(ci_netif*,
+                                              ci_addr_t laddr, ci_uint16 lport,
+                                              ci_addr_t raddr,
+                                              ci_uint16 rport);
 
 /*********************************************************************
 ****************************** PIPE ***********************************
@@ -1627,6 +1847,9 @@ extern void ci_tcp_listenq_drop(ci_netif*, ci_tcp_socket_listen*,
 extern ci_tcp_state_synrecv* ci_tcp_listenq_lookup(ci_netif* netif,
 						   ci_tcp_socket_listen* tls,
 						   ciip_tcp_rx_pkt*) CI_HF;
+extern void ci_tcp_listenq_prefetch(ci_netif* netif,
+                                    ci_tcp_socket_listen* tls,
+                                    ciip_tcp_rx_pkt*) CI_HF;
 extern void ci_tcp_listenq_drop_oldest(ci_netif*, ci_tcp_socket_listen*) CI_HF;
 extern int ci_tcp_listenq_drop_all(ci_netif*, ci_tcp_socket_listen*) CI_HF;
 
@@ -1635,6 +1858,7 @@ extern int ci_tcp_listenq_try_promote(ci_netif*, ci_tcp_socket_listen*,
                                       ci_ip_cached_hdrs*,
                                       ci_ip_pkt_fmt*,
                                       ci_tcp_state**) CI_HF;
+extern void ci_tcp_acceptq_flush_batch(ci_netif* ni) CI_HF;
 
 
 extern const char* ci_tcp_state_num_str(int state) CI_HF;
@@ -1654,6 +1878,7 @@ extern const char* ci_tcp_congstate_str(unsigned state) CI_HF;
 
 extern void ci_tcp_handle_rx(ci_netif*, struct ci_netif_poll_state*,
                              ci_ip_pkt_fmt*, ci_tcp_hdr*, int ip_paylen) CI_HF;
+extern void ci_tcp_rx_deferred_syns(ci_netif*) CI_HF;
 extern void ci_tcp_rx_deliver2(ci_tcp_state*,ci_netif*,ciip_tcp_rx_pkt*) CI_HF;
 extern void ci_tcp_rx_plugin_meta(ci_netif*, struct ci_netif_poll_state*,
                                   ci_ip_pkt_fmt* pkt) CI_HF;
@@ -1675,6 +1900,10 @@ extern void ci_tcp_retrans_recover(ci_netif* ni, ci_tcp_state* ts,
                                    int force_retrans_first) CI_HF;
 extern int /*bool*/
 ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+extern void ci_tcp_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+#if CI_CFG_TCP_RACK
+extern void ci_tcp_rack_detect_loss(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+#endif
 
 extern void ci_tcp_recovered(ci_netif* ni, ci_tcp_state* ts) CI_HF;
 
@@ -1701,6 +1930,8 @@ extern int ci_tcp_tx_split(ci_netif* ni, ci_tcp_state* ts, ci_ip_pkt_queue* qu,
 extern void ci_tcp_tx_advance(ci_tcp_state* ts, ci_netif* netif) CI_HF;
 extern void ci_tcp_tx_advance_to(ci_netif* ni, ci_tcp_state* ts,
                             unsigned right_edge, ci_uint32* p_stop_cntr) CI_HF;
+extern void ci_tcp_tx_send_direct(ci_netif* ni, ci_tcp_state* ts,
+                                  ci_ip_pkt_fmt* pkt) CI_HF;
 extern void ci_tcp_send_rst_with_flags(ci_netif*, ci_tcp_state*,
                                        ci_uint8 extra_flags) CI_HF;
 extern void ci_tcp_send_rst(ci_netif* netif, ci_tcp_state* ts) CI_HF;
@@ -1797,18 +2028,110 @@ ci_netif_filter_hash(ci_netif* ni, ci_addr_t laddr, unsigned lport,
                      ci_addr_t raddr, unsigned rport,
                      unsigned protocol) CI_HF;
 
+/* RX flow hint cache (EF_RX_FLOW_HINT).  The fold below is deliberately
+ * much cheaper than the filter-table hash: a hint is only ever a
+ * suggestion, and ci_netif_rx_flow_hint_probe() revalidates the socket
+ * against the packet's full 4-tuple before it is used. */
+ci_inline unsigned
+ci_netif_rx_flow_hint_idx(unsigned laddr_be32, unsigned lport_be16,
+                          unsigned raddr_be32, unsigned rport_be16)
+{
+  unsigned h = laddr_be32 ^ raddr_be32 ^ (lport_be16 << 16) ^ rport_be16;
+  h ^= h >> 16;
+  h ^= h >> 8;
+  return h & (CI_NI_RX_FLOW_HINT_SIZE - 1);
+}
+
+/* Returns the hinted socket if it is still an exact match for the packet,
+ * else NULL (in which case the caller probes the filter table as usual). */
+ci_inline ci_sock_cmn*
+ci_netif_rx_flow_hint_probe(ci_netif* ni, unsigned laddr_be32,
+                            unsigned lport_be16, unsigned raddr_be32,
+                            unsigned rport_be16, int intf_i, int vlan,
+                            unsigned idx)
+{
+  oo_sp sp = ni->state->rx_flow_hint[idx];
+  ci_sock_cmn* s;
+
+  if( OO_SP_IS_NULL(sp) ||
+      (unsigned) OO_SP_TO_INT(sp) >= (unsigned) ni->state->n_ep_bufs )
+    return NULL;
+  s = ID_TO_SOCK_CMN(ni, sp);
+  if( (s->b.state & CI_TCP_STATE_TCP) && s->b.state != CI_TCP_LISTEN &&
+#if CI_CFG_IPV6
+      ipcache_af(&s->pkt) == AF_INET &&
+#endif
+      sock_laddr_be32(s) == laddr_be32 && sock_lport_be16(s) == lport_be16 &&
+      sock_raddr_be32(s) == raddr_be32 && sock_rport_be16(s) == rport_be16 &&
+      sock_protocol(s) == IPPROTO_TCP &&
+      (s->rx_bind2dev_ifindex == CI_IFID_BAD ||
+       ((s->rx_bind2dev_hwports &
+         (1ull << ni->state->intf_i_to_hwport[intf_i])) != 0 &&
+        s->rx_bind2dev_vlan == vlan)) )
+    return s;
+  return NULL;
+}
+
+/* NIC flow-hash hint table.  The RX prefix carries the adapter's RSS hash
+ * of the flow, which is available at event-decode time before any packet
+ * header has been touched.  rx_nic_flow_hint[] remembers the socket each
+ * hash value last delivered to, so the poll loop can prefetch the
+ * probable socket state one event ahead of demux and hide the socket
+ * cache misses under event decode.  A wrong or stale hint merely
+ * prefetches the wrong lines; demux never trusts it. */
+ci_inline unsigned
+ci_netif_rx_nic_hint_idx(ci_uint32 flow_hash)
+{
+  flow_hash ^= flow_hash >> 16;
+  flow_hash ^= flow_hash >> 8;
+  return flow_hash & (CI_NI_RX_FLOW_HINT_SIZE - 1);
+}
+
+ci_inline void
+ci_netif_rx_nic_hint_prefetch(ci_netif* ni, const ef_vi* vi,
+                              const ci_ip_pkt_fmt* pkt)
+{
+  unsigned idx = ci_netif_rx_nic_hint_idx(
+                     ef_vi_receive_prefix_flow_hash(vi, pkt->dma_start));
+  oo_sp sp = ni->state->rx_nic_flow_hint[idx];
+  if( OO_SP_NOT_NULL(sp) &&
+      (unsigned) OO_SP_TO_INT(sp) < (unsigned) ni->state->n_ep_bufs ) {
+    char* s = (char*) ID_TO_SOCK_CMN(ni, sp);
+    ci_prefetch(s);
+    ci_prefetch(s + CI_CACHE_LINE_SIZE);
+  }
+}
+
 extern int
 ci_netif_filter_insert(ci_netif* netif, oo_sp sock_id, int af_space,
                        const ci_addr_t laddr, unsigned lport,
                        const ci_addr_t raddr, unsigned rport, 
                        unsigned protocol) CI_HF;
 
-extern void 
+extern void
 ci_netif_filter_remove(ci_netif* netif, oo_sp tcp_id, int af_space,
                        const ci_addr_t laddr, unsigned lport,
                        const ci_addr_t raddr, unsigned rport,
                        unsigned protocol) CI_HF;
 
+/* Multicast demux table (EF_MCAST_DEMUX).  Maintained alongside the
+ * software filter table for multicast UDP filters; demux falls back to the
+ * filter table whenever the table is not authoritative. */
+extern void
+ci_netif_mcast_tbl_insert(ci_netif* netif, oo_sp sock_id,
+                          unsigned group, unsigned lport) CI_HF;
+
+extern void
+ci_netif_mcast_tbl_remove(ci_netif* netif, oo_sp sock_id,
+                          unsigned group, unsigned lport) CI_HF;
+
+extern int
+ci_netif_mcast_tbl_for_each_match(ci_netif* ni, unsigned daddr, unsigned dport,
+                                  unsigned saddr, unsigned sport,
+                                  int intf_i, int vlan,
+                                  int (*callback)(ci_sock_cmn*, void*),
+                                  void* callback_arg) CI_HF;
+
 #if CI_CFG_UL_INTERRUPT_HELPER || defined(__KERNEL__)
 ci_inline void
 oo_sw_filter_apply(ci_netif* ni, struct oo_sw_filter_op* op)
@@ -1907,8 +2230,13 @@ extern void ci_tcp_timeout_listen(ci_netif* netif,
 extern void ci_tcp_timeout_kalive(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_zwin(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_delack(ci_netif* netif, ci_tcp_state* ts) CI_HF;
+extern void ci_tcp_fast_ack_check(ci_netif* netif) CI_HF;
+extern void ci_tcp_cork_deadline_check(ci_netif* netif) CI_HF;
 extern void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_timeout_cork(ci_netif* netif, ci_tcp_state* ts) CI_HF;
+#if CI_CFG_TCP_RACK
+extern void ci_tcp_timeout_rack(ci_netif* netif, ci_tcp_state* ts) CI_HF;
+#endif
 extern void ci_tcp_timeout_recycle(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_stop_timers(ci_netif* netif, ci_tcp_state* ts) CI_HF;
 extern void ci_tcp_send_corked_packets(ci_netif* netif, ci_tcp_state* ts) CI_HF;
@@ -1960,12 +2288,18 @@ extern int ci_tcp_setsockopt(citp_socket* ep, ci_fd_t fd, int level, int optname
 extern int ci_tcp_ioctl(citp_socket* ep, ci_fd_t fd, int request, void* arg) CI_HF;
 
 struct oo_msg_template;
+struct onload_template_msg;
 struct onload_template_msg_update_iovec;
 
 extern int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
                              struct oo_msg_template** omt_pp,
                              const struct iovec* initial_msg, int mlen,
                              unsigned flags) CI_HF;
+extern int ci_tcp_tmpl_alloc_array(ci_netif* ni, ci_tcp_state* ts,
+                                   const struct onload_template_msg* msgs,
+                                   int ntemplates,
+                                   struct oo_msg_template** handles,
+                                   unsigned flags) CI_HF;
 extern int
 ci_tcp_tmpl_update(ci_netif* ni, ci_tcp_state* ts,
                    struct oo_msg_template* omt,
@@ -1991,6 +2325,11 @@ extern int ci_tcp_recvmsg(const ci_tcp_recvmsg_args*) CI_HF;
 struct onload_zc_recv_args;
 extern int ci_tcp_zc_recvmsg(const ci_tcp_recvmsg_args*,
                              struct onload_zc_recv_args* args) CI_HF;
+#ifndef __KERNEL__
+struct onload_recv_framing;
+extern int ci_tcp_recv_framing_set(ci_netif* ni, ci_tcp_state* ts,
+                                   const struct onload_recv_framing* frm) CI_HF;
+#endif
 extern int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
                           const ci_iovec* iov, unsigned long iovlen,
                           int flags
@@ -2495,6 +2834,7 @@ ci_inline citp_waitable_obj* SOCK_TO_WAITABLE_OBJ(ci_sock_cmn* s)
 ci_inline void ci_udp_recv_q_init(ci_udp_recv_q* q) {
   q->head = q->extract = OO_PP_NULL;
   q->pkts_reaped = q->pkts_delivered = q->pkts_added = 0;
+  q->compact_arena = OO_PP_NULL;
 }
 
 ci_inline int ci_udp_recv_q_is_empty(ci_udp_recv_q* q)
@@ -2513,10 +2853,72 @@ ci_inline int ci_udp_recv_q_pkts(ci_udp_recv_q* q)
 }
 
 ci_inline int ci_udp_recv_q_reapable(ci_udp_recv_q* q)
-{ 
+{
   return q->pkts_delivered - q->pkts_reaped;
 }
 
+/* Number of receive queues on a UDP socket: 1 normally, or the number of
+ * mailboxes when RX mailbox demux is enabled (ONLOAD_UDP_RX_MAILBOXES). */
+ci_inline int ci_udp_rx_q_count(ci_udp_state* us)
+{
+  return us->n_mailboxes ? us->n_mailboxes : 1;
+}
+
+/* The [i]th receive queue; recv_q acts as mailbox 0. */
+ci_inline ci_udp_recv_q* ci_udp_rx_q(ci_udp_state* us, int i)
+{
+  return i == 0 ? &us->recv_q : &us->mailbox_q[i - 1];
+}
+
+ci_inline int ci_udp_rx_q_any_not_empty(ci_udp_state* us)
+{
+  int i;
+  for( i = 0; i < ci_udp_rx_q_count(us); ++i )
+    if( ci_udp_recv_q_not_empty(ci_udp_rx_q(us, i)) )
+      return 1;
+  return 0;
+}
+
+/* Claim exclusive consumer rights on mailbox [i].  Consumers of a mailbox
+ * serialise through this bitmap rather than through the socket lock. */
+ci_inline int ci_udp_rx_q_try_claim(ci_udp_state* us, int i)
+{
+  ci_uint32 bit = 1u << i;
+  ci_uint32 old;
+  do {
+    old = OO_ACCESS_ONCE(us->mailbox_busy);
+    if( old & bit )
+      return 0;
+  } while( ! ci_cas32u_succeed(&us->mailbox_busy, old, old | bit) );
+  return 1;
+}
+
+ci_inline void ci_udp_rx_q_release(ci_udp_state* us, int i)
+{
+  ci_atomic32_and(&us->mailbox_busy, ~(1u << i));
+}
+
+/* Claim a non-empty mailbox, preferring [hint] so that a steady reader
+ * keeps returning to the same one.  Returns the mailbox index or -1 if
+ * every non-empty mailbox is claimed (or all are empty). */
+ci_inline int ci_udp_rx_q_claim_not_empty(ci_udp_state* us, int hint)
+{
+  int n = ci_udp_rx_q_count(us);
+  int i, q;
+  for( i = 0; i < n; ++i ) {
+    q = (hint + i) % n;
+    if( ci_udp_recv_q_not_empty(ci_udp_rx_q(us, q)) &&
+        ci_udp_rx_q_try_claim(us, q) ) {
+      /* Re-check now that we own it: a concurrent reader may have drained
+       * it between the emptiness test and the claim. */
+      if( ci_udp_recv_q_not_empty(ci_udp_rx_q(us, q)) )
+        return q;
+      ci_udp_rx_q_release(us, q);
+    }
+  }
+  return -1;
+}
+
 
 /*********************************************************************
 ********************** Timers and management *************************
@@ -2869,6 +3271,25 @@ ci_inline int ci_netif_need_poll_maybe_spinning(ci_netif* ni, ci_uint64 frc_now,
     return ci_netif_need_poll_frc(ni, frc_now);
 }
 
+
+/* Lock-free pre-check for a spinning thread about to attempt
+** ci_netif_trylock() in order to poll.  While another thread holds the
+** stack lock the trylock can only fail, and the holder sees the same
+** events we do, so attempting it just bounces the lock word between the
+** spinners' caches.  Callers re-check the event queues (which, like
+** [poll_gen], advance with every poll) once the lock looks free.
+**
+** Must not be used where the caller may itself hold the stack lock.
+*/
+ci_inline int ci_netif_poll_uncontended(ci_netif* ni)
+{
+  if( ef_eplock_is_locked(&ni->state->lock) ) {
+    CITP_STATS_NETIF(++ni->state->stats.spin_poll_lock_avoided);
+    return 0;
+  }
+  return 1;
+}
+
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
 ci_inline int ci_netif_should_allocate_tcp_shared_local_ports(ci_netif* ni)
 {
@@ -3175,11 +3596,24 @@ ci_inline int ci_netif_pkt_tx_can_alloc_now(ci_netif* ni) {
 ci_inline ci_ip_pkt_fmt*
 ci_netif_pkt_tx_tcp_alloc(ci_netif* ni, ci_tcp_state* ts) {
   int bufset_id;
+  ci_ip_pkt_fmt* pkt;
+  unsigned iso_dom = ts != NULL ? ts->s.iso_domain : 0u;
   ci_assert(ci_netif_is_locked(ni));
+
+  /* Sockets in a non-default isolation domain may not take more than
+   * EF_ISO_DOMAIN_PKTS buffers from the shared pool; beyond that they get
+   * the usual no-buffer backpressure while other domains carry on.
+   */
+  if( iso_dom != 0 && NI_OPTS(ni).iso_domain_pkts != 0 &&
+      ni->state->iso_dom_n_pkts[iso_dom] >= NI_OPTS(ni).iso_domain_pkts ) {
+    CITP_STATS_NETIF(++ni->state->stats.iso_dom_refused);
+    return NULL;
+  }
+
   bufset_id = NI_PKT_SET(ni);
   if(CI_LIKELY( ci_netif_pkt_tx_may_alloc(ni) &&
                 ni->packets->set[bufset_id].n_free > 0 )) {
-    return ci_netif_pkt_get(ni, bufset_id);
+    pkt = ci_netif_pkt_get(ni, bufset_id);
   }
   else {
     if( (! ci_netif_pkt_tx_may_alloc(ni)) &&
@@ -3190,9 +3624,15 @@ ci_netif_pkt_tx_tcp_alloc(ci_netif* ni, ci_tcp_state* ts) {
     /* TCP TX path is always allowed to allocate from the non-blocking pool
      * because those packet buffers are already allocated to TX.
      */
-    return ci_netif_pkt_alloc_slow(ni, CI_PKT_ALLOC_FOR_TCP_TX |
+    pkt = ci_netif_pkt_alloc_slow(ni, CI_PKT_ALLOC_FOR_TCP_TX |
                                    CI_PKT_ALLOC_USE_NONB);
   }
+
+  if( pkt != NULL && iso_dom != 0 && NI_OPTS(ni).iso_domain_pkts != 0 ) {
+    pkt->iso_domain = iso_dom;
+    ci_atomic32_inc(&ni->state->iso_dom_n_pkts[iso_dom]);
+  }
+  return pkt;
 }
 
 
@@ -3223,6 +3663,22 @@ ci_inline ci_ip_pkt_fmt* ci_netif_pkt_alloc_nonb(ci_netif* ni)
 }
 
 
+#ifndef __KERNEL__
+/* Magazine-cached variant of ci_netif_pkt_alloc_nonb(); see netif_pkt.c. */
+extern ci_ip_pkt_fmt* ci_netif_pkt_alloc_nonb_mag(ci_netif* ni) CI_HF;
+#endif
+
+/* As ci_netif_pkt_alloc_nonb(), but goes via the per-thread magazine when
+ * EF_PKT_MAGAZINE is set. */
+ci_inline ci_ip_pkt_fmt* ci_netif_pkt_alloc_nonb_cached(ci_netif* ni)
+{
+#ifndef __KERNEL__
+  if( NI_OPTS(ni).pkt_magazine )
+    return ci_netif_pkt_alloc_nonb_mag(ni);
+#endif
+  return ci_netif_pkt_alloc_nonb(ni);
+}
+
 ci_inline void ci_netif_pkt_free_nonb_list(ci_netif *ni, oo_pkt_p pkt_list,
                                              ci_ip_pkt_fmt *pkt_list_tail) 
 {
@@ -3691,6 +4147,20 @@ extern int ci_udp_timestamp_q_enqueue(ci_netif* ni, ci_udp_state* us,
                                       ci_ip_pkt_fmt* pkt);
 #endif
 
+/* Close the open compact arena, if any: the producer will append no more
+ * records, so the consumer may step past it once it is drained.  Stack
+ * should be locked. */
+ci_inline void ci_udp_compact_close(ci_netif* ni, ci_udp_recv_q* q)
+{
+  if( OO_PP_NOT_NULL(q->compact_arena) ) {
+    ci_ip_pkt_fmt* arena = PKT_CHK(ni, q->compact_arena);
+    ci_wmb();
+    arena->pf.udp.compact_closed = 1;
+    q->compact_arena = OO_PP_NULL;
+  }
+}
+
+
 /* Put a packet into recv_q but don't mark it as visible to the consumer yet.
  * Stack should be locked. */
 ci_inline void ci_udp_recv_q_put_pending(ci_netif* ni, ci_udp_recv_q* q,
@@ -3698,6 +4168,11 @@ ci_inline void ci_udp_recv_q_put_pending(ci_netif* ni, ci_udp_recv_q* q,
 {
   ci_assert(ci_netif_is_locked(ni));
 
+  /* A drained arena is only stepped past once it is closed, so close the
+   * open one before queueing behind it or the consumer would report the
+   * queue empty with this packet still waiting. */
+  ci_udp_compact_close(ni, q);
+
   if( pkt->rx_flags & CI_PKT_RX_FLAG_RECV_Q_CONSUMED ) {
     /* Changing [pkt->rx_flags] without the socket lock is safe as long as we
      * ensure that we do so before posting [pkt] to the recvq.
@@ -3864,26 +4339,119 @@ ci_inline void ci_tcp_rto_bound(ci_netif* netif, ci_tcp_state* ts) {
 }
 
 /* delayed ack timers */
-ci_inline void ci_tcp_delack_check_and_set(ci_netif* netif, 
+/* Record a delayed-ACK deadline in the stack's fast-ack array instead of
+ * arming the delack wheel timer.  Returns 0 if the array is full, in which
+ * case the caller should fall back to the timer. */
+ci_inline int ci_tcp_fast_ack_arm(ci_netif* netif, ci_tcp_state* ts,
+                                  ci_iptime_t deadline)
+{
+  ci_netif_state* ns = netif->state;
+  if( ts->tcpflags & CI_TCPT_FLAG_FAST_ACK_ARMED )
+    return 1;
+  if( ns->fast_ack_n >= CI_TCP_FAST_ACK_SLOTS )
+    return 0;
+  ns->fast_ack_sock[ns->fast_ack_n] = S_SP(ts);
+  ns->fast_ack_deadline[ns->fast_ack_n] = deadline;
+  ++ns->fast_ack_n;
+  ts->tcpflags |= CI_TCPT_FLAG_FAST_ACK_ARMED;
+  return 1;
+}
+
+ci_inline void ci_tcp_fast_ack_unarm(ci_netif* netif, ci_tcp_state* ts)
+{
+  ci_netif_state* ns = netif->state;
+  ci_uint32 i;
+  for( i = 0; i < ns->fast_ack_n; ++i )
+    if( OO_SP_EQ(ns->fast_ack_sock[i], S_SP(ts)) ) {
+      --ns->fast_ack_n;
+      ns->fast_ack_sock[i] = ns->fast_ack_sock[ns->fast_ack_n];
+      ns->fast_ack_deadline[i] = ns->fast_ack_deadline[ns->fast_ack_n];
+      break;
+    }
+  ts->tcpflags &=~ CI_TCPT_FLAG_FAST_ACK_ARMED;
+}
+
+/* Modify the deadline of a fast-ack armed socket. */
+ci_inline void ci_tcp_fast_ack_modify(ci_netif* netif, ci_tcp_state* ts,
+                                      ci_iptime_t deadline)
+{
+  ci_netif_state* ns = netif->state;
+  ci_uint32 i;
+  ci_assert(ts->tcpflags & CI_TCPT_FLAG_FAST_ACK_ARMED);
+  for( i = 0; i < ns->fast_ack_n; ++i )
+    if( OO_SP_EQ(ns->fast_ack_sock[i], S_SP(ts)) ) {
+      ns->fast_ack_deadline[i] = deadline;
+      break;
+    }
+}
+
+/* EF_TCP_CORK_NS auto-corking: record a flush deadline (in frc ticks) in
+ * the stack's cork array.  Returns 0 if the array is full, in which case
+ * the caller should fall back to the cork wheel timer.  An already-armed
+ * socket keeps its original deadline, so the bound is measured from the
+ * first held write. */
+ci_inline int ci_tcp_cork_deadline_arm(ci_netif* netif, ci_tcp_state* ts,
+                                       ci_uint64 deadline_frc)
+{
+  ci_netif_state* ns = netif->state;
+  if( ts->tcpflags & CI_TCPT_FLAG_CORK_DEADLINE )
+    return 1;
+  if( ns->cork_n >= CI_TCP_CORK_SLOTS )
+    return 0;
+  ns->cork_sock[ns->cork_n] = S_SP(ts);
+  ns->cork_deadline_frc[ns->cork_n] = deadline_frc;
+  ++ns->cork_n;
+  ts->tcpflags |= CI_TCPT_FLAG_CORK_DEADLINE;
+  return 1;
+}
+
+ci_inline void ci_tcp_cork_deadline_unarm(ci_netif* netif, ci_tcp_state* ts)
+{
+  ci_netif_state* ns = netif->state;
+  ci_uint32 i;
+  for( i = 0; i < ns->cork_n; ++i )
+    if( OO_SP_EQ(ns->cork_sock[i], S_SP(ts)) ) {
+      --ns->cork_n;
+      ns->cork_sock[i] = ns->cork_sock[ns->cork_n];
+      ns->cork_deadline_frc[i] = ns->cork_deadline_frc[ns->cork_n];
+      break;
+    }
+  ts->tcpflags &=~ CI_TCPT_FLAG_CORK_DEADLINE;
+}
+
+ci_inline void ci_tcp_delack_check_and_set(ci_netif* netif,
                                            ci_tcp_state* ts) {
   /* shouldn't set a timer in a state that doesn't allow them */
   ci_assert(!(ts->s.b.state & CI_TCP_STATE_NO_TIMERS));
+  if( NI_OPTS(netif).tcp_fast_ack &&
+      ! ci_ip_timer_pending(netif, &ts->delack_tid) &&
+      ci_tcp_fast_ack_arm(netif, ts, ci_tcp_time_now(netif) +
+                          NI_CONF(netif).tconst_delack) )
+    return;
   if( !ci_ip_timer_pending(netif, &ts->delack_tid) )
     ci_ip_timer_set(netif, &ts->delack_tid, ci_tcp_time_now(netif) +
                     NI_CONF(netif).tconst_delack);
 }
 
 ci_inline void ci_tcp_delack_clear(ci_netif* netif, ci_tcp_state* ts)
-{ ci_ip_timer_clear(netif, &ts->delack_tid); }
+{
+  if( ts->tcpflags & CI_TCPT_FLAG_FAST_ACK_ARMED )
+    ci_tcp_fast_ack_unarm(netif, ts);
+  ci_ip_timer_clear(netif, &ts->delack_tid);
+}
 
 #if CI_CFG_DYNAMIC_ACK_RATE
-ci_inline void ci_tcp_delack_soon(ci_netif* netif, ci_tcp_state* ts) 
+ci_inline void ci_tcp_delack_soon(ci_netif* netif, ci_tcp_state* ts)
 {
   /* shouldn't set a timer in a state that doesn't allow them */
   ci_assert(!(ts->s.b.state & CI_TCP_STATE_NO_TIMERS));
   ci_assert_gt(ts->acks_pending & CI_TCP_ACKS_PENDING_MASK,
                NI_OPTS(netif).delack_thresh);
   ts->acks_pending |= CI_TCP_DELACK_SOON_FLAG;
+  if( ts->tcpflags & CI_TCPT_FLAG_FAST_ACK_ARMED ) {
+    ci_tcp_fast_ack_modify(netif, ts, ci_tcp_time_now(netif)+1);
+    return;
+  }
   if( ci_ip_timer_pending(netif, &ts->delack_tid) )
     ci_ip_timer_modify(netif, &ts->delack_tid, ci_tcp_time_now(netif)+1);
   else
@@ -3962,6 +4530,20 @@ ci_inline unsigned ci_tcp_taildrop_timeout(const ci_netif* netif,
 
 #endif
 
+
+#if CI_CFG_TCP_RACK
+
+/* RACK needs SACK: deliveries of segments above a hole are what advance
+ * the RACK point ahead of the un-SACKed segments it declares lost. */
+ci_inline int ci_tcp_rack_enabled(const ci_netif* ni, const ci_tcp_state* ts)
+{
+  return NI_OPTS(ni).tcp_rack &&
+         (ts->tcpflags & CI_TCPT_FLAG_SACK) &&
+         (ts->s.b.state & CI_TCP_STATE_SYNCHRONISED);
+}
+
+#endif
+
 /* keep alive timers */
 
 /*
@@ -4345,7 +4927,42 @@ ci_inline ci_uint32 ci_tcp_base_dupack_thresh(ci_tcp_state *ts) {
 
 /* congestion control functions */
 
-/* set the initial congestion window as in rfc3390/rfc2581/rfc2001 */ 
+/* Pluggable congestion control (tcp_cong.c).  Sockets carry an algorithm
+ * index rather than a pointer, since socket state is shared memory; each
+ * address space indexes its own copy of the const ops table.
+ */
+struct ci_tcp_cc_ops {
+  /* Name exposed via setsockopt(TCP_CONGESTION). */
+  const char* name;
+  /* Reset algorithm state; may be NULL. */
+  void (*init)(ci_netif* ni, ci_tcp_state* ts);
+  /* New data acked in the non-congested states: grow (or re-size) the
+   * congestion window.  [ts->bytes_acked] has been updated already. */
+  void (*on_ack)(ci_netif* ni, ci_tcp_state* ts, unsigned acked);
+  /* A fresh RTT measurement, in ticks; may be NULL. */
+  void (*rtt_sample)(ci_netif* ni, ci_tcp_state* ts, ci_iptime_t rtt);
+  /* New value for [ssthresh] when loss is detected. */
+  unsigned (*losswnd)(ci_netif* ni, ci_tcp_state* ts);
+};
+
+#define CI_TCP_CC_NEWRENO  0
+#define CI_TCP_CC_BBR      1
+#define CI_TCP_CC_N        2
+
+/* Scaling of ci_tcp_state::cc_bw: bytes per tick << CI_TCP_CC_BW_SHIFT. */
+#define CI_TCP_CC_BW_SHIFT 4
+
+extern const struct ci_tcp_cc_ops ci_tcp_cc_tbl[CI_TCP_CC_N];
+
+ci_inline const struct ci_tcp_cc_ops* ci_tcp_cc(ci_tcp_state* ts)
+{
+  ci_assert_lt(ts->cc_algo, CI_TCP_CC_N);
+  return &ci_tcp_cc_tbl[ts->cc_algo];
+}
+
+extern void ci_tcp_cc_init(ci_netif* ni, ci_tcp_state* ts) CI_HF;
+
+/* set the initial congestion window as in rfc3390/rfc2581/rfc2001 */
 ci_inline void ci_tcp_set_initialcwnd(ci_netif* ni, ci_tcp_state* ts) {
   if( NI_OPTS(ni).initial_cwnd == 0 ) {
 #if CI_CFG_TCP_INITIAL_CWND_RFC == 3390
@@ -4671,6 +5288,38 @@ ci_inline citp_waitable* ci_tcp_acceptq_get(ci_netif* ni,
 }
 
 
+/* Dequeue up to [max] sockets from the accept queue in one pass, with a
+ * single [acceptq_n_out] update.  The gather walk touches each waitable's
+ * link word, so the batch is cache-warm for the caller's processing pass.
+ * Same locking rules as ci_tcp_acceptq_get(); only call this if
+ * ci_tcp_acceptq_not_empty() is true.  Returns the number dequeued
+ * (at least 1). */
+ci_inline int ci_tcp_acceptq_get_batch(ci_netif* ni,
+                                       ci_tcp_socket_listen* tls,
+                                       citp_waitable** w_out, int max)
+{
+  citp_waitable* w;
+  int n = 0;
+  ci_assert(ci_sock_is_locked(ni, &tls->s.b) ||
+            (tls->s.b.sb_aflags & CI_SB_AFLAG_ORPHAN));
+  ci_assert_gt(max, 0);
+  do {
+    if( OO_SP_IS_NULL(tls->acceptq_get) ) {
+      if( tls->acceptq_put < 0 )
+        break;
+      ci_tcp_acceptq_get_swizzle(ni, tls);
+    }
+    w = SP_TO_WAITABLE(ni, tls->acceptq_get);
+    tls->acceptq_get = w->wt_next;
+    CI_DEBUG(w->wt_next = OO_SP_NULL);
+    w_out[n++] = w;
+  } while( n < max );
+  ci_assert_gt(n, 0);
+  tls->acceptq_n_out += n;
+  return n;
+}
+
+
 #ifndef __ci_driver__
 /* Only call this if ci_tcp_acceptq_not_empty() is true. */
 ci_inline ci_tcp_state* ci_tcp_acceptq_peek(ci_netif* ni,
@@ -4704,6 +5353,7 @@ static inline const char* ci_tcp_aux_type2str(int type)
     case CI_TCP_AUX_TYPE_SYNRECV: return "syn-recv state";
     case CI_TCP_AUX_TYPE_BUCKET:  return "syn-recv bucket";
     case CI_TCP_AUX_TYPE_EPOLL: return "epoll3 state";
+    case CI_TCP_AUX_TYPE_PMTUS: return "pmtu state";
     default: return "unknown";
   }
 }
@@ -4764,9 +5414,13 @@ ci_inline void ci_ni_aux_free(ci_netif* ni, ci_ni_aux_mem* aux)
 {
   ci_assert( ci_netif_is_locked(ni) );
   ni->state->n_aux_bufs[aux->type]--;
-  oo_p_dllink_add(ni, oo_p_dllink_ptr(ni, &ni->state->free_aux_mem),
+  /* Return the buf to its type's free list, keeping the type tag.  The
+   * same cachelines are then reused for the next allocation of that
+   * type, so each type's working set stays packed together. */
+  oo_p_dllink_add(ni,
+                  oo_p_dllink_ptr(ni, &ni->state->free_aux_typed[aux->type]),
                   ci_ni_aux2link(ni, aux));
-  ni->state->n_free_aux_bufs++;
+  ni->state->n_free_aux_typed[aux->type]++;
 }
 ci_inline void ci_tcp_synrecv_free(ci_netif* ni, ci_tcp_state_synrecv* tsr) {
   ci_ni_aux_free(ni, CI_CONTAINER(ci_ni_aux_mem, u.synrecv, tsr));
@@ -4785,6 +5439,9 @@ ci_inline int/*bool*/ ci_ni_aux_can_alloc(ci_netif* ni, int type)
                            oo_p_dllink_ptr(ni, &ni->state->free_aux_mem);
   if( ni->state->n_aux_bufs[type] >= ni->state->max_aux_bufs[type] )
     return CI_FALSE;
+  if( ! oo_p_dllink_is_empty(ni,
+                oo_p_dllink_ptr(ni, &ni->state->free_aux_typed[type])) )
+    return CI_TRUE;
   if( !  oo_p_dllink_is_empty(ni, free_aux_mem) )
     return CI_TRUE;
   ci_ni_aux_more_bufs(ni);
@@ -4792,6 +5449,8 @@ ci_inline int/*bool*/ ci_ni_aux_can_alloc(ci_netif* ni, int type)
 }
 ci_inline oo_p ci_ni_aux_alloc(ci_netif* ni, int type)
 {
+  struct oo_p_dllink_state free_aux_typed =
+                   oo_p_dllink_ptr(ni, &ni->state->free_aux_typed[type]);
   struct oo_p_dllink_state free_aux_mem =
                            oo_p_dllink_ptr(ni, &ni->state->free_aux_mem);
   struct oo_p_dllink_state link;
@@ -4803,12 +5462,24 @@ ci_inline oo_p ci_ni_aux_alloc(ci_netif* ni, int type)
     return OO_P_NULL;
   }
 
-  link = oo_p_dllink_statep(ni, free_aux_mem.l->next);
-  oo_p_dllink_del(ni, link);
+  /* Prefer a buf previously used for this type: it is already warm and
+   * keeps same-type objects on the same cachelines.  Fall back to the
+   * untyped pool, which ci_ni_aux_can_alloc() refills in bulk. */
+  if( ! oo_p_dllink_is_empty(ni, free_aux_typed) ) {
+    link = oo_p_dllink_statep(ni, free_aux_typed.l->next);
+    oo_p_dllink_del(ni, link);
+    aux = ci_ni_aux_p2aux(ni, link.p);
+    ci_assert_equal(aux->type, type);
+    ni->state->n_free_aux_typed[type]--;
+  }
+  else {
+    link = oo_p_dllink_statep(ni, free_aux_mem.l->next);
+    oo_p_dllink_del(ni, link);
+    aux = ci_ni_aux_p2aux(ni, link.p);
+    ni->state->n_free_aux_bufs--;
+  }
 
-  aux = ci_ni_aux_p2aux(ni, link.p);
   aux->type = type;
-  ni->state->n_free_aux_bufs--;
   ni->state->n_aux_bufs[type]++;
   return link.p;
 }
@@ -4895,6 +5566,23 @@ ci_sb_epoll_ready_link(ci_netif* ni, ci_sb_epoll_state* epoll, int i)
   ci_assert_lt((bitmask), 1u << CI_CFG_N_READY_LISTS); \
   OO_FOR_EACH_BIT(bitmask, tmp, i)
 
+#if CI_CFG_EPOLL3
+/* Post a readiness edge to a ready list's ring.  Caller holds the stack
+ * lock.  Duplicate entries for a socket are allowed; the consumer
+ * tolerates them. */
+ci_inline void ci_netif_ready_ring_put(ci_netif* ni, int id, oo_sp bufid)
+{
+  struct oo_ready_ring* ring = &ni->state->ready_rings[id];
+  if( ring->wr - ring->rd >= CI_READY_RING_SIZE ) {
+    ring->overflow = 1;
+    return;
+  }
+  ring->sock_id[ring->wr % CI_READY_RING_SIZE] = OO_SP_TO_INT(bufid);
+  ci_wmb();
+  ring->wr = ring->wr + 1;
+}
+#endif
+
 ci_inline void
 ci_netif_put_on_post_poll_epoll(ci_netif* ni, citp_waitable* sb)
 {
@@ -4907,6 +5595,8 @@ ci_netif_put_on_post_poll_epoll(ci_netif* ni, citp_waitable* sb)
     oo_p_dllink_add_tail(ni,
                          oo_p_dllink_ptr(ni, &ni->state->ready_lists[i]),
                          link);
+    if( NI_OPTS(ni).epoll_ready_ring )
+      ci_netif_ready_ring_put(ni, i, sb->bufid);
   }
 #endif
 }
@@ -5286,10 +5976,26 @@ ci_inline ci_uint16 oo_tcpdump_queue_len(ci_netif* ni)
   return ni->state->dump_write_i - ni->state->dump_read_i;
 }
 
+/* Sampling: when [dump_sample] is N > 1, only one in every N matched
+ * packets is captured.  Sampled-out packets are deliberate and do not
+ * count as missed. */
+ci_inline int oo_tcpdump_check_sampling(ci_netif* ni)
+{
+  if(CI_LIKELY( ni->state->dump_sample <= 1 ))
+    return 1;
+  if( ++ni->state->dump_sample_n >= ni->state->dump_sample ) {
+    ni->state->dump_sample_n = 0;
+    return 1;
+  }
+  return 0;
+}
+
 /* Should we dump this packet? */
 ci_inline int oo_tcpdump_check(ci_netif *ni, ci_ip_pkt_fmt *pkt, int intf_i)
 {
   if( ni->state->dump_intf[intf_i] == OO_INTF_I_DUMP_ALL ) {
+    if( ! oo_tcpdump_check_sampling(ni) )
+      return 0;
     if( oo_tcpdump_queue_len(ni) < CI_CFG_DUMPQUEUE_LEN - 1 )
       return 1;
     else
@@ -5303,6 +6009,8 @@ ci_inline int oo_tcpdump_check_no_match(ci_netif *ni, ci_ip_pkt_fmt *pkt,
                                         int intf_i)
 {
   if( ni->state->dump_intf[intf_i] == OO_INTF_I_DUMP_NO_MATCH ) {
+    if( ! oo_tcpdump_check_sampling(ni) )
+      return 0;
     if( oo_tcpdump_queue_len(ni) < CI_CFG_DUMPQUEUE_LEN - 1 )
       return 1;
     else
@@ -5338,6 +6046,46 @@ ci_inline void oo_tcpdump_dump_pkt(ci_netif *ni, ci_ip_pkt_fmt *pkt)
 #endif
 
 
+/*********************************************************************
+************************ Wire-order RX tap ***************************
+*********************************************************************/
+#if CI_CFG_RX_ORDER_TAP
+/* Append a tap record for a payload delivery to [sock_id]'s receive
+ * queue.  Called under the stack lock from the RX delivery points, so
+ * records land in poll order, which is NIC arrival order.  When the
+ * ring is full the record is dropped and counted; the reader can see
+ * the gap via rx_order_drops. */
+ci_inline void oo_rx_order_record(ci_netif* ni, oo_sp sock_id,
+                                  unsigned bytes, const ci_ip_pkt_fmt* pkt)
+{
+  ci_netif_state* ns = ni->state;
+  struct oo_rx_order_ev* ev;
+
+  if(CI_LIKELY( ! NI_OPTS(ni).rx_order_tap ))
+    return;
+  ci_assert(ci_netif_is_locked(ni));
+  if( (ci_uint16) (ns->rx_order_write_i - ns->rx_order_read_i) >=
+      CI_CFG_RX_ORDER_TAP_LEN - 1 ) {
+    ++ns->rx_order_drops;
+    return;
+  }
+  ev = &ns->rx_order_q[ns->rx_order_write_i % CI_CFG_RX_ORDER_TAP_LEN];
+  ev->sock_id = OO_SP_TO_INT(sock_id);
+  ev->bytes = bytes;
+#if CI_CFG_TIMESTAMPING
+  ev->hw_stamp = pkt->hw_stamp;
+#else
+  ev->hw_stamp.tv_sec = 0;
+  ev->hw_stamp.tv_nsec = 0;
+#endif
+  ci_wmb();
+  ns->rx_order_write_i = ns->rx_order_write_i + 1;
+}
+#else
+#define oo_rx_order_record(ni, sock_id, bytes, pkt)
+#endif
+
+
 #ifdef __KERNEL__
 /*********************************************************************
 **************************** OS socket status ************************
@@ -5452,11 +6200,28 @@ typedef struct oo_zc_buf* onload_zc_handle;
 #define CI_ZC_HANDLE_MAGIC         ((uintptr_t)0)
 #endif
 
+/* Chunk granularity for ONLOAD_ZC_REGISTER_ON_DEMAND regions.  2MB keeps
+ * the number of memregs manageable for large arenas and matches the huge
+ * page size, so a hugepage-backed arena registers whole pages. */
+#define CI_ZC_USERMEM_CHUNK_BYTES  (2u << 20)
+/* Value in chunk_kernel_ids[] for a chunk not yet registered. */
+#define CI_ZC_USERMEM_CHUNK_UNREG  ((uint64_t)-1)
+
 struct ci_zc_usermem {
   ef_addrspace addr_space;
   uint64_t base;
   uint64_t size;
   uint64_t kernel_id;
+  /* On-demand (ONLOAD_ZC_REGISTER_ON_DEMAND) registration state.  When
+   * lazy_chunk_pages is non-zero only the chunks of the region that have
+   * been referenced by a send are registered with the NIC.  Each chunk's
+   * kernel handle lives in chunk_kernel_ids[], CI_ZC_USERMEM_CHUNK_UNREG
+   * until the chunk is registered.  All access to this state (and to the
+   * hw_addrs slices it guards) is protected by the stack lock. */
+  uint32_t lazy_chunk_pages;
+  uint32_t lazy_n_chunks;
+  uint32_t lazy_reg_flags;
+  uint64_t* chunk_kernel_ids;
   /* HW addresses are structured as
    * hw_addr[page_n + intf_i * size << PAGE_SHIFT] */
   uint64_t hw_addrs[0];
@@ -180,6 +180,7 @@
                                  (s) == retrrc_noroute ? "NoRoute" :    \
                                  (s) == retrrc_alienroute ? "ViaOs" :   \
                                  (s) == retrrc_localroute ? "Local" :   \
+                                 (s) == retrrc_pending ? "Resolving" :  \
                                  "MacFail")
 
 #define OOF_IPCACHE_VALID            "%s"
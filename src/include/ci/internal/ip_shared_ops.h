@@ -461,6 +461,7 @@ ci_inline oo_pkt_p __TRUSTED_PKT_ID(ci_netif* ni, oo_pkt_p pp,
 # define PKT_BUFSET_U_MMAPPED(ni, setid)  ((ni)->pkt_bufs[setid] != NULL)
 
 extern ci_ip_pkt_fmt* __ci_netif_pkt(ci_netif* ni, unsigned id) CI_HF;
+extern int ci_netif_pkt_premap(ci_netif* ni) CI_HF;
 
 ci_inline ci_ip_pkt_fmt* __PKT(ci_netif* ni, unsigned id) {
   if(CI_LIKELY( PKT_BUFSET_U_MMAPPED((ni), (id) >> CI_CFG_PKTS_PER_SET_S) ))
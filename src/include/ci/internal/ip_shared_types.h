@@ -152,6 +152,16 @@ struct oo_timespec {
 };
 
 
+#if CI_CFG_RX_ORDER_TAP
+/* One wire-order RX tap record; see ci_netif_state_s::rx_order_q. */
+struct oo_rx_order_ev {
+  ci_int32           sock_id;   /* endpoint id of the receiving socket */
+  ci_uint32          bytes;     /* payload bytes delivered */
+  struct oo_timespec hw_stamp;  /* NIC arrival time; zero if unstamped */
+};
+#endif
+
+
 typedef struct {
   /* We cache EPs between close and accept to speed up passive opens.  See
    * comment in defintion of ci_netif_state_s::epcache_free for details.
@@ -230,6 +240,9 @@ typedef union {
     oo_pkt_p          block_end;     /* end of the current (un)sacked block */
     oo_sp             sock_id;       /* The socket this pkt is tx'd on:
                                       * used in oo_deferred_arp_failed() */
+#if CI_CFG_TCP_RACK
+    ci_iptime_t       tx_time;       /* time of most recent (re)transmit */
+#endif
 #if CI_CFG_TIMESTAMPING
     struct oo_timespec first_tx_hw_stamp; /* Timestamp of the first transmit */
 #endif
@@ -238,8 +251,18 @@ typedef union {
   struct {
     ci_uint32         pay_len;              /*!< length of UDP payload */
     ci_int32          tx_length;
-    oo_sp             tx_sock_id; /* The socket this pkt is tx'd on:  
+    oo_sp             tx_sock_id; /* The socket this pkt is tx'd on:
                                    * used in oo_deferred_arp_failed() */
+    /* Compact-arena cursors (EF_UDP_RX_COMPACT); see udp_internal.h.
+     * [compact_wr], [compact_n_recs] and [compact_closed] are owned by the
+     * producer (stack lock); [compact_rd] and [compact_rd_idx] by the
+     * consumer (socket lock).  Only valid on packets with
+     * CI_PKT_RX_FLAG_COMPACT set. */
+    ci_uint16         compact_wr;      /* offset of next record to write   */
+    ci_uint16         compact_rd;      /* offset of current record to read */
+    ci_uint16         compact_n_recs;  /* records written, release order   */
+    ci_uint16         compact_rd_idx;  /* records consumed                 */
+    ci_uint8          compact_closed;  /* producer will append no more     */
   } udp;
   struct {
     ci_uint32         base;       /* Offset of start of data from dma_start. */
@@ -334,22 +357,47 @@ struct ci_ip_pkt_fmt_s {
   /*! Length of data from base_addr used in this buffer. */
   ci_int16              buf_len;
 
-#if CI_CFG_TIMESTAMPING
-  /*! UTC time we were sent or received according to hw */
-  struct oo_timespec    hw_stamp;
+  /* The fields from here to [n_buffers] are, together with the links and
+   * [buf] above, the ones the RX demux path reads for every packet; they
+   * are kept adjacent so that demux touches a single metadata cache line.
+   * Rarely-touched metadata (timestamps, TX-only state) follows below. */
 
-  /*! Key for SOF_TIMESTAMPING_OPT_ID */
-  ci_uint32             ts_key;
-#endif
+  /* VLAN tag from packet header (RX). */
+  ci_int16              vlan;
 
-  union {
-    struct {
-      oo_pkt_p          dmaq_next; /**< Next packet in the overflow queue. */
-#if CI_CFG_PORT_STRIPING
-      ci_int32          intf_swap;
-#endif
-    } tx;
-  } netif;
+#define PKT_START_OFF_BAD ((ci_int16)0xffff)
+  /*! Offset of the start of data from [dma_start].  This is usually the
+   * Ethernet header, but points to the start of payload for fragments in a
+   * chain.
+   */
+  ci_int16              pkt_start_off;
+
+  /*! Offset from [dma_start] of the layer-3 header (usually the IPv4/IPv6
+   * header).  If the frame is encapsulated this is the inner header.  It
+   * should not be assumed that there is an Ethernet header immediately in
+   * front of this header.
+   */
+  ci_int16              pkt_eth_payload_off;
+
+  /*! Offset from [dma_start] of the outer layer-3 header.  Used only on
+   * the transmit path.  If the frame is not encapsulated then this is the
+   * same as [pkt_eth_payload_off].  This always corresponds to the end of
+   * the outer Ethernet header (including VLANs if any).
+   */
+  ci_int16              pkt_outer_l3_off;
+
+#define CI_Q_ID_NORMAL        0
+#define CI_Q_ID_TCP_RECYCLER  1
+#define CI_Q_ID_TCP_APP       2
+/* ...and potentially more q_ids beyond TCP_APP, all of which are also owned
+ * by the TCP_APP */
+  /*! For rx packets, the VI/rxq on which this packet was enqueued/received.
+   * For tx packets, the VI/txq on which to send this packet.
+   * If !CI_CFG_TCP_OFFLOAD_RECYCLER then there is only one queue and this
+   * field is irrelevant. Otherwise, plugins tend to use multiple VIs to
+   * distinguish different classes of packet and/or content targetting at
+   * different levels of the stack. */
+  ci_uint8              q_id;
 
   /*! These flags can only be used by (i) netif lock holder, or (ii)
    *  in app context if they know the packet can't be touched by the
@@ -405,6 +453,9 @@ struct ci_ip_pkt_fmt_s {
                                    * processing (EF100 feature). The user_mark
                                    * is put in pf.tcp_rx.lo.rx_sock */
 #define CI_PKT_RX_FLAG_RX_SHARED       0x08 /* Packet comes from shared RXQ */
+#define CI_PKT_RX_FLAG_COMPACT         0x10 /* recv_q: small-datagram arena
+                                   * holding several packed datagrams; see
+                                   * EF_UDP_RX_COMPACT */
   ci_uint8              rx_flags;
 
   /*! Number of these buffers that are chained together using
@@ -412,49 +463,35 @@ struct ci_ip_pkt_fmt_s {
    */
   ci_int8               n_buffers;
 
-  /*! Time packet was sent or received.  Used for software timestamps
-   * (SO_TIMESTAMP, SIOCGSTAMP etc.) and onload_tcpdump.
+  /*! Isolation domain this packet buffer is charged to, or 0 if unconfined.
+   *  Set by the TCP TX allocator when EF_ISO_DOMAIN_PKTS is enabled and
+   *  credited back to ni->state->iso_dom_n_pkts by ci_netif_pkt_free().
    */
-  ci_uint64             tstamp_frc CI_ALIGN(8);
-
-  ci_ip_pkt_fmt_prefix  pf CI_ALIGN(8);
+  ci_uint8              iso_domain;
 
-  /* VLAN tag from packet header (RX). */
-  ci_int16              vlan;
+#if CI_CFG_TIMESTAMPING
+  /*! UTC time we were sent or received according to hw */
+  struct oo_timespec    hw_stamp;
 
-#define PKT_START_OFF_BAD ((ci_int16)0xffff)
-  /*! Offset of the start of data from [dma_start].  This is usually the
-   * Ethernet header, but points to the start of payload for fragments in a
-   * chain.
-   */
-  ci_int16              pkt_start_off;
+  /*! Key for SOF_TIMESTAMPING_OPT_ID */
+  ci_uint32             ts_key;
+#endif
 
-  /*! Offset from [dma_start] of the layer-3 header (usually the IPv4/IPv6
-   * header).  If the frame is encapsulated this is the inner header.  It
-   * should not be assumed that there is an Ethernet header immediately in
-   * front of this header.
-   */
-  ci_int16              pkt_eth_payload_off;
+  union {
+    struct {
+      oo_pkt_p          dmaq_next; /**< Next packet in the overflow queue. */
+#if CI_CFG_PORT_STRIPING
+      ci_int32          intf_swap;
+#endif
+    } tx;
+  } netif;
 
-  /*! Offset from [dma_start] of the outer layer-3 header.  Used only on
-   * the transmit path.  If the frame is not encapsulated then this is the
-   * same as [pkt_eth_payload_off].  This always corresponds to the end of
-   * the outer Ethernet header (including VLANs if any).
+  /*! Time packet was sent or received.  Used for software timestamps
+   * (SO_TIMESTAMP, SIOCGSTAMP etc.) and onload_tcpdump.
    */
-  ci_int16              pkt_outer_l3_off;
+  ci_uint64             tstamp_frc CI_ALIGN(8);
 
-#define CI_Q_ID_NORMAL        0
-#define CI_Q_ID_TCP_RECYCLER  1
-#define CI_Q_ID_TCP_APP       2
-/* ...and potentially more q_ids beyond TCP_APP, all of which are also owned
- * by the TCP_APP */
-  /*! For rx packets, the VI/rxq on which this packet was enqueued/received.
-   * For tx packets, the VI/txq on which to send this packet.
-   * If !CI_CFG_TCP_OFFLOAD_RECYCLER then there is only one queue and this
-   * field is irrelevant. Otherwise, plugins tend to use multiple VIs to
-   * distinguish different classes of packet and/or content targetting at
-   * different levels of the stack. */
-  ci_uint8              q_id;
+  ci_ip_pkt_fmt_prefix  pf CI_ALIGN(8);
 
   /*! Ensure we have space before [dma_start] so we can expand the Ethernet
    * header to add a VLAN tag.  This member should never be referenced
@@ -596,6 +633,31 @@ typedef struct {
 } ci_netif_ipid_cb_t;
 
 
+/*!
+** oo_udp_reasm_t
+**
+** Reassembly context for one fragmented IPv4 UDP datagram
+** (EF_UDP_RX_REASSEMBLY).  [frags] is a list of fragment packets linked
+** by [frag_next] and sorted by fragment offset; OO_PP_NULL means the
+** context is free.  Each pending fragment remains a self-contained frame
+** until the datagram completes, so an abandoned context can be flushed
+** to the kernel fragment by fragment.
+*/
+#define OO_UDP_REASM_CTXTS      8
+#define OO_UDP_REASM_MAX_FRAGS  45
+typedef struct {
+  ci_uint64             start_frc CI_ALIGN(8); /* first fragment arrival */
+  oo_pkt_p              frags;
+  ci_int32              got_bytes;   /* IP payload bytes accumulated */
+  ci_int32              total_bytes; /* IP payload length; -1 until the
+                                        last fragment has been seen */
+  ci_uint32             saddr_be32;
+  ci_uint32             daddr_be32;
+  ci_uint16             ip_id_be16;
+  ci_uint16             n_frags;
+} oo_udp_reasm_t;
+
+
 /*!
 ** ci_netif_stats
 **
@@ -640,6 +702,25 @@ typedef struct {
 } ci_netif_filter_table;
 
 
+/* Per-(group, port) entry in the multicast demux table (see EF_MCAST_DEMUX).
+ * Each entry records the sockets subscribed to one multicast group and local
+ * port, so RX demux can consider just those sockets instead of probing the
+ * main software filter table.  The table uses linear probing; an entry with
+ * [group] zero has never been used, and one with [n_socks] zero is a
+ * tombstone.  If more sockets subscribe than fit in [socks] the entry is
+ * marked overflowed and demux for that group falls back to the filter table
+ * until the last subscriber leaves. */
+#define CI_MCAST_TBL_ENTRY_SOCKS  8
+#define CI_MCAST_TBL_ENTRY_OVERFLOW  0x1
+typedef struct {
+  ci_uint32 group;    /* multicast group address (network order); 0 => free */
+  ci_uint16 lport;    /* local port (network order) */
+  ci_uint8  n_socks;  /* live subscriptions, including any not in [socks] */
+  ci_uint8  flags;
+  ci_int32  socks[CI_MCAST_TBL_ENTRY_SOCKS];
+} ci_netif_mcast_tbl_entry;
+
+
 typedef struct {
   ci_addr_t laddr;
   ci_addr_t raddr;
@@ -841,6 +922,8 @@ typedef struct {
 # define CI_IP_TIMER_NETIF_STATS        0xa  /* netif statistics timer   */
 # define CI_IP_TIMER_TCP_CORK           0xb  /* TCP_CORK timer           */
 # define CI_IP_TIMER_NETIF_TCP_RECYCLE  0xc  /* EF100 plugin recycling   */
+# define CI_IP_TIMER_NETIF_TX_PACE      0xd  /* TX pacing release timer  */
+# define CI_IP_TIMER_TCP_RACK           0xe  /* TCP RACK reorder timer   */
 } ci_ip_timer;
 
 
@@ -915,6 +998,10 @@ struct oo_deferred_pkt {
 /* This flag is used when the packet have just been deferred, and
  * oo_deferred_send_one() is called for the first time with it. */
 #define OO_DEFERRED_FLAG_FIRST        2
+/* Route resolution is still in progress for this packet: the fwd info
+ * above is not yet valid and must be filled in once the control plane
+ * publishes the fwd row.  See EF_CPLANE_NONBLOCK_RESOLVE. */
+#define OO_DEFERRED_FLAG_RESOLVE      4
 
   ci_iptime_t ts;    /* Timestamp when added to the queue */
   struct oo_p_dllink link; /* Link */
@@ -931,6 +1018,11 @@ typedef struct {
   volatile ci_uint64  lock;
 # define CI_EPLOCK_LOCKED	           0x20000000ULL
 # define CI_EPLOCK_FL_NEED_WAKE	           0x40000000ULL
+  /* A poll-priority thread is spinning for the lock, and should win the
+   * next handoff (see onload_thread_set_poll_priority()).  Best-effort:
+   * only user-level trylock paths yield to it; blocking acquisition via
+   * the driver ignores it, so a stale bit cannot prevent progress. */
+# define CI_EPLOCK_FL_POLL_PRIO            0x10000000ULL
 
  /* Flags used by eplock code itself */
 # define CI_EPLOCK_LOCK_FLAGS              0x70000000ULL
@@ -980,14 +1072,17 @@ typedef struct {
 #define CI_EPLOCK_NETIF_NEED_SOCK_BUFS     0x0002000000000000ULL
   /* if CI_EPLOCK_NETIF_NEED_POLL did nothing then prime */
 #define CI_EPLOCK_NETIF_PRIME_IF_IDLE      0x0000800000000000ULL
+  /* have packets on the per-stack TX staging queue (EF_UDP_TX_STAGING) */
+#define CI_EPLOCK_NETIF_STAGED_TX          0x0000400000000000ULL
 
   /* mask for the above flags that must be handled before dropping lock */
-# define CI_EPLOCK_NETIF_UNLOCK_FLAGS      0xff3b800000000000ULL
+# define CI_EPLOCK_NETIF_UNLOCK_FLAGS      0xff3bc00000000000ULL
 
   /* these flags can be handled in UL */
 #define CI_EPLOCK_NETIF_UL_COMMON_MASK \
     (CI_EPLOCK_NETIF_IS_PKT_WAITER | CI_EPLOCK_NETIF_NEED_POLL | \
      CI_EPLOCK_NETIF_HAS_DEFERRED_PKTS | \
+     CI_EPLOCK_NETIF_STAGED_TX | \
      CI_EPLOCK_NETIF_MERGE_ATOMIC_COUNTERS | \
      CI_EPLOCK_NETIF_PRIME_IF_IDLE)
 #if ! CI_CFG_UL_INTERRUPT_HELPER
@@ -1028,6 +1123,23 @@ struct oo_ringbuffer_state {
 };
 
 
+#if CI_CFG_EPOLL3
+/* Ring of readiness edges for one epoll ready list, used when
+ * EF_EPOLL_READY_RING is set.  Producers push socket ids under the stack
+ * lock; the single consumer is the epoll object that owns the list, and
+ * it reads without taking the stack lock.  When the ring fills, overflow
+ * is set and the consumer falls back to harvesting the ready list under
+ * the lock, which also resets the ring. */
+#define CI_READY_RING_SIZE 256
+struct oo_ready_ring {
+  ci_uint32 volatile   wr;
+  ci_uint32 volatile   rd;
+  ci_uint32 volatile   overflow;
+  ci_int32             sock_id[CI_READY_RING_SIZE];
+};
+#endif
+
+
 /*********************************************************************
 ************************* Global netif state *************************
 *********************************************************************/
@@ -1069,6 +1181,9 @@ typedef struct {
   CI_ULCONST char       dev_name[20];
   /* Transmit overflow queue.  Packets here are ready to send. */
   oo_pktq               dmaq[CI_MAX_VIS_PER_INTF];
+  /* Urgent transmit overflow queue, drained ahead of [dmaq].  Packets from
+   * latency-class sockets are queued here; see EF_TX_LATENCY_PRIO. */
+  oo_pktq               dmaq_urgent;
   /* Counts bytes of packet payload into and out of the TX descriptor ring. */
   ci_uint32             tx_bytes_added;
   ci_uint32             tx_bytes_removed;
@@ -1087,10 +1202,21 @@ typedef struct {
   struct oo_timespec    last_rx_timestamp;
   /* Sync flags of the last packet received */
   ci_uint32             last_sync_flags;
+  /* Snapshot of the VI clock-sync state, captured once per batch of
+   * events so that per-packet timestamp conversion does not re-read and
+   * re-validate the sync state.  rx_tsync_valid is zero when the VI was
+   * unsynchronised at capture. */
+  ci_uint32             rx_tsync_minor;
+  ci_uint32             rx_tsync_major;
+  ci_uint32             rx_tsync_valid;
 #endif
 
 # define CI_NETIF_NIC_ERROR_REMAP               0x00000001u
   ci_uint32             nic_error_flags;
+  /* Exponential moving average of the RXQ deficit seen when refilling,
+   * used by EF_RX_REFILL_ADAPTIVE to size the refill quantum.  See
+   * ci_netif_rx_refill_epilogue(). */
+  ci_uint32             rx_refill_ema;
 #if CI_CFG_CTPIO
   ci_uint32             ctpio_ct_threshold;
   /* This enforces EF_CTPIO_MAX_FRAME_LEN, and also is set to zero disable
@@ -1106,6 +1232,66 @@ typedef struct {
 } ci_netif_state_nic_t;
 
 
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+/* One flight-recorder trace record.  Records are written lock-free from
+ * hot-path sites (see ci_netif_fr_log()); readers must tolerate records
+ * that are in the middle of being overwritten. */
+typedef struct {
+  ci_uint64             frc CI_ALIGN(8); /* ci_frc64() at the event site */
+  ci_uint16             event;           /* CI_FR_EV_* */
+  ci_uint16             arg16;           /* event-specific */
+  ci_uint32             arg32;           /* event-specific */
+} ci_fr_record;
+#endif
+
+
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+/* Drop diagnostics: the RX drop sites copy the first bytes of each
+ * dropped frame into a small per-reason ring (see ci_netif_drop_sample())
+ * so that "onload_stackdump drops" can show which flows are being hit and
+ * why, without disturbing the stack. */
+#define CI_DROP_SAMPLE_BYTES  64
+
+enum {
+  CI_DROP_REASON_CSUM_BAD,        /* L3/L4 or inner checksum error */
+  CI_DROP_REASON_CRC_BAD,         /* ethernet FCS error */
+  CI_DROP_REASON_TRUNC,           /* truncated or bad-length frame */
+  CI_DROP_REASON_MCAST_MISMATCH,  /* multicast filter mismatch */
+  CI_DROP_REASON_HW_OTHER,        /* other hardware discard classes */
+  CI_DROP_REASON_NO_MATCH,        /* no matching socket for the packet */
+  CI_DROP_REASON_TCP,             /* TCP validation or resource failure */
+  CI_DROP_REASON_UDP,             /* UDP validation failure */
+  CI_DROP_REASON_MAX
+};
+
+typedef struct {
+  ci_uint64             frc CI_ALIGN(8); /* ci_frc64() at the drop site */
+  ci_uint32             frame_len;
+  ci_int32              intf_i;
+  ci_uint8              data[CI_DROP_SAMPLE_BYTES];
+} ci_drop_sample;
+
+typedef struct {
+  ci_uint32             n;     /* total drops recorded for this reason */
+  ci_uint32             wr;    /* next sample slot to overwrite */
+  ci_drop_sample        sample[CI_CFG_DROP_SAMPLES_PER_REASON];
+} ci_drop_ring;
+#endif
+
+
+/* One request in the per-stack slow-path command ring (see
+** ci_netif_slowpath_req()).  The [op] word doubles as the completion
+** flag: a producer publishes it last, and the driver resets it to
+** OO_SLOWPATH_FREE once the request has been carried out. */
+#define OO_SLOWPATH_RING_SIZE      128   /* must be a power of two */
+#define OO_SLOWPATH_FREE           0     /* slot empty or completed */
+#define OO_SLOWPATH_WAITABLE_WAKE  1     /* arg = endpoint id */
+struct oo_slowpath_req {
+  volatile ci_uint32    op;
+  ci_uint32             arg;
+};
+
+
 struct ci_netif_state_s {
 
   ci_netif_state_nic_t  nic[CI_CFG_MAX_INTERFACES];
@@ -1180,6 +1366,11 @@ struct ci_netif_state_s {
    */
   ci_uint32             evq_prime_deferred;
 
+  /* Count of consecutive polls that found no events, used by
+   * EF_INT_ADAPTIVE_EMPTY_POLLS to decide when to arm interrupts.
+   */
+  ci_uint32             poll_empty_polls;
+
   cicp_hwport_mask_t    hwport_mask; /* hwports accelearted by the stack */
   ci_int8               hwport_to_intf_i[CI_CFG_MAX_HWPORTS];
   ci_int8               intf_i_to_hwport[CI_CFG_MAX_INTERFACES];
@@ -1187,6 +1378,11 @@ struct ci_netif_state_s {
   /* Count of threads spinning.  Manipulated using atomics. */
   ci_uint32             n_spinners;
 
+  /* Incremented by every ci_netif_poll_n() under the stack lock.  Read
+   * without the lock by spinning threads to tell that another thread's
+   * poll has completed since they last looked. */
+  ci_uint32             poll_gen;
+
   /* Set to true by a thread that is "spinning" waiting for network events
    * and leared when no longer spinning.  May be set/cleared by multiple
    * threads without synchronisation.
@@ -1198,6 +1394,10 @@ struct ci_netif_state_s {
    */
   ci_int8               poll_work_outstanding;
 
+  /* Round-robin rotation of the interface polled first by ci_netif_poll_n();
+   * only advanced on stacks with more than one interface. */
+  ci_uint32             poll_intf_rr;
+
   /* Set by thread that is spinning just after it polls for network events. */
   ci_uint64             last_spin_poll_frc CI_ALIGN(8);
 
@@ -1216,6 +1416,27 @@ struct ci_netif_state_s {
   oo_pkt_p              looppkts CI_ALIGN(CI_CACHE_LINE_SIZE);
   ci_int32              n_looppkts;
 
+  /** Incoming SYNs deferred for processing after the rest of the event
+   * batch (EF_TCP_SYN_DEFER).  Packets are chained via pkt->next with the
+   * target listening socket stashed in pf.tcp_rx.lo.rx_sock. */
+  oo_pkt_p              syn_defer_head;
+  oo_pkt_p              syn_defer_tail;
+  ci_uint32             syn_defer_n;
+
+  /** Demux hint cache (EF_RX_FLOW_HINT): the socket each RX flow fold
+   * last delivered to.  A hint is revalidated against the packet's full
+   * 4-tuple before use, so stale entries are harmless. */
+#define CI_NI_RX_FLOW_HINT_SIZE 64
+  oo_sp                 rx_flow_hint[CI_NI_RX_FLOW_HINT_SIZE];
+
+  /** NIC flow-hash hint table: the socket each adapter RSS hash value
+   * last delivered to.  Unlike rx_flow_hint this is keyed by the hash
+   * from the RX prefix, which is available at event-decode time before
+   * any packet header has been read, so the poll loop can prefetch the
+   * probable socket state one event ahead of demux.  It is only ever
+   * used for prefetching, never for demux itself. */
+  oo_sp                 rx_nic_flow_hint[CI_NI_RX_FLOW_HINT_SIZE];
+
   /* Number of packets that are in use by the RX path.  This includes
   ** packets posted as RX descriptors, and those queued in socket
   ** buffers 
@@ -1270,6 +1491,10 @@ struct ci_netif_state_s {
 #endif
   CI_ULCONST ci_uint32  table_ofs;       /**< offset of s/w filter table */
   CI_ULCONST ci_uint32  table_ext_ofs;   /**< offset of slow s/w filter state */
+  CI_ULCONST ci_uint32  mcast_tbl_ofs;   /**< offset of multicast demux table */
+  CI_ULCONST ci_uint32  mcast_tbl_entries_n; /**< size of above (power of 2) */
+  ci_uint32             mcast_tbl_overflowed; /**< insert found no free slot;
+                                                   demux via table disabled */
 #if CI_CFG_IPV6
   CI_ULCONST ci_uint32  ip6_table_ofs;   /**< offset of IPv6 s/w filter table */
 #endif
@@ -1289,6 +1514,48 @@ struct ci_netif_state_s {
 #define OO_TIMEOUT_Q_FINWAIT  1
 #define OO_TIMEOUT_Q_MAX      2
   struct oo_p_dllink    timeout_q[OO_TIMEOUT_Q_MAX]; /**< time-out queues */
+  ci_uint32             n_timewait;     /**< sockets on the timewait queue */
+
+  /* Per-phase cycle attribution for ci_netif_poll(), collected when
+   * EF_POLL_PROFILE is set.  RX demux and TX completion are handled
+   * per-event and so are accounted to the event queue phase. */
+#define CI_POLL_PROFILE_EVQ        0  /* event processing */
+#define CI_POLL_PROFILE_POST_POLL  1  /* deferred per-socket work */
+#define CI_POLL_PROFILE_POST       2  /* RX ring refill + dmaq shove */
+#define CI_POLL_PROFILE_LOOPBACK   3  /* loopback delivery */
+#define CI_POLL_PROFILE_TIMERS     4  /* timer wheel */
+#define CI_POLL_PROFILE_PHASES     5
+  struct {
+    ci_uint64           cycles;      /* total cycles spent in this phase */
+    ci_uint64           max_cycles;  /* longest single visit */
+    ci_uint64           n;           /* number of visits */
+  }                     poll_profile[CI_POLL_PROFILE_PHASES] CI_ALIGN(8);
+
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+  /* Always-on flight recorder (see ci_netif_fr_log()).  [fr_wr] is a
+   * free-running cursor claimed with an atomic add; the ring index is the
+   * cursor modulo the ring size, so the oldest records are overwritten
+   * once the ring wraps. */
+  ci_atomic_t           fr_wr;
+  ci_fr_record          fr_ring[CI_CFG_FLIGHT_RECORDER_ENTRIES] CI_ALIGN(8);
+#endif
+
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+  /* Per-reason sampled drop rings (see ci_netif_drop_sample()). */
+  ci_drop_ring          drop_rings[CI_DROP_REASON_MAX] CI_ALIGN(8);
+#endif
+
+  /* TX pacing (EF_TX_PACING_RATE).  Packets that would exceed the stack's
+   * transmit rate wait on [pacing_q] and are released from the timer wheel
+   * once [pacing_next_frc] has passed. */
+  oo_pktq               pacing_q;
+  ci_uint64             pacing_next_frc CI_ALIGN(8);
+  ci_ip_timer           pacing_tid;
+
+  /* Pool of pre-initialised TCP state objects (EF_TCP_STATE_POOL), linked
+   * through [s.b.wt_next].  Protected by the stack lock. */
+  oo_sp                 warm_state_pool;
+  ci_uint32             warm_state_pool_n;
 
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
   ci_ip_timer           recycle_tid;
@@ -1299,6 +1566,30 @@ struct ci_netif_state_s {
   /* List of sockets that may have reapable buffers. */
   struct oo_p_dllink        reap_list;
 
+  /* Sockets with memory watermarks registered
+   * (onload_socket_watermarks_set()), plus a count for cheap poll
+   * gating. */
+  struct oo_p_dllink        mem_watermark_socks;
+  ci_uint32                 mem_watermark_n;
+
+  /* Deadline array for EF_TCP_FAST_ACK: sockets with a delayed ACK due,
+   * checked inline on every poll instead of arming a wheel timer.  When
+   * the array is full further sockets fall back to the delack wheel
+   * timer. */
+#define CI_TCP_FAST_ACK_SLOTS 16
+  oo_sp                 fast_ack_sock[CI_TCP_FAST_ACK_SLOTS];
+  ci_iptime_t           fast_ack_deadline[CI_TCP_FAST_ACK_SLOTS];
+  ci_uint32             fast_ack_n;
+
+  /* Deadline array for EF_TCP_CORK_NS: sockets holding auto-corked data
+   * in the send queue, with flush deadlines in frc ticks checked inline
+   * on every poll.  When the array is full further sockets fall back to
+   * the cork wheel timer. */
+#define CI_TCP_CORK_SLOTS 16
+  ci_uint64             cork_deadline_frc[CI_TCP_CORK_SLOTS] CI_ALIGN(8);
+  oo_sp                 cork_sock[CI_TCP_CORK_SLOTS];
+  ci_uint32             cork_n;
+
 #if CI_CFG_SUPPORT_STATS_COLLECTION
   ci_int32              stats_fmt; /**< Output format */
   ci_ip_timer           stats_tid CI_ALIGN(8); /**< NETIF statistics timer id */
@@ -1335,6 +1626,7 @@ struct ci_netif_state_s {
 #define CI_NI_READY_LIST_FLAG_PENDING_FREE   2 /* Pending free at netif unlock */
   ci_uint32             ready_list_flags[CI_CFG_N_READY_LISTS];
   ci_uint32             ready_lists_in_use;
+  struct oo_ready_ring  ready_rings[CI_CFG_N_READY_LISTS];
 #endif
 
 #if CI_CFG_PIO
@@ -1347,8 +1639,17 @@ struct ci_netif_state_s {
 #define CI_TCP_AUX_TYPE_EPOLL   2
 #define CI_TCP_AUX_TYPE_PMTUS   3
 #define CI_TCP_AUX_TYPE_NUM     4
-  struct oo_p_dllink    free_aux_mem;    /**< Free list of synrecv bufs. */
-  ci_uint32             n_free_aux_bufs; /**< Number of free aux bufs */
+  struct oo_p_dllink    free_aux_mem;    /**< Free list of untyped aux bufs,
+                                          * refilled in bulk from socket
+                                          * buffers by ci_ni_aux_more_bufs. */
+  ci_uint32             n_free_aux_bufs; /**< Number of free untyped bufs */
+  struct oo_p_dllink    free_aux_typed[CI_TCP_AUX_TYPE_NUM];
+                        /**< Per-type free lists.  Freed aux bufs keep their
+                         * type tag and are reused for the same type first,
+                         * so each type's working set stays packed into the
+                         * same cachelines. */
+  ci_uint32             n_free_aux_typed[CI_TCP_AUX_TYPE_NUM];
+                        /**< Number of free bufs cached per type */
   ci_uint32             n_aux_bufs[CI_TCP_AUX_TYPE_NUM];
                         /**< Number of aux bufs allocated */
   CI_ULCONST ci_uint32  max_aux_bufs[CI_TCP_AUX_TYPE_NUM];
@@ -1369,6 +1670,9 @@ struct ci_netif_state_s {
   ci_uint64             sock_spin_cycles    CI_ALIGN(8);
   ci_uint64             buzz_cycles         CI_ALIGN(8);
   ci_uint64             timer_prime_cycles  CI_ALIGN(8);
+  ci_uint64             tcp_cork_cycles     CI_ALIGN(8);
+  /* EF_VXLAN_PORT in network byte order, 0 when disabled. */
+  ci_uint16             vxlan_port_be16;
 
   CI_ULCONST ci_uint32  timesync_bytes;
   CI_ULCONST ci_uint32  io_mmap_bytes;
@@ -1431,16 +1735,59 @@ struct ci_netif_state_s {
   ci_uint8              dump_intf[OO_INTF_I_NUM];
   volatile ci_uint16    dump_read_i;
   volatile ci_uint16    dump_write_i;
+  /* Capture one in this many matched packets; 0 or 1 captures every
+  ** packet.  Written by the attached onload_tcpdump process. */
+  ci_uint16             dump_sample;
+  /* Matched packets seen since the last one captured. */
+  ci_uint16             dump_sample_n;
+#endif
+
+#if CI_CFG_RX_ORDER_TAP
+  /* Wire-order RX delivery tap (EF_RX_ORDER_TAP): one record per payload
+  ** delivery to a socket receive queue, produced under the stack lock in
+  ** poll order, which is NIC arrival order.  Single reader via
+  ** onload_rx_order_read(). */
+  struct oo_rx_order_ev rx_order_q[CI_CFG_RX_ORDER_TAP_LEN];
+  volatile ci_uint16    rx_order_read_i;
+  volatile ci_uint16    rx_order_write_i;
+  /* Records lost because the ring was full. */
+  ci_uint32             rx_order_drops;
 #endif
 
+  /* In-stack reassembly of fragmented IPv4 UDP datagrams
+  ** (EF_UDP_RX_REASSEMBLY). */
+  oo_udp_reasm_t        udp_reasm[OO_UDP_REASM_CTXTS] CI_ALIGN(8);
+
   ef_vi_stats           vi_stats CI_ALIGN(8);
 
   CI_ULCONST ci_int32   creation_numa_node;
   CI_ULCONST ci_int32   load_numa_node;
+  /* Node the shared state was actually allocated on; see
+   * EF_STACK_NUMA_NODE. */
+  CI_ULCONST ci_int32   stack_alloc_numa_node;
   CI_ULCONST ci_uint32  packet_alloc_numa_nodes;
   CI_ULCONST ci_uint32  sock_alloc_numa_nodes;
   CI_ULCONST ci_uint32  interrupt_numa_nodes;
 
+  /* Worst-case memory footprint computed at stack creation and debited
+   * from the host-wide admission ledger (the pinned_mem_max_mb module
+   * option): the shared-state/socket-buffer shmbuf and a fully populated
+   * packet buffer pool respectively. */
+  CI_ULCONST ci_uint64  preflight_shm_bytes CI_ALIGN(8);
+  CI_ULCONST ci_uint64  preflight_pktbuf_bytes;
+
+/* Number of isolation domains that sockets sharing a stack can be grouped
+ * into for packet-buffer accounting.  Domain 0 is the default and is never
+ * limited; domains 1..OO_ISO_DOMAIN_MAX-1 are each capped at
+ * EF_ISO_DOMAIN_PKTS TX packet buffers. */
+#define OO_ISO_DOMAIN_MAX 8
+
+  /* Per-isolation-domain count of TX packet buffers currently charged to
+   * each domain.  Entry 0 is unused (domain 0 is unconfined).  Updated
+   * with atomic ops: allocation charges under the stack lock, but the
+   * central free path can credit from contexts that do not hold it. */
+  ci_uint32             iso_dom_n_pkts[OO_ISO_DOMAIN_MAX];
+
 #if CI_CFG_FD_CACHING
   ci_socket_cache_t     active_cache;
   ci_uint32             active_cache_avail_stack;
@@ -1491,6 +1838,12 @@ struct ci_netif_state_s {
    */
   ci_int32              reserved_pktbufs;
 
+  /* Lock-free MPSC queue of fully-formed UDP packets staged for transmit
+   * by threads that found the stack lock contended (EF_UDP_TX_STAGING).
+   * Pushed with a CAS; drained by the lock holder.
+   */
+  ci_int32           tx_staging_q;
+
   /* Deferred packets, because of nomac. */
   struct oo_p_dllink deferred_list;
   struct oo_p_dllink deferred_list_free;
@@ -1515,6 +1868,26 @@ struct ci_netif_state_s {
 #endif
   } nvme_crc_plugin_idp[CI_CFG_MAX_INTERFACES];
 
+  /* Slow-path command ring: user level enqueues requests here instead of
+  ** issuing an ioctl per operation.  The driver drains the ring on every
+  ** ioctl entry, so a doorbell (OO_IOC_SLOWPATH_KICK) is only needed when
+  ** the ring goes from empty to non-empty.  [slowpath_added] and
+  ** [slowpath_drained] are free-running cursors. */
+  struct oo_slowpath_req  slowpath_ring[OO_SLOWPATH_RING_SIZE];
+  volatile ci_uint32      slowpath_added;
+  volatile ci_uint32      slowpath_drained;
+
+  /* Accept-queue publication batch.  Sockets promoted from a listener's
+  ** syn-recv queue during the current poll are chained here via wt_next
+  ** and spliced onto the listener's acceptq in a single shared-state
+  ** update when post-poll processing runs (ci_tcp_acceptq_flush_batch()).
+  ** Only valid while in_poll, and only ever holds sockets for one
+  ** listener at a time. */
+  oo_sp                   promote_batch_listener;
+  oo_sp                   promote_batch_head;
+  oo_sp                   promote_batch_tail;
+  ci_uint32               promote_batch_n;
+
   /* Followed by:
   **
   **   vi_state  (for each nic)
@@ -1529,6 +1902,7 @@ struct oo_timesync {
   ci_uint64 smoothed_ticks;         /* frc ticks during smoothed_ns time */
   ci_uint64 smoothed_ns;            /* ns to count smoothed_ticks */
   ci_uint64 update_jiffies;         /* time in jiffies of next update */
+  ci_uint64 max_error_ns;           /* bound on frc->wall conversion error */
   ci_uint32 generation_count;       /* to synchronise with local copy */
 };
 
@@ -1594,6 +1968,11 @@ typedef struct {
   /* Per-socket SO_BUSY_POLL settings */
   ci_uint64             spin_cycles CI_ALIGN(8);
 
+  /* Consecutive spins that timed out without the condition being met.
+  ** Drives the spin-budget back-off when EF_TCP_RECV_SPIN_ADAPTIVE is
+  ** set; reset by any spin that succeeds. */
+  ci_uint32             spin_misses;
+
   /* These bits are set when someone wants to be woken (or other action
   ** associated with things happening). */
   ci_uint32             wake_request;
@@ -1611,6 +1990,18 @@ typedef struct {
 # define CI_SB_FLAG_RX_DELIVERED  0x8
 # define CI_SB_FLAG_MOVED         0x10
 
+  /* Shared-memory futex doorbell (EF_PIPE_FUTEX), one word per wake
+  ** direction (indexed by CI_SB_FLAG_WAKE_*_B).  [futex_waiters] counts
+  ** threads blocked (or committing to block) in futex-wait on the
+  ** corresponding [futex_word]; wakers bump the word and futex-wake it,
+  ** avoiding an ioctl into the driver.  Keeping the directions separate
+  ** means waking one end of a pipe does not spuriously rouse a thread
+  ** blocked on the other end.  Manipulate [futex_waiters] only with
+  ** atomic ops.
+  */
+  ci_uint32             futex_word[2];
+  ci_uint32             futex_waiters[2];
+
   /* Atomic flags.  Manipulate only with atomic ops. */
   ci_uint32             sb_aflags;
   /* Set when not connected to a file descriptor. */
@@ -1749,7 +2140,9 @@ typedef enum
    retrrc_nomac   = 1,/* no mac found, deferred retrieval of MAC info needed */
    retrrc_noroute = 2,/* route not found */
    retrrc_alienroute = 3, /* route found but is not via our interfaces */
-   retrrc_localroute = 4, /* destination is local address of the host */ 
+   retrrc_localroute = 4, /* destination is local address of the host */
+   retrrc_pending = 5, /* route resolution requested but not yet published;
+                          see EF_CPLANE_NONBLOCK_RESOLVE */
 } cicpos_retrieve_rc_t;
 
 
@@ -1763,6 +2156,7 @@ typedef enum
          (rc) == retrrc_noroute? "no route known to IP address":           \
          (rc) == retrrc_alienroute? "non-EtherFabric route":               \
          (rc) == retrrc_localroute? "loopback route":                      \
+         (rc) == retrrc_pending? "route resolution pending":               \
          "<unknown forwarding return code>")
 
 
@@ -1884,6 +2278,54 @@ struct oo_sock_cplane {
 struct ci_sock_cmn_s {
   citp_waitable         b;
 
+  /* Mutable hot fields are grouped here with the waitable, which is
+   * already dirtied for wakeups: stores arriving from other contexts
+   * (atomic flag updates, OS socket status, asynchronous errors) then
+   * stay off the read-mostly option lines below. */
+  ci_uint32             s_aflags;
+#define CI_SOCK_AFLAG_CORK              0x01          /* TCP_CORK     */
+#define CI_SOCK_AFLAG_CORK_BIT          0u
+#define CI_SOCK_AFLAG_NEED_SHUT_RD      0x2
+#define CI_SOCK_AFLAG_NEED_SHUT_RD_BIT  1u
+#define CI_SOCK_AFLAG_NEED_SHUT_WR      0x4
+#define CI_SOCK_AFLAG_NEED_SHUT_WR_BIT  2u
+/* Prefer an exact-match hw filter over the stack's scalable filter for
+ * this connection.  See ONLOAD_TCP_RX_STEER. */
+#define CI_SOCK_AFLAG_RX_STEER          0x8
+#define CI_SOCK_AFLAG_RX_STEER_BIT      3u
+#define CI_SOCK_AFLAG_NODELAY           0x200        /* TCP_NODELAY  */
+#define CI_SOCK_AFLAG_NODELAY_BIT       9u
+#define CI_SOCK_AFLAG_NEED_ACK          0x400
+#define CI_SOCK_AFLAG_NEED_ACK_BIT      10u
+#define CI_SOCK_AFLAG_SELECT_ERR_QUEUE  0x800
+#define CI_SOCK_AFLAG_SELECT_ERR_QUEUE_BIT 11u
+
+  ci_uint16            tx_errno;
+  /* Zero if transmits permitted by user, else error code to return to 'em. */
+
+  ci_uint16            rx_errno;
+  /* Zero if data can still arrive.  Otherwise low-order bits give error
+  ** code to return to user (which may be zero).
+  */
+
+  ci_uint32 os_sock_status; /*!< seq<<3 + (RX | TX | ERR) */
+#define OO_OS_STATUS_RX 1
+#define OO_OS_STATUS_TX 2
+#define OO_OS_STATUS_ERR 4
+#define OO_OS_STATUS_SEQ_SHIFT 3
+
+  ci_int32              so_error;
+
+  /* Pad the mutable group out to a cache-line boundary (endpoint buffers
+   * are EP_BUF_SIZE-aligned), so that everything below - socket options,
+   * bound addresses and header templates, all read-mostly - starts on a
+   * fresh line and hot-path option loads never share a line with remote
+   * stores.  Explicit padding rather than CI_ALIGN so that struct sizes
+   * are not rounded up to a multiple of the line size: ci_tcp_state has
+   * little headroom within CI_CFG_EP_BUF_SIZE.  The split is asserted in
+   * ci_netif_sanity_checks(). */
+  ci_uint8              mutable_pad[16];
+
   ci_uint32             s_flags CI_ALIGN(8);
 #define CI_SOCK_FLAG_REUSEADDR    0x00000001   /* socket SO_REUSEADDR option */
 #define CI_SOCK_FLAG_KALIVE       0x00000002   /* socket SO_KEEPALIVE option */
@@ -1953,21 +2395,6 @@ struct ci_sock_cmn_s {
 #define CI_SOCK_FLAG_IP6_PMTU_DO       0x40000000
 #define CI_SOCK_FLAG_IP6_ALWAYS_DF     0x80000000
 
-  ci_uint32             s_aflags;
-#define CI_SOCK_AFLAG_CORK              0x01          /* TCP_CORK     */
-#define CI_SOCK_AFLAG_CORK_BIT          0u
-#define CI_SOCK_AFLAG_NEED_SHUT_RD      0x2
-#define CI_SOCK_AFLAG_NEED_SHUT_RD_BIT  1u
-#define CI_SOCK_AFLAG_NEED_SHUT_WR      0x4
-#define CI_SOCK_AFLAG_NEED_SHUT_WR_BIT  2u
-#define CI_SOCK_AFLAG_NODELAY           0x200        /* TCP_NODELAY  */
-#define CI_SOCK_AFLAG_NODELAY_BIT       9u
-#define CI_SOCK_AFLAG_NEED_ACK          0x400
-#define CI_SOCK_AFLAG_NEED_ACK_BIT      10u
-#define CI_SOCK_AFLAG_SELECT_ERR_QUEUE  0x800
-#define CI_SOCK_AFLAG_SELECT_ERR_QUEUE_BIT 11u
-
-
   /*! Which socket flags should be inherited by accepted connections? */
 #define CI_SOCK_FLAG_TCP_INHERITED                                          \
   (CI_SOCK_FLAG_KALIVE | CI_SOCK_FLAG_OOBINLINE | CI_SOCK_FLAG_LINGER |     \
@@ -2002,20 +2429,6 @@ struct ci_sock_cmn_s {
   ** network byte-order.
   */
 
-  ci_uint16            tx_errno;
-  /* Zero if transmits permitted by user, else error code to return to 'em. */
-
-  ci_uint16            rx_errno;
-  /* Zero if data can still arrive.  Otherwise low-order bits give error
-  ** code to return to user (which may be zero).
-  */
-
-  ci_uint32 os_sock_status; /*!< seq<<3 + (RX | TX | ERR) */
-#define OO_OS_STATUS_RX 1
-#define OO_OS_STATUS_TX 2
-#define OO_OS_STATUS_ERR 4
-#define OO_OS_STATUS_SEQ_SHIFT 3
-
   struct {
     /* This contains only sockopts that are inherited from the listening
     ** socket by newly accepted TCP sockets.
@@ -2036,6 +2449,7 @@ struct ci_sock_cmn_s {
 # define CI_SOCKOPT_FLAG_SO_DEBUG    0x1
 # define CI_SOCKOPT_FLAG_IP_RECVERR  0x2
 # define CI_SOCKOPT_FLAG_IPV6_RECVERR 0x4
+# define CI_SOCKOPT_FLAG_SO_ZEROCOPY 0x8
   } so;
 
   /* Socket options that are not inherited on accept from listening socket.
@@ -2043,7 +2457,6 @@ struct ci_sock_cmn_s {
   ** [so] above.
   */
   ci_pkt_priority_t     so_priority;
-  ci_int32              so_error;
 
   /* When set, these limit the RX path to only accept packets from the
    * given interface.  Used by SO_BINDTODEVICE and also the
@@ -2093,11 +2506,34 @@ struct ci_sock_cmn_s {
 
   struct oo_p_dllink    reap_link;
 
+  /* onload_socket_watermarks_set(): notification thresholds (0 = off,
+   * saturated at 65535 packet buffers) and fired bitmask, cleared by
+   * the query call.  Registered sockets are linked on
+   * ci_netif_state::mem_watermark_socks via [wm_link] and their queue
+   * depths checked once per poll.  NB endpoint buffers have no spare
+   * room, hence the 16-bit thresholds. */
+#define CI_SOCK_WM_SENDQ  0x1
+#define CI_SOCK_WM_RCVQ   0x2
+#define CI_SOCK_WM_POOL   0x4
+  struct oo_p_dllink    wm_link;
+  ci_uint16             wm_sendq_pkts;
+  ci_uint16             wm_rcvq_pkts;
+  ci_uint16             wm_pool_free_pkts;
+  ci_uint8              wm_fired;
+
   /* Size of 'ci_sock_cmn_s' structure may be improved by making 'domain'
    * as a flag. Also 'so_debug' field of 'so' structure has 2 flags and size
    * of 4 bytes.
    */
   ci_uint8              domain;           /*!<  PF_INET or PF_INET6 */
+
+  /* Isolation domain for packet-buffer accounting; 0 (the default) is
+   * unconfined.  Set via onload_socket_isolation_domain() and enforced by
+   * the TCP TX allocator when EF_ISO_DOMAIN_PKTS is non-zero, so that one
+   * group of sockets sharing a stack cannot starve the others of packet
+   * buffers.
+   */
+  ci_uint8              iso_domain;
 };
 
 ci_inline bool is_sock_flag_pmtu_do_set(const ci_sock_cmn* s, int af)
@@ -2193,6 +2629,11 @@ typedef struct {
    */
   oo_pkt_p      extract;
   ci_uint32     pkts_delivered;
+
+  /* Protected by the netif lock.  The open compact arena that small
+   * datagrams are currently being appended to, or OO_PP_NULL.  Closed
+   * (and forgotten) whenever an ordinary packet is queued behind it. */
+  oo_pkt_p      compact_arena;
 } ci_udp_recv_q;
 
 
@@ -2203,7 +2644,9 @@ typedef struct {
   ci_uint32 n_rx_eagain;      /* recv returned EAGAIN                  */
   ci_uint32 n_rx_overflow;    /* datagrams dropped due to overflow     */
   ci_uint32 n_rx_mem_drop;    /* datagrams dropped due to out-of-mem   */
+  ci_uint32 n_rx_filter_drop; /* datagrams dropped by filter chain     */
   ci_uint32 n_rx_pktinfo;     /* n times IP/IPV6_PKTINFO retrieved     */
+  ci_uint32 n_rx_compact;     /* datagrams packed into compact arenas  */
   ci_uint32 max_recvq_pkts;   /* maximum packets queued for recv       */
 
   ci_uint32 n_tx_os;          /* datagrams send via OS socket          */
@@ -2228,6 +2671,8 @@ typedef struct {
   ci_uint32 n_tx_msg_confirm; /* onload send with MSG_CONFIRM          */
   ci_uint32 n_tx_os_late;     /* sent via OS, after copying            */
   ci_uint32 n_tx_unconnect_late; /* concurrent send and unconnect      */
+  ci_uint32 n_tx_fanout;      /* datagrams sent by fanout clone        */
+  ci_uint32 n_tx_fanout_drop; /* fanout destinations dropped (no pkt)  */
 } ci_udp_socket_stats;
 
 struct  ci_udp_state_s {
@@ -2260,13 +2705,55 @@ struct  ci_udp_state_s {
   /* Only safe to use these at user-level in context of caller who set them */
   ci_uint64     recv_q_filter CI_ALIGN(8);
   ci_uint64     recv_q_filter_arg CI_ALIGN(8);
+
+  /* Match-predicate chain evaluated on the poll path before a datagram is
+   * queued; see onload_set_recv_filter_chain().  Unlike recv_q_filter this
+   * is plain data, so it is also evaluated when the stack is polled from
+   * the kernel. */
+#define CI_UDP_RECV_FILTER_RULES_MAX  8  /* = ONLOAD_ZC_RECV_FILTER_RULES_MAX
+                                          * in onload/extensions_zc.h */
+  struct {
+    ci_uint64   mask CI_ALIGN(8);
+    ci_uint64   value;
+    ci_uint16   offset;
+    ci_uint16   len;
+  }             recv_q_filter_rules[CI_UDP_RECV_FILTER_RULES_MAX];
+  ci_uint8      recv_q_filter_n_rules;
+  /* Drop datagrams that match the chain rather than those that do not. */
+#define CI_UDP_RECV_FILTER_F_DROP_MATCH  0x1
+  ci_uint8      recv_q_filter_flags;
 #endif
   ci_udp_recv_q recv_q;
 
+  /* Extra receive queues used when RX mailbox demux is enabled; recv_q
+   * acts as mailbox 0.  The poll loop distributes datagrams round-robin
+   * across the mailboxes and each reader consumes from a mailbox it has
+   * claimed, so concurrent readers do not contend on a single queue.
+   * See ONLOAD_UDP_RX_MAILBOXES. */
+#define CI_UDP_RX_MAILBOXES_MAX 4
+  ci_udp_recv_q mailbox_q[CI_UDP_RX_MAILBOXES_MAX - 1];
+  /* Bitmap of mailboxes currently claimed by a reader; manipulated
+   * atomically. */
+  ci_uint32     mailbox_busy;
+  /* Number of mailboxes; 0 when demux is disabled. */
+  ci_uint8      n_mailboxes;
+  /* Producer round-robin cursor; protected by the netif lock. */
+  ci_uint8      mailbox_rr;
+
 #if CI_CFG_TIMESTAMPING
   ci_udp_recv_q timestamp_q;
 #endif
 
+  /* MSG_ZEROCOPY completion state (SO_ZEROCOPY).  Sends are numbered from
+   * [zc_key] and completed notifications are coalesced into the inclusive
+   * range [zc_comp_lo, zc_comp_hi], reported via recvmsg(MSG_ERRQUEUE).
+   * Like the send-path stats these are maintained without atomics, so
+   * concurrent senders on one socket get best-effort notification ids. */
+  ci_uint32 zc_key;
+  ci_uint32 zc_comp_lo;
+  ci_uint32 zc_comp_hi;
+  ci_uint32 zc_comp_pending;
+
   /*! A list of buffers to support receiving datagrams via kernel in zc API */ 
   oo_pkt_p zc_kernel_datagram;
   /*! Number of buffers present in zc_kernel_datagram list */
@@ -2400,6 +2887,11 @@ struct ci_active_wild_s {
   struct oo_p_dllink    pool_link;
   ci_iptime_t           expiry;
   ci_uint32             last_rport;
+  /* Final sequence number (including the ISN offset) of the last
+   * connection closed on this port that left the peer in TIME-WAIT.
+   * Allows the port to be reused for the same remote inside the peer's
+   * TIME-WAIT window by choosing an ISN above it. */
+  ci_uint32             last_seq;
 };
 
 
@@ -2515,6 +3007,9 @@ typedef struct {
   ci_uint8             tcp_defer_accept;    /* TCP_DEFER_ACCEPT sockopt  */
 #define OO_TCP_DEFER_ACCEPT_OFF 0xff
 
+  ci_uint8             tcp_cc;              /* TCP_CONGESTION sockopt:
+                                               index into ci_tcp_cc_tbl */
+
 } ci_tcp_socket_cmn;
 
 
@@ -2546,6 +3041,31 @@ struct oo_tcp_socket_stats {
 };
 
 
+#if CI_CFG_TCP_SOCK_TELEMETRY
+/* Event types recorded in the per-socket telemetry ring. */
+#define OO_TCP_TELEM_RETRANS  1  /* retransmission started; value is SND.UNA */
+#define OO_TCP_TELEM_RTO      2  /* RTO fired; value is the backed-off RTO */
+#define OO_TCP_TELEM_CWND     3  /* cwnd changed on loss; value is new cwnd */
+#define OO_TCP_TELEM_ZWIN     4  /* zero-window probe sent; value is probes */
+
+typedef struct {
+  ci_uint64   frc CI_ALIGN(8);
+  ci_uint32   ev;
+  ci_uint32   val;
+} oo_tcp_telem_entry;
+
+typedef struct {
+  /* Single writer under the stack lock; lock-free readers.  [wr] counts
+  ** entries ever written; entry i lives in ring[i % ring length].  A reader
+  ** snapshots [wr], copies the ring, then re-reads [wr] to detect a torn
+  ** copy.
+  */
+  volatile ci_uint32  wr;
+  oo_tcp_telem_entry  ring[CI_CFG_TCP_TELEM_RING_LEN];
+} oo_tcp_telem_ring;
+#endif
+
+
 struct ci_tcp_state_s {
   ci_sock_cmn         s;
   ci_tcp_socket_cmn   c;
@@ -2591,6 +3111,9 @@ struct ci_tcp_state_s {
    * EF_TCP_SERVER_LOOPBACK=2 mode */
 #define CI_TCPT_FLAG_LOOP_FAKE          0x20000
 
+  /* delayed ACK deadline held in the stack's fast-ack array, so the
+   * delack wheel timer is not armed */
+#define CI_TCPT_FLAG_FAST_ACK_ARMED     0x40000
   /* Timer is running (rto timer is used) */
 #define CI_TCPT_FLAG_TAIL_DROP_TIMING   0x80000
   /* Probe sent */
@@ -2608,6 +3131,10 @@ struct ci_tcp_state_s {
    * because packet allocation failed.  Must send FIN, really. */
 #define CI_TCPT_FLAG_FIN_PENDING        0x800000
 
+  /* auto-cork flush deadline held in the stack's cork array
+   * (EF_TCP_CORK_NS) */
+#define CI_TCPT_FLAG_CORK_DEADLINE      0x1000000
+
   /* flags advertised on SYN */
 # define CI_TCPT_SYN_FLAGS \
         (CI_TCPT_FLAG_WSCL | CI_TCPT_FLAG_TSO | CI_TCPT_FLAG_SACK)
@@ -2765,6 +3292,33 @@ struct ci_tcp_state_s {
   ci_uint32            taildrop_mark;
 #endif
 
+#if CI_CFG_TCP_RACK
+  /* RACK (RFC 8985) state: transmit time and end sequence number of the
+   * most recently (re)transmitted segment known to have been delivered,
+   * and the RTT it measured.  [rack_rtt] == 0 means no delivery has been
+   * recorded yet. */
+  ci_iptime_t          rack_xmit_time;
+  ci_uint32            rack_end_seq;
+  ci_iptime_t          rack_rtt;
+#endif
+
+  /* Congestion-control algorithm for this socket (CI_TCP_CC_*), from
+   * EF_TCP_CC or setsockopt(TCP_CONGESTION).  The fields below are only
+   * used by the BBR-style algorithm; see tcp_cong.c. */
+  ci_uint8             cc_algo;
+  ci_uint8             cc_cycle;       /* position in the probe cycle */
+  /* Lowest RTT seen recently (ticks) and when it was recorded; 0 means no
+   * measurement yet. */
+  ci_iptime_t          cc_min_rtt;
+  ci_iptime_t          cc_min_rtt_time;
+  /* Start of the current bandwidth-sampling epoch and bytes newly acked
+   * within it. */
+  ci_iptime_t          cc_epoch_start;
+  ci_uint32            cc_epoch_delivered;
+  /* Decaying-maximum estimate of the bottleneck bandwidth, in bytes per
+   * tick scaled by 2^CI_TCP_CC_BW_SHIFT; 0 means no estimate yet. */
+  ci_uint32            cc_bw;
+
   /* Keep alive probes, and sending ACKs after gaps that may cause
    * other end to validated its congetion window 
    */
@@ -2831,6 +3385,12 @@ struct ci_tcp_state_s {
  */
 #define CI_TCP_ACKS_PENDING_MASK 0x7fff
 
+#if CI_CFG_DYNAMIC_ACK_RATE
+  ci_uint16            dynack_adapt;/* adaptive immediate-ACK threshold;
+                                       tracks recent per-poll RX batch size
+                                       (EF_DYNAMIC_ACK_MAX)               */
+#endif
+
   ci_uint16 urg_data; /** out-of-band byte store & relevant flags */
 #define CI_TCP_URG_DATA_MASK    0x00ff
 #define CI_TCP_URG_COMING       0x0100  /* oob byte here or coming */
@@ -2852,6 +3412,9 @@ struct ci_tcp_state_s {
   ci_ip_timer          stats_tid;   /* Statistics report timer            */
 #endif
   ci_ip_timer          cork_tid;    /* TCP timer for TCP_CORK/MSG_MORE   */
+#if CI_CFG_TCP_RACK
+  ci_ip_timer          rack_tid;    /* RACK reordering window timer      */
+#endif
 
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
   /* Technically a timer, but it always has a single-tick expiry so we save
@@ -2893,6 +3456,9 @@ struct ci_tcp_state_s {
     ci_uint32          bytes;
     ci_uint32          seq;
     ci_iptime_t        time;
+    /* Consecutive RTT periods with drain rate well below rcvbuf; used by
+     * EF_TCP_RCVBUF_MODE=2 to decide when to shrink. */
+    ci_uint32          quiet;
   } rcvbuf_drs;
 
   /* Destination address before NAT.  Required for getpeername(). */
@@ -2903,6 +3469,10 @@ struct ci_tcp_state_s {
 
   struct oo_tcp_socket_stats    stats;
 
+#if CI_CFG_TCP_SOCK_TELEMETRY
+  oo_tcp_telem_ring     telem;
+#endif
+
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
   ci_uint64             plugin_ddr_base;
   ci_uint64             plugin_ddr_size;
@@ -102,6 +102,62 @@ struct oo_ringbuffer {
 };
 
 
+#ifndef __KERNEL__
+/* One entry of the per-stack L1 route cache: the fwd request key together
+** with the fwd-table row which answered it last time.  The row version in
+** [verinfo] is re-checked on every use, so entries may go stale without
+** harm. */
+struct ci_ni_fwd_cache_entry {
+  struct cp_fwd_key  key;      /* request key, as built for resolution */
+  ci_addr_sh_t       src;      /* source address the resolution chose */
+  cicp_verinfo_t     verinfo;  /* fwd row which answered the request */
+};
+
+/* Per-socket receive framing descriptor, set via
+** onload_socket_recv_framing().  Describes a length-prefixed message
+** format so that onload_zc_recv() delivers whole frames only; see
+** ci_tcp_recv_framing_limit() in tcp_recv.c. */
+struct ci_tcp_recv_framing {
+  ci_uint8           active;      /* descriptor in use */
+  ci_uint8           len_offset;  /* offset of length field in header */
+  ci_uint8           len_width;   /* width of length field: 1, 2, 4 or 8 */
+  ci_uint8           len_nbo;     /* length field is big-endian */
+  ci_uint16          hdr_len;     /* fixed header length */
+  ci_int32           len_adjust;  /* field value + this = frame length */
+};
+#endif
+
+
+/* Hot-path stack options, frozen at stack creation.  This is a compact
+** read-only image of the ci_netif_config_opts fields that the poll loop
+** consults per poll or per packet.  The full options structure is several
+** KB, so reading these through NI_OPTS() scatters loads over many cache
+** lines; the image packs them into one.  Built from NI_OPTS() by
+** ci_netif_hot_opts_init(); changing the underlying options at runtime
+** does not take effect here until the stack is recreated.
+*/
+struct ci_netif_hot_opts {
+  ci_uint32 evs_per_poll;
+  ci_uint32 evq_high_watermark;
+  ci_uint32 timer_usec;
+  ci_uint32 int_adaptive_empty_polls;
+  ci_uint32 kernel_packets_batch_size;
+  ci_uint32 timestamping_reporting;
+#if CI_CFG_RANDOM_DROP
+  ci_uint32 rx_drop_rate;
+#endif
+  /* Boolean options are folded into a single flags word so that testing
+  ** several of them costs one load. */
+  ci_uint32 flags;
+#define CI_NETIF_HOT_POLL_PROFILE          0x1u
+#define CI_NETIF_HOT_RX_LATENCY_HISTOGRAM  0x2u
+#define CI_NETIF_HOT_TCP_FAST_ACK          0x4u
+#define CI_NETIF_HOT_XDP                   0x8u
+#define CI_NETIF_HOT_POLL_TX_BATCH         0x10u
+#define CI_NETIF_HOT_TCP_CORK_NS           0x20u
+};
+
+
 /*!
 ** ci_netif
 **
@@ -122,6 +178,9 @@ struct ci_netif_s {
 
   ci_netif_state*      state;
 
+  /* Read-only image of the hot-path options; see struct ci_netif_hot_opts. */
+  struct ci_netif_hot_opts hot_opts CI_ALIGN(CI_CACHE_LINE_SIZE);
+
 #ifndef __KERNEL__
   unsigned             future_intf_mask;
   /* Use ci_netif_get_driver_handle() rather than this directly. */
@@ -169,6 +228,33 @@ struct ci_netif_s {
    * So, kernel code uses efab_tcp_driver.timesync,
    * and UL code uses ni->timesync. */
   struct oo_timesync   *timesync;
+
+  /* Per-stack L1 route cache: a small direct-mapped map from fwd request
+   * key to the row which resolved it last time.  Avoids a full fwd-table
+   * walk when unconnected sends alternate between destinations; sized by
+   * EF_FWD_CACHE_SIZE to cover multi-homed fan-out to thousands of peers.
+   * [fwd_cache_mask] is entries minus one; [fwd_cache] is NULL when the
+   * cache is disabled or could not be allocated.  Accessed from the
+   * stack-locked send path only. */
+  struct ci_ni_fwd_cache_entry* fwd_cache;
+  ci_uint32            fwd_cache_mask;
+
+  /* Per-socket receive framing descriptors, indexed by endpoint id;
+   * allocated on the first onload_socket_recv_framing() call.  Process
+   * local, so framed delivery only applies to receives performed by the
+   * process which set the descriptor. */
+  struct ci_tcp_recv_framing* recv_framing;
+
+  /* eventfd signalled once per poll batch that generates readiness edges;
+   * -1 when no bridge is attached.  Process-local, so only stack polls
+   * performed by this process signal it.  See onload_stack_eventfd(). */
+  int                  eventfd_bridge;
+
+  /* Shared-memory mirror of ni->state->stats, refreshed from the polling
+   * paths; NULL unless this process created the stack with
+   * EF_STATS_EXPORT_MS set.  See <onload/netif_stats_export.h>. */
+  struct oo_stats_export_hdr* stats_export;
+  ci_uint64            stats_export_last_frc;
 #endif
     
 #ifdef __KERNEL__
@@ -180,6 +266,7 @@ struct ci_netif_s {
 
   ci_netif_filter_table* filter_table;
   ci_netif_filter_table_entry_ext* filter_table_ext;
+  ci_netif_mcast_tbl_entry* mcast_tbl;
 #if CI_CFG_IPV6
   ci_ip6_netif_filter_table* ip6_filter_table;
 #endif
@@ -290,6 +377,9 @@ struct ci_netif_s {
 #define CI_NETIF_FLAG_AF_XDP               0x10000
 /* one of the NICs is EFCT */
 #define CI_NETIF_FLAG_EFCT                 0x20000
+/* Mass socket teardown in progress: hardware filter removal is deferred
+ * to non-atomic work rather than done per-socket under the stack lock */
+#define CI_NETIF_FLAG_BULK_CLOSE           0x40000
 /* these architecture cannot handle polling in atomic */
 #define CI_NETIF_FLAGS_AVOID_ATOMIC \
         (CI_NETIF_FLAG_AF_XDP|\
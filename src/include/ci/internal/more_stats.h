@@ -69,9 +69,11 @@ static inline void get_more_stats(ci_netif* ni, more_stats_t* s)
     }
     else if( state == CI_TCP_STATE_UDP ) {
       ci_udp_state* us = &wo->udp;
-      if( ci_udp_recv_q_not_empty(&us->recv_q) ) {
+      if( ci_udp_rx_q_any_not_empty(us) ) {
+        int q;
         ++s->udp_has_recvq;
-        s->udp_recvq_pkts += ci_udp_recv_q_pkts(&us->recv_q);
+        for( q = 0; q < ci_udp_rx_q_count(us); ++q )
+          s->udp_recvq_pkts += ci_udp_recv_q_pkts(ci_udp_rx_q(us, q));
       }
       if( us->tx_count ) {
         ++s->udp_has_sendq;
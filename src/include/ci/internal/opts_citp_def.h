@@ -144,7 +144,21 @@ CI_CFG_OPT("EF_EPOLL_CTL_HANDOFF", ul_epoll_ctl_handoff, ci_uint32,
 "message is emitted to stderr or the system log.",
            1, , 1, 0, 1, yesno)
 
-CI_CFG_OPT("EF_EPOLL_MT_SAFE", ul_epoll_mt_safe, ci_uint32, 
+CI_CFG_OPT("EF_EPOLL_MULTI_STACK", ul_epoll_multi_stack, ci_uint32,
+"When using EF_UL_EPOLL=3, attach sockets residing in stacks other than the "
+"epoll set's home stack to a ready list in their own stack, so that their "
+"readiness is aggregated through the per-stack ready rings "
+"(EF_EPOLL_READY_RING).  One spinning epoll_wait() call then covers all "
+"stacks without polling every non-home socket on each pass.  This helps "
+"applications with sockets spread over several stacks, for example one "
+"stack per interface."
+"\n"
+"The stacks must have EF_EPOLL_READY_RING enabled for the aggregation to "
+"take effect.  Blocking behaviour is unchanged: non-home sockets still "
+"wake the set via the kernel.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_EPOLL_MT_SAFE", ul_epoll_mt_safe, ci_uint32,
 "This option disables concurrency control inside the accelerated epoll "
 "implementations, reducing CPU overhead.  It is safe to enable this option if,"
 " for each epoll set, all calls on the epoll set and all calls that may modify"
@@ -189,6 +203,18 @@ CI_CFG_OPT("EF_FDS_MT_SAFE", fds_mt_safe, ci_uint32,
 "if your signal handlers call bind(), connect(), listen() or close()",
            1, , 1, 0, 1, yesno)
 
+CI_CFG_OPT("EF_FDTABLE_RCU", fdtable_rcu, ci_uint32,
+"When EF_FDS_MT_SAFE=0, look up file descriptors optimistically instead of "
+"locking the fdtable entry with a busy marker.  The lookup takes a single "
+"reference with one atomic operation and re-validates the entry, instead of "
+"performing two compare-and-swaps on the shared table entry per intercepted "
+"call.  Freeing of fd state is deferred until all concurrent lookups are "
+"known to have completed, using the membarrier() system call; on kernels "
+"without membarrier() support this option is ignored.  This option has no "
+"effect when EF_FDS_MT_SAFE=1, which avoids the atomic operations entirely "
+"by assuming fds are not concurrently reused.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_FDTABLE_STRICT", fdtable_strict, ci_uint32,
 "Enables more strict concurrency control for the user-level file descriptor "
 "table.  Enabling this option can reduce performance for applications that "
@@ -495,6 +521,25 @@ CI_CFG_OPT("EF_SLEEP_SPIN_USEC", sleep_spin_usec, ci_uint32,
 OO_SPIN_BLURB,
            , , 0, MIN, MAX, time:usec)
 
+CI_CFG_OPT("EF_SPIN_TOPOLOGY_AWARE", spin_topology_aware, ci_uint32,
+"When set, spinning threads periodically check their CPU placement and "
+"switch to yield-based waiting (with a warning) when running on an SMT "
+"sibling of another spinning Onload thread, or on an efficiency core of a "
+"hybrid CPU.  A spinner on such a core steals execution resources from the "
+"thread it is waiting for and typically increases latency rather than "
+"reducing it.  Clear to spin at full rate regardless of placement.",
+           1, ,1, 0, 1, yesno)
+
+CI_CFG_OPT("EF_FWD_CACHE_SIZE", fwd_cache_size, ci_uint32,
+"Number of entries in the per-stack route cache consulted by unconnected "
+"sends before falling back to a full control-plane fwd-table lookup.  "
+"Rounded up to a power of two.  Each entry caches the source address, "
+"interface and encapsulation chosen for one destination, and is "
+"invalidated automatically when the control plane updates the underlying "
+"route.  Size it to cover the number of distinct destinations the "
+"application sends to; set to 0 to disable the cache.",
+           , , 4096, 0, 1048576, count)
+
 CI_CFG_OPT("EF_POLL_FAST_USEC", ul_poll_fast_usec, ci_uint32,
 "When spinning in a poll() call, causes accelerated sockets to be polled for N "
 "usecs before unaccelerated sockets are polled.  This reduces "
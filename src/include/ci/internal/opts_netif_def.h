@@ -171,6 +171,15 @@ CI_CFG_OPT("EF_INT_DRIVEN", int_driven, ci_uint32,
 "moderation be set to a reasonably high value (eg. 100us) to prevent too high "
 "a rate of interrupts.",
            1, , 1, 0, 1, yesno)
+
+CI_CFG_OPT("EF_EPOLL_READY_RING", epoll_ready_ring, ci_uint32,
+"Deliver socket readiness to epoll sets via a shared-memory ring as well as "
+"the ready lists.  With this option an epoll set using its home stack "
+"(EF_UL_EPOLL=3) can usually gather ready sockets without taking the stack "
+"lock, so the cost of epoll_wait() scales with the number of ready sockets "
+"rather than the number of stack pollers contending for the lock.  This "
+"helps applications with very large epoll sets.",
+           1, , 0, 0, 1, yesno)
 #if CI_CFG_WANT_BPF_NATIVE
 CI_CFG_OPT("EF_POLL_IN_KERNEL", poll_in_kernel, ci_uint32,
 "Do polling of eventq in kernel.  This introduces cost of additional syscall(s) "
@@ -191,6 +200,19 @@ CI_CFG_OPT("EF_INT_REPRIME", int_reprime, ci_uint32,
 "Enable interrupts more aggressively than the default.",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_INT_ADAPTIVE_EMPTY_POLLS", int_adaptive_empty_polls, ci_uint32,
+"Hybrid spinning/interrupt mode of operation.  When set to a non-zero value "
+"N, the stack counts consecutive polls that find no events.  Once N empty "
+"polls have been seen in a row the event-queue interrupts are armed, so that "
+"a thread which stops spinning (eg. because its spin timeout expires) is "
+"woken promptly when traffic resumes.  Any poll that finds events resets the "
+"count, returning the stack to pure spinning while it is busy."
+"\n"
+"This provides a middle ground between spinning (see EF_POLL_USEC) and "
+"EF_INT_DRIVEN=1: quiet periods do not burn a core raising interrupt rate, "
+"and busy periods do not take interrupts at all.",
+           1, , 0, 0, SMAX, count)
+
 #define MULTICAST_LIMITATIONS_NOTE                                      \
     "\nSee the OpenOnload manual for further details on multicast operation."
 
@@ -292,6 +314,28 @@ CI_CFG_OPT("EF_UDP_SEND_UNLOCKED", udp_send_unlocked, ci_uint32,
 "concurrency when multiple threads are performing UDP sends.",
            1, , 1, 0, 1, yesno)
 
+CI_CFG_OPT("EF_PIPE_SPSC", pipe_spsc, ci_uint32,
+"Enables lock-free fast paths for pipe reads and writes.  This option is a "
+"promise by the application that each end of every pipe in the stack is used "
+"by at most one thread at a time, as is typical when a pipe is used for "
+"handoff between a single producer and a single consumer.  When enabled, "
+"reads do not take the socket lock and writes that fit in the current pipe "
+"buffer do not take the stack lock.  Do not enable this option if any pipe "
+"end may be shared between threads (including across fork()), or if the "
+"zero-copy pipe extension API is used.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_PIPE_FUTEX", pipe_futex, ci_uint32,
+"Deliver pipe wakeups between processes sharing a stack via a futex word in "
+"the shared state instead of an ioctl into the driver.  A thread blocking on "
+"a pipe waits on the futex, and the peer end wakes it with a single futex "
+"syscall -- or none at all if the blocked end is still spinning.  Wakeups "
+"that originate in the kernel (notably cleanup when a peer process dies "
+"without closing its end) cannot ding the futex, so a blocked thread "
+"re-checks the pipe periodically; noticing such events may be delayed by up "
+"to 100ms.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_UNCONFINE_SYN", unconfine_syn, ci_uint32,
 "Accept TCP connections that cross into or out-of a private network.",
            1, , 1, 0, 1, yesno)
@@ -345,6 +389,16 @@ CI_CFG_OPT("EF_RX_TIMESTAMPING", rx_timestamping, ci_uint32,
 " does not succeed;\n",
            2, , 0, 0, 3, count)
 
+CI_CFG_OPT("EF_RX_LATENCY_HISTOGRAM", rx_latency_histogram, ci_uint32,
+"Accumulate a histogram of wire-to-poll latency: the difference between "
+"each received packet's hardware timestamp and the wallclock time at which "
+"the stack poll processed it.  The buckets are exposed as rx_wire_lat_* in "
+"the stack statistics, so they are visible through onload_stackdump lots "
+"and the remote monitor without any per-packet work in the application."
+"\n"
+"Requires hardware receive timestamping (see EF_RX_TIMESTAMPING).",
+           1, , 0, 0, 1, yesno)
+
 #define CITP_RX_TIMESTAMPING_SOURCE_NIC 0
 #define CITP_RX_TIMESTAMPING_SOURCE_CPACKET 1
 CI_CFG_OPT("EF_RX_TIMESTAMPING_ORDERING", rx_timestamping_ordering, ci_uint32,
@@ -379,6 +433,25 @@ CI_CFG_OPT("EF_CLUSTER_IGNORE", cluster_ignore, ci_uint32,
 "effectively ignore attempts to set SO_REUSEPORT.",
            1, , 0, 0, 1, count)
 
+CI_CFG_OPT("EF_CLUSTER_RSS_POLICY", cluster_rss_policy, ci_uint32,
+"Policy used to distribute new connections across the members of a "
+"SO_REUSEPORT cluster.  The adapter spreads connections with an RSS hash; "
+"the policy is applied by periodically reweighting the RSS indirection "
+"table of the cluster's VI set, so it steers flows in aggregate rather "
+"than per connection.\n"
+"  0  -  even: stripe the indirection table evenly (default)\n"
+"  1  -  least-loaded: shift weight away from cluster members with deep "
+"listen accept queues\n"
+"  2  -  numa: prefer cluster members whose creating thread ran on the "
+"adapter's NUMA node\n"
+"The policy is fixed when the cluster is created, i.e. by the first "
+"process to create a stack in it.",
+           2, , 0, 0, 2, count)
+
+#define CITP_CLUSTER_RSS_POLICY_EVEN   0
+#define CITP_CLUSTER_RSS_POLICY_LLOAD  1
+#define CITP_CLUSTER_RSS_POLICY_NUMA   2
+
 CI_CFG_OPT("EF_VALIDATE_ENV", validate_env, ci_uint32,
 "When set this option validates Onload related environment "
 "variables (starting with EF_).",
@@ -392,6 +465,17 @@ CI_CFG_OPT("EF_TAIL_DROP_PROBE", tail_drop_probe, ci_uint32,
            , , 1, 0, 1, yesno)
 #endif
 
+#if CI_CFG_TCP_RACK
+CI_CFG_OPT("EF_TCP_RACK", tcp_rack, ci_uint32,
+"Enable RACK (RFC 8985) time-based loss detection on TCP connections that "
+"negotiate SACK.  A segment is deemed lost, and fast recovery entered, once "
+"a segment sent after it has been delivered and a reordering window has "
+"passed, instead of waiting for three duplicate ACKs or a retransmit "
+"timeout.  This improves recovery latency on lossy paths, particularly when "
+"too little data is in flight to generate enough duplicate ACKs.",
+           , , 0, 0, 1, yesno)
+#endif
+
 CI_CFG_OPT("EF_TCP_RST_DELAYED_CONN", rst_delayed_conn, ci_uint32,
 "This option tells Onload to reset TCP connections rather than allow data to "
 "be transmitted late.  Specifically, TCP connections are reset if the "
@@ -453,6 +537,16 @@ CI_CFG_OPT("EF_TCP_SYNCOOKIES", tcp_syncookies, ci_uint32,
 "Use TCP syncookies to protect from SYN flood attack",
            1, , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_TCP_SYN_DEFER", tcp_syn_defer, ci_uint32,
+"Defer processing of incoming SYNs to listening sockets until after the "
+"rest of the event batch has been handled, and bound the number of SYNs "
+"processed per stack poll to this value.  This keeps the latency of "
+"established connections stable when a listener is being scanned or SYN "
+"flooded: data packets are always handled first, and excess SYNs are "
+"carried over to later polls (or dropped once the deferral queue is "
+"full).  Set to 0 (the default) to process SYNs inline as they arrive.",
+           , , 0, 0, MAX, count)
+
 CI_CFG_OPT("EF_TCP_SEND_NONBLOCK_NO_PACKETS_MODE", 
            tcp_nonblock_no_pkts_mode, ci_uint32,
            "This option controls how a non-blocking TCP send() call should "
@@ -491,8 +585,32 @@ CI_CFG_OPT("EF_TCP_RCVBUF_MODE", tcp_rcvbuf_mode, ci_uint32,
 "       If SO_RCVBUF is explictly set by the application this value will be"
 "       used. EF_TCP_SOCKBUF_MAX_FRACTION can be used to control the maximum"
 "       size of the buffer for an individual socket."
+"Mode 2 is as mode 1, but additionally shrinks RCVBUF when the rate data"
+"       is drained by the application stays well below the buffer size for"
+"       several RTTs, releasing packet buffer reservation to other sockets"
+"       in the stack."
 "The effect of EF_TCP_RCVBUF_STRICT is independent of this setting.",
-	   1, , 0, 0, 1, yesno)
+	   2, , 0, 0, 2, oneof:fixed;drs;drs_shrink)
+
+CI_CFG_OPT("EF_TCP_RX_COALESCE", tcp_rx_coalesce, ci_uint32,
+"When set to 1, the payload of an in-order TCP segment is copied into spare "
+"space in the packet buffer at the tail of the receive queue, where possible, "
+"instead of always being queued as a separate packet.  This reduces the "
+"number of receive queue entries that bulk readers must walk, at the cost of "
+"a payload copy on receive.  It is most effective for streams of small "
+"segments.  Coalescing is not performed while hardware timestamps are being "
+"delivered to the application.",
+           1, , 0, 0, 1, yesno)
+
+#if CI_CFG_RX_ORDER_TAP
+CI_CFG_OPT("EF_RX_ORDER_TAP", rx_order_tap, ci_uint32,
+"When set to 1, every payload delivery to a TCP or UDP receive queue also "
+"appends a (socket, bytes, hardware timestamp) record to a per-stack ring "
+"in NIC arrival order.  Applications merging multiple feeds in wire order "
+"can consume the ring via onload_rx_order_read() instead of paying "
+"onload_ordered_epoll_wait()'s per-batch timestamp sort.",
+           1, , 0, 0, 1, yesno)
+#endif
 
 CI_CFG_OPT("EF_HIGH_THROUGHPUT_MODE", rx_merge_mode, ci_uint32,
 "This option causes onload to optimise for throughput at the cost of latency.",
@@ -693,6 +811,15 @@ CI_CFG_OPT("EF_TCP_TCONST_MSL", msl_seconds, ci_uint32,
 "causes connections to spend less time in the TIME_WAIT state.",
            8, , CI_CFG_TCP_TCONST_MSL, MIN, MAX, time:sec)
 
+CI_CFG_OPT("EF_TCP_TIME_WAIT_MAX", tcp_time_wait_max, ci_uint32,
+"Maximum number of sockets held in the TIME_WAIT state at once.  When a "
+"connection enters TIME_WAIT beyond this limit, the socket closest to its "
+"2MSL expiry is closed early and returned to the endpoint pool, so a "
+"reconnect storm cannot exhaust the stack's endpoints on a transient "
+"state.  Equivalent to the kernel's tcp_max_tw_buckets.  Set to 0 (the "
+"default) for no limit.",
+           , , 0, 0, 1000000000, count)
+
 CI_CFG_OPT("EF_TCP_FIN_TIMEOUT", fin_timeout, ci_uint32,
 "Time in seconds to wait for an orphaned connection to be closed properly "
 "by the network partner (e.g. FIN in the TCP FIN_WAIT2 state; zero window "
@@ -780,6 +907,60 @@ CI_CFG_OPT("EF_TXQ_SIZE", txq_size, ci_uint16,
 "or 4096.",
            , , 512, 512, 4096, bincount)
 
+CI_CFG_OPT("EF_POLL_PROFILE", poll_profile, ci_uint32,
+"When set to 1, timestamp the phases of each stack poll (event processing, "
+"deferred socket work, descriptor ring refill, loopback delivery and the "
+"timer wheel) and accumulate per-phase cycle totals and maxima.  The "
+"results are reported by onload_stackdump in the \"dump_extra\" output and "
+"identify which phase is responsible for poll-latency spikes.  Adds two "
+"cycle-counter reads per phase per poll, so leave it off when not "
+"investigating.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_TX_PACING_RATE", tx_pacing_rate, ci_uint32,
+"When non-zero, limits the rate at which this stack transmits to the given "
+"number of bytes per second.  Packets that would exceed the rate are held on "
+"a per-stack pacing queue and released from the stack's timer wheel, so no "
+"application timer thread is needed to pace traffic.  Zero (the default) "
+"disables pacing.",
+           , , 0, MIN, MAX, count)
+
+CI_CFG_OPT("EF_TX_LATENCY_PRIO", tx_latency_prio, ci_uint32,
+"When non-zero, sockets whose SO_PRIORITY is at least this value are "
+"treated as latency-class senders.  Their packets are placed on a "
+"per-interface urgent transmit overflow queue that is drained ahead of the "
+"normal overflow queue, and they may be sent immediately even while bulk "
+"traffic is queued, so a bulk sender sharing the stack cannot delay them "
+"behind its backlog.  Ordering is preserved per socket but not between "
+"sockets of different classes.  Zero (the default) disables transmit "
+"classes and all packets share the normal overflow queue.",
+           , , 0, MIN, MAX, count)
+
+CI_CFG_OPT("EF_RX_LATENCY_INTFS", rx_latency_intfs, ci_uint32,
+"Bitmask of the stack's interfaces (in the order shown by onload_stackdump, "
+"bit N covering interface N) to treat as latency-class when polling.  Each "
+"stack poll drains the latency-class interfaces exhaustively - re-polling "
+"them while their event queues keep filling the poll budget - before the "
+"remaining bulk-class interfaces are polled once as usual.  This stops a "
+"burst of bulk traffic on one interface from head-of-line-blocking "
+"latency-critical flows steered to another.  The number of latency-class "
+"drain rounds per poll is bounded, so bulk interfaces are always serviced.  "
+"Zero (the default), or a mask covering every interface, leaves the "
+"single-tier rotating poll order unchanged.",
+           , , 0, MIN, MAX, bitmask)
+
+CI_CFG_OPT("EF_RX_REFILL_ADAPTIVE", rx_refill_adaptive, ci_uint32,
+"Batch RX descriptor ring refills adaptively.  By default the ring is "
+"topped up at the end of every poll that leaves at least one batch of "
+"space, which keeps the ring as full as possible but scatters small "
+"descriptor writes across polls.  With this option set, refill is "
+"deferred until the ring deficit reaches a quantum scaled to the drain "
+"rate observed over recent refill cycles, so descriptor writes batch "
+"into contiguous stretches of the ring.  The deferral is abandoned "
+"whenever the ring falls below half of EF_RXQ_LIMIT, so the hysteresis "
+"cannot run the ring dry.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_SEND_POLL_THRESH", send_poll_thresh, ci_uint16,
 "Poll for network events after sending this many packets."
 "\n"
@@ -843,7 +1024,39 @@ CI_CFG_OPT("EF_DELACK_THRESH", delack_thresh, ci_uint16,
 "NB. This option is overridden by EF_DYNAMIC_ACK_THRESH, so both options need "
 "to be set to 0 to disable delayed acknowledgements.",
            , , 1, 0, 65535, count)
-           
+
+CI_CFG_OPT("EF_TCP_FAST_ACK", tcp_fast_ack, ci_uint32,
+"Schedule delayed acknowledgements via a small per-stack deadline array "
+"that is checked inline on every stack poll, instead of arming and "
+"cancelling a timer-wheel entry for each received segment.  This reduces "
+"per-segment timer bookkeeping on the receive path for busy sockets.  "
+"Only a limited number of sockets can hold a deadline at once; further "
+"sockets fall back to the normal delayed-ack timer.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_TCP_CORK_NS", tcp_cork_ns, ci_uint32,
+"Auto-cork small TCP sends with a deadline given in nanoseconds.  When "
+"non-zero, data written by send() calls is held in the send queue and a "
+"frame is transmitted when the segment fills, when the application "
+"pushes explicitly (uncorking via TCP_CORK, or shutdown), or when the "
+"deadline expires -- whichever happens first.  The deadline is enforced "
+"by a cycle-counter check inline in the stack poll loop, so it can be "
+"well below a microsecond without any timer-wheel cost.  This lets an "
+"application that issues several back-to-back writes per message "
+"coalesce them into a single frame with a bounded latency penalty.  "
+"Set to 0 (the default) to disable.",
+           , , 0, 0, 1000000, count)
+
+CI_CFG_OPT("EF_TCP_CC", tcp_cc, ci_uint32,
+"Default TCP congestion control algorithm for sockets in this stack: "
+"0 - NewReno (RFC3465 byte counting, the historical behaviour); "
+"1 - a BBR-style rate-based algorithm which sizes the window from "
+"measured delivery rate and minimum RTT rather than from loss.  "
+"Individual sockets may override this with "
+"setsockopt(TCP_CONGESTION, \"newreno\"|\"bbr\").",
+           2, , 0, 0, 1, count)
+
+
 #if CI_CFG_DYNAMIC_ACK_RATE
 CI_CFG_OPT("EF_DYNAMIC_ACK_THRESH", dynack_thresh, ci_uint16,
 "If set to >0 this will turn on dynamic adapation of the ACK rate to "
@@ -852,6 +1065,18 @@ CI_CFG_OPT("EF_DYNAMIC_ACK_THRESH", dynack_thresh, ci_uint16,
 "ACKs before an ACK is forced.  If set to zero then the standard "
 "delayed-ack algorithm is used.",
            , , 16, 0, 65535, count)
+
+CI_CFG_OPT("EF_DYNAMIC_ACK_MAX", dynack_max, ci_uint16,
+"Upper bound for adaptive ACK thinning.  When set above "
+"EF_DYNAMIC_ACK_THRESH, each socket's immediate-ACK threshold adapts "
+"between the two values by tracking the number of segments the socket "
+"receives per stack poll: sustained bulk receive raises the threshold so "
+"that each poll's batch of segments is acknowledged with a single ACK, "
+"and the threshold decays when the receive rate drops, restoring prompt "
+"ACKs for request-response traffic.  This reduces the share of the TX "
+"path consumed by pure ACKs during high-rate ingest.  Set to 0 (or to "
+"<= EF_DYNAMIC_ACK_THRESH) to disable adaptation.",
+           , , 0, 0, 65535, count)
 #endif
 
 CI_CFG_OPT("EF_INVALID_ACK_RATELIMIT", oow_ack_ratelimit, ci_uint32,
@@ -877,6 +1102,16 @@ CI_CFG_OPT("EF_PER_SOCKET_CACHE_MAX", per_sock_cache_max, ci_int32,
            , , -1, -1, SMAX, count)
 #endif
 
+CI_CFG_OPT("EF_TCP_STATE_POOL", tcp_state_pool, ci_uint32,
+"Sets the number of pre-initialised TCP state objects to keep in reserve "
+"for this stack.  When set > 0, socket state for accepted (and loopback) "
+"connections is taken from this pool instead of being initialised on the "
+"spot, which reduces accept latency during connection storms.  The pool is "
+"filled when a socket starts listening and replenished from the listening "
+"socket's timer, off the accept path.  Each pooled object consumes an "
+"endpoint buffer.",
+           , , 0, MIN, SMAX, count)
+
 CI_CFG_OPT("EF_ACCEPTQ_MIN_BACKLOG", acceptq_min_backlog, ci_uint16,
 "Sets a minimum value to use for the 'backlog' argument to the listen() "
 "call.  If the application requests a smaller value, use this value instead.",
@@ -897,6 +1132,39 @@ CI_CFG_OPT("EF_DEFER_WORK_LIMIT", defer_work_limit, ci_uint16,
 "before we force the unlocked thread to block and wait for the lock",
            , , 32, MIN, MAX, count)
 
+CI_CFG_OPT("EF_UDP_TX_STAGING", udp_tx_staging, ci_uint32,
+"When a thread sending on a UDP socket finds the stack lock contended, "
+"stage the fully-formed packet on a per-stack lock-free queue instead of "
+"on the per-socket deferred-send queue.  The staging queue is drained by "
+"whichever thread holds the stack lock, so senders never block on the lock "
+"and do not contend on the lock word itself.  This can improve throughput "
+"when many threads send on sockets sharing one stack.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_PACKET_BUF_NUMA_NODE", packet_buf_numa_node, ci_int16,
+"Allocate packet buffer memory from the specified NUMA node.  By default "
+"(-1) packet memory is allocated on the node of the CPU that happens to "
+"trigger the allocation.  On multi-socket hosts, pinning packet buffers to "
+"the node that runs the critical threads (and to which the NIC is attached) "
+"avoids remote-node memory accesses on every packet."
+"\n"
+"This applies to the normal and compound-page allocation paths; explicit "
+"hugetlbfs allocations (see EF_USE_HUGE_PAGES) follow the mount's own "
+"NUMA policy.",
+	   , , -1, -1, SMAX, count)
+
+CI_CFG_OPT("EF_STACK_NUMA_NODE", stack_numa_node, ci_int16,
+"Allocate the stack's shared state and socket buffers from the specified "
+"NUMA node.  By default (-1) this memory lands on the node of the CPU that "
+"creates the stack.  On multi-socket hosts, setting this to the node of the "
+"stack's NIC (or of the critical threads) avoids remote-node memory "
+"accesses on every stack lock acquisition and socket-state touch."
+"\n"
+"The placement actually achieved is reported by stackdump in the "
+"\"numa nodes\" line.  Packet buffer memory is controlled separately by "
+"EF_PACKET_BUF_NUMA_NODE.",
+	   , , -1, -1, SMAX, count)
+
 CI_CFG_OPT("EF_IRQ_CORE", irq_core, ci_int16,
 "Specify which CPU core interrupts for this stack should be handled on."
 "\n"
@@ -935,6 +1203,16 @@ CI_CFG_OPT("EF_SHARED_RXQ_NUM", shared_rxq_num, ci_int32,
 "available queues.",
            , , -1, -1, 7, count)
 
+CI_CFG_OPT("EF_POLL_TIMER_BUDGET", poll_timer_budget, ci_uint32,
+"Hard cap on the number of timer callbacks dispatched per stack poll.  "
+"When a poll reaches the cap the remaining expired timers stay queued on "
+"the timer wheel and fire on subsequent polls, so a burst of expirations "
+"(e.g. many delayed ACKs or retransmit timeouts becoming due together) "
+"cannot stretch a single poll arbitrarily.  Together with EF_EVS_PER_POLL "
+"this bounds worst-case poll duration at the cost of some timer "
+"dispatch latency under bursts.  Set to 0 (the default) for no cap.",
+           , , 0, 0, 0x7fffffff, count)
+
 CI_CFG_OPT("EF_EVS_PER_POLL", evs_per_poll, ci_uint32,
 "Sets the number of hardware network events to handle before performing other "
 "work.  This is a hint for internal tuning, and the actual number handled "
@@ -945,6 +1223,21 @@ CI_CFG_OPT("EF_EVS_PER_POLL", evs_per_poll, ci_uint32,
 "value is 192, to increasing batching efficiency.",
            , , 64, 0, 0x7fffffff, level)
 
+CI_CFG_OPT("EF_EVQ_HIGH_WATERMARK", evq_high_watermark, ci_uint32,
+"Event-queue high watermark, measured in events.  When set to a non-zero "
+"value N, a poll that consumes its normal budget (EF_EVS_PER_POLL) and "
+"finds at least N further events still queued continues to drain the event "
+"queue, and requests that interrupts be armed when the stack lock is next "
+"dropped so that the kernel polls the stack if the application stops "
+"calling in.  Event-queue overflow is fatal to a stack, so this trades "
+"extra polling work for protection when the application falls behind (for "
+"example during a garbage-collection pause)."
+"\n"
+"Choose a value that is a sizeable fraction of the event queue capacity "
+"but leaves enough headroom to absorb traffic that arrives while the "
+"drain is in progress.  Set to 0 (the default) to disable.",
+           , , 0, MIN, MAX, level)
+
 #if CI_CFG_PORT_STRIPING
 CI_CFG_OPT("EF_STRIPE_NETMASK", stripe_netmask_be32, ci_uint32,
 "Port striping is only negotiated with hosts whose IP address is on the same "
@@ -962,6 +1255,16 @@ CI_CFG_OPT("EF_SPIN_USEC", spin_usec, ci_uint32,
            "" /* documented in opts_citp_def.h */,
            ,  poll_cycles, 0, MIN, MAX, time:usec)
 
+CI_CFG_OPT("EF_TCP_RECV_SPIN_ADAPTIVE", tcp_recv_spin_adaptive, ci_uint32,
+"Adapt the spin budget of a blocking TCP receive to the traffic.  Each "
+"receive spin that times out without finding data halves the time the next "
+"one will spin before sleeping (down to 1/64 of the configured spin "
+"timeout), and any spin that finds data restores the full budget.  This "
+"keeps the run-to-completion receive path (see EF_TCP_RECV_SPIN) from "
+"burning a full spin timeout per call on a quiet connection, without "
+"giving up the latency benefit of spinning while traffic is flowing.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_BUZZ_USEC", buzz_usec, ci_uint32,
 "Sets the timeout in microseconds for lock buzzing options.  Set to zero to "
 "disable lock buzzing (spinning).  Will buzz forever if set to -1.  Also set "
@@ -1013,6 +1316,72 @@ CI_CFG_OPT("EF_MAX_TX_PACKETS", max_tx_packets, ci_int32,
 "receive path.",
            , , 24576, 0, 1000000000, count)
 
+CI_CFG_OPT("EF_UDP_RX_COMPACT", udp_rx_compact, ci_uint32,
+"Copy received UDP datagrams with payload up to this many bytes into "
+"densely packed delivery buffers while they are still cache-hot in the "
+"stack poll, instead of queueing the 2KB receive buffer that each datagram "
+"arrives in.  The receive buffer recycles immediately and the socket "
+"receive queue holds many datagrams per buffer, which cuts its memory "
+"footprint and receive-side cache misses for small-datagram streams such "
+"as market data.  Only unicast IPv4 datagrams on sockets with no ancillary "
+"data (cmsg) options enabled are packed; others are queued as normal.  Not "
+"recommended with wire-order delivery (onload_ordered_epoll_wait), and "
+"zero-copy receive callbacks must not retain (ONLOAD_ZC_KEEP) more than "
+"one packed datagram at a time.  Set to 0 (the default) to disable.",
+           , , 0, 0, 1024, count)
+
+CI_CFG_OPT("EF_UDP_RX_REASSEMBLY", udp_rx_reassembly, ci_uint32,
+"Reassemble fragmented IPv4 UDP datagrams inside the stack instead of "
+"handing the fragments to the kernel.  A completed datagram is delivered "
+"to the socket as a single chained packet, exactly as a jumbo frame would "
+"be, so recvmsg and zero-copy receive see one datagram spanning several "
+"buffers.  This avoids the kernel reassembly path (and its softirq "
+"dependency) for large datagrams from senders that fragment at the MTU.  "
+"Fragments only reach the stack at all when hardware filters steer them "
+"here, e.g. with scalable filters; with ordinary full-match filters "
+"non-first fragments go to the kernel as before and this option has no "
+"effect.  Fragments of datagrams that do not complete, or that turn out "
+"not to match an Onload socket, are passed on to the kernel.  Set to 1 to "
+"enable; default is 0.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_VXLAN_PORT", vxlan_port, ci_uint32,
+"UDP destination port carrying VXLAN-encapsulated traffic (4789 is the "
+"IANA-assigned port).  When non-zero, UDP datagrams received on this "
+"port are decapsulated in the stack and the inner Ethernet frame "
+"(including any inner VLAN tag) is demuxed through the normal filter "
+"table, so tunnelled TCP and UDP flows are accelerated.  The outer flow "
+"must be steered to the stack by a hardware filter, e.g. an Onload UDP "
+"socket bound to the port or scalable filters.  Inner checksums are not "
+"validated by the adapter and are verified in software.  Datagrams on "
+"the port that are not well-formed VXLAN are delivered as ordinary UDP.  "
+"Set to 0 (the default) to disable.",
+           , , 0, 0, 65535, count)
+
+CI_CFG_OPT("EF_ISO_DOMAIN_PKTS", iso_domain_pkts, ci_uint32,
+"Per-isolation-domain limit on the number of packet buffers that the TCP "
+"transmit path may hold at once.  Sockets sharing a stack can be grouped "
+"into isolation domains with onload_socket_isolation_domain(); when this "
+"option is non-zero a domain that reaches the limit has further transmit "
+"allocations refused (the sockets in that domain see normal send-buffer "
+"backpressure) while other domains continue to allocate from the shared "
+"pool.  Set to 0 (the default) to disable per-domain accounting.  Sockets "
+"left in domain 0 are never limited.",
+           , , 0, 0, 1000000000, count)
+
+CI_CFG_OPT("EF_POLL_TX_DOORBELL_BATCH", poll_tx_doorbell_batch, ci_uint32,
+"Defer TX doorbells for the duration of each stack poll.  Transmits made "
+"while the stack is polled - ACKs, retransmits, and application sends from "
+"all sockets processed in the poll - initialise their DMA descriptors "
+"immediately but share a single doorbell per interface, rung when the poll "
+"completes.  Fan-out workloads that send to many sockets per poll replace "
+"one MMIO write per send with one per interface.  Deferral is bounded: the "
+"doorbell is rung early after 64 deferred sends, or if the poll has to "
+"wait for transmit completions.  Adds up to one poll's processing time of "
+"latency to transmits made mid-poll, so leave disabled (the default) for "
+"latency-sensitive request-response traffic.",
+           , , 0, 0, 1, yesno)
+
 /* TODO EFCT allow 0 ring size for now for development purposes */
 CI_CFG_OPT("EF_RXQ_MIN", rxq_min, ci_uint16,
 "Minimum initial fill level for each RX ring.  If Onload is not able to "
@@ -1020,6 +1389,17 @@ CI_CFG_OPT("EF_RXQ_MIN", rxq_min, ci_uint16,
 "creation of the stack will fail.",
            , , 256, 0, MAX, count)
 
+CI_CFG_OPT("EF_RXQ_INIT_FILL", rxq_init_fill, ci_int32,
+"Initial fill level for each RX ring at stack creation.  When non-zero, "
+"rings are only filled to this level (but never below EF_RXQ_MIN) while the "
+"stack is being created, and the normal refill path tops them up to "
+"EF_RXQ_LIMIT as the stack starts to be polled.  This reduces the packet "
+"memory committed synchronously during stack creation, which shortens "
+"start-up time when many stacks are created at once.  Ignored when "
+"EF_PREALLOC_PACKETS is set.  The default of 0 fills rings completely "
+"during creation.",
+           , , 0, 0, 65535, count)
+
 CI_CFG_OPT("EF_MIN_FREE_PACKETS", min_free_packets, ci_int32,
 "Minimum number of free packets to reserve for each stack at initialisation.  "
 "If Onload is not able to allocate sufficient packet buffers to fill the "
@@ -1043,12 +1423,50 @@ CI_CFG_OPT("EF_PREFAULT_PACKETS", prefault_packets, ci_int32,
 "reserved.  Set to 0 to prevent prefaulting.",
            , , 1, 0, 1000000000, count)
 
+CI_CFG_OPT("EF_PKT_SET_PREMAP", pkt_set_premap, ci_uint32,
+"When set, a process attaching to a stack maps all of the stack's "
+"currently-allocated packet buffer sets with a single contiguous mmap and "
+"precomputes the per-set pointers, instead of mapping each set with its own "
+"mmap the first time a packet in it is touched.  This reduces attach "
+"latency and the number of mappings per process, which matters for "
+"short-lived workers that attach to long-running stacks.  Packet sets "
+"allocated after the attach are still mapped on demand.  Has no effect "
+"when packet buffers are backed by huge pages (EF_USE_HUGE_PAGES), which "
+"must be mapped a hugepage at a time.",
+           1, , 0, 0, 1, yesno)
+
 CI_CFG_OPT("EF_PREALLOC_PACKETS", prealloc_packets, ci_int32,
 "If set ensures all packet buffers (EF_MAX_PACKETS) get allocated during "
 "stack creation or the stack creation fails.  Also when set "
 "EF_MIN_FREE_PACKETS option is not taken into account.",
            , , 0, 0, 1, yesno)
 
+CI_CFG_OPT("EF_STACK_PERSIST", stack_persist, ci_uint32,
+"When set, the stack and its hardware resources (VIs, packet memory and "
+"MAC filters) are kept alive in the kernel after the application exits, "
+"so that a restarted application using the same EF_NAME re-attaches to "
+"the existing stack instead of rebuilding it.  This avoids the stack "
+"allocation and filter insertion costs on restart."
+"\n"
+"A persistent stack holds its resources until it is explicitly killed "
+"with onload_stackdump, so this option should be used together with "
+"EF_NAME and only for applications that are expected to restart.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_ASYNC_FILTER_INSERT", async_filter_insert, ci_uint32,
+"When set, hardware filter installation for actively-opened TCP "
+"connections is deferred to workqueue context instead of being done "
+"synchronously on the connect() path.  Software demultiplexing state is "
+"installed immediately, so the connection is usable as soon as connect() "
+"returns, and the NIC filter-table update happens in the background."
+"\n"
+"Until the hardware filter is installed, packets from the peer are "
+"delivered to the kernel stack rather than to Onload.  This is normally "
+"harmless because the filter is installed well within the connection's "
+"round-trip time, but on very low latency networks early packets can be "
+"reset by the kernel, so this option is off by default.",
+           1, , 0, 0, 1, yesno)
+
 /* Max is currently 2^21 EPs.
  * We allocate ep in pages, EP_BUF_PER_PAGE=4 ep per page, so min is 4.
  * 7 synrecv states consume one endpoint, but we also use aux buffers for
@@ -1069,6 +1487,48 @@ CI_CFG_OPT("EF_MAX_ENDPOINTS", max_ep_bufs, ci_uint32,
            , , CI_CFG_NETIF_MAX_ENDPOINTS, 4, CI_CFG_NETIF_MAX_ENDPOINTS_MAX,
            count)
 
+CI_CFG_OPT("EF_PKT_MAGAZINE", pkt_magazine, ci_uint32,
+"Cache up to this many packet buffers per thread for the non-blocking send "
+"path.  Threads refill the cache from the stack's shared non-blocking pool "
+"in a single atomic operation and then allocate locally, instead of "
+"contending on the shared pool for every packet.  This helps multi-threaded "
+"senders sharing one stack.  Cached buffers are returned to the pool when a "
+"thread exits or moves to a different stack, so up to this many buffers per "
+"thread can be held outside the shared pools.  Set to 0 (default) to "
+"disable.",
+           , , 0, 0, 32, count)
+
+CI_CFG_OPT("EF_SW_FILTER_CUCKOO", sw_filter_cuckoo, ci_uint32,
+"Use a two-choice (cuckoo) layout for the software filter table instead of "
+"open addressing with double hashing.  Every entry lives in one of two "
+"candidate slots, so packet demux never probes more than two table entries "
+"regardless of table occupancy or deletion history.  Inserts may relocate "
+"existing entries to make room and can fail earlier than the default layout "
+"when the table is heavily loaded, in which case the affected socket is "
+"handed over to the kernel as with a full table today.",
+           1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_MCAST_DEMUX", mcast_demux, ci_uint32,
+"Number of multicast (group, port) subscriptions to index in a dedicated "
+"demux table.  Received multicast UDP packets are then matched against the "
+"small set of sockets subscribed to the packet's group and port rather than "
+"probing the main software filter table, which helps applications with "
+"thousands of group subscriptions.  The table falls back to the ordinary "
+"demux path when it overflows.  Set to 0 (default) to disable.",
+           , , 0, 0, 1048576, count)
+
+CI_CFG_OPT("EF_RX_FLOW_HINT", rx_flow_hint, ci_uint32,
+"Remember which socket each received TCP flow last demuxed to, keyed by a "
+"cheap fold of the packet's addresses and ports, and try that socket first "
+"on the next packet.  A hint is revalidated against the packet's full "
+"4-tuple (and any interface binding) before delivery, so it can never "
+"deliver to the wrong socket; a hit merely skips the software filter "
+"table probe, which removes the hash-table walk from the steady-state "
+"per-packet cost for established flows.  On adapters whose RX prefix "
+"carries the RSS flow hash this also enables a hash-keyed prefetch of "
+"the probable socket state one event ahead of packet processing.",
+           1, , 1, 0, 1, yesno)
+
 
 CI_CFG_OPT("EF_ENDPOINT_PACKET_RESERVE", endpoint_packet_reserve, ci_uint16,
 "This option enables reservation of packets per endpoint.  No other endpoints"
@@ -1089,6 +1549,20 @@ CI_CFG_OPT("EF_DEFER_ARP_TIMEOUT", defer_arp_timeout, ci_uint16,
 "(via ARP protocol for IPv4 or Neighbor Discovery for IPv6).",
           , , 60, 1, 600, time:sec)
 
+CI_CFG_OPT("EF_CPLANE_NONBLOCK_RESOLVE", cplane_nonblock_resolve, ci_uint32,
+"When set to 1, a send to a destination whose route is not yet in the "
+"control plane's forwarding cache does not wait for the control plane "
+"server to resolve it.  Instead the packet is queued in the stack and "
+"transmitted from the poll loop once the forwarding entry is published, "
+"subject to the EF_DEFER_ARP_TIMEOUT timeout.  This avoids a blocking "
+"resolution (which can include an ARP round-trip) in the send call after "
+"a route change or on the first send to a new destination.  It only "
+"applies when the socket's source address is already known; sends from "
+"unbound sockets still wait so that a local address can be selected.  "
+"UDP sendmsg() calls to an unresolved destination fall back to the OS "
+"socket instead of being queued.",
+           1, , 0, 0, 1, yesno)
+
 
 CI_CFG_OPT("EF_TCP_SNDBUF_ESTABLISHED_DEFAULT", tcp_sndbuf_est_def, ci_uint32,
 "Overrides the OS default SO_SNDBUF value for TCP sockets in the ESTABLISHED "
@@ -1370,6 +1844,15 @@ CI_CFG_OPT("EF_CTPIO_SWITCH_BYPASS", ctpio_switch_bypass, ci_uint32,
 "loopback between interfaces, as used by virtual machines.  CTPIO bypasses "
 "the switch, and hence is not compatible with those features.",
            1, , 0, 0, 1, yesno)
+
+CI_CFG_OPT("EF_UDP_CTPIO", udp_ctpio, ci_uint32,
+"Allows UDP datagrams to be sent using CTPIO (subject to EF_CTPIO and the "
+"usual frame-length and fill-level checks).  Set to 0 to restrict CTPIO to "
+"TCP: with EF_CTPIO_MODE=ct a frame that underruns is poisoned and dropped "
+"by the link partner, and a UDP datagram, unlike a TCP segment, has no "
+"retransmit to recover it.  Ignored on NICs where CTPIO is the only "
+"transmit mechanism.",
+           1, , 1, 0, 1, yesno)
 #endif
 
 CI_CFG_OPT("EF_TX_PUSH_THRESHOLD", tx_push_thresh, ci_uint16,
@@ -1487,6 +1970,29 @@ CI_CFG_STR_OPT("EF_SCALABLE_FILTERS", scalable_filter_string, ci_string256,
 "is the string 'any', scalable filters are installed on all interfaces.",
                ,  , "", none, none, )
 
+CI_CFG_OPT("EF_RX_ETHERTYPE", rx_ethertype, ci_uint16,
+"When non-zero, install a hardware filter steering all frames of this "
+"ethertype (host byte order, e.g. 0x88b5) arriving on the interface given "
+"by EF_RX_ETHERTYPE_IFINDEX to this stack.  The frames are delivered to "
+"the stack's receive path, where the application consumes them with "
+"onload_rx_prefilter_set() and can transmit replies with oo_raw_send(); "
+"frames not consumed by the prefilter are passed on to the kernel, so "
+"an AF_PACKET socket continues to work as a fallback.  This keeps a raw "
+"L2 protocol's receive processing in the same spin loop as the stack's "
+"TCP/UDP traffic instead of taking the kernel softirq path.\n"
+"\n"
+"The filter is MAC-qualified: only frames addressed to the interface's "
+"own MAC address are steered.  Requires CAP_NET_RAW.  The filter is "
+"per-(interface, ethertype): a second stack asking for the same flow "
+"fails to create.",
+           , , 0, MIN, MAX, count)
+
+CI_CFG_OPT("EF_RX_ETHERTYPE_IFINDEX", rx_ethertype_ifindex, ci_int32,
+"The ifindex of the interface on which EF_RX_ETHERTYPE frames are "
+"steered to this stack.  Must be set (non-zero) when EF_RX_ETHERTYPE is "
+"set, and must be an interface accelerated by this stack.",
+           , , 0, MIN, MAX, count)
+
 #define CITP_SCALABLE_MODE_NONE              0x0
 #define CITP_SCALABLE_MODE_RSS               0x1
 #define CITP_SCALABLE_MODE_TPROXY_ACTIVE     0x2
@@ -1542,6 +2048,18 @@ CI_CFG_OPT("EF_PERIODIC_TIMER_CPU", periodic_timer_cpu, ci_int32,
            "periodic timer ticks."
            , , , -1, -1, SMAX, count)
 
+CI_CFG_OPT("EF_STATS_EXPORT_MS", stats_export_ms, ci_uint32,
+"When non-zero, the process creating the stack mirrors the stack's "
+"statistics counters into a world-readable shared-memory file "
+"(/dev/shm/onload_stats_<stack-id>) approximately every this many "
+"milliseconds.  Monitoring agents can mmap() the file and read the "
+"counters of every stack on the host with plain memory reads, without "
+"attaching to the stacks.  The file layout is described in "
+"<onload/netif_stats_export.h>.  The counters are refreshed from the "
+"stack-polling paths, so they are only as fresh as the stack is polled.  "
+"Set to 0 to disable the export.",
+           , , 0, MIN, MAX, count)
+
 #define CITP_SCALABLE_FILTERS_DISABLE 0
 #define CITP_SCALABLE_FILTERS_ENABLE  1
 #define CITP_SCALABLE_FILTERS_ENABLE_WORKER  2
@@ -1572,6 +2090,15 @@ CI_CFG_OPT("EF_SCALABLE_LISTEN_MODE", scalable_listen, ci_uint32,
 "        issue with large numbers of listen sockets.\n",
          , , 0, 0, 1, oneof:bound;accelerated_only;)
 
+CI_CFG_OPT("EF_FILTER_SPILL", filter_spill, ci_uint32,
+"When the NIC filter table is full, keep new actively-opened TCP connections "
+"accelerated by falling back to the stack's scalable (wildcard) filter with "
+"software demultiplexing, instead of handing the socket over to the kernel "
+"stack.  Requires scalable filters to be configured in an active mode (see "
+"EF_SCALABLE_FILTERS); connections whose local address is not covered by the "
+"scalable filter are handed over as before.",
+           1, , 0, 0, 1, yesno)
+
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
 CI_CFG_OPT("EF_SCALABLE_ACTIVE_WILDS_NEED_FILTER",
            scalable_active_wilds_need_filter, ci_uint32,
@@ -1720,8 +2247,12 @@ CI_CFG_OPTGROUP(rto,                         tcp_retransmission, 100)
 
 
 CI_CFG_OPT("EF_AF_XDP_ZEROCOPY", af_xdp_zerocopy, ci_uint32,
-"Enables zerocopy on AF_XDP NICs. Support for zerocopy is required. ",
-           1, , 0, 0, 1, yesno)
+"Requests zerocopy mode on AF_XDP NICs, eliminating the kernel's copy of "
+"each packet between the driver and the umem.  Zerocopy is negotiated at "
+"bind time: if the driver does not support it the socket falls back to "
+"copy mode with a warning, so this is safe to leave enabled on drivers of "
+"unknown capability.",
+           1, , 1, 0, 1, yesno)
 
 CI_CFG_OPT("EF_ICMP_PKTS", icmp_msg_max, ci_uint32,
            "Maximum number of ICMP messages which can be queued to "
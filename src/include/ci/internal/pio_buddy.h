@@ -22,12 +22,30 @@ extern void ci_pio_buddy_dtor(ci_netif* ni, ci_pio_buddy_allocator* buddy);
 extern ci_int32 ci_pio_buddy_alloc(ci_netif* ni, ci_pio_buddy_allocator*,
                               ci_uint8 order);
 
+/*! Allocate [n] contiguous blocks, each of length 1 << order, from the PIO
+ * region and return the offset of the first.  Each constituent block may
+ * subsequently be freed individually with ci_pio_buddy_free(offset, order)
+ * as if it had been allocated with ci_pio_buddy_alloc.
+ * Returns less than 0 (errno) on failure; on failure no blocks are
+ * allocated.
+ */
+extern ci_int32 ci_pio_buddy_alloc_array(ci_netif* ni,
+                                         ci_pio_buddy_allocator*,
+                                         ci_uint8 order, int n);
+
 /*! Free a block in the PIO region.  The provided offset should be an offset
  * into the region as returned from ci_pio_buddy_alloc.
  */
 extern void ci_pio_buddy_free(ci_netif* ni, ci_pio_buddy_allocator*,
                               ci_int32 offset, ci_uint8 order);
 
+/*! Report the number of free bytes in the PIO region and the size of the
+ * largest free block (a measure of fragmentation).
+ */
+extern void ci_pio_buddy_stats(ci_netif* ni, ci_pio_buddy_allocator*,
+                               ci_uint32* bytes_free_out,
+                               ci_uint32* largest_free_out);
+
 
 #endif  /* __CI_INTERNAL_PIO_BUDDY_H__ */
 
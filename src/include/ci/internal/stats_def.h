@@ -51,6 +51,10 @@ OO_STAT("Number of times event queue was polled from user-level.",
         ci_uint32, u_polls, count)
 OO_STAT("Number of times event queue was polled from user-level with ioctl.",
         ci_uint32, ioctl_evq_polls, count)
+OO_STAT("A spinning thread saw outstanding events but skipped its poll "
+        "attempt because another thread already held the stack lock, "
+        "avoiding a doomed trylock on the contended lock word.",
+        ci_uint32, spin_poll_lock_avoided, count)
 OO_STAT("Number of RX events handled.  Not always 1:1 with number of "
         "packets received, an event can cover a batch of packets in "
         "high-throughput mode.",
@@ -97,6 +101,69 @@ OO_STAT("Number of times an interrupt handler was limited by NAPI budget.  "
 OO_STAT("Number of times poll has been deferred to lock holder.  i.e. There "
         "was contention, and this reader thread gave way.",
         ci_uint32, deferred_polls, count)
+OO_STAT("Number of times interrupts were armed because a run of empty polls "
+        "exceeded EF_INT_ADAPTIVE_EMPTY_POLLS.",
+        ci_uint32, adaptive_int_primes, count)
+OO_STAT("Number of times a poll was extended past its budget because an "
+        "event queue was still filled above EF_EVQ_HIGH_WATERMARK.  "
+        "Frequent increments mean the stack is close to event-queue "
+        "overflow; poll more often or raise EF_EVS_PER_POLL.",
+        ci_uint32, evq_watermark_drains, count)
+OO_STAT("Number of times the post-poll list of sockets with deferred work "
+        "was drained.",
+        ci_uint32, post_poll_drains, count)
+OO_STAT("Number of sockets processed when draining the post-poll list.  "
+        "Divide by post_poll_drains for the mean drain cost; set "
+        "EF_POLL_PROFILE for the cycle cost.",
+        ci_uint32, post_poll_socks, count)
+/* The rx_wire_lat_* buckets below form a histogram and are indexed as an
+ * array by the poll loop: they must stay contiguous and in this order.
+ * See EF_RX_LATENCY_HISTOGRAM. */
+OO_STAT("Packets with wire-to-poll latency below 1us.",
+        ci_uint32, rx_wire_lat_lt1us, count)
+OO_STAT("Packets with wire-to-poll latency of 1-2us.",
+        ci_uint32, rx_wire_lat_2us, count)
+OO_STAT("Packets with wire-to-poll latency of 2-4us.",
+        ci_uint32, rx_wire_lat_4us, count)
+OO_STAT("Packets with wire-to-poll latency of 4-8us.",
+        ci_uint32, rx_wire_lat_8us, count)
+OO_STAT("Packets with wire-to-poll latency of 8-16us.",
+        ci_uint32, rx_wire_lat_16us, count)
+OO_STAT("Packets with wire-to-poll latency of 16-32us.",
+        ci_uint32, rx_wire_lat_32us, count)
+OO_STAT("Packets with wire-to-poll latency of 32-64us.",
+        ci_uint32, rx_wire_lat_64us, count)
+OO_STAT("Packets with wire-to-poll latency of 64-128us.",
+        ci_uint32, rx_wire_lat_128us, count)
+OO_STAT("Packets with wire-to-poll latency of 128-256us.",
+        ci_uint32, rx_wire_lat_256us, count)
+OO_STAT("Packets with wire-to-poll latency of 256-512us.",
+        ci_uint32, rx_wire_lat_512us, count)
+OO_STAT("Packets with wire-to-poll latency of 512us-1ms.",
+        ci_uint32, rx_wire_lat_1ms, count)
+OO_STAT("Packets with wire-to-poll latency of 1ms or more.",
+        ci_uint32, rx_wire_lat_gt1ms, count)
+OO_STAT("RX hardware timestamps converted using the per-poll clock-sync "
+        "snapshot.",
+        ci_uint32, rx_ts_snapshot_hit, count)
+OO_STAT("RX hardware timestamp conversions that failed because the "
+        "clock-sync snapshot was unsynchronised or out of range for the "
+        "packet.  A steadily incrementing count indicates lost time-sync "
+        "events.",
+        ci_uint32, rx_ts_snapshot_miss, count)
+OO_STAT("Number of empty timer-wheel ticks skipped by the busy-bitmap "
+        "scan in ci_ip_timer_poll().",
+        ci_uint32, timer_poll_ticks_skipped, count)
+OO_STAT("Times a poll hit the EF_POLL_TIMER_BUDGET cap and deferred the "
+        "remaining expired timers to a later poll.",
+        ci_uint32, timer_poll_budget_hit, count)
+OO_STAT("Received TCP packets demuxed via the RX flow-hint cache, "
+        "skipping the software filter table probe (EF_RX_FLOW_HINT).",
+        ci_uint32, rx_flow_hint_hit, count)
+OO_STAT("Times Dynamic Right Sizing shrank a socket's receive buffer "
+        "because the application drain rate stayed well below the buffer "
+        "size (EF_TCP_RCVBUF_MODE=2).",
+        ci_uint32, tcp_rcvbuf_shrunk, count)
 OO_STAT("Number of timeout interrupts.  Timeout interrupts mean no "
         "accelerated networking call was made for at least "
         "EF_HELPER_PRIME_USEC.  Some at start-up are normal, otherwise this "
@@ -199,6 +266,9 @@ OO_STAT("We came to release the lock and needed to update software filters.",
         ci_uint32, unlock_slow_swf_update, count)
 OO_STAT("We came to release the lock and needed to close sockets/pipes.",
         ci_uint32, unlock_slow_close, count)
+OO_STAT("Endpoints torn down in bulk-close mode, with hardware filter "
+        "removal deferred out from under the stack lock.",
+        ci_uint32, bulk_close_eps, count)
 #if CI_CFG_WANT_BPF_NATIVE
 OO_STAT("We came to release the lock and needed to handle change in XDP prog",
         ci_uint32, unlock_slow_xdp_change, count)
@@ -214,6 +284,9 @@ OO_STAT("Times a thread has spun waiting for the stack lock.  Indication of "
         "contention (not high) wanted to take the lock; smoething else had "
         "it, so it retried for a while.  See  EF_BUZZ_USEC.",
         ci_uint32, stack_lock_buzz, count)
+OO_STAT("Times a poll-priority thread (onload_thread_set_poll_priority()) "
+        "took the stack lock via priority handoff while spinning.",
+        ci_uint32, stack_lock_prio_handoff, count)
 OO_STAT("Times work has been done by the lock holder for another thread.  "
         "This is a mitigation mechanism for contention - which means that "
         "multiple threads are accessing this stack simultaneously.",
@@ -222,12 +295,31 @@ OO_STAT("Times a thread has slept waiting for a socket lock.",
         ci_uint32, sock_lock_sleeps, count)
 OO_STAT("Times a thread has spun waiting for a socket lock.",
         ci_uint32, sock_lock_buzz, count)
+OO_STAT("Times a spinning thread yielded due to bad CPU placement "
+        "(SMT sibling of another spinner, or efficiency core).",
+        ci_uint32, spin_topology_yield, count)
+OO_STAT("Times a framed zero-copy receive found data queued but no "
+        "complete frame to deliver.",
+        ci_uint32, recv_framing_incomplete, count)
+OO_STAT("Doorbell ioctls issued for the slow-path command ring.",
+        ci_uint32, slowpath_ring_kick, count)
+OO_STAT("Slow-path ring requests enqueued without a doorbell because the "
+        "ring was already non-empty.",
+        ci_uint32, slowpath_ring_moderated, count)
+OO_STAT("Established sockets published to an accept queue via a batched "
+        "promotion flush.",
+        ci_uint32, acceptq_batch_socks, count)
+OO_STAT("Batched accept-queue publications (one shared-state update each).",
+        ci_uint32, acceptq_batch_flush, count)
 OO_STAT("Number of times TCP sendmsg() found the non-blocking pool empty.",
         ci_uint32, tcp_send_nonb_pool_empty, count)
 OO_STAT("Number of times TCP sendmsg() contended the stack lock.",
         ci_uint32, tcp_send_ni_lock_contends, count)
 OO_STAT("Number of times TCP sendmsg() failed to find an acceleratable route.",
         ci_uint32, tcp_send_fail_noroute, count)
+OO_STAT("Number of TCP sends transmitted directly, bypassing the send queue "
+        "(single segment, empty sendq, window and congestion checks passed).",
+        ci_uint32, tcp_send_direct, count)
 OO_STAT("Number of times UDP sendmsg() contended the stack lock.",
         ci_uint32, udp_send_ni_lock_contends, count)
 OO_STAT("Number of times getsockopt() contended the stack lock.",
@@ -252,6 +344,9 @@ OO_STAT("This indicates that a connection came in from a non-accelerated "
         ci_uint32, tcp_accept_os, count)
 OO_STAT(HANDOVER_DESCRIPTION(connect),
         ci_uint32, tcp_handover_connect, count)
+OO_STAT("Number of connect() calls satisfied by handing over a connection "
+        "pre-warmed at start-up (EF_TCP_PREWARM).",
+        ci_uint32, tcp_prewarm_handoffs, count)
 OO_STAT(HANDOVER_DESCRIPTION(setsockopt),
         ci_uint32, tcp_handover_setsockopt, count)
 OO_STAT(HANDOVER_DESCRIPTION_UDP(socket),
@@ -281,6 +376,10 @@ OO_STAT("Onload was short of filters, and reclaimed sockets that were "
         "closing, but not yet fully closed.  This can cause resets to be "
         "sent; if the remote side later finalises the close sequence.",
         ci_uint32, timewait_reap_filter, count)
+OO_STAT("The number of sockets in TIME_WAIT reached EF_TCP_TIME_WAIT_MAX, "
+        "and the socket closest to its 2MSL expiry was recycled early to "
+        "admit a new one.",
+        ci_uint32, timewait_max_reap, count)
 OO_STAT("Max hops in the software-filter hash table lookup.",
         ci_uint32, table_max_hops, val)
 OO_STAT("Rolling mean of number of hops in recent inserts to the software "
@@ -290,6 +389,12 @@ OO_STAT("Number of entries in software-filter hash table.",
         ci_uint32, table_n_entries, val)
 OO_STAT("Number of slots occupied in software-filter hash table.",
         ci_uint32, table_n_slots, val)
+OO_STAT("Multicast UDP packets demuxed via the multicast demux table "
+        "(see EF_MCAST_DEMUX).",
+        ci_uint32, mcast_tbl_rx, count)
+OO_STAT("Multicast UDP packets that fell back from the multicast demux "
+        "table to the software filter table.",
+        ci_uint32, mcast_tbl_rx_fallback, count)
 #if CI_CFG_IPV6
 OO_STAT("Max hops in the IPv6 software-filter hash table lookup.",
         ci_uint32, ipv6_table_max_hops, val)
@@ -314,6 +419,10 @@ OO_STAT("Number of tail-drop probes that were probably unnecessary.",
 OO_STAT("Number of tail-drop probes that probably recovered loss.",
         ci_uint32, tail_drop_probe_success, count)
 #endif
+#if CI_CFG_TCP_RACK
+OO_STAT("Number of times RACK loss detection triggered fast recovery.",
+        ci_uint32, tcp_rack_recovers, count)
+#endif
 OO_STAT("Number of times a connection has been reset while in accept queue; "
         "not yet a fully-connected socket.",
         ci_uint32, rst_recv_acceptq, count)
@@ -437,6 +546,12 @@ OO_STAT("We received a SYN packet, but the accept queue was full, so we drop "
 OO_STAT("We received a SYN, but we don't have an accelerated outgoing route "
         "for the SYN-ACK.  So we drop the connection attempt.",
         ci_uint32, syn_drop_no_return_route, count)
+OO_STAT("Number of SYNs queued for deferred processing after the event "
+        "batch (EF_TCP_SYN_DEFER).",
+        ci_uint32, syn_defer_queued, count)
+OO_STAT("Number of SYNs dropped because the deferral queue was full "
+        "(EF_TCP_SYN_DEFER).",
+        ci_uint32, syn_defer_drop_overflow, count)
 OO_STAT("Number of times a LISTEN socket has started a new half-open socket"
         "(in the listen queue; the SYN-RECV state)",
         ci_uint32, listen2synrecv, count)
@@ -459,6 +574,10 @@ OO_STAT("Times that accept() was called, but as a result of the "
 OO_STAT("Number of times we have sent a pure ACK packet.  Indicates that we "
         "are receiving data substantially more often than we are sending any.",
         ci_uint32, acks_sent, count)
+OO_STAT("Number of stack polls in which adaptive ACK thinning "
+        "(EF_DYNAMIC_ACK_MAX) deferred a pure ACK that the static "
+        "EF_DYNAMIC_ACK_THRESH threshold would have sent immediately.",
+        ci_uint32, acks_thinned, count)
 OO_STAT("Number of TCP window updates sent.",
         ci_uint32, wnd_updates_sent, count)
 OO_STAT("This means that Onload received a packet, and had to do something "
@@ -474,6 +593,9 @@ OO_STAT("Number of TCP segments received in-order when ROB is non-empty.  "
         "indicate a higher latency connection where packets had already "
         "been sent ahead of the re-ordering being detected.",
         ci_uint32, rx_rob_non_empty, count)
+OO_STAT("Number of in-order TCP segments whose payload was coalesced into "
+        "the packet at the tail of the receive queue (EF_TCP_RX_COALESCE).",
+        ci_uint32, rx_coalesced, count)
 OO_STAT("Number of TCP segments retransmited.",
         ci_uint32, retransmits, count)
 OO_STAT("Number of ACK packets not sent in response of invalid incoming TCP "
@@ -484,8 +606,14 @@ OO_STAT("Number of challenge ACKs sent (RFC 5961).",
 OO_STAT("Number of challenge ACKs not sent because of packet allocation "
         "failure.",
         ci_uint32, challenge_ack_out_of_pkts, count)
+OO_STAT("Number of packets whose transmission was delayed by stack TX "
+        "pacing (EF_TX_PACING_RATE).",
+        ci_uint32, tx_pace_delayed, count)
 OO_STAT("Number of deferred packets when next hop MAC address is not known.",
         ci_uint32, tx_defer_pkt, count)
+OO_STAT("Number of packets deferred while waiting for the control plane to "
+        "publish a route (see EF_CPLANE_NONBLOCK_RESOLVE).",
+        ci_uint32, tx_defer_pkt_resolve, count)
 OO_STAT("Number of deferred packets sent without any real delay.",
         ci_uint32, tx_defer_pkt_fast, count)
 OO_STAT("Number of deferred packets sent.",
@@ -507,6 +635,9 @@ OO_STAT("Number of RX discards (checksum bad).",
         ci_uint32, rx_discard_csum_bad, count)
 OO_STAT("Number of RX discards (inner checksum bad).",
         ci_uint32, rx_discard_inner_csum_bad, count)
+OO_STAT("Number of VXLAN-encapsulated frames decapsulated in software "
+        "(EF_VXLAN_PORT).",
+        ci_uint32, rx_vxlan_decap, count)
 OO_STAT("Number of RX discards (multicast mismatch).  On 7000 and newer, "
         "these will usually be discarded by the hardware; but some can get "
         "through if the socket was recently closed.",
@@ -526,9 +657,19 @@ OO_STAT("Number of RX discards (length error; "
         ci_uint32, rx_discard_len_err, count)
 OO_STAT("Number of RX discards (other).",
         ci_uint32, rx_discard_other, count)
+OO_STAT("Number of packets dropped by an application RX prefilter.  "
+        "See onload_rx_prefilter_set().",
+        ci_uint32, rx_prefilter_dropped, count)
+OO_STAT("Duplicate feed packets dropped by the A/B feed arbiter "
+        "(onload_feed_arbiter_set()).",
+        ci_uint32, rx_feed_dup_dropped, count)
 OO_STAT("Number of times we have refilled RX ring from recv() path.  This is "
         "a short-cut path used when in a low-memory situation.",
         ci_uint32, rx_refill_recv, count)
+OO_STAT("Number of polls that left the RX ring refill deferred because the "
+        "deficit had not yet reached the adaptive refill quantum.  See "
+        "EF_RX_REFILL_ADAPTIVE.",
+        ci_uint32, rx_refill_deferred, count)
 OO_STAT("Number of RX packets detected from the future.",
         ci_uint32, rx_future, count)
 OO_STAT("Number of RX packets detected from the future but contended.",
@@ -584,6 +725,10 @@ OO_STAT("Number of attempts to allocate packet buffer set which have failed "
         "unlikely for this to increment multiple times.  To resolve this, "
         "make huge pages available, or look into EF_PACKET_BUFFER_MODE.",
         ci_uint32, bufset_alloc_nospace, count)
+OO_STAT("Number of attempts to allocate a packet buffer set which have "
+        "failed because the host-wide shared packet buffer budget is "
+        "exhausted - see the shared_packets_max module option.",
+        ci_uint32, bufset_shared_limited, count)
 OO_STAT("Something has requested a larger MSS than we can support in a "
         "single packet buffer; so we've reduced it.  The maximum mss has "
         "multiple possibilities depending on card version.  "
@@ -615,6 +760,21 @@ OO_STAT("A UDP packet has arrived into the Onload stack, but it doesn't "
         "or the socket just closed (and there were already matching packets"
         "in the RX ring).",
         ci_uint32, udp_rx_no_match_drops, count)
+OO_STAT("Number of IPv4 UDP fragments taken into the in-stack reassembly "
+        "engine (EF_UDP_RX_REASSEMBLY).",
+        ci_uint32, udp_rx_frags, count)
+OO_STAT("Number of fragmented UDP datagrams reassembled in the stack and "
+        "delivered without a trip through the kernel.",
+        ci_uint32, udp_reasm_completed, count)
+OO_STAT("Fragmented UDP datagrams dropped by the reassembly engine: "
+        "overlapping or duplicate fragments, inconsistent lengths, too "
+        "many fragments, or a bad UDP checksum over the reassembled "
+        "payload.",
+        ci_uint32, udp_reasm_bad, count)
+OO_STAT("Reassembly contexts abandoned before the datagram completed "
+        "(timed out, evicted to make room, or flushed under memory "
+        "pressure).  Their fragments are handed to the kernel.",
+        ci_uint32, udp_reasm_abandoned, count)
 OO_STAT("We've been asked to free up a UDP socket (i.e. nothing references "
         "that fd any more) - but there are still some transmits waiting to "
         "complete.  The socket will be freed up once those transmits complete.",
@@ -633,6 +793,11 @@ OO_STAT("Number of times PIO was not used due to flags",
 # endif
 OO_STAT("Number of times PIO was not used due to an error",
         ci_uint32, no_pio_err, count)
+OO_STAT("Number of times the PIO region has been compacted to recover "
+        "contiguous space for templated sends",
+        ci_uint32, pio_compactions, count)
+OO_STAT("Number of templates relocated within the PIO region by compaction",
+        ci_uint32, pio_compact_moves, count)
 #endif
 #if CI_CFG_CTPIO
 OO_STAT("Number of times CTPIO has been used to send a packet",
@@ -660,6 +825,12 @@ OO_STAT("Number of loops spent in pipe read() code while busy-waiting",
         ci_uint64, spin_pipe_read, count)
 OO_STAT("Number of loops spent in pipe write() code while busy-waiting",
         ci_uint64, spin_pipe_write, count)
+OO_STAT("Number of wakeups delivered via the shared-memory futex doorbell "
+        "instead of the driver (EF_PIPE_FUTEX).",
+        ci_uint32, futex_wakes, count)
+OO_STAT("Number of TCP TX packet-buffer allocations refused because the "
+        "socket's isolation domain had reached EF_ISO_DOMAIN_PKTS.",
+        ci_uint32, iso_dom_refused, count)
 OO_STAT("Number of loops spent in TCP accept() code while busy-waiting",
         ci_uint64, spin_tcp_accept, count)
 OO_STAT("Number of loops spent in TCP connect() code while busy-waiting",
@@ -677,6 +848,18 @@ OO_STAT("Number of loops x sockets spent in epoll_wait() busy-waiting, "
         "with EF_UL_EPOLL=2",
         ci_uint64, spin_epoll_kernel, count)
 #endif
+#if CI_CFG_SPIN_CYCLE_STATS
+OO_STAT("Cycles spent in spin rounds in which a stack poll processed at "
+        "least one event.",
+        ci_uint64, spin_cycles_useful, count)
+OO_STAT("Cycles spent in spin rounds that found no new events.  A high "
+        "ratio of this to spin_cycles_useful means the spinning cores are "
+        "mostly idle despite appearing 100% busy to the OS.",
+        ci_uint64, spin_cycles_empty, count)
+OO_STAT("Cycles spent in spin rounds that wanted to poll the stack but "
+        "could not get the stack lock.",
+        ci_uint64, spin_cycles_lock_wait, count)
+#endif
 #if CI_CFG_FD_CACHING
 OO_STAT("Number of sockets cached over lifetime of the stack",
         ci_uint32, sockcache_cached, count)
@@ -708,6 +891,9 @@ OO_STAT("Number of times socket caching was successful.",
 OO_STAT("Socket cache failed due to lack of resources, reclaimed some, "
         "and then succeeded.",
         ci_uint32, sockcache_hit_reap, count)
+OO_STAT("Number of socket-cache hits where a reconnecting peer was given "
+        "back the cached endpoint its previous connection used.",
+        ci_uint32, sockcache_hit_samepeer, count)
 OO_STAT("Number of socket-cache misses due to mismatched interfaces",
         ci_uint32, sockcache_miss_intmismatch, count)
 OO_STAT("Number of active sockets cached over lifetime of the stack",
@@ -719,8 +905,19 @@ OO_STAT("Number of active-cache hits",
 OO_STAT("Number of active-cache hits after reaping",
         ci_uint32, activecache_hit_reap, count)
 #endif
+OO_STAT("Number of TCP state allocations satisfied from the pool of "
+        "pre-initialised state objects (EF_TCP_STATE_POOL).",
+        ci_uint32, tcp_state_pool_hit, count)
 OO_STAT("Number of times that cached endpoint had its fd forcecully detached.",
         ci_uint32, sock_attach_fd_detach, count)
+OO_STAT("Number of attempts to install a hardware filter for a socket.",
+        ci_uint32, hw_filter_set, count)
+OO_STAT("Number of hardware filter installs that failed for lack of space "
+        "in the NIC filter table.",
+        ci_uint32, hw_filter_nospc, count)
+OO_STAT("Number of connections kept accelerated behind the stack's scalable "
+        "filter after the NIC filter table filled (EF_FILTER_SPILL).",
+        ci_uint32, hw_filter_spill, count)
 OO_STAT("Number of times fd detach failed legitimately. ",
         ci_uint32, sock_attach_fd_detach_fail_soft, count)
 OO_STAT("Number of times fd detach failed unexpectedly. ",
@@ -767,12 +964,18 @@ OO_STAT("Number of TCP active-open sockets that used a shared local port",
         ci_uint32, tcp_shared_local_ports_used, count)
 OO_STAT("Number of times a TIME_WAIT was reused to use a shared local port",
         ci_uint32, tcp_shared_local_ports_reused_tw, count)
+OO_STAT("Number of times a shared local port was reused towards a peer "
+        "possibly still in TIME_WAIT, by choosing an ISN beyond the old "
+        "connection's final sequence number",
+        ci_uint32, tcp_shared_local_ports_reused_prev_seq, count)
 OO_STAT("Number of times the shared local port pool was grown",
         ci_uint32, tcp_shared_local_ports_grow, count)
 OO_STAT("Number of times an attempt to grow the shared local port pool failed",
         ci_uint32, tcp_shared_local_ports_grow_failed, count)
 OO_STAT("Number of times no active wild filter was available",
         ci_uint32, tcp_shared_local_ports_exhausted, count)
+OO_STAT("Number of packet buffers moved between sockets by onload_splice()",
+        ci_uint32, tcp_splice_pkts, count)
 OO_STAT("Number of times a socket from this stack was added to an epoll set "
         "with a different home stack.",
         ci_uint32, epoll_add_non_home, count)
@@ -79,6 +79,16 @@
 #define CI_CFG_USERSPACE_SYSCALL        0
 #endif
 
+/* Devirtualise the hot send/recv dispatch in the socket-call intercepts.
+ * When enabled, fds whose protocol is known at compile time (TCP and UDP
+ * sockets) are dispatched with direct calls instead of going through the
+ * protocol ops vtable, trading a pointer compare for the dependent
+ * indirect call.  Intended for sealed deployments where the small code
+ * size cost is acceptable; all other fd types still use the vtable. */
+#ifndef CI_CFG_STATIC_INTERCEPT
+#define CI_CFG_STATIC_INTERCEPT        0
+#endif
+
 /* Maximum number of onload stacks handled by single epoll object.
  * See also epoll_max_stacks module parameter.
  * Socket from other stacks will look just like "regular file descriptor"
@@ -105,6 +115,17 @@
 #define CI_CFG_SUPPORT_STATS_COLLECTION	1
 #define CI_CFG_TCP_SOCK_STATS           0
 
+/* Per-socket telemetry ring: records a (timestamp, event, value) entry in
+ * the socket's shared state for retransmits, RTO backoffs, congestion
+ * window changes on loss and zero-window probes.  Single writer (the stack
+ * lock holder), lock-free readers: a monitoring process that maps the
+ * stack read-only (e.g. onload_stackdump) can follow a connection's loss
+ * events at frc-timestamp resolution without attaching to the process.
+ * Costs CI_CFG_TCP_TELEM_RING_LEN * 16 + 8 bytes of each TCP socket's
+ * shared state; see the note against CI_CFG_EP_BUF_SIZE below. */
+#define CI_CFG_TCP_SOCK_TELEMETRY       0
+#define CI_CFG_TCP_TELEM_RING_LEN       8
+
 /* Enable this to cause buffered stats (from sockopt) to be output
  * to the log rather than written to a buffer */
 #define CI_CFG_SEND_STATS_TO_LOG        1
@@ -402,6 +423,12 @@
 */
 #define CI_CFG_TAIL_DROP_PROBE 1
 
+/* RACK (RFC 8985) time-based loss detection.  Complements the tail drop
+ * probe: detects loss from the transmit times of delivered segments
+ * rather than waiting for three dupacks or an RTO.
+ */
+#define CI_CFG_TCP_RACK 1
+
 /* Dump users of TCP and UDP sockets to a log file. */
 #define CI_CFG_LOG_SOCKET_USERS         0
 
@@ -438,6 +465,22 @@
 */
 #define CI_CFG_STATS_NETIF		1
 
+/* Number of entries in the per-stack flight recorder: a ring of compact
+** binary trace records in shared state, written lock-free from a few hot
+** sites (poll, TCP RX drops, stack-lock contention) and dumped by
+** "onload_stackdump flight_recorder", including post-mortem from an
+** orphaned stack.  Each entry is 16 bytes.  Must be a power of two;
+** define to 0 to compile the recorder out.
+*/
+#define CI_CFG_FLIGHT_RECORDER_ENTRIES  1024
+
+/* Number of sampled packet-header copies retained per drop reason (see
+** ci_netif_drop_sample()).  The RX drop sites record the first bytes of
+** dropped frames into per-reason rings, dumped by "onload_stackdump
+** drops".  Define to 0 to compile the sampling out.
+*/
+#define CI_CFG_DROP_SAMPLES_PER_REASON  4
+
 /* Per-netif statistics for spin rounds inside each operation.
  * It depends on CI_CFG_STATS_NETIF being on. */
 #ifdef NDEBUG
@@ -446,6 +489,15 @@
 #define CI_CFG_SPIN_STATS 1
 #endif
 
+/* Cycle-classified spin accounting: attribute time spent spinning to
+ * useful polls, empty spins and stack-lock waits.  Unlike the per-round
+ * counters above this is cheap enough (two additions per spin round,
+ * using a cycle count the spin loops read anyway) to leave enabled in
+ * production builds, where it feeds capacity planning: OS CPU accounting
+ * shows a spinning thread as 100% busy regardless of how much of that
+ * time does real work.  Depends on CI_CFG_STATS_NETIF being on. */
+#define CI_CFG_SPIN_CYCLE_STATS CI_CFG_STATS_NETIF
+
 /* Size of packet buffers.  Must be 2048 or 4096.  The larger value reduces
  * overhead when packets are large, but wastes memory when they aren't.
  */
@@ -480,6 +532,14 @@
 #define CI_CFG_DUMPQUEUE_LEN 128
 #endif /* CI_CFG_TCPDUMP */
 
+/* Wire-order RX delivery tap; see onload_rx_order_read() */
+#define CI_CFG_RX_ORDER_TAP 1
+
+#if CI_CFG_RX_ORDER_TAP
+/* Tap ring length, should be 2^x, x <= 16 */
+#define CI_CFG_RX_ORDER_TAP_LEN 512
+#endif /* CI_CFG_RX_ORDER_TAP */
+
 
 /* Support for reducing ACK rate at high throughput to improve efficiency */
 #define CI_CFG_DYNAMIC_ACK_RATE 1
@@ -551,7 +611,17 @@
 /* Handle incoming ICMP for Onloaded sockets */
 #define CI_CFG_HANDLE_ICMP 1
 
-/* Enable cooperation with the SmartNIC TCP reordering plugin */
+/* Enable cooperation with the SmartNIC TCP reordering plugin.
+ *
+ * Note that the "plugin" framework here (and the plugin-meta paths in
+ * netif_event.c) is NIC-resident application logic on SN1022-class
+ * devices: payload transforms execute on the NIC and the host sees their
+ * results via plugin metadata and the zero-copy APIs.  It is not a hook
+ * point for software per-socket payload transforms inside the stack.  A
+ * software transform (e.g. compression) must run before data enters the
+ * send queue, since the retransmit path resends exactly the queued bytes;
+ * apps wanting that without an extra copy should transform directly into
+ * zero-copy send buffers (onload_zc_send()). */
 #define CI_CFG_TCP_OFFLOAD_RECYCLER 0
 
 /* When using CI_CFG_TCP_OFFLOAD_RECYCLER, the number of additional VIs
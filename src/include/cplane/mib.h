@@ -485,9 +485,11 @@ struct cp_fwd_row {
   /* Version is the "data" version. Even version means that snapshot of data
    * at index 0 is to be read by clients, odd that the data under index 1.
    *
-   * When data changes, both copies are updated, one-after another.
-   * The version may be updated without any data change, for example for
-   * CICP_FWD_FLAG_STALE flag.
+   * When data changes, the inactive snapshot is rewritten in full and the
+   * version is bumped once, so the snapshot selected by any sampled
+   * version always holds a complete row.  The version may also be bumped
+   * without a logical data change (e.g. to force route rediscovery), in
+   * which case the current data is copied across first.
    */
   cp_version_t version CI_ALIGN(16);
   uint32_t flags;
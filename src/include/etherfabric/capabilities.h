@@ -176,6 +176,10 @@ enum ef_vi_capability {
   /** Filter on MAC + IPv4 protocol */
   EF_VI_CAP_RX_FILTER_MAC_IP4_PROTO,
 
+  /** Frames spanning several receive buffers can be collected with
+   ** ef_vi_receive_chain_event() */
+  EF_VI_CAP_RX_CHAINED_FRAMES,
+
   /** Maximum value of capabilities enumeration */
   EF_VI_CAP_MAX, /* Keep this last */
 };
@@ -899,6 +899,26 @@ struct ef_vi_tx_extra {
 **
 ** Users should not access this structure.
 */
+
+/*! \brief Known RX prefix layouts, for inline prefix parsing
+**
+** Selected when the virtual interface is initialized, according to the
+** NIC's capabilities, so that ef_vi_receive_prefix_pkt_len() and
+** ef_vi_receive_prefix_ticks() can parse the prefix with fixed-offset
+** loads and no indirection through the layout tables returned by
+** ef_vi_receive_query_layout().
+*/
+enum ef_vi_rx_prefix_fmt {
+  /** No prefix: packet data starts at offset 0 */
+  EF_VI_RX_PREFIX_FMT_NONE = 0,
+  /** EF10: 14-byte prefix, length at byte 8 */
+  EF_VI_RX_PREFIX_FMT_DZ = 1,
+  /** EF10: as above, plus timestamp minor ticks at byte 10 */
+  EF_VI_RX_PREFIX_FMT_DZ_TS = 2,
+  /** EF100: 14-bit length at the start of the prefix */
+  EF_VI_RX_PREFIX_FMT_GZ = 3,
+};
+
 typedef struct ef_vi {
   /** True if the virtual interface has been initialized */
   unsigned                      inited;
@@ -915,6 +935,8 @@ typedef struct ef_vi {
   unsigned                      rx_buffer_len;
   /** The length of the prefix at the start of a received packet */
   unsigned                      rx_prefix_len;
+  /** Bytes of headroom inserted before the RX prefix in receive buffers */
+  unsigned                      rx_headroom;
   /** efct: The last call to transmit_ctpio didn't have space; remember this
    * for the call to ctpio_fallback */
   uint8_t                       last_ctpio_failed;
@@ -926,6 +948,8 @@ typedef struct ef_vi {
   unsigned                      rx_pkt_len_offset;
   /** The mask of packet length in receive buffer */
   unsigned                      rx_pkt_len_mask;
+  /** The RX prefix layout; one of enum ef_vi_rx_prefix_fmt */
+  uint8_t                       rx_prefix_fmt;
   /** The timestamp correction (ns) for transmitted packets */
   int                           tx_ts_correction_ns;
   /** The timestamp format used by the hardware */
@@ -1018,6 +1042,20 @@ typedef struct ef_vi {
   /** mask to apply to unsol_credit_seq */
   uint32_t                      unsol_credit_seq_mask;
 
+  /** TX completion moderation threshold in descriptors; 0 disables
+  ** moderation.  See ef_vi_transmit_completion_moderation(). */
+  unsigned                      tx_compl_thresh;
+  /** TX completion moderation flush timeout, in cycle-counter ticks */
+  uint64_t                      tx_compl_timeout_ticks;
+  /** Deadline by which a held-back TX completion must be reported */
+  uint64_t                      tx_compl_deadline;
+  /** Descriptor id of the held-back TX completion */
+  uint32_t                      tx_compl_desc_id;
+  /** Queue label of the held-back TX completion */
+  uint32_t                      tx_compl_q_id;
+  /** Non-zero if a TX completion is currently held back */
+  int                           tx_compl_held;
+
   /*! \brief Driver-dependent operations. */
   /* Doxygen comment above is the detailed description of ef_vi::ops */
   struct ops {
@@ -1214,6 +1252,148 @@ ef_vi_inline int ef_vi_receive_prefix_len(const ef_vi* vi)
 }
 
 
+/* RX prefix field locations for the layouts in enum ef_vi_rx_prefix_fmt.
+** These match the hardware definitions; the library build asserts the
+** equivalence.
+*/
+/** Length of the EF10 (DZ) RX prefix */
+#define EF_VI_RX_PREFIX_DZ_LEN          14
+/** Offset of the RSS flow hash in the EF10 (DZ) RX prefix */
+#define EF_VI_RX_PREFIX_DZ_HASH_OFST    0
+/** Offset of the packet length in the EF10 (DZ) RX prefix */
+#define EF_VI_RX_PREFIX_DZ_PKTLEN_OFST  8
+/** Offset of the timestamp minor ticks in the EF10 (DZ) RX prefix */
+#define EF_VI_RX_PREFIX_DZ_TSTAMP_OFST  10
+/** Width of the packet length field in the EF100 (GZ) RX prefix */
+#define EF_VI_RX_PREFIX_GZ_LENGTH_BITS  14
+/** Offset of the RSS flow hash in the EF100 (GZ) RX prefix */
+#define EF_VI_RX_PREFIX_GZ_HASH_OFST    4
+
+
+/*! \brief Returns the RX prefix layout of a virtual interface
+**
+** \param vi The virtual interface to query.
+**
+** \return The layout of the prefix at the start of a received packet,
+**         as an enum ef_vi_rx_prefix_fmt value.
+**
+** Applications that know which adapter they run on can use this once at
+** start of day to select a per-layout parser
+** (eg. ef_vi_prefix_pkt_len_dz()) and avoid any per-packet dispatch.
+*/
+ef_vi_inline enum ef_vi_rx_prefix_fmt
+ef_vi_receive_prefix_fmt(const ef_vi* vi)
+{
+  return (enum ef_vi_rx_prefix_fmt) vi->rx_prefix_fmt;
+}
+
+
+/*! \brief Parse the packet length from an EF10 (DZ) RX prefix */
+ef_vi_inline unsigned ef_vi_prefix_pkt_len_dz(const void* pkt)
+{
+  const uint8_t* p = (const uint8_t*) pkt + EF_VI_RX_PREFIX_DZ_PKTLEN_OFST;
+  return (unsigned) p[0] | ((unsigned) p[1] << 8);
+}
+
+
+/*! \brief Parse the timestamp minor ticks from an EF10 (DZ) RX prefix */
+ef_vi_inline uint32_t ef_vi_prefix_ticks_dz(const void* pkt)
+{
+  const uint8_t* p = (const uint8_t*) pkt + EF_VI_RX_PREFIX_DZ_TSTAMP_OFST;
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+         ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+/*! \brief Parse the packet length from an EF100 (GZ) RX prefix */
+ef_vi_inline unsigned ef_vi_prefix_pkt_len_gz(const void* pkt)
+{
+  const uint8_t* p = (const uint8_t*) pkt;
+  return ((unsigned) p[0] | ((unsigned) p[1] << 8)) &
+         ((1u << EF_VI_RX_PREFIX_GZ_LENGTH_BITS) - 1);
+}
+
+
+/*! \brief Retrieve the packet length from a received packet's prefix
+**
+** \param vi  The virtual interface that received the packet.
+** \param pkt The first packet buffer of the received packet.
+**
+** \return The length of the received packet, in bytes.
+**
+** Inline equivalent of ef_vi_receive_get_bytes(): the prefix is parsed
+** with fixed-offset loads selected by the layout established at
+** initialization time.  Must only be called if
+** ef_vi_receive_prefix_len() is non-zero.
+*/
+ef_vi_inline unsigned ef_vi_receive_prefix_pkt_len(const ef_vi* vi,
+                                                   const void* pkt)
+{
+  if( vi->rx_prefix_fmt == EF_VI_RX_PREFIX_FMT_GZ )
+    return ef_vi_prefix_pkt_len_gz(pkt);
+  return ef_vi_prefix_pkt_len_dz(pkt);
+}
+
+
+/*! \brief Parse the RSS flow hash from an EF10 (DZ) RX prefix */
+ef_vi_inline uint32_t ef_vi_prefix_flow_hash_dz(const void* pkt)
+{
+  const uint8_t* p = (const uint8_t*) pkt + EF_VI_RX_PREFIX_DZ_HASH_OFST;
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+         ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+/*! \brief Parse the RSS flow hash from an EF100 (GZ) RX prefix */
+ef_vi_inline uint32_t ef_vi_prefix_flow_hash_gz(const void* pkt)
+{
+  const uint8_t* p = (const uint8_t*) pkt + EF_VI_RX_PREFIX_GZ_HASH_OFST;
+  return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+         ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+/*! \brief Retrieve the RSS flow hash from a received packet's prefix
+**
+** \param vi  The virtual interface that received the packet.
+** \param pkt The first packet buffer of the received packet.
+**
+** \return The flow hash the adapter computed for the received packet.
+**
+** The hash identifies the packet's flow without touching any packet
+** header, so it is available as soon as the event is decoded and can
+** drive flow-keyed lookups (or prefetches) ahead of demultiplexing.
+** Must only be called if ef_vi_receive_prefix_len() is non-zero.
+*/
+ef_vi_inline uint32_t ef_vi_receive_prefix_flow_hash(const ef_vi* vi,
+                                                     const void* pkt)
+{
+  if( vi->rx_prefix_fmt == EF_VI_RX_PREFIX_FMT_GZ )
+    return ef_vi_prefix_flow_hash_gz(pkt);
+  return ef_vi_prefix_flow_hash_dz(pkt);
+}
+
+
+/*! \brief Retrieve the timestamp minor ticks from a received packet's
+**         prefix
+**
+** \param vi  The virtual interface that received the packet.
+** \param pkt The first packet buffer of the received packet.
+**
+** \return The raw hardware timestamp (minor ticks) from the prefix.
+**
+** Must only be called if the layout is EF_VI_RX_PREFIX_FMT_DZ_TS.  To
+** convert the ticks to a time of day, use
+** ef_vi_receive_get_timestamp_with_sync_flags(), which also handles
+** clock synchronization status.
+*/
+ef_vi_inline uint32_t ef_vi_receive_prefix_ticks(const ef_vi* vi,
+                                                 const void* pkt)
+{
+  return ef_vi_prefix_ticks_dz(pkt);
+}
+
+
 /*! \brief Returns the length of a receive buffer
 **
 ** \param vi The virtual interface to query.
@@ -1260,6 +1440,83 @@ ef_vi_inline void ef_vi_receive_set_buffer_len(ef_vi* vi, unsigned buf_len)
 }
 
 
+/*! \brief Returns the RX buffer headroom for a virtual interface
+**
+** \param vi The virtual interface to query.
+**
+** \return The number of bytes of headroom inserted at the start of each
+**         receive buffer, as set by ef_vi_receive_set_headroom().
+*/
+ef_vi_inline unsigned ef_vi_receive_headroom(const ef_vi* vi)
+{
+  return vi->rx_headroom;
+}
+
+
+/*! \brief Sets the RX buffer headroom for a virtual interface
+**
+** \param vi       The virtual interface for which to set the headroom.
+** \param headroom The number of bytes of headroom to insert at the start
+**                 of each receive buffer.
+**
+** \return 0 on success, or a negative error code:\n
+**         -EOPNOTSUPP if the adapter or VI mode does not support headroom
+**         adjustment\n
+**         -EINVAL if the headroom is larger than a receive buffer.
+**
+** Requests that the adapter deliver received packets \p headroom bytes
+** beyond the address posted via ef_vi_receive_init() or
+** ef_vi_receive_post(). The headroom precedes the RX prefix (if any), so
+** the received packet starts at offset headroom +
+** ef_vi_receive_prefix_len() within the buffer. This can be used to place
+** the packet payload at a chosen alignment (see
+** ef_vi_receive_align_headroom()), or to reserve space for headers that
+** the application prepends before forwarding.
+**
+** The adapter may still write up to ef_vi_receive_buffer_len() bytes
+** starting at the adjusted address, so the application must either size
+** its buffers to cover the extra headroom bytes, or reduce the buffer
+** length accordingly with ef_vi_receive_set_buffer_len().
+**
+** The new headroom applies to buffers posted by subsequent calls to
+** ef_vi_receive_init() and ef_vi_receive_post(); buffers already posted
+** are unaffected.
+**
+** Supported for 7000, 8000 and X2-series adapters and for EF100, in
+** normal (non-packed-stream) mode. Not supported where the adapter or
+** kernel owns buffer placement (X3-series, AF_XDP).
+*/
+extern int ef_vi_receive_set_headroom(ef_vi* vi, unsigned headroom);
+
+
+/*! \brief Compute the headroom needed to align received payload
+**
+** \param vi             The virtual interface the buffers will be posted
+**                       to.
+** \param payload_offset Offset of the field to align from the start of
+**                       the received frame (eg. the sum of the Ethernet,
+**                       IP and TCP/UDP header lengths for L4 payload).
+** \param align          The required alignment, in bytes. Must be a power
+**                       of two.
+**
+** \return The smallest headroom such that, if receive buffers are posted
+**         at \p align -aligned DMA addresses, the byte at
+**         \p payload_offset within each received frame is \p align
+**         -aligned.
+**
+** Helper for use with ef_vi_receive_set_headroom(). It accounts for the
+** RX prefix length of this VI, so must be called after the VI is
+** allocated.
+*/
+ef_vi_inline unsigned ef_vi_receive_align_headroom(const ef_vi* vi,
+                                                   unsigned payload_offset,
+                                                   unsigned align)
+{
+  return (align - ((vi->rx_prefix_len + payload_offset) & (align - 1))) &
+         (align - 1);
+}
+
+
 /*! \brief Returns the amount of free space in the RX descriptor ring.
 **
 ** \param vi The virtual interface to query.
@@ -1546,6 +1803,81 @@ extern int ef_vi_receive_unbundle(ef_vi* ep, const ef_event* event,
 extern ef_request_id ef_vi_rxq_next_desc_id(ef_vi* vi);
 
 
+/*! \brief Maximum number of buffers a single chained frame can span. */
+#define EF_VI_RECEIVE_CHAIN_MAX_FRAGS 8
+
+
+/*! \brief State for collecting the fragments of a multi-buffer frame
+**
+** A frame that is larger than the receive buffer size (eg. a jumbo frame)
+** is delivered as a chain of buffers, each signalled by a separate RX
+** event carrying the EF_EVENT_FLAG_SOP and EF_EVENT_FLAG_CONT flags.
+** This structure accumulates one frame's worth of those fragments; see
+** ef_vi_receive_chain_event().
+**
+** One instance is needed per receive queue being chained.  Initialise it
+** with ef_vi_receive_chain_init() before feeding it events.
+*/
+typedef struct ef_vi_rx_chain {
+  /** DMA ids of the buffers holding the frame, in delivery order */
+  ef_request_id rq_ids[EF_VI_RECEIVE_CHAIN_MAX_FRAGS];
+  /** Number of bytes delivered to each buffer.  The first entry includes
+   ** the receive prefix, if any */
+  uint32_t      frag_bytes[EF_VI_RECEIVE_CHAIN_MAX_FRAGS];
+  /** Total bytes delivered so far, including the receive prefix */
+  uint32_t      total_bytes;
+  /** Number of fragments collected so far */
+  int           n_frags;
+  /** True while a frame is in progress (SOP seen, end not yet seen) */
+  int           in_frame;
+} ef_vi_rx_chain;
+
+
+/*! \brief Initialise a fragment-chaining state structure
+**
+** \param chain The chaining state to initialise.
+*/
+ef_vi_inline void ef_vi_receive_chain_init(ef_vi_rx_chain* chain)
+{
+  chain->total_bytes = 0;
+  chain->n_frags = 0;
+  chain->in_frame = 0;
+}
+
+
+/*! \brief Feed an RX event to a fragment chain
+**
+** \param vi    The virtual interface that raised the event.
+** \param ev    The event, of type EF_EVENT_TYPE_RX.
+** \param chain The chaining state for this receive queue.
+**
+** \return 1 when the event completes a frame, 0 when more fragments are
+**         expected, or a negative error code.
+**
+** Feed an RX event to a fragment chain.  This replaces the open-coded
+** SOP/CONT tracking that applications receiving jumbo frames previously
+** had to implement themselves.
+**
+** On a return of 1 the chain describes a complete frame: n_frags buffers
+** identified by rq_ids[], with frag_bytes[] giving the bytes delivered to
+** each.  Translating rq_ids to buffer addresses (and so building an
+** iovec) is up to the caller, since only the caller knows the mapping it
+** chose at ef_vi_receive_init() time.
+**
+** Returns -EPROTO if the event stream loses sync with the chain (for
+** example an unexpected SOP mid-frame, a discard event, or a frame
+** spanning more than EF_VI_RECEIVE_CHAIN_MAX_FRAGS buffers).  The chain
+** is reset; the caller should recycle any buffers it describes and
+** resume with the next SOP.
+**
+** The chained fragments arrive from consecutive descriptors, so this is
+** only meaningful for NICs with a descriptor-based receive queue; see
+** EF_VI_CAP_RX_CHAINED_FRAMES.
+*/
+extern int ef_vi_receive_chain_event(ef_vi* vi, const ef_event* ev,
+                                     ef_vi_rx_chain* chain);
+
+
 /*! \brief Set which errors cause an EF_EVENT_TYPE_RX_DISCARD event
 **
 ** \param vi                The virtual interface to configure.
@@ -1822,6 +2154,46 @@ extern int ef_vi_transmit_init(ef_vi* vi, ef_addr addr, int bytes,
   (vi)->ops.transmitv((vi), (iov), (iov_len), (dma_id))
 
 
+/*! \brief A single packet within a batch passed to ef_vi_transmitv_batch() */
+typedef struct {
+  /** Start of the iovec array describing the packet buffers */
+  const ef_iovec* iov;
+  /** Length of the iovec array */
+  int             iov_len;
+  /** DMA id to associate with the packet's final descriptor */
+  ef_request_id   dma_id;
+} ef_vi_tx_batch_entry;
+
+
+/*! \brief Transmit a batch of packets, ringing the doorbell once
+**
+** \param vi     The virtual interface from which to transmit.
+** \param pkts   Array of packets to transmit.
+** \param n_pkts Number of packets in the array.
+**
+** \return The number of packets queued for transmit on success, or a
+**         negative error code:\n
+**         -EAGAIN if no packets could be queued because the descriptor
+**         ring is full.
+**
+** Transmit a batch of packets. This initializes a TX descriptor on the TX
+** descriptor ring for each buffer of each packet, and then submits the
+** whole batch to the NIC with a single doorbell write.
+**
+** This is equivalent to calling ef_vi_transmitv_init() for each packet
+** followed by a single ef_vi_transmit_push(), but is more convenient when
+** a batch of packets is already assembled. Amortizing the doorbell over
+** the batch substantially reduces the per-packet cost of PCIe writes for
+** small packets.
+**
+** If the ring fills part way through the batch, the packets queued so far
+** are pushed and their count is returned; the caller should retry the
+** remainder after harvesting TX completions.
+*/
+extern int ef_vi_transmitv_batch(ef_vi* vi, const ef_vi_tx_batch_entry* pkts,
+                                 int n_pkts);
+
+
 /*! \brief Transmit a packet already resident in Programmed I/O
 **
 ** \param vi     The virtual interface from which to transmit.
@@ -2011,6 +2383,42 @@ extern int ef_vi_transmit_unbundle(ef_vi* ep, const ef_event* event,
                                    ef_request_id* ids);
 
 
+/*! \brief Moderate delivery of TX completion events
+**
+** \param vi           The virtual interface to configure.
+** \param n_descs      Report a completion once at least this many
+**                     descriptors have completed.  Must not exceed
+**                     EF_VI_TRANSMIT_BATCH.  0 disables moderation.
+** \param timeout_usec Report any outstanding completion no later than
+**                     this many microseconds after the first swallowed
+**                     completion event.
+**
+** \return 0 on success, or a negative error code:\n
+**         -EINVAL if the parameters are out of range, or the virtual
+**         interface uses TX timestamps, TX alternatives or CTPIO\n
+**         -EOPNOTSUPP if the virtual interface's architecture does not
+**         support moderation.
+**
+** By default every TX completion event raised by the adapter is reported
+** to the application.  With moderation enabled the event poll absorbs
+** completion events until either [n_descs] descriptors have completed or
+** [timeout_usec] microseconds have passed since the first absorbed event,
+** whichever comes first, and then reports a single cumulative
+** EF_EVENT_TYPE_TX event.  This reduces event-processing load for bulk
+** senders at the cost of completion latency; buffers for swallowed sends
+** are not reusable until the cumulative completion is reported.
+**
+** A pending completion whose timeout has expired is reported by the next
+** call to ef_eventq_poll(), so an application that stops transmitting
+** must keep polling to collect its final completions.
+**
+** This is a software mechanism implemented in the event poll and is
+** currently only available on EF10 architecture adapters.
+*/
+extern int ef_vi_transmit_completion_moderation(ef_vi* vi, int n_descs,
+                                                int timeout_usec);
+
+
 /*! \brief Return the number of TX alternatives allocated for a virtual
 ** interface.
 **
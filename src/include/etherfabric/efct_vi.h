@@ -114,6 +114,64 @@ efct_vi_rxpkt_get_timestamp(struct ef_vi* vi, uint32_t pkt_id,
 **/
 extern void efct_vi_rxpkt_release(struct ef_vi* vi, uint32_t pkt_id);
 
+/*! \brief A received packet, as returned by \a efct_vi_rx_peek_batch */
+typedef struct {
+  /** Pointer to the packet data, typically the first byte of the Ethernet
+   ** header.  Valid until the packet is released. */
+  const void* data;
+  /** Identifier for use with the \a efct_vi_rxpkt_* functions */
+  uint32_t    pkt_id;
+  /** Length of the frame */
+  uint16_t    len;
+  /** Zero for a good packet, otherwise the EF_VI_DISCARD_RX_* flags which
+   ** would have caused an RX_REF_DISCARD event */
+  uint16_t    discard_flags;
+} efct_rx_pkt_info;
+
+/*! \brief Retrieve a batch of received packets in a single call
+**
+** \param vi   The virtual interface to poll.
+** \param qid  Index of the receive queue to poll, as reported in the
+**             \a q_id field of this VI's receive events.
+** \param pkts Array in which to return packet details.
+** \param n    Length of the \a pkts array.
+**
+** \return The number of packets retrieved.
+**
+** This is an alternative to \a ef_eventq_poll for receive-only, high
+** packet rate applications: it consumes completed packets directly from
+** the receive queue, without the per-packet event handling, and returns
+** the data pointer and length for each so that \a efct_vi_rxpkt_get need
+** not be called.  Packets which would have produced an RX_REF_DISCARD
+** event are returned with \a discard_flags set.
+**
+** A single call never crosses a superbuf boundary, so all packets in a
+** batch may be released together with \a efct_vi_rxpkt_release_batch.
+** Each packet retrieved must be released exactly once, either in a batch
+** or individually via \a efct_vi_rxpkt_release.
+**
+** This function polls only the given receive queue: it does not process
+** transmit completions or other events, so \a ef_eventq_poll must still
+** be called when \a ef_eventq_has_event indicates that work is pending.
+** It cannot be mixed with \a ef_eventq_poll calls that would consume
+** packets from the same queue.
+*/
+extern int efct_vi_rx_peek_batch(struct ef_vi* vi, int qid,
+                                 efct_rx_pkt_info* pkts, int n);
+
+/*! \brief Release a batch of received packets' buffers after use
+**
+** \param vi      The virtual interface which received the packets.
+** \param pkt_ids Array of valid packet identifiers.
+** \param n       Number of identifiers in the array.
+**
+** Equivalent to calling \a efct_vi_rxpkt_release for each identifier in
+** order, but runs of packets from the same superbuf are released with a
+** single refcount operation.
+*/
+extern void efct_vi_rxpkt_release_batch(struct ef_vi* vi,
+                                        const uint32_t* pkt_ids, int n);
+
 /*! \brief Detect incoming packets before completion
 **
 ** \param vi    The virtual interface to check for incoming packets.
@@ -0,0 +1,152 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/**************************************************************************\
+*//*! \file
+** \author    Advanced Micro Devices, Inc.
+** \brief     NIC-to-NIC packet forwarding engine for ef_vi.
+** \date      2026/08/30
+*//*
+\**************************************************************************/
+
+#ifndef __EFAB_FORWARD_H__
+#define __EFAB_FORWARD_H__
+
+#include <etherfabric/ef_vi.h>
+#include <etherfabric/pd.h>
+#include <etherfabric/memreg.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*! \brief A forwarding engine moves packets between two interfaces with
+** zero-copy buffer handoff.
+**
+** Every packet buffer is registered with both protection domains through
+** a shared memory region, so a buffer filled by RX DMA on one interface
+** is handed straight to TX DMA on the other without a copy.  Descriptor
+** recycling is batched: TX completions return buffers to a LIFO free
+** pool and RX rings are refilled in batches from it.
+**
+** The caller drives the engine by calling ef_fwd_engine_poll() in a
+** tight loop, optionally rewriting or dropping packets via a callback.
+*/
+
+/*! \brief Rewrite callback.
+**
+** Invoked for each received packet before it is queued for transmit.
+** [pkt] points at the start of the Ethernet frame and may be modified in
+** place; up to EF_FWD_PKT_BUF_SPACE bytes may be written.  [rx_port] is
+** the index (0 or 1) of the interface the packet arrived on.
+**
+** Return the (possibly changed) frame length to forward the packet, or a
+** negative value to drop it.
+*/
+typedef int (*ef_fwd_rewrite_fn)(void* pkt, int len, int rx_port, void* arg);
+
+/*! \brief Only forward from the first interface to the second. */
+#define EF_FWD_F_UNIDIRECTIONAL  0x1
+/*! \brief Do not install all-traffic filters; the caller adds its own
+** filters to the VIs returned by ef_fwd_engine_vi(). */
+#define EF_FWD_F_NO_FILTERS      0x2
+/*! \brief Use batched RX event merging (EF_VI_RX_EVENT_MERGE).  Improves
+** packet rate on adapters that support it. */
+#define EF_FWD_F_RX_MERGE        0x4
+
+/*! \brief Bytes available for frame data in each packet buffer. */
+#define EF_FWD_PKT_BUF_SPACE     1792
+
+struct ef_fwd_pkt_buf;
+
+/*! \brief Per-interface state of a forwarding engine. */
+typedef struct ef_fwd_port {
+  /** Driver handle */
+  ef_driver_handle   fwd_dh;
+  /** Protection domain */
+  ef_pd              fwd_pd;
+  /** Virtual interface */
+  ef_vi              fwd_vi;
+  /** Packet buffer memory registered with this port's PD */
+  ef_memreg          fwd_memreg;
+  /** Number of TX descriptors initialised but not yet pushed */
+  unsigned           fwd_tx_pending;
+  /** Packets received on this port */
+  uint64_t           fwd_n_rx_pkts;
+  /** Packets dropped because the peer TX ring was full */
+  uint64_t           fwd_n_tx_full_drops;
+  /** Packets dropped by hardware discard or the rewrite callback */
+  uint64_t           fwd_n_drops;
+} ef_fwd_port;
+
+/*! \brief A NIC-to-NIC forwarding engine. */
+typedef struct ef_fwd_engine {
+  /** The two forwarded interfaces */
+  ef_fwd_port            fwd_port[2];
+  /** Packet buffer memory shared by both ports */
+  void*                  fwd_pkt_mem;
+  /** Size of the packet buffer memory */
+  size_t                 fwd_pkt_mem_size;
+  /** Whether the packet buffer memory came from mmap() */
+  int                    fwd_pkt_mem_is_mmap;
+  /** Number of packet buffers */
+  int                    fwd_n_pkt_bufs;
+  /** LIFO pool of free packet buffers */
+  struct ef_fwd_pkt_buf* fwd_free_pool;
+  /** Number of buffers in the free pool */
+  int                    fwd_free_pool_n;
+  /** Optional rewrite callback */
+  ef_fwd_rewrite_fn      fwd_rewrite;
+  /** Opaque argument for the rewrite callback */
+  void*                  fwd_rewrite_arg;
+  /** EF_FWD_F_* flags */
+  unsigned               fwd_flags;
+} ef_fwd_engine;
+
+
+/*! \brief Initialise a forwarding engine over two interfaces.
+**
+** \param fwd     The engine to initialise.
+** \param intf_a  Name of the first interface (e.g. "eth2").
+** \param intf_b  Name of the second interface.
+** \param flags   EF_FWD_F_* flags.
+**
+** \return 0 on success, or a negative error code.
+**
+** Allocates both VIs, registers a shared packet buffer region with both
+** protection domains, pre-fills the RX rings and (unless
+** EF_FWD_F_NO_FILTERS) steers all unicast and multicast traffic to the
+** receiving VIs.
+*/
+extern int ef_fwd_engine_init(ef_fwd_engine* fwd, const char* intf_a,
+                              const char* intf_b, unsigned flags);
+
+/*! \brief Release all resources held by a forwarding engine. */
+extern void ef_fwd_engine_free(ef_fwd_engine* fwd);
+
+/*! \brief Set or clear (fn == NULL) the rewrite callback. */
+extern void ef_fwd_engine_set_rewrite(ef_fwd_engine* fwd,
+                                      ef_fwd_rewrite_fn fn, void* arg);
+
+/*! \brief One polling pass over both interfaces.
+**
+** Handles RX, TX-complete and discard events, queues received packets on
+** the opposite interface, pushes pending TX descriptors and refills the
+** RX rings.  Call in a tight loop.
+**
+** \return The number of packets forwarded in this pass.
+*/
+extern int ef_fwd_engine_poll(ef_fwd_engine* fwd);
+
+/*! \brief The VI of port [port_i] (0 or 1), for adding filters or reading
+** statistics with the usual ef_vi calls. */
+ef_vi_inline ef_vi* ef_fwd_engine_vi(ef_fwd_engine* fwd, int port_i)
+{
+  return &fwd->fwd_port[port_i].fwd_vi;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __EFAB_FORWARD_H__ */
@@ -428,6 +428,41 @@ extern int ef_vi_alloc_from_set(ef_vi* vi, ef_driver_handle vi_dh,
 extern int ef_vi_prime(ef_vi* vi, ef_driver_handle dh, unsigned current_ptr);
 
 
+/*! \brief Query the interrupt servicing a virtual interface
+**
+** \param vi      The virtual interface to query.
+** \param dh      The ef_driver_handle associated with the virtual
+**                interface.
+** \param irq_out Updated on return with the absolute IRQ number.
+**
+** \return 0 on success, or a negative error code:\n
+**         -EOPNOTSUPP if interrupts for this adapter are managed by the
+**         net driver rather than by the ef_vi driver.
+**
+** Report the IRQ that fires when this virtual interface's event queue is
+** primed.  Together with ef_vi_irq_affinity() this allows deployment
+** tooling to co-locate the interrupt, the thread polling the virtual
+** interface, and the adapter's NUMA node.
+*/
+extern int ef_vi_get_irq(ef_vi* vi, ef_driver_handle dh, unsigned* irq_out);
+
+
+/*! \brief Bind a virtual interface's interrupt to a CPU
+**
+** \param vi  The virtual interface whose interrupt is to be bound.
+** \param dh  The ef_driver_handle associated with the virtual interface.
+** \param cpu The CPU to deliver the interrupt to.
+**
+** \return 0 on success, or a negative error code.
+**
+** Set the affinity of the interrupt servicing this virtual interface's
+** event queue.  Note that the underlying interrupt vector can be shared
+** with other virtual interfaces on the same adapter, in which case their
+** interrupt delivery moves too.
+*/
+extern int ef_vi_irq_affinity(ef_vi* vi, ef_driver_handle dh, int cpu);
+
+
 /**********************************************************************
  * ef_filter **********************************************************
  **********************************************************************/
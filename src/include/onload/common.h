@@ -152,6 +152,17 @@ typedef struct {
   ci_ifid_t         ifindex;
 } oo_tcp_filter_mcast_t;
 
+/* Max multicast groups programmed by one OO_IOC_EP_FILTER_MCAST_ADD_BATCH
+ * ioctl; user-level loops over larger subscriptions. */
+#define OO_MCAST_BATCH_MAX 32
+
+typedef struct {
+  oo_sp             tcp_id;
+  ci_ifid_t         ifindex;
+  ci_uint32         count;    /* in: groups supplied; out: groups added */
+  ci_uint32         addrs[OO_MCAST_BATCH_MAX];
+} oo_tcp_filter_mcast_batch_t;
+
 typedef struct {
   ci_user_ptr_t buf;
   ci_int32      buf_len;
@@ -169,6 +180,16 @@ typedef struct {
   oo_sp         	new_ep_id;
 } oo_tcp_move_state_t;
 
+/* Batched cross-stack socket move.  [fds] and [rcs] point at user arrays
+ * of [n] entries; rcs[i] is written with the result of moving fds[i], so
+ * the caller gets a per-socket completion even when the batch partially
+ * fails. */
+typedef struct {
+  ci_user_ptr_t fds;            /* ci_int32[n]: sockets to move */
+  ci_user_ptr_t rcs;            /* ci_int32[n]: per-socket result */
+  ci_int32      n;
+} oo_move_fd_batch_t;
+
 typedef struct {
   ci_int32      level;
   ci_int32      optname;
@@ -217,9 +238,14 @@ typedef struct {
   ci_uint64 base_ptr;
   ci_uint64 num_pages;
   ci_uint64 hw_addrs_ptr;
+  ci_uint64 flags;      /* OO_ZC_REGISTER_BUFFERS_* */
   ci_uint64 id;
 } oo_zc_register_buffers_t;
 
+/* The region is a transmit source only, so the pages need not be mapped
+ * writable (eg. a read-only mmap'd file). */
+#define OO_ZC_REGISTER_BUFFERS_SEND_ONLY  0x1
+
 typedef struct {
   ci_fixed_descriptor_t rfd, wfd;   /* OUT for Unix */
   oo_sp                 ep_id;
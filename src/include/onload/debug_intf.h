@@ -163,6 +163,7 @@ typedef struct {
 #define __CI_DEBUG_OP_NETIF_CONFIG_OPTS_DUMP__ (17)
 #define __CI_DEBUG_OP_STACK_TIME__ (18)
 #define __CI_DEBUG_OP_VI_INFO__ (19)
+#define __CI_DEBUG_OP_FLIGHT_RECORDER__ (20)
 
   ci_uint32			what;		/* which operation */
 
@@ -0,0 +1,89 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* A sockets-free library API over the Onload TCP engine.
+ *
+ * This gives applications the transport/ip TCP state machine without the
+ * socket-call intercept, fdtable and syscall-compat layers in
+ * transport/unix.  A stack is created explicitly, connections are plain
+ * handles rather than file descriptors, and receive readiness is
+ * delivered by callback from od_stack_poll().
+ *
+ * Threading model: a stack and its connections may be used from multiple
+ * threads (the engine's own locking applies), but callbacks run on the
+ * thread that calls od_stack_poll().
+ *
+ * Limitations: active-open IPv4 connections only.  Listening sockets,
+ * accelerated loopback (EF_TCP_CLIENT_LOOPBACK) and connections that the
+ * engine would hand over to the kernel stack are not supported and fail
+ * with EOPNOTSUPP.
+ */
+
+#ifndef __ONLOAD_DIRECT_H__
+#define __ONLOAD_DIRECT_H__
+
+#include <sys/socket.h>
+#include <poll.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct od_stack;
+struct od_conn;
+
+/* Event bits passed to the connection handler are POLLIN/POLLOUT/POLLERR/
+ * POLLHUP with their usual meanings. */
+typedef void (*od_conn_handler_fn)(struct od_conn* conn, void* arg,
+                                   int events);
+
+/* Initialise the library.  Must be called once, before any other call,
+ * and before any threads are created.  Reads the usual EF_* environment
+ * variables for stack configuration.  Returns 0 or negative error. */
+extern int od_init(void);
+
+/* Create (or attach to) an Onload stack.  [name] may be NULL or "" for an
+ * anonymous stack.  Returns 0 or negative error. */
+extern int od_stack_alloc(const char* name, struct od_stack** stack_out);
+
+/* Destroy a stack handle.  All connections must have been closed. */
+extern void od_stack_free(struct od_stack* stack);
+
+/* Poll the stack for network events and invoke the handler of every
+ * connection that has pending events.  Returns the number of handler
+ * invocations, so a spinning caller can detect idleness. */
+extern int od_stack_poll(struct od_stack* stack);
+
+/* Create a connection and connect it.  Blocks until the handshake
+ * completes unless OD_CONN_F_NONBLOCK is given, in which case completion
+ * is signalled by a POLLOUT event.  Returns 0 or negative error. */
+#define OD_CONN_F_NONBLOCK  0x1
+extern int od_conn_connect(struct od_stack* stack,
+                           const struct sockaddr* sa, socklen_t sa_len,
+                           unsigned conn_flags,
+                           od_conn_handler_fn handler, void* handler_arg,
+                           struct od_conn** conn_out);
+
+/* Send on a connection.  [flags] takes MSG_* send flags (MSG_DONTWAIT,
+ * MSG_MORE, ...).  Returns bytes queued, or -1 with errno set, exactly
+ * like send(). */
+extern ssize_t od_conn_send(struct od_conn* conn, const void* buf,
+                            size_t len, int flags);
+
+/* Receive from a connection without blocking.  Returns bytes received,
+ * 0 at end-of-stream, or -1 with errno set (EAGAIN when no data). */
+extern ssize_t od_conn_recv(struct od_conn* conn, void* buf, size_t len);
+
+/* Current event mask for the connection (same bits as the handler gets),
+ * without polling the stack. */
+extern int od_conn_events(struct od_conn* conn);
+
+/* Close and free a connection.  Any unsent data is flushed by the stack
+ * as for close() on a socket. */
+extern void od_conn_close(struct od_conn* conn);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* __ONLOAD_DIRECT_H__ */
@@ -43,13 +43,46 @@ __ef_eplock_lock_slow(ci_netif *, long tiemout, int maybe_wedged) CI_HF;
 
 #if defined(CI_HAVE_COMPARE_AND_SWAP)
 
-  /*! Attempt to lock an eplock.  Returns true on success. */
+  /*! Attempt to lock an eplock.  Returns true on success.  Fails while a
+  ** poll-priority thread is spinning for the lock, so that thread wins
+  ** the handoff.
+  */
 ci_inline int ef_eplock_trylock(ci_eplock_t* l) {
   ci_uint64 v = l->lock;
-  return !(v & CI_EPLOCK_LOCKED) &&
+  return !(v & (CI_EPLOCK_LOCKED | CI_EPLOCK_FL_POLL_PRIO)) &&
     ci_cas64u_succeed(&l->lock, v, v | CI_EPLOCK_LOCKED);
 }
 
+  /*! As ef_eplock_trylock(), for the poll-priority thread itself: takes
+  ** the lock regardless of CI_EPLOCK_FL_POLL_PRIO, clearing it.
+  */
+ci_inline int ef_eplock_trylock_poll_prio(ci_eplock_t* l) {
+  ci_uint64 v = l->lock;
+  return !(v & CI_EPLOCK_LOCKED) &&
+    ci_cas64u_succeed(&l->lock, v,
+                      (v &~ CI_EPLOCK_FL_POLL_PRIO) | CI_EPLOCK_LOCKED);
+}
+
+  /*! Assert or withdraw this thread's claim to the next lock handoff.
+  ** Only the poll-priority thread may call these; the claim may be lost
+  ** to a racing unlock in the driver, so it must be re-asserted while
+  ** spinning.
+  */
+ci_inline void ef_eplock_poll_prio_set(ci_eplock_t* l) {
+  ci_uint64 v = l->lock;
+  if( ! (v & CI_EPLOCK_FL_POLL_PRIO) )
+    (void) ci_cas64u_succeed(&l->lock, v, v | CI_EPLOCK_FL_POLL_PRIO);
+}
+
+ci_inline void ef_eplock_poll_prio_clear(ci_eplock_t* l) {
+  ci_uint64 v;
+  do {
+    v = l->lock;
+    if( ! (v & CI_EPLOCK_FL_POLL_PRIO) )
+      return;
+  } while( ci_cas64u_fail(&l->lock, v, v &~ CI_EPLOCK_FL_POLL_PRIO) );
+}
+
   /* Always returns 0 (success) at userland.  Returns -EINTR if interrupted
    * when invoked in kernel.  So return value *must* be checked when
    * invoked in kernel, else risk of proceeding without the lock held.
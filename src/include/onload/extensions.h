@@ -15,6 +15,8 @@
 #define __ONLOAD_EXTENSIONS_H__
 
 #include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <stdint.h>
 #include <onload/extensions_timestamping.h>
 
@@ -208,6 +210,30 @@ extern int onload_thread_set_spin(enum onload_spin_type type, int spin);
  *  bitmask of the spin settings */
 extern int onload_thread_get_spin(unsigned* state);
 
+/**********************************************************************
+ * onload_thread_set_poll_priority: Give this thread priority for the
+ * stack lock.
+ *
+ * In applications where one thread is responsible for polling the stack
+ * and others mostly send, the poll thread can lose the stack lock to
+ * other waiting threads each time the holder releases it, delaying
+ * receive processing for the whole stack.  A thread with poll priority
+ * claims the next lock handoff whenever it waits for the stack lock:
+ * while it is spinning, other threads' opportunistic lock attempts
+ * stand aside (their deferrable work is still handled by the eventual
+ * lock holder, as usual).
+ *
+ * The priority is best-effort and applies while the priority thread is
+ * spinning for the lock; it cannot pre-empt a thread that already holds
+ * the lock, and threads blocked in the kernel ignore it, so forward
+ * progress is preserved even if the priority thread dies.  At most one
+ * thread per stack should be given poll priority; with more than one
+ * they compete as normal among themselves.
+ *
+ * Returns 0 on success.
+ */
+extern int onload_thread_set_poll_priority(int enable);
+
 /**********************************************************************
  * onload_fd_check_feature : Check whether or not a feature is supported
  *
@@ -250,6 +276,46 @@ extern int onload_fd_check_feature(int fd, enum onload_fd_feature feature);
  */
 extern int onload_move_fd(int fd);
 
+/**********************************************************************
+ * onload_move_fd_batch: Move several file descriptors to the current
+ * stack in one driver call.
+ *
+ * Equivalent to calling onload_move_fd() on each entry of fds, but the
+ * whole batch is handed to the driver in a single system call, which
+ * matters when handing many hot connections over to another stack at
+ * rate.  The same socket-state limitations as onload_move_fd() apply to
+ * each entry.
+ *
+ * rcs must have room for n entries; rcs[i] is written with the result of
+ * moving fds[i] (0 on success, negative error otherwise), so one failed
+ * move does not abort the rest of the batch.
+ *
+ * Returns 0 if the batch was processed (inspect rcs for the per-socket
+ * results), negative error otherwise.
+ */
+extern int onload_move_fd_batch(const int* fds, int* rcs, int n);
+
+
+/**********************************************************************
+ * onload_socket_isolation_domain: Assign a socket to an isolation
+ * domain within its stack.
+ *
+ * Sockets sharing a stack can be grouped into isolation domains for
+ * packet-buffer accounting: when the EF_ISO_DOMAIN_PKTS environment
+ * variable is set, each domain may hold at most that many transmit
+ * packet buffers, so a stalled or misbehaving group of sockets cannot
+ * starve the rest of the stack of buffers.
+ *
+ * domain must be between 0 and 7 inclusive.  Domain 0 is the default
+ * and is never limited.  The assignment affects buffers allocated after
+ * the call; buffers the socket already holds remain charged to their
+ * original domain until freed.
+ *
+ * Returns 0 on success, negative error otherwise (-ENOTTY if fd is not
+ * an Onload socket, -EINVAL if domain is out of range).
+ */
+extern int onload_socket_isolation_domain(int fd, int domain);
+
 
 /**********************************************************************
  * onload_ordered_epoll_wait: Wire order delivery via epoll
@@ -285,6 +351,177 @@ int onload_ordered_epoll_wait(int epfd, struct epoll_event *events,
                               int maxevents, int timeout);
 
 
+/**********************************************************************
+ * onload_epoll_set_priority: per-fd poll frequency while spinning
+ *
+ * When epoll_wait() spins (EF_POLL_USEC etc.) all accelerated members of
+ * the set are polled on every spin iteration.  For sets that mix a few
+ * latency-critical sockets with many mostly-idle ones, this call lets the
+ * idle ones be scanned less often: a member with priority N is polled on
+ * every Nth spin pass only.  Priority 1 (the default for all members)
+ * polls on every pass.
+ *
+ * The first poll pass of each epoll_wait() call always polls every
+ * member, so a non-spinning call and event delivery when blocking are
+ * unaffected.  The setting is per-membership and is forgotten when the fd
+ * is removed from the set.  It has no effect on non-accelerated members,
+ * which the kernel polls, or on members in the epoll set's home stack,
+ * which are polled only when ready.
+ *
+ * This function can only be used if EF_UL_EPOLL=1, which is the default.
+ *
+ * Returns 0 on success, or a negative error code: -EINVAL for a bad
+ * priority, -EBADF if fd is not accelerated, -ENOENT if fd is not a
+ * member of the epoll set.
+ */
+int onload_epoll_set_priority(int epfd, int fd, int priority);
+
+
+/**********************************************************************
+ * onload_epoll_ctl_batch: apply several epoll_ctl() ops in one call
+ *
+ * Applies an array of EPOLL_CTL_ADD/MOD/DEL operations to an epoll set
+ * under a single acquisition of the set's lock.  For applications that
+ * add and remove many fds per second this avoids taking and dropping the
+ * lock (and contending with concurrent epoll_wait() callers) once per
+ * fd.  With EF_EPOLL_CTL_FAST=1 (the default) membership changes for
+ * accelerated fds are also synced to the kernel lazily, so a batch
+ * typically makes no per-fd system calls at all.
+ *
+ * Each operation's result is returned in its rc field: 0 on success or a
+ * negative error code, as for epoll_ctl().  Operations are applied in
+ * order and a failure does not stop later operations.  The events and
+ * data fields correspond to the members of struct epoll_event and are
+ * ignored for EPOLL_CTL_DEL.
+ *
+ * This function can only be used if EF_UL_EPOLL=1, which is the default.
+ *
+ * Returns the number of operations that succeeded, or a negative error
+ * code: -EINVAL for a bad ops array or count, -ENOTSUP if epfd is not a
+ * user-level epoll set.
+ */
+
+struct onload_epoll_ctl_op {
+  int op;          /* EPOLL_CTL_ADD, EPOLL_CTL_MOD, EPOLL_CTL_DEL */
+  int fd;
+  uint32_t events; /* epoll_event.events; ignored for EPOLL_CTL_DEL */
+  uint64_t data;   /* epoll_event.data; ignored for EPOLL_CTL_DEL */
+  int rc;          /* out: result of this operation */
+};
+
+int onload_epoll_ctl_batch(int epfd, struct onload_epoll_ctl_op* ops,
+                           int n_ops);
+
+
+/**********************************************************************
+ * onload_epoll_timer_arm: a user-space timer on an epoll set
+ *
+ * Arms a timer belonging to the epoll set itself.  When it expires, an
+ * epoll_wait() on the set returns an EPOLLIN event whose data field
+ * carries the 64-bit [data] value.  The timer is serviced entirely at
+ * user level: a spinning epoll_wait() (EF_POLL_USEC etc.) notices expiry
+ * from the timestamps it already takes on each spin iteration, so a
+ * firing timer costs no syscall and does not break the spin streak the
+ * way waking a timerfd through the kernel set does.  A blocking
+ * epoll_wait() clamps its wait to the deadline, so expiry is on time
+ * there too.
+ *
+ * timeout_us is the relative time to the first expiry and must be
+ * positive.  If interval_us is non-zero the timer re-arms itself on each
+ * expiry for periodic operation; otherwise it is one-shot.  An epoll set
+ * has one timer, and arming it replaces any previous deadline.  The
+ * timer is checked, and its event delivered, only inside epoll_wait()
+ * calls on this set.
+ *
+ * Timerfd fds continue to work in an epoll set, but via the kernel; for
+ * event loops whose timers only drive the epoll_wait() timeout this call
+ * replaces the timerfd entirely.
+ *
+ * This function can only be used if EF_UL_EPOLL=1, which is the default.
+ *
+ * Returns 0 on success, or a negative error code: -EINVAL for a bad
+ * timeout or interval, -ENOTSUP if epfd is not a user-level epoll set.
+ *
+ * onload_epoll_timer_cancel() disarms the timer.  It returns 0, or
+ * -ENOENT if the timer was not armed.
+ */
+int onload_epoll_timer_arm(int epfd, int64_t timeout_us, int64_t interval_us,
+                           uint64_t data);
+int onload_epoll_timer_cancel(int epfd);
+
+
+/**********************************************************************
+ * onload_rx_order_read: consume the per-stack wire-order RX event tap
+ *
+ * When EF_RX_ORDER_TAP=1, every payload delivery to a TCP or UDP receive
+ * queue in the stack also appends a record to a per-stack ring, in the
+ * order the stack delivered the data, which is NIC arrival order.  This
+ * gives applications that merge multiple feeds in wire order a streaming
+ * alternative to onload_ordered_epoll_wait(), with no per-batch
+ * timestamp sort or second readiness scan.
+ *
+ * fd identifies the stack: it may be any accelerated socket in it.  Up
+ * to n records are copied into events, oldest first.  endpoint_id
+ * matches the endpoint_id reported by onload_fd_stat() for the receiving
+ * socket.  bytes is the payload newly made readable; out-of-order TCP
+ * data produces a single record when the hole is filled.  hw_stamp is
+ * the NIC arrival time of the (last) packet, or zero if hardware receive
+ * timestamps are not enabled.  dropped returns the number of records
+ * lost so far to ring overflow, and may be NULL.
+ *
+ * The ring supports a single reader; concurrent callers must serialise
+ * among themselves.  Records are emitted as data is delivered to the
+ * receive queue, which for TCP can be ahead of what recv() will return
+ * until the stack is polled.
+ *
+ * Returns the number of records copied (0 if none are pending), or a
+ * negative error code: -EINVAL for a bad array or count, -ESOCKTNOSUPPORT
+ * if fd is not an accelerated socket, -ENOTSUP if the tap is not enabled
+ * for the stack.
+ */
+
+struct onload_rx_order_event {
+  int32_t  endpoint_id;    /* onload_fd_stat() endpoint_id of the socket */
+  uint32_t bytes;          /* payload bytes delivered */
+  struct timespec hw_stamp;/* NIC arrival time; zero if unstamped */
+};
+
+int onload_rx_order_read(int fd, struct onload_rx_order_event* events,
+                         int n, uint32_t* dropped);
+
+
+/**********************************************************************
+ * onload_stack_eventfd: batched readiness notification via an eventfd.
+ *
+ * Attaches an eventfd to the Onload stack that accelerates the socket
+ * [fd].  Whenever a stack poll performed by this process makes one or
+ * more endpoints ready (readable, writable or in error), Onload makes a
+ * single write to the eventfd for the whole batch, adding the number of
+ * endpoints that became ready to the eventfd counter.  This lets an
+ * io_uring- or eventfd-driven event loop wait on the eventfd instead of
+ * running a thread to translate readiness events one at a time.
+ *
+ * The counter value is a hint and may over-state the number of distinct
+ * endpoints that became ready.  Detail of what became ready remains in
+ * the stack's shared state: poll the sockets in the usual way, or
+ * combine with EF_RX_ORDER_TAP and onload_rx_order_read() to learn
+ * which endpoints received data and how much.
+ *
+ * The association is process-local: only stack polls performed by the
+ * calling process signal the eventfd, so the eventfd should be attached
+ * by the process that polls the stack (normally the process using the
+ * sockets).  Create the eventfd with EFD_NONBLOCK so that a saturated
+ * counter cannot block the stack's poll path.
+ *
+ * Pass [evfd] of -1 to detach the bridge.
+ *
+ * Returns 0 on success;
+ *  -EINVAL if evfd is less than -1
+ *  -ESOCKTNOSUPPORT if fd is not an accelerated socket
+ */
+int onload_stack_eventfd(int fd, int evfd);
+
+
 /**********************************************************************
  * onload_delegated_send: send via EF_VI to the Onload-managed TCP connection
  *
@@ -602,6 +839,146 @@ extern int
 onload_delegated_send_cancel(int fd);
 
 
+/**********************************************************************
+ * onload_udp_send_batch: send a batch of datagrams to pre-registered
+ * destinations.
+ *
+ * onload_udp_dest_register() registers a destination address against an
+ * accelerated, unconnected UDP socket and returns a non-negative slot
+ * index.  Onload keeps a per-slot copy of the resolved route and the
+ * Ethernet/IP/UDP header template, so that a send to a registered
+ * destination does not repeat route resolution or header construction
+ * even when sends alternate between destinations (which defeats the
+ * socket's own single-entry destination cache).  Registrations belong to
+ * the calling process and are forgotten when the socket is closed; there
+ * is no way to unregister a slot.  Returns -EINVAL for a bad address,
+ * -EAFNOSUPPORT for a family the socket cannot send to, or -ENOSPC when
+ * the per-socket slot limit is reached.
+ *
+ * onload_udp_send_batch() sends one datagram per entry.  Each entry names
+ * a slot returned by onload_udp_dest_register() and supplies the payload
+ * as a single iovec; the payload is copied into Onload packet buffers as
+ * with ordinary send calls.  Entries are processed in order and each
+ * entry's rc field is set to the number of bytes sent or a negative
+ * errno.  Processing stops at the first failing entry.  Returns the
+ * number of entries sent successfully; if the first entry fails, returns
+ * its negative errno.  flags take the same values as send().
+ *
+ * Sending on the same socket from another thread while a batch is in
+ * flight is not supported.
+ *
+ * Both functions return -ENOTTY if the socket is not accelerated by
+ * Onload.
+ */
+extern int
+onload_udp_dest_register(int fd, const struct sockaddr* addr,
+                         socklen_t addrlen);
+
+struct onload_udp_send_batch_entry {
+  int dest;              /* slot from onload_udp_dest_register() */
+  struct iovec iov;      /* payload of one datagram */
+  int rc;                /* filled on return: bytes sent or -errno */
+};
+
+extern int
+onload_udp_send_batch(int fd, struct onload_udp_send_batch_entry* entries,
+                      int n, int flags);
+
+/* onload_udp_fanout_send() sends one datagram to several registered
+ * destinations.  The payload described by [iov] is copied out of user
+ * memory into packet buffers once; per-destination packets are built by
+ * cloning only the headers and sharing the payload buffers by reference,
+ * so the payload bytes cross memory once however many destinations are
+ * named.  [dests] is an array of [n_dests] slots returned by
+ * onload_udp_dest_register(), or NULL to send to every registered slot
+ * (in which case pass the number of registered slots, or 0 for all).
+ *
+ * The datagram must fit in a single IP packet (no fragmentation), and
+ * local multicast loopback delivery (IP_MULTICAST_LOOP with
+ * EF_MCAST_SEND including local delivery) forces a slower path; in these
+ * and other unsupported cases the datagram is sent with one internal
+ * sendmsg per destination instead, with identical on-the-wire results.
+ *
+ * Returns the payload length in bytes on success.  Delivery to each
+ * destination is best-effort, as for any UDP send; if packet buffers run
+ * out mid-fanout the remaining destinations are dropped (counted in the
+ * socket's fanout_drop stat).  Returns -EINVAL for bad arguments and
+ * -ENOTTY if the socket is not accelerated by Onload.
+ */
+extern int
+onload_udp_fanout_send(int fd, const struct iovec* iov, int iovlen,
+                       const int* dests, int n_dests, int flags);
+
+
+/**********************************************************************
+ * onload_cq: submission/completion rings for socket operations
+ *
+ * An onload_cq batches socket operations behind a submission ring and a
+ * completion harvest, in the style of an io_uring: the application
+ * queues operations with onload_cq_submit() - which performs no fd
+ * lookups, locking or I/O - and later calls onload_cq_harvest(), which
+ * enters the Onload library once and attempts every pending operation,
+ * writing a completion entry per finished operation.  This amortizes
+ * the per-call library entry, signal deferral and fd-table lookups that
+ * individual send()/recv()/accept() calls each pay, and gives event
+ * loops already structured around completion queues a native adapter.
+ *
+ * Operations are attempted in submission order and never block: an
+ * operation that cannot make progress (the equivalent call would return
+ * EAGAIN) stays pending and is retried on the next harvest, so a recv
+ * can be submitted before data arrives.  Completion order therefore
+ * follows readiness, not submission; use user_data to correlate.  For
+ * ONLOAD_CQ_OP_ACCEPT the listening socket must be nonblocking,
+ * otherwise harvest can block in the accept call.
+ *
+ * The fds may be Onload or kernel sockets; operations on kernel sockets
+ * complete with -ESOCKTNOSUPPORT.  An onload_cq may only be used by one
+ * thread at a time.
+ *
+ * onload_cq_submit() returns the number of entries queued, which is
+ * less than [n] only when the ring fills.  onload_cq_harvest() returns
+ * the number of completions written to [cqes], up to [max]; pending
+ * operations beyond [max] completions are left for the next harvest.
+ */
+
+enum onload_cq_op {
+  ONLOAD_CQ_OP_SEND,    /* send(fd, buf, len, flags) */
+  ONLOAD_CQ_OP_RECV,    /* recv(fd, buf, len, flags) */
+  ONLOAD_CQ_OP_ACCEPT,  /* accept4(fd, NULL, NULL, flags) */
+};
+
+struct onload_cq_sqe {
+  uint64_t user_data;   /* opaque, copied to the completion */
+  int32_t  fd;
+  uint16_t op;          /* enum onload_cq_op */
+  uint16_t spare;       /* must be zero */
+  void*    buf;         /* payload buffer; unused for ACCEPT */
+  uint32_t len;         /* payload length; unused for ACCEPT */
+  uint32_t flags;       /* MSG_* flags; SOCK_* flags for ACCEPT */
+};
+
+struct onload_cq_cqe {
+  uint64_t user_data;
+  int32_t  res;         /* bytes transferred / accepted fd, or -errno */
+  uint32_t flags;       /* reserved, set to 0 */
+};
+
+struct onload_cq;
+
+extern int
+onload_cq_create(unsigned sq_entries, struct onload_cq** cq_out);
+
+extern int
+onload_cq_destroy(struct onload_cq* cq);
+
+extern int
+onload_cq_submit(struct onload_cq* cq, const struct onload_cq_sqe* sqes,
+                 int n);
+
+extern int
+onload_cq_harvest(struct onload_cq* cq, struct onload_cq_cqe* cqes, int max);
+
+
 /**********************************************************************
  * onload_get_tcp_info: Onload-specific call similar to Linux TCP_INFO
  *
@@ -709,6 +1086,321 @@ onload_socket_nonaccel(int domain, int type, int protocol);
 extern int
 onload_socket_unicast_nonaccel(int domain, int type, int protocol);
 
+
+/**********************************************************************
+ * onload_rx_prefilter_set: process-wide early receive filter
+ *
+ * This installs a callback that is invoked once per received packet
+ * during stack polls performed by this process, before any protocol
+ * processing or socket demultiplexing.  It allows an application to
+ * discard traffic it knows it does not want - for example the bulk of
+ * an unfiltered multicast feed - before the packet touches socket
+ * receive queues and their cache lines.
+ *
+ * The callback is passed a pointer to the start of the Ethernet frame
+ * and the frame length in bytes.  For frames spanning multiple packet
+ * buffers only the first buffer's bytes are contiguous at [frame];
+ * the protocol headers always lie within the first buffer.  Return
+ * ONLOAD_RX_PREFILTER_PASS to deliver the packet normally, or
+ * ONLOAD_RX_PREFILTER_DROP to free it immediately.
+ *
+ * The callback runs on the critical packet-processing path with the
+ * stack lock held.  It must not block and must not call back into
+ * Onload or the socket API.
+ *
+ * Polls of the stack performed by other processes, or by the kernel
+ * on the application's behalf, do not run the callback, so dropping
+ * is best-effort: the application must tolerate occasional delivery
+ * of packets the filter would have dropped.  This is not a security
+ * mechanism; use XDP programs (see EF_XDP_MODE) when every packet
+ * must be inspected.
+ *
+ * Passing a NULL callback uninstalls the filter.  Install the filter
+ * before traffic starts if other threads may be polling the stack.
+ *
+ * Returns 0 on success, or -ENOSYS if the onload extensions library
+ * is not in use.
+ */
+
+enum onload_rx_prefilter_verdict {
+  ONLOAD_RX_PREFILTER_PASS,
+  ONLOAD_RX_PREFILTER_DROP,
+};
+
+typedef enum onload_rx_prefilter_verdict
+(*onload_rx_prefilter_callback)(void* cb_arg, const void* frame,
+                                int frame_len);
+
+extern int
+onload_rx_prefilter_set(onload_rx_prefilter_callback filter, void* cb_arg);
+
+
+/**********************************************************************
+ * onload_feed_arbiter_set: in-stack A/B feed arbitration
+ *
+ * Applications consuming a redundant market-data feed subscribe the
+ * same stream on two (or more) interfaces and traditionally
+ * de-duplicate by sequence number themselves, touching every packet
+ * twice.  The feed arbiter moves that work into the stack poll loop:
+ * the extractor callback recovers the feed's sequence number from a
+ * received frame, and the stack delivers only the first copy of each
+ * sequence number to the socket, dropping the losing arm's duplicate
+ * before it reaches socket receive queues.
+ *
+ * The extractor is invoked once per received packet, before protocol
+ * processing, with a pointer to the start of the Ethernet frame and
+ * the frame length.  It should return 0 and fill *seq_out for frames
+ * belonging to the arbitrated feed, or non-zero for any other frame,
+ * which is then delivered normally.  Like the prefilter callback it
+ * runs on the critical path under the stack lock: it must not block
+ * or call back into Onload.
+ *
+ * Arbitration tracks a single expected sequence number.  A frame
+ * whose sequence is below it is dropped as a duplicate; one at or
+ * above it is delivered, a jump being counted as a gap (i.e. a
+ * sequence range no arm supplied, or reordering beyond the arbiter's
+ * tolerance - it keeps no reorder buffer).  Counters of deliveries
+ * won per interface, duplicates dropped and gaps are available from
+ * onload_feed_arbiter_get_stats(); wins[] is indexed by the stack's
+ * interface index, so with one subscription per NIC the two arms'
+ * win counts can be compared directly.
+ *
+ * Only polls performed by this process arbitrate.  Polls by other
+ * processes or by the kernel deliver packets unchecked, so the
+ * application must still tolerate occasional duplicates.
+ *
+ * Passing a NULL extractor uninstalls the arbiter and resets its
+ * sequence state.  Both functions return 0 on success, or -ENOSYS if
+ * the onload extensions library is not in use.
+ */
+
+#define ONLOAD_FEED_ARBITER_MAX_ARMS 8
+
+struct onload_feed_arbiter_stats {
+  /* Packets delivered first by each interface, indexed by the stack's
+   * interface index. */
+  uint64_t wins[ONLOAD_FEED_ARBITER_MAX_ARMS];
+  uint64_t duplicates_dropped;
+  uint64_t gaps;
+};
+
+typedef int (*onload_feed_seq_extractor)(void* cb_arg, const void* frame,
+                                         int frame_len, uint64_t* seq_out);
+
+extern int
+onload_feed_arbiter_set(onload_feed_seq_extractor extract, void* cb_arg);
+
+extern int
+onload_feed_arbiter_get_stats(struct onload_feed_arbiter_stats* stats);
+
+
+/**********************************************************************
+ * onload_socket_watermarks_set: memory-pressure notification
+ *
+ * When a stack's packet pool runs low, behaviour degrades globally:
+ * allocations stall and packets are dropped.  Watermarks let an
+ * application discover the pressure building and shed load before the
+ * stack does it for it.  Per socket, three thresholds can be set (in
+ * packet buffers; 0 disables a threshold):
+ *
+ *   sendq_pkts     - the socket's send plus retransmit queues exceed
+ *                    this many buffers (ONLOAD_WATERMARK_SENDQ);
+ *   rcvq_pkts      - the socket's receive queue exceeds this many
+ *                    buffers (ONLOAD_WATERMARK_RCVQ);
+ *   pool_free_pkts - the stack's free packet pool falls below this
+ *                    many buffers (ONLOAD_WATERMARK_POOL).
+ *
+ * Thresholds are evaluated once per stack poll.  When one is crossed
+ * the corresponding flag latches and the socket is woken, so a thread
+ * blocked on it in epoll_wait()/poll()/select() returns through the
+ * normal readiness path.  onload_socket_watermarks_query() retrieves
+ * and clears the latched flags; while a flag remains latched no
+ * further wakeups are generated for it, so wakeup rate is bounded by
+ * the application's query cadence.  Note the wakeup itself carries no
+ * distinct event: a level-triggered poller simply re-reports the
+ * socket's actual readiness, and the query call is what identifies
+ * the pressure.
+ *
+ * Thresholds saturate at 65535 packet buffers.  Passing all-zero
+ * thresholds deregisters the socket.  Both functions return 0 on
+ * success, -ENOTTY if the fd is not an Onload socket, or -ENOSYS if
+ * the extensions library is not in use.
+ */
+
+#define ONLOAD_WATERMARK_SENDQ  0x1
+#define ONLOAD_WATERMARK_RCVQ   0x2
+#define ONLOAD_WATERMARK_POOL   0x4
+
+struct onload_socket_watermarks {
+  uint32_t sendq_pkts;
+  uint32_t rcvq_pkts;
+  uint32_t pool_free_pkts;
+};
+
+extern int
+onload_socket_watermarks_set(int fd,
+                             const struct onload_socket_watermarks* wm);
+
+extern int
+onload_socket_watermarks_query(int fd, unsigned* fired_out);
+
+
+/**********************************************************************
+ * onload_stack_clock_get: the stack's disciplined clock
+ *
+ * Onload timestamps events with the CPU timestamp counter (frc) and
+ * converts to wall-clock time using a clock page the driver
+ * disciplines against the system clock (which is in turn typically
+ * PTP-disciplined against the NIC clock).  This call reads a coherent
+ * snapshot of that page for the stack owning [fd], letting an
+ * application convert its own frc readings into the same timebase the
+ * stack's timestamps use, with no per-message clock_gettime() calls:
+ *
+ *   wall(frc) = wall_base + (frc - frc_base) * frc_ns / frc_ticks
+ *
+ * frc_ticks counter ticks elapse in frc_ns nanoseconds (a smoothed
+ * rate estimate; divide late to preserve precision).  max_error_ns
+ * bounds the error of such conversions, from the driver's observed
+ * prediction error; generation advances on each resync, so a cached
+ * snapshot can be revalidated cheaply.
+ *
+ * Returns 0 on success, -ENOTTY if the fd is not an Onload socket, or
+ * -ENOSYS if the extensions library is not in use.
+ */
+
+struct onload_stack_clock {
+  uint64_t frc_base;      /* counter reading at the baseline */
+  uint64_t frc_ticks;     /* frc_ticks of the counter elapse... */
+  uint64_t frc_ns;        /* ...in frc_ns nanoseconds */
+  uint64_t wall_sec;      /* CLOCK_REALTIME at the baseline */
+  uint32_t wall_nsec;
+  uint32_t generation;    /* advances on each resync */
+  uint64_t max_error_ns;  /* bound on conversion error */
+};
+
+extern int
+onload_stack_clock_get(int fd, struct onload_stack_clock* clock_out);
+
+
+/**********************************************************************
+ * onload_udp_mcast_join_batch: bulk multicast subscription
+ *
+ * Join [count] multicast groups on the given interface through the
+ * Onload socket [fd], as if by one IP_ADD_MEMBERSHIP setsockopt() per
+ * group, but with the hardware filters and software demux state
+ * programmed in batches inside the driver rather than one ioctl per
+ * group.  For feed handlers subscribing to thousands of groups at
+ * startup this removes most of the per-group syscall and filter-table
+ * locking overhead.  [groups] is an array of IPv4 group addresses in
+ * network byte order; [ifindex] must be nonzero and identify an
+ * accelerated interface.
+ *
+ * Groups are joined in array order.  Returns the number of groups
+ * joined; groups beyond the returned count are not joined at all (on
+ * the OS socket or in hardware), so a caller can retry or fall back
+ * from that index.  Returns a negative error if no group could be
+ * joined: -EINVAL for a bad argument, -ENOTTY if the fd is not an
+ * Onload UDP socket, -EOPNOTSUPP if the stack's configuration does not
+ * accelerate multicast receive, or -ENOSYS if the extensions library
+ * is not in use.
+ */
+extern int
+onload_udp_mcast_join_batch(int fd, int ifindex, int count,
+                            const uint32_t* groups);
+
+
+/**********************************************************************
+ * onload_socket_recv_framing: whole-frame delivery for onload_zc_recv
+ *
+ * Describes the length-prefixed framing of the byte stream carried by
+ * the TCP socket [fd], so that subsequent onload_zc_recv() calls
+ * deliver only complete frames.  Each frame starts with a fixed header
+ * of [hdr_len] bytes containing a length field of [len_width] bytes
+ * (1, 2, 4 or 8) at byte offset [len_offset]; the field is read
+ * big-endian if [len_nbo] is nonzero, little-endian otherwise, and
+ * [len_adjust] is added to its value to obtain the total frame length
+ * including the header (so a field counting payload bytes only takes
+ * len_adjust == hdr_len).
+ *
+ * With a descriptor set, onload_zc_recv() callbacks never see a
+ * partial frame: data is held in the stack's receive queue until the
+ * whole frame has arrived, and delivery stops at the last complete
+ * frame boundary, which may fall mid-packet.  A frame spanning several
+ * packets is delivered through consecutive callback invocations within
+ * one onload_zc_recv() call, so the application needs no reassembly
+ * buffer of its own.  When the last complete frame boundary falls
+ * mid-packet, that delivery's iovec carries ONLOAD_ZC_HANDLE_NONZC
+ * rather than a buffer handle: the rest of the packet is still owned by
+ * the receive queue, so the data is valid only for the duration of the
+ * callback and ONLOAD_ZC_KEEP does not retain it.  If a decoded frame
+ * length is smaller than the
+ * header (the stream is not framed as described), framed delivery is
+ * abandoned with a log message and the socket reverts to unframed
+ * delivery rather than stalling.
+ *
+ * The descriptor only affects receives performed by the process that
+ * set it.  Pass NULL to return the socket to unframed delivery.  Do not
+ * combine with MSG_PEEK or ONLOAD_MSG_ONEPKT, which operate on raw
+ * packet boundaries.  Returns 0 on success, -EINVAL for an invalid
+ * descriptor, -ENOTTY if [fd] is not an Onload TCP socket, or -ENOSYS
+ * if the extensions library is not in use.
+ */
+struct onload_recv_framing {
+  uint16_t hdr_len;     /* fixed header length, bytes; max 255 */
+  uint8_t  len_offset;  /* offset of length field within header */
+  uint8_t  len_width;   /* width of length field: 1, 2, 4 or 8 */
+  uint8_t  len_nbo;     /* nonzero: length field is big-endian */
+  int32_t  len_adjust;  /* field value + len_adjust = frame length */
+};
+
+extern int
+onload_socket_recv_framing(int fd, const struct onload_recv_framing* framing);
+
+
+/**********************************************************************
+ * ONLOAD_TCP_RX_STEER: per-connection receive steering
+ *
+ * A socket option for use with setsockopt() at the IPPROTO_TCP level.
+ * Takes an int for the optval: nonzero requests that this connection's
+ * received packets be delivered via an exact-match hardware filter
+ * pointing at the stack that owns the socket, 0 (the default) accepts
+ * the stack-wide configuration.
+ *
+ * This only changes behaviour for stacks using scalable filters
+ * (EF_SCALABLE_FILTERS), where connections normally share the stack's
+ * MAC or RSS filter and a flow's receive queue is chosen by hash.
+ * Opting a hot connection out of the shared filter pins its receive
+ * processing to the VI polled by the socket's owning thread, avoiding
+ * a cross-core handoff per packet.  It consumes one hardware filter
+ * entry per connection, so use it selectively.
+ *
+ * May be set before connecting, or on an established connection, in
+ * which case the hardware filter is installed immediately; that can
+ * fail with ENOBUFS if the filter table is full.
+ */
+#define ONLOAD_TCP_RX_STEER  47430
+
+/*
+ * ONLOAD_UDP_RX_MAILBOXES: per-thread receive mailboxes
+ *
+ * A socket option for use with setsockopt()/getsockopt() at the
+ * IPPROTO_UDP level.  Takes an int for the optval: a value of 2 or more
+ * (up to 4) splits the socket's receive queue into that many mailboxes,
+ * and 0 (the default) restores a single queue.
+ *
+ * With mailboxes enabled the stack poll loop distributes received
+ * datagrams round-robin across the mailboxes, and each reader thread
+ * claims a free mailbox for the duration of its call, so threads
+ * sharing one socket (e.g. a consumer group on a multicast feed) do
+ * not serialise on a single receive queue.  Datagram ordering is
+ * preserved within a mailbox but not across mailboxes.
+ *
+ * May only be changed while the socket has no queued datagrams.  The
+ * SO_RCVBUF limit applies to each mailbox independently.  Not supported
+ * in conjunction with onload_zc_recv() or onload_set_recv_filter().
+ */
+#define ONLOAD_UDP_RX_MAILBOXES  47431
+
 #endif /* ONLOAD_INCLUDE_DS_DATA_ONLY */
 
 #ifdef __cplusplus
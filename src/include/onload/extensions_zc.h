@@ -277,6 +277,43 @@ struct onload_zc_recv_args {
 extern int onload_zc_recv(int fd, struct onload_zc_recv_args *args);
 
 
+/* onload_zc_recv_many drains a set of sockets in a single call,
+ * amortizing the library entry, fd table lookups and stack polling that
+ * per-socket onload_zc_recv() calls would each pay separately.  The first
+ * socket to find its receive queue empty polls the stack, delivering
+ * packets for every socket in it, so later sockets in the set normally
+ * just dequeue.
+ *
+ * The args structure is used exactly as for onload_zc_recv(), except that
+ * args->cb is ignored; cb is invoked instead, with the additional fd
+ * argument identifying the socket that received the data.  The fds are
+ * drained in order and each socket is treated as if ONLOAD_MSG_DONTWAIT
+ * were set; the call never blocks.
+ *
+ * Each socks[i].rc is set to the result of draining socks[i].fd: 0 on
+ * success, -EAGAIN if the socket had no data, or another error as for
+ * onload_zc_recv().  If the callback returns ONLOAD_ZC_TERMINATE then no
+ * further sockets are processed.
+ *
+ * Returns the number of sockets processed (i.e. with rc set), or <0 to
+ * indicate an error before any socket was processed.
+ */
+
+struct onload_zc_recv_many_sock {
+  int fd;
+  int rc;
+};
+
+typedef enum onload_zc_callback_rc
+(*onload_zc_recv_many_callback)(struct onload_zc_recv_args *args, int fd,
+                                int flags);
+
+extern int onload_zc_recv_many(struct onload_zc_recv_many_sock* socks,
+                               int n_socks,
+                               struct onload_zc_recv_args* args,
+                               onload_zc_recv_many_callback cb);
+
+
 /* Use onload_recvmsg_kernel() to access packets delivered by
  * kernel/OS rather than Onload, when onload_zc_recv() returns
  * -ENOTEMPTY
@@ -343,9 +380,34 @@ extern int onload_recvmsg_kernel(int fd, struct msghdr *msg, int flags);
 extern int onload_zc_send(struct onload_zc_mmsg* msgs, int mlen, int flags);
 
 
+/* onload_delegated_send_complete_zc is a zero-copy variant of
+ * onload_delegated_send_complete (see extensions.h).  Instead of
+ * copying the completed payload out of application memory it takes
+ * ownership of Onload packet buffers that already contain it, so the
+ * retransmit queue is populated without a data copy.
+ *
+ * Each iovec must reference a buffer allocated with
+ * onload_zc_alloc_buffers() on the same stack as the socket, with
+ * iov_len no larger than the socket's effective MSS; one packet
+ * buffer becomes one TCP segment.  The payload must match what was
+ * transmitted via the delegated (e.g. ef_vi or PIO) path.
+ *
+ * On success returns the number of bytes completed and ownership of
+ * all buffers passes to Onload; they must not be subsequently used by
+ * the application.  On failure returns -1 with errno set and the
+ * application retains ownership of all buffers; in particular EAGAIN
+ * indicates a transient shortage of send queue space, and the caller
+ * may retry or fall back to onload_delegated_send_complete().
+ *
+ * ONLOAD_MSG_WARM is not supported by this function.
+ */
+extern int onload_delegated_send_complete_zc(int fd,
+                                             const struct onload_zc_iovec* iov,
+                                             int iovlen, int flags);
+
 
 /******************************************************************************
- * Receive filtering 
+ * Receive filtering
  ******************************************************************************/
 
 /*
@@ -377,11 +439,62 @@ typedef enum onload_zc_callback_rc
 (*onload_zc_recv_filter_callback)(struct onload_zc_msg *msg, void* arg, 
                                   int flags);
 
-extern int onload_set_recv_filter(int fd, 
+extern int onload_set_recv_filter(int fd,
                                   onload_zc_recv_filter_callback filter,
                                   void* cb_arg, int flags);
 
 
+/*
+ * onload_set_recv_filter_chain() installs a chain of match predicates
+ * which Onload evaluates against each received datagram's payload on
+ * the poll path, before the datagram is queued on the socket.  This
+ * replaces the deprecated callback form above: because the chain is
+ * plain data rather than application code it runs while the payload is
+ * still cache-hot, including when the stack is polled from another
+ * thread or from the kernel, and its verdict can discard datagrams
+ * that the application does not want to see.
+ *
+ * Each rule compares up to eight bytes of the payload: the onzcfr_len
+ * bytes starting at onzcfr_offset are read in wire order into the
+ * least significant bytes of a 64-bit value, masked with onzcfr_mask
+ * and compared against onzcfr_value.  A datagram matches the chain if
+ * every rule matches.  A rule that refers to bytes beyond the end of
+ * the datagram, or beyond its first packet buffer (i.e. beyond the
+ * first 1500-odd bytes of a jumbo datagram), does not match.
+ *
+ * By default matching datagrams are delivered and all others are
+ * dropped before they are queued.  With
+ * ONLOAD_ZC_RECV_FILTER_CHAIN_DROP_MATCH the sense is inverted:
+ * matching datagrams are dropped and all others delivered.  Dropped
+ * datagrams are counted in the socket's rcv filter_drop statistic.
+ *
+ * Passing rules_len of zero removes any installed chain.  At most
+ * ONLOAD_ZC_RECV_FILTER_RULES_MAX rules may be installed, and
+ * onzcfr_reserved must be zero in each rule.
+ *
+ * This function is currently only supported for UDP sockets, and like
+ * onload_set_recv_filter() requires the socket to be accelerated.  It
+ * should not be used in conjunction with onload_set_recv_filter().
+ */
+
+#define ONLOAD_ZC_RECV_FILTER_RULES_MAX  8
+
+#define ONLOAD_ZC_RECV_FILTER_CHAIN_DROP_MATCH  0x1
+
+struct onload_zc_recv_filter_rule {
+  uint16_t onzcfr_offset;    /* byte offset into the payload */
+  uint16_t onzcfr_len;       /* bytes compared, 1 to 8 */
+  uint32_t onzcfr_reserved;  /* must be zero */
+  uint64_t onzcfr_mask;
+  uint64_t onzcfr_value;
+};
+
+extern int
+onload_set_recv_filter_chain(int fd,
+                             const struct onload_zc_recv_filter_rule* rules,
+                             int rules_len, int flags);
+
+
 
 /******************************************************************************
  * Send templates 
@@ -438,6 +551,19 @@ extern int onload_set_recv_filter(int fd,
  * onload_msg_template_update can be called multiple times and updates
  * are cumulative.
  *
+ * onload_msg_template_alloc_array allocates a set of templates in a
+ * single call, with all of them packed into a single span of the PIO
+ * region.  This is useful for applications that rotate among several
+ * near-identical messages: allocating the templates individually can
+ * exhaust the (small) PIO region through fragmentation, and the array
+ * allocation takes the per-call overhead once.  Each entry in the
+ * handles array receives an ordinary template handle, used with
+ * onload_msg_template_update (optionally with
+ * ONLOAD_TEMPLATE_FLAGS_SEND_NOW to apply a set of updates and send in
+ * one call) and onload_msg_template_abort exactly as if it had been
+ * allocated with onload_msg_template_alloc.  On failure no templates
+ * are allocated.
+ *
  * onload_msg_template_abort can be used to abort a templated send
  * without sending.
  * 
@@ -492,6 +618,19 @@ extern int onload_msg_template_alloc(int fd, const struct iovec* initial_msg,
                                      unsigned flags);
 
 
+/* The initial contents of one template in an array allocation */
+struct onload_template_msg {
+  const struct iovec* otm_msg;  /* Initial packet contents */
+  int                 otm_mlen; /* Number of iovecs in otm_msg */
+};
+
+/* Valid options for flags are: ONLOAD_TEMPLATE_FLAGS_PIO_RETRY */
+extern int
+onload_msg_template_alloc_array(int fd, const struct onload_template_msg* msgs,
+                                int ntemplates, onload_template_handle* handles,
+                                unsigned flags);
+
+
 /* Valid options for flags are: ONLOAD_TEMPLATE_FLAGS_SEND_NOW,
  * ONLOAD_TEMPLATE_FLAGS_DONTWAIT
  */
@@ -502,6 +641,37 @@ onload_msg_template_update(int fd, onload_template_handle handle,
 
 extern int onload_msg_template_abort(int fd, onload_template_handle handle);
 
+
+/******************************************************************************
+ * onload_zc_splice: zero-copy transfer between two Onload TCP sockets
+ ******************************************************************************
+ *
+ * Moves up to len received bytes from fd_in's receive queue directly onto
+ * fd_out's send queue without copying them through userspace.  Whole
+ * packet buffers are transferred, so data is moved in units of received
+ * segments; a segment is only moved if all of it is still unread and all
+ * of it is wanted.
+ *
+ * Both fds must be connected TCP sockets accelerated by the same Onload
+ * stack.  flags is for future use and must be set to 0.
+ *
+ * Returns the number of bytes moved, or 0 at end-of-stream on fd_in, or
+ * <0 to indicate an error:
+ *
+ *  -EAGAIN       no data is currently available on fd_in
+ *  -EOPNOTSUPP   data is available but cannot be moved without copying
+ *                (e.g. partially-read segments, segments larger than
+ *                fd_out's MSS, or pending urgent data); the caller should
+ *                fall back to recv() and send()
+ *  -EXDEV        the sockets belong to different Onload stacks
+ *
+ * A successful return may be less than len; the remaining data can be
+ * moved by a further call.  Note that segments are re-framed for fd_out,
+ * so the segment boundaries seen by the peer may differ from those
+ * received on fd_in.
+ */
+extern int onload_zc_splice(int fd_in, int fd_out, size_t len, int flags);
+
 #ifdef __cplusplus
 }
 #endif
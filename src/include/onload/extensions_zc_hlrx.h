@@ -105,7 +105,27 @@ extern int onload_zc_buffer_decref(int fd, onload_zc_handle buf);
  *
  * addr_space must be EF_ADDRSPACE_LOCAL (to send from the process's
  * local address space) or a value obtained from elsewhere. flags must
- * be 0.
+ * be 0 or a combination of ONLOAD_ZC_REGISTER_* values.
+ *
+ * ONLOAD_ZC_REGISTER_SEND_ONLY registers the region as a transmit source
+ * only: Onload will never write to it, so the underlying mapping may be
+ * read-only.  This permits registering mmap'd files (eg. PROT_READ,
+ * MAP_PRIVATE mappings) so that file contents can be sent with
+ * onload_zc_send() without first being copied into allocated zc buffers.
+ * Buffers from a send-only region must not be passed to receive-side
+ * calls.
+ *
+ * ONLOAD_ZC_REGISTER_ON_DEMAND declares the region without registering
+ * any of it with the NIC up front.  Registration happens lazily, in
+ * 2MB chunks, the first time a send references memory in a chunk; chunks
+ * that are never sent from are never registered or locked.  This makes
+ * it cheap to declare a large, long-lived arena (eg. an existing pool
+ * allocator's backing store) so that onload_zc_send() can take pointers
+ * into it directly, without restructuring the application around
+ * onload_zc_alloc_buffers().  Note that the first send into each chunk
+ * pays the registration cost, so latency-critical paths should touch
+ * their chunks during warmup.  Only addr_space == EF_ADDRSPACE_LOCAL is
+ * supported with this flag.
  *
  * Returns zero on success, or <0 to indicate an error.
  *
@@ -113,6 +133,11 @@ extern int onload_zc_buffer_decref(int fd, onload_zc_handle buf);
  * when this registered region is to be used, and can be passed to
  * onload_zc_unregister_buffers() to unregister the buffers.
  */
+enum onload_zc_register_flags {
+  ONLOAD_ZC_REGISTER_SEND_ONLY = 0x1,
+  ONLOAD_ZC_REGISTER_ON_DEMAND = 0x2,
+};
+
 extern int onload_zc_register_buffers(int fd,
                                       ef_addrspace addr_space,
                                       uint64_t base_ptr, uint64_t len,
@@ -369,6 +394,56 @@ onload_zc_hlrx_recv_oob(struct onload_zc_hlrx* hlrx,
                         void* buf, size_t len, int *flags);
 
 
+/* A pool of hlrx states covering many sockets.
+ *
+ * Applications which drive hundreds of sockets from one epoll loop do not
+ * want to track an hlrx object per socket themselves.  A pool maps fds to
+ * per-socket hlrx states internally, creating them on demand, so the event
+ * loop can simply do:
+ *
+ *     onload_zc_hlrx_pool_get(pool, ready_fd, &hlrx);
+ *     onload_zc_hlrx_recv_zc(hlrx, ...);
+ *
+ * Pools are not thread-safe: all calls on one pool must be serialised by
+ * the caller, exactly as for a single hlrx instance.
+ */
+struct onload_zc_hlrx_pool;
+
+/* Create a new, empty hlrx pool.  No flags are currently defined.
+ *
+ * Returns zero on success, or <0 to indicate an error
+ */
+extern int onload_zc_hlrx_pool_alloc(int flags,
+                                     struct onload_zc_hlrx_pool** pool_out);
+
+/* Free an hlrx pool and all hlrx states it still contains.
+ *
+ * Returns zero on success, or <0 to indicate an error.  As for
+ * onload_zc_hlrx_free(), -EBUSY indicates that buffers or remote blocks
+ * given out by a member hlrx state remain unfreed; no state is freed in
+ * that case.
+ */
+extern int onload_zc_hlrx_pool_free(struct onload_zc_hlrx_pool* pool);
+
+/* Obtain the hlrx state for fd, creating it (as if by
+ * onload_zc_hlrx_alloc()) if the fd is not yet known to the pool.  The
+ * returned instance remains owned by the pool.
+ *
+ * Returns zero on success, or <0 to indicate an error
+ */
+extern int onload_zc_hlrx_pool_get(struct onload_zc_hlrx_pool* pool, int fd,
+                                   struct onload_zc_hlrx** hlrx_out);
+
+/* Remove fd's hlrx state from the pool and free it.  Call this when a
+ * socket is closed or deregistered from the event loop.
+ *
+ * Returns zero on success, -ENOENT if the fd is not in the pool, or any
+ * error onload_zc_hlrx_free() can return (in which case the state stays in
+ * the pool).
+ */
+extern int onload_zc_hlrx_pool_put(struct onload_zc_hlrx_pool* pool, int fd);
+
+
 /******************************************************************************
  * TCP processing offload
  ******************************************************************************/
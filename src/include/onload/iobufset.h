@@ -157,7 +157,7 @@ void oo_iobufset_kfree(struct oo_buffer_pages *pages);
  */
 extern int
 oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
-                        struct oo_buffer_pages **pages_out,
+                        struct oo_buffer_pages **pages_out, int numa_node,
                         struct oo_hugetlb_allocator *hugetlb_alloc);
 extern void oo_iobufset_pages_release(struct oo_buffer_pages *);
 
@@ -74,6 +74,10 @@ enum {
   OO_OP_EP_FILTER_MCAST_DEL,
 #define OO_IOC_EP_FILTER_MCAST_DEL  OO_IOC_W(EP_FILTER_MCAST_DEL, \
                                              oo_tcp_filter_mcast_t)
+  OO_OP_EP_FILTER_MCAST_ADD_BATCH,
+#define OO_IOC_EP_FILTER_MCAST_ADD_BATCH \
+                                OO_IOC_RW(EP_FILTER_MCAST_ADD_BATCH, \
+                                          oo_tcp_filter_mcast_batch_t)
   OO_OP_EP_FILTER_DUMP,
 #define OO_IOC_EP_FILTER_DUMP       OO_IOC_W(EP_FILTER_DUMP,            \
                                              oo_tcp_filter_dump_t)
@@ -189,6 +193,10 @@ enum {
 #define OO_IOC_MOVE_FD              OO_IOC_W(MOVE_FD, \
                                              ci_fixed_descriptor_t)
 
+  OO_OP_MOVE_FD_BATCH,
+#define OO_IOC_MOVE_FD_BATCH        OO_IOC_W(MOVE_FD_BATCH, \
+                                             oo_move_fd_batch_t)
+
   OO_OP_EP_REUSEPORT_BIND,
 #define OO_IOC_EP_REUSEPORT_BIND                        \
   OO_IOC_W(EP_REUSEPORT_BIND, oo_tcp_reuseport_bind_t)
@@ -251,6 +259,18 @@ enum {
 #define OO_IOC_DESIGN_PARAMETERS OO_IOC_RW(DESIGN_PARAMETERS, \
                                            oo_design_parameters_t)
 
+  /* Keep the stack and its hardware resources alive over the last close,
+   * so that a restarted process can re-attach by name (EF_NAME) instead
+   * of rebuilding the stack.  Argument: 1 to persist, 0 to release. */
+  OO_OP_STACK_PERSIST,
+#define OO_IOC_STACK_PERSIST OO_IOC_W(STACK_PERSIST, ci_int32)
+
+  /* Doorbell for the shared-memory slow-path command ring; the driver
+   * also drains the ring on every ioctl entry, so user level only kicks
+   * when the ring goes from idle to non-empty. */
+  OO_OP_SLOWPATH_KICK,
+#define OO_IOC_SLOWPATH_KICK OO_IOC_NONE(SLOWPATH_KICK)
+
   OO_OP_CONTIG_END,  /* This is the last in range of contigous opcodes */
 
   /* Here come only placeholder for operations with arbitrary codes */
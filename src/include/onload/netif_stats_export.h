@@ -0,0 +1,56 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2023 Advanced Micro Devices, Inc. */
+
+#ifndef __ONLOAD_NETIF_STATS_EXPORT_H__
+#define __ONLOAD_NETIF_STATS_EXPORT_H__
+
+/* Shared-memory export of stack statistics counters.
+ *
+ * When EF_STATS_EXPORT_MS is non-zero the process that creates a stack also
+ * creates a small world-readable file, OO_STATS_EXPORT_PATH_FMT with the
+ * stack id substituted, and periodically copies the stack's ci_netif_stats
+ * counters into it.  Monitoring agents can mmap() the file and scrape all
+ * stacks on a host with plain memory reads, with no need to attach to each
+ * stack via onload_stackdump or the onload device.
+ *
+ * The file starts with struct oo_stats_export_hdr.  The counter block lives
+ * at [stats_off] and is a verbatim copy of ci_netif_stats as defined by
+ * <ci/internal/stats_def.h> for the build identified by [version]:
+ * consecutive fields in declaration order, each of the declared type, no
+ * padding beyond natural alignment.  OO_STATS_EXPORT_VERSION must be bumped
+ * whenever the layout of ci_netif_stats (or of this header) changes, so a
+ * reader built against different headers can detect a mismatch instead of
+ * misparsing.
+ *
+ * [generation] is a seqlock: the writer increments it before and after each
+ * copy, so it is odd while an update is in progress.  Readers should read
+ * [generation], copy the counter block, re-read [generation] and retry if
+ * the two values differ or are odd.
+ *
+ * The counters are refreshed from the stack-polling paths of the creating
+ * process, so they are only as fresh as that process's polling; if the
+ * creator exits while the stack persists, the file goes stale.  Readers can
+ * check [pid] for liveness.
+ */
+
+#include <ci/compat.h>
+#include <ci/internal/transport_config_opt.h>
+
+#define OO_STATS_EXPORT_PATH_FMT  "/dev/shm/onload_stats_%d"
+#define OO_STATS_EXPORT_MAGIC     0x6f537478u           /* "oStx" */
+#define OO_STATS_EXPORT_VERSION   1u
+
+struct oo_stats_export_hdr {
+  ci_uint32          magic;        /* OO_STATS_EXPORT_MAGIC */
+  ci_uint32          version;      /* OO_STATS_EXPORT_VERSION */
+  ci_uint32          hdr_len;      /* sizeof(struct oo_stats_export_hdr) */
+  ci_uint32          stats_off;    /* offset of the counter block */
+  ci_uint32          stats_len;    /* sizeof(ci_netif_stats) */
+  ci_uint32          stack_id;
+  ci_int32           pid;          /* process refreshing the counters */
+  ci_uint32          pad;
+  volatile ci_uint64 generation;   /* seqlock; odd => update in progress */
+  char               stack_name[CI_CFG_STACK_NAME_LEN + 1];
+};
+
+#endif  /* __ONLOAD_NETIF_STATS_EXPORT_H__ */
@@ -23,6 +23,9 @@ struct oo_shmbuf {
   void** addrs;
 #define OO_SHMBUF_INIT_CHUNK ((void*)1UL)
 
+  /* NUMA node to allocate chunks from, or -1 for no preference */
+  int numa_node;
+
   /* Lock for the num field above */
   struct mutex lock;
 };
@@ -70,7 +73,7 @@ static inline long oo_shmbuf_size(struct oo_shmbuf* sh)
 }
 
 extern int oo_shmbuf_alloc(struct oo_shmbuf* sh, int order,
-                           int max, int init_num);
+                           int max, int init_num, int numa_node);
 extern void oo_shmbuf_free(struct oo_shmbuf* sh);
 extern int oo_shmbuf_add(struct oo_shmbuf* sh);
 extern int oo_shmbuf_fault(struct oo_shmbuf* sh, struct vm_area_struct* vma,
@@ -35,6 +35,7 @@ enum {
 
 extern int oof_shared_keep_thresh;
 extern int oof_shared_steal_thresh;
+extern int oof_mcast_mac_aggregation;
 extern int oof_all_ports_required;
 extern int oof_use_all_local_ip_addresses;
 
@@ -72,6 +73,9 @@ oof_hwport_up_down(struct oof_manager* fm, int hwport, int up,
 extern void
 oof_hwport_removed(struct oof_manager* fm, int hwport);
 
+extern void
+oof_hwport_reset(struct oof_manager* fm, int hwport, int sync);
+
 extern void
 oof_hwport_un_available(ci_hwport_id_t hwport, int available, int tag,
                         void *arg);
@@ -162,6 +166,16 @@ oof_tproxy_free(struct oof_manager* fm,
 extern int
 oof_tproxy_update_filters(struct oof_manager* fm, int ifindex);
 
+extern int
+oof_ethertype_install(struct oof_manager* fm,
+                      struct tcp_helper_resource_s* trs,
+                      int ifindex, ci_uint16 ethertype_be16);
+
+extern int
+oof_ethertype_free(struct oof_manager* fm,
+                   struct tcp_helper_resource_s* trs,
+                   int ifindex, ci_uint16 ethertype_be16);
+
 extern void
 oof_socket_dump(struct oof_manager*, struct oof_socket*,
                 void (*dump_fn)(void* opaque, const char* fmt, ...),
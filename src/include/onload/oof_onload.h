@@ -44,6 +44,7 @@ oof_onload_mcast_update_interface(ci_ifid_t ifindex, ci_uint16 flags,
 extern void oof_onload_mcast_update_filters(ci_ifid_t ifindex,
                                             struct net* netns, void *arg);
 extern void oof_onload_hwport_removed(struct efab_tcp_driver_s*, int hwport);
+extern void oof_onload_hwport_reset(struct efab_tcp_driver_s*, int hwport);
 extern void oof_onload_hwport_up_down(struct efab_tcp_driver_s*, int hwport,
                                       int up, int mcast_replicate_capable,
                                       int vlan_filters, int no5tuple,
@@ -14,8 +14,23 @@ ci_inline void citp_waitable_wakeup(ci_netif* ni, citp_waitable* w)
   tcp_helper_endpoint_wakeup(netif2tcp_helper_resource(ni),
                              ci_netif_get_valid_ep(ni, w->bufid));
 }
+
+/* The kernel cannot ding a user-space futex; futex waiters poll with a
+ * bounded timeout instead, so kernel-originated wakeups are still seen.
+ */
+ci_inline void citp_waitable_futex_wake(ci_netif* ni, citp_waitable* w,
+                                        unsigned why)
+{
+}
 #else
 extern void citp_waitable_wakeup(ci_netif*, citp_waitable*) CI_HF;
+
+/* Wake any threads blocked in futex-wait on the waitable's futex doorbell
+ * for the direction(s) in [why] (EF_PIPE_FUTEX).  No-op, and no syscall,
+ * when nobody is waiting.
+ */
+extern void citp_waitable_futex_wake(ci_netif*, citp_waitable*,
+                                     unsigned why) CI_HF;
 #endif
 
 extern void citp_waitable_wake_not_in_poll(ci_netif* ni, citp_waitable* sb,
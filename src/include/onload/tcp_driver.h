@@ -69,6 +69,13 @@ typedef struct efab_tcp_driver_s {
   /*! work queue */
   struct workqueue_struct      *workqueue;
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  /*! Shared worker pool for periodic stack polls.  Stacks round-robin
+   * their periodic maintenance work here instead of each owning a
+   * workqueue, unless pinned via EF_PERIODIC_TIMER_CPU. */
+  struct workqueue_struct      *periodic_workqueue;
+#endif
+
   /*! Number of pages pinned by all sendpage() users */
   ci_atomic_t sendpage_pinpages_n;
   /*! An overall limit of pinned pages for all sendpage() users */
@@ -112,6 +112,10 @@ typedef struct tcp_helper_cluster_s {
 #define THC_FLAG_SCALABLE          0x10
 
 #define THC_FLAG_PREALLOC_LPORTS   0x20
+
+/* RSS indirection table rebalancing policies (EF_CLUSTER_RSS_POLICY). */
+#define THC_FLAG_RSS_LLOAD         0x40
+#define THC_FLAG_RSS_NUMA          0x80
   unsigned                        thc_flags;
   uint16_t*                       thc_tproxy_ifindex;
   int                             thc_tproxy_ifindex_count;
@@ -121,6 +125,14 @@ typedef struct tcp_helper_cluster_s {
 
   wait_queue_head_t               thr_release_done;
 
+  /* Periodic reweighting of the VI set's RSS indirection table when a
+   * non-default EF_CLUSTER_RSS_POLICY is in effect. */
+  struct delayed_work             thc_rebalance_work;
+  /* Set while the NIC is programmed with a non-even indirection table, so
+   * that the rebalance work knows to restore even striping when the
+   * computed weights become uniform again. */
+  int                             thc_rss_skewed;
+
   struct oo_cplane_handle*        thc_cplane;
   struct oo_filter_ns*            thc_filter_ns;
 
@@ -184,6 +196,16 @@ typedef struct tcp_helper_resource_s {
   char                   name[CI_CFG_STACK_NAME_LEN + 1];
   oo_thr_ref_t           ref;
 
+  /* Non-zero when OO_IOC_STACK_PERSIST holds an extra file-level
+   * reference to keep the stack alive over the last close.  Modified
+   * with compare-and-swap only. */
+  ci_uint32              is_persistent;
+
+  /* Non-zero while some task is draining the shared-memory slow-path
+   * command ring; claimed with compare-and-swap so that at most one
+   * drain runs at a time. */
+  ci_uint32              slowpath_draining;
+
   ci_netif               netif;
 
 #if ! CI_CFG_UL_INTERRUPT_HELPER
@@ -222,6 +244,10 @@ typedef struct tcp_helper_resource_s {
   /* For pinning periodic work */
   int periodic_timer_cpu;
 
+  /* Workqueue for periodic work: the driver-wide shared pool, or wq below
+   * when the work is pinned to a cpu. */
+  struct workqueue_struct *periodic_wq;
+
   /* For deferring work to a non-atomic context. */
 #define ONLOAD_WQ_NAME "onload-wq:%s"
 #define ONLOAD_WQ_NAME_BASELEN 11
@@ -322,6 +348,16 @@ typedef struct tcp_helper_resource_s {
 #endif
   unsigned              efct_shm_mmap_bytes;
 
+  /* Number of packet buffer sets this stack has debited from the
+   * host-wide shared packet budget (see the shared_packets_max module
+   * option).  Credited back when the stack's packets are released. */
+  unsigned              pkt_sets_budgeted;
+
+  /* Worst-case pinned bytes this stack has debited from the host-wide
+   * memory ledger (see the pinned_mem_max_mb module option).  Credited
+   * back when the stack's resources are released. */
+  ci_uint64             mem_accounted;
+
   /* Used to block threads that are waiting for free pkt buffers. */
   ci_waitq_t            pkt_waitq;
 
@@ -351,6 +387,9 @@ typedef struct tcp_helper_resource_s {
   ci_dllink             thc_thr_link;
   /* bucket of rss hardware filter */
   int thc_rss_instance;
+  /* NUMA node of the thread that created this stack, for the "numa"
+   * cluster RSS rebalancing policy. */
+  int thc_numa_node;
   /* backing store for efct's mmappable hugepages */
   struct oo_hugetlb_allocator* thc_efct_alloc;
   /* backing store for packet buffers */
@@ -369,6 +408,11 @@ typedef struct tcp_helper_resource_s {
   uint16_t*             tproxy_ifindex;
   int                   tproxy_ifindex_count;
 
+  /* Raw-L2 ethertype steering (EF_RX_ETHERTYPE): the interface and
+   * ethertype whose oof filter this stack owns, or 0 if none. */
+  int                   ethertype_ifindex;
+  uint16_t              ethertype_be16;
+
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
   /* The available ephemeral ports for active wilds are maintained in a hash
    * table keyed by local IP address.  If the stack is clustered, then this
@@ -483,6 +527,11 @@ struct tcp_helper_endpoint_s {
 #define OO_THR_EP_AFLAG_NEED_FREE      0x10 /* Endpoint to be freed */
 #define OO_THR_EP_AFLAG_OS_NOTIFIER    0x20 /* Pollwait registration for os */
 #define OO_THR_EP_AFLAG_TCP_OFFLOAD_ISN 0x40 /* Send sync_stream to plugin */
+#define OO_THR_EP_AFLAG_SET_FILTERS    0x80 /* Needs hw filters setting */
+
+  /*! ifindex captured when a filter-set operation is deferred to
+   * workqueue context via OO_THR_EP_AFLAG_SET_FILTERS. */
+  ci_ifid_t set_filters_ifindex;
 
   struct ci_private_s* alien_ref;
 
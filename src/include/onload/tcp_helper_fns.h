@@ -190,6 +190,8 @@ oo_version_check(const char* version, const char* uk_intf_ver, int debug_lib);
 extern int efab_tcp_helper_sock_sleep(tcp_helper_resource_t*,
 				      oo_tcp_sock_sleep_t* op);
 
+extern void efab_slowpath_ring_drain(tcp_helper_resource_t* trs);
+
 extern int efab_tcp_helper_pkt_wait(tcp_helper_resource_t* trs,
                                     int* lock_flags);
 
@@ -226,7 +228,7 @@ struct file *sock_alloc_file(struct socket *sock, int flags, void *unused);
 extern int efab_tcp_helper_map_usermem(tcp_helper_resource_t* trs,
                                        struct oo_iobufs_usermem* ioum,
                                        unsigned long user_base, int n_pages,
-                                       uint64_t** hw_addrs_out);
+                                       int writable, uint64_t** hw_addrs_out);
 
 extern void efab_tcp_helper_unmap_usermem(tcp_helper_resource_t* trs,
                                           struct oo_iobufs_usermem* ioum);
@@ -267,6 +269,9 @@ extern int efab_tcp_helper_pkt_buf_map(tcp_helper_resource_t* trs,
 extern int efab_tcp_helper_design_parameters(tcp_helper_resource_t* trs,
                                              oo_design_parameters_t* arg);
 
+extern int efab_tcp_helper_set_persistent(tcp_helper_resource_t* trs,
+                                          int enable);
+
 extern void
 tcp_helper_cluster_ref(tcp_helper_cluster_t* thc);
 
@@ -142,7 +142,7 @@ ci_udp_poll_events(ci_netif* ni, ci_udp_state* us)
       events |= POLLHUP;
   }
 
-  if( UDP_RX_ERRNO(us) | ci_udp_recv_q_not_empty(&us->recv_q) )
+  if( UDP_RX_ERRNO(us) | ci_udp_rx_q_any_not_empty(us) )
     events |= POLLIN | POLLRDNORM;
 
   if( us->s.os_sock_status & OO_OS_STATUS_RX )
@@ -152,6 +152,7 @@ ci_udp_poll_events(ci_netif* ni, ci_udp_state* us)
 #if CI_CFG_TIMESTAMPING
      ci_udp_recv_q_not_empty(&us->timestamp_q) ||
 #endif
+      us->zc_comp_pending ||
       (us->s.os_sock_status & OO_OS_STATUS_ERR) ) {
     events |= POLLERR;
     if( us->s.s_aflags & CI_SOCK_AFLAG_SELECT_ERR_QUEUE )
@@ -16,6 +16,7 @@
 
 #include <onload/signals.h>
 #include <onload/ul/stackname.h>
+#include <sched.h>
 
 
 #ifdef __i386__
@@ -36,8 +37,11 @@
 #endif
 
 
+struct citp_fdtable_rcu_reader;
+
 struct oo_per_thread {
   ci_netif_config_opts*      thread_local_netif_opts;
+  struct citp_fdtable_rcu_reader* fdtable_rcu;
   int                        initialised;
   int                        avoid_fds;
   struct oo_sig_thread_state sig;
@@ -45,9 +49,19 @@ struct oo_per_thread {
   ci_uint64                  poll_nonblock_fast_frc;
   ci_uint64                  select_nonblock_fast_frc;
   struct oo_timesync         timesync;
-  unsigned                   spinstate; 
+  unsigned                   spinstate;
+  /* Non-zero if this thread has stack-lock poll priority; see
+   * onload_thread_set_poll_priority(). */
+  int                        poll_prio;
   int                        in_vfork_child;
   void*                      vfork_scratch[OO_VFORK_SCRATCH_SIZE];
+  /* Spin-placement state; see oo_spin_topology_assess().  [spin_cpu_plus1]
+   * is the CPU this thread was last assessed on, plus one (zero means not
+   * yet assessed); [spin_yield] is set when that placement calls for
+   * yield-based waiting instead of a full spin. */
+  ci_uint64                  spin_topology_frc;
+  ci_int32                   spin_cpu_plus1;
+  ci_uint8                   spin_yield;
 };
 
 
@@ -77,4 +91,53 @@ ci_inline struct oo_per_thread* oo_per_thread_get(void)
   return &oo_per_thread;
 }
 
+
+/**********************************************************************
+ * Spin-placement topology awareness (EF_SPIN_TOPOLOGY_AWARE).
+ *
+ * A thread spinning on the SMT sibling of another spinning thread, or
+ * on an efficiency core, hurts more than it helps: it starves the
+ * core's shared execution resources or simply runs slowly.  The unix
+ * layer scans sysfs at startup to build per-CPU sibling and
+ * efficiency-core tables; spin loops then periodically re-assess their
+ * own placement and switch to yield-based waiting when it is bad.
+ */
+
+/* How often a spinning thread re-checks its CPU placement. */
+#define OO_SPIN_TOPOLOGY_RECHECK_MS  10
+
+/* Largest CPU id the topology tables cover. */
+#define OO_SPIN_TOPOLOGY_MAX_CPUS    1024
+
+extern int oo_spin_topology_enabled CI_HV;
+/* Per-CPU: id of an SMT sibling (the first, on >2-way SMT), or -1. */
+extern ci_int16 oo_spin_cpu_sibling[OO_SPIN_TOPOLOGY_MAX_CPUS] CI_HV;
+/* Per-CPU: nonzero for efficiency cores. */
+extern ci_uint8 oo_spin_cpu_e_core[OO_SPIN_TOPOLOGY_MAX_CPUS] CI_HV;
+
+extern void oo_spin_topology_assess(struct oo_per_thread* pt) CI_HF;
+
+/* Call once in a while from a spin loop: re-assesses placement at most
+ * every OO_SPIN_TOPOLOGY_RECHECK_MS.  [khz] is cycles per millisecond. */
+ci_inline void oo_spin_topology_enter(struct oo_per_thread* pt,
+                                      ci_uint64 now_frc, unsigned khz)
+{
+  if( oo_spin_topology_enabled &&
+      now_frc - pt->spin_topology_frc >
+      (ci_uint64) khz * OO_SPIN_TOPOLOGY_RECHECK_MS ) {
+    pt->spin_topology_frc = now_frc;
+    oo_spin_topology_assess(pt);
+  }
+}
+
+/* Returns true (and yields) if this thread's placement calls for
+ * yield-based waiting; the caller should otherwise pause as usual. */
+ci_inline int/*bool*/ oo_spin_topology_yield(struct oo_per_thread* pt)
+{
+  if(CI_LIKELY( ! pt->spin_yield ))
+    return 0;
+  sched_yield();
+  return 1;
+}
+
 #endif  /* __ONLOAD_UL_PER_THREAD_H__ */
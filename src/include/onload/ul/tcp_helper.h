@@ -176,6 +176,28 @@ ci_tcp_helper_ep_mcast_add_del(ci_fd_t           fd,
                                ci_ifid_t         ifindex,
                                int               add);
 
+/*--------------------------------------------------------------------
+ *!
+ * Adds an array of multicast addresses to the socket list, programming
+ * filters in batches of OO_MCAST_BATCH_MAX per ioctl.
+ *
+ * \param fd              File descriptor of tcp_helper
+ * \param ep              TCP control block id
+ * \param ifindex         Interface to join the groups on
+ * \param mcast_addrs     Multicast addresses to add to the socket list
+ * \param count           Number of addresses
+ *
+ * \return                number of addresses added, or negative error
+ *                        if none could be added
+ *
+ *--------------------------------------------------------------------*/
+extern int
+ci_tcp_helper_ep_mcast_add_batch(ci_fd_t           fd,
+                                 oo_sp             ep,
+                                 ci_ifid_t         ifindex,
+                                 const ci_uint32*  mcast_addrs,
+                                 int               count);
+
 /*--------------------------------------------------------------------
  *!
  * Setup event triggering mechanism
@@ -217,7 +239,8 @@ extern int ci_tcp_helper_alloc_active_wild(ci_netif *ni, ci_addr_t laddr);
 
 
 int ci_tcp_helper_zc_register_buffers(ci_netif* ni, void* base, int num_pages,
-                                      uint64_t* hw_addrs, uint64_t* id);
+                                      unsigned flags, uint64_t* hw_addrs,
+                                      uint64_t* id);
 
 int ci_tcp_helper_zc_unregister_buffers(ci_netif* ni, uint64_t id);
 #endif /* __CI_UL_TCP_HELPER_H__ */
@@ -32,15 +32,37 @@ struct oo_wqlock {
   pthread_cond_t      cond;
 };
 
+/* Work item types.  The lock holder drains deferred work one type at a
+ * time, so all items of a given type run back-to-back.  This keeps the
+ * handler code hot in the I-cache and the branch predictor trained when a
+ * large batch of mixed work has been handed off. */
+enum oo_wqlock_work_type {
+  OO_WQLOCK_WORK_EPOLL_CTL,
+  OO_WQLOCK_WORK_EPOLL_HANDOVER,
+  OO_WQLOCK_WORK_MISC,
+  OO_WQLOCK_WORK_NTYPES
+};
+
 struct oo_wqlock_work {
   void (*fn)(struct oo_wqlock_work* work, void* unlock_param);
   struct oo_wqlock_work* next;
+  enum oo_wqlock_work_type type;
+};
+
+/* Counters of work handed off to lock holders, accumulated process-wide
+ * across all wqlocks.  Updated without atomics: only ever an
+ * approximation under concurrent drains, which is fine for stats. */
+struct oo_wqlock_work_stats {
+  uint64_t items[OO_WQLOCK_WORK_NTYPES];
+  uint64_t batches;
 };
 
 extern void oo_wqlock_init(struct oo_wqlock* wql);
 
 void oo_wqlock_work_do(struct oo_wqlock_work* work_list, void *unlock_param);
 
+extern void oo_wqlock_work_stats_get(struct oo_wqlock_work_stats* stats);
+
 extern void oo_wqlock_lock_slow(struct oo_wqlock* wql) CI_HF;
 
 extern void oo_wqlock_unlock_slow(struct oo_wqlock* wql,
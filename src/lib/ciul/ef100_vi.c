@@ -301,6 +301,7 @@ static int ef100_ef_vi_receive_init(ef_vi* vi, ef_addr addr,
   ef_vi_rxq_state* qs = &vi->ep_state->rxq;
   unsigned di;
 
+  addr += vi->rx_headroom;
   if( ef_vi_receive_space(vi) ) {
     ef_vi_ef100_dma_rx_desc* dp;
 
@@ -386,6 +387,60 @@ static void ef100_ef_vi_transmit_copy_pio_warm(ef_vi* vi, int pio_offset,
 }
 
 
+/* EF100 has no CTPIO aperture: cut-through transmit is a property of the
+ * TXQ, requested at queue initialisation when the VI is allocated with
+ * EF_VI_TX_CTPIO, and frame data always travels by DMA descriptor.  We
+ * keep the CTPIO API working by making the aperture write a no-op and
+ * doing the real send in the fallback call, which the API obliges the
+ * caller to make in any case.  Applications written against the CTPIO
+ * pattern therefore run unchanged, at the best latency the silicon
+ * offers.
+ */
+static void
+  ef100_ef_vi_transmitv_ctpio(ef_vi* vi, size_t frame_len,
+                              const struct iovec* iov, int iovcnt,
+                              unsigned threshold)
+{
+  EF_VI_ASSERT( vi->vi_flags & EF_VI_TX_CTPIO );
+}
+
+
+static void
+  ef100_ef_vi_transmitv_ctpio_copy(ef_vi* vi, size_t frame_len,
+                                   const struct iovec* iov, int iovcnt,
+                                   unsigned threshold, void* fallback)
+{
+  int i;
+
+  EF_VI_ASSERT( vi->vi_flags & EF_VI_TX_CTPIO );
+
+  /* The caller's fallback buffer must contain the frame on return, ready
+   * for the fallback send. */
+  for( i = 0; i < iovcnt; ++i ) {
+    memcpy(fallback, iov[i].iov_base, iov[i].iov_len);
+    fallback = (char*) fallback + iov[i].iov_len;
+  }
+}
+
+
+static int ef100_ef_vi_transmit_ctpio_fallback(ef_vi* vi, ef_addr dma_addr,
+                                               size_t len, ef_request_id dma_id)
+{
+  EF_VI_ASSERT( vi->vi_flags & EF_VI_TX_CTPIO );
+  return ef100_ef_vi_transmit(vi, dma_addr, len, dma_id);
+}
+
+
+static int ef100_ef_vi_transmitv_ctpio_fallback(ef_vi* vi,
+                                                const ef_iovec* dma_iov,
+                                                int dma_iov_len,
+                                                ef_request_id dma_id)
+{
+  EF_VI_ASSERT( vi->vi_flags & EF_VI_TX_CTPIO );
+  return ef100_ef_vi_transmitv(vi, dma_iov, dma_iov_len, dma_id);
+}
+
+
 static void
   ef100_ef_vi_transmitv_ctpio_not_supp(ef_vi* vi, size_t frame_len,
                                       const struct iovec* iov, int iovcnt,
@@ -395,15 +450,27 @@ static void
 }
 
 
-static int ef100_ef_vi_transmit_ctpio_fallback(ef_vi* vi, ef_addr dma_addr,
-                                               size_t len, ef_request_id dma_id)
+static void
+  ef100_ef_vi_transmitv_ctpio_copy_not_supp(ef_vi* vi, size_t frame_len,
+                                            const struct iovec* iov,
+                                            int iovcnt, unsigned threshold,
+                                            void* fallback)
+{
+  ef100_unsupported_msg(__FUNCTION__);
+}
+
+
+static int ef100_ef_vi_transmit_ctpio_fallback_not_supp(ef_vi* vi,
+                                                        ef_addr dma_addr,
+                                                        size_t len,
+                                                        ef_request_id dma_id)
 {
   ef100_unsupported_msg(__FUNCTION__);
   return -EOPNOTSUPP;
 }
 
 
-static int ef100_ef_vi_transmitv_ctpio_fallback(ef_vi* vi,
+static int ef100_ef_vi_transmitv_ctpio_fallback_not_supp(ef_vi* vi,
                                                 const ef_iovec* dma_iov,
                                                 int dma_iov_len,
                                                 ef_request_id dma_id)
@@ -590,7 +657,14 @@ static void ef100_vi_initialise_ops(ef_vi* vi)
   vi->ops.transmit_copy_pio      = ef100_ef_vi_transmit_copy_pio;
   vi->ops.transmit_pio_warm      = ef100_ef_vi_transmit_pio_warm;
   vi->ops.transmit_copy_pio_warm = ef100_ef_vi_transmit_copy_pio_warm;
-  vi->ops.transmitv_ctpio        = ef100_ef_vi_transmitv_ctpio_not_supp;
+  if( vi->vi_flags & EF_VI_TX_CTPIO ) {
+    vi->ops.transmitv_ctpio        = ef100_ef_vi_transmitv_ctpio;
+    vi->ops.transmitv_ctpio_copy   = ef100_ef_vi_transmitv_ctpio_copy;
+  }
+  else {
+    vi->ops.transmitv_ctpio        = ef100_ef_vi_transmitv_ctpio_not_supp;
+    vi->ops.transmitv_ctpio_copy   = ef100_ef_vi_transmitv_ctpio_copy_not_supp;
+  }
   vi->ops.transmit_alt_select    = ef100_ef_vi_transmit_alt_select;
   vi->ops.transmit_alt_select_default = ef100_ef_vi_transmit_alt_select_normal;
   vi->ops.transmit_alt_stop      = ef100_ef_vi_transmit_alt_stop;
@@ -615,8 +689,16 @@ static void ef100_vi_initialise_ops(ef_vi* vi)
     vi->ops.transmit_memcpy        = ef100_ef_vi_transmit_memcpy_disabled;
     vi->ops.transmit_memcpy_sync   = ef100_ef_vi_transmit_memcpy_sync_disabled;
   }
-  vi->ops.transmit_ctpio_fallback = ef100_ef_vi_transmit_ctpio_fallback;
-  vi->ops.transmitv_ctpio_fallback = ef100_ef_vi_transmitv_ctpio_fallback;
+  if( vi->vi_flags & EF_VI_TX_CTPIO ) {
+    vi->ops.transmit_ctpio_fallback = ef100_ef_vi_transmit_ctpio_fallback;
+    vi->ops.transmitv_ctpio_fallback = ef100_ef_vi_transmitv_ctpio_fallback;
+  }
+  else {
+    vi->ops.transmit_ctpio_fallback =
+                                ef100_ef_vi_transmit_ctpio_fallback_not_supp;
+    vi->ops.transmitv_ctpio_fallback =
+                                ef100_ef_vi_transmitv_ctpio_fallback_not_supp;
+  }
 }
 
 void ef100_vi_init(ef_vi* vi)
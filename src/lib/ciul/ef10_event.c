@@ -433,15 +433,69 @@ static void ef10_tx_event_ts_enabled(ef_vi* evq, const ef_vi_event* ev,
 }
 
 
+/* TX completion moderation: decide whether to hold back a completion
+ * event rather than report it to the app now.  Returns non-zero if the
+ * event was absorbed.  Each hardware event carries the cumulative
+ * descriptor index, so a held-back completion is superseded simply by
+ * reporting a later event: nothing is lost by swallowing earlier ones.
+ * Only valid when the VI uses plain DMA completions (no timestamps, no
+ * alternatives, no CTPIO), which the setter enforces.
+ */
+static int ef10_tx_event_moderate(ef_vi* evq, const ef_vi_event* ev)
+{
+  uint32_t desc_id = QWORD_GET_U(ESF_DZ_TX_DESCR_INDX, *ev) + 1;
+  uint32_t outstanding = (desc_id - (uint32_t) evq->ep_state->txq.removed)
+                         & evq->vi_txq.mask;
+  uint64_t now = ef_vi_frc64();
+
+  if( ! evq->tx_compl_held ) {
+    evq->tx_compl_held = 1;
+    evq->tx_compl_deadline = now + evq->tx_compl_timeout_ticks;
+  }
+  evq->tx_compl_desc_id = desc_id;
+  evq->tx_compl_q_id = QWORD_GET_U(ESF_DZ_TX_QLABEL, *ev);
+  if( outstanding >= evq->tx_compl_thresh ||
+      (int64_t) (now - evq->tx_compl_deadline) >= 0 ) {
+    evq->tx_compl_held = 0;
+    return 0;   /* report this (cumulative) completion now */
+  }
+  return 1;     /* hold back */
+}
+
+
+/* Report a held-back TX completion if its flush deadline has passed.
+ * Called on the way out of a poll, so must cope with a full [evs]. */
+static void ef10_tx_compl_maybe_flush(ef_vi* evq, ef_event** evs,
+                                      int* evs_len)
+{
+  ef_event* ev_out;
+
+  if( *evs_len == 0 ||
+      (int64_t) (ef_vi_frc64() - evq->tx_compl_deadline) < 0 )
+    return;
+  evq->tx_compl_held = 0;
+  ev_out = (*evs)++;
+  --(*evs_len);
+  ev_out->tx.type = EF_EVENT_TYPE_TX;
+  ev_out->tx.q_id = evq->tx_compl_q_id;
+  ev_out->tx.desc_id = evq->tx_compl_desc_id;
+  ev_out->tx.flags = 0;
+}
+
+
 static inline void ef10_tx_event_completion(ef_vi* evq, const ef_vi_event* ev,
                                             ef_event** evs, int* evs_len)
 {
-  ef_event* ev_out = (*evs)++;
+  ef_event* ev_out;
   unsigned ev_type = QWORD_GET_U(ESF_EZ_TX_SOFT1, *ev);
 
   EF_VI_ASSERT( ev_type == TX_TIMESTAMP_EVENT_TX_EV_COMPLETION ||
                 ev_type == TX_TIMESTAMP_EVENT_TX_EV_CTPIO_COMPLETION );
 
+  if( evq->tx_compl_thresh != 0 && ef10_tx_event_moderate(evq, ev) )
+    return;
+
+  ev_out = (*evs)++;
   --(*evs_len);
   ev_out->tx.q_id = QWORD_GET_U(ESF_DZ_TX_QLABEL, *ev);
   ev_out->tx.desc_id = QWORD_GET_U(ESF_DZ_TX_DESCR_INDX, *ev) + 1;
@@ -870,6 +924,10 @@ int ef10_ef_eventq_poll(ef_vi* evq, ef_event* evs, int evs_len)
   if (!EF_VI_IS_EVENT(&ev))
     goto empty;
   do {
+    /* Fetch the event ring a couple of cache lines ahead of the event
+     * being processed, so that by the time we get there the line is
+     * warm even if hardware has pushed it out since the last poll. */
+    ef_vi_prefetch(EF_VI_EVENT_PTR(evq, EF_VI_EVQ_PREFETCH_DIST));
     /* Ugly: Exploit the fact that event code lies in top bits
      * of event. */
     BUG_ON(ESF_DZ_EV_CODE_LBN < 32u);
@@ -918,6 +976,8 @@ int ef10_ef_eventq_poll(ef_vi* evq, ef_event* evs, int evs_len)
   } while (EF_VI_IS_EVENT(&ev));
 
  out:
+  if(unlikely( evq->tx_compl_held ))
+    ef10_tx_compl_maybe_flush(evq, &evs, &evs_len);
   return evs_len_orig - evs_len;
 
  empty:
@@ -936,7 +996,7 @@ int ef10_ef_eventq_poll(ef_vi* evq, ef_event* evs, int evs_len)
     }
   }
 
-  return 0;
+  goto out;
 
  overflow:
   evs->generic.type = EF_EVENT_TYPE_OFLOW;
@@ -1104,6 +1164,16 @@ int ef_vi_packed_stream_unbundle(ef_vi* vi, const ef_event* ev,
      * returned by the last call.
      */
     rc = ef10_unbundle_one_packet(vi, pkt);
+    if( i + 1 < ev->rx_packed_stream.n_pkts ) {
+      /* The chain is data-dependent - the next packet's address is only
+       * known once this one's length has been read - so we can see just
+       * one packet ahead.  Fetch its metadata and first header line
+       * while we finish off the current packet. */
+      char* next = (char*) pkt + pkt->ps_next_offset;
+      ef_vi_prefetch(next + EF_VI_PS_METADATA_OFFSET);
+      ef_vi_prefetch(next + EF_VI_PS_METADATA_OFFSET +
+                     ES_DZ_PS_RX_PREFIX_SIZE);
+    }
     pkt->ps_flags |= ev->rx_packed_stream.ps_flags;
     bytes_unpacked += pkt->ps_cap_len;
     pkt = (void*) ((char*) pkt + pkt->ps_next_offset);
@@ -498,6 +498,56 @@ static void
                              0, 0, 1, fallback);
 }
 
+#ifdef MEMCPY_TO_CTPIO_SIMD
+/* "fast" mode variants using wide stores to fill the CTPIO aperture.
+ * Multi-iovec frames take the generic path: they are rare and the qword
+ * loop's byte-merging logic is not worth vectorizing.
+ */
+ef_vi_inline uint32_t ef10_ctpio_header(ef_vi* vi, size_t frame_len,
+                                        unsigned threshold)
+{
+  int time_stamp_req = (vi->vi_flags & EF_VI_TX_TIMESTAMPS) != 0;
+  ci_dword_t header;
+  CI_POPULATE_DWORD_3(header,
+                      ESF_FZ_USER_THRESHOLD, threshold,
+                      ESF_FZ_TIME_STAMP_REQ, time_stamp_req,
+                      ESF_FZ_FRAME_LENGTH, frame_len);
+  return header.u32[0];
+}
+
+static void
+  ef10_ef_vi_transmitv_ctpio_fast_avx(ef_vi* vi, size_t frame_len,
+                                      const struct iovec* iov, int iovcnt,
+                                      unsigned threshold)
+{
+  if(likely( iovcnt == 1 )) {
+    EF_VI_ASSERT( vi->vi_flags & EF_VI_TX_CTPIO );
+    EF_VI_ASSERT( frame_len == iovec_bytes(iov, iovcnt) );
+    __memcpy_to_ctpio_avx((void*) vi->vi_ctpio_mmap_ptr,
+                          ef10_ctpio_header(vi, frame_len, threshold),
+                          iov[0].iov_base, iov[0].iov_len);
+  }
+  else
+    ef10_ef_vi_transmitv_ctpio_fast(vi, frame_len, iov, iovcnt, threshold);
+}
+
+static void
+  ef10_ef_vi_transmitv_ctpio_fast_avx512(ef_vi* vi, size_t frame_len,
+                                         const struct iovec* iov, int iovcnt,
+                                         unsigned threshold)
+{
+  if(likely( iovcnt == 1 )) {
+    EF_VI_ASSERT( vi->vi_flags & EF_VI_TX_CTPIO );
+    EF_VI_ASSERT( frame_len == iovec_bytes(iov, iovcnt) );
+    __memcpy_to_ctpio_avx512((void*) vi->vi_ctpio_mmap_ptr,
+                             ef10_ctpio_header(vi, frame_len, threshold),
+                             iov[0].iov_base, iov[0].iov_len);
+  }
+  else
+    ef10_ef_vi_transmitv_ctpio_fast(vi, frame_len, iov, iovcnt, threshold);
+}
+#endif
+
 /* Emit write-combined writes with gaps in between -- seems to keep them in
  * order most of the time, and is faster than using barriers.
  */
@@ -739,6 +789,7 @@ static int ef10_ef_vi_receive_init(ef_vi* vi, ef_addr addr,
   ef_vi_rxq_state* qs = &vi->ep_state->rxq;
   unsigned di;
 
+  addr += vi->rx_headroom;
   if( ef_vi_receive_space(vi) ) {
     di = qs->added++ & q->mask;
     EF_VI_BUG_ON(q->ids[di] !=  EF_REQUEST_ID_MASK);
@@ -782,14 +833,29 @@ static void ef10_ef_vi_receive_push(ef_vi* vi)
 }
 
 
+static void select_ctpio_fast(ef_vi* vi)
+{
+  vi->ops.transmitv_ctpio      = ef10_ef_vi_transmitv_ctpio_fast;
+  vi->ops.transmitv_ctpio_copy = ef10_ef_vi_transmitv_ctpio_copy_fast;
+#ifdef MEMCPY_TO_CTPIO_SIMD
+  /* In fast mode there is no pacing between write buffers, so fill the
+   * aperture with the widest stores the CPU supports. */
+  __builtin_cpu_init();
+  if( __builtin_cpu_supports("avx512f") )
+    vi->ops.transmitv_ctpio = ef10_ef_vi_transmitv_ctpio_fast_avx512;
+  else if( __builtin_cpu_supports("avx") )
+    vi->ops.transmitv_ctpio = ef10_ef_vi_transmitv_ctpio_fast_avx;
+#endif
+}
+
+
 static void select_ctpio_method(ef_vi* vi)
 {
 #ifndef __KERNEL__
   const char* s = getenv("EF_VI_CTPIO_MODE");
   if( s != NULL ) {
     if( ! strcmp(s, "fast") ) {
-      vi->ops.transmitv_ctpio      = ef10_ef_vi_transmitv_ctpio_fast;
-      vi->ops.transmitv_ctpio_copy = ef10_ef_vi_transmitv_ctpio_copy_fast;
+      select_ctpio_fast(vi);
     }
     else if( ! strcmp(s, "paced") ) {
       vi->ops.transmitv_ctpio      = ef10_ef_vi_transmitv_ctpio_paced;
@@ -810,6 +876,7 @@ static void select_ctpio_method(ef_vi* vi)
   vi->ops.transmitv_ctpio_copy = ef10_ef_vi_transmitv_ctpio_copy_paced;
   (void) ef10_ef_vi_transmitv_ctpio_fast;
   (void) ef10_ef_vi_transmitv_ctpio_copy_fast;
+  (void) select_ctpio_fast;
   (void) ef10_ef_vi_transmitv_ctpio_in_order;
   (void) ef10_ef_vi_transmitv_ctpio_copy_in_order;
 }
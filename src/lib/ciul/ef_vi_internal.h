@@ -93,6 +93,17 @@
 
 #define EF_VI_EVS_PER_CACHE_LINE  (EF_VI_CACHE_LINE_SIZE / EF_VI_EV_SIZE)
 
+/* Software prefetch of a (probably cold) cache line. */
+#ifdef __GNUC__
+# define ef_vi_prefetch(p)  __builtin_prefetch(p)
+#else
+# define ef_vi_prefetch(p)  do{}while(0)
+#endif
+
+/* How far ahead of the current read pointer the event queue is fetched
+ * while polling. */
+#define EF_VI_EVQ_PREFETCH_DIST   (2 * EF_VI_EVS_PER_CACHE_LINE)
+
 /* required for CI_PAGE_SIZE and related things */
 #include "ci/compat.h"
 
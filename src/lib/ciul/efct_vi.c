@@ -830,19 +830,17 @@ static inline uint16_t header_status_flags(const ci_oword_t *header)
   return flags;
 }
 
-static inline int efct_poll_rx(ef_vi* vi, int qid, ef_event* evs, int evs_len)
+/* Handle rollover and configuration changes before reading packet
+ * headers.  Returns < 0 if polling cannot proceed on this queue. */
+static int efct_poll_rx_prepare(ef_vi* vi, int qid)
 {
-  ef_vi_rxq_state* qs = &vi->ep_state->rxq;
-  ef_vi_efct_rxq_ptr* rxq_ptr = &qs->rxq_ptr[qid];
+  ef_vi_efct_rxq_ptr* rxq_ptr = &vi->ep_state->rxq.rxq_ptr[qid];
   ef_vi_efct_rxq* rxq = &vi->efct_rxq[qid];
   struct efab_efct_rxq_uk_shm_q* shm = &vi->efct_shm->q[qid];
-  int i;
 
   if( efct_rxq_need_rollover(shm, rxq_ptr->next) )
     if( rx_rollover(vi, qid) < 0 )
-      /* ef_eventq_poll() has historically never been able to fail, so we
-       * maintain that policy */
-      return 0;
+      return -1;
 
   if( efct_rxq_need_config(rxq, shm) ) {
     unsigned new_generation = OO_ACCESS_ONCE(shm->config_generation);
@@ -858,10 +856,59 @@ static inline int efct_poll_rx(ef_vi* vi, int qid, ef_event* evs, int evs_len)
        * don't want that */
       OO_ACCESS_ONCE(rxq->config_generation) = new_generation;
 #endif
-      return 0;
+      return -1;
     }
     OO_ACCESS_ONCE(rxq->config_generation) = new_generation;
   }
+  return 0;
+}
+
+
+/* Handle a header with the ROLLOVER bit: consume the unused refs on the
+ * current superbuf and arrange for a rollover on the next poll. */
+static void efct_rx_handle_rollover_header(ef_vi* vi, int qid, uint32_t pkt_id)
+{
+  ef_vi_efct_rxq_ptr* rxq_ptr = &vi->ep_state->rxq.rxq_ptr[qid];
+  struct efab_efct_rxq_uk_shm_q* shm = &vi->efct_shm->q[qid];
+  struct efct_rx_descriptor* desc = efct_rx_desc(vi, pkt_id);
+
+  /* We created the desc->refcnt assuming that this superbuf would be
+   * full of packets. It wasn't, so consume all the unused refs */
+  int nskipped = shm->superbuf_pkts - pkt_id_to_index_in_superbuf(pkt_id);
+  EF_VI_ASSERT(nskipped > 0);
+  EF_VI_ASSERT(nskipped <= desc->refcnt);
+  desc->refcnt -= nskipped;
+  if( desc->refcnt == 0 )
+    superbuf_free(vi, qid, pkt_id_to_local_superbuf_ix(pkt_id));
+  if( nskipped == 1 ) {
+    /* i.e. the current packet is the one straddling a superbuf
+     * boundary. We consume the last packet of the first superbuf above
+     * (it's the bogus 'manual rollover' packet) and here we consume the
+     * entirety of the current superbuf, which is the one the NIC wants
+     * to get rid of */
+    superbuf_free(vi, qid, pkt_id_to_local_superbuf_ix(
+                                    rxq_ptr_to_pkt_id(rxq_ptr->next)));
+  }
+
+  /* Force a rollover on the next poll, while preserving the superbuf
+   * index encoded in rxq_ptr->next. The +1 is necessary to avoid ending
+   * up with exactly superbuf_pkts (which means normal rollover)
+   */
+  rxq_ptr->next += 1 + shm->superbuf_pkts;
+}
+
+
+static inline int efct_poll_rx(ef_vi* vi, int qid, ef_event* evs, int evs_len)
+{
+  ef_vi_rxq_state* qs = &vi->ep_state->rxq;
+  ef_vi_efct_rxq_ptr* rxq_ptr = &qs->rxq_ptr[qid];
+  struct efab_efct_rxq_uk_shm_q* shm = &vi->efct_shm->q[qid];
+  int i;
+
+  /* ef_eventq_poll() has historically never been able to fail, so we
+   * maintain that policy */
+  if( efct_poll_rx_prepare(vi, qid) < 0 )
+    return 0;
 
   /* Avoid crossing a superbuf in a single poll. Otherwise we'd need to check
    * for rollover after each packet. */
@@ -886,30 +933,7 @@ static inline int efct_poll_rx(ef_vi* vi, int qid, ef_event* evs, int evs_len)
        (header->u64[0] & M(ROLLOVER) ||
         (discard_flags = header_status_flags(header) & vi->rx_discard_mask)) ) {
       if( CI_OWORD_FIELD(*header, EFCT_RX_HEADER_ROLLOVER) ) {
-        /* We created the desc->refcnt assuming that this superbuf would be
-         * full of packets. It wasn't, so consume all the unused refs */
-        int nskipped = shm->superbuf_pkts -
-                       pkt_id_to_index_in_superbuf(pkt_id);
-        EF_VI_ASSERT(nskipped > 0);
-        EF_VI_ASSERT(nskipped <= desc->refcnt);
-        desc->refcnt -= nskipped;
-        if( desc->refcnt == 0 )
-          superbuf_free(vi, qid, pkt_id_to_local_superbuf_ix(pkt_id));
-        if( nskipped == 1 ) {
-          /* i.e. the current packet is the one straddling a superbuf
-           * boundary. We consume the last packet of the first superbuf above
-           * (it's the bogus 'manual rollover' packet) and here we consume the
-           * entirety of the current superbuf, which is the one the NIC wants
-           * to get rid of */
-          superbuf_free(vi, qid, pkt_id_to_local_superbuf_ix(
-                                          rxq_ptr_to_pkt_id(rxq_ptr->next)));
-        }
-
-        /* Force a rollover on the next poll, while preserving the superbuf
-         * index encoded in rxq_ptr->next. The +1 is necessary to avoid ending
-         * up with exactly superbuf_pkts (which means normal rollover)
-         */
-        rxq_ptr->next += 1 + shm->superbuf_pkts;
+        efct_rx_handle_rollover_header(vi, qid, pkt_id);
         break;
       }
 
@@ -1415,6 +1439,86 @@ void efct_vi_rxpkt_release(ef_vi* vi, uint32_t pkt_id)
                   pkt_id_to_local_superbuf_ix(pkt_id));
 }
 
+int efct_vi_rx_peek_batch(ef_vi* vi, int qid, efct_rx_pkt_info* pkts, int n)
+{
+  ef_vi_efct_rxq_ptr* rxq_ptr = &vi->ep_state->rxq.rxq_ptr[qid];
+  struct efab_efct_rxq_uk_shm_q* shm = &vi->efct_shm->q[qid];
+  int i;
+
+  EF_VI_ASSERT(vi->nic_type.arch == EF_VI_ARCH_EFCT);
+
+  if( efct_poll_rx_prepare(vi, qid) < 0 )
+    return 0;
+
+  /* As in efct_poll_rx(): never cross a superbuf in a single call, so that
+   * rollover need not be checked per packet.  This also means a whole
+   * batch can be released with a single refcount operation. */
+  n = CI_MIN(n, (int)(shm->superbuf_pkts -
+                      pkt_id_to_index_in_superbuf(rxq_ptr->next)));
+
+  for( i = 0; i < n; ++i ) {
+    const ci_oword_t* header;
+    struct efct_rx_descriptor* desc;
+    uint32_t pkt_id;
+    uint16_t discard_flags = 0;
+
+    header = efct_rx_next_header(vi, rxq_ptr->next);
+    if( header == NULL )
+      break;
+
+    pkt_id = rxq_ptr->prev;
+    desc = efct_rx_desc(vi, pkt_id);
+
+    if(unlikely( header->u64[0] & CHECK_FIELDS ) &&
+       (header->u64[0] & M(ROLLOVER) ||
+        (discard_flags = header_status_flags(header) & vi->rx_discard_mask)) ) {
+      if( CI_OWORD_FIELD(*header, EFCT_RX_HEADER_ROLLOVER) ) {
+        efct_rx_handle_rollover_header(vi, qid, pkt_id);
+        break;
+      }
+    }
+
+    /* assume DP_FRAME_OFFSET_FIXED, as efct_vi_rxpkt_get() does */
+    BUG_ON(CI_OWORD_FIELD(*header, EFCT_RX_HEADER_NEXT_FRAME_LOC) != 1);
+    pkts[i].data = (char*)efct_rx_header(vi, pkt_id) +
+                   EFCT_RX_HEADER_NEXT_FRAME_LOC_1;
+    pkts[i].pkt_id = pkt_id;
+    pkts[i].len = CI_OWORD_FIELD(*header, EFCT_RX_HEADER_PACKET_LENGTH);
+    pkts[i].discard_flags = discard_flags;
+
+    /* This is only necessary for the final packet of each superbuf, storing
+     * metadata from the next superbuf, but it may be faster to do it
+     * unconditionally. */
+    desc->final_timestamp = CI_OWORD_FIELD(*header, EFCT_RX_HEADER_TIMESTAMP);
+    desc->final_ts_status = CI_OWORD_FIELD(*header,
+                                           EFCT_RX_HEADER_TIMESTAMP_STATUS);
+
+    rxq_ptr->prev = rxq_ptr_to_pkt_id(rxq_ptr->next++);
+  }
+
+  return i;
+}
+
+void efct_vi_rxpkt_release_batch(ef_vi* vi, const uint32_t* pkt_ids, int n)
+{
+  int i = 0;
+
+  while( i < n ) {
+    struct efct_rx_descriptor* desc = efct_rx_desc(vi, pkt_ids[i]);
+    int sb = pkt_id_to_global_superbuf_ix(pkt_ids[i]);
+    int j = i + 1;
+
+    while( j < n && pkt_id_to_global_superbuf_ix(pkt_ids[j]) == sb )
+      ++j;
+    EF_VI_ASSERT(desc->refcnt >= j - i);
+    desc->refcnt -= j - i;
+    if( desc->refcnt == 0 )
+      superbuf_free(vi, pkt_id_to_rxq_ix(pkt_ids[i]),
+                    pkt_id_to_local_superbuf_ix(pkt_ids[i]));
+    i = j;
+  }
+}
+
 const void* efct_vi_rx_future_peek(ef_vi* vi)
 {
   uint64_t qs = vi->efct_shm->active_qs;
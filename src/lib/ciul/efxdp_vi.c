@@ -20,27 +20,11 @@
 #include "af_xdp_defs.h"
 #include "logging.h"
 
-/* Currently, AF_XDP requires a system call to start transmitting.
- *
- * There is a limit (undocumented, so we can't rely on it being 16) to the
- * number of packets which will be sent each time. We use the "previous"
- * field to store the last packet known to be sent; if this does not cover
- * all those in the queue, we will try again once a send has completed.
- */
-#define AF_XDP_TX_BATCH_MAX 16
-static int efxdp_tx_need_kick(ef_vi* vi)
-{
-  ef_vi_txq_state* qs = &vi->ep_state->txq;
-  return qs->previous != qs->added;
-}
-
-static void efxdp_tx_kick(ef_vi* vi)
-{
-  if( vi->xdp_kick(vi) == 0 ) {
-    ef_vi_txq_state* qs = &vi->ep_state->txq;
-    qs->previous = qs->added;
-  }
-}
+/* Older kernel headers may not define the need-wakeup interface; the
+ * driver reports at bind time whether the running kernel supports it. */
+#ifndef XDP_RING_NEED_WAKEUP
+#define XDP_RING_NEED_WAKEUP (1 << 0)
+#endif
 
 /* Access the AF_XDP rings, using the offsets provided in the mapped memory.
  * The (fake) event queue pointer must be initialised to point to the start
@@ -60,8 +44,47 @@ static struct efab_af_xdp_offsets* xdp_offsets(ef_vi* vi)
 #define RING_CONSUMER(vi, ring) \
   ((volatile uint32_t*)RING_THING(vi, ring, consumer))
 
+#define RING_FLAGS(vi, ring) \
+  ((volatile uint32_t*)RING_THING(vi, ring, flags))
+
 #define RING_DESC(vi, ring) RING_THING(vi, ring, desc)
 
+/* Currently, AF_XDP requires a system call to start transmitting.
+ *
+ * There is a limit (undocumented, so we can't rely on it being 16) to the
+ * number of packets which will be sent each time. We use the "previous"
+ * field to store the last packet known to be sent; if this does not cover
+ * all those in the queue, we will try again once a send has completed.
+ */
+#define AF_XDP_TX_BATCH_MAX 16
+static int efxdp_tx_need_kick(ef_vi* vi)
+{
+  ef_vi_txq_state* qs = &vi->ep_state->txq;
+
+  if( qs->previous == qs->added )
+    return 0;
+  if( xdp_offsets(vi)->rings.tx.flags != EFAB_AF_XDP_NO_RING_FLAGS ) {
+    /* Ensure our producer update is visible before sampling the flag. */
+    ci_mb();
+    if( ! (*RING_FLAGS(vi, tx) & XDP_RING_NEED_WAKEUP) ) {
+      /* The driver is still running and will consume what we produced
+       * without a kick; it re-checks the ring after raising the flag, so
+       * this cannot lose a wakeup. */
+      qs->previous = qs->added;
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void efxdp_tx_kick(ef_vi* vi)
+{
+  if( vi->xdp_kick(vi) == 0 ) {
+    ef_vi_txq_state* qs = &vi->ep_state->txq;
+    qs->previous = qs->added;
+  }
+}
+
 static int efxdp_ef_vi_transmitv_init(ef_vi* vi, const ef_iovec* iov,
                                       int iov_len, ef_request_id dma_id)
 {
@@ -96,9 +119,16 @@ static void efxdp_ef_vi_transmit_push(ef_vi* vi)
    *  * at least every packets if queue is quarter stuffed.
    */
   EF_VI_BUG_ON(vi->ep_state->txq.added == vi->ep_state->txq.previous);
-  if( vi->ep_state->txq.added - vi->ep_state->txq.removed < 3 ||
-      (vi->ep_state->txq.added ^ vi->ep_state->txq.previous) /
-      (AF_XDP_TX_BATCH_MAX >> 2) )
+  if( xdp_offsets(vi)->rings.tx.flags != EFAB_AF_XDP_NO_RING_FLAGS ) {
+    /* The kernel maintains the ring's need-wakeup flag, so we can let it
+     * coalesce kicks for us: while the driver is running no kick is
+     * issued at all, and one sendto() covers a whole burst. */
+    if( efxdp_tx_need_kick(vi) )
+      efxdp_tx_kick(vi);
+  }
+  else if( vi->ep_state->txq.added - vi->ep_state->txq.removed < 3 ||
+           (vi->ep_state->txq.added ^ vi->ep_state->txq.previous) /
+           (AF_XDP_TX_BATCH_MAX >> 2) )
     efxdp_tx_kick(vi);
 }
 
@@ -261,6 +291,13 @@ static void efxdp_ef_vi_receive_push(ef_vi* vi)
 {
   wmb();
   *RING_PRODUCER(vi, fr) = vi->ep_state->rxq.added;
+  if( xdp_offsets(vi)->rings.fr.flags != EFAB_AF_XDP_NO_RING_FLAGS ) {
+    /* A zerocopy driver that ran dry of fill-ring entries sleeps until
+     * woken; the kick reaches the socket's receive side via the driver. */
+    ci_mb();
+    if( *RING_FLAGS(vi, fr) & XDP_RING_NEED_WAKEUP )
+      vi->xdp_kick(vi);
+  }
 }
 
 static void efxdp_ef_eventq_prime(ef_vi* vi)
@@ -72,4 +72,55 @@ int ef_eventq_wait(ef_vi* evq, ef_driver_handle fd,
   return ci_resource_op(fd, &op);
 }
 
+
+/* Calibrate the free-running cycle counter against the system clock.
+ * Done once, at configuration time, so a crude busy-wait is fine. */
+static uint64_t tx_compl_ticks_per_usec(void)
+{
+  static uint64_t cached;
+
+  if( cached == 0 ) {
+    struct timespec s, e;
+    uint64_t f0, f1;
+    int64_t ns;
+    clock_gettime(CLOCK_MONOTONIC, &s);
+    f0 = ef_vi_frc64();
+    do {
+      clock_gettime(CLOCK_MONOTONIC, &e);
+      ns = (e.tv_sec - s.tv_sec) * (int64_t) 1000000000
+        + (e.tv_nsec - s.tv_nsec);
+    } while( ns < 2000000 );
+    f1 = ef_vi_frc64();
+    cached = (f1 - f0) * 1000 / ns;
+    if( cached == 0 )
+      cached = 1;
+  }
+  return cached;
+}
+
+
+int ef_vi_transmit_completion_moderation(ef_vi* vi, int n_descs,
+                                         int timeout_usec)
+{
+  if( vi->nic_type.arch != EF_VI_ARCH_EF10 )
+    return -EOPNOTSUPP;
+  if( n_descs < 0 || n_descs > EF_VI_TRANSMIT_BATCH || timeout_usec < 0 )
+    return -EINVAL;
+  /* Merging completions would confuse timestamp, TX alternative and CTPIO
+   * fallback accounting, all of which need to see each hardware event. */
+  if( vi->vi_flags & (EF_VI_TX_TIMESTAMPS | EF_VI_TX_ALT | EF_VI_TX_CTPIO) )
+    return -EINVAL;
+
+  if( n_descs == 0 ) {
+    vi->tx_compl_thresh = 0;
+    /* Make sure any held completion is reported by the next poll. */
+    vi->tx_compl_deadline = 0;
+    return 0;
+  }
+  vi->tx_compl_timeout_ticks =
+    (uint64_t) timeout_usec * tx_compl_ticks_per_usec();
+  vi->tx_compl_thresh = n_descs;
+  return 0;
+}
+
 /*! \cidoxg_end */
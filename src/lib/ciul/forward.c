@@ -0,0 +1,404 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  NIC-to-NIC forwarding engine.
+**   \date  2026/08/30
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/* Supported form of the RX-to-TX forwarding pattern demonstrated by
+ * tests/ef_vi/efforward.c.  All packet buffers live in one memory region
+ * registered with both protection domains, so a buffer filled by RX DMA
+ * on one port is queued for TX DMA on the other by descriptor alone.
+ */
+
+#include <etherfabric/vi.h>
+#include <etherfabric/pd.h>
+#include <etherfabric/memreg.h>
+#include <etherfabric/capabilities.h>
+#include <etherfabric/forward.h>
+#include "ef_vi_internal.h"
+#include "logging.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <net/if.h>
+#include <sys/mman.h>
+
+
+/* Hardware delivers at most ef_vi_receive_buffer_len() bytes to each
+ * buffer (default 1792), RX DMA will not cross a 4K boundary, and buffers
+ * should be 64-byte aligned for best performance, so buffers are always
+ * 2K in size. */
+#define FWD_PKT_BUF_SIZE   2048
+
+#define FWD_RX_RING_SIZE   512
+#define FWD_TX_RING_SIZE   2048
+
+#define FWD_REFILL_BATCH   64
+
+#define FWD_HUGE_PAGE_SIZE 0x200000
+
+
+struct ef_fwd_pkt_buf {
+  /* I/O address of the RX DMA destination in this buffer, per port. */
+  ef_addr                rx_ef_addr[2];
+  /* I/O address of the frame start (past the RX prefix), per port. */
+  ef_addr                tx_ef_addr[2];
+  /* Buffer id used in descriptors and events. */
+  int                    id;
+  struct ef_fwd_pkt_buf* next;
+};
+
+/* Align the DMA destination on EF_VI_DMA_ALIGN for best performance. */
+#define FWD_RX_DMA_OFF                                                  \
+  ((sizeof(struct ef_fwd_pkt_buf) + EF_VI_DMA_ALIGN - 1) &              \
+   ~(size_t) (EF_VI_DMA_ALIGN - 1))
+
+
+static inline struct ef_fwd_pkt_buf* fwd_pkt_buf(ef_fwd_engine* fwd, int id)
+{
+  EF_VI_ASSERT((unsigned) id < (unsigned) fwd->fwd_n_pkt_bufs);
+  return (void*) ((char*) fwd->fwd_pkt_mem + (size_t) id * FWD_PKT_BUF_SIZE);
+}
+
+
+/* Stagger DMA start addresses between adjacent buffers to make better use
+ * of memory channels and cache. */
+static inline int fwd_addr_offset(int id)
+{
+  return ( id % 2 ) * EF_VI_DMA_ALIGN;
+}
+
+
+static inline void fwd_pkt_buf_free(ef_fwd_engine* fwd,
+                                    struct ef_fwd_pkt_buf* pb)
+{
+  /* LIFO to minimise the working set. */
+  pb->next = fwd->fwd_free_pool;
+  fwd->fwd_free_pool = pb;
+  ++fwd->fwd_free_pool_n;
+}
+
+
+static void fwd_refill_rx_ring(ef_fwd_engine* fwd, int port_i)
+{
+  ef_vi* vi = &fwd->fwd_port[port_i].fwd_vi;
+  struct ef_fwd_pkt_buf* pb;
+  int i;
+
+  if( ef_vi_receive_space(vi) < FWD_REFILL_BATCH ||
+      fwd->fwd_free_pool_n < FWD_REFILL_BATCH )
+    return;
+
+  for( i = 0; i < FWD_REFILL_BATCH; ++i ) {
+    pb = fwd->fwd_free_pool;
+    fwd->fwd_free_pool = pb->next;
+    --fwd->fwd_free_pool_n;
+    ef_vi_receive_init(vi, pb->rx_ef_addr[port_i], pb->id);
+  }
+  ef_vi_receive_push(vi);
+}
+
+
+/* Queue a received packet for transmit on the other port.  Returns 1 if
+ * the packet was queued, else 0. */
+static int fwd_handle_rx(ef_fwd_engine* fwd, int rx_port_i, int id, int len)
+{
+  int tx_port_i = 2 - 1 - rx_port_i;
+  ef_fwd_port* rx_port = &fwd->fwd_port[rx_port_i];
+  ef_fwd_port* tx_port = &fwd->fwd_port[tx_port_i];
+  struct ef_fwd_pkt_buf* pb = fwd_pkt_buf(fwd, id);
+  int rc;
+
+  ++rx_port->fwd_n_rx_pkts;
+
+  if( fwd->fwd_rewrite != NULL ) {
+    char* frame = (char*) pb + FWD_RX_DMA_OFF + fwd_addr_offset(id)
+      + ef_vi_receive_prefix_len(&rx_port->fwd_vi);
+    len = fwd->fwd_rewrite(frame, len, rx_port_i, fwd->fwd_rewrite_arg);
+    if( len < 0 || len > EF_FWD_PKT_BUF_SPACE ) {
+      ++rx_port->fwd_n_drops;
+      fwd_pkt_buf_free(fwd, pb);
+      return 0;
+    }
+  }
+
+  rc = ef_vi_transmit_init(&tx_port->fwd_vi, pb->tx_ef_addr[tx_port_i],
+                           len, pb->id);
+  if( rc == 0 ) {
+    ++tx_port->fwd_tx_pending;
+    return 1;
+  }
+
+  /* TXQ full.  Drop rather than queue in software: an inline device must
+   * shed load somewhere, and the TX ring is already deep. */
+  EF_VI_ASSERT(rc == -EAGAIN);
+  ++tx_port->fwd_n_tx_full_drops;
+  fwd_pkt_buf_free(fwd, pb);
+  return 0;
+}
+
+
+static int fwd_handle_batched_rx(ef_fwd_engine* fwd, int rx_port_i, int id)
+{
+  ef_fwd_port* rx_port = &fwd->fwd_port[rx_port_i];
+  void* dma_ptr = (char*) fwd_pkt_buf(fwd, id) + FWD_RX_DMA_OFF
+    + fwd_addr_offset(id);
+  uint16_t len;
+  int rc;
+
+  rc = ef_vi_receive_get_bytes(&rx_port->fwd_vi, dma_ptr, &len);
+  if( rc < 0 ) {
+    ++rx_port->fwd_n_drops;
+    fwd_pkt_buf_free(fwd, fwd_pkt_buf(fwd, id));
+    return 0;
+  }
+  return fwd_handle_rx(fwd, rx_port_i, id, len);
+}
+
+
+static void fwd_handle_rx_discard(ef_fwd_engine* fwd, int rx_port_i, int id)
+{
+  ++fwd->fwd_port[rx_port_i].fwd_n_drops;
+  fwd_pkt_buf_free(fwd, fwd_pkt_buf(fwd, id));
+}
+
+
+int ef_fwd_engine_poll(ef_fwd_engine* fwd)
+{
+  int n_fwd = 0;
+  int i, j, k;
+
+  for( i = 0; i < 2; ++i ) {
+    ef_fwd_port* port = &fwd->fwd_port[i];
+    ef_vi* vi = &port->fwd_vi;
+    ef_event evs[EF_VI_EVENT_POLL_MIN_EVS];
+    int n_ev;
+
+    /* One doorbell covers all descriptors queued since the last pass. */
+    if( port->fwd_tx_pending ) {
+      ef_vi_transmit_push(vi);
+      port->fwd_tx_pending = 0;
+    }
+
+    n_ev = ef_eventq_poll(vi, evs, sizeof(evs) / sizeof(evs[0]));
+
+    for( j = 0; j < n_ev; ++j ) {
+      switch( EF_EVENT_TYPE(evs[j]) ) {
+      case EF_EVENT_TYPE_RX:
+        /* Jumbos spanning multiple buffers are not forwarded. */
+        if( ! EF_EVENT_RX_SOP(evs[j]) || EF_EVENT_RX_CONT(evs[j]) ) {
+          fwd_handle_rx_discard(fwd, i, EF_EVENT_RX_RQ_ID(evs[j]));
+          break;
+        }
+        n_fwd += fwd_handle_rx(fwd, i, EF_EVENT_RX_RQ_ID(evs[j]),
+                               EF_EVENT_RX_BYTES(evs[j]) -
+                               ef_vi_receive_prefix_len(vi));
+        break;
+      case EF_EVENT_TYPE_RX_MULTI: {
+        ef_request_id ids[EF_VI_RECEIVE_BATCH];
+        int n_rx = ef_vi_receive_unbundle(vi, &evs[j], ids);
+        for( k = 0; k < n_rx; ++k )
+          n_fwd += fwd_handle_batched_rx(fwd, i, ids[k]);
+        break;
+      }
+      case EF_EVENT_TYPE_TX: {
+        ef_request_id ids[EF_VI_TRANSMIT_BATCH];
+        int n_tx = ef_vi_transmit_unbundle(vi, &evs[j], ids);
+        for( k = 0; k < n_tx; ++k )
+          fwd_pkt_buf_free(fwd, fwd_pkt_buf(fwd, ids[k]));
+        break;
+      }
+      case EF_EVENT_TYPE_RX_DISCARD:
+        fwd_handle_rx_discard(fwd, i, EF_EVENT_RX_DISCARD_RQ_ID(evs[j]));
+        break;
+      case EF_EVENT_TYPE_RX_MULTI_DISCARD: {
+        ef_request_id ids[EF_VI_RECEIVE_BATCH];
+        int n_rx = ef_vi_receive_unbundle(vi, &evs[j], ids);
+        for( k = 0; k < n_rx; ++k )
+          fwd_handle_rx_discard(fwd, i, ids[k]);
+        break;
+      }
+      default:
+        LOGV(ef_log("%s: unexpected event %d", __FUNCTION__,
+                    (int) EF_EVENT_TYPE(evs[j])));
+        break;
+      }
+    }
+
+    fwd_refill_rx_ring(fwd, i);
+  }
+
+  return n_fwd;
+}
+
+
+static int fwd_port_init(ef_fwd_engine* fwd, int port_i, const char* intf)
+{
+  ef_fwd_port* port = &fwd->fwd_port[port_i];
+  unsigned vi_flags = EF_VI_FLAGS_DEFAULT;
+  int i, rc;
+
+  rc = ef_driver_open(&port->fwd_dh);
+  if( rc < 0 )
+    return rc;
+
+  if( fwd->fwd_flags & EF_FWD_F_RX_MERGE )
+    vi_flags |= EF_VI_RX_EVENT_MERGE;
+
+  rc = ef_pd_alloc_by_name(&port->fwd_pd, port->fwd_dh, intf, EF_PD_DEFAULT);
+  if( rc < 0 )
+    goto fail_close;
+
+  rc = ef_vi_alloc_from_pd(&port->fwd_vi, port->fwd_dh, &port->fwd_pd,
+                           port->fwd_dh, -1, FWD_RX_RING_SIZE,
+                           FWD_TX_RING_SIZE, NULL, -1, vi_flags);
+  if( rc < 0 )
+    goto fail_pd;
+
+  rc = ef_memreg_alloc(&port->fwd_memreg, port->fwd_dh, &port->fwd_pd,
+                       port->fwd_dh, fwd->fwd_pkt_mem,
+                       fwd->fwd_pkt_mem_size);
+  if( rc < 0 )
+    goto fail_vi;
+
+  for( i = 0; i < fwd->fwd_n_pkt_bufs; ++i ) {
+    struct ef_fwd_pkt_buf* pb = fwd_pkt_buf(fwd, i);
+    pb->rx_ef_addr[port_i] =
+      ef_memreg_dma_addr(&port->fwd_memreg, i * FWD_PKT_BUF_SIZE)
+      + FWD_RX_DMA_OFF + fwd_addr_offset(i);
+    pb->tx_ef_addr[port_i] = pb->rx_ef_addr[port_i]
+      + ef_vi_receive_prefix_len(&port->fwd_vi);
+  }
+  return 0;
+
+ fail_vi:
+  ef_vi_free(&port->fwd_vi, port->fwd_dh);
+ fail_pd:
+  ef_pd_free(&port->fwd_pd, port->fwd_dh);
+ fail_close:
+  ef_driver_close(port->fwd_dh);
+  return rc;
+}
+
+
+static int fwd_port_add_filters(ef_fwd_port* port)
+{
+  ef_filter_spec fs;
+  int rc;
+
+  ef_filter_spec_init(&fs, EF_FILTER_FLAG_NONE);
+  if( (rc = ef_filter_spec_set_unicast_all(&fs)) < 0 )
+    return rc;
+  if( (rc = ef_vi_filter_add(&port->fwd_vi, port->fwd_dh, &fs, NULL)) < 0 )
+    return rc;
+  ef_filter_spec_init(&fs, EF_FILTER_FLAG_NONE);
+  if( (rc = ef_filter_spec_set_multicast_all(&fs)) < 0 )
+    return rc;
+  return ef_vi_filter_add(&port->fwd_vi, port->fwd_dh, &fs, NULL);
+}
+
+
+static void fwd_port_free(ef_fwd_engine* fwd, int port_i)
+{
+  ef_fwd_port* port = &fwd->fwd_port[port_i];
+  ef_memreg_free(&port->fwd_memreg, port->fwd_dh);
+  ef_vi_free(&port->fwd_vi, port->fwd_dh);
+  ef_pd_free(&port->fwd_pd, port->fwd_dh);
+  ef_driver_close(port->fwd_dh);
+}
+
+
+int ef_fwd_engine_init(ef_fwd_engine* fwd, const char* intf_a,
+                       const char* intf_b, unsigned flags)
+{
+  int i, rc, n_rx_ports;
+
+  memset(fwd, 0, sizeof(*fwd));
+  fwd->fwd_flags = flags;
+
+  /* Worst case to fill the TX and RX rings of each forwarding direction. */
+  n_rx_ports = (flags & EF_FWD_F_UNIDIRECTIONAL) ? 1 : 2;
+  fwd->fwd_n_pkt_bufs = n_rx_ports * (FWD_RX_RING_SIZE + FWD_TX_RING_SIZE);
+  fwd->fwd_pkt_mem_size = (size_t) fwd->fwd_n_pkt_bufs * FWD_PKT_BUF_SIZE;
+  fwd->fwd_pkt_mem_size = (fwd->fwd_pkt_mem_size + FWD_HUGE_PAGE_SIZE - 1)
+    & ~(size_t) (FWD_HUGE_PAGE_SIZE - 1);
+
+  /* Prefer explicit huge pages; otherwise huge-page-aligned memory gives
+   * the best chance of transparent huge pages. */
+  fwd->fwd_pkt_mem = mmap(NULL, fwd->fwd_pkt_mem_size,
+                          PROT_READ | PROT_WRITE,
+                          MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+  if( fwd->fwd_pkt_mem != MAP_FAILED ) {
+    fwd->fwd_pkt_mem_is_mmap = 1;
+  }
+  else {
+    fwd->fwd_pkt_mem = NULL;
+    rc = posix_memalign(&fwd->fwd_pkt_mem, FWD_HUGE_PAGE_SIZE,
+                        fwd->fwd_pkt_mem_size);
+    if( rc != 0 )
+      return -rc;
+  }
+
+  for( i = 0; i < fwd->fwd_n_pkt_bufs; ++i ) {
+    struct ef_fwd_pkt_buf* pb = fwd_pkt_buf(fwd, i);
+    pb->id = i;
+    fwd_pkt_buf_free(fwd, pb);
+  }
+
+  rc = fwd_port_init(fwd, 0, intf_a);
+  if( rc < 0 )
+    goto fail_mem;
+  rc = fwd_port_init(fwd, 1, intf_b);
+  if( rc < 0 )
+    goto fail_port0;
+
+  for( i = 0; i < n_rx_ports; ++i ) {
+    while( ef_vi_receive_space(&fwd->fwd_port[i].fwd_vi) > FWD_REFILL_BATCH )
+      fwd_refill_rx_ring(fwd, i);
+    if( ! (flags & EF_FWD_F_NO_FILTERS) ) {
+      rc = fwd_port_add_filters(&fwd->fwd_port[i]);
+      if( rc < 0 )
+        goto fail_port1;
+    }
+  }
+
+  return 0;
+
+ fail_port1:
+  fwd_port_free(fwd, 1);
+ fail_port0:
+  fwd_port_free(fwd, 0);
+ fail_mem:
+  if( fwd->fwd_pkt_mem_is_mmap )
+    munmap(fwd->fwd_pkt_mem, fwd->fwd_pkt_mem_size);
+  else
+    free(fwd->fwd_pkt_mem);
+  fwd->fwd_pkt_mem = NULL;
+  return rc;
+}
+
+
+void ef_fwd_engine_set_rewrite(ef_fwd_engine* fwd, ef_fwd_rewrite_fn fn,
+                               void* arg)
+{
+  fwd->fwd_rewrite = fn;
+  fwd->fwd_rewrite_arg = arg;
+}
+
+
+void ef_fwd_engine_free(ef_fwd_engine* fwd)
+{
+  fwd_port_free(fwd, 1);
+  fwd_port_free(fwd, 0);
+  if( fwd->fwd_pkt_mem_is_mmap )
+    munmap(fwd->fwd_pkt_mem, fwd->fwd_pkt_mem_size);
+  else
+    free(fwd->fwd_pkt_mem);
+  fwd->fwd_pkt_mem = NULL;
+}
@@ -45,7 +45,8 @@ LIB_SRCS	+=		\
 		vi_prime.c	\
 		capabilities.c	\
 		smartnic_exts.c	\
-		ctpio.c
+		ctpio.c		\
+		forward.c
 
 # librt is needed on old glibc, e.g. on RHEL 6
 MMAKE_DIR_LINKFLAGS	:= $(MMAKE_DIR_LINKFLAGS) -lrt
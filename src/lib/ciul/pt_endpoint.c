@@ -528,7 +528,10 @@ int __ef_vi_alloc(ef_vi* vi, ef_driver_handle vi_dh,
     mem_mmap_ptr = mem_mmap_ptr_orig = (char*) p;
   }
 
-  if( vi_flags & EF_VI_TX_CTPIO ) {
+  /* EF100 has no CTPIO aperture to map: cut-through was requested when the
+   * TXQ was initialised and sends go through the DMA fallback path. */
+  if( vi_flags & EF_VI_TX_CTPIO &&
+      ra.u.vi_out.nic_arch != EFHW_ARCH_EF100 ) {
     rc = ci_resource_mmap(vi_dh, ra.out_id.index, EFCH_VI_MMAP_CTPIO,
 			  CTPIO_MMAP_LEN, &p);
     if( rc < 0 ) {
@@ -619,7 +622,8 @@ int __ef_vi_alloc(ef_vi* vi, ef_driver_handle vi_dh,
   rc = ef_vi_add_queue(evq, vi);
   BUG_ON(rc != q_label);
 
-  if( vi->vi_flags & EF_VI_TX_CTPIO )
+  /* Write-buffer pacing only applies where there is an aperture to pace. */
+  if( vi->vi_flags & EF_VI_TX_CTPIO && nic_type.arch != EF_VI_ARCH_EF100 )
     ef_vi_ctpio_init(vi);
   if( vi->vi_is_packed_stream )
     ef_vi_packed_stream_update_credit(vi);
@@ -26,6 +26,24 @@ int ef_vi_receive_post(ef_vi* vi, ef_addr addr, ef_request_id dma_id)
 }
 
 
+int ef_vi_receive_set_headroom(ef_vi* vi, unsigned headroom)
+{
+  /* Headroom works by offsetting the address the application posts, so it
+   * is only available where the application owns buffer placement and the
+   * hardware accepts byte-aligned RX addresses.  Packed stream and AF_XDP
+   * impose their own buffer layouts, and on X3-series adapters the
+   * buffers belong to the NIC. */
+  if( (vi->nic_type.arch != EF_VI_ARCH_EF10 &&
+       vi->nic_type.arch != EF_VI_ARCH_EF100) ||
+      (vi->vi_flags & EF_VI_RX_PACKED_STREAM) )
+    return -EOPNOTSUPP;
+  if( headroom >= vi->rx_buffer_len )
+    return -EINVAL;
+  vi->rx_headroom = headroom;
+  return 0;
+}
+
+
 int ef_vi_receive_unbundle(ef_vi* vi, const ef_event* ev,
                            ef_request_id* ids)
 {
@@ -54,6 +72,49 @@ int ef_vi_receive_unbundle(ef_vi* vi, const ef_event* ev,
 }
 
 
+int ef_vi_receive_chain_event(ef_vi* vi, const ef_event* ev,
+                              ef_vi_rx_chain* chain)
+{
+  uint32_t bytes;
+  int sop;
+
+  if(unlikely( EF_EVENT_TYPE(*ev) != EF_EVENT_TYPE_RX )) {
+    /* Discards (and anything else unexpected) abort the frame in
+     * progress; the caller recycles whatever the chain collected. */
+    chain->in_frame = 0;
+    return -EPROTO;
+  }
+
+  sop = EF_EVENT_RX_SOP(*ev) != 0;
+  if(unlikely( sop == chain->in_frame ||
+               chain->n_frags == EF_VI_RECEIVE_CHAIN_MAX_FRAGS )) {
+    /* Either we lost sync with the descriptor stream (eg. an earlier
+     * fragment was discarded) or the frame is too long to describe. */
+    chain->in_frame = 0;
+    return -EPROTO;
+  }
+
+  if( sop ) {
+    chain->total_bytes = 0;
+    chain->n_frags = 0;
+    chain->in_frame = 1;
+  }
+
+  /* The hardware reports the running byte total for the frame; convert
+   * back to per-fragment lengths so each entry describes one buffer. */
+  bytes = EF_EVENT_RX_BYTES(*ev);
+  chain->rq_ids[chain->n_frags] = EF_EVENT_RX_RQ_ID(*ev);
+  chain->frag_bytes[chain->n_frags] = bytes - chain->total_bytes;
+  chain->total_bytes = bytes;
+  ++chain->n_frags;
+
+  if( EF_EVENT_RX_CONT(*ev) )
+    return 0;
+  chain->in_frame = 0;
+  return 1;
+}
+
+
 int
 ef_vi_receive_get_bytes(ef_vi* vi, const void* pkt, uint16_t* bytes_out)
 {
@@ -33,6 +33,31 @@ void ef_vi_transmit_init_undo(ef_vi* vi)
 }
 
 
+int ef_vi_transmitv_batch(ef_vi* vi, const ef_vi_tx_batch_entry* pkts,
+                          int n_pkts)
+{
+  int i, rc;
+
+  EF_VI_BUG_ON(n_pkts <= 0);
+  EF_VI_BUG_ON(pkts == NULL);
+
+  for( i = 0; i < n_pkts; ++i ) {
+    rc = ef_vi_transmitv_init(vi, pkts[i].iov, pkts[i].iov_len,
+                              pkts[i].dma_id);
+    if( rc < 0 ) {
+      if( i == 0 )
+        return rc;
+      break;
+    }
+  }
+
+  /* A single barrier and doorbell covers the whole batch. */
+  wmb();
+  ef_vi_transmit_push(vi);
+  return i;
+}
+
+
 int ef_vi_transmit_unbundle(ef_vi* vi, const ef_event* ev,
 			    ef_request_id* ids)
 {
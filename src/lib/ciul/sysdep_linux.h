@@ -15,6 +15,7 @@
 #include <linux/errno.h>
 #include <linux/string.h>
 #include <linux/nodemask.h>
+#include <linux/timex.h>
 
 
 typedef dma_addr_t ef_vi_dma_addr_t;
@@ -51,6 +52,13 @@ static inline int sys_is_numa(void)
 }
 
 
+/* Free-running cycle counter, used for TX completion moderation. */
+static inline uint64_t ef_vi_frc64(void)
+{
+  return get_cycles();
+}
+
+
 #ifndef mmiowb
 /* Kernels from 5.2 onwards no longer have mmiowb(), because it is now
  * implied by spin_unlock() on architectures that require it.
@@ -208,6 +208,27 @@ ef_vi_inline void writel(uint32_t data, volatile void *addr)
 #endif
 
 
+/* Free-running cycle counter, used for TX completion moderation. */
+ef_vi_inline uint64_t ef_vi_frc64(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  uint32_t lo, hi;
+  __asm__ __volatile__("rdtsc" : "=a" (lo), "=d" (hi));
+  return ((uint64_t) hi << 32) | lo;
+#elif defined(__aarch64__)
+  uint64_t val;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r" (val));
+  return val;
+#elif defined(__PPC__)
+  uint64_t val;
+  __asm__ __volatile__("mfspr %0, 268" : "=r" (val));
+  return val;
+#else
+# error "Need to define ef_vi_frc64"
+#endif
+}
+
+
 #define BUG_ON(exp)  assert(!(exp))
 
 
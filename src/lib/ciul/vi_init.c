@@ -271,6 +271,18 @@ void ef_vi_init_rxq(struct ef_vi* vi, int ring_size, void* descriptors,
   vi->vi_rxq.descriptors = descriptors;
   vi->vi_rxq.ids = ids;
   vi->rx_prefix_len = prefix_len;
+  /* Resolve the prefix layout now so that per-packet parsing can use
+   * fixed-offset loads rather than indirecting through the offset/mask
+   * fields at runtime. */
+  if( prefix_len == 0 )
+    vi->rx_prefix_fmt = EF_VI_RX_PREFIX_FMT_NONE;
+  else if( vi->nic_type.arch == EF_VI_ARCH_EF10 )
+    vi->rx_prefix_fmt = (vi->vi_flags & EF_VI_RX_TIMESTAMPS) ?
+                        EF_VI_RX_PREFIX_FMT_DZ_TS : EF_VI_RX_PREFIX_FMT_DZ;
+  else if( vi->nic_type.arch == EF_VI_ARCH_EF100 )
+    vi->rx_prefix_fmt = EF_VI_RX_PREFIX_FMT_GZ;
+  else
+    vi->rx_prefix_fmt = EF_VI_RX_PREFIX_FMT_NONE;
   vi->inited |= EF_VI_INITED_RXQ;
 }
 
@@ -24,6 +24,21 @@
   "Packet length"
 
 
+/* The fixed-offset prefix parsers exposed in ef_vi.h hard-code the field
+ * locations; make sure they stay in step with the hardware definitions. */
+static inline void ef_vi_rx_prefix_fmt_assertions(void)
+{
+  EF_VI_BUILD_ASSERT(EF_VI_RX_PREFIX_DZ_LEN == ES_DZ_RX_PREFIX_SIZE);
+  EF_VI_BUILD_ASSERT(EF_VI_RX_PREFIX_DZ_PKTLEN_OFST ==
+                     ES_DZ_RX_PREFIX_PKTLEN_OFST);
+  EF_VI_BUILD_ASSERT(EF_VI_RX_PREFIX_DZ_TSTAMP_OFST ==
+                     ES_DZ_RX_PREFIX_TSTAMP_OFST);
+  EF_VI_BUILD_ASSERT(ESF_GZ_RX_PREFIX_LENGTH_LBN == 0);
+  EF_VI_BUILD_ASSERT(EF_VI_RX_PREFIX_GZ_LENGTH_BITS ==
+                     ESF_GZ_RX_PREFIX_LENGTH_WIDTH);
+}
+
+
 static const ef_vi_layout_entry layout_no_prefix = {
   .evle_type = EF_VI_LAYOUT_FRAME,
   .evle_offset = 0,
@@ -29,3 +29,29 @@ int ef_vi_prime(ef_vi* vi, ef_driver_handle dh, unsigned current_ptr)
     return ci_resource_prime(dh, &op);
   }
 }
+
+
+int ef_vi_get_irq(ef_vi* vi, ef_driver_handle dh, unsigned* irq_out)
+{
+  ci_resource_op_t op;
+  int rc;
+
+  op.op = CI_RSOP_VI_GET_IRQ;
+  op.id = efch_make_resource_id(vi->vi_resource_id);
+  rc = ci_resource_op(dh, &op);
+  if( rc < 0 )
+    return rc;
+  *irq_out = op.u.vi_get_irq.out_irq;
+  return 0;
+}
+
+
+int ef_vi_irq_affinity(ef_vi* vi, ef_driver_handle dh, int cpu)
+{
+  ci_resource_op_t op;
+
+  op.op = CI_RSOP_VI_IRQ_AFFINITY;
+  op.id = efch_make_resource_id(vi->vi_resource_id);
+  op.u.vi_irq_affinity.cpu = cpu;
+  return ci_resource_op(dh, &op);
+}
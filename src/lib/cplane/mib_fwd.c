@@ -51,7 +51,7 @@ weight_check_match(struct cp_fwd_table* fwd_table,
 {
   struct cp_fwd_row* fwd = cp_get_fwd_by_id(fwd_table, fwd_id);
   ci_uint32 val = *(ci_uint32*)arg;
-  return cp_fwd_weight_match(val, &fwd->data->weight);
+  return cp_fwd_weight_match(val, &cp_get_fwd_data_current(fwd)->weight);
 }
 
 
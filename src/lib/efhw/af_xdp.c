@@ -441,6 +441,16 @@ fail_sock:
   return rc;
 }
 
+/* Tell the consumers of a set of ring offsets that the kernel will not
+ * maintain the need-wakeup flags, so every push must be followed by a kick. */
+static void xdp_disable_ring_flags(struct efab_af_xdp_offsets_rings* rings)
+{
+  rings->rx.flags = EFAB_AF_XDP_NO_RING_FLAGS;
+  rings->tx.flags = EFAB_AF_XDP_NO_RING_FLAGS;
+  rings->fr.flags = EFAB_AF_XDP_NO_RING_FLAGS;
+  rings->cr.flags = EFAB_AF_XDP_NO_RING_FLAGS;
+}
+
 /* Bind an AF_XDP socket to an interface */
 static int xdp_bind(struct socket* sock, int ifindex, unsigned queue, unsigned flags)
 {
@@ -653,10 +663,12 @@ static int xdp_create_ring(struct socket* sock,
   kern_offset->producer = kern_base + xdp_offset->producer;
   kern_offset->consumer = kern_base + xdp_offset->consumer;
   kern_offset->desc     = kern_base + xdp_offset->desc;
+  kern_offset->flags    = kern_base + xdp_offset->flags;
 
   user_offset->producer = user_base + xdp_offset->producer;
   user_offset->consumer = user_base + xdp_offset->consumer;
   user_offset->desc     = user_base + xdp_offset->desc;
+  user_offset->flags    = user_base + xdp_offset->flags;
 
   return 0;
 }
@@ -878,8 +890,31 @@ static int af_xdp_init(struct efhw_nic* nic, int instance,
   if( rc < 0 )
     goto fail;
 
+  /* Ask the kernel to maintain the ring need-wakeup flags so that
+   * consumers can elide kicks while the driver is running; we fall back
+   * below if the kernel is too old to understand the request. */
+  vi->flags |= XDP_USE_NEED_WAKEUP;
+
   /* TODO AF_XDP: currently instance number matches net_device channel */
   rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags);
+  if( rc == -EINVAL && (vi->flags & XDP_USE_NEED_WAKEUP) ) {
+    /* Kernel without need-wakeup support: bind without it and tell both
+     * the kernel and userland consumers to kick unconditionally. */
+    vi->flags &= ~XDP_USE_NEED_WAKEUP;
+    xdp_disable_ring_flags(&vi->kernel_offsets.rings);
+    xdp_disable_ring_flags(&user_offsets->rings);
+    rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags);
+  }
+  if( (rc == -EOPNOTSUPP || rc == -ENOTSUPP) && (vi->flags & XDP_ZEROCOPY) ) {
+    /* Driver without XDP_ZEROCOPY support: bind in copy mode rather than
+     * failing the stack.  The socket still works, at the cost of a kernel
+     * copy per packet. */
+    EFHW_WARN("%s: %s queue %d does not support XDP_ZEROCOPY;"
+              " falling back to copy mode",
+              __func__, nic->net_dev->name, instance);
+    vi->flags = (vi->flags & ~XDP_ZEROCOPY) | XDP_COPY;
+    rc = xdp_bind(sock, nic->net_dev->ifindex, instance, vi->flags);
+  }
   if( rc == -EBUSY ) {
     /* AF_XDP resource release happens asynchronously - the socket through RCU
      * and the associated umem through deferred work on the global workqueue.
@@ -915,6 +950,18 @@ static int af_xdp_dmaq_kick(struct efhw_nic *nic, int instance)
   if( vi == NULL )
     return -ENODEV;
 
+  /* A zerocopy driver that has run out of fill-ring entries asks to be
+   * woken via the ring's need-wakeup flag, and that wakeup must come from
+   * the receive side of the socket. */
+  if( vi->kernel_offsets.rings.fr.flags != EFAB_AF_XDP_NO_RING_FLAGS ) {
+    const volatile uint32_t* flags =
+      (void*)((char*)&vi->kernel_offsets + vi->kernel_offsets.rings.fr.flags);
+    if( *flags & XDP_RING_NEED_WAKEUP ) {
+      struct msghdr rmsg = {.msg_flags = MSG_DONTWAIT};
+      kernel_recvmsg(vi->sock, &rmsg, NULL, 0, 0, MSG_DONTWAIT);
+    }
+  }
+
   return kernel_sendmsg(vi->sock, &msg, NULL, 0, 0);
 }
 
@@ -1164,6 +1211,13 @@ static bool af_xdp_accept_vi_constraints(struct efhw_nic *nic, int low,
 {
 	struct efhw_vi_constraints *avc = arg;
 
+	/* Each VI instance binds the same-numbered net_device queue, so an
+	 * instance beyond the device's real queue count could only fail
+	 * later, at bind time.  Refusing it here lets the allocator place
+	 * the VI on another queue instead. */
+	if( nic->net_dev != NULL && low >= nic->net_dev->real_num_rx_queues )
+		return false;
+
 	if( avc->channel >= 0 )
 		return avc->channel == low;
 
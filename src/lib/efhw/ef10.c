@@ -2522,7 +2522,10 @@ int
 ef10_ef100_filter_query(struct efhw_nic *nic, int filter_id,
                         struct efhw_filter_info *info)
 {
-  return -EOPNOTSUPP;
+	/* EF10/EF100 firmware keeps no per-filter match counter that
+	 * MC_CMD_FILTER_OP can read back, so there is nothing useful we can
+	 * report here. */
+	return -EOPNOTSUPP;
 }
 
 int
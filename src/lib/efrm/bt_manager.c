@@ -34,6 +34,67 @@
 #include <ci/driver/efab/hardware.h>
 #include <ci/efhw/efhw_buftable.h>
 
+/* Maximum number of unused hardware chunks to cache per manager.  Large
+ * registrations (multi-GB arenas mapped with high-order entries) are torn
+ * down and re-built on failover; re-using the chunks halves the number of
+ * MCDI round-trips taken to re-register.  The cache is bounded because
+ * buffer-table chunks are a hardware resource shared with other functions,
+ * and is dropped when the PD is released or the NIC is reset. */
+#define EFRM_BT_MANAGER_CACHE_MAX 256
+
+static struct efhw_buffer_table_block *
+efrm_bt_cached_block_get(struct efrm_bt_manager *manager)
+{
+	struct efhw_buffer_table_block *block;
+
+	spin_lock_bh(&manager->btm_lock);
+	block = manager->btm_cached_blocks;
+	if (block != NULL) {
+		manager->btm_cached_blocks = block->btb_next;
+		manager->btm_cached_n--;
+	}
+	spin_unlock_bh(&manager->btm_lock);
+
+	return block;
+}
+
+static int
+efrm_bt_cached_block_put(struct efrm_bt_manager *manager,
+			 struct efhw_buffer_table_block *block)
+{
+	spin_lock_bh(&manager->btm_lock);
+	if (manager->btm_cached_n >= EFRM_BT_MANAGER_CACHE_MAX) {
+		spin_unlock_bh(&manager->btm_lock);
+		return -ENOSPC;
+	}
+	block->btb_free_mask = EFHW_BT_BLOCK_FREE_ALL;
+	block->btb_next = manager->btm_cached_blocks;
+	manager->btm_cached_blocks = block;
+	manager->btm_cached_n++;
+	spin_unlock_bh(&manager->btm_lock);
+
+	return 0;
+}
+
+void
+efrm_bt_manager_shrink(struct efhw_nic *nic, struct efrm_bt_manager *manager,
+		       int reset_pending)
+{
+	struct efhw_buffer_table_block *block;
+	struct efhw_buffer_table_block *blocks;
+
+	spin_lock_bh(&manager->btm_lock);
+	blocks = manager->btm_cached_blocks;
+	manager->btm_cached_blocks = NULL;
+	manager->btm_cached_n = 0;
+	spin_unlock_bh(&manager->btm_lock);
+
+	while ((block = blocks) != NULL) {
+		blocks = block->btb_next;
+		efhw_nic_buffer_table_free(nic, block, reset_pending);
+	}
+}
+
 static int
 efrm_bt_block_reuse_try(struct efhw_buffer_table_block *block,
 			struct efrm_buffer_table_allocation *a)
@@ -74,14 +135,23 @@ efrm_bt_blocks_alloc(struct efhw_nic *nic,
 	 * FIXME AF_XDP: for AF_XDP this is guaranteed and is required behaviour for
 	 * descriptor address->pkt_id resolution */
 	for (i = 0; i < n_blocks; i++) {
-		rc = efhw_nic_buffer_table_alloc(nic, manager->owner,
-						 manager->order, &block,
-						 reset_pending);
-		/* ENETDOWN indicates absent hardware, in which case we should
-		 * not report failure as we wish to preserve all software state
-		 * in anticipation of the hardware's reappearance. */
-		if (rc != 0 && rc != -ENETDOWN)
-			goto fail;
+		/* Prefer a cached chunk: its hardware state is already
+		 * allocated, so no MCDI is needed.  The cache is not used
+		 * while a reset is pending, as cached handles will not be
+		 * covered by the post-reset reallocation. */
+		block = reset_pending ? NULL :
+			efrm_bt_cached_block_get(manager);
+		if (block == NULL) {
+			rc = efhw_nic_buffer_table_alloc(nic, manager->owner,
+							 manager->order, &block,
+							 reset_pending);
+			/* ENETDOWN indicates absent hardware, in which case
+			 * we should not report failure as we wish to preserve
+			 * all software state in anticipation of the
+			 * hardware's reappearance. */
+			if (rc != 0 && rc != -ENETDOWN)
+				goto fail;
+		}
 		if( blocks == NULL )
 			blocks = block;
 		if( blocks_end != NULL )
@@ -122,7 +192,7 @@ efrm_bt_block_clear(struct efhw_nic *nic, int bta_flags,
                     
 
 static void
-efrm_bt_blocks_free(struct efhw_nic *nic,
+efrm_bt_blocks_free(struct efhw_nic *nic, struct efrm_bt_manager *manager,
 		    struct efrm_buffer_table_allocation *a, int reset_pending)
 {
 	int n = a->bta_size;
@@ -135,7 +205,11 @@ efrm_bt_blocks_free(struct efhw_nic *nic,
                                     reset_pending);
 		n -= EFHW_BUFFER_TABLE_BLOCK_SIZE;
 		a->bta_blocks = block->btb_next;
-		efhw_nic_buffer_table_free(nic, block, reset_pending);
+		/* Cache the hardware chunk for re-use if it is healthy;
+		 * blocks caught by a reset may have stale handles. */
+		if (reset_pending || a->bta_flags != 0 ||
+		    efrm_bt_cached_block_put(manager, block) != 0)
+			efhw_nic_buffer_table_free(nic, block, reset_pending);
 	}
 }
 
@@ -216,8 +290,12 @@ efrm_bt_free_small(struct efhw_nic *nic, struct efrm_bt_manager *manager,
 
 	if (! reset_pending &&
 	    (a->bta_flags & (EFRM_BTA_FLAG_IN_RESET | EFRM_BTA_FLAG_FRAUD))
-             != EFRM_BTA_FLAG_IN_RESET)
-		efhw_nic_buffer_table_free(nic, a->bta_blocks, reset_pending);
+             != EFRM_BTA_FLAG_IN_RESET) {
+		if (a->bta_flags != 0 ||
+		    efrm_bt_cached_block_put(manager, a->bta_blocks) != 0)
+			efhw_nic_buffer_table_free(nic, a->bta_blocks,
+						   reset_pending);
+	}
 	atomic_dec(&manager->btm_blocks);
 }
 
@@ -233,6 +311,11 @@ efrm_bt_manager_realloc(struct efhw_nic *nic,
 
 	a->bta_flags = EFRM_BTA_FLAG_IN_RESET;
 
+	/* Cached chunks are not covered by any allocation, so nothing will
+	 * re-allocate their hardware state after the reset: drop them.  This
+	 * is idempotent across the per-allocation realloc calls. */
+	efrm_bt_manager_shrink(nic, manager, 1);
+
 	EFRM_DO_DEBUG(
 		if (a->bta_size > EFHW_BUFFER_TABLE_BLOCK_SIZE)
 			EFRM_ASSERT(a->bta_first_entry_offset == 0);
@@ -299,7 +382,7 @@ efrm_bt_manager_free(struct efhw_nic *nic, struct efrm_bt_manager *manager,
 
 	atomic_sub((a->bta_size - 1) / EFHW_BUFFER_TABLE_BLOCK_SIZE + 1,
 		   &manager->btm_blocks);
-	efrm_bt_blocks_free(nic, a, reset_pending);
+	efrm_bt_blocks_free(nic, manager, a, reset_pending);
 	a->bta_size = 0;
 }
 
@@ -39,6 +39,8 @@ static inline void
 efrm_bt_manager_ctor(struct efrm_bt_manager *manager, int owner, int order)
 {
 	manager->btm_block = NULL;
+	manager->btm_cached_blocks = NULL;
+	manager->btm_cached_n = 0;
 	spin_lock_init(&manager->btm_lock);
 	manager->owner = owner;
 	manager->order = order;
@@ -49,6 +51,7 @@ static inline void
 efrm_bt_manager_dtor(struct efrm_bt_manager *manager)
 {
 	EFRM_ASSERT(manager->btm_block == NULL);
+	EFRM_ASSERT(manager->btm_cached_blocks == NULL);
 	EFRM_ASSERT(atomic_read(&manager->btm_blocks) == 0);
 	EFRM_ASSERT(atomic_read(&manager->btm_entries) == 0);
 	spin_lock_destroy(&manager->btm_lock);
@@ -70,5 +73,8 @@ efrm_bt_manager_free(struct efhw_nic *nic, struct efrm_bt_manager *manager,
 extern int
 efrm_bt_nic_set(struct efhw_nic *nic, struct efrm_buffer_table_allocation *a,
 		dma_addr_t *dma_addrs);
+extern void
+efrm_bt_manager_shrink(struct efhw_nic *nic, struct efrm_bt_manager *manager,
+		       int reset_pending);
 
 #endif /* __EFRM_BT_MANAGER_H__ */
@@ -414,8 +414,11 @@ void efrm_pd_free(struct efrm_pd *pd)
 		for (ord = 0;
 		     ord < efhw_nic_buffer_table_orders_num(
 					pd->rs.rs_client->nic);
-		     ord++)
+		     ord++) {
+			efrm_bt_manager_shrink(pd->rs.rs_client->nic,
+					       &pd->bt_managers[ord], 0);
 			efrm_bt_manager_dtor(&pd->bt_managers[ord]);
+		}
 	}
 	efrm_client_put(pd->rs.rs_client);
 	kfree(pd);
@@ -320,6 +320,106 @@ int efrm_vi_set_get_rss_context(struct efrm_vi_set *vi_set, unsigned rss_id)
 EXPORT_SYMBOL(efrm_vi_set_get_rss_context);
 
 
+/* Rebuild the indirection table(s) of a vi_set from per-VI weights and push
+ * them to the NIC.  Each VI gets a share of the table proportional to its
+ * weight; a VI with weight 0 receives no RSS-spread traffic.  This is used
+ * to apply cluster distribution policies at runtime; the initial table set
+ * up at allocation time is equivalent to all weights being equal.
+ */
+int efrm_vi_set_rss_rebalance(struct efrm_vi_set *vi_set,
+			      const uint32_t *weights, int n_weights)
+{
+	struct efrm_client *client = vi_set->rs.rs_client;
+	uint64_t total = 0;
+	int i, rc = 0;
+
+	if (n_weights != vi_set->n_vis)
+		return -EINVAL;
+	for (i = 0; i < n_weights; ++i)
+		total += weights[i];
+	if (total == 0)
+		return -EINVAL;
+
+	for (i = 0; i <= EFRM_RSS_MODE_ID_MAX; ++i) {
+		struct efrm_rss_context *context = &vi_set->rss_context[i];
+		uint64_t acc = 0;
+		uint32_t index = 0;
+		int q;
+
+		if (context->rss_context_id == -1 ||
+		    context->indirection_table == NULL)
+			continue;
+
+		context->indirected_vis = 0;
+		for (q = 0; q < n_weights; ++q) {
+			uint32_t end;
+
+			acc += weights[q];
+			end = acc * context->indirection_table_size / total;
+			if (end > index)
+				context->indirected_vis |= 1ULL << q;
+			for (; index < end; ++index)
+				context->indirection_table[index] = q;
+		}
+
+		rc = efrm_rss_context_update(client, context->rss_context_id,
+					     context->indirection_table,
+					     context->rss_hash_key,
+					     context->rss_mode);
+		if (rc < 0)
+			break;
+	}
+	return rc;
+}
+EXPORT_SYMBOL(efrm_vi_set_rss_rebalance);
+
+
+/* Re-establish the hardware RSS context(s) behind a vi_set after an NIC
+ * reset.  The firmware forgets all RSS contexts across a reset, but we
+ * retain a shadow of the indirection table and hash key, so we can
+ * allocate a fresh context and program the remembered state back into it.
+ * The context ID changes; callers owning filters that reference the old
+ * ID must re-push those filters afterwards.
+ */
+int efrm_vi_set_reset(struct efrm_vi_set *vi_set)
+{
+	struct efrm_client *client = vi_set->rs.rs_client;
+	int i, rc = 0;
+
+	for (i = 0; i <= EFRM_RSS_MODE_ID_MAX; ++i) {
+		struct efrm_rss_context *context = &vi_set->rss_context[i];
+		int rc1;
+
+		if (context->rss_context_id == -1 ||
+		    context->indirection_table == NULL)
+			continue;
+
+		/* Release the stale ID on a best-effort basis: following an
+		 * MC reboot the firmware has already forgotten it and the
+		 * free may fail, which is harmless. */
+		efrm_rss_context_free(client, context->rss_context_id);
+		context->rss_context_id = -1;
+
+		rc1 = efrm_rss_context_alloc(client,
+					     efrm_pd_get_vport_id(vi_set->pd),
+					     0 /* exclusive */,
+					     context->indirection_table,
+					     context->rss_hash_key,
+					     context->rss_mode,
+					     vi_set->n_vis,
+					     &context->rss_context_id);
+		if (rc1 < 0) {
+			EFRM_ERR("%s: ERROR: failed to re-establish RSS "
+				 "context (mode %x) post-reset (rc %d)",
+				 __FUNCTION__, context->rss_mode, rc1);
+			rc = rc1;
+		}
+	}
+	return rc;
+}
+EXPORT_SYMBOL(efrm_vi_set_reset);
+
+
 struct efrm_resource * efrm_vi_set_to_resource(struct efrm_vi_set *vi_set)
 {
 	return &vi_set->rs;
@@ -207,6 +207,10 @@ efrm_vi_irq_free(struct efrm_interrupt_vector *vec)
 	if( vec->irq == IRQ_NOTCONNECTED )
 		return;
 
+	/* Drop any affinity hint set via efrm_vi_irq_affinity(); free_irq()
+	 * warns if one is still in place. */
+	irq_set_affinity_hint(vec->irq, NULL);
+
 	/* linux>=4.13: free_irq() returns name */
 #ifdef EFRM_IRQ_FREE_RETURNS_NAME
 	name = free_irq(vec->irq, &vec->tasklet);
@@ -45,6 +45,7 @@
 #include <ci/efrm/efrm_nic.h>
 #include <ci/efrm/buffer_table.h>
 #include "efrm_internal.h"
+#include <linux/interrupt.h>
 
 
 static DEFINE_MUTEX(register_evq_cb_mutex);
@@ -342,3 +343,43 @@ int efrm_handle_timeout_event(struct efhw_nic *nic, unsigned instance,
 	return efrm_eventq_do_callback(nic, instance, true, budget);
 }
 
+
+int efrm_vi_get_irq(struct efrm_vi *virs, uint32_t *irq_out)
+{
+	/* On architectures where wakeups are managed by the net driver
+	 * there is no vector, and hence no IRQ, for us to report. */
+	if (virs->vec == NULL)
+		return -EOPNOTSUPP;
+	/* The irq field is fixed for the lifetime of the vector (barring
+	 * hardware removal), so no locking is needed to read it. */
+	*irq_out = virs->vec->irq;
+	return 0;
+}
+EXPORT_SYMBOL(efrm_vi_get_irq);
+
+
+int efrm_vi_irq_affinity(struct efrm_vi *virs, int cpu)
+{
+	struct efrm_interrupt_vector *vec = virs->vec;
+	int rc;
+
+	if (vec == NULL)
+		return -EOPNOTSUPP;
+	if (cpu < 0 || cpu >= nr_cpu_ids || !cpu_online(cpu))
+		return -EINVAL;
+
+	/* Serialise against efrm_vi_irq_setup()/efrm_vi_irq_free() so that
+	 * we only touch the IRQ while it is requested.  The hint applies to
+	 * the whole vector, and so affects every VI sharing it; that is the
+	 * desired behaviour, since they all fire through the same IRQ. */
+	mutex_lock(&vec->vec_acquire_lock);
+	if (vec->num_vis == 0)
+		rc = -ENODEV;
+	else
+		rc = irq_set_affinity_hint(vec->irq, cpumask_of(cpu));
+	mutex_unlock(&vec->vec_acquire_lock);
+
+	return rc;
+}
+EXPORT_SYMBOL(efrm_vi_irq_affinity);
+
@@ -134,7 +134,7 @@ static int oo_bufpage_init(struct oo_buffer_pages **pages_out,
 
 static int oo_bufpage_alloc(struct oo_buffer_pages **pages_out,
                             int user_order, int low_order, int min_nic_order,
-                            int *flags, int gfp_flag,
+                            int *flags, int gfp_flag, int numa_node,
                             struct oo_hugetlb_allocator *hugetlb_alloc)
 {
   struct oo_buffer_pages *pages;
@@ -187,8 +187,12 @@ static int oo_bufpage_alloc(struct oo_buffer_pages **pages_out,
     gfp_flag |= __GFP_COMP | __GFP_NOWARN;
   }
 
+  if( numa_node < 0 || numa_node >= MAX_NUMNODES ||
+      ! node_online(numa_node) )
+    numa_node = numa_node_id();
+
   for( i = 0; i < n_bufs; ++i ) {
-    pages->pages[i] = alloc_pages_node(numa_node_id(), gfp_flag, low_order);
+    pages->pages[i] = alloc_pages_node(numa_node, gfp_flag, low_order);
     if( pages->pages[i] == NULL ) {
       OO_DEBUG_VERB(ci_log("%s: failed to allocate page (i=%u) "
                            "user_order=%d page_order=%d",
@@ -214,7 +218,7 @@ void oo_iobufset_pages_release(struct oo_buffer_pages *pages)
 
 int
 oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
-                        struct oo_buffer_pages **pages_out,
+                        struct oo_buffer_pages **pages_out, int numa_node,
                         struct oo_hugetlb_allocator *hugetlb_alloc)
 {
   int rc;
@@ -229,7 +233,7 @@ oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
   if( *flags & OO_IOBUFSET_FLAG_HUGE_PAGE_FORCE ) {
 # ifdef OO_DO_HUGE_PAGES
     rc = oo_bufpage_alloc(pages_out, order, order, min_order, flags,
-                          gfp_flag, hugetlb_alloc);
+                          gfp_flag, numa_node, hugetlb_alloc);
 # else
     rc = -ENOMEM;
 # endif
@@ -254,11 +258,11 @@ oo_iobufset_pages_alloc(int nic_order, int min_nic_order, int *flags,
       low_order = HPAGE_SHIFT - PAGE_SHIFT;
 
     rc = oo_bufpage_alloc(pages_out, order, low_order, min_order, flags,
-                          gfp_flag, hugetlb_alloc);
+                          gfp_flag, numa_node, hugetlb_alloc);
 
     if( rc != 0 && rc != -EINTR && low_order != 0 )
       rc = oo_bufpage_alloc(pages_out, order, 0, min_order, flags, gfp_flag,
-                            hugetlb_alloc);
+                            numa_node, hugetlb_alloc);
   }
 
   if( rc == -EMSGSIZE ) {
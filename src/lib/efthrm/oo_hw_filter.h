@@ -152,4 +152,13 @@ extern void oo_hw_filter_transfer(struct oo_hw_filter* oofilter_old,
  */
 extern unsigned oo_hw_filter_hwports(struct oo_hw_filter* oofilter);
 
+
+/* Sum the hardware match counters of this filter across all hwports it is
+ * installed on, for NICs that can report them.  Returns the number of
+ * hwports that reported a counter; zero means the NIC(s) keep no
+ * per-filter match count and *hits_out is not meaningful.
+ */
+extern int oo_hw_filter_hits(struct oo_hw_filter* oofilter,
+                             uint64_t* hits_out);
+
 #endif  /* __ONLOAD_HW_FILTER_H__ */
@@ -77,6 +77,19 @@ int oof_shared_keep_thresh = 100;
  */
 int oof_shared_steal_thresh = 200;
 
+/* If non-zero, then once a stack has this many multicast filters on a
+ * local port, further group subscriptions are captured with a shared
+ * filter on the multicast MAC address rather than an exact IP filter.  A
+ * MAC filter covers every group whose address maps to the same 23-bit MAC
+ * image, so applications subscribing to large group ranges need far fewer
+ * hardware filter insertions.  Only used on hwports that replicate
+ * multicast traffic to all interested recipients, where the over-wide
+ * match cannot steal traffic from other stacks or the kernel; traffic
+ * captured for groups the stack is not subscribed to is discarded by the
+ * software filters.  Set to 0 (default) to disable.
+ */
+int oof_mcast_mac_aggregation = 0;
+
 /* Module option to handle all local IP addresses. */
 int oof_use_all_local_ip_addresses = 0;
 
@@ -162,6 +175,11 @@ static unsigned
 oof_mcast_filter_hwport_mask(struct oof_manager* fm,
                              struct oof_mcast_filter* mf);
 
+static unsigned
+oof_mcast_filter_mac_hwports(struct oof_manager* fm,
+                             struct oof_local_port* lp,
+                             struct oof_mcast_filter* mf);
+
 static void
 __oof_manager_addr_add(struct oof_manager*, int af, ci_addr_t laddr,
                        unsigned ifindex);
@@ -193,6 +211,9 @@ __oof_manager_update_interface(struct oof_manager* fm,
 static int
 oof_tproxy_filter_update(struct oof_manager* fm, struct oof_tproxy* ft);
 
+static int
+oof_ethertype_filter_update(struct oof_manager* fm, struct oof_ethertype* fe);
+
 static void
 __oof_socket_del_wild(struct oof_manager* fm,
                       struct oof_socket* skf,
@@ -496,6 +517,46 @@ static int oof_hw_filter_update(struct oof_manager* fm,
 }
 
 
+/* Install or modify a filter on the multicast MAC address that [maddr]
+ * maps to (see oof_mcast_mac_aggregation).
+ */
+static int oof_hw_filter_update_mcast_mac(struct oof_manager* fm,
+                                          struct oo_hw_filter* oofilter,
+                                          struct tcp_helper_resource_s*
+                                                 new_stack,
+                                          unsigned maddr,
+                                          ci_uint16 vlan_id,
+                                          unsigned hwport_mask)
+{
+  int rc;
+  unsigned maddr_he = CI_BSWAP_BE32(maddr);
+  struct oo_hw_filter_spec oo_filter_spec = {
+    .type    = OO_HW_FILTER_TYPE_MAC,
+    .vlan_id = vlan_id,
+  };
+
+  /* IANA mapping of an IPv4 multicast address onto a MAC address: the
+   * 01:00:5e OUI followed by the low 23 bits of the group. */
+  oo_filter_spec.addr.mac.mac[0] = 0x01;
+  oo_filter_spec.addr.mac.mac[1] = 0x00;
+  oo_filter_spec.addr.mac.mac[2] = 0x5e;
+  oo_filter_spec.addr.mac.mac[3] = (maddr_he >> 16) & 0x7f;
+  oo_filter_spec.addr.mac.mac[4] = (maddr_he >> 8) & 0xff;
+  oo_filter_spec.addr.mac.mac[5] = maddr_he & 0xff;
+
+  ci_assert(spin_is_locked(&fm->fm_inner_lock));
+  ci_assert(mutex_is_locked(&fm->fm_outer_lock));
+
+  spin_unlock_bh(&fm->fm_inner_lock);
+  ci_assert(!in_atomic());
+  rc = oo_hw_filter_update(oofilter, new_stack, &oo_filter_spec,
+                           fm->fm_hwports_vlan_filters & hwport_mask,
+                           hwport_mask, 0, OOF_SRC_FLAGS_DEFAULT_MCAST);
+  spin_lock_bh(&fm->fm_inner_lock);
+  return rc;
+}
+
+
 static void __oof_hw_filter_move(struct oof_manager* fm,
                                  struct oof_socket* skf,
                                  struct oof_local_port* lp,
@@ -1076,11 +1137,13 @@ oof_manager_alloc(unsigned local_addr_max, void* owner_private)
   ci_dllist_init(&fm->fm_local_interfaces);
   ci_dllist_init(&fm->fm_mcast_laddr_socks);
   ci_dllist_init(&fm->fm_tproxies);
+  ci_dllist_init(&fm->fm_ethertypes);
   for( i = 0; i < OOF_TPROXY_GLOBAL_FILTER_COUNT; ++i )
     fm->fm_tproxy_global_filters[i] = 0;
   fm->fm_hwports_up = 0;
   fm->fm_hwports_up_new = 0;
   fm->fm_hwports_removed = 0;
+  fm->fm_hwports_reset = 0;
   fm->fm_hwports_down = 0;
   fm->fm_hwports_down_new = 0;
   fm->fm_hwports_mcast_replicate_capable = 0;
@@ -1120,6 +1183,7 @@ oof_manager_free(struct oof_manager* fm)
   struct oof_local_interface* li_tmp;
 
   ci_assert(ci_dllist_is_empty(&fm->fm_tproxies));
+  ci_assert(ci_dllist_is_empty(&fm->fm_ethertypes));
   ci_assert(ci_dllist_is_empty(&fm->fm_mcast_laddr_socks));
   for( hash = 0; hash < OOF_LOCAL_PORT_TBL_SIZE; ++hash )
     ci_assert(ci_dllist_is_empty(&fm->fm_local_ports[hash]));
@@ -1739,6 +1803,7 @@ oof_manager_update_all_filters(struct oof_manager* fm)
   struct oof_mcast_filter* mf;
   struct oof_local_port* lp;
   struct oof_tproxy* ft;
+  struct oof_ethertype* fe;
   struct oof_socket* skf;
   unsigned hwport_mask;
   ci_addr_t laddr;
@@ -1779,7 +1844,9 @@ oof_manager_update_all_filters(struct oof_manager* fm)
       /* Find and update multicast filters. */
       CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf, mf_lp_link,
                           &lp->lp_mcast_filters) {
-        ci_assert_equal(mf->mf_filter.thc, NULL);
+        /* [mf_filter] may be cluster-owned (trs NULL, thc set);
+         * oof_hw_filter_update() handles both ownership models.
+         */
         if( ! oo_hw_filter_is_empty(&mf->mf_filter) ) {
           ci_addr_t maddr = CI_ADDR_FROM_IP4(mf->mf_maddr);
           hwport_mask = oof_mcast_filter_installable_hwports(fm, lp, mf);
@@ -1791,6 +1858,14 @@ oof_manager_update_all_filters(struct oof_manager* fm)
                                mf->mf_vlan_id, hwport_mask,
                                OOF_SRC_FLAGS_DEFAULT_MCAST);
         }
+        if( ! oo_hw_filter_is_empty(&mf->mf_mac_filter) ) {
+          hwport_mask = mf->mf_hwport_mask &
+              fm->fm_hwports_mcast_replicate_capable &
+              fm->fm_hwports_up & fm->fm_hwports_available;
+          oof_hw_filter_update_mcast_mac(fm, &mf->mf_mac_filter,
+                                         mf->mf_mac_filter.trs, mf->mf_maddr,
+                                         mf->mf_vlan_id, hwport_mask);
+        }
       }
     }
   }
@@ -1799,6 +1874,12 @@ oof_manager_update_all_filters(struct oof_manager* fm)
   CI_DLLIST_FOR_EACH2(struct oof_tproxy, ft, ft_manager_link,
                       &fm->fm_tproxies)
     oof_tproxy_filter_update(fm, ft);
+
+  /* ...and raw-L2 ethertype filters, which follow their interface in the
+   * same way. */
+  CI_DLLIST_FOR_EACH2(struct oof_ethertype, fe, fe_manager_link,
+                      &fm->fm_ethertypes)
+    oof_ethertype_filter_update(fm, fe);
 }
 
 
@@ -1844,6 +1925,28 @@ void oof_hwport_up_down(struct oof_manager* fm, int hwport, int up,
 }
 
 
+/* An NIC reset has rebuilt hardware state behind [hwport] -- in particular
+ * any RSS contexts have been re-allocated under new IDs -- so filters that
+ * reference the old state must be re-pushed.  The hwport itself never went
+ * down from the control plane's point of view, so we mark it separately and
+ * let the deferred work run a full filter update, which redirects every
+ * installed filter to the current RSS context and VI. */
+void oof_hwport_reset(struct oof_manager* fm, int hwport, int sync)
+{
+  if( fm == NULL )
+    return;
+
+  spin_lock_bh(&fm->fm_cplane_updates_lock);
+  fm->fm_hwports_reset |= 1 << hwport;
+  spin_unlock_bh(&fm->fm_cplane_updates_lock);
+
+  if( sync )
+    oof_do_deferred_work(fm);
+  else
+    oof_cb_defer_work(fm->fm_owner_private);
+}
+
+
 /* This is called when a new interface is probed that is stepping into the
  * shoes of a previous interface.  We trigger the insertion of drop filters
  * for that interface to prevent the kernel from receiving traffic destined for
@@ -1887,7 +1990,7 @@ void __oof_do_deferred_work(struct oof_manager* fm)
 {
   /* Invoked with both outer and inner locks held. */
   unsigned hwports_up_new, hwports_down_new,
-           hwports_changed, hwports_removed;
+           hwports_changed, hwports_removed, hwports_reset;
   unsigned hwports_avail_new[OOF_HWPORT_AVAIL_TAG_NUM];
   IPF_LOG("%s:", __FUNCTION__);
 
@@ -1910,18 +2013,20 @@ void __oof_do_deferred_work(struct oof_manager* fm)
   fm->fm_hwports_no5tuple = fm->fm_hwports_no5tuple_new;
 
   hwports_removed = fm->fm_hwports_removed;
+  hwports_reset = fm->fm_hwports_reset;
   hwports_up_new = fm->fm_hwports_up_new;
   hwports_down_new = fm->fm_hwports_down_new;
   memcpy(hwports_avail_new, fm->fm_hwports_avail_per_tag_new,
          sizeof(hwports_avail_new));
 
-  hwports_changed |= hwports_removed |
+  hwports_changed |= hwports_removed | hwports_reset |
     (hwports_up_new ^ fm->fm_hwports_up) |
     (hwports_down_new ^ fm->fm_hwports_down);
 
 
   /* Restart port change monitoring */
   fm->fm_hwports_removed = 0;
+  fm->fm_hwports_reset = 0;
 
   spin_unlock_bh(&fm->fm_cplane_updates_lock);
 
@@ -2853,6 +2958,95 @@ int oof_socket_can_update_stack(struct oof_manager* fm, struct oof_socket* skf,
 }
 
 
+/* Fast path for adding a full-match socket that can share an existing wild
+ * hardware filter pointing at its own stack: the common case for sockets
+ * accepted from (or connecting alongside) a listening socket.
+ *
+ * This takes only [fm_inner_lock], so concurrent adds from different stacks
+ * do not serialise behind hardware filter updates made under
+ * [fm_outer_lock].  It is safe for the same reason oof_socket_share() is:
+ * nothing reached from here inserts or removes hardware filters, frees any
+ * resources or removes anything from lists, and the presence of an armed
+ * wild socket in the same stack (checked under the lock) guarantees the
+ * wild filter is not concurrently being torn down or moved to another
+ * stack.  Anything more complicated falls back to the locked slow path.
+ *
+ * Returns 0 on success and -EAGAIN if the caller must use the slow path.
+ */
+static int
+oof_socket_add_fast(struct oof_manager* fm, struct oof_socket* skf,
+                    int flags, int protocol, int af_space,
+                    ci_addr_t laddr, int lport,
+                    ci_addr_t raddr, int rport)
+{
+  struct oof_local_port* lp;
+  struct oof_local_port_addr* lpa;
+  struct oof_local_addr* la;
+  int la_i;
+  int rc;
+
+  if( flags & (OOF_SOCKET_ADD_FLAG_CLUSTERED | OOF_SOCKET_ADD_FLAG_DUMMY |
+               OOF_SOCKET_ADD_FLAG_NO_STACK | OOF_SOCKET_ADD_FLAG_NO_UCAST) )
+    return -EAGAIN;
+  if( lport == 0 || rport == 0 ||
+      CI_IPX_ADDR_IS_ANY(laddr) || CI_IPX_ADDR_IS_ANY(raddr) ||
+      CI_IPX_IS_MULTICAST(laddr) )
+    return -EAGAIN;
+
+  spin_lock_bh(&fm->fm_inner_lock);
+
+  rc = -EAGAIN;
+  if( skf->sf_local_port != NULL || oof_socket_is_clustered(skf) ||
+      ci_dllist_not_empty(&skf->sf_mcast_memberships) ||
+      fm->fm_hwports_no5tuple != 0 )
+    goto unlock_out;
+  if( (lp = oof_local_port_find(fm, protocol, lport)) == NULL )
+    goto unlock_out;
+  if( (la_i = oof_manager_addr_find(fm, laddr)) < 0 )
+    goto unlock_out;
+  lpa = &lp->lp_addr[la_i];
+  la = &fm->fm_local_addrs[la_i];
+  if( ! oof_local_port_addr_valid(fm, lpa) )
+    goto unlock_out;
+
+  skf->af_space = af_space;
+  skf->sf_laddr = laddr;
+  skf->sf_raddr = raddr;
+  skf->sf_rport = rport;
+  skf->sf_lport_prenat = 0;
+  skf->sf_la_i = la_i;
+  skf->sf_flags = (flags & OOF_SOCKET_ADD_FLAG_SUBVI_MASK) >>
+                  OOF_SOCKET_ADD_FLAG_SUBVI_SHIFT << OOF_SOCKET_SUBVI_SHIFT;
+
+  if( ! oof_socket_can_share_hw_filter(skf, &lpa->lpa_filter) ||
+      oof_wild_socket_matching_stack(lp, lpa, af_space,
+                                     oof_cb_socket_stack(skf)) == NULL ) {
+    skf->sf_flags = 0;
+    goto unlock_out;
+  }
+
+  skf->sf_local_port = lp;
+  if( (rc = oof_socket_add_full_sw(skf)) != 0 ) {
+    /* Report the error rather than retrying via the slow path: it would
+     * only attempt the same insertion again. */
+    skf->sf_local_port = NULL;
+    skf->sf_flags = 0;
+    goto unlock_out;
+  }
+  ++lpa->lpa_n_full_sharers;
+  ++lp->lp_refs;
+  ci_dllist_push(&lpa->lpa_full_socks, &skf->sf_lp_link);
+  ++la->la_sockets;
+  IPF_LOG(FSK_FMT "SHARE "SK_ADDR_FMT" (fast)", FSK_PRI_ARGS(skf),
+          SK_ADDR_ARGS(skf));
+  rc = 0;
+
+ unlock_out:
+  spin_unlock_bh(&fm->fm_inner_lock);
+  return rc;
+}
+
+
 /* Adds a socket or arms a dummy socket
  *
  * Before new socket is added some checks are done:
@@ -2890,6 +3084,14 @@ oof_socket_add(struct oof_manager* fm, struct oof_socket* skf,
   int do_arm_only;
   int inc_laddr_ref = 1;
 
+  rc = oof_socket_add_fast(fm, skf, flags, protocol, af_space,
+                           laddr, lport, raddr, rport);
+  if( rc != -EAGAIN ) {
+    if( thc_out != NULL )
+      *thc_out = NULL;
+    return rc;
+  }
+
   mutex_lock(&fm->fm_outer_lock);
   spin_lock_bh(&fm->fm_inner_lock);
 
@@ -3845,6 +4047,11 @@ oof_mcast_member_state(struct oof_manager* fm, struct oof_mcast_member* mm)
                         &mm->mm_socket->sf_local_port->lp_mcast_filters)
     hwports_got |= oof_mcast_filter_duplicate_hwports(fm, mm->mm_filter, mf2);
 
+  /* Likewise traffic may be captured via a shared MAC filter. */
+  hwports_got |= oof_mcast_filter_mac_hwports(fm,
+                                              mm->mm_socket->sf_local_port,
+                                              mm->mm_filter);
+
   if( hwports_want ) {
     if( (hwports_got & hwports_want) == hwports_want )
       s = "ACCELERATED";
@@ -3864,6 +4071,7 @@ oof_mcast_filter_init(struct oof_mcast_filter* mf, unsigned maddr,
                       ci_uint16 vlan_id)
 {
   oo_hw_filter_init(&mf->mf_filter);
+  oo_hw_filter_init(&mf->mf_mac_filter);
   mf->mf_maddr = maddr;
   mf->mf_vlan_id = vlan_id;
   mf->mf_hwport_mask = 0;
@@ -3884,16 +4092,21 @@ oof_mcast_filter_hwport_mask(struct oof_manager* fm,
 }
 
 
+/* Filters for clustered sockets are owned by the cluster rather than a
+ * stack, so the owner is identified by the (stack, thc) pair with exactly
+ * one of the two non-NULL.
+ */
 static struct oof_mcast_filter*
 oof_local_port_find_mcast_filter(struct oof_local_port* lp,
                                  struct tcp_helper_resource_s* stack,
+                                 struct tcp_helper_cluster_s* thc,
                                  unsigned maddr, ci_uint16 vlan_id)
 {
   struct oof_mcast_filter* mf;
   CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf, mf_lp_link,
                       &lp->lp_mcast_filters)
-    if( mf->mf_filter.trs == stack && mf->mf_maddr == maddr
-        && mf->mf_vlan_id == vlan_id )
+    if( mf->mf_filter.trs == stack && mf->mf_filter.thc == thc
+        && mf->mf_maddr == maddr && mf->mf_vlan_id == vlan_id )
       break;
   return mf;
 }
@@ -3911,6 +4124,12 @@ ci_inline unsigned oof_mcast_conflicted_hwports(struct oof_manager* fm,
                                                 ci_uint16 vlan_id,
                                                 struct oof_mcast_filter* mf)
 {
+  /* Cluster-owned filters are restricted to hwports that support multicast
+   * replication (see oof_mcast_filter_installable_hwports()), all of which
+   * are excluded from the conflict mask below, so they never conflict.
+   */
+  if( mf->mf_filter.thc != NULL )
+    return 0;
   /* There can only be a conflict is this is for the same address, but a
    * different stack.
    */
@@ -3949,7 +4168,8 @@ oof_mcast_filter_duplicate_hwports(struct oof_manager* fm,
    * - the hwport does not support vlans
    * - mf2 already has installed a filter on that hwport
    */
-  if( (mf->mf_filter.trs == mf2->mf_filter.trs) && 
+  if( (mf->mf_filter.trs == mf2->mf_filter.trs) &&
+      (mf->mf_filter.thc == mf2->mf_filter.thc) &&
       (mf->mf_maddr == mf2->mf_maddr) )
     /* The filter matches, now check for hwport overlap on non-vlan hwports */
     hwport_mask = oof_mcast_filter_hwport_mask(fm, mf) &
@@ -3959,6 +4179,74 @@ oof_mcast_filter_duplicate_hwports(struct oof_manager* fm,
 }
 
 
+/* Do two multicast group addresses map onto the same MAC address?  Only
+ * the low 23 bits of the group survive the mapping.
+ */
+ci_inline int
+oof_mcast_maddr_mac_eq(unsigned maddr1, unsigned maddr2)
+{
+  return ((CI_BSWAP_BE32(maddr1) ^ CI_BSWAP_BE32(maddr2)) & 0x7fffff) == 0;
+}
+
+
+/* Hwports on which [mf]'s traffic is captured by a MAC filter: its own,
+ * or one installed by another oof_mcast_filter on the same local port for
+ * the same stack, MAC image and vlan.
+ */
+static unsigned
+oof_mcast_filter_mac_hwports(struct oof_manager* fm,
+                             struct oof_local_port* lp,
+                             struct oof_mcast_filter* mf)
+{
+  unsigned hwport_mask = oo_hw_filter_hwports(&mf->mf_mac_filter);
+  struct oof_mcast_filter* mf2;
+
+  CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf2, mf_lp_link,
+                      &lp->lp_mcast_filters)
+    if( mf2 != mf && mf2->mf_filter.trs == mf->mf_filter.trs &&
+        mf2->mf_vlan_id == mf->mf_vlan_id &&
+        oof_mcast_maddr_mac_eq(mf->mf_maddr, mf2->mf_maddr) )
+      hwport_mask |= oo_hw_filter_hwports(&mf2->mf_mac_filter);
+  return hwport_mask;
+}
+
+
+/* Should [mf] be captured with a shared MAC filter rather than exact IP
+ * filters?  See oof_mcast_mac_aggregation.
+ */
+static int
+oof_mcast_filter_use_mac(struct oof_manager* fm, struct oof_local_port* lp,
+                         struct oof_mcast_filter* mf,
+                         unsigned install_hwport_mask)
+{
+  struct oof_mcast_filter* mf2;
+  int n = 0;
+
+  if( oof_mcast_mac_aggregation <= 0 )
+    return 0;
+  /* Cluster-owned filters must be exact IP filters: a MAC filter would
+   * bypass the RSS spreading that clustering exists to provide.
+   */
+  if( mf->mf_filter.thc != NULL )
+    return 0;
+  /* A MAC filter matches every group sharing the 23-bit MAC image and
+   * every local port, so it is only safe on hwports that replicate
+   * multicast traffic to all interested recipients; elsewhere it would
+   * steal traffic from other stacks and the kernel.
+   */
+  if( install_hwport_mask == 0 ||
+      (install_hwport_mask & ~fm->fm_hwports_mcast_replicate_capable) != 0 )
+    return 0;
+  if( ! oo_hw_filter_is_empty(&mf->mf_mac_filter) )
+    return 1;
+  CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf2, mf_lp_link,
+                      &lp->lp_mcast_filters)
+    if( ++n >= oof_mcast_mac_aggregation )
+      return 1;
+  return 0;
+}
+
+
 /* Find out whether there are any hwports that [mf] can install filters on.
  * ie. We're looking for hwports that support multicast replication or that
  * no other stack wants to install the same multicast filter on.
@@ -3971,6 +4259,14 @@ oof_mcast_filter_installable_hwports(struct oof_manager* fm,
   unsigned hwport_mask = mf->mf_hwport_mask;
   struct oof_mcast_filter* mf2;
 
+  /* Cluster-owned filters spread the group over the cluster's vi-set via
+   * RSS, and only go on hwports that support multicast replication: on
+   * other hwports they'd capture traffic wanted by other stacks, and the
+   * trs-keyed conflict machinery below doesn't arbitrate clusters.
+   */
+  if( mf->mf_filter.thc != NULL )
+    hwport_mask &= fm->fm_hwports_mcast_replicate_capable;
+
   CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf2, mf_lp_link,
                       &lp->lp_mcast_filters)
     if( mf2 != mf ) {
@@ -3990,9 +4286,11 @@ oof_mcast_install(struct oof_manager* fm, struct oof_mcast_member* mm,
 {
   struct oof_socket* skf = mm->mm_socket;
   struct tcp_helper_resource_s* skf_stack = oof_cb_socket_stack(skf);
+  struct tcp_helper_cluster_s* skf_thc = oof_socket_thc_effective(skf);
   struct oof_local_port* lp = skf->sf_local_port;
   unsigned install_hwport_mask;
   unsigned conflicted_port_mask;
+  unsigned mac_hwport_mask;
   struct oof_mcast_filter* mf;
   int rc;
   int mf_pushed = 0;
@@ -4029,11 +4327,13 @@ oof_mcast_install(struct oof_manager* fm, struct oof_mcast_member* mm,
    * support multicast replication and this isn't a connected socket.
    * Multicast replication means we can't conflict.  For connected sockets
    * we will only install mcast (wild match) filters on hwports that
-   * support multicast replication.
+   * support multicast replication.  Likewise for clustered sockets, whose
+   * filters are restricted to replication-capable hwports.
    *
    * Remove hardware filters that conflict.
    */
-  if( (mm->mm_hwport_mask & fm->fm_hwports_mcast_replicate_capable)
+  if( skf_thc == NULL &&
+      (mm->mm_hwport_mask & fm->fm_hwports_mcast_replicate_capable)
       != mm->mm_hwport_mask )  {
     CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf, mf_lp_link,
                         &lp->lp_mcast_filters) {
@@ -4055,12 +4355,16 @@ oof_mcast_install(struct oof_manager* fm, struct oof_mcast_member* mm,
     }
   }
 
-  mf = oof_local_port_find_mcast_filter(lp, skf_stack, mm->mm_maddr,
+  mf = oof_local_port_find_mcast_filter(lp, oof_socket_stack_effective(skf),
+                                        skf_thc, mm->mm_maddr,
                                         mm->mm_vlan_id);
   if( mf == NULL ) {
     mf = oof_mcast_filter_list_get(mcast_filters);
     oof_mcast_filter_init(mf, mm->mm_maddr, mm->mm_vlan_id);
-    mf->mf_filter.trs = skf_stack;
+    if( skf_thc != NULL )
+      mf->mf_filter.thc = skf_thc;
+    else
+      mf->mf_filter.trs = skf_stack;
     ci_dllist_push(&lp->lp_mcast_filters, &mf->mf_lp_link);
     mf_pushed = 1;
   }
@@ -4070,10 +4374,37 @@ oof_mcast_install(struct oof_manager* fm, struct oof_mcast_member* mm,
   ci_dllist_push(&mf->mf_memberships, &mm->mm_filter_link);
   mf->mf_hwport_mask |= OOF_MCAST_WILD_HWPORTS(fm, mm);
   install_hwport_mask = oof_mcast_filter_installable_hwports(fm, lp, mf);
+
+  /* When aggregating, capture the group with a shared MAC filter and only
+   * fall back to exact IP filters for hwports the MAC path can't cover.
+   * Hwports already covered by a MAC filter never get exact filters, even
+   * when aggregation no longer applies, to avoid duplicate delivery.
+   */
+  mac_hwport_mask = oof_mcast_filter_mac_hwports(fm, lp, mf);
+  if( oof_mcast_filter_use_mac(fm, lp, mf, install_hwport_mask) &&
+      (install_hwport_mask & ~mac_hwport_mask) != 0 ) {
+    rc = oof_hw_filter_update_mcast_mac(fm, &mf->mf_mac_filter, skf_stack,
+                                        mf->mf_maddr, mf->mf_vlan_id,
+                                        oo_hw_filter_hwports(
+                                                        &mf->mf_mac_filter) |
+                                        (install_hwport_mask &
+                                         ~mac_hwport_mask));
+    if( rc == 0 )
+      mac_hwport_mask = oof_mcast_filter_mac_hwports(fm, lp, mf);
+    else
+      /* Fall back to exact IP filters below. */
+      IPF_LOG(FSK_FMT "maddr="IPPORT_FMT" MAC filter error rc=%d; "
+              "using exact filters", FSK_PRI_ARGS(skf),
+              IPPORT_ARG(mm->mm_maddr, lp->lp_lport), rc);
+  }
+  mac_hwport_mask &= install_hwport_mask;
+
   maddr = CI_ADDR_FROM_IP4(mf->mf_maddr);
-  rc = oof_hw_filter_update(fm, &mf->mf_filter, skf_stack, AF_INET,
+  rc = oof_hw_filter_update(fm, &mf->mf_filter,
+                            oof_socket_stack_effective(skf), AF_INET,
                             lp->lp_protocol, addr_any, 0, maddr, lp->lp_lport,
-                            mf->mf_vlan_id, install_hwport_mask,
+                            mf->mf_vlan_id,
+                            install_hwport_mask & ~mac_hwport_mask,
                             OOF_SRC_FLAGS_DEFAULT_MCAST);
   if( rc != 0 ) {
     ci_addr_t laddr;
@@ -4089,6 +4420,8 @@ oof_mcast_install(struct oof_manager* fm, struct oof_mcast_member* mm,
     mm->mm_filter = old_mm_filter;
     ci_dllist_pop(&mf->mf_memberships);
     if( mf_pushed ) {
+      if( ! oo_hw_filter_is_empty(&mf->mf_mac_filter) )
+        oof_hw_filter_clear(fm, &mf->mf_mac_filter);
       ci_dllist_pop(&lp->lp_mcast_filters);
       ci_dllist_push(mcast_filters, &mf->mf_lp_link);
     }
@@ -4140,6 +4473,27 @@ oof_mcast_remove(struct oof_manager* fm, struct oof_mcast_member* mm,
   mm->mm_filter = NULL;
   ci_dllist_remove(&mm->mm_filter_link);
   if( ci_dllist_is_empty(&mf->mf_memberships) ) {
+    if( ! oo_hw_filter_is_empty(&mf->mf_mac_filter) ) {
+      /* Other groups sharing the MAC image may be relying on this filter:
+       * pass it to one of them rather than leaving a gap.  Any candidate
+       * will do, as the remainder see the filter wherever it lives (see
+       * oof_mcast_filter_mac_hwports()).  We skip candidates with exact
+       * filters on overlapping hwports to avoid duplicate delivery.
+       */
+      CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf2, mf_lp_link,
+                          &lp->lp_mcast_filters)
+        if( mf2 != mf && mf2->mf_filter.trs == mf->mf_filter.trs &&
+            mf2->mf_vlan_id == mf->mf_vlan_id &&
+            oof_mcast_maddr_mac_eq(mf->mf_maddr, mf2->mf_maddr) &&
+            oo_hw_filter_is_empty(&mf2->mf_mac_filter) &&
+            (oo_hw_filter_hwports(&mf2->mf_filter) &
+             oo_hw_filter_hwports(&mf->mf_mac_filter)) == 0 ) {
+          mf2->mf_mac_filter = mf->mf_mac_filter;
+          oo_hw_filter_init(&mf->mf_mac_filter);
+          break;
+        }
+      oof_hw_filter_clear(fm, &mf->mf_mac_filter);
+    }
     oof_hw_filter_clear(fm, &mf->mf_filter);
     IPF_LOG(FSK_FMT "CLEAR "IPPORT_FMT, FSK_PRI_ARGS(skf),
             IPPORT_ARG(mm->mm_maddr, lp->lp_lport));
@@ -4151,6 +4505,9 @@ oof_mcast_remove(struct oof_manager* fm, struct oof_mcast_member* mm,
     ci_addr_t maddr = CI_ADDR_FROM_IP4(mf->mf_maddr);
     mf->mf_hwport_mask = oof_mcast_filter_hwport_mask(fm, mf);
     hwport_mask = oof_mcast_filter_installable_hwports(fm, lp, mf);
+    /* Keep any MAC filter as-is even if [mf_hwport_mask] shrank: other
+     * groups may rely on it, and over-capture is harmless. */
+    hwport_mask &= ~oof_mcast_filter_mac_hwports(fm, lp, mf);
     oof_hw_filter_update(fm, &mf->mf_filter, mf->mf_filter.trs, AF_INET,
                          lp->lp_protocol, addr_any, 0, maddr, lp->lp_lport,
                          mf->mf_vlan_id, hwport_mask,
@@ -4164,9 +4521,11 @@ oof_mcast_remove(struct oof_manager* fm, struct oof_mcast_member* mm,
                       &lp->lp_mcast_filters)
     if( mf->mf_maddr == mm->mm_maddr ) {
       unsigned got_hwport_mask;
+      unsigned mac_hwport_mask = oof_mcast_filter_mac_hwports(fm, lp, mf);
       got_hwport_mask = oo_hw_filter_hwports(&mf->mf_filter);
-      if( mf->mf_hwport_mask != got_hwport_mask ) {
+      if( mf->mf_hwport_mask != (got_hwport_mask | mac_hwport_mask) ) {
         hwport_mask = oof_mcast_filter_installable_hwports(fm, lp, mf);
+        hwport_mask &= ~mac_hwport_mask;
         if( hwport_mask != got_hwport_mask ) {
           ci_addr_t maddr = CI_ADDR_FROM_IP4(mf->mf_maddr);
           IPF_LOG(FSK_FMT "maddr="IPPORT_FMT" if=%d MODIFY stack=%d wanted=%x "
@@ -4209,6 +4568,7 @@ oof_mcast_update(struct oof_manager* fm, struct oof_local_port *lp,
 
   before_hwport_mask = oo_hw_filter_hwports(&mf->mf_filter);
   install_hwport_mask = oof_mcast_filter_installable_hwports(fm, lp, mf);
+  install_hwport_mask &= ~oof_mcast_filter_mac_hwports(fm, lp, mf);
   if( install_hwport_mask != before_hwport_mask ) {
     ci_addr_t maddr = CI_ADDR_FROM_IP4(mf->mf_maddr);
     oof_hw_filter_update(fm, &mf->mf_filter, mf->mf_filter.trs, AF_INET,
@@ -4609,7 +4969,6 @@ oof_socket_mcast_del_all(struct oof_manager* fm, struct oof_socket* skf)
 static int
 oof_socket_mcast_install(struct oof_manager* fm, struct oof_socket* skf)
 {
-  struct tcp_helper_resource_s* skf_stack = oof_cb_socket_stack(skf);
   struct oof_mcast_filter* mf;
   struct oof_mcast_member* mm;
   struct oof_local_port* lp;
@@ -4637,7 +4996,10 @@ oof_socket_mcast_install(struct oof_manager* fm, struct oof_socket* skf)
                           &skf->sf_mcast_memberships) {
         if( mm->mm_filter == NULL &&
             OOF_NEED_MCAST_FILTER(fm, skf, mm) &&
-            oof_local_port_find_mcast_filter(lp, skf_stack, mm->mm_maddr,
+            oof_local_port_find_mcast_filter(lp,
+                                             oof_socket_stack_effective(skf),
+                                             oof_socket_thc_effective(skf),
+                                             mm->mm_maddr,
                                              mm->mm_vlan_id) == NULL )
           ++mf_needed;
       }
@@ -5047,6 +5409,177 @@ fail1:
 }
 
 
+/**********************************************************************
+*********************** RAW L2 ETHERTYPE ******************************
+**********************************************************************/
+
+/* Installs, refreshes or removes the hardware filter backing [fe] in
+ * response to interface state.  Structured like
+ * oof_tproxy_filter_update(), but there is only the one MAC-qualified
+ * ethertype filter to maintain. */
+static int
+oof_ethertype_filter_update(struct oof_manager* fm, struct oof_ethertype* fe)
+{
+  unsigned short vlan_id = OO_HW_VLAN_UNSPEC;
+  unsigned hwport_mask = 0;
+  unsigned allowed_hwport_mask;
+  unsigned effective_hwport_mask;
+  ci_mac_addr_t mac = { 0 };
+  struct oo_hw_filter_spec oo_filter_spec;
+  struct oof_local_interface_details* lid;
+  int rc;
+
+  ci_assert(spin_is_locked(&fm->fm_inner_lock));
+  ci_assert(mutex_is_locked(&fm->fm_outer_lock));
+  ci_assert(fe != NULL);
+  ci_assert(fe->fe_filter.trs != NULL || fe->fe_filter.thc != NULL);
+
+  lid = oof_local_interface_details_find(fm, fe->fe_ifindex);
+  if( lid == NULL ) {
+    IPF_LOG("%s: WARNING: cannot get details of if=%d",
+            __FUNCTION__, fe->fe_ifindex);
+    /* fall through to delete the filters */
+  }
+  else {
+    hwport_mask = lid->lid_hwport_mask;
+    vlan_id = lid->lid_vlan_id;
+    if( vlan_id == 0 )
+      vlan_id = OO_HW_VLAN_UNSPEC;
+    memcpy(mac, lid->lid_mac, sizeof(mac));
+  }
+
+  allowed_hwport_mask = fm->fm_hwports_available &
+                        (fm->fm_hwports_up | fm->fm_hwports_down);
+  effective_hwport_mask = hwport_mask & allowed_hwport_mask;
+
+  spin_unlock_bh(&fm->fm_inner_lock);
+
+  oo_filter_spec.type = OO_HW_FILTER_TYPE_ETHERTYPE;
+  oo_filter_spec.addr.ethertype.t = fe->fe_ethertype_be16;
+  memcpy(oo_filter_spec.addr.ethertype.mac, mac,
+         sizeof(oo_filter_spec.addr.ethertype.mac));
+  oo_filter_spec.vlan_id = vlan_id;
+  rc = oo_hw_filter_update(&fe->fe_filter, fe->fe_filter.trs,
+                           &oo_filter_spec, effective_hwport_mask,
+                           effective_hwport_mask, 0, OO_HW_SRC_FLAG_RSS_DST);
+
+  IPF_LOG("%s: if=%d ethertype=0x%04x hwports=%x/%x rc=%d", __FUNCTION__,
+          fe->fe_ifindex, CI_BSWAP_BE16(fe->fe_ethertype_be16), hwport_mask,
+          effective_hwport_mask, rc);
+
+  spin_lock_bh(&fm->fm_inner_lock);
+  return rc;
+}
+
+
+static struct oof_ethertype*
+oof_ethertype_find(struct oof_manager* fm,
+                   struct tcp_helper_resource_s* trs,
+                   int ifindex, ci_uint16 ethertype_be16)
+{
+  struct oof_ethertype* fe;
+  ci_assert(spin_is_locked(&fm->fm_inner_lock));
+  CI_DLLIST_FOR_EACH2(struct oof_ethertype, fe, fe_manager_link,
+                      &fm->fm_ethertypes) {
+    if( (ifindex < 0 || fe->fe_ifindex == ifindex) &&
+        (trs == NULL || fe->fe_filter.trs == trs) &&
+        (ethertype_be16 == 0 || fe->fe_ethertype_be16 == ethertype_be16) )
+      return fe;
+  }
+  return NULL;
+}
+
+
+/* Steer all traffic of a given ethertype arriving on [ifindex] to [trs].
+ * The caller is expected to consume the frames from the stack's RX path
+ * (see onload_rx_prefilter_set()); anything it does not consume is passed
+ * on to the kernel as usual.  Requires CAP_NET_RAW, as this diverts
+ * traffic the way an AF_PACKET socket would receive it. */
+int
+oof_ethertype_install(struct oof_manager* fm,
+                      struct tcp_helper_resource_s* trs,
+                      int ifindex, ci_uint16 ethertype_be16)
+{
+  struct oof_ethertype* fe;
+  int rc;
+
+#ifdef EFRM_NET_HAS_USER_NS
+  if( !ns_capable(oof_cb_user_ns(fm->fm_owner_private), CAP_NET_RAW) )
+#else
+  if( !capable(CAP_NET_RAW) )
+#endif
+    return -EPERM;
+
+  mutex_lock(&fm->fm_outer_lock);
+  spin_lock_bh(&fm->fm_inner_lock);
+
+  /* One owner per (ifindex, ethertype) flow, like tproxies. */
+  fe = oof_ethertype_find(fm, NULL, ifindex, ethertype_be16);
+  if( fe != NULL ) {
+    rc = -EALREADY;
+    goto fail1;
+  }
+
+  spin_unlock_bh(&fm->fm_inner_lock);
+  fe = CI_ALLOC_OBJ(struct oof_ethertype);
+  spin_lock_bh(&fm->fm_inner_lock);
+  if( fe == NULL ) {
+    OO_DEBUG_ERR(ci_log("%s: ERROR: out of memory", __FUNCTION__));
+    rc = -ENOMEM;
+    goto fail1;
+  }
+
+  fe->fe_ifindex = ifindex;
+  fe->fe_ethertype_be16 = ethertype_be16;
+  oo_hw_filter_init2(&fe->fe_filter, trs, NULL);
+
+  rc = oof_ethertype_filter_update(fm, fe);
+  if( rc == 0 )
+    ci_dllist_push(&fm->fm_ethertypes, &fe->fe_manager_link);
+  else
+    ci_free(fe);
+
+fail1:
+  spin_unlock_bh(&fm->fm_inner_lock);
+  mutex_unlock(&fm->fm_outer_lock);
+  return rc;
+}
+
+
+int
+oof_ethertype_free(struct oof_manager* fm,
+                   struct tcp_helper_resource_s* trs,
+                   int ifindex, ci_uint16 ethertype_be16)
+{
+  struct oof_ethertype* fe;
+  int rc = 0;
+
+  mutex_lock(&fm->fm_outer_lock);
+  spin_lock_bh(&fm->fm_inner_lock);
+
+  fe = oof_ethertype_find(fm, trs, ifindex, ethertype_be16);
+  if( fe == NULL ) {
+    rc = -ENOENT;
+    goto fail1;
+  }
+
+  ci_dllist_remove(&fe->fe_manager_link);
+  IPF_LOG("%s: if=%d ethertype=0x%04x", __FUNCTION__, fe->fe_ifindex,
+          CI_BSWAP_BE16(fe->fe_ethertype_be16));
+
+  spin_unlock_bh(&fm->fm_inner_lock);
+  oo_hw_filter_clear(&fe->fe_filter);
+  spin_lock_bh(&fm->fm_inner_lock);
+
+  ci_free(fe);
+
+fail1:
+  spin_unlock_bh(&fm->fm_inner_lock);
+  mutex_unlock(&fm->fm_outer_lock);
+  return rc;
+}
+
+
 /**********************************************************************
 ***********************************************************************
 **********************************************************************/
@@ -5075,6 +5608,9 @@ oof_socket_dump_w_lp(const char* pf, struct oof_manager* fm,
   struct oof_local_port* lp = skf->sf_local_port;
   struct oof_local_port_addr* lpa;
   struct oof_mcast_filter* mf, *mf2;
+  struct oo_hw_filter* hwf = NULL;
+  char hits_buf[32];
+  uint64_t hw_hits;
   const char* state = NULL;
   int n_laddr, n_filter, n_mine;
   int la_i;
@@ -5086,13 +5622,18 @@ oof_socket_dump_w_lp(const char* pf, struct oof_manager* fm,
   /* Work out whether the socket can receive any packets. */
   if( ! oo_hw_filter_is_empty(&skf->sf_full_match_filter) ) {
     state = "ACCELERATED (full)";
+    hwf = &skf->sf_full_match_filter;
   }
   else if( CI_IPX_IS_MULTICAST(skf->sf_laddr) ) {
     CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf, mf_lp_link,
                         &lp->lp_mcast_filters)
-      if( mf->mf_maddr == skf->sf_laddr.ip4 && mf->mf_filter.trs == skf_stack ) {
-        if( oo_hw_filter_hwports(&mf->mf_filter) )
+      if( mf->mf_maddr == skf->sf_laddr.ip4 &&
+          mf->mf_filter.trs == oof_socket_stack_effective(skf) &&
+          mf->mf_filter.thc == oof_socket_thc_effective(skf) ) {
+        if( oo_hw_filter_hwports(&mf->mf_filter) ) {
           state = "ACCELERATED (multicast laddr)";
+          hwf = &mf->mf_filter;
+        }
         else {
           /* See if there's another filter that we're sharing. */
           CI_DLLIST_FOR_EACH2(struct oof_mcast_filter, mf2, mf_lp_link,
@@ -5117,8 +5658,10 @@ oof_socket_dump_w_lp(const char* pf, struct oof_manager* fm,
     if( !CI_IPX_ADDR_IS_ANY(skf->sf_raddr) ) {
       if( oo_hw_filter_is_empty(&lpa->lpa_filter) )
         state = "ORPHANED (no filter)";
-      else if( oof_socket_can_share_hw_filter(skf, &lpa->lpa_filter) )
+      else if( oof_socket_can_share_hw_filter(skf, &lpa->lpa_filter) ) {
         state = "ACCELERATED (sharing wild)";
+        hwf = &lpa->lpa_filter;
+      }
       else
         state = "ORPHANED (filter points elsewhere)";
     }
@@ -5132,6 +5675,7 @@ oof_socket_dump_w_lp(const char* pf, struct oof_manager* fm,
             state = "ACCELERATED CLUSTERED-MASTER (wild)";
           else
             state = "ACCELERATED (wild)";
+          hwf = &lpa->lpa_filter;
         }
         else
           state = "!! BAD_FILTER !!";
@@ -5171,10 +5715,19 @@ oof_socket_dump_w_lp(const char* pf, struct oof_manager* fm,
       state = "ACCELERATED";
   }
 
-  log(loga, "%s: "SK_FMT" "SK_ADDR_FMT" lport_prenat=%d %s %s", pf,
+  /* Where the NIC can report a per-filter match count, show how many
+   * packets have hit this socket's filter: distinguishes "traffic never
+   * arrives" from "traffic arrives but is dropped later". */
+  hits_buf[0] = '\0';
+  if( hwf != NULL && oo_hw_filter_hits(hwf, &hw_hits) > 0 )
+    snprintf(hits_buf, sizeof(hits_buf), " hw_hits=%llu",
+             (unsigned long long) hw_hits);
+
+  log(loga, "%s: "SK_FMT" "SK_ADDR_FMT" lport_prenat=%d %s %s%s", pf,
       SK_PRI_ARGS(skf), SK_ADDR_ARGS(skf), FMT_PORT(skf->sf_lport_prenat),
       state,
-      oof_socket_thc_safe(skf) ? oof_cb_thc_name(oof_socket_thc_safe(skf)) : "");
+      oof_socket_thc_safe(skf) ? oof_cb_thc_name(oof_socket_thc_safe(skf)) : "",
+      hits_buf);
 }
 
 
@@ -5244,11 +5797,18 @@ oof_local_port_dump(struct oof_manager* fm, struct oof_local_port* lp,
     la = &fm->fm_local_addrs[la_i];
     lpa = &lp->lp_addr[la_i];
 
-    if( ! oo_hw_filter_is_empty(&lpa->lpa_filter) )
-      log(loga, "  FILTER " IPX_FMT ":%d hwports=%x stack=%d",
+    if( ! oo_hw_filter_is_empty(&lpa->lpa_filter) ) {
+      uint64_t hw_hits;
+      char hits_buf[32];
+      hits_buf[0] = '\0';
+      if( oo_hw_filter_hits(&lpa->lpa_filter, &hw_hits) > 0 )
+        snprintf(hits_buf, sizeof(hits_buf), " hw_hits=%llu",
+                 (unsigned long long) hw_hits);
+      log(loga, "  FILTER " IPX_FMT ":%d hwports=%x stack=%d%s",
           IPX_ARG(AF_IP(la->la_laddr)), FMT_PORT(lp->lp_lport),
           oo_hw_filter_hwports(&lpa->lpa_filter),
-          oof_cb_stack_id(lpa->lpa_filter.trs));
+          oof_cb_stack_id(lpa->lpa_filter.trs), hits_buf);
+    }
     if( ci_dllist_not_empty(&lpa->lpa_semi_wild_socks) ) {
       log(loga, "  semi-wild sockets:");
       CI_DLLIST_FOR_EACH2(struct oof_socket, skf, sf_lp_link,
@@ -5278,10 +5838,11 @@ oof_local_port_dump(struct oof_manager* fm, struct oof_local_port* lp,
                         &lp->lp_mcast_filters) {
       hwports_got = oo_hw_filter_hwports(&mf->mf_filter);
       hwports_uc = oof_mcast_filter_installable_hwports(fm, lp, mf);
-      log(loga, "    maddr="IPPORT_FMT" stack=%d hwports=%x,%x,%x",
+      log(loga, "    maddr="IPPORT_FMT" stack=%d hwports=%x,%x,%x mac=%x",
           IPPORT_ARG(mf->mf_maddr, lp->lp_lport),
           oof_cb_stack_id(mf->mf_filter.trs), mf->mf_hwport_mask,
-          hwports_uc, hwports_got);
+          hwports_uc, hwports_got,
+          oo_hw_filter_hwports(&mf->mf_mac_filter));
       CI_DLLIST_FOR_EACH2(struct oof_mcast_member, mm, mm_filter_link,
                           &mf->mf_memberships)
         log(loga, "      "SK_FMT" "SK_ADDR_FMT" if=%d hwports=%x,%x,%x %s",
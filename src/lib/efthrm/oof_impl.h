@@ -139,6 +139,18 @@ struct oof_tproxy {
 };
 
 
+/* Raw L2 steering: one MAC-qualified ethertype filter per (stack,
+ * ifindex, ethertype), directing a non-IP protocol's frames to the
+ * stack's VIs.  See oof_ethertype_install(). */
+struct oof_ethertype {
+  struct oo_hw_filter fe_filter;
+  int fe_ifindex;
+  ci_uint16 fe_ethertype_be16;
+
+  ci_dllink fe_manager_link;
+};
+
+
 struct oof_manager {
 
   /* Pointer to state belonging to the code module using this module. */
@@ -176,6 +188,9 @@ struct oof_manager {
   /* List of scalable-filter-manager structures, or "tproxies" for short. */
   ci_dllist    fm_tproxies;
 
+  /* List of raw-L2 ethertype steering filters (struct oof_ethertype). */
+  ci_dllist    fm_ethertypes;
+
   /* Track which ports we've requested tproxy global filters on.  For each
    * filter type we need to know which hwports we have a filter installed on.
    * We store this as a bitmask.
@@ -222,6 +237,10 @@ struct oof_manager {
   unsigned     fm_hwports_up_new;
   unsigned     fm_hwports_down_new;
   unsigned     fm_hwports_removed;
+  /* Hwports whose hardware state (e.g. RSS contexts) was rebuilt by an NIC
+   * reset; filters on these must be re-pushed even though the hwport never
+   * went administratively down. */
+  unsigned     fm_hwports_reset;
   unsigned     fm_hwports_avail_per_tag_new[OOF_HWPORT_AVAIL_TAG_NUM];
   unsigned     fm_hwports_mcast_replicate_capable_new;
   unsigned     fm_hwports_vlan_filters_new;
@@ -245,6 +264,14 @@ struct oof_mcast_filter {
 
   struct oo_hw_filter mf_filter;
 
+  /* When [oof_mcast_mac_aggregation] is enabled, groups may be captured
+   * with a filter on the multicast MAC address instead of exact IP
+   * filters.  Such a filter matches every group sharing the 23-bit MAC
+   * image and every local port, and is shared by all oof_mcast_filters on
+   * this local port with the same stack, MAC image and vlan; only one of
+   * them has the filter installed here at any time. */
+  struct oo_hw_filter mf_mac_filter;
+
   unsigned            mf_maddr;
 
   /* Union of the physical interfaces wanted by the [mf_memberships]. */
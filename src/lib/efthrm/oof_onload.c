@@ -89,6 +89,22 @@ void oof_onload_hwport_removed(efab_tcp_driver_t* drv, int hwport)
 }
 
 
+void oof_onload_hwport_reset(efab_tcp_driver_t* drv, int hwport)
+{
+  struct oo_filter_ns* fns;
+  ci_dllink* link;
+
+  mutex_lock(&drv->filter_ns_manager->ofnm_lock);
+
+  CI_DLLIST_FOR_EACH(link, &drv->filter_ns_manager->ofnm_ns_list) {
+    fns = CI_CONTAINER(struct oo_filter_ns, ofn_ofnm_link, link);
+    /* Always defer to the workitem: our callers hold stack locks. */
+    oof_hwport_reset(fns->ofn_filter_manager, hwport, 0);
+  }
+  mutex_unlock(&drv->filter_ns_manager->ofnm_lock);
+}
+
+
 void oof_onload_hwport_up_down(efab_tcp_driver_t* drv, int hwport, int up,
                                int mcast_replicate_capable, int vlan_filters,
                                int no5tuple, int sync)
@@ -520,3 +520,21 @@ unsigned oo_hw_filter_hwports(struct oo_hw_filter* oofilter)
         hwport_mask |= 1 << hwport;
   return hwport_mask;
 }
+
+
+int oo_hw_filter_hits(struct oo_hw_filter* oofilter, uint64_t* hits_out)
+{
+  uint64_t hits, total = 0;
+  int hwport, n_reported = 0;
+
+  if( oofilter->trs != NULL || oofilter->thc != NULL )
+    for( hwport = 0; hwport < CI_CFG_MAX_HWPORTS; ++hwport )
+      if( oofilter->filter_id[hwport] >= 0 &&
+          efrm_filter_query_hits(get_client(hwport),
+                                 oofilter->filter_id[hwport], &hits) == 0 ) {
+        total += hits;
+        ++n_reported;
+      }
+  *hits_out = total;
+  return n_reported;
+}
@@ -18,6 +18,8 @@
 
 #include <ci/efrm/pd.h>
 #include <ci/efrm/vi_set.h>
+#include <ci/efrm/efrm_client.h>
+#include <ci/efhw/efhw_types.h>
 #include <onload/nic.h>
 #include <onload/drv/dump_to_user.h>
 #include <kernel_utils/hugetlb.h>
@@ -163,6 +165,129 @@ static int /*bool*/ thc_has_live_stacks(tcp_helper_cluster_t* thc)
 }
 
 
+/* Period between RSS rebalance runs for clusters with a non-default
+ * EF_CLUSTER_RSS_POLICY. */
+#define THC_RSS_REBALANCE_PERIOD  HZ
+
+/* Weight given to cluster members on the NIC's NUMA node, relative to 1 for
+ * remote members, with EF_CLUSTER_RSS_POLICY=numa. */
+#define THC_RSS_NUMA_WEIGHT       4
+
+
+/* Sum of accept queue depths over the listening sockets of [thr]'s stack.
+ * Reads the shared state without the stack lock: the result is only a load
+ * heuristic, so races are harmless. */
+static unsigned thc_thr_listenq_depth(tcp_helper_resource_t* thr)
+{
+  ci_netif* ni = &thr->netif;
+  unsigned depth = 0;
+  unsigned i;
+
+  for( i = 0; i < ni->ep_tbl_n; ++i ) {
+    citp_waitable_obj* wo = ID_TO_WAITABLE_OBJ(ni, i);
+    if( wo->waitable.state == CI_TCP_LISTEN )
+      depth += ci_tcp_acceptq_n(&wo->tcp_listen);
+  }
+  return depth;
+}
+
+
+/* Reweight the RSS indirection tables of a cluster's VI sets according to
+ * the cluster's distribution policy.  Runs periodically off the global
+ * workqueue while the cluster exists; thc_cluster_free() cancels it before
+ * tearing anything down. */
+static void thc_rss_rebalance_work(struct work_struct* work)
+{
+  tcp_helper_cluster_t* thc = container_of(work, tcp_helper_cluster_t,
+                                           thc_rebalance_work.work);
+  /* efrm_vi_set_alloc() limits a set to 64 VIs. */
+  ci_uint32 load[64];
+  ci_uint32 weights[64];
+  int node[64];
+  ci_uint64 seen = 0;
+  ci_dllink* link;
+  int any_skewed = 0;
+  int i, q;
+
+  /* Clusters larger than a VI set can hold get no vi_sets and so cannot be
+   * rebalanced. */
+  if( thc->thc_cluster_size > 64 )
+    return;
+
+  /* Never block here: thc_cluster_free() may be waiting for us with
+   * thc_mutex held. */
+  if( ! mutex_trylock(&thc_mutex) )
+    goto reschedule;
+
+  memset(load, 0, sizeof(load[0]) * thc->thc_cluster_size);
+  for( q = 0; q < thc->thc_cluster_size; ++q )
+    node[q] = NUMA_NO_NODE;
+
+  CI_DLLIST_FOR_EACH(link, &thc->thc_thr_list) {
+    tcp_helper_resource_t* thr_walk = CI_CONTAINER(tcp_helper_resource_t,
+                                                   thc_thr_link, link);
+    int inst = thr_walk->thc_rss_instance;
+    if( inst < 0 || inst >= thc->thc_cluster_size )
+      continue;
+    load[inst] += thc_thr_listenq_depth(thr_walk);
+    node[inst] = thr_walk->thc_numa_node;
+    seen |= 1ULL << inst;
+  }
+
+  /* Until every RSS bucket has a member stack, leave the even striping that
+   * was programmed at allocation time in place: reweighting on partial
+   * information would starve members that are still starting up. */
+  if( seen != (thc->thc_cluster_size < 64 ?
+               (1ULL << thc->thc_cluster_size) - 1 : ~0ULL) ) {
+    mutex_unlock(&thc_mutex);
+    goto reschedule;
+  }
+
+  for( i = 0; i < CI_CFG_MAX_HWPORTS; ++i ) {
+    int uniform = 1;
+
+    if( thc->thc_vi_set[i] == NULL )
+      continue;
+
+    if( thc->thc_flags & THC_FLAG_RSS_LLOAD ) {
+      ci_uint32 max_load = 0;
+      for( q = 0; q < thc->thc_cluster_size; ++q )
+        max_load = CI_MAX(max_load, load[q]);
+      for( q = 0; q < thc->thc_cluster_size; ++q )
+        weights[q] = max_load + 1 - load[q];
+    }
+    else {
+      int nic_node = NUMA_NO_NODE;
+      if( oo_nics[i].efrm_client != NULL )
+        nic_node = dev_to_node(efrm_client_get_nic(oo_nics[i].efrm_client)
+                               ->dev);
+      for( q = 0; q < thc->thc_cluster_size; ++q )
+        weights[q] = ( nic_node != NUMA_NO_NODE && node[q] == nic_node ) ?
+                     THC_RSS_NUMA_WEIGHT : 1;
+    }
+
+    for( q = 1; q < thc->thc_cluster_size; ++q )
+      if( weights[q] != weights[0] )
+        uniform = 0;
+    /* Equal weights are what the NIC was programmed with at allocation
+     * time, so only touch the hardware state if the weights are skewed, or
+     * if a previously-programmed skew needs to be undone. */
+    if( ! uniform || thc->thc_rss_skewed )
+      efrm_vi_set_rss_rebalance(thc->thc_vi_set[i], weights,
+                                thc->thc_cluster_size);
+    if( ! uniform )
+      any_skewed = 1;
+  }
+  thc->thc_rss_skewed = any_skewed;
+
+  mutex_unlock(&thc_mutex);
+
+ reschedule:
+  queue_delayed_work(CI_GLOBAL_WORKQUEUE, &thc->thc_rebalance_work,
+                     THC_RSS_REBALANCE_PERIOD);
+}
+
+
 /* Allocate a new cluster.
  *
  * On success returns cluster with single reference */
@@ -192,6 +317,7 @@ static int thc_alloc(const char* cluster_name, int protocol, int port_be16,
   memset(thc, 0, sizeof(*thc));
   ci_dllist_init(&thc->thc_tlos);
   ci_dllist_init(&thc->thc_thr_list);
+  INIT_DELAYED_WORK(&thc->thc_rebalance_work, thc_rss_rebalance_work);
 
   thc->thc_thr_rrobin = kmalloc(sizeof(tcp_helper_resource_t*) * cluster_size,
                                 GFP_KERNEL);
@@ -294,6 +420,10 @@ redo:
   thc->thc_next = thc_head;
   thc_head = thc;
 
+  if( flags & (THC_FLAG_RSS_LLOAD | THC_FLAG_RSS_NUMA) )
+    queue_delayed_work(CI_GLOBAL_WORKQUEUE, &thc->thc_rebalance_work,
+                       THC_RSS_REBALANCE_PERIOD);
+
   *thc_out = thc;
   return 0;
 
@@ -437,6 +567,10 @@ static void thc_cluster_free(tcp_helper_cluster_t* thc)
 {
   int i;
 
+  /* Safe against the work requeueing itself, and against being called with
+   * thc_mutex held, as the work never blocks on that mutex. */
+  cancel_delayed_work_sync(&thc->thc_rebalance_work);
+
   if( thc->thc_ephem_table != NULL )
     tcp_helper_free_ephemeral_ports(thc->thc_ephem_table,
                                     thc->thc_ephem_table_entries);
@@ -1132,6 +1266,15 @@ static int tcp_helper_cluster_thc_flags(const ci_netif_config_opts* ni_opts)
   int maybe_prealloc_lports = ni_opts->tcp_shared_local_ports_per_ip ?
     0 : THC_FLAG_PREALLOC_LPORTS;
 
+  switch( ni_opts->cluster_rss_policy ) {
+  case CITP_CLUSTER_RSS_POLICY_LLOAD:
+    flags |= THC_FLAG_RSS_LLOAD;
+    break;
+  case CITP_CLUSTER_RSS_POLICY_NUMA:
+    flags |= THC_FLAG_RSS_NUMA;
+    break;
+  }
+
   /* The remaining flags are only applicable to scalable clusters, i.e. to
    * those that have a MAC filter pointing at their VI set.  If scalable
    * filters are disabled, or if they're not in one of the "rss" modes, then
@@ -352,6 +352,30 @@ tcp_helper_endpoint_set_filters(tcp_helper_endpoint_t* ep,
   if(CI_UNLIKELY( rc < 0 ))
     return rc;
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  /* Optionally take the hardware filter insertion off the connect() path:
+   * defer the whole operation to workqueue context for actively-opened TCP
+   * connections.  The software filter is already installed by the stack, so
+   * the connection is usable immediately; until the workqueue runs, packets
+   * from the peer fall through to the kernel stack.
+   *
+   * Only defer when no other non-atomic work is pending on this endpoint:
+   * that keeps ordering with deferred filter clears simple, and prevents the
+   * workqueue handler (which calls back in here) from deferring again. */
+  if( NI_OPTS(ni).async_filter_insert &&
+      (s->b.state & CI_TCP_STATE_TCP) && s->b.state != CI_TCP_LISTEN &&
+      ! CI_IPX_ADDR_IS_ANY(sock_raddr(s)) &&
+      OO_SP_IS_NULL(from_tcp_id) &&
+      OO_SP_IS_NULL(SOCK_TO_TCP(s)->local_peer) &&
+      ! oof_socket_is_armed(&ep->oofilter) &&
+      ! ci_tcp_use_mac_filter(ni, s, bindto_ifindex, from_tcp_id) &&
+      (ep->ep_aflags & OO_THR_EP_AFLAG_NON_ATOMIC) == 0 ) {
+    ep->set_filters_ifindex = bindto_ifindex;
+    tcp_helper_endpoint_queue_non_atomic(ep, OO_THR_EP_AFLAG_SET_FILTERS);
+    return 0;
+  }
+#endif
+
   /* The lock is needed for assertions with CI_NETIF_FLAG_IN_DL_CONTEXT
    * flag only. */
   ci_assert( ci_netif_is_locked(&ep->thr->netif) );
@@ -499,6 +523,7 @@ tcp_helper_endpoint_set_filters(tcp_helper_endpoint_t* ep,
       flags |= OOF_SOCKET_ADD_FLAG_NO_UCAST;
     }
 
+    CITP_STATS_NETIF(++ni->state->stats.hw_filter_set);
     rc = oof_socket_add(oo_filter_ns_to_manager(ep->thr->filter_ns),
                         &ep->oofilter, flags, protocol,
                         af_space, laddr, lport, raddr, rport, NULL);
@@ -513,6 +538,8 @@ tcp_helper_endpoint_set_filters(tcp_helper_endpoint_t* ep,
 #endif
     if( rc == 0 || rc == -EFILTERSSOME )
       s->s_flags |= CI_SOCK_FLAG_FILTER;
+    else if( rc == -EBUSY || rc == -ENOBUFS || rc == -ENOSPC )
+      CITP_STATS_NETIF(++ni->state->stats.hw_filter_nospc);
   }
 
  set_os_port_keeper_and_out:
@@ -605,6 +632,12 @@ tcp_helper_endpoint_clear_filters(tcp_helper_endpoint_t* ep,
            flags & EP_CLEAR_FILTERS_FLAG_NEED_UPDATE ? " NEED_UPDATE":"")
   );
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  /* Cancel any deferred filter-set (EF_ASYNC_FILTER_INSERT) that has not
+   * run yet: there is no longer anything to install. */
+  ci_atomic32_and(&ep->ep_aflags, ~OO_THR_EP_AFLAG_SET_FILTERS);
+#endif
+
   /* Sockets have either FILTER or MAC_FILTER with exception of
    * scalable SO_REUSEPORT listen sockets, which can have both */
   ci_assert_impl(! (s->b.state == CI_TCP_LISTEN &&
@@ -129,12 +129,12 @@ static int efab_file_move_supported_udp(ci_netif *ni, ci_udp_state *us,
   }
 
   /* Do not copy any packets */
-  if( ci_udp_recv_q_not_empty(&us->recv_q) ||
+  if( ci_udp_rx_q_any_not_empty(us) ||
       us->zc_kernel_datagram != OO_PP_ID_NULL ||
       us->zc_kernel_datagram_count != 0 ||
       us->tx_count != 0 || us->tx_async_q != CI_ILL_END ) {
     if( do_assert ) {
-      ci_assert(! ci_udp_recv_q_not_empty(&us->recv_q));
+      ci_assert(! ci_udp_rx_q_any_not_empty(us));
       ci_assert_equal(us->zc_kernel_datagram, OO_PP_ID_NULL);
       ci_assert_equal(us->zc_kernel_datagram_count, 0);
       ci_assert_equal(us->tx_count, 0);
@@ -583,9 +583,9 @@ fail1_ni_unlocked:
   return rc;
 }
 
-int efab_file_move_to_alien_stack_rsop(ci_private_t *stack_priv, void *arg)
+static int
+efab_file_move_fd(ci_private_t *stack_priv, ci_fixed_descriptor_t sock_fd)
 {
-  ci_fixed_descriptor_t sock_fd = *(ci_fixed_descriptor_t *)arg;
   struct file *sock_file = fget(sock_fd);
   ci_private_t *sock_priv;
   tcp_helper_resource_t *old_thr;
@@ -660,6 +660,42 @@ int efab_file_move_to_alien_stack_rsop(ci_private_t *stack_priv, void *arg)
   return rc;
 }
 
+int efab_file_move_to_alien_stack_rsop(ci_private_t *stack_priv, void *arg)
+{
+  return efab_file_move_fd(stack_priv, *(ci_fixed_descriptor_t *)arg);
+}
+
+/* Batched variant of the above.  Entries are moved independently and the
+ * per-entry result is written to the user's [rcs] array, so one failed
+ * move does not abort the rest of the batch and the caller gets a
+ * per-connection completion.  Batching amortises the system call and
+ * stack-attach costs when many hot connections are handed to a worker's
+ * stack at once; each move's hardware filter insertion is still a
+ * synchronous adapter operation, as the NIC offers no batched
+ * filter update. */
+int efab_file_move_to_alien_stack_batch_rsop(ci_private_t *stack_priv,
+                                             void *arg)
+{
+  oo_move_fd_batch_t *op = arg;
+  ci_int32 __user* fds = CI_USER_PTR_GET(op->fds);
+  ci_int32 __user* rcs = CI_USER_PTR_GET(op->rcs);
+  ci_int32 fd;
+  ci_int32 rc;
+  int i;
+
+  if( op->n < 0 || fds == NULL || rcs == NULL )
+    return -EINVAL;
+
+  for( i = 0; i < op->n; ++i ) {
+    if( get_user(fd, fds + i) )
+      return -EFAULT;
+    rc = efab_file_move_fd(stack_priv, fd);
+    if( put_user(rc, rcs + i) )
+      return -EFAULT;
+  }
+  return 0;
+}
+
 /* Locking policy:
  * Enterance: priv->thr->netif is assumed to be locked.
  * Exit: all stacks (the client stack and the listener's stack) are
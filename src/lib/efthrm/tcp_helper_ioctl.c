@@ -658,6 +658,29 @@ efab_ep_filter_mcast_add(ci_private_t *priv, void *arg)
   return rc;
 }
 static int
+efab_ep_filter_mcast_add_batch(ci_private_t *priv, void *arg)
+{
+  oo_tcp_filter_mcast_batch_t *op = arg;
+  tcp_helper_endpoint_t* ep;
+  ci_uint32 i = 0;
+  int rc = efab_ioctl_get_ep(priv, op->tcp_id, &ep);
+  if( rc != 0 )
+    return rc;
+  if( op->count > OO_MCAST_BATCH_MAX )
+    return -EINVAL;
+  /* One syscall programs the whole batch: hardware filter insertion and
+   * software demux state for each group, without returning to user-level
+   * in between.  On failure op->count reports how many were added. */
+  for( i = 0; i < op->count; ++i ) {
+    rc = oof_socket_mcast_add(oo_filter_ns_to_manager(ep->thr->filter_ns),
+                              &ep->oofilter, op->addrs[i], op->ifindex);
+    if( rc != 0 )
+      break;
+  }
+  op->count = i;
+  return rc;
+}
+static int
 efab_ep_filter_mcast_del(ci_private_t *priv, void *arg)
 {
   oo_tcp_filter_mcast_t *op = arg;
@@ -859,6 +882,74 @@ efab_tcp_helper_waitable_wake_rsop(ci_private_t* priv, void* arg)
   return 0;
 }
 
+
+/* Drain the shared-memory slow-path command ring.  Called on every ioctl
+ * entry as well as from the explicit doorbell, so user level only needs to
+ * kick when the ring goes from empty to non-empty.  The ring lives in
+ * untrusted shared state: we stop at the first unpublished slot rather
+ * than waiting for a producer, and endpoint ids are validated by
+ * ci_trs_get_valid_ep().
+ */
+void efab_slowpath_ring_drain(tcp_helper_resource_t* trs)
+{
+  ci_netif_state* ns = trs->netif.state;
+  struct oo_slowpath_req* req;
+  ci_uint32 drained, op;
+
+  if( ns->slowpath_added == ns->slowpath_drained )
+    return;
+
+  /* Single drainer at a time; a concurrent drainer will pick up anything
+   * we miss because it re-checks after releasing the flag, as do we. */
+  if( ci_cas32u_fail(&trs->slowpath_draining, 0, 1) )
+    return;
+
+ again:
+  for( drained = ns->slowpath_drained;
+       drained != ns->slowpath_added; ++drained ) {
+    req = &ns->slowpath_ring[drained & (OO_SLOWPATH_RING_SIZE - 1)];
+    op = req->op;
+    if( op == OO_SLOWPATH_FREE )
+      /* Slot claimed but not yet published; the producer's doorbell (or
+       * its next ioctl) will bring us back. */
+      break;
+    ci_rmb();
+    switch( op ) {
+    case OO_SLOWPATH_WAITABLE_WAKE:
+      tcp_helper_endpoint_wakeup(trs, ci_trs_get_valid_ep(trs, req->arg));
+      break;
+    default:
+      /* Unknown op from untrusted shared state: discard it. */
+      break;
+    }
+    req->op = OO_SLOWPATH_FREE;
+    ci_wmb();
+    ns->slowpath_drained = drained + 1;
+  }
+
+  trs->slowpath_draining = 0;
+  ci_mb();
+  /* Close the race with a producer that published after our scan but saw
+   * the ring as non-empty and so did not kick.  Only retry if the head
+   * slot has actually been published, else we would spin on a producer
+   * that has claimed a slot but not yet filled it in. */
+  if( ns->slowpath_added != ns->slowpath_drained &&
+      ns->slowpath_ring[ns->slowpath_drained &
+                        (OO_SLOWPATH_RING_SIZE - 1)].op != OO_SLOWPATH_FREE &&
+      ci_cas32u_succeed(&trs->slowpath_draining, 0, 1) )
+    goto again;
+}
+
+
+static int
+oo_slowpath_kick_rsop(ci_private_t* priv, void* arg)
+{
+  if( priv->thr == NULL )
+    return -EINVAL;
+  efab_slowpath_ring_drain(priv->thr);
+  return 0;
+}
+
 /* This resource op must be called with the stack lock held.  This ensures
  * that we sync a consistent set of state to the OS socket when it is created.
  * All operations that can affect what we sync (setsockopt, ioctl, fcntl) are
@@ -1014,6 +1105,14 @@ oo_design_parameters_rsop(ci_private_t* priv, void *arg)
   return efab_tcp_helper_design_parameters(priv->thr, arg);
 }
 
+static int
+oo_stack_persist_rsop(ci_private_t* priv, void *arg)
+{
+  if (priv->thr == NULL)
+    return -EINVAL;
+  return efab_tcp_helper_set_persistent(priv->thr, *(ci_int32*)arg);
+}
+
 static int
 oo_eplock_lock_rsop(ci_private_t* priv, void* arg)
 {
@@ -1078,6 +1177,7 @@ oo_ioctl_debug_op(ci_private_t *priv, void *arg)
   case __CI_DEBUG_OP_NETIF_CONFIG_OPTS_DUMP__:
   case __CI_DEBUG_OP_STACK_TIME__:
   case __CI_DEBUG_OP_VI_INFO__:
+  case __CI_DEBUG_OP_FLIGHT_RECORDER__:
     rc = tcp_helper_dump_stack(op->u.dump_stack.stack_id,
                                op->u.dump_stack.orphan_only,
                                CI_USER_PTR_GET(op->u.dump_stack.user_buf),
@@ -1112,9 +1212,19 @@ static DEFINE_MUTEX(ctor_mutex);
 
   ci_resource_onload_alloc_t *alloc = arg;
   tcp_helper_resource_t* trs;
+  int named = alloc->in_name[0] != '\0';
   int rc;
 
-  mutex_lock(&ctor_mutex);
+  /* Only named stacks need serialising: UL looks a name up and falls back
+   * to creating it, so two racing creators must not both build a full
+   * stack.  (The check-and-insert in tcp_helper_rm_alloc() is atomic under
+   * THR_TABLE.lock, so a race is safe, but the loser would pay for a
+   * complete construction only to tear it down again.)  Anonymous stacks
+   * cannot collide, and holding a global mutex across the whole ~100ms
+   * construction serialises concurrent stack creation at boot, so they
+   * proceed in parallel. */
+  if( named )
+    mutex_lock(&ctor_mutex);
   rc = tcp_helper_alloc_ul(alloc, -1, &trs);
   if( rc == 0 ) {
     rc = oo_priv_set_stack(priv, trs);
@@ -1125,7 +1235,8 @@ static DEFINE_MUTEX(ctor_mutex);
     else
       oo_thr_ref_drop(trs->ref, OO_THR_REF_APP);
   }
-  mutex_unlock(&ctor_mutex);
+  if( named )
+    mutex_unlock(&ctor_mutex);
   return rc;
 }
 static int
@@ -1189,6 +1300,8 @@ ioctl_kill_self(ci_private_t *priv, void *unused)
 
 #if CI_CFG_ENDPOINT_MOVE
 extern int efab_file_move_to_alien_stack_rsop(ci_private_t *priv, void *arg);
+extern int efab_file_move_to_alien_stack_batch_rsop(ci_private_t *priv,
+                                                    void *arg);
 extern int efab_tcp_loopback_connect(ci_private_t *priv, void *arg);
 extern int efab_tcp_helper_reuseport_bind(ci_private_t *priv, void *arg);
 #endif
@@ -1275,11 +1388,16 @@ static int efab_tcp_helper_zc_register_buffers_rsop(ci_private_t* priv,
   struct tcp_helper_usermem* um;
   size_t nbytes;
 
+  if( rb->flags & ~(ci_uint64)OO_ZC_REGISTER_BUFFERS_SEND_ONLY )
+    return -EINVAL;
+
   um = kmalloc(sizeof(*um), GFP_KERNEL);
   if( ! um )
     return -ENOMEM;
 
   rc = efab_tcp_helper_map_usermem(trs, &um->um, rb->base_ptr, rb->num_pages,
+                                   ! (rb->flags &
+                                      OO_ZC_REGISTER_BUFFERS_SEND_ONLY),
                                    &hw_addrs);
   if( rc < 0 ) {
     kfree(um);
@@ -1625,6 +1743,7 @@ oo_operations_table_t oo_operations[] = {
   op(OO_IOC_EP_FILTER_CLEAR,     efab_ep_filter_clear),
   op(OO_IOC_EP_FILTER_MCAST_ADD, efab_ep_filter_mcast_add),
   op(OO_IOC_EP_FILTER_MCAST_DEL, efab_ep_filter_mcast_del),
+  op(OO_IOC_EP_FILTER_MCAST_ADD_BATCH, efab_ep_filter_mcast_add_batch),
   op(OO_IOC_EP_FILTER_DUMP,      efab_ep_filter_dump),
 
   op(OO_IOC_TCP_SOCK_LOCK,      efab_tcp_helper_sock_lock_slow_rsop),
@@ -1674,6 +1793,7 @@ oo_operations_table_t oo_operations[] = {
 #if CI_CFG_ENDPOINT_MOVE
   op(OO_IOC_TCP_LOOPBACK_CONNECT, efab_tcp_loopback_connect),
   op(OO_IOC_MOVE_FD, efab_file_move_to_alien_stack_rsop),
+  op(OO_IOC_MOVE_FD_BATCH, efab_file_move_to_alien_stack_batch_rsop),
   op(OO_IOC_EP_REUSEPORT_BIND, efab_tcp_helper_reuseport_bind),
   op(OO_IOC_CLUSTER_DUMP,      efab_cluster_dump),
 #endif
@@ -1706,6 +1826,8 @@ oo_operations_table_t oo_operations[] = {
   op(OO_IOC_EFCT_SUPERBUF_CONFIG_REFRESH,oo_efct_superbuf_config_refresh_rsop),
   op(OO_IOC_PKT_BUF_MMAP, oo_pkt_buf_map_rsop),
   op(OO_IOC_DESIGN_PARAMETERS, oo_design_parameters_rsop),
+  op(OO_IOC_STACK_PERSIST, oo_stack_persist_rsop),
+  op(OO_IOC_SLOWPATH_KICK, oo_slowpath_kick_rsop),
 
 /* Here come non contigous operations only, their position need to match
  * index according to their placeholder */
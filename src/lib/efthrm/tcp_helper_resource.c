@@ -93,6 +93,114 @@ MODULE_PARM_DESC(max_packets_per_stack,
                  "option are not applied retrospectively to stacks already "
                  "existing before the change.");
 
+/* Host-wide budget for packet buffers allocated beyond each stack's floor.
+ * Stacks allocate packet sets on demand, so with a budget in place
+ * EF_MAX_PACKETS can be sized for a stack's worst-case burst without every
+ * stack pinning that worst case simultaneously: the excess over the floor
+ * is shared first-come-first-served and returned when a stack is
+ * destroyed. */
+static int shared_packets_max = -1;
+module_param(shared_packets_max, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(shared_packets_max,
+                 "Limit the total number of packet buffers allocated across "
+                 "all Onload stacks in excess of their per-stack floors "
+                 "(EF_MIN_FREE_PACKETS).  Each stack can always allocate up "
+                 "to its floor; allocations beyond the floor fail once this "
+                 "budget is exhausted, until another stack releases its "
+                 "buffers.  -1 means no limit.");
+
+/* Number of packet sets currently debited from the shared budget.
+ * Protected by THR_TABLE.lock. */
+static unsigned shared_packet_sets_used;
+
+
+static int shared_packet_set_get(tcp_helper_resource_t* trs)
+{
+  ci_irqlock_state_t lock_flags;
+  int rc = 0;
+
+  if( shared_packets_max < 0 )
+    return 0;
+  ci_irqlock_lock(&THR_TABLE.lock, &lock_flags);
+  if( shared_packet_sets_used + 1 >
+      ((unsigned) shared_packets_max >> CI_CFG_PKTS_PER_SET_S) ) {
+    rc = -ENOSPC;
+  }
+  else {
+    ++shared_packet_sets_used;
+    ++trs->pkt_sets_budgeted;
+  }
+  ci_irqlock_unlock(&THR_TABLE.lock, &lock_flags);
+  return rc;
+}
+
+
+static void shared_packet_sets_put(tcp_helper_resource_t* trs, unsigned n)
+{
+  ci_irqlock_state_t lock_flags;
+
+  if( n == 0 )
+    return;
+  ci_irqlock_lock(&THR_TABLE.lock, &lock_flags);
+  ci_assert_ge(shared_packet_sets_used, n);
+  ci_assert_ge(trs->pkt_sets_budgeted, n);
+  shared_packet_sets_used -= n;
+  trs->pkt_sets_budgeted -= n;
+  ci_irqlock_unlock(&THR_TABLE.lock, &lock_flags);
+}
+
+
+/* Host-wide admission ledger for stack memory.  A stack's worst-case
+ * pinned footprint -- the shared-state/socket-buffer shmbuf plus a fully
+ * populated packet buffer pool -- is known exactly before anything is
+ * allocated, so oversubscription can be refused deterministically at
+ * stack creation rather than degrading mid-run when an on-demand
+ * allocation fails. */
+static int pinned_mem_max_mb = -1;
+module_param(pinned_mem_max_mb, int, S_IRUGO | S_IWUSR);
+MODULE_PARM_DESC(pinned_mem_max_mb,
+                 "Limit the total worst-case pinned memory (in MiB) of all "
+                 "Onload stacks on this host.  Each stack's worst-case "
+                 "footprint is debited from this budget at creation time "
+                 "and stack creation fails cleanly once the budget is "
+                 "exhausted.  -1 means no limit.");
+
+/* Bytes currently debited from the ledger.  Protected by THR_TABLE.lock. */
+static ci_uint64 pinned_mem_accounted;
+
+
+static int stack_mem_account(tcp_helper_resource_t* trs, ci_uint64 bytes)
+{
+  ci_irqlock_state_t lock_flags;
+  int rc = 0;
+
+  ci_irqlock_lock(&THR_TABLE.lock, &lock_flags);
+  if( pinned_mem_max_mb >= 0 &&
+      pinned_mem_accounted + bytes > (ci_uint64) pinned_mem_max_mb << 20 ) {
+    rc = -ENOSPC;
+  }
+  else {
+    pinned_mem_accounted += bytes;
+    trs->mem_accounted = bytes;
+  }
+  ci_irqlock_unlock(&THR_TABLE.lock, &lock_flags);
+  return rc;
+}
+
+
+static void stack_mem_unaccount(tcp_helper_resource_t* trs)
+{
+  ci_irqlock_state_t lock_flags;
+
+  if( trs->mem_accounted == 0 )
+    return;
+  ci_irqlock_lock(&THR_TABLE.lock, &lock_flags);
+  ci_assert_ge(pinned_mem_accounted, trs->mem_accounted);
+  pinned_mem_accounted -= trs->mem_accounted;
+  trs->mem_accounted = 0;
+  ci_irqlock_unlock(&THR_TABLE.lock, &lock_flags);
+}
+
 static int allow_insecure_setuid_sharing;
 module_param(allow_insecure_setuid_sharing, int, S_IRUGO | S_IWUSR);
 MODULE_PARM_DESC(allow_insecure_setuid_sharing,
@@ -129,6 +237,17 @@ MODULE_PARM_DESC(periodic_poll_skew,
                  "Allowed time skew for periodic polls.  "
                  "Defaults to 10ms.");
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+static int shared_periodic_poll = 1;
+module_param(shared_periodic_poll, int, S_IRUGO);
+MODULE_PARM_DESC(shared_periodic_poll,
+                 "Run periodic stack polls on a single shared worker pool "
+                 "rather than giving each stack its own workqueue.  Saves a "
+                 "kernel worker pool per stack on hosts running many stacks. "
+                 "Stacks with EF_PERIODIC_TIMER_CPU set always keep their "
+                 "own workqueue so the pinning is honoured.");
+#endif
+
 
 /* Global structure for onload driver */
 efab_tcp_driver_t efab_tcp_driver;
@@ -1328,13 +1447,16 @@ get_vi_settings(ci_netif* ni, struct efhw_nic* nic,
   info->try_ctpio = 0;
   info->retry_without_ctpio = 0;
 
-  if( NI_OPTS(ni).af_xdp_zerocopy ) {
+  /* Zerocopy only means anything to AF_XDP adapters; with the option now
+   * defaulting to on, do not warn about the NICs it does not apply to. */
+  if( NI_OPTS(ni).af_xdp_zerocopy &&
+      nic->devtype.arch == EFHW_ARCH_AF_XDP ) {
     if (nic->flags & NIC_FLAG_RX_ZEROCOPY) {
       info->ef_vi_flags |= EF_VI_RX_ZEROCOPY;
       info->efhw_flags |= EFHW_VI_RX_ZEROCOPY;
     } else {
       NI_LOG(ni, CONFIG_WARNINGS,
-             "[%s]: WARNING: Zerocopy is required but NIC does not support it",
+             "[%s]: WARNING: Zerocopy requested but NIC does not support it",
              ni->state->pretty_name);
     }
   }
@@ -1783,6 +1905,7 @@ static int allocate_vis(tcp_helper_resource_t* trs,
     /* FIXME we should impose vi_set instance top down */
     if( thc ) {
       trs->thc_rss_instance = efrm_vi_set_get_vi_instance(vi_rs);
+      trs->thc_numa_node = numa_node_id();
       ns->rss_instance = trs->thc_rss_instance;
       ns->cluster_size = thc->thc_cluster_size;
     }
@@ -2050,6 +2173,9 @@ static void release_pkts(tcp_helper_resource_t* trs)
   for (i = 0; i < ni->pkt_sets_n; i++)
     oo_iobufset_pages_release(ni->pkt_bufs[i]);
   vfree(ni->pkt_bufs);
+
+  /* Return this stack's share of the host-wide packet budget. */
+  shared_packet_sets_put(trs, trs->pkt_sets_budgeted);
 }
 
 
@@ -2241,8 +2367,10 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   int no_active_wild_pools, no_active_wild_table_entries;
 #endif
   int no_seq_table_entries;
+  int no_mcast_tbl_entries;
   unsigned vi_state_bytes;
   unsigned dma_addrs_bytes;
+  ci_uint64 shm_bytes, pktbuf_bytes;
 #if CI_CFG_PIO
   unsigned pio_bufs_ofs = 0;
 #endif
@@ -2265,6 +2393,8 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
 #endif
   trs->buf_mmap_bytes = 0;
   trs->efct_shm_mmap_bytes = 0;
+  trs->pkt_sets_budgeted = 0;
+  trs->mem_accounted = 0;
 
   no_table_entries = ci_netif_filter_table_size(ni);
 
@@ -2280,6 +2410,13 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
     no_seq_table_entries = 0;
   }
 
+  if( NI_OPTS(ni).mcast_demux != 0 )
+    /* Double the size to keep the table sparse, and round up to a power of
+     * two. */
+    no_mcast_tbl_entries = 1u << ci_log2_ge(NI_OPTS(ni).mcast_demux * 2, 1);
+  else
+    no_mcast_tbl_entries = 0;
+
   /* pkt_sets_n should be zeroed before possible NIC reset */
   if( NI_OPTS(ni).max_packets > max_packets_per_stack ) {
     OO_DEBUG_ERR(ci_log("WARNING: EF_MAX_PACKETS reduced from %d to %d due to "
@@ -2363,6 +2500,8 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   sz += filter_table_size;
   sz = CI_ROUND_UP(sz, __alignof__(ci_netif_filter_table_entry_ext));
   sz += filter_table_ext_size;
+  sz = CI_ROUND_UP(sz, __alignof__(ci_netif_mcast_tbl_entry));
+  sz += sizeof(ci_netif_mcast_tbl_entry) * no_mcast_tbl_entries;
 
 #if CI_CFG_IPV6
   sz = CI_ROUND_UP(sz, __alignof__(ci_ip6_netif_filter_table));
@@ -2399,11 +2538,28 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   /* Now add in the pages for the shared state. */
   i += sz / OO_SHARED_BUFFER_CHUNK_SIZE;
 
+  /* Preflight admission: everything this stack can ever pin is now known
+   * exactly, so debit the host-wide ledger before allocating anything.
+   */
+  shm_bytes = (ci_uint64) i * OO_SHARED_BUFFER_CHUNK_SIZE;
+  pktbuf_bytes = (ci_uint64) ni->pkt_sets_max * PKTS_PER_SET *
+                 CI_CFG_PKT_BUF_SIZE;
+  rc = stack_mem_account(trs, shm_bytes + pktbuf_bytes);
+  if( rc < 0 ) {
+    ci_log("%s: stack would pin up to %llu bytes (shm=%llu pktbuf=%llu) but "
+           "%llu bytes are already accounted against pinned_mem_max_mb=%d",
+           __FUNCTION__, (unsigned long long) (shm_bytes + pktbuf_bytes),
+           (unsigned long long) shm_bytes, (unsigned long long) pktbuf_bytes,
+           (unsigned long long) pinned_mem_accounted, pinned_mem_max_mb);
+    goto fail1;
+  }
+
   /* Allocate the shmbuf, and fault in the pages for the shared state (but not
    * for the sockets).  These pages get zeroed, so all fields in the shared
    * state can be assumed to have been zero-initialised. */
   rc = oo_shmbuf_alloc(&ni->shmbuf, OO_SHARED_BUFFER_CHUNK_ORDER, i,
-                       sz / OO_SHARED_BUFFER_CHUNK_SIZE);
+                       sz / OO_SHARED_BUFFER_CHUNK_SIZE,
+                       NI_OPTS(ni).stack_numa_node);
   if( rc < 0 ) {
     OO_DEBUG_ERR(ci_log("%s: failed to alloc shmbuf for shared state and "
                         "socket buffers (%d)", __FUNCTION__, rc));
@@ -2412,9 +2568,16 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
 
   ns = ni->state = (ci_netif_state*) oo_shmbuf_off2ptr(&ni->shmbuf, 0);
 
+  /* Record where the shared state actually landed, so that stackdump can
+   * report the achieved placement whether or not EF_STACK_NUMA_NODE was
+   * honoured. */
+  ns->stack_alloc_numa_node = page_to_nid(vmalloc_to_page(ns));
+
   CI_DEBUG(ns->flags |= CI_NETIF_FLAG_DEBUG);
 
   ns->netif_mmap_bytes = oo_shmbuf_size(&ni->shmbuf);
+  ns->preflight_shm_bytes = shm_bytes;
+  ns->preflight_pktbuf_bytes = pktbuf_bytes;
 
   ns->stack_id = trs->id;
   ns->ep_ofs = ni->ep_ofs = sz;
@@ -2482,6 +2645,11 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   ns->table_ext_ofs = ns_ofs;
   ns_ofs += filter_table_ext_size;
 
+  ns_ofs = CI_ROUND_UP(ns_ofs, __alignof__(ci_netif_mcast_tbl_entry));
+  ns->mcast_tbl_ofs = ns_ofs;
+  ns->mcast_tbl_entries_n = no_mcast_tbl_entries;
+  ns_ofs += sizeof(ci_netif_mcast_tbl_entry) * no_mcast_tbl_entries;
+
 #if CI_CFG_IPV6
   ns_ofs = CI_ROUND_UP(ns_ofs, __alignof__(ci_ip6_netif_filter_table));
   ns->ip6_table_ofs = ns_ofs;
@@ -2513,6 +2681,7 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   ni->deferred_pkts = (void*) ((char*) ns + ns->deferred_pkts_ofs);
   ni->filter_table = (void*) ((char*) ns + ns->table_ofs);
   ni->filter_table_ext = (void*) ((char*) ns + ns->table_ext_ofs);
+  ni->mcast_tbl = (void*) ((char*) ns + ns->mcast_tbl_ofs);
 
 #if CI_CFG_IPV6
   ni->ip6_filter_table = (void*) ((char*) ns + ns->ip6_table_ofs);
@@ -2534,9 +2703,13 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
   ni->packets->sets_n = 0;
   ni->packets->n_pkts_allocated = 0;
 
-  /* Initialize the free list of synrecv/aux bufs */
+  /* Initialize the free lists of synrecv/aux bufs */
   oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ni->state->free_aux_mem));
   ni->state->n_free_aux_bufs = 0;
+  for( i = 0; i < CI_TCP_AUX_TYPE_NUM; i++ )
+    oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &ni->state->free_aux_typed[i]));
+  memset(ni->state->n_free_aux_typed, 0,
+         sizeof(ni->state->n_free_aux_typed));
   memset(ni->state->n_aux_bufs, 0, sizeof(ni->state->n_aux_bufs));
   ns->max_aux_bufs[CI_TCP_AUX_TYPE_SYNRECV] = ni->opts.tcp_synrecv_max;
   ns->max_aux_bufs[CI_TCP_AUX_TYPE_BUCKET] = ni->opts.max_ep_bufs;
@@ -2592,6 +2765,7 @@ allocate_netif_resources(ci_resource_onload_alloc_t* alloc,
  fail2:
   oo_shmbuf_free(&ni->shmbuf);
  fail1:
+  stack_mem_unaccount(trs);
   LOG_NC(ci_log("failed to allocate tcp_helper resources (%d)", rc));
   return rc;
 }
@@ -2997,6 +3171,9 @@ release_netif_resources(tcp_helper_resource_t* trs)
     ci_waitable_dtor(&trs->ready_list_waitqs[i]);
 
   oo_shmbuf_free(&ni->shmbuf);
+
+  /* Credit the stack's footprint back to the host-wide memory ledger. */
+  stack_mem_unaccount(trs);
 }
 static void
 release_netif_hw_resources(tcp_helper_resource_t* trs)
@@ -3291,6 +3468,7 @@ static void tcp_helper_do_non_atomic(struct work_struct *data)
   tcp_helper_resource_t* trs = container_of(data, tcp_helper_resource_t,
                                             non_atomic_work);
   const unsigned handled_aflags = (OO_THR_EP_AFLAG_CLEAR_FILTERS |
+                                   OO_THR_EP_AFLAG_SET_FILTERS |
                                    OO_THR_EP_AFLAG_NEED_FREE |
                                    OO_THR_EP_AFLAG_TCP_OFFLOAD_ISN);
   ci_irqlock_state_t lock_flags;
@@ -3319,6 +3497,28 @@ static void tcp_helper_do_non_atomic(struct work_struct *data)
                          OO_SP_FMT(ep->id), ep_aflags));
     if( ep_aflags & OO_THR_EP_AFLAG_CLEAR_FILTERS )
       tcp_helper_endpoint_clear_filters(ep, 0);
+    if( (ep_aflags & OO_THR_EP_AFLAG_SET_FILTERS) &&
+        ! (ep_aflags & (OO_THR_EP_AFLAG_CLEAR_FILTERS |
+                        OO_THR_EP_AFLAG_NEED_FREE)) &&
+        ci_netif_lock(&trs->netif) == 0 ) {
+      /* Deferred hardware filter install for an actively-opened connection
+       * (EF_ASYNC_FILTER_INSERT).  NON_ATOMIC is still set here, which stops
+       * tcp_helper_endpoint_set_filters() from deferring again.  Re-check
+       * the socket under the lock: it may have closed or been handed over
+       * since the operation was queued. */
+      ci_sock_cmn* s = SP_TO_SOCK(&trs->netif, ep->id);
+      if( (s->b.state & CI_TCP_STATE_TCP) && s->b.state != CI_TCP_LISTEN &&
+          s->b.state != CI_TCP_CLOSED &&
+          ! CI_IPX_ADDR_IS_ANY(sock_raddr(s)) ) {
+        int rc = tcp_helper_endpoint_set_filters(ep, ep->set_filters_ifindex,
+                                                 OO_SP_NULL);
+        if( rc != 0 && rc != -EFILTERSSOME )
+          OO_DEBUG_ERR(ci_log("%s: [%u:%d] deferred filter install failed "
+                              "(%d)", __FUNCTION__, trs->id,
+                              OO_SP_FMT(ep->id), rc));
+      }
+      ci_netif_unlock(&trs->netif);
+    }
     if( ep_aflags & OO_THR_EP_AFLAG_NEED_FREE ) {
       /* make sure that the filters are released: */
       tcp_helper_endpoint_clear_filters(ep, 0);
@@ -4073,6 +4273,43 @@ thr_uninstall_tproxy(tcp_helper_resource_t* thr)
 }
 
 
+/* Steer a raw L2 protocol (EF_RX_ETHERTYPE) to this stack's VIs.  Frames
+ * are consumed at user level via onload_rx_prefilter_set(); anything not
+ * consumed follows the usual pass-to-kernel path. */
+static int
+thr_install_ethertype(tcp_helper_resource_t* thr)
+{
+  const ci_netif_config_opts* ni_opts = &NI_OPTS(&thr->netif);
+  struct oof_manager* ofm = oo_filter_ns_to_manager(thr->filter_ns);
+  int rc;
+
+  ci_assert_equal(thr->ethertype_ifindex, 0);
+  if( ni_opts->rx_ethertype_ifindex == 0 ) {
+    ci_log("%s: EF_RX_ETHERTYPE is set but EF_RX_ETHERTYPE_IFINDEX is not",
+           __func__);
+    return -EINVAL;
+  }
+  rc = oof_ethertype_install(ofm, thr, ni_opts->rx_ethertype_ifindex,
+                             CI_BSWAP_BE16(ni_opts->rx_ethertype));
+  if( rc == 0 ) {
+    thr->ethertype_ifindex = ni_opts->rx_ethertype_ifindex;
+    thr->ethertype_be16 = CI_BSWAP_BE16(ni_opts->rx_ethertype);
+  }
+  return rc;
+}
+
+
+static void
+thr_uninstall_ethertype(tcp_helper_resource_t* thr)
+{
+  if( thr->ethertype_ifindex != 0 ) {
+    oof_ethertype_free(oo_filter_ns_to_manager(thr->filter_ns), thr,
+                       thr->ethertype_ifindex, thr->ethertype_be16);
+    thr->ethertype_ifindex = 0;
+  }
+}
+
+
 
 static inline void netns_get_identifiers(ci_netif_state* state,
                                          const struct net* ns)
@@ -4485,6 +4722,8 @@ int tcp_helper_rm_alloc(ci_resource_onload_alloc_t* alloc,
 #if CI_CFG_ENDPOINT_MOVE
   rs->thc = NULL;
 #endif
+  rs->thc_rss_instance = -1;
+  rs->thc_numa_node = NUMA_NO_NODE;
   strcpy(rs->name, alloc->in_name);
   generate_efct_filter_irqmask(&rs->filter_irqmask);
 
@@ -4562,6 +4801,14 @@ int tcp_helper_rm_alloc(ci_resource_onload_alloc_t* alloc,
     rc = -ENOMEM;
     goto fail5;
   }
+
+  /* Periodic maintenance work goes to the shared pool unless this stack's
+   * periodic work is pinned to a cpu. */
+  if( shared_periodic_poll && NI_OPTS(ni).periodic_timer_cpu < 0 &&
+      efab_tcp_driver.periodic_workqueue != NULL )
+    rs->periodic_wq = efab_tcp_driver.periodic_workqueue;
+  else
+    rs->periodic_wq = rs->wq;
 #endif
 
 #if CI_CFG_NIC_RESET_SUPPORT
@@ -4693,6 +4940,17 @@ int tcp_helper_rm_alloc(ci_resource_onload_alloc_t* alloc,
     }
   }
 
+  rs->ethertype_ifindex = 0;
+  if( NI_OPTS(ni).rx_ethertype != 0 && thc == NULL ) {
+    rc = thr_install_ethertype(rs);
+    if( rc != 0 ) {
+      OO_DEBUG_ERR(ci_log("%s: [%d] Failed to install EF_RX_ETHERTYPE "
+                          "filter rc=%d.", __func__, NI_ID(ni), rc));
+      thr_uninstall_tproxy(rs);
+      goto fail10;
+    }
+  }
+
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
   /* Create or get the table used to hold the ephemeral ports that are used for
    * active wilds.  If we are clustered then we get this from the cluster;
@@ -5001,7 +5259,7 @@ static inline int thr_queue_delayed_work(tcp_helper_resource_t* thr,
                                          struct delayed_work *dwork,
                                          unsigned long delay)
 {
-  return queue_delayed_work_on(thr->periodic_timer_cpu, thr->wq,
+  return queue_delayed_work_on(thr->periodic_timer_cpu, thr->periodic_wq,
                                dwork, delay);
 }
 #endif
@@ -5108,10 +5366,26 @@ static void tcp_helper_reset_stack_locked(tcp_helper_resource_t* thr)
 
 #if CI_CFG_ENDPOINT_MOVE
   if( thr->thc != NULL ) {
-    /* This warning can be removed once Bug43452 is properly addressed */
-    ci_log("Stack %s:%d in cluster %s can't restore filters post-NIC-reset.\n"
-           "This stack will no longer receive packets",
-           thr->name, thr->id, thr->thc->thc_name);
+    /* Clustered stacks receive via the cluster's RSS vi_set, and the
+     * hardware RSS context behind that vi_set did not survive the reset.
+     * Re-establish it from the efrm shadow state, then get oof to re-push
+     * filters on the affected hwports so they point at the new context
+     * (Bug43452).  Each stack in the cluster runs this, so the vi_set may
+     * be reset several times; that is harmless, as the filter re-push is
+     * deferred to a workitem that runs after the last re-allocation. */
+    for( intf_i = 0; intf_i < CI_CFG_MAX_INTERFACES; ++intf_i )
+      if( intfs_to_reset & (1 << intf_i) ) {
+        int hwport = ni->intf_i_to_hwport[intf_i];
+        if( hwport >= 0 && thr->thc->thc_vi_set[hwport] != NULL ) {
+          int rc1 = efrm_vi_set_reset(thr->thc->thc_vi_set[hwport]);
+          if( rc1 < 0 )
+            ci_log("Stack %s:%d in cluster %s failed to re-establish RSS "
+                   "state on hwport %d post-NIC-reset (rc %d); this stack "
+                   "may no longer receive packets",
+                   thr->name, thr->id, thr->thc->thc_name, hwport, rc1);
+          oof_onload_hwport_reset(&efab_tcp_driver, hwport);
+        }
+      }
   }
 #endif
 
@@ -5494,6 +5768,15 @@ tcp_helper_close_cleanup_ep(tcp_helper_resource_t* trs,
 }
 
 #if ! CI_CFG_UL_INTERRUPT_HELPER
+/* When at least this many endpoints are waiting to be closed, switch to
+ * bulk-close mode: per-socket hardware filter removal (a blocking MCDI
+ * round-trip each) is deferred to the non-atomic work queue instead of
+ * being done synchronously under the stack lock.  This bounds the time a
+ * mass disconnect can freeze the stack for surviving connections.
+ * Software filters are still removed immediately, so no packets are
+ * delivered to a closed endpoint meanwhile. */
+#define EP_TOBE_CLOSED_BULK_THRESH 8
+
 /*! Close sockets.  Called with netif lock held.  Kernel netif lock may or
  * may not be held.
  */
@@ -5503,6 +5786,8 @@ tcp_helper_close_pending_endpoints(tcp_helper_resource_t* trs)
   ci_irqlock_state_t lock_flags;
   tcp_helper_endpoint_t* ep;
   ci_sllink* link;
+  ci_sllist batch;
+  int n;
 
   OO_DEBUG_TCPH(ci_log("%s: [%d]", __FUNCTION__, trs->id));
 
@@ -5530,14 +5815,33 @@ tcp_helper_close_pending_endpoints(tcp_helper_resource_t* trs)
       ci_log("%s: [%d] ERROR: stack lock corrupted", __func__, trs->id);
       break;
     }
-    link = ci_sllist_pop(&trs->ep_tobe_closed);
+    /* Detach the whole list: one irqlock round-trip per batch rather than
+     * per endpoint, and a stable count to decide whether this is a mass
+     * teardown.  Endpoints queued while we process the batch are picked
+     * up by the outer loop. */
+    batch.head = trs->ep_tobe_closed.head;
+    ci_sllist_init(&trs->ep_tobe_closed);
     ci_irqlock_unlock(&trs->lock, &lock_flags);
 
-    ep = CI_CONTAINER(tcp_helper_endpoint_t, tobe_closed , link);
-    OO_DEBUG_TCPH(ci_log("%s: [%u:%d] closing",
-                         __FUNCTION__, trs->id, OO_SP_FMT(ep->id)));
-    tcp_helper_close_cleanup_ep(trs, ep);
-    citp_waitable_all_fds_gone(&trs->netif, ep->id);
+    n = 0;
+    for( link = batch.head; link != CI_SLLIST_TAIL; link = link->next )
+      if( ++n >= EP_TOBE_CLOSED_BULK_THRESH )
+        break;
+    if( n >= EP_TOBE_CLOSED_BULK_THRESH )
+      trs->netif.flags |= CI_NETIF_FLAG_BULK_CLOSE;
+
+    while( ci_sllist_not_empty(&batch) ) {
+      link = ci_sllist_pop(&batch);
+      ep = CI_CONTAINER(tcp_helper_endpoint_t, tobe_closed , link);
+      OO_DEBUG_TCPH(ci_log("%s: [%u:%d] closing",
+                           __FUNCTION__, trs->id, OO_SP_FMT(ep->id)));
+      tcp_helper_close_cleanup_ep(trs, ep);
+      citp_waitable_all_fds_gone(&trs->netif, ep->id);
+      if( trs->netif.flags & CI_NETIF_FLAG_BULK_CLOSE )
+        CITP_STATS_NETIF(++trs->netif.state->stats.bulk_close_eps);
+    }
+
+    trs->netif.flags &= ~CI_NETIF_FLAG_BULK_CLOSE;
   }
 }
 #else
@@ -5930,6 +6234,7 @@ void tcp_helper_dtor(tcp_helper_resource_t* trs)
   vfree(trs->trs_ephem_table_consumed);
 #endif
 
+  thr_uninstall_ethertype(trs);
   thr_uninstall_tproxy(trs);
 
   oo_filter_ns_put(&efab_tcp_driver, trs->filter_ns);
@@ -6029,7 +6334,20 @@ efab_tcp_driver_ctor()
     rc = -ENOMEM;
     goto fail_wq;
   }
-  
+
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  /* Shared worker pool for periodic stack polls: the concurrency-managed
+   * pool round-robins the per-stack delayed work items, so one pool
+   * serves all low-activity stacks. */
+  efab_tcp_driver.periodic_workqueue =
+      alloc_workqueue("onload-periodic",
+                      WQ_UNBOUND | WQ_CPU_INTENSIVE | WQ_SYSFS, 0);
+  if (efab_tcp_driver.periodic_workqueue == NULL) {
+    rc = -ENOMEM;
+    goto fail_periodic_wq;
+  }
+#endif
+
   /* Create TCP helpers table */
   if ((rc = thr_table_ctor(&efab_tcp_driver.thr_table)) < 0)
     goto fail_thr_table;
@@ -6086,6 +6404,10 @@ fail_dlf:
 fail_filter_ns_manager:
   thr_table_dtor(&efab_tcp_driver.thr_table);
 fail_thr_table:
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  destroy_workqueue(efab_tcp_driver.periodic_workqueue);
+fail_periodic_wq:
+#endif
   destroy_workqueue(CI_GLOBAL_WORKQUEUE);
 fail_wq:
   OO_DEBUG_ERR(ci_log("%s: failed rc=%d", __FUNCTION__, rc));
@@ -6125,6 +6447,9 @@ efab_tcp_driver_dtor(void)
   efab_tcp_driver.timesync = NULL;
   __free_page(efab_tcp_driver.timesync_page);
 
+#if ! CI_CFG_UL_INTERRUPT_HELPER
+  destroy_workqueue(efab_tcp_driver.periodic_workqueue);
+#endif
   destroy_workqueue(CI_GLOBAL_WORKQUEUE);
 #if CI_CFG_HANDLE_ICMP
   efx_dlfilter_dtor(efab_tcp_driver.dlfilter);
@@ -6377,7 +6702,8 @@ efab_tcp_helper_iobufset_alloc(tcp_helper_resource_t* trs,
   }
 #endif
   rc = oo_iobufset_pages_alloc(HW_PAGES_PER_SET_S, min_nics_order, &flags,
-                               &pages, trs->thc_pktbuf_alloc);
+                               &pages, NI_OPTS(ni).packet_buf_numa_node,
+                               trs->thc_pktbuf_alloc);
   if( rc != 0 )
     return rc;
 #if CI_CFG_PKTS_AS_HUGE_PAGES
@@ -6447,7 +6773,8 @@ static long efab_get_all_user_pages(unsigned long base, long max_pages,
  *     and aligned hugepages then no splitting happens and they never notice
  *     this fixup code. */
 static long efab_get_unstraddled_user_pages(unsigned long base, long max_pages,
-                                            struct page** pages)
+                                            struct page** pages,
+                                            unsigned gup_flags)
 {
   long rc;
 #ifdef FOLL_SPLIT
@@ -6455,7 +6782,7 @@ static long efab_get_unstraddled_user_pages(unsigned long base, long max_pages,
 #endif
   ci_assert_gt(max_pages, 0);
 
-  rc = efab_get_all_user_pages(base, max_pages, pages, FOLL_WRITE);
+  rc = efab_get_all_user_pages(base, max_pages, pages, gup_flags);
   if( rc < 0 )
     return rc;
 
@@ -6475,7 +6802,7 @@ static long efab_get_unstraddled_user_pages(unsigned long base, long max_pages,
       if( ! PageTail(pages[count]) )
         break;
     efab_put_pages(pages, count);
-    rc = efab_get_all_user_pages(base, count, pages, FOLL_WRITE | FOLL_SPLIT);
+    rc = efab_get_all_user_pages(base, count, pages, gup_flags | FOLL_SPLIT);
     if( rc < 0 ) {
       efab_put_pages(pages + count, max_pages - count);
       return rc;
@@ -6496,7 +6823,7 @@ static long efab_get_unstraddled_user_pages(unsigned long base, long max_pages,
   if( count + (1L << compound_order(pages[count])) != max_pages ) {
     efab_put_pages(pages + count, max_pages - count);
     rc = efab_get_all_user_pages(base + count * PAGE_SIZE, max_pages - count,
-                                 pages + count, FOLL_WRITE | FOLL_SPLIT);
+                                 pages + count, gup_flags | FOLL_SPLIT);
     if( rc < 0 ) {
       efab_put_pages(pages, count);
       return rc;
@@ -6516,7 +6843,7 @@ static long efab_get_unstraddled_user_pages(unsigned long base, long max_pages,
 int efab_tcp_helper_map_usermem(tcp_helper_resource_t* trs,
                                 struct oo_iobufs_usermem* ioum,
                                 unsigned long user_base, int n_pages,
-                                uint64_t** hw_addrs_out)
+                                int writable, uint64_t** hw_addrs_out)
 {
 #if PAGE_SIZE != EFHW_NIC_PAGE_SIZE
   /* Not implemented, solely for simplicity */
@@ -6539,8 +6866,13 @@ int efab_tcp_helper_map_usermem(tcp_helper_resource_t* trs,
   if( ! pages )
     return -ENOMEM;
 
+  /* A send-only registration pins without FOLL_WRITE so that read-only
+   * mappings (eg. mmap'd files) can be used as zero-copy transmit
+   * sources.  The NIC only ever DMA-reads from usermem regions, so not
+   * being able to write is fine. */
   mmap_read_lock(current->mm);
-  rc = efab_get_unstraddled_user_pages(user_base, n_pages, pages);
+  rc = efab_get_unstraddled_user_pages(user_base, n_pages, pages,
+                                       writable ? FOLL_WRITE : 0);
   mmap_read_unlock(current->mm);
   if( rc < 0 ) {
     NI_LOG(ni, RESOURCE_WARNINGS, "[%s]: pin_user_pages(%d) returned %ld",
@@ -6718,6 +7050,7 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
   ci_irqlock_state_t lock_flags;
   ci_netif* ni = &trs->netif;
   int i, rc, bufset_id, intf_i, page_order;
+  int budgeted = 0;
 
   ci_assert(ci_netif_is_locked(ni));
 
@@ -6733,10 +7066,29 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
     return -EBUSY;
   }
 
+  /* Packet sets beyond the stack's floor come out of the host-wide shared
+   * budget. */
+  if( (unsigned) ni->pkt_sets_n >=
+      ((unsigned) NI_OPTS(ni).min_free_packets + PKTS_PER_SET - 1)
+          >> CI_CFG_PKTS_PER_SET_S ) {
+    rc = shared_packet_set_get(trs);
+    if( rc < 0 ) {
+      ++ni->state->stats.bufset_shared_limited;
+      NI_LOG_ONCE(ni, RESOURCE_WARNINGS,
+                  FN_FMT "Shared packet buffer budget exhausted - see the "
+                  "shared_packets_max module option",
+                  FN_PRI_ARGS(&trs->netif));
+      return rc;
+    }
+    budgeted = 1;
+  }
+
   hw_addrs = ci_vmalloc(sizeof(uint64_t) * (1 << HW_PAGES_PER_SET_S) *
                         CI_CFG_MAX_INTERFACES);
   if( hw_addrs == NULL ) {
     ci_log("%s: [%d] out of memory", __func__, trs->id);
+    if( budgeted )
+      shared_packet_sets_put(trs, 1);
     return -ENOMEM;
   }
 
@@ -6759,6 +7111,8 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
              FN_PRI_ARGS(&trs->netif), rc);
     }
     ci_vfree(hw_addrs);
+    if( budgeted )
+      shared_packet_sets_put(trs, 1);
     return rc;
   }
   /* check we get the size we are expecting */
@@ -6776,6 +7130,8 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
       oo_iobufset_resource_release(iobrs[intf_i], 0);
     oo_iobufset_pages_release(pages);
     ci_vfree(hw_addrs);
+    if( budgeted )
+      shared_packet_sets_put(trs, 1);
     return -ENOSPC;
   }
   bufset_id = ni->pkt_sets_n;
@@ -6835,6 +7191,7 @@ efab_tcp_helper_more_bufs(tcp_helper_resource_t* trs)
     OO_PKT_PP_INIT(pkt, id);
 
     pkt->flags = 0;
+    pkt->iso_domain = 0;
     __ci_netif_pkt_clean(pkt);
     pkt->refcount = 0;
     pkt->stack_id = trs->id;
@@ -7427,6 +7784,8 @@ tcp_helper_stop_periodic_work(tcp_helper_resource_t* rs)
   cancel_delayed_work(&rs->purge_txq_work);
   /* wait for running timer workqitem */
   flush_workqueue(rs->wq);
+  if( rs->periodic_wq != rs->wq )
+    flush_workqueue(rs->periodic_wq);
   /* the running workitems might haved kicked off some more before the flags
    * were cleared earlier - let's cancel them. */
   if( timer_was_running )
@@ -7435,6 +7794,8 @@ tcp_helper_stop_periodic_work(tcp_helper_resource_t* rs)
   /* and flush, just in case the second workitem have started
    * before we cancelled it */
   flush_workqueue(rs->wq);
+  if( rs->periodic_wq != rs->wq )
+    flush_workqueue(rs->periodic_wq);
 }
 #endif
 
@@ -8320,7 +8681,11 @@ efab_tcp_helper_vi_stats_query(tcp_helper_resource_t* trs, unsigned int intf_i,
 
 
 #if CI_CFG_INJECT_PACKETS
-static int oo_inject_packet_kernel(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+/* Converts an Onload packet into an skb ready for handing to the kernel
+ * stack.  The skb is returned via [skb_out] rather than injected here so
+ * that the caller can submit a whole batch in one kernel entry. */
+static int oo_inject_packet_kernel(ci_netif* ni, ci_ip_pkt_fmt* pkt,
+                                   struct sk_buff** skb_out)
 {
   struct net_device* dev;
   struct sk_buff* skb;
@@ -8385,10 +8750,7 @@ static int oo_inject_packet_kernel(ci_netif* ni, ci_ip_pkt_fmt* pkt)
   /* Infer the protocol from the Ethernet payload. */
   skb->protocol = eth_type_trans(skb, dev);
 
-  /* Inject the skb into the kernel.  The return value indicates whether the
-   * kernel decided to drop the packet, but we don't need to check that. */
-  ci_netif_rx_non_irq(skb);
-
+  *skb_out = skb;
   dev_put(dev);
   return 0;
 
@@ -8406,23 +8768,37 @@ struct oo_inject_packets_work_data {
   oo_pkt_p pkt_head;
 };
 
+/* Number of skbs handed to the kernel stack per entry.  Sized like a NAPI
+ * poll budget: big enough to amortise the per-entry costs, small enough to
+ * bound the burst the kernel sees at once. */
+#define OO_INJECT_SKB_BATCH 32
+
 static void oo_inject_packets_work(struct work_struct* work)
 {
   struct oo_inject_packets_work_data* data =
             container_of(work, struct oo_inject_packets_work_data, work);
   ci_netif* ni = &data->trs->netif;
   ci_ip_pkt_fmt* pkt;
+  struct sk_buff* skbs[OO_INJECT_SKB_BATCH];
+  int n_skbs = 0;
   int netif_is_locked;
 
-  /* Part one: inject all packets to the kernel */
+  /* Part one: convert packets to skbs and inject them to the kernel in
+   * batches. */
   for( pkt = PKT_CHK(ni, data->pkt_head); ; pkt = PKT_CHK(ni, pkt->next) ) {
     /* No need to check the return value here.  If the function fails, the
      * packet is dropped, and a counter is incremented. */
-    oo_inject_packet_kernel(ni, pkt);
+    if( oo_inject_packet_kernel(ni, pkt, &skbs[n_skbs]) == 0 &&
+        ++n_skbs == OO_INJECT_SKB_BATCH ) {
+      ci_netif_receive_skb_batch(skbs, n_skbs);
+      n_skbs = 0;
+    }
 
     if( OO_PP_IS_NULL(pkt->next) )
       break;
   }
+  if( n_skbs > 0 )
+    ci_netif_receive_skb_batch(skbs, n_skbs);
 
   /* Part two: free Onload packets */
   netif_is_locked = 0;
@@ -8730,6 +9106,34 @@ int efab_tcp_helper_design_parameters(tcp_helper_resource_t* trs,
   return copy_to_user(user_data, &dp, dp.known_size) ? -EFAULT : 0;
 }
 
+/* Warm-restart support: hold or release a file-level reference on the
+ * stack so that its VIs, packet memory and MAC filters survive the last
+ * close.  Because the reference is at file level, the stack is not
+ * treated as an orphan and a restarted process can re-attach to it by
+ * name through the usual efab_thr_table_lookup() path.
+ *
+ * A persistent stack is released by a later call with enable=0, or by
+ * killing it with onload_stackdump.
+ */
+int efab_tcp_helper_set_persistent(tcp_helper_resource_t* trs, int enable)
+{
+  if( enable ) {
+    if( ci_cas32u_fail(&trs->is_persistent, 0, 1) )
+      return 0;
+    if( oo_thr_ref_get(trs->ref, OO_THR_REF_FILE) != 0 ) {
+      /* Racing with stack destruction; nothing to preserve. */
+      trs->is_persistent = 0;
+      return -EBUSY;
+    }
+  }
+  else {
+    if( ci_cas32u_fail(&trs->is_persistent, 1, 0) )
+      return 0;
+    oo_thr_ref_drop(trs->ref, OO_THR_REF_FILE);
+  }
+  return 0;
+}
+
 static tcp_helper_resource_t*
 thr_ref2thr(oo_thr_ref_t ref)
 {
@@ -238,6 +238,19 @@ void full_dump_vi_info_to_logger(void* netif, oo_dump_log_fn_t logger,
 }
 
 
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+static void full_dump_flight_recorder_to_logger(void* netif,
+                                                oo_dump_log_fn_t logger,
+                                                void* log_arg)
+{
+  ci_netif *ni = (ci_netif*) netif;
+  logger(log_arg,
+         "--------------------- flight recorder ----------------------");
+  ci_netif_dump_flight_recorder_to_logger(ni, logger, log_arg);
+}
+#endif
+
+
 /*! Function to dump specific part of the stack[id] defined in fn function
  * into user buffer. Basic use is to stackdump lots data from  orphaned stack.
   */
@@ -314,6 +327,11 @@ int tcp_helper_dump_stack(unsigned id, unsigned orphan_only, void* user_buf,
     case __CI_DEBUG_OP_VI_INFO__:
       fn = full_dump_vi_info_to_logger;
       break;
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+    case __CI_DEBUG_OP_FLIGHT_RECORDER__:
+      fn = full_dump_flight_recorder_to_logger;
+      break;
+#endif
     default:
       return -ENOPROTOOPT;
   }
@@ -147,6 +147,14 @@ int onload_zc_recv(int fd, struct onload_zc_recv_args* args)
   return -ENOSYS;
 }
 
+__attribute__((weak))
+int onload_zc_recv_many(struct onload_zc_recv_many_sock* socks, int n_socks,
+                        struct onload_zc_recv_args* args,
+                        onload_zc_recv_many_callback cb)
+{
+  return -ENOSYS;
+}
+
 __attribute__((weak))
 int onload_zc_send(struct onload_zc_mmsg* msgs, int mlen, int flags)
 {
@@ -162,6 +170,20 @@ int onload_set_recv_filter(int fd, onload_zc_recv_filter_callback filter,
   return -ENOSYS;
 }
 
+__attribute__((weak))
+int onload_set_recv_filter_chain(int fd,
+                                 const struct onload_zc_recv_filter_rule*
+                                 rules, int rules_len, int flags)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_zc_splice(int fd_in, int fd_out, size_t len, int flags)
+{
+  return -ENOSYS;
+}
+
 /**************************************************************************/
 
 __attribute__((weak))
@@ -206,6 +228,32 @@ onload_zc_hlrx_recv_oob(struct onload_zc_hlrx* hlrx,
   return -ENOSYS;
 }
 
+__attribute__((weak))
+int onload_zc_hlrx_pool_alloc(int flags,
+                              struct onload_zc_hlrx_pool** pool_out)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_zc_hlrx_pool_free(struct onload_zc_hlrx_pool* pool)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_zc_hlrx_pool_get(struct onload_zc_hlrx_pool* pool, int fd,
+                            struct onload_zc_hlrx** hlrx_out)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_zc_hlrx_pool_put(struct onload_zc_hlrx_pool* pool, int fd)
+{
+  return -ENOSYS;
+}
+
 /**************************************************************************/
 
 __attribute__((weak))
@@ -216,6 +264,16 @@ int onload_msg_template_alloc(int fd, const struct iovec* initial_msg,
   return -ENOSYS;
 }
 
+__attribute__((weak))
+int onload_msg_template_alloc_array(int fd,
+                                    const struct onload_template_msg* msgs,
+                                    int ntemplates,
+                                    onload_template_handle* handles,
+                                    unsigned flags)
+{
+  return -ENOSYS;
+}
+
 __attribute__((weak))
 int
 onload_msg_template_update(int fd, onload_template_handle handle,
@@ -262,6 +320,13 @@ int onload_thread_get_spin(unsigned* state)
 }
 /**************************************************************************/
 
+__attribute__((weak))
+int onload_thread_set_poll_priority(int enable)
+{
+  return 0;
+}
+/**************************************************************************/
+
 __attribute__((weak))
 int onload_ordered_epoll_wait(int epfd, struct epoll_event *events,
                               struct onload_ordered_epoll_event *oo_events,
@@ -270,6 +335,32 @@ int onload_ordered_epoll_wait(int epfd, struct epoll_event *events,
   return -ENOSYS;
 }
 
+__attribute__((weak))
+int onload_epoll_set_priority(int epfd, int fd, int priority)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_epoll_ctl_batch(int epfd, struct onload_epoll_ctl_op* ops,
+                           int n_ops)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_rx_order_read(int fd, struct onload_rx_order_event* events,
+                         int n, uint32_t* dropped)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int onload_stack_eventfd(int fd, int evfd)
+{
+  return -ENOSYS;
+}
+
 
 
 /**************************************************************************/
@@ -317,6 +408,68 @@ onload_delegated_send_cancel(int fd)
   return -1;
 }
 
+__attribute__((weak))
+int
+onload_delegated_send_complete_zc(int fd, const struct onload_zc_iovec* iov,
+                                  int iovlen, int flags)
+{
+  errno = ENOSYS;
+  return -1;
+}
+
+__attribute__((weak))
+int
+onload_udp_dest_register(int fd, const struct sockaddr* addr,
+                         socklen_t addrlen)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_udp_send_batch(int fd, struct onload_udp_send_batch_entry* entries,
+                      int n, int flags)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_udp_fanout_send(int fd, const struct iovec* iov, int iovlen,
+                       const int* dests, int n_dests, int flags)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_cq_create(unsigned sq_entries, struct onload_cq** cq_out)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_cq_destroy(struct onload_cq* cq)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_cq_submit(struct onload_cq* cq, const struct onload_cq_sqe* sqes,
+                 int n)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_cq_harvest(struct onload_cq* cq, struct onload_cq_cqe* cqes, int max)
+{
+  return -ENOSYS;
+}
+
 __attribute__((weak))
 int
 oo_raw_send(int fd, int hwport, const struct iovec *iov, int iovcnt)
@@ -347,3 +500,60 @@ onload_socket_unicast_nonaccel(int domain, int type, int protocol)
   return socket(domain, type, protocol);
 }
 
+__attribute__((weak))
+int
+onload_rx_prefilter_set(onload_rx_prefilter_callback filter, void* cb_arg)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_feed_arbiter_set(onload_feed_seq_extractor extract, void* cb_arg)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_feed_arbiter_get_stats(struct onload_feed_arbiter_stats* stats)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_socket_watermarks_set(int fd, const struct onload_socket_watermarks* wm)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_socket_watermarks_query(int fd, unsigned* fired_out)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_stack_clock_get(int fd, struct onload_stack_clock* clock_out)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_udp_mcast_join_batch(int fd, int ifindex, int count,
+                            const uint32_t* groups)
+{
+  return -ENOSYS;
+}
+
+__attribute__((weak))
+int
+onload_socket_recv_framing(int fd, const struct onload_recv_framing* framing)
+{
+  return -ENOSYS;
+}
+
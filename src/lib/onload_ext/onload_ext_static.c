@@ -173,6 +173,11 @@ wrap(int, onload_zc_buffer_decref, (int fd, onload_zc_handle buf),
 wrap(int, onload_zc_recv, (int fd, struct onload_zc_recv_args* args),
      (fd, args), -ENOSYS)
 
+wrap(int, onload_zc_recv_many, (struct onload_zc_recv_many_sock* socks,
+                                int n_socks, struct onload_zc_recv_args* args,
+                                onload_zc_recv_many_callback cb),
+     (socks, n_socks, args, cb), -ENOSYS)
+
 wrap(int, onload_zc_send, (struct onload_zc_mmsg* msgs, int mlen, int flags),
      (msgs, mlen, flags), -ENOSYS)
 
@@ -180,6 +185,14 @@ wrap(int, onload_set_recv_filter, (int fd, onload_zc_recv_filter_callback filter
                                    void* cb_arg, int flags),
      (fd, filter, cb_arg, flags), -ENOSYS)
 
+wrap(int, onload_set_recv_filter_chain,
+     (int fd, const struct onload_zc_recv_filter_rule* rules, int rules_len,
+      int flags),
+     (fd, rules, rules_len, flags), -ENOSYS)
+
+wrap(int, onload_zc_splice, (int fd_in, int fd_out, size_t len, int flags),
+     (fd_in, fd_out, len, flags), -ENOSYS)
+
 wrap(int, onload_zc_hlrx_alloc, (int fd, int flags,
                                  struct onload_zc_hlrx** hlrx_out),
      (fd, flags, hlrx_out), -ENOSYS)
@@ -204,6 +217,21 @@ wrap(ssize_t, onload_zc_hlrx_recv_oob,
       void* buf, size_t len, int* flags),
      (hlrx, inband, buf, len, flags), -ENOSYS)
 
+wrap(int, onload_zc_hlrx_pool_alloc,
+     (int flags, struct onload_zc_hlrx_pool** pool_out),
+     (flags, pool_out), -ENOSYS)
+
+wrap(int, onload_zc_hlrx_pool_free, (struct onload_zc_hlrx_pool* pool),
+     (pool), -ENOSYS)
+
+wrap(int, onload_zc_hlrx_pool_get,
+     (struct onload_zc_hlrx_pool* pool, int fd,
+      struct onload_zc_hlrx** hlrx_out),
+     (pool, fd, hlrx_out), -ENOSYS)
+
+wrap(int, onload_zc_hlrx_pool_put, (struct onload_zc_hlrx_pool* pool, int fd),
+     (pool, fd), -ENOSYS)
+
 
 wrap(int, onload_msg_template_alloc, (int fd, const struct iovec* initial_msg,
                                       int mlen, onload_template_handle* handle,
@@ -211,6 +239,12 @@ wrap(int, onload_msg_template_alloc, (int fd, const struct iovec* initial_msg,
      (fd, initial_msg, mlen, handle, flags), -ENOSYS)
 
 
+wrap(int, onload_msg_template_alloc_array,
+     (int fd, const struct onload_template_msg* msgs, int ntemplates,
+      onload_template_handle* handles, unsigned flags),
+     (fd, msgs, ntemplates, handles, flags), -ENOSYS)
+
+
 wrap(int, onload_msg_template_update,
      (int fd, onload_template_handle handle,
       const struct onload_template_msg_update_iovec* updates, int ulen,
@@ -228,6 +262,8 @@ wrap(int, onload_thread_set_spin, (enum onload_spin_type type, int spin),
 
 wrap(int, onload_thread_get_spin, (unsigned* state), (state), -ENOSYS)
 
+wrap(int, onload_thread_set_poll_priority, (int enable), (enable), 0)
+
 wrap(int, onload_move_fd, (int fd), (fd), 0)
 
 wrap( int, onload_fd_check_feature, (int fd, enum onload_fd_feature feature),
@@ -238,6 +274,21 @@ wrap( int, onload_ordered_epoll_wait, (int epfd, struct epoll_event *events,
                                   int maxevents, int timeout),
     (epfd, events, oo_events, maxevents, timeout), -ENOSYS)
 
+wrap( int, onload_epoll_set_priority, (int epfd, int fd, int priority),
+     (epfd, fd, priority), -ENOSYS)
+
+wrap( int, onload_epoll_ctl_batch,
+     (int epfd, struct onload_epoll_ctl_op* ops, int n_ops),
+     (epfd, ops, n_ops), -ENOSYS)
+
+wrap( int, onload_rx_order_read,
+     (int fd, struct onload_rx_order_event* events, int n,
+      uint32_t* dropped),
+     (fd, events, n, dropped), -ENOSYS)
+
+wrap( int, onload_stack_eventfd, (int fd, int evfd),
+     (fd, evfd), -ENOSYS)
+
 wrap(int, onload_timestamping_request, (int fd, unsigned flags),
      (fd, flags), -ENOSYS)
 
@@ -251,6 +302,24 @@ wrap_with_errno(int,  onload_delegated_send_complete,
 
 wrap_with_errno(int, onload_delegated_send_cancel, (int fd), (fd), -1, ENOSYS)
 
+wrap_with_errno(int, onload_delegated_send_complete_zc,
+                (int fd, const struct onload_zc_iovec* iov, int iovlen,
+                 int flags),
+                (fd, iov, iovlen, flags), -1, ENOSYS)
+
+wrap(int, onload_udp_dest_register,
+     (int fd, const struct sockaddr* addr, socklen_t addrlen),
+     (fd, addr, addrlen), -ENOSYS)
+
+wrap(int, onload_udp_send_batch,
+     (int fd, struct onload_udp_send_batch_entry* entries, int n, int flags),
+     (fd, entries, n, flags), -ENOSYS)
+
+wrap(int, onload_udp_fanout_send,
+     (int fd, const struct iovec* iov, int iovlen, const int* dests,
+      int n_dests, int flags),
+     (fd, iov, iovlen, dests, n_dests, flags), -ENOSYS)
+
 wrap_with_errno(int, oo_raw_send,
                 (int fd, int hwport, const struct iovec* iov, int iovlen),
                 (fd, hwport, iov, iovlen), -1, ENOSYS)
@@ -267,3 +336,7 @@ wrap_with_fn(int, onload_socket_unicast_nonaccel,
              (int domain, int type, int protocol),
              (domain, type, protocol), socket)
 
+wrap(int, onload_rx_prefilter_set,
+     (onload_rx_prefilter_callback filter, void* cb_arg),
+     (filter, cb_arg), -ENOSYS)
+
@@ -0,0 +1,286 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+
+/* Sockets-free library API over the Onload TCP engine.
+ *
+ * This links directly against the transport/ip engine and the kernel
+ * driver, bypassing the intercept, fdtable and syscall-compat layers in
+ * transport/unix.  Each connection still holds an onload driver fd
+ * internally -- the kernel attaches endpoint state to fds and the engine
+ * blocks through them -- but the fd is never exposed, never enters an
+ * fdtable, and no per-call fd translation happens on the fast path.
+ *
+ * See include/onload/direct.h for the API contract.
+ */
+
+#define _GNU_SOURCE  /* for POLLRDHUP via <onload/tcp_poll.h> */
+
+#include <ci/internal/ip.h>
+#include <ci/internal/efabcfg.h>
+#include <onload/ul.h>
+#include <onload/ul/tcp_helper.h>
+#include <onload/ul/rwlock.h>
+#include <onload/dup2_lock.h>
+#include <onload/tcp_poll.h>
+#include <onload/direct.h>
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#define LPF "od_"
+
+
+struct od_conn {
+  struct od_stack*   stack;
+  citp_socket        ep;
+  ci_fd_t            fd;
+  od_conn_handler_fn handler;
+  void*              handler_arg;
+  struct od_conn*    next;
+};
+
+struct od_stack {
+  ci_netif        ni;
+  struct od_conn* conns;
+};
+
+
+static int od_inited;
+
+
+int od_init(void)
+{
+  int rc;
+
+  if( od_inited )
+    return 0;
+
+  if( (rc = oo_rwlock_ctor(&citp_dup2_lock)) != 0 )
+    return -rc;
+
+  /* Load EF_* netif options from the environment, as the intercept
+   * library's startup sequence would. */
+  ci_cfg_query();
+  ci_tp_init(NULL, NULL);
+
+  od_inited = 1;
+  return 0;
+}
+
+
+int od_stack_alloc(const char* name, struct od_stack** stack_out)
+{
+  struct od_stack* stack;
+  ef_driver_handle fd;
+  int rc;
+
+  if( ! od_inited )
+    return -EINVAL;
+
+  stack = calloc(1, sizeof(*stack));
+  if( stack == NULL )
+    return -ENOMEM;
+
+  rc = ef_onload_driver_open(&fd, OO_STACK_DEV, 1);
+  if( rc < 0 ) {
+    LOG_E(ci_log(LPF "stack_alloc: failed to open driver (%d)", rc));
+    free(stack);
+    return rc;
+  }
+
+  rc = ci_netif_ctor(&stack->ni, fd, name == NULL ? "" : name, 0);
+  if( rc < 0 ) {
+    LOG_E(ci_log(LPF "stack_alloc: failed to construct netif (%d)", rc));
+    ef_onload_driver_close(fd);
+    free(stack);
+    return rc;
+  }
+
+  *stack_out = stack;
+  return 0;
+}
+
+
+void od_stack_free(struct od_stack* stack)
+{
+  ci_assert_equal(stack->conns, NULL);
+  ci_netif_dtor(&stack->ni);
+  free(stack);
+}
+
+
+static int od_conn_events_locked_ok(struct od_conn* conn)
+{
+  /* ci_tcp_poll_events() reads shared state that may change underfoot;
+   * it is written to tolerate that, exactly as the select/poll
+   * intercepts use it. */
+  return ci_tcp_poll_events(&conn->stack->ni, conn->ep.s);
+}
+
+
+int od_conn_events(struct od_conn* conn)
+{
+  return od_conn_events_locked_ok(conn);
+}
+
+
+int od_stack_poll(struct od_stack* stack)
+{
+  ci_netif* ni = &stack->ni;
+  struct od_conn* conn;
+  int n_handled = 0;
+
+  if( ci_netif_trylock(ni) ) {
+    if( ci_netif_may_poll(ni) && ci_netif_has_event(ni) )
+      ci_netif_poll(ni);
+    ci_netif_unlock(ni);
+  }
+
+  for( conn = stack->conns; conn != NULL; conn = conn->next ) {
+    int events = od_conn_events_locked_ok(conn);
+    if( events != 0 && conn->handler != NULL ) {
+      conn->handler(conn, conn->handler_arg, events);
+      ++n_handled;
+    }
+  }
+
+  return n_handled;
+}
+
+
+int od_conn_connect(struct od_stack* stack,
+                    const struct sockaddr* sa, socklen_t sa_len,
+                    unsigned conn_flags,
+                    od_conn_handler_fn handler, void* handler_arg,
+                    struct od_conn** conn_out)
+{
+  ci_netif* ni = &stack->ni;
+  struct od_conn* conn;
+  ci_tcp_state* ts;
+  ci_fd_t fd;
+  int rc, moved = 0;
+
+  conn = calloc(1, sizeof(*conn));
+  if( conn == NULL )
+    return -ENOMEM;
+
+  ci_netif_lock(ni);
+  ts = ci_tcp_get_state_buf(ni);
+  ci_netif_unlock(ni);
+  if( ts == NULL ) {
+    LOG_E(ci_log(LPF "conn_connect: [%d] out of socket buffers", NI_ID(ni)));
+    free(conn);
+    return -EMFILE;
+  }
+
+  /* Attach kernel endpoint state.  The resulting fd is internal to the
+   * connection handle: the kernel needs it to keep the endpoint alive and
+   * the engine blocks through it. */
+  fd = ci_tcp_helper_sock_attach(ci_netif_get_driver_handle(ni),
+                                 S_SP(ts), AF_INET, SOCK_STREAM);
+  if( fd < 0 ) {
+    LOG_E(ci_log(LPF "conn_connect: sock_attach failed (%d)", fd));
+    free(conn);
+    return fd;
+  }
+
+  ts->s.so.sndbuf = NI_OPTS(ni).tcp_sndbuf_def;
+  ts->s.so.rcvbuf = NI_OPTS(ni).tcp_rcvbuf_def;
+
+  conn->stack = stack;
+  conn->ep.netif = ni;
+  conn->ep.s = &ts->s;
+  conn->fd = fd;
+  conn->handler = handler;
+  conn->handler_arg = handler_arg;
+
+  if( conn_flags & OD_CONN_F_NONBLOCK )
+    ci_atomic32_or(&ts->s.b.sb_aflags, CI_SB_AFLAG_O_NONBLOCK);
+
+  rc = ci_tcp_connect(&conn->ep, sa, sa_len, fd, &moved);
+
+  if( rc == CI_SOCKET_HANDOVER || moved ) {
+    /* Handover to the kernel stack, or a loopback connection moved to the
+     * listener's stack: both need the fdtable machinery we bypass. */
+    ci_sys_close(fd);
+    free(conn);
+    return -EOPNOTSUPP;
+  }
+  if( rc < 0 ) {
+    rc = -errno;
+    if( rc != -EINPROGRESS || ! (conn_flags & OD_CONN_F_NONBLOCK) ) {
+      ci_sys_close(fd);
+      free(conn);
+      return rc;
+    }
+    /* Non-blocking connect in progress: completion is reported as
+     * POLLOUT by od_stack_poll(). */
+  }
+
+  conn->next = stack->conns;
+  stack->conns = conn;
+  *conn_out = conn;
+  return 0;
+}
+
+
+ssize_t od_conn_send(struct od_conn* conn, const void* buf, size_t len,
+                     int flags)
+{
+  ci_sock_cmn* s = conn->ep.s;
+  ci_uint32 state = OO_ACCESS_ONCE(s->b.state);
+  ci_iovec iov;
+  int rc;
+
+  /* Handle CI_TCP_CLOSED without entering ci_tcp_sendmsg(), as the
+   * socket-call path does: the TCP state can change under our feet. */
+  if(CI_UNLIKELY( state == CI_TCP_CLOSED || state == CI_TCP_LISTEN ||
+                  state == CI_TCP_INVALID )) {
+    if( (rc = ci_get_so_error(s)) != 0 )
+      CI_SET_ERROR(rc, rc);
+    else
+      CI_SET_ERROR(rc, EPIPE);
+    return rc;
+  }
+
+  CI_IOVEC_BASE(&iov) = (void*) buf;
+  CI_IOVEC_LEN(&iov) = len;
+  return ci_tcp_sendmsg(conn->ep.netif, SOCK_TO_TCP(s), &iov, 1, flags);
+}
+
+
+ssize_t od_conn_recv(struct od_conn* conn, void* buf, size_t len)
+{
+  ci_tcp_recvmsg_args a;
+  ci_msghdr m;
+  ci_iovec iov;
+
+  CI_IOVEC_BASE(&iov) = buf;
+  CI_IOVEC_LEN(&iov) = len;
+  memset(&m, 0, sizeof(m));
+  m.msg_iov = &iov;
+  m.msg_iovlen = 1;
+  ci_tcp_recvmsg_args_init(&a, conn->ep.netif, SOCK_TO_TCP(conn->ep.s),
+                           &m, MSG_DONTWAIT);
+  return ci_tcp_recvmsg(&a);
+}
+
+
+void od_conn_close(struct od_conn* conn)
+{
+  struct od_conn** pconn;
+
+  for( pconn = &conn->stack->conns; *pconn != NULL;
+       pconn = &(*pconn)->next )
+    if( *pconn == conn ) {
+      *pconn = conn->next;
+      break;
+    }
+
+  /* Closing the attached fd drops the kernel's endpoint reference and
+   * runs the normal TCP close path (graceful shutdown, linger options,
+   * etc.), exactly as when an application's last socket fd closes. */
+  ci_sys_close(conn->fd);
+  free(conn);
+}
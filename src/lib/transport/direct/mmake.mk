@@ -0,0 +1,20 @@
+# SPDX-License-Identifier: GPL-2.0
+# X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc.
+TARGET		:= $(CIDIRECT_LIB)
+MMAKE_TYPE	:= LIB
+
+LIB_SRCS	:=		\
+		direct.c
+
+MMAKE_OBJ_PREFIX := ci_tp_direct_
+LIB_OBJS	:= $(LIB_SRCS:%.c=$(MMAKE_OBJ_PREFIX)%.o)
+
+all: $(TARGET)
+
+lib: $(TARGET)
+
+clean:
+	@$(MakeClean)
+
+$(TARGET): $(LIB_OBJS)
+	$(MMakeLinkStaticLib)
@@ -25,6 +25,7 @@ static void ci_active_wild_state_init(ci_netif* netif, ci_active_wild* aw)
   aw->last_laddr = addr_any;
   aw->last_raddr = addr_any;
   aw->last_rport = 0u;
+  aw->last_seq = 0u;
 }
 
 
@@ -670,6 +670,10 @@ int ci_get_sol_socket( ci_netif* netif, ci_sock_cmn* s,
     u = !!(s->so.so_debug & CI_SOCKOPT_FLAG_SO_DEBUG);
     goto u_out;
 
+  case SO_ZEROCOPY:
+    u = !!(s->so.so_debug & CI_SOCKOPT_FLAG_SO_ZEROCOPY);
+    goto u_out;
+
   case SO_TIMESTAMP:
     u = !!(s->cmsg_flags & CI_IP_CMSG_TIMESTAMP);
     goto u_out;
@@ -1678,6 +1682,24 @@ int ci_set_sol_socket(ci_netif* netif, ci_sock_cmn* s,
       s->so.so_debug &= ~CI_SOCKOPT_FLAG_SO_DEBUG;
     break;
 
+  case SO_ZEROCOPY:
+    if( (rc = opt_not_ok(optval, optlen, unsigned)) )
+      goto fail_inval;
+
+    /* MSG_ZEROCOPY completion notifications are only implemented for UDP.
+     * Refuse elsewhere so that applications fall back to plain sends
+     * rather than wait for notifications that would never arrive. */
+    if( s->b.state != CI_TCP_STATE_UDP ) {
+      rc = -EOPNOTSUPP;
+      goto fail_other;
+    }
+
+    if (*(unsigned*)optval)
+      s->so.so_debug |= CI_SOCKOPT_FLAG_SO_ZEROCOPY;
+    else
+      s->so.so_debug &= ~CI_SOCKOPT_FLAG_SO_ZEROCOPY;
+    break;
+
   case SO_TIMESTAMP:
     if( (rc = opt_not_ok(optval, optlen, char)) )
       goto fail_inval;
@@ -1880,6 +1902,12 @@ int ci_setsockopt_os_fail_ignore(ci_netif* ni, ci_sock_cmn* s, int err,
            optname == ONLOAD_TCP_OFFLOAD && optlen >= sizeof(int) )
     return 1;
 #endif
+  else if( s->b.state & CI_TCP_STATE_TCP && level == IPPROTO_TCP &&
+           optname == ONLOAD_TCP_RX_STEER && optlen >= sizeof(int) )
+    return 1;
+  else if( s->b.state == CI_TCP_STATE_UDP && level == IPPROTO_UDP &&
+           optname == ONLOAD_UDP_RX_MAILBOXES && optlen >= sizeof(int) )
+    return 1;
   return 0;
 }
 
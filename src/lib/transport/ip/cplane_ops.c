@@ -65,6 +65,10 @@
 
 
 #include <onload/cplane_ops.h>
+#if OO_DO_STACK_POLL
+#include "ip_internal.h"
+#include "ip_tx.h"
+#endif
 
 
 
@@ -169,8 +173,11 @@ __cicp_user_resolve(ci_netif* ni, struct oo_cplane_handle* cp,
     return 0;
   }
 #else
-  /* There is no reason to call this in UL without WAIT; so we don't. */
-  ci_assert(key->flag & CP_FWD_KEY_REQ_WAIT);
+  /* UL only omits WAIT with EF_CPLANE_NONBLOCK_RESOLVE: the request has
+   * still been queued with the server, so a failure here means "not yet"
+   * rather than "never". */
+  ci_assert_impl(! (key->flag & CP_FWD_KEY_REQ_WAIT),
+                 NI_OPTS(ni).cplane_nonblock_resolve);
 #endif
   if( rc < 0 )
     data->base.ifindex = CI_IFID_BAD;
@@ -254,13 +261,103 @@ cicp_user_build_fwd_key(ci_netif* ni, const ci_ip_cached_hdrs* ipcache,
 
 #ifdef __KERNEL__
   if( ! (ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT) )
-#endif
     key->flag |= CP_FWD_KEY_REQ_WAIT;
+#else
+  /* Non-blocking resolution is only usable when the source address is
+   * already known: without a fwd row we cannot select one. */
+  if( ! NI_OPTS(ni).cplane_nonblock_resolve ||
+      (key->flag & CP_FWD_KEY_SOURCELESS) ||
+      CI_IPX_ADDR_IS_ANY(key->src) )
+    key->flag |= CP_FWD_KEY_REQ_WAIT;
+#endif
 
   return 0;
 }
 
 
+#ifndef __KERNEL__
+/* Per-stack L1 route cache.  cicp_user_retrieve() is only called when the
+ * socket's own ipcache is unusable, which for an unconnected UDP socket is
+ * every send to a destination other than the previous one.  The cache
+ * remembers the fwd rows which answered recent requests, so that
+ * alternating between a handful of destinations does not pay for a full
+ * fwd-table walk each time.  Hits are validated against the row version in
+ * the same way as oo_cp_route_resolve()'s fast path, so a stale entry
+ * simply misses.  Entries are never stored for routes across namespaces or
+ * multipath routes.  The table size comes from EF_FWD_CACHE_SIZE; with the
+ * default of a few thousand entries the whole working set of a telemetry
+ * fan-out stays resident, so per-send source selection on multi-homed
+ * hosts costs one probe rather than a table walk. */
+
+ci_inline struct ci_ni_fwd_cache_entry*
+cicp_fwd_cache_entry(ci_netif* ni, ci_addr_t daddr)
+{
+  return &ni->fwd_cache[onload_addr_xor(daddr) & ni->fwd_cache_mask];
+}
+
+static int/*bool*/
+cicp_fwd_cache_lookup(ci_netif* ni, ci_addr_t daddr,
+                      const struct cp_fwd_key* key,
+                      cicp_verinfo_t* verinfo, struct cp_fwd_data* data)
+{
+  struct ci_ni_fwd_cache_entry* entry;
+  struct cp_fwd_table* fwd_table = &ni->cplane->mib[0].fwd_table;
+
+  if( ni->fwd_cache == NULL )
+    return 0;
+  entry = cicp_fwd_cache_entry(ni, daddr);
+
+  /* Compare field-by-field: the key structure has padding. */
+  if( ! CI_IPX_ADDR_EQ(entry->key.dst, key->dst) ||
+      ! CI_IPX_ADDR_EQ(entry->key.src, key->src) ||
+      entry->key.ifindex != key->ifindex ||
+      entry->key.tos != key->tos ||
+      entry->key.iif_ifindex != key->iif_ifindex ||
+      entry->key.flag != key->flag ||
+      ! oo_cp_verinfo_is_valid(ni->cplane, &entry->verinfo,
+                               CP_FWD_TABLE_ID_INVALID) )
+    return 0;
+
+  cp_get_fwd_rw(fwd_table, &entry->verinfo)->frc_used = ci_frc64_get();
+  memcpy(data, cp_get_fwd_data(fwd_table, &entry->verinfo), sizeof(*data));
+  ci_rmb();
+  if( ! cp_fwd_version_matches(fwd_table, &entry->verinfo) )
+    return 0;
+
+  /* Reproduce the source-address fixup which cicp_user_resolve() applied
+   * when this entry was stored. */
+  data->base.src = entry->src;
+  *verinfo = entry->verinfo;
+  return 1;
+}
+
+static void
+cicp_fwd_cache_update(ci_netif* ni, ci_addr_t daddr,
+                      const struct cp_fwd_key* key, ci_addr_sh_t key_src,
+                      const cicp_verinfo_t* verinfo,
+                      const struct cp_fwd_data* data)
+{
+  struct ci_ni_fwd_cache_entry* entry;
+
+  if( ni->fwd_cache == NULL )
+    return;
+  entry = cicp_fwd_cache_entry(ni, daddr);
+
+  /* Multipath routes must take the per-lookup hash each time; pinning one
+   * of the paths here would defeat the balancing. */
+  if( data->weight.end > 1 )
+    return;
+
+  entry->key = *key;
+  /* cicp_user_resolve() may have overwritten the key source with the
+   * address it selected; the cache must be keyed by the original. */
+  entry->key.src = key_src;
+  entry->src = data->base.src;
+  entry->verinfo = *verinfo;
+}
+#endif
+
+
 void
 cicp_user_retrieve(ci_netif*                    ni,
                    ci_ip_cached_hdrs*           ipcache,
@@ -273,6 +370,10 @@ cicp_user_retrieve(ci_netif*                    ni,
   /* Initialise to placate compiler. */
   ci_addr_sh_t pre_nat_laddr = addr_sh_any;
   int /*bool*/ nat_applied = 0;
+  int /*bool*/ from_cache = 0;
+#ifndef __KERNEL__
+  ci_addr_sh_t key_src;
+#endif
 
   /* This function must be called when "the route is unusable".  I.e. when
    * the route is invalid or if there is no ARP.  In the second case, we
@@ -302,9 +403,18 @@ cicp_user_retrieve(ci_netif*                    ni,
      * we can do. */
     nat_applied = cp_svc_check_dnat(ni->cplane_init_net, &key.src, &lport) > 0;
   }
-  if( cicp_user_resolve(ni, ni->cplane, &ipcache->fwd_ver,
-                        sock_cp->sock_cp_flags, &key, &data) != 0 )
+#ifndef __KERNEL__
+  key_src = key.src;
+  from_cache = cicp_fwd_cache_lookup(ni, daddr, &key, &ipcache->fwd_ver,
+                                     &data);
+#endif
+  if( ! from_cache &&
+      cicp_user_resolve(ni, ni->cplane, &ipcache->fwd_ver,
+                        sock_cp->sock_cp_flags, &key, &data) != 0 ) {
+    if( ! (key.flag & CP_FWD_KEY_REQ_WAIT) )
+      goto pending_route;
     goto alien_route;
+  }
 
   /* Look at main namespace if this route is across veth. */
   if( data.encap.type & CICP_LLAP_TYPE_ROUTE_ACROSS_NS ) {
@@ -322,12 +432,20 @@ cicp_user_retrieve(ci_netif*                    ni,
      * the cplane server, then the field will not be touched. */
     ipcache->fwd_ver_init_net.id = CICP_MAC_ROWID_BAD;
     if( cicp_user_resolve(ni, ni->cplane_init_net, &ipcache->fwd_ver_init_net,
-                          sock_cp->sock_cp_flags, &key, &data) != 0 )
+                          sock_cp->sock_cp_flags, &key, &data) != 0 ) {
+      if( ! (key.flag & CP_FWD_KEY_REQ_WAIT) )
+        goto pending_route;
       goto alien_route;
+    }
   }
   else {
     ipcache->fwd_ver_init_net.id = CICP_MAC_ROWID_UNUSED;
     ipcache->iif_ifindex = CI_IFID_BAD;
+#ifndef __KERNEL__
+    if( ! from_cache )
+      cicp_fwd_cache_update(ni, daddr, &key, key_src, &ipcache->fwd_ver,
+                            &data);
+#endif
   }
 
   /* IPv6 + !OO_SCP_BOUND_ADDR: set the source address back */
@@ -413,6 +531,15 @@ cicp_user_retrieve(ci_netif*                    ni,
   }
   return;
 
+ pending_route:
+  /* The resolution request is queued with the cplane server; the fwd row
+   * will be published shortly.  The caller may defer the packet via
+   * ci_ip_send_pkt_defer() and it will be sent from the poll loop. */
+  ipcache->status = retrrc_pending;
+  ipcache->hwport = CI_HWPORT_ID_BAD;
+  ipcache->intf_i = -1;
+  return;
+
  alien_route:
   ipcache->status = retrrc_alienroute;
   ipcache->hwport = CI_HWPORT_ID_BAD;
@@ -491,6 +618,61 @@ oo_deferred_arp_failed(ci_netif *ni, int af, ci_ip_pkt_fmt* pkt)
   cicp_pkt_complete_fake(ni, pkt);
 }
 
+/* Handle a deferred packet whose route is still being resolved
+ * (OO_DEFERRED_FLAG_RESOLVE).  Re-runs the lookup; once the cplane has
+ * published the fwd row, fills in the forward info and hands the packet
+ * over to the normal deferred-send handling, which copes with a missing
+ * MAC.  Returns TRUE if the packet was sent or dropped. */
+static int oo_deferred_resolve_one(ci_netif* ni, struct oo_deferred_pkt* dpkt,
+                                   ci_ip_pkt_fmt* pkt)
+{
+  int af = dpkt->flag & OO_DEFERRED_FLAG_IS_IPV6 ? AF_INET6 : AF_INET;
+  ci_ip_cached_hdrs ipcache;
+  ci_sock_cmn* s = NULL;
+  oo_sp sock_id = pkt->flags & CI_PKT_FLAG_UDP ?
+                  pkt->pf.udp.tx_sock_id : pkt->pf.tcp_tx.sock_id;
+#if ! CI_CFG_IPV6
+  (void)af;
+#endif
+
+  if( OO_SP_NOT_NULL(sock_id) )
+    s = SP_TO_SOCK(ni, sock_id);
+
+  ci_ip_cache_init(&ipcache, af);
+  ci_ip_send_pkt_lookup(ni, s != NULL ? &s->cp : NULL, pkt, &ipcache);
+
+  switch( ipcache.status ) {
+  case retrrc_pending:
+    /* Row still not published; retry on the next poll. */
+    dpkt->flag &=~ OO_DEFERRED_FLAG_FIRST;
+    return 0;
+  case retrrc_success:
+  case retrrc_nomac:
+    /* The route is known now.  Lay out the Ethernet header, fill in the
+     * forward info and fall back to the normal deferred-send handling. */
+    ci_ip_set_mac_and_port(ni, &ipcache, pkt);
+    dpkt->src = ipcache_laddr(&ipcache);
+    dpkt->nexthop = ipcache.nexthop;
+    dpkt->ifindex = ipcache.ifindex;
+    if( ipcache.fwd_ver_init_net.id != CICP_MAC_ROWID_UNUSED ) {
+      dpkt->ver = ipcache.fwd_ver_init_net;
+      dpkt->iif_ifindex = ipcache.iif_ifindex;
+    }
+    else {
+      dpkt->ver = ipcache.fwd_ver;
+      dpkt->iif_ifindex = CI_IFID_BAD;
+    }
+    dpkt->flag &=~ OO_DEFERRED_FLAG_RESOLVE;
+    dpkt->flag |= OO_DEFERRED_FLAG_FIRST;
+    return oo_deferred_send_one(ni, dpkt);
+  default:
+    /* The route turned out to be unusable - drop the packet. */
+    CITP_STATS_NETIF_INC(ni, tx_defer_pkt_drop_failed);
+    cicp_pkt_complete_fake(ni, pkt);
+    return 1;
+  }
+}
+
 /* Try to send one deferrred packet.  Returns TRUE if sent. */
 int oo_deferred_send_one(ci_netif *ni, struct oo_deferred_pkt* dpkt)
 {
@@ -500,6 +682,9 @@ int oo_deferred_send_one(ci_netif *ni, struct oo_deferred_pkt* dpkt)
   ci_ip_pkt_fmt* pkt = PKT_CHK(ni, dpkt->pkt_id);
   int rc;
 
+  if( dpkt->flag & OO_DEFERRED_FLAG_RESOLVE )
+    return oo_deferred_resolve_one(ni, dpkt, pkt);
+
   /* Has anything changed? */
   if( ! (dpkt->flag & OO_DEFERRED_FLAG_FIRST) &&
       oo_cp_verinfo_is_valid(cp, &dpkt->ver, ci_ni_fwd_table_id(ni)) )
@@ -51,19 +51,44 @@ int __ef_eplock_lock_slow(ci_netif *ni, long timeout, int maybe_wedged)
   ci_assert_equal(maybe_wedged, 0);
 #endif
 
+  ci_netif_fr_log(ni, CI_FR_EV_LOCK_CONTEND, 0,
+                  (ci_uint32) ni->state->lock.lock);
+
 #ifndef __KERNEL__
   /* Limit to user-level for now.  Could allow spinning in kernel if we did
    * not rely on user-level accessible state for spin timeout.
    */
-  if( oo_per_thread_get()->spinstate & (1 << ONLOAD_SPIN_STACK_LOCK) ) {
-    CITP_STATS_NETIF(++ni->state->stats.stack_lock_buzz);
-    ci_frc64(&now_frc);
-    start_frc = now_frc;
-    while( now_frc - start_frc < ni->state->buzz_cycles ) {
-      ci_spinloop_pause();
+  {
+    struct oo_per_thread* pt = oo_per_thread_get();
+    int poll_prio = pt->poll_prio;
+
+    if( poll_prio || (pt->spinstate & (1 << ONLOAD_SPIN_STACK_LOCK)) ) {
+      CITP_STATS_NETIF(++ni->state->stats.stack_lock_buzz);
       ci_frc64(&now_frc);
-      if( ef_eplock_trylock(&ni->state->lock) )
-        return 0;
+      start_frc = now_frc;
+      oo_spin_topology_enter(pt, now_frc, IPTIMER_STATE(ni)->khz);
+      while( now_frc - start_frc < ni->state->buzz_cycles ) {
+        if( poll_prio ) {
+          /* Claim the next handoff.  The claim can be wiped by a racing
+           * unlock in the driver, so re-assert it each iteration. */
+          ef_eplock_poll_prio_set(&ni->state->lock);
+          if( ef_eplock_trylock_poll_prio(&ni->state->lock) ) {
+            CITP_STATS_NETIF(++ni->state->stats.stack_lock_prio_handoff);
+            return 0;
+          }
+        }
+        else if( ef_eplock_trylock(&ni->state->lock) )
+          return 0;
+        if( oo_spin_topology_yield(pt) )
+          CITP_STATS_NETIF(++ni->state->stats.spin_topology_yield);
+        else
+          ci_spinloop_pause();
+        ci_frc64(&now_frc);
+      }
+      /* Withdraw the claim before blocking: blocked waiters take the
+       * lock regardless of it, and must, for forward progress. */
+      if( poll_prio )
+        ef_eplock_poll_prio_clear(&ni->state->lock);
     }
   }
 #endif
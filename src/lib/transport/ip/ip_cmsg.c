@@ -381,6 +381,117 @@ void ci_ip_cmsg_finish(struct cmsg_state* cmsg_state)
   cmsg_state->msg->msg_controllen = cmsg_state->cmsg_bytes_used;
 }
 
+/**
+ * Fast path for sockets whose only control messages are timestamps,
+ * i.e. cmsg_flags has no bits outside CI_IP_CMSG_TIMESTAMP_ANY.  The
+ * control buffer layout is then a single cmsg at offset zero whose
+ * level, type and length are known from the socket's flag words alone,
+ * so we store the header fields and compute the payload directly at
+ * fixed offsets in the user buffer instead of walking
+ * CMSG_FIRSTHDR()/CMSG_NXTHDR() and copying piecewise through
+ * ci_put_cmsg().
+ *
+ * Returns 0 if this flag combination (or a too-small buffer) needs the
+ * generic path.
+ */
+ci_inline int ci_ip_cmsg_recv_fast_ts(ci_netif* ni, ci_udp_state* us,
+                                      const ci_ip_pkt_fmt* pkt,
+                                      struct msghdr* msg, int* p_msg_flags)
+{
+  unsigned flags = us->s.cmsg_flags;
+  struct cmsghdr* cm = msg->msg_control;
+  void* data;
+  socklen_t len;
+  int type;
+
+#if CI_CFG_TIMESTAMPING
+  if( flags & CI_IP_CMSG_TIMESTAMPING ) {
+    /* Multiple cmsgs: leave it to the generic path. */
+    if( flags & (CI_IP_CMSG_TIMESTAMP | CI_IP_CMSG_TIMESTAMPNS) )
+      return 0;
+    type = ONLOAD_SO_TIMESTAMPING;
+    if( us->s.timestamping_flags & ONLOAD_SOF_TIMESTAMPING_ONLOAD )
+      len = (!!(us->s.timestamping_flags & ONLOAD_TIMESTAMPING_FLAG_RX_NIC) +
+             !!(us->s.timestamping_flags & ONLOAD_TIMESTAMPING_FLAG_RX_CPACKET))
+            * sizeof(struct onload_timestamp);
+    else if( us->s.timestamping_flags &
+             (ONLOAD_SOF_TIMESTAMPING_RAW_HARDWARE |
+              ONLOAD_SOF_TIMESTAMPING_SYS_HARDWARE |
+              ONLOAD_SOF_TIMESTAMPING_SOFTWARE) )
+      len = 3 * sizeof(struct timespec);
+    else
+      return 0;
+  }
+  else
+#endif
+  if( flags & CI_IP_CMSG_TIMESTAMPNS ) {
+    type = SO_TIMESTAMPNS;
+    len = sizeof(struct timespec);
+  }
+  else {
+    ci_assert(flags & CI_IP_CMSG_TIMESTAMP);
+    type = SO_TIMESTAMP;
+    len = sizeof(struct timeval);
+  }
+
+  if( cm == NULL || msg->msg_controllen < CMSG_SPACE(len) )
+    return 0;
+
+  cm->cmsg_len = CMSG_LEN(len);
+  cm->cmsg_level = SOL_SOCKET;
+  cm->cmsg_type = type;
+  data = CMSG_DATA(cm);
+
+#if CI_CFG_TIMESTAMPING
+  if( flags & CI_IP_CMSG_TIMESTAMPING ) {
+    if( us->s.timestamping_flags & ONLOAD_SOF_TIMESTAMPING_ONLOAD ) {
+      struct onload_timestamp* ts = data;
+      if( us->s.timestamping_flags & ONLOAD_TIMESTAMPING_FLAG_RX_NIC )
+        ci_rx_pkt_timestamp_nic(pkt, ts++);
+      if( us->s.timestamping_flags & ONLOAD_TIMESTAMPING_FLAG_RX_CPACKET )
+        ci_rx_pkt_timestamp_cpacket(pkt, ts);
+    }
+    else {
+      struct {
+        struct timespec swtime;
+        struct timespec hwtimesys;
+        struct timespec hwtimeraw;
+      } *ts = data;
+      struct onload_timestamp ots;
+      struct timespec nic;
+
+      memset(ts, 0, sizeof(*ts));
+      if( us->s.timestamping_flags & ONLOAD_SOF_TIMESTAMPING_SOFTWARE &&
+          pkt->tstamp_frc != 0 )
+        ci_udp_compute_stamp(ni, pkt->tstamp_frc, &ts->swtime);
+
+      ci_rx_pkt_timestamp_nic(pkt, &ots);
+      onload_timestamp_to_timespec(&ots, &nic);
+      if( us->s.timestamping_flags & ONLOAD_SOF_TIMESTAMPING_SYS_HARDWARE &&
+          nic.tv_nsec & CI_IP_PKT_HW_STAMP_FLAG_IN_SYNC )
+        ts->hwtimesys = nic;
+      if( us->s.timestamping_flags & ONLOAD_SOF_TIMESTAMPING_RAW_HARDWARE )
+        ts->hwtimeraw = nic;
+    }
+  }
+  else
+#endif
+  if( flags & CI_IP_CMSG_TIMESTAMPNS ) {
+    ci_udp_compute_stamp(ni, pkt->tstamp_frc, data);
+  }
+  else {
+    struct timespec ts;
+    struct timeval* tv = data;
+    ci_udp_compute_stamp(ni, pkt->tstamp_frc, &ts);
+    tv->tv_sec = ts.tv_sec;
+    tv->tv_usec = ts.tv_nsec / 1000;
+  }
+
+  msg->msg_controllen = CMSG_SPACE(len);
+  return 1;
+}
+
+
 /**
  * Fill in the msg ancillary data buffer with all control messages
  * according to cmsg_flags the user has set beforehand.
@@ -392,14 +503,18 @@ void ci_ip_cmsg_recv(ci_netif* ni, ci_udp_state* us, const ci_ip_pkt_fmt *pkt,
   struct cmsg_state cmsg_state;
   int af = oo_pkt_af(pkt);
 
+  if( pkt->flags & CI_PKT_FLAG_INDIRECT )
+    pkt = PKT_CHK_NML(ni, pkt->frag_next, netif_locked);
+
+  if( (flags & ~CI_IP_CMSG_TIMESTAMP_ANY) == 0 &&
+      ci_ip_cmsg_recv_fast_ts(ni, us, pkt, msg, p_msg_flags) )
+    return;
+
   cmsg_state.msg = msg;
   cmsg_state.cmsg_bytes_used = 0;
   cmsg_state.cm = CMSG_FIRSTHDR(msg);
   cmsg_state.p_msg_flags = p_msg_flags;
 
-  if( pkt->flags & CI_PKT_FLAG_INDIRECT )
-    pkt = PKT_CHK_NML(ni, pkt->frag_next, netif_locked);
-
   if( (af == AF_INET) && (flags & CI_IP_CMSG_PKTINFO) ) {
     ++us->stats.n_rx_pktinfo;
     ip_cmsg_recv_pktinfo(ni, us, pkt, af, &cmsg_state);
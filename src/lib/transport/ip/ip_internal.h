@@ -100,6 +100,8 @@ ci_inline unsigned ip_pkt_dump_len(unsigned len) {
 */
 ci_inline void ci_tcp_update_rtt(ci_netif* netif, ci_tcp_state* ts, int m)
 {
+  int measurement = m;
+
   /* ?? Jacobson's algorithm assumes a signed number which might not
   ** be the same as ci_iptime_t, hmmm... what to do? */
   if( m < 0 ) {
@@ -132,6 +134,9 @@ ci_inline void ci_tcp_update_rtt(ci_netif* netif, ci_tcp_state* ts, int m)
 
   ci_tcp_rto_bound(netif, ts);
 
+  if( ci_tcp_cc(ts)->rtt_sample != NULL )
+    ci_tcp_cc(ts)->rtt_sample(netif, ts, (ci_iptime_t) CI_MAX(1, measurement));
+
   CI_IP_SOCK_STATS_VAL_RTT_SRTT_RTO( ts, ts->sv >> 2, ts->sa >> 3, ts->rto );
   LOG_TR(ci_log("TCP RX %d UPDATE RTT sa=%u sv=%u SRTT=%u RTTVAR=%u RTO=%u",
 	        S_FMT(ts), ts->sa, ts->sv,
@@ -281,7 +286,8 @@ ci_tcp_ep_clear_filters(ci_netif*         ni,
 {
   int rc;
 #ifdef __ci_driver__
-  int supress_hw_ops = ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT;
+  int supress_hw_ops = ni->flags & (CI_NETIF_FLAG_IN_DL_CONTEXT |
+                                    CI_NETIF_FLAG_BULK_CLOSE);
 #endif
   ci_assert(ni);
 
@@ -427,6 +433,21 @@ struct oo_sock_extended_err {
 #define SO_EE_ORIGIN_TIMESTAMPING 4
 #endif
 
+/* MSG_ZEROCOPY and its completion-notification constants could be
+ * undefined in older headers. */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+#ifndef SO_EE_CODE_ZEROCOPY_COPIED
+#define SO_EE_CODE_ZEROCOPY_COPIED 1
+#endif
+
 /* The following value needs to match its counterpart
  * in kernel headers.
  */
@@ -719,19 +740,26 @@ oo_spinloop_pause_check_signals(ci_netif* ni, ci_uint64 now_frc,
 #else
 
 #include "ci/internal/ip_signal.h"
+#include <onload/ul/per_thread.h>
 extern int oo_spinloop_run_pending_sigs(ci_netif*, citp_waitable*,
                                         citp_signal_info*, int) CI_HF;
 
 ci_inline int
 oo_spinloop_pause_check_signals(ci_netif* ni,
-                                ci_uint64 now_frc /*unused*/,
+                                ci_uint64 now_frc,
                                 ci_uint64* schedule_frc /*unused*/,
                                 int have_timeout,
                                 citp_waitable* w, citp_signal_info* si)
 {
+  struct oo_per_thread* pt = __oo_per_thread_get();
+
   ci_assert_gt(si->c.inside_lib, 0);
   ci_assert(~si->c.aflags & OO_SIGNAL_FLAG_FDTABLE_LOCKED);
 
+  oo_spin_topology_enter(pt, now_frc, IPTIMER_STATE(ni)->khz);
+  if( oo_spin_topology_yield(pt) )
+    CITP_STATS_NETIF(++ni->state->stats.spin_topology_yield);
+
   if(CI_LIKELY( ! (si->c.aflags & OO_SIGNAL_FLAG_HAVE_PENDING) ))
     return 0;
   else
@@ -746,6 +774,39 @@ oo_spinloop_pause_check_signals(ci_netif* ni,
 #endif
 
 
+/**********************************************************************
+ * OO_SPIN_ACCOUNT()
+ */
+
+#if CI_CFG_SPIN_CYCLE_STATS
+/* Attribute the cycles spent in one spin round to one of three buckets:
+ * useful (a stack poll processed at least one event), lock-wait (we
+ * wanted to poll but could not get the stack lock) or empty (nothing to
+ * do).  [last_frc] carries the cycle count at which the previous round
+ * was accounted; spin loops maintain a per-round frc already, so this
+ * adds no timestamp reads on the common paths.
+ */
+ci_inline void
+oo_spin_account(ci_netif* ni, ci_uint64* last_frc, ci_uint64 now_frc,
+                int n_evs, int/*bool*/ lock_missed)
+{
+  ci_uint64 delta = now_frc - *last_frc;
+  *last_frc = now_frc;
+  if( n_evs > 0 )
+    ni->state->stats.spin_cycles_useful += delta;
+  else if( lock_missed )
+    ni->state->stats.spin_cycles_lock_wait += delta;
+  else
+    ni->state->stats.spin_cycles_empty += delta;
+}
+#define OO_SPIN_ACCOUNT(ni, last_frc, now_frc, n_evs, lock_missed)      \
+  oo_spin_account((ni), (last_frc), (now_frc), (n_evs), (lock_missed))
+#else
+#define OO_SPIN_ACCOUNT(ni, last_frc, now_frc, n_evs, lock_missed)      \
+  do{ (void) (n_evs); (void) (lock_missed); }while(0)
+#endif
+
+
 /*********************************************************************
  ******************************** Per-Thread *************************
  *********************************************************************/
@@ -63,7 +63,7 @@ void ci_ip_send_pkt_defer(ci_netif* ni, const struct oo_sock_cplane* sock_cp,
   struct oo_p_dllink_state free_list =
                 oo_p_dllink_ptr(ni, &ni->state->deferred_list_free);
   struct oo_p_dllink_state lnk;
-  ci_assert_equal(retrieve_rc, retrrc_nomac);
+  ci_assert(retrieve_rc == retrrc_nomac || retrieve_rc == retrrc_pending);
 
   /* The upper layers think that the packet is in-flight and the NIC owns
    * it.  We pretend to be that NIC, so we take the reference.
@@ -81,8 +81,10 @@ void ci_ip_send_pkt_defer(ci_netif* ni, const struct oo_sock_cplane* sock_cp,
   lnk = oo_p_dllink_statep(ni, free_list.l->next);
   oo_p_dllink_del(ni, lnk);
 
-  /* Ensure the pkt is ready to send */
-  ci_assert_equal(pkt->intf_i, ipcache->intf_i);
+  /* Ensure the pkt is ready to send.  With retrrc_pending the route (and
+   * so the interface) is not known yet. */
+  ci_assert_impl(retrieve_rc == retrrc_nomac,
+                 pkt->intf_i == ipcache->intf_i);
 
   /* Store all the data in the deferred packets queue */
   dpkt = CI_CONTAINER(struct oo_deferred_pkt, link, lnk.l);
@@ -101,6 +103,12 @@ void ci_ip_send_pkt_defer(ci_netif* ni, const struct oo_sock_cplane* sock_cp,
   dpkt->nexthop = ipcache->nexthop;
   dpkt->ifindex = ipcache->ifindex;
   dpkt->flag = OO_DEFERRED_FLAG_FIRST;
+  if( retrieve_rc == retrrc_pending ) {
+    /* The fwd info above is not valid yet; oo_deferred_send_one() will
+     * fill it in once the cplane publishes the route. */
+    dpkt->flag |= OO_DEFERRED_FLAG_RESOLVE;
+    CITP_STATS_NETIF_INC(ni, tx_defer_pkt_resolve);
+  }
   if( IS_AF_INET6(ipcache_af(ipcache)) )
     dpkt->flag |= OO_DEFERRED_FLAG_IS_IPV6;
   if( ipcache->fwd_ver_init_net.id != CICP_MAC_ROWID_UNUSED ) {
@@ -144,6 +152,11 @@ int ci_ip_send_pkt_send(ci_netif* ni, const struct oo_sock_cplane* sock_cp,
     ci_ip_set_mac_and_port(ni, ipcache, pkt);
     ci_ip_send_pkt_defer(ni, sock_cp, retrrc_nomac, &os_rc, pkt, ipcache);
     return 0;
+  case retrrc_pending:
+    /* Route resolution is in flight; the Ethernet header is laid out when
+     * it completes. */
+    ci_ip_send_pkt_defer(ni, sock_cp, retrrc_pending, &os_rc, pkt, ipcache);
+    return 0;
   case retrrc_noroute:
     return -EHOSTUNREACH;
   case retrrc_alienroute:
@@ -217,6 +230,14 @@ void ci_ip_send_tcp_slow(ci_netif* ni, ci_tcp_state* ts, ci_ip_pkt_fmt* pkt)
      * But ci_ip_send_pkt_defer() uses ipcache verinfo if available. */
     ci_ip_cache_invalidate(&ts->s.pkt);
 
+    return;
+  case retrrc_pending:
+    /* EF_CPLANE_NONBLOCK_RESOLVE: the route is being resolved
+     * asynchronously.  Queue the packet; it is transmitted from the poll
+     * loop when the fwd row is published. */
+    rc = 0;
+    ci_ip_send_pkt_defer(ni, &ts->s.cp, ts->s.pkt.status, &rc, pkt, &ts->s.pkt);
+    ci_ip_cache_invalidate(&ts->s.pkt);
     return;
   case retrrc_alienroute:
   case retrrc_localroute:
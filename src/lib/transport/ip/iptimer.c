@@ -336,12 +336,22 @@ static void ci_ip_timer_docallback(ci_netif *netif, ci_ip_timer* ts)
     sp = oo_statep_to_sockp(netif, ts->statep);
     ci_tcp_timeout_cork(netif, SP_TO_TCP(netif, sp));
     break;
+#if CI_CFG_TCP_RACK
+  case CI_IP_TIMER_TCP_RACK:
+    sp = oo_statep_to_sockp(netif, ts->statep);
+    CHECK_TS(netif, SP_TO_TCP(netif, sp));
+    ci_tcp_timeout_rack(netif, SP_TO_TCP(netif, sp));
+    break;
+#endif
   case CI_IP_TIMER_NETIF_TCP_RECYCLE:
     ci_ip_timer_do_recycle(netif);
     break;
   case CI_IP_TIMER_NETIF_TIMEOUT:
     ci_netif_timeout_state(netif);
     break;
+  case CI_IP_TIMER_NETIF_TX_PACE:
+    ci_netif_tx_pacing_timeout(netif);
+    break;
   case CI_IP_TIMER_PMTU_DISCOVER:
   {
     oo_p pmtu_p = ts->statep;
@@ -383,6 +393,8 @@ void ci_ip_timer_poll(ci_netif *netif) {
   ci_ip_timer* ts;
   ci_iptime_t rtime;
   int changed = 0;
+  ci_uint32 budget = NI_OPTS(netif).poll_timer_budget;
+  ci_uint32 n_fired = 0;
   struct oo_p_dllink_state fire_list = oo_p_dllink_ptr(netif,
                                                        &ipts->fire_list);
   struct oo_p_dllink_state bucket;
@@ -405,6 +417,41 @@ void ci_ip_timer_poll(ci_netif *netif) {
     /* advance the schedulers view of time */
     (*stime)++;
 
+    /* Ticks whose wheel-0 bucket is empty need no work, so consult the
+     * busy bitmap and jump the scheduler's clock straight to the next
+     * tick that has timers to fire, stopping at real time or at the end
+     * of this wheel-0 revolution (the next revolution starts with a
+     * cascade).  This bounds the per-poll cost by the number of
+     * expirations rather than by the number of ticks elapsed since the
+     * last poll. */
+    if( IPTIMER_BUCKETNO(0, *stime) != 0 ) {
+      ci_iptime_t base = *stime & IPTIMER_WHEEL0_MASK;
+      ci_iptime_t limit = rtime;
+      ci_iptime_t b = *stime - base;
+      ci_iptime_t next;
+      ci_uint64 m = ipts->busy_mask[b/64] & ~((1ULL << (b%64)) - 1);
+      unsigned i;
+
+      if( TIME_GT(limit, base + CI_IPTIME_BUCKETS - 1) )
+        limit = base + CI_IPTIME_BUCKETS - 1;
+
+      next = limit;
+      for( i = b/64; i < 4; ++i ) {
+        if( m != 0 ) {
+          next = base + i*64 + ci_ffs64(m) - 1;
+          break;
+        }
+        if( i + 1 < 4 )
+          m = ipts->busy_mask[i + 1];
+      }
+      if( TIME_GT(next, limit) )
+        next = limit;
+      if( TIME_GT(next, *stime) ) {
+        CITP_STATS_NETIF_ADD(netif, timer_poll_ticks_skipped, next - *stime);
+        *stime = next;
+      }
+    }
+
     /* cascade through wheels if reached end of current wheel */
     if(IPTIMER_BUCKETNO(0, *stime) == 0) {
       if(IPTIMER_BUCKETNO(1, *stime) == 0) {
@@ -436,6 +483,23 @@ void ci_ip_timer_poll(ci_netif *netif) {
     DETAILED_CHECK_TIMERS(netif);
 
     while( ! oo_p_dllink_is_empty(netif, fire_list) ) {
+      /* EF_POLL_TIMER_BUDGET: hard cap on callbacks per poll.  Splice
+       * the unfired remainder back into its bucket and rewind the
+       * scheduler's clock one tick so the next poll revisits this
+       * bucket.  Ticks in bucket 0 are always completed: rewinding
+       * across a cascade boundary would confuse the closest-timer
+       * estimate, and one bucket every wheel revolution is a negligible
+       * overrun. */
+      if( budget != 0 && n_fired >= budget &&
+          IPTIMER_BUCKETNO(0, *stime) != 0 ) {
+        oo_p_dllink_splice(netif, fire_list, bucket);
+        oo_p_dllink_init(netif, fire_list);
+        __ci_timer_busy_set(netif, *stime);
+        --(*stime);
+        CITP_STATS_NETIF_INC(netif, timer_poll_budget_hit);
+        goto budget_out;
+      }
+
       link = oo_p_dllink_statep(netif, fire_list.l->next);
       oo_p_dllink_del_init(netif, link);
 
@@ -445,12 +509,14 @@ void ci_ip_timer_poll(ci_netif *netif) {
 
       /* callback safe to set/clear this or other timers */
       ci_ip_timer_docallback(netif, ts);
+      ++n_fired;
     }
     OO_P_DLLINK_ASSERT_EMPTY(netif, fire_list);
 
     DETAILED_CHECK_TIMERS(netif);
   }
 
+ budget_out:
   OO_P_DLLINK_ASSERT_EMPTY(netif, fire_list);
 
   /* What is our next timer?
@@ -582,7 +648,11 @@ static const char* ci_ip_timer_dump(const ci_ip_timer* ts)
     MAKECASE(CI_IP_TIMER_TCP_KALIVE,   "kalive")
     MAKECASE(CI_IP_TIMER_TCP_LISTEN,   "listen")
     MAKECASE(CI_IP_TIMER_TCP_CORK,     "cork")
+#if CI_CFG_TCP_RACK
+    MAKECASE(CI_IP_TIMER_TCP_RACK,     "rack")
+#endif
     MAKECASE(CI_IP_TIMER_NETIF_TIMEOUT, "netif")
+    MAKECASE(CI_IP_TIMER_NETIF_TX_PACE, "txpace")
     MAKECASE(CI_IP_TIMER_PMTU_DISCOVER, "pmtu")
 #if CI_CFG_SUPPORT_STATS_COLLECTION
     MAKECASE(CI_IP_TIMER_TCP_STATS,     "tcp-stats")
@@ -82,6 +82,8 @@ ci_inline void ci_netif_timeout_add(ci_netif* ni, ci_tcp_state* ts, int idx)
 
   is_first = oo_p_dllink_is_empty(ni, my_list);
   oo_p_dllink_add_tail(ni, my_list, link);
+  if( idx == OO_TIMEOUT_Q_TIMEWAIT )
+    ++ni->state->n_timewait;
 
   /* Set up the timer */
   if( ! is_first )
@@ -118,6 +120,10 @@ void ci_netif_timeout_remove(ci_netif* ni, ci_tcp_state* ts)
 
   /* remove from the list */
   oo_p_dllink_del_init(ni, link);
+  if( idx == OO_TIMEOUT_Q_TIMEWAIT ) {
+    ci_assert_gt(ni->state->n_timewait, 0);
+    --ni->state->n_timewait;
+  }
 
   /* if needed re-set or clear timer */
   if( ! is_first )
@@ -277,6 +283,24 @@ void ci_netif_timewait_enter(ci_netif* ni, ci_tcp_state* ts)
 
   ci_tcp_stop_timers(ni, ts);
 
+  /* EF_TCP_TIME_WAIT_MAX: cap the number of sockets parked in TIME_WAIT
+   * so that a reconnect storm cannot exhaust the endpoint table.  Recycle
+   * the oldest entry - it is the closest to its 2MSL expiry, and losing
+   * its protection early is the same trade-off Linux makes with
+   * tcp_max_tw_buckets. */
+  if( NI_OPTS(ni).tcp_time_wait_max != 0 &&
+      ni->state->n_timewait >= NI_OPTS(ni).tcp_time_wait_max ) {
+    struct oo_p_dllink_state list =
+            oo_p_dllink_ptr(ni, &ni->state->timeout_q[OO_TIMEOUT_Q_TIMEWAIT]);
+    if( ! oo_p_dllink_is_empty(ni, list) ) {
+      ci_tcp_state* oldest =
+            TCP_STATE_FROM_LINK(oo_p_dllink_statep(ni, list.l->next).l);
+      ci_assert_nequal(oldest, ts);
+      ci_netif_timeout_leave(ni, oldest);
+      CITP_STATS_NETIF(++ni->state->stats.timewait_max_reap);
+    }
+  }
+
   /* store time to leave TIMEWAIT state */
   ts->t_last_sent = ci_ip_time_now(ni) + NI_CONF(ni).tconst_2msl_time;
   /* add to list */
@@ -396,6 +420,11 @@ void ci_netif_try_to_reap(ci_netif* ni, int stop_once_freed_n)
   int reap_harder = ni->packets->sets_n == ni->packets->sets_max
       || ni->state->mem_pressure;
 
+  /* Partially reassembled UDP datagrams pin RX buffers; under real
+   * pressure give them to the kernel to finish. */
+  if( reap_harder && NI_OPTS(ni).udp_rx_reassembly )
+    ci_netif_udp_reasm_flush(ni);
+
   if( oo_p_dllink_is_empty(ni, reap_list) )
     return;
 
@@ -439,8 +468,10 @@ void ci_netif_try_to_reap(ci_netif* ni, int stop_once_freed_n)
     }
     else if( wo->waitable.state == CI_TCP_STATE_UDP ) {
       ci_udp_state* us = &wo->udp;
-      freed_n += ci_netif_try_to_reap_udp_recv_q(ni, &us->recv_q,
-                                                 &add_to_reap_list);
+      int q;
+      for( q = 0; q < ci_udp_rx_q_count(us); ++q )
+        freed_n += ci_netif_try_to_reap_udp_recv_q(ni, ci_udp_rx_q(us, q),
+                                                   &add_to_reap_list);
 #if CI_CFG_TIMESTAMPING
       freed_n += ci_netif_try_to_reap_udp_recv_q(ni, &us->timestamp_q,
                                                  &add_to_reap_list);
@@ -1145,6 +1176,11 @@ ci_uint64 ci_netif_unlock_slow_common(ci_netif* ni, ci_uint64 lock_val,
     oo_p_dllink_for_each_safe(ni, lnk, tmp_lnk, post_poll_list) {
       oo_p_dllink_del_init(ni, lnk);
 
+      /* The next waitable's [bufid] is a cold cache line; start fetching
+       * it while we deal with this one. */
+      if( tmp_lnk.l != post_poll_list.l )
+        ci_prefetch(CI_CONTAINER(citp_waitable, post_poll_link, tmp_lnk.l));
+
       w = CI_CONTAINER(citp_waitable, post_poll_link, lnk.l);
       eps[op.eps_num++] = w->bufid;
 
@@ -1185,6 +1221,9 @@ ci_uint64 ci_netif_unlock_slow_common(ci_netif* ni, ci_uint64 lock_val,
       set_flags |= CI_EPLOCK_NETIF_HAS_DEFERRED_PKTS;
   }
 
+  if( test_val & CI_EPLOCK_NETIF_STAGED_TX )
+    ci_udp_sendmsg_drain_staged(ni);
+
   if( test_val & CI_EPLOCK_NETIF_MERGE_ATOMIC_COUNTERS )
     ci_netif_merge_atomic_counters(ni);
 
@@ -1229,7 +1268,8 @@ static void ci_netif_unlock_slow(ci_netif* ni)
     if( l & all_handled_flags & CI_EPLOCK_NETIF_NEED_PRIME ) {
       CITP_STATS_NETIF_INC(ni, unlock_slow_need_prime);
       CITP_STATS_NETIF_INC(ni, unlock_slow_prime_ul);
-      ci_assert(NI_OPTS(ni).int_driven);
+      ci_assert(NI_OPTS(ni).int_driven ||
+                NI_OPTS(ni).int_adaptive_empty_polls);
       /* TODO: When interrupt driven, evq_primed is never cleared, so we
       * don't know here which subset of interfaces needs to be primed.
       * Would be more efficient if we did.
@@ -1277,6 +1317,48 @@ static void ci_netif_unlock_slow(ci_netif* ni)
 #endif /* __KERNEL__ */
 
 
+#ifndef __KERNEL__
+/* Enqueue a request on the shared-memory slow-path command ring.  The
+** driver drains the ring on every ioctl entry, so we only issue the
+** doorbell ioctl when the ring was empty (else some ioctl -- ours or
+** another thread's -- is already on its way into the kernel, or the
+** previous doorbell has not been consumed yet).
+**
+** Returns 0 on success or -EAGAIN if the ring is full; callers must fall
+** back to the equivalent synchronous ioctl in that case.
+*/
+int ci_netif_slowpath_req(ci_netif* ni, ci_uint32 op, ci_uint32 arg)
+{
+  ci_netif_state* ns = ni->state;
+  struct oo_slowpath_req* req;
+  ci_uint32 added;
+
+  do {
+    added = ns->slowpath_added;
+    if( added - ns->slowpath_drained >= OO_SLOWPATH_RING_SIZE )
+      return -EAGAIN;
+  } while( ci_cas32u_fail(&ns->slowpath_added, added, added + 1) );
+
+  req = &ns->slowpath_ring[added & (OO_SLOWPATH_RING_SIZE - 1)];
+  req->arg = arg;
+  ci_wmb();
+  /* Publishing [op] hands the slot to the driver. */
+  req->op = op;
+  ci_mb();
+
+  if( ns->slowpath_drained == added ) {
+    CITP_STATS_NETIF_INC(ni, slowpath_ring_kick);
+    oo_resource_op(ci_netif_get_driver_handle(ni),
+                   OO_IOC_SLOWPATH_KICK, NULL);
+  }
+  else {
+    CITP_STATS_NETIF_INC(ni, slowpath_ring_moderated);
+  }
+  return 0;
+}
+#endif
+
+
 void ci_netif_unlock(ci_netif* ni)
 {
 #ifdef __KERNEL__
@@ -1683,20 +1765,43 @@ static int __ci_netif_active_wild_pool_select(ci_netif* ni, ci_addr_t laddr,
  *
  * When we assign a new port we check if we expect the peer to be out of
  * TIME-WAIT by now (assuming they're using the same length of timer as us).
- * If so we can give them a new active wild port as usual.  If not, we'll
- * keep looking (potentially increasing the pool).
+ * If so we can give them a new active wild port as usual.  If not, we can
+ * still reuse the port for the same remote provided we choose an initial
+ * sequence number beyond the final sequence number of the old connection,
+ * in which case the peer will accept our SYN as reopening the connection
+ * it holds in TIME-WAIT.  This is the same trick we use when reusing a
+ * local TIME-WAIT, and matters for workloads making rapid short-lived
+ * connections to a small set of remote services, where otherwise each
+ * port would be unusable towards its last remote for two MSLs at a time.
  */
 static int __ci_netif_active_wild_allow_reuse(ci_netif* ni, ci_active_wild* aw,
                                               ci_addr_t laddr, ci_addr_t raddr,
-                                              unsigned rport)
+                                              unsigned rport,
+                                              ci_uint32* prev_seq_out)
 {
   if( ci_ip_time_now(ni) > aw->expiry ||
       NI_OPTS(ni).tcp_shared_local_ports_reuse_fast )
     return 1;
-  else
-    return !CI_IPX_ADDR_EQ(aw->last_laddr, laddr) ||
-           !CI_IPX_ADDR_EQ(aw->last_raddr, raddr) ||
-           (aw->last_rport != rport);
+
+  if( !CI_IPX_ADDR_EQ(aw->last_laddr, laddr) ||
+      !CI_IPX_ADDR_EQ(aw->last_raddr, raddr) ||
+      (aw->last_rport != rport) )
+    return 1;
+
+  if( aw->last_seq != 0 ) {
+    /* The sequence number table may also hold an entry for this
+     * four-tuple, recorded when the old connection sent its FIN.  It is
+     * now stale (the number we remembered at close is at least as
+     * recent), so purge it to keep the table tidy.
+     */
+    ci_tcp_prev_seq_lookup_tuple(ni, laddr, sock_lport_be16(&aw->s),
+                                 raddr, rport);
+    *prev_seq_out = aw->last_seq;
+    CITP_STATS_NETIF_INC(ni, tcp_shared_local_ports_reused_prev_seq);
+    return 1;
+  }
+
+  return 0;
 }
 
 
@@ -1798,8 +1903,8 @@ static oo_sp __ci_netif_active_wild_pool_get(ci_netif* ni, int aw_pool,
 
       CITP_STATS_NETIF_INC(ni, tcp_shared_local_ports_skipped_in_use);
     }
-    else if( __ci_netif_active_wild_allow_reuse(ni, aw, laddr,
-                                                raddr, rport) ) {
+    else if( __ci_netif_active_wild_allow_reuse(ni, aw, laddr, raddr, rport,
+                                                prev_seq_out) ) {
       /* If no-one's using this 4-tuple we can let the caller share this
        * active wild.
        */
@@ -1924,6 +2029,14 @@ void ci_netif_active_wild_sharer_closed(ci_netif* ni, ci_sock_cmn* s)
     aw->last_laddr = sock_ipx_laddr(s);
     aw->last_raddr = sock_ipx_raddr(s);
     aw->last_rport = sock_rport_be16(s);
+    /* Remember the final sequence number so that the port can be reused
+     * for this remote before [expiry] with a safe ISN.  Choose the ISN a
+     * little way beyond the old sequence space, as we do when reusing a
+     * local TIME-WAIT.
+     */
+    aw->last_seq = tcp_snd_nxt(SOCK_TO_TCP(s)) + NI_OPTS(ni).tcp_isn_offset;
+    if( aw->last_seq == 0 )
+      aw->last_seq = 1;
   }
 }
 #endif /* CI_CFG_TCP_SHARED_LOCAL_PORTS */
@@ -15,6 +15,7 @@
 #include <onload/version.h>
 #include <onload/sleep.h>
 #include <onload/netif_dtor.h>
+#include <ci/internal/pio_buddy.h>
 #include <etherfabric/vi.h>
 #include <etherfabric/internal/efct_uk_api.h>
 
@@ -54,8 +55,10 @@ static void ci_netif_state_assert_valid(ci_netif* ni,
   /* check DMAQ overflow queue if non-empty */
   OO_STACK_FOR_EACH_INTF_I(ni, intf_i) {
     int i;
-    for( i = 0; i < ci_netif_num_vis(ni); ++i ) {
-      oo_pktq* dmaq = &nis->nic[intf_i].dmaq[i];
+    for( i = 0; i <= ci_netif_num_vis(ni); ++i ) {
+      oo_pktq* dmaq = i < ci_netif_num_vis(ni) ?
+                      &nis->nic[intf_i].dmaq[i] :
+                      &nis->nic[intf_i].dmaq_urgent;
       if( OO_PP_NOT_NULL(dmaq->head) ) {
         verify( IS_VALID_PKT_ID(ni, dmaq->head) );
         verify( IS_VALID_PKT_ID(ni, dmaq->tail) );
@@ -587,13 +590,208 @@ void ci_netif_dump_extra_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
   logger(log_arg, "  hwport_to_intf_i=%s intf_i_to_hwport=%s", hp2i, i2hp);
   logger(log_arg, "  uk_intf_ver=%s", OO_UK_INTF_VER);
   logger(log_arg, "  deferred count %d/%d", ns->defer_work_count, NI_OPTS(ni).defer_work_limit);
-  logger(log_arg, "  numa nodes: creation=%d load=%d",
-         ns->creation_numa_node, ns->load_numa_node);
+  logger(log_arg, "  numa nodes: creation=%d load=%d stack=%d",
+         ns->creation_numa_node, ns->load_numa_node,
+         ns->stack_alloc_numa_node);
   logger(log_arg, "  numa node masks: packet alloc=%x sock alloc=%x interrupt=%x",
          ns->packet_alloc_numa_nodes, ns->sock_alloc_numa_nodes,
          ns->interrupt_numa_nodes);
+  logger(log_arg, "  mem preflight: shm=%llu pktbuf=%llu",
+         (unsigned long long) ns->preflight_shm_bytes,
+         (unsigned long long) ns->preflight_pktbuf_bytes);
+
+  if( NI_OPTS(ni).poll_profile ) {
+    static const char* phase_names[CI_POLL_PROFILE_PHASES] =
+      { "evq", "post-poll", "ring-refill", "loopback", "timers" };
+    logger(log_arg, "  poll profile (cycles):");
+    for( i = 0; i < CI_POLL_PROFILE_PHASES; ++i )
+      logger(log_arg, "    %-11s n=%llu total=%llu max=%llu", phase_names[i],
+             (unsigned long long) ns->poll_profile[i].n,
+             (unsigned long long) ns->poll_profile[i].cycles,
+             (unsigned long long) ns->poll_profile[i].max_cycles);
+  }
 }
 
+void ci_netif_dump_tuning_advice(ci_netif* ni)
+{
+  ci_netif_dump_tuning_advice_to_logger(ni, ci_log_dump_fn, NULL);
+}
+
+
+/* Turns counters that indicate resource pressure into concrete EF_ option
+ * suggestions.  Each line cites the evidence it is based on, so the reader
+ * can judge it; nothing here changes any state.  The rules are
+ * conservative: they only speak up when a limit has demonstrably been hit
+ * (or is demonstrably oversized), not on the first blip. */
+void ci_netif_dump_tuning_advice_to_logger(ci_netif* ni,
+                                           oo_dump_log_fn_t logger,
+                                           void* log_arg)
+{
+  ci_netif_state* ns = ni->state;
+  ci_netif_stats* s = &ns->stats;
+  const ci_netif_config_opts* opts = &NI_OPTS(ni);
+  unsigned max_packets = opts->max_packets;
+  int n_advice = 0;
+
+  logger(log_arg, "%s: stack=%d", __FUNCTION__, NI_ID(ni));
+
+  /* Packet buffer pool.  Pressure counters mean the pool has run dry;
+   * while sets are allocated on demand, so a pool that never grew close
+   * to its limit is oversized. */
+  if( s->memory_pressure_enter || s->refill_buf_limited ||
+      s->rx_refill_recv ) {
+    logger(log_arg, "  EF_MAX_PACKETS=%u (currently %u): pool exhausted "
+           "(memory_pressure_enter=%u drops=%u refill_buf_limited=%u "
+           "rx_refill_recv=%u)",
+           max_packets * 2, max_packets, s->memory_pressure_enter,
+           s->memory_pressure_drops, s->refill_buf_limited,
+           s->rx_refill_recv);
+    ++n_advice;
+  }
+  else if( ni->packets->sets_n * 4 <= ni->packets->sets_max &&
+           ni->packets->sets_max > 1 ) {
+    logger(log_arg, "  EF_MAX_PACKETS=%u (currently %u): peak demand was "
+           "only %d buffers; halving the limit frees reserved memory",
+           max_packets / 2, max_packets, ni->packets->n_pkts_allocated);
+    ++n_advice;
+  }
+  if( s->refill_rx_limited ) {
+    logger(log_arg, "  EF_MAX_RX_PACKETS (currently %d): RX ring refill "
+           "was starved of buffers %u times; raise it (and EF_MAX_PACKETS) "
+           "if receive loss is seen",
+           opts->max_rx_packets, s->refill_rx_limited);
+    ++n_advice;
+  }
+
+  /* TX ring.  tx_dma_max records the deepest overflow queue behind the
+   * ring, i.e. how far short the ring itself fell. */
+  if( s->tx_dma_max > 0 ) {
+    logger(log_arg, "  EF_TXQ_SIZE=%u (currently %u): TX ring filled and "
+           "up to %u sends queued behind it",
+           (unsigned) opts->txq_size * 2, (unsigned) opts->txq_size,
+           s->tx_dma_max);
+    ++n_advice;
+  }
+
+  /* Event queue.  Watermark drains mean polls were not keeping up with
+   * the event rate. */
+  if( s->evq_watermark_drains ) {
+    logger(log_arg, "  EF_EVS_PER_POLL=%u (currently %u): event queue "
+           "neared overflow %u times; poll more per call or more often",
+           opts->evs_per_poll * 2, opts->evs_per_poll,
+           s->evq_watermark_drains);
+    ++n_advice;
+  }
+
+  /* Endpoint table grows on demand up to the limit. */
+  if( ns->n_ep_bufs >= opts->max_ep_bufs ) {
+    logger(log_arg, "  EF_MAX_ENDPOINTS=%u (currently %u): endpoint table "
+           "is fully grown; socket creation fails beyond this",
+           opts->max_ep_bufs * 2, opts->max_ep_bufs);
+    ++n_advice;
+  }
+
+  /* Latency: a stack that blocks in the kernel very often, with spinning
+   * disabled, is usually leaving latency on the table. */
+  if( opts->spin_usec == 0 && s->sock_sleeps >= 10000 ) {
+    logger(log_arg, "  EF_POLL_USEC: spinning is disabled and threads "
+           "blocked in the kernel %u times; if cores are available, "
+           "spinning cuts wakeup latency", s->sock_sleeps);
+    ++n_advice;
+  }
+
+  if( n_advice == 0 )
+    logger(log_arg, "  no advice: no pressure or oversizing indicators "
+           "recorded (stats cover the period since stack creation or the "
+           "last clear_stats)");
+}
+
+
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+void ci_netif_dump_flight_recorder_to_logger(ci_netif* ni,
+                                             oo_dump_log_fn_t logger,
+                                             void* log_arg)
+{
+  static const char* fr_event_names[] = {
+    "?", "poll", "tcp-rx-drop", "tcp-rx-bad-seq", "lock-contend",
+  };
+  ci_netif_state* ns = ni->state;
+  ci_uint32 wr = (ci_uint32) ns->fr_wr.n;
+  ci_uint32 i, n, first;
+  ci_uint64 prev_frc = 0;
+
+  n = CI_MIN(wr, (ci_uint32) CI_CFG_FLIGHT_RECORDER_ENTRIES);
+  first = wr - n;
+  logger(log_arg, "%s: stack=%d records=%u (of %u logged)", __FUNCTION__,
+         NI_ID(ni), n, wr);
+
+  /* Oldest first.  We read the ring without synchronisation, so a stack
+   * that is still running can overwrite the records under us; the worst
+   * outcome is a torn or out-of-order line at the start of the dump. */
+  for( i = first; i != wr; ++i ) {
+    const ci_fr_record* r =
+      &ns->fr_ring[i & (CI_CFG_FLIGHT_RECORDER_ENTRIES - 1)];
+    const char* name = r->event < sizeof(fr_event_names) /
+                                  sizeof(fr_event_names[0]) ?
+                       fr_event_names[r->event] : "?";
+    logger(log_arg, "  %10u: frc=%016llx (+%10llu) %-15s "
+           "arg16=%u arg32=%u (0x%x)",
+           i, (unsigned long long) r->frc,
+           (unsigned long long) (i == first ? 0 : r->frc - prev_frc),
+           name, (unsigned) r->arg16, (unsigned) r->arg32,
+           (unsigned) r->arg32);
+    prev_frc = r->frc;
+  }
+}
+#endif
+
+
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+void ci_netif_dump_drops_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
+                                   void* log_arg)
+{
+  static const char* reason_names[CI_DROP_REASON_MAX] = {
+    "csum-bad", "crc-bad", "trunc", "mcast-mismatch", "hw-other",
+    "no-match", "tcp", "udp",
+  };
+  ci_netif_state* ns = ni->state;
+  int reason, i, j;
+
+  logger(log_arg, "%s: stack=%d", __FUNCTION__, NI_ID(ni));
+
+  /* We read the rings without synchronisation; a stack that is still
+   * dropping packets can overwrite a sample under us, giving a torn
+   * entry at worst. */
+  for( reason = 0; reason < CI_DROP_REASON_MAX; ++reason ) {
+    const ci_drop_ring* ring = &ns->drop_rings[reason];
+    ci_uint32 n = CI_MIN(ring->n, (ci_uint32) CI_CFG_DROP_SAMPLES_PER_REASON);
+    ci_uint32 first = ring->n > n ? ring->wr : 0;
+
+    if( ring->n == 0 )
+      continue;
+    logger(log_arg, "  %s: drops=%u samples=%u",
+           reason_names[reason], ring->n, n);
+    for( i = 0; i < (int) n; ++i ) {
+      const ci_drop_sample* s =
+        &ring->sample[(first + i) % CI_CFG_DROP_SAMPLES_PER_REASON];
+      int len = CI_MIN((int) s->frame_len, CI_DROP_SAMPLE_BYTES);
+
+      logger(log_arg, "    frc=%016llx intf=%d frame_len=%u",
+             (unsigned long long) s->frc, (int) s->intf_i, s->frame_len);
+      for( j = 0; j < len; j += 16 ) {
+        char line[3 * 16 + 1];
+        int k, off = 0;
+        for( k = j; k < CI_MIN(j + 16, len); ++k )
+          off += ci_scnprintf(line + off, sizeof(line) - off, " %02x",
+                              s->data[k]);
+        logger(log_arg, "      %04x:%s", j, line);
+      }
+    }
+  }
+}
+#endif
+
+
 void ci_netif_config_opts_dump(ci_netif_config_opts* opts,
                                oo_dump_log_fn_t logger, void* log_arg)
 {
@@ -757,11 +955,13 @@ static void ci_netif_dump_vi(ci_netif* ni, int intf_i, oo_dump_log_fn_t logger,
   }
   for( i = 0; i < ci_netif_num_vis(ni); ++i )
     sum_dmaq_num += nic->dmaq[i].num;
-  logger(log_arg, "  txq: cap=%d lim=%d spc=%d level=%d pkts=%d oflow_pkts=%d",
+  sum_dmaq_num += nic->dmaq_urgent.num;
+  logger(log_arg, "  txq: cap=%d lim=%d spc=%d level=%d pkts=%d oflow_pkts=%d "
+         "urgent_pkts=%d",
          ef_vi_transmit_capacity(vi), ef_vi_transmit_capacity(vi),
          ef_vi_transmit_space(vi), ef_vi_transmit_fill_level(vi),
          nic->tx_dmaq_insert_seq - nic->tx_dmaq_done_seq - sum_dmaq_num,
-         nic->dmaq[0].num);
+         nic->dmaq[0].num, nic->dmaq_urgent.num);
   logger(log_arg, "  txq: pio_buf_size=%d tot_pkts=%d bytes=%d",
 #if CI_CFG_PIO
          nic->pio_io_len,
@@ -770,6 +970,15 @@ static void ci_netif_dump_vi(ci_netif* ni, int intf_i, oo_dump_log_fn_t logger,
 #endif
          nic->tx_dmaq_done_seq, nic->tx_bytes_added - nic->tx_bytes_removed);
   logger(log_arg, "  txq: ts_nsec=%x", vi->ep_state->txq.ts_nsec);
+#if CI_CFG_PIO
+  if( nic->oo_vi_flags & OO_VI_FLAGS_PIO_EN ) {
+    ci_uint32 pio_free, pio_largest;
+    ci_pio_buddy_stats(ni, &nic->pio_buddy, &pio_free, &pio_largest);
+    logger(log_arg, "  pio: len=%d used=%d free=%d largest_free_blk=%d",
+           nic->pio_io_len, nic->pio_io_len - pio_free, pio_free,
+           pio_largest);
+  }
+#endif
 
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
   {
@@ -966,8 +1175,9 @@ void ci_netif_dump_to_logger(ci_netif* ni, oo_dump_log_fn_t logger,
   logger(log_arg, "  aux_bufs: free=%u",
          ns->n_free_aux_bufs);
   for( i = 0; i < CI_TCP_AUX_TYPE_NUM; i++ ) {
-    logger(log_arg, "  aux_bufs[%s]: n=%d max=%d",
-           ci_tcp_aux_type2str(i), ns->n_aux_bufs[i], ns->max_aux_bufs[i]);
+    logger(log_arg, "  aux_bufs[%s]: n=%d max=%d cached=%u",
+           ci_tcp_aux_type2str(i), ns->n_aux_bufs[i], ns->max_aux_bufs[i],
+           ns->n_free_aux_typed[i]);
   }
   ci_netif_dump_pkt_summary(ni, logger, log_arg);
 
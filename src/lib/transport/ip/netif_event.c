@@ -22,6 +22,7 @@
 #include <etherfabric/timer.h>
 #include <etherfabric/vi.h>
 #include <ci/internal/pio_buddy.h>
+#include <onload/sleep.h>
 #include <ci/driver/efab/hardware/efct.h>
 
 #if OO_DO_STACK_POLL
@@ -186,7 +187,7 @@ static void record_rx_timestamp(ci_netif* netif, ci_netif_state_nic_t* nsn,
                                 ci_ip_pkt_fmt* pkt,
                                 ef_timespec stamp, unsigned sync_flags)
 {
-  int tsf = (NI_OPTS(netif).timestamping_reporting &
+  int tsf = (NI_HOT_OPTS(netif).timestamping_reporting &
                CITP_TIMESTAMPING_RECORDING_FLAG_CHECK_SYNC) ?
                  EF_VI_SYNC_FLAG_CLOCK_IN_SYNC :
                  EF_VI_SYNC_FLAG_CLOCK_SET;
@@ -197,10 +198,60 @@ static void record_rx_timestamp(ci_netif* netif, ci_netif_state_nic_t* nsn,
   nsn->last_rx_timestamp = pkt->hw_stamp;
   nsn->last_sync_flags = sync_flags;
 
+#if CI_CFG_STATS_NETIF
+  if(CI_UNLIKELY( NI_HOT_OPTS(netif).flags & CI_NETIF_HOT_RX_LATENCY_HISTOGRAM )) {
+#ifdef __KERNEL__
+    struct timespec64 now;
+#else
+    struct timespec now;
+#endif
+    ci_int64 delta_ns;
+#ifdef __KERNEL__
+    ktime_get_real_ts64(&now);
+#else
+    clock_gettime(CLOCK_REALTIME, &now);
+#endif
+    delta_ns = (ci_int64) (now.tv_sec - stamp.tv_sec) * 1000000000 +
+               (now.tv_nsec - (stamp.tv_nsec &
+                               ~CI_IP_PKT_HW_STAMP_FLAG_IN_SYNC));
+    if( delta_ns >= 0 ) {
+      /* Roughly microseconds; each subsequent bucket doubles. */
+      ci_uint64 us = delta_ns >> 10;
+      int b = 0;
+      while( us != 0 && b < 11 ) {
+        us >>= 1;
+        ++b;
+      }
+      /* The rx_wire_lat_* stats are contiguous, forming the histogram. */
+      ++(&netif->state->stats.rx_wire_lat_lt1us)[b];
+    }
+  }
+#endif
+
   LOG_NR(log(LPF "RX id=%d timestamp: %lu.%09lu sync %d",
       OO_PKT_FMT(pkt), (long)stamp.tv_sec, stamp.tv_nsec, sync_flags));
 }
 
+#if CI_CFG_TIMESTAMPING
+/* Snapshot the VI clock-sync state for the current batch of events.
+ * Per-packet conversion then works from the snapshot, avoiding re-reading
+ * and re-validating the sync state for every timestamped packet.  Sync
+ * updates arrive a few times a second, so batch granularity loses
+ * nothing: the conversion maths tolerates a sync point this stale. */
+static void ci_netif_rx_tsync_refresh(ci_netif* ni, int intf_i)
+{
+  ci_netif_state_nic_t* nsn = &ni->state->nic[intf_i];
+
+  if( nsn->oo_vi_flags & OO_VI_FLAGS_RX_HW_TS_EN ) {
+    ef_eventq_state* evqs = &ci_netif_vi(ni, intf_i)->ep_state->evq;
+    nsn->rx_tsync_minor = evqs->sync_timestamp_minor;
+    nsn->rx_tsync_major = evqs->sync_timestamp_major;
+    nsn->rx_tsync_valid = evqs->sync_timestamp_synchronised;
+  }
+}
+#endif
+
+
 static void get_rx_timestamp(ci_netif* netif, ci_ip_pkt_fmt* pkt)
 {
 #if CI_CFG_TIMESTAMPING
@@ -211,13 +262,24 @@ static void get_rx_timestamp(ci_netif* netif, ci_ip_pkt_fmt* pkt)
       (nsn->oo_vi_flags & OO_VI_FLAGS_RX_HW_TS_EN) ) {
     unsigned sync_flags;
     ef_timespec stamp;
-    int rc = ef_vi_receive_get_timestamp_with_sync_flags(
-               vi, PKT_START(pkt) - nsn->rx_prefix_len, &stamp, &sync_flags);
+    int rc;
 
-    if( rc == 0 )
-      record_rx_timestamp(netif, nsn, pkt, stamp, sync_flags);
+    if(CI_LIKELY( nsn->rx_tsync_valid ))
+      rc = ef10_receive_get_timestamp_with_sync_flags_internal(
+               vi, PKT_START(pkt) - nsn->rx_prefix_len, &stamp, &sync_flags,
+               nsn->rx_tsync_minor, nsn->rx_tsync_major);
     else
+      rc = -EL2NSYNC;
+
+    if( rc == 0 ) {
+      CITP_STATS_NETIF_INC(netif, rx_ts_snapshot_hit);
+      record_rx_timestamp(netif, nsn, pkt, stamp, sync_flags);
+    }
+    else {
+      if( rc != -ENODATA )
+        CITP_STATS_NETIF_INC(netif, rx_ts_snapshot_miss);
       LOG_NR(log(LPF "RX id=%d missing timestamp", OO_PKT_FMT(pkt)));
+    }
   }
 #else
   (void)netif;
@@ -254,6 +316,309 @@ static inline unsigned unexpected_rx_log_flag(ci_ip_pkt_fmt* pkt)
          CI_TP_LOG_NR : CI_TP_LOG_U;
 }
 
+
+/**********************************************************************
+ * In-stack reassembly of fragmented IPv4 UDP datagrams
+ * (EF_UDP_RX_REASSEMBLY).
+ *
+ * Fragments are collected in a small table of per-datagram contexts in
+ * shared state (ci_netif_state::udp_reasm), each fragment remaining a
+ * self-contained frame until the datagram completes.  A completed
+ * datagram is converted into the [frag_next] chain a jumbo frame
+ * arrives in and demuxed through ci_udp_handle_rx(), so recvmsg and
+ * zero-copy receive see one datagram spanning several buffers.
+ * Contexts that go stale or lose the eviction race hand their
+ * fragments to the kernel individually, preserving the pre-existing
+ * behaviour for datagrams we cannot complete.
+ */
+
+#define OO_UDP_REASM_TIMEOUT_MS  2000
+
+
+/* Release or hand to the kernel everything a context holds.  Pending
+ * fragments are complete frames in their own right, so the kernel can
+ * finish off a datagram we gave up on. */
+static void oo_udp_reasm_flush_ctx(ci_netif* ni, oo_udp_reasm_t* ctx,
+                                   int to_kernel)
+{
+  oo_pkt_p pp = ctx->frags;
+  ctx->frags = OO_PP_NULL;
+  while( OO_PP_NOT_NULL(pp) ) {
+    ci_ip_pkt_fmt* pkt = PKT_CHK(ni, pp);
+    pp = pkt->frag_next;
+    pkt->frag_next = OO_PP_NULL;
+    if( ! to_kernel || ! ci_netif_pkt_pass_to_kernel(ni, pkt) )
+      ci_netif_pkt_release_rx_1ref(ni, pkt);
+  }
+}
+
+
+static void oo_udp_reasm_expire(ci_netif* ni, ci_uint64 now_frc)
+{
+  ci_uint64 timeout = (ci_uint64) OO_UDP_REASM_TIMEOUT_MS *
+                      IPTIMER_STATE(ni)->khz;
+  int i;
+  for( i = 0; i < OO_UDP_REASM_CTXTS; ++i ) {
+    oo_udp_reasm_t* ctx = &ni->state->udp_reasm[i];
+    if( OO_PP_NOT_NULL(ctx->frags) && now_frc - ctx->start_frc > timeout ) {
+      CITP_STATS_NETIF_INC(ni, udp_reasm_abandoned);
+      oo_udp_reasm_flush_ctx(ni, ctx, 1);
+    }
+  }
+}
+
+
+/* Flush all pending reassembly state, handing the fragments to the
+ * kernel.  Called when reclaiming packet buffers under pressure. */
+void ci_netif_udp_reasm_flush(ci_netif* ni)
+{
+  int i;
+  for( i = 0; i < OO_UDP_REASM_CTXTS; ++i ) {
+    oo_udp_reasm_t* ctx = &ni->state->udp_reasm[i];
+    if( OO_PP_NOT_NULL(ctx->frags) ) {
+      CITP_STATS_NETIF_INC(ni, udp_reasm_abandoned);
+      oo_udp_reasm_flush_ctx(ni, ctx, 1);
+    }
+  }
+}
+
+
+/* All fragments are in hand: validate, convert to the jumbo-frame
+ * representation and deliver through the normal UDP demux. */
+static void oo_udp_reasm_deliver(ci_netif* ni, oo_udp_reasm_t* ctx)
+{
+  struct iovec iov[OO_UDP_REASM_MAX_FRAGS];
+  ci_ip_pkt_fmt* head = PKT_CHK(ni, ctx->frags);
+  ci_ip4_hdr* hip = oo_ip_hdr(head);
+  ci_udp_hdr* udp = (ci_udp_hdr*) ((char*) hip + CI_IP4_IHL(hip));
+  int total = ctx->total_bytes;
+  int n = 0, expected = 0, n_frags;
+  ci_ip_pkt_fmt* p;
+  oo_pkt_p pp;
+
+  /* The offset-sorted fragments must tile [0, total_bytes) exactly.  A
+   * hole can pair up with a stray fragment beyond the datagram length
+   * accepted while that length was still unknown; such a set sums to
+   * total_bytes without covering it. */
+  for( pp = ctx->frags; OO_PP_NOT_NULL(pp); pp = p->frag_next ) {
+    ci_ip4_hdr* pip;
+    int poff, ppay;
+    p = PKT_CHK(ni, pp);
+    pip = oo_ip_hdr(p);
+    poff = CI_IP4_FRAG_OFFSET(pip) * 8;
+    ppay = CI_BSWAP_BE16(pip->ip_tot_len_be16) - CI_IP4_IHL(pip);
+    if( poff != expected )
+      goto bad;
+    expected = poff + ppay;
+    if( poff == 0 ) {
+      iov[n].iov_base = udp + 1;
+      iov[n].iov_len = ppay - sizeof(ci_udp_hdr);
+    }
+    else {
+      iov[n].iov_base = (char*) pip + CI_IP4_IHL(pip);
+      iov[n].iov_len = ppay;
+    }
+    ++n;
+  }
+  ci_assert_equal(expected, total);
+
+  if( udp->udp_check_be16 != 0 &&
+      ci_udp_checksum(hip, udp, iov, n) != udp->udp_check_be16 )
+    goto bad;
+
+  /* Present the datagram as a jumbo frame: the head fragment keeps its
+   * headers, each later fragment's [buf] covers just its payload, and
+   * [frag_next] already links them in offset order. */
+  n_frags = n;
+  n = 0;
+  for( pp = ctx->frags; OO_PP_NOT_NULL(pp); pp = p->frag_next ) {
+    p = PKT_CHK(ni, pp);
+    p->n_buffers = n_frags - n;
+    if( n != 0 ) {
+      oo_offbuf_init(&p->buf, iov[n].iov_base, iov[n].iov_len);
+      p->buf_len = iov[n].iov_len;
+      CI_DEBUG(p->pay_len = -1);
+    }
+    ++n;
+  }
+  head->pay_len = oo_pre_l3_len(head) + CI_IP4_IHL(hip) + total;
+  hip->ip_tot_len_be16 = CI_BSWAP_BE16(CI_IP4_IHL(hip) + total);
+  hip->ip_frag_off_be16 = 0;
+  hip->ip_check_be16 = (ci_uint16) ci_ip_checksum(hip);
+
+  ctx->frags = OO_PP_NULL;
+  CITP_STATS_NETIF_INC(ni, udp_reasm_completed);
+  ci_udp_handle_rx(ni, head, udp, total);
+  CI_IPV4_STATS_INC_IN_DELIVERS(ni);
+  return;
+
+ bad:
+  CITP_STATS_NETIF_INC(ni, udp_reasm_bad);
+  oo_udp_reasm_flush_ctx(ni, ctx, 0);
+}
+
+
+/* Take one IPv4 UDP fragment into the reassembly engine.  The caller
+ * has validated the IP header and lengths; we always consume [pkt]. */
+static void handle_rx_udp_frag(ci_netif* ni, ci_ip_pkt_fmt* pkt,
+                               ci_ip4_hdr* ip, int hdr_size, int ip_tot_len)
+{
+  ci_uint64 now_frc = IPTIMER_STATE(ni)->frc;
+  int off = CI_IP4_FRAG_OFFSET(ip) * 8;
+  int pay = ip_tot_len - hdr_size;
+  int mf = (ip->ip_frag_off_be16 & CI_IP4_FRAG_MORE) != 0;
+  oo_udp_reasm_t* ctx = NULL;
+  oo_udp_reasm_t* free_ctx = NULL;
+  oo_pkt_p* prevp;
+  ci_ip_pkt_fmt* p;
+  int i;
+
+  CITP_STATS_NETIF_INC(ni, udp_rx_frags);
+  get_rx_timestamp(ni, pkt);
+  if( oo_tcpdump_check(ni, pkt, pkt->intf_i) )
+    oo_tcpdump_dump_pkt(ni, pkt);
+
+  oo_udp_reasm_expire(ni, now_frc);
+
+  /* Fragment payloads must be non-empty, a multiple of 8 bytes except
+   * at the tail, within the 64KiB datagram limit, and the first
+   * fragment must carry the whole UDP header. */
+  if( pay <= 0 || (mf && (pay & 7)) ||
+      (off == 0 && pay < (int) sizeof(ci_udp_hdr)) ||
+      off + pay > 0xffff )
+    goto bad_frag;
+
+  for( i = 0; i < OO_UDP_REASM_CTXTS; ++i ) {
+    oo_udp_reasm_t* c = &ni->state->udp_reasm[i];
+    if( OO_PP_IS_NULL(c->frags) )
+      free_ctx = c;
+    else if( c->saddr_be32 == ip->ip_saddr_be32 &&
+             c->daddr_be32 == ip->ip_daddr_be32 &&
+             c->ip_id_be16 == ip->ip_id_be16 )
+      ctx = c;
+  }
+  if( ctx == NULL ) {
+    if( free_ctx == NULL ) {
+      /* All contexts busy: evict the oldest to make room. */
+      free_ctx = &ni->state->udp_reasm[0];
+      for( i = 1; i < OO_UDP_REASM_CTXTS; ++i )
+        if( (ci_int64) (ni->state->udp_reasm[i].start_frc -
+                        free_ctx->start_frc) < 0 )
+          free_ctx = &ni->state->udp_reasm[i];
+      CITP_STATS_NETIF_INC(ni, udp_reasm_abandoned);
+      oo_udp_reasm_flush_ctx(ni, free_ctx, 1);
+    }
+    ctx = free_ctx;
+    ctx->start_frc = now_frc;
+    ctx->saddr_be32 = ip->ip_saddr_be32;
+    ctx->daddr_be32 = ip->ip_daddr_be32;
+    ctx->ip_id_be16 = ip->ip_id_be16;
+    ctx->got_bytes = 0;
+    ctx->total_bytes = -1;
+    ctx->n_frags = 0;
+  }
+
+  if( ! mf ) {
+    /* Last fragment fixes the datagram length. */
+    if( ctx->total_bytes >= 0 && ctx->total_bytes != off + pay )
+      goto bad_dgram;
+    ctx->total_bytes = off + pay;
+  }
+  else if( ctx->total_bytes >= 0 && off + pay > ctx->total_bytes )
+    goto bad_dgram;
+
+  if( ctx->n_frags >= OO_UDP_REASM_MAX_FRAGS )
+    goto bad_dgram;
+
+  /* Insert sorted by fragment offset; any overlap kills the datagram. */
+  prevp = &ctx->frags;
+  while( OO_PP_NOT_NULL(*prevp) ) {
+    ci_ip4_hdr* pip;
+    int poff, ppay;
+    p = PKT_CHK(ni, *prevp);
+    pip = oo_ip_hdr(p);
+    poff = CI_IP4_FRAG_OFFSET(pip) * 8;
+    ppay = CI_BSWAP_BE16(pip->ip_tot_len_be16) - CI_IP4_IHL(pip);
+    if( off < poff ) {
+      if( off + pay > poff )
+        goto bad_dgram;
+      break;
+    }
+    if( off < poff + ppay )
+      goto bad_dgram;
+    prevp = &p->frag_next;
+  }
+  pkt->frag_next = *prevp;
+  *prevp = OO_PKT_P(pkt);
+  ++ctx->n_frags;
+  ctx->got_bytes += pay;
+
+  if( ctx->total_bytes >= 0 && ctx->got_bytes == ctx->total_bytes )
+    oo_udp_reasm_deliver(ni, ctx);
+  return;
+
+ bad_dgram:
+  /* The datagram can no longer be completed: drop what we hold of it
+   * along with the new fragment. */
+  oo_udp_reasm_flush_ctx(ni, ctx, 0);
+ bad_frag:
+  CITP_STATS_NETIF_INC(ni, udp_reasm_bad);
+  CI_IPV4_STATS_INC_IN_DISCARDS(ni);
+  ci_netif_drop_sample(ni, CI_DROP_REASON_UDP, pkt->intf_i,
+                       PKT_START(pkt), pkt->pay_len);
+  ci_netif_pkt_release_rx_1ref(ni, pkt);
+}
+
+
+static int handle_rx_csum_bad(ci_netif* ni, struct ci_netif_poll_state* ps,
+                              ci_ip_pkt_fmt* pkt, int frame_len);
+
+
+/* VXLAN encapsulation header (RFC 7348). */
+typedef struct {
+  ci_uint8  flags;          /* CI_VXLAN_FLAG_VNI must be set */
+  ci_uint8  reserved1[3];
+  ci_uint8  vni[3];
+  ci_uint8  reserved2;
+} ci_vxlan_hdr;
+
+#define CI_VXLAN_FLAG_VNI  0x08
+
+
+/* EF_VXLAN_PORT: [pkt] is a UDP datagram to the configured VXLAN port.
+ * Strip the outer headers and demux the inner frame through the normal
+ * filter table, as if it had arrived bare.  Hardware only validated the
+ * outer checksum, so the inner frame goes via the software-verification
+ * path.  Returns true if the packet was consumed (delivered or dropped);
+ * false to fall through to ordinary UDP handling.
+ */
+static int handle_rx_vxlan(ci_netif* netif, struct ci_netif_poll_state* ps,
+                           ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp, int ip_paylen)
+{
+  ci_vxlan_hdr* vxh = (ci_vxlan_hdr*) (udp + 1);
+  int decap_bytes;
+
+  /* Scattered frames would need the inner headers pulled together; leave
+   * those to the normal UDP path. */
+  if( OO_PP_NOT_NULL(pkt->frag_next) )
+    return 0;
+  if( ip_paylen < sizeof(ci_udp_hdr) + sizeof(ci_vxlan_hdr) + ETH_HLEN )
+    return 0;
+  if( ! (vxh->flags & CI_VXLAN_FLAG_VNI) )
+    return 0;
+
+  /* Re-point the packet at the inner Ethernet frame (which may itself
+   * carry a VLAN tag). */
+  decap_bytes = (char*) (vxh + 1) - PKT_START(pkt);
+  pkt->pkt_start_off += decap_bytes;
+  pkt->pkt_eth_payload_off = PKT_START_OFF_BAD;
+  CITP_STATS_NETIF_INC(netif, rx_vxlan_decap);
+  if( ! handle_rx_csum_bad(netif, ps, pkt, pkt->pay_len - decap_bytes) )
+    ci_netif_pkt_release_rx_1ref(netif, pkt);
+  return 1;
+}
+
+
 static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
                           ci_ip_pkt_fmt* pkt)
 {
@@ -269,7 +634,7 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
   ci_assert_nequal(pkt->pkt_eth_payload_off, PKT_START_OFF_BAD);
 
 #if CI_CFG_RANDOM_DROP && !defined(__KERNEL__)
-  if( CI_UNLIKELY(rand() < NI_OPTS(netif).rx_drop_rate) )  goto drop;
+  if( CI_UNLIKELY(rand() < NI_HOT_OPTS(netif).rx_drop_rate) )  goto drop;
 #endif
 
   pkt->tstamp_frc = IPTIMER_STATE(netif)->frc;
@@ -341,6 +706,12 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
         return;
       }
       else if(CI_LIKELY( ip->ip_protocol == IPPROTO_UDP )) {
+        if( CI_UNLIKELY( netif->state->vxlan_port_be16 != 0 ) &&
+            ((ci_udp_hdr*) payload)->udp_dest_be16 ==
+                                          netif->state->vxlan_port_be16 &&
+            handle_rx_vxlan(netif, ps, pkt, (ci_udp_hdr*) payload,
+                            ip_paylen) )
+          return;
         ci_udp_handle_rx(netif, pkt, (ci_udp_hdr*) payload, ip_paylen);
         CI_IPV4_STATS_INC_IN_DELIVERS( netif );
         return;
@@ -349,6 +720,21 @@ static void handle_rx_pkt(ci_netif* netif, struct ci_netif_poll_state* ps,
       LOG_FL(unexpected_rx_log_flag(pkt),
              CI_RLLOG(10, LPF "IGNORE IP protocol=%d", (int) ip->ip_protocol));
     }
+    else if( NI_OPTS(netif).udp_rx_reassembly &&
+             ip->ip_protocol == IPPROTO_UDP &&
+             (ip->ip_frag_off_be16 &
+              (CI_IP4_OFFSET_MASK | CI_IP4_FRAG_MORE)) != 0 &&
+             hdr_size == sizeof(ci_ip4_hdr) &&
+             ip_tot_len >= hdr_size &&
+             ip_tot_len <= pkt->pay_len - oo_pre_l3_len(pkt) &&
+             OO_PP_IS_NULL(pkt->frag_next) &&
+             (~pkt->rx_flags & CI_PKT_RX_FLAG_RX_SHARED) ) {
+      /* A UDP fragment that hardware filters steered to us (e.g. under
+       * scalable filters): reassemble it in the stack rather than
+       * handing it straight to the kernel. */
+      handle_rx_udp_frag(netif, pkt, ip, hdr_size, ip_tot_len);
+      return;
+    }
     else if( ~pkt->rx_flags & CI_PKT_RX_FLAG_RX_SHARED ) {
       /*! \todo IP slow path.  Don't want to deal with this yet.
        * 
@@ -593,7 +979,7 @@ int ci_netif_evq_poll(ci_netif* ni, int intf_i)
   ef_vi* evq = ci_netif_vi(ni, intf_i);
   int n_evs;
   size_t evs_per_poll = ef_vi_flags(evq) & EF_VI_RX_EVENT_MERGE ?
-                NI_OPTS(ni).evs_per_poll / 4 : NI_OPTS(ni).evs_per_poll;
+                NI_HOT_OPTS(ni).evs_per_poll / 4 : NI_HOT_OPTS(ni).evs_per_poll;
 #if CI_CFG_WANT_BPF_NATIVE && CI_HAVE_BPF_NATIVE
   ef_event *ev = ni->state->events;
 #endif
@@ -629,7 +1015,7 @@ int ci_netif_evq_poll(ci_netif* ni, int intf_i)
   n_evs = convert_efct_to_pkts(ni, intf_i, ni->state->events, n_evs);
 
 #if CI_CFG_WANT_BPF_NATIVE && CI_HAVE_BPF_NATIVE
-  if( NI_OPTS(ni).xdp_mode == 0 )
+  if( ! (NI_HOT_OPTS(ni).flags & CI_NETIF_HOT_XDP) )
     return n_evs;
 
   {
@@ -679,7 +1065,7 @@ int ci_netif_evq_poll(ci_netif* ni, int intf_i)
 #if CI_HAVE_BPF_NATIVE
 ci_inline int oo_xdp_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
 {
-  if( NI_OPTS(ni).xdp_mode != 0 &&
+  if( (NI_HOT_OPTS(ni).flags & CI_NETIF_HOT_XDP) &&
       ! efab_tcp_helper_xdp_rx_pkt(netif2tcp_helper_resource(ni), *pkt) ) {
     /* just drop */
     (*pkt)->flags &= ~CI_PKT_FLAG_XDP_DROP;
@@ -697,7 +1083,7 @@ ci_inline int oo_xdp_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
 #if ! defined(__KERNEL__) && CI_CFG_WANT_BPF_NATIVE
 ci_inline int oo_xdp_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
 {
-  if( NI_OPTS(ni).xdp_mode != 0 &&
+  if( (NI_HOT_OPTS(ni).flags & CI_NETIF_HOT_XDP) &&
       ((*pkt)->flags & CI_PKT_FLAG_XDP_DROP) ) {
     /* just drop */
     (*pkt)->flags &= ~CI_PKT_FLAG_XDP_DROP;
@@ -716,6 +1102,106 @@ ci_inline int oo_xdp_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
 #endif
 
 
+#ifndef __KERNEL__
+/* Process-wide early RX filter installed via onload_rx_prefilter_set().
+ * Only polls performed by this process run the filter; polls by the
+ * kernel, or by other processes sharing the stack, deliver packets
+ * unfiltered.
+ */
+static oo_rx_prefilter_fn oo_rx_prefilter;
+static void* oo_rx_prefilter_arg;
+
+void oo_rx_prefilter_set(oo_rx_prefilter_fn fn, void* arg)
+{
+  oo_rx_prefilter_arg = arg;
+  ci_wmb();
+  oo_rx_prefilter = fn;
+}
+
+ci_inline int oo_rx_prefilter_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
+{
+  if(CI_UNLIKELY( oo_rx_prefilter != NULL ) &&
+     oo_rx_prefilter(oo_rx_prefilter_arg, PKT_START(*pkt),
+                     (*pkt)->pay_len) != 0 ) {
+    CITP_STATS_NETIF_INC(ni, rx_prefilter_dropped);
+    ci_netif_pkt_release_rx_1ref(ni, *pkt);
+    *pkt = NULL;
+    return 0;
+  }
+  return 1;
+}
+/* A/B feed arbiter installed via onload_feed_arbiter_set().  Both arms
+ * of a redundant multicast feed are delivered to this stack (typically
+ * one VI per NIC); the app-supplied extractor recovers the feed sequence
+ * number and the arbiter forwards the first copy of each sequence,
+ * dropping the loser arm's duplicate before it touches socket receive
+ * queues.  Like the prefilter, only polls performed by this process
+ * arbitrate, so the app must still tolerate the odd duplicate.
+ */
+static oo_feed_seq_fn oo_feed_seq_extract;
+static void* oo_feed_seq_arg;
+static int oo_feed_started;
+static ci_uint64 oo_feed_expected_seq;
+static ci_uint64 oo_feed_wins[CI_CFG_MAX_INTERFACES];
+static ci_uint64 oo_feed_dups;
+static ci_uint64 oo_feed_gaps;
+
+void oo_feed_arbiter_set(oo_feed_seq_fn fn, void* arg)
+{
+  oo_feed_seq_arg = arg;
+  oo_feed_started = 0;
+  ci_wmb();
+  oo_feed_seq_extract = fn;
+}
+
+void oo_feed_arbiter_get_stats(ci_uint64* wins, int n_arms,
+                               ci_uint64* dups, ci_uint64* gaps)
+{
+  int i;
+  for( i = 0; i < n_arms && i < CI_CFG_MAX_INTERFACES; ++i )
+    wins[i] = oo_feed_wins[i];
+  *dups = oo_feed_dups;
+  *gaps = oo_feed_gaps;
+}
+
+ci_inline int oo_feed_arbiter_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
+{
+  ci_uint64 seq;
+  if(CI_LIKELY( oo_feed_seq_extract == NULL ))
+    return 1;
+  if( oo_feed_seq_extract(oo_feed_seq_arg, PKT_START(*pkt),
+                          (*pkt)->pay_len, &seq) != 0 )
+    return 1;  /* not a feed packet; deliver normally */
+  if( oo_feed_started ) {
+    if( seq < oo_feed_expected_seq ) {
+      /* The other arm won this sequence number. */
+      ++oo_feed_dups;
+      CITP_STATS_NETIF_INC(ni, rx_feed_dup_dropped);
+      ci_netif_pkt_release_rx_1ref(ni, *pkt);
+      *pkt = NULL;
+      return 0;
+    }
+    if( seq != oo_feed_expected_seq )
+      ++oo_feed_gaps;
+  }
+  oo_feed_started = 1;
+  oo_feed_expected_seq = seq + 1;
+  ++oo_feed_wins[(*pkt)->intf_i];
+  return 1;
+}
+#else
+ci_inline int oo_rx_prefilter_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
+{
+  return 1;
+}
+
+ci_inline int oo_feed_arbiter_check_pkt(ci_netif* ni, ci_ip_pkt_fmt** pkt)
+{
+  return 1;
+}
+#endif
+
+
 ci_inline void __handle_rx_pkt(ci_netif* ni, struct ci_netif_poll_state* ps,
                                ci_ip_pkt_fmt** pkt)
 {
@@ -726,7 +1212,8 @@ ci_inline void __handle_rx_pkt(ci_netif* ni, struct ci_netif_poll_state* ps,
       return;
     }
 #endif
-    if( oo_xdp_check_pkt(ni, pkt) ) {
+    if( oo_rx_prefilter_check_pkt(ni, pkt) && oo_xdp_check_pkt(ni, pkt) &&
+        oo_feed_arbiter_check_pkt(ni, pkt) ) {
       ci_parse_rx_vlan(*pkt);
       handle_rx_pkt(ni, ps, *pkt);
     }
@@ -748,7 +1235,7 @@ ci_inline int handle_rx_pre_future(ci_netif* ni, ci_ip_pkt_fmt* pkt,
   int valid_bytes = CI_CACHE_LINE_SIZE - pkt->pkt_start_off;
 
 #if CI_CFG_RANDOM_DROP && !defined(__KERNEL__)
-  if(CI_UNLIKELY( rand() < NI_OPTS(ni).rx_drop_rate )) {
+  if(CI_UNLIKELY( rand() < NI_HOT_OPTS(ni).rx_drop_rate )) {
     LOG_NR(log(LPF "DROP"));
     LOG_DR(ci_hex_dump(ci_log_fn, pkt, 40, 0));
     return FUTURE_DROP;
@@ -1165,6 +1652,39 @@ drop:
 }
 
 
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+static int ci_drop_reason_from_discard(int discard_type)
+{
+  switch( discard_type ) {
+  case EF_EVENT_RX_DISCARD_CSUM_BAD:
+  case EF_EVENT_RX_DISCARD_INNER_CSUM_BAD:
+    return CI_DROP_REASON_CSUM_BAD;
+  case EF_EVENT_RX_DISCARD_CRC_BAD:
+    return CI_DROP_REASON_CRC_BAD;
+  case EF_EVENT_RX_DISCARD_TRUNC:
+    return CI_DROP_REASON_TRUNC;
+  case EF_EVENT_RX_DISCARD_MCAST_MISMATCH:
+    return CI_DROP_REASON_MCAST_MISMATCH;
+  default:
+    return CI_DROP_REASON_HW_OTHER;
+  }
+}
+
+
+static int ci_drop_reason_from_discard_flags(unsigned discard_flags)
+{
+  if( discard_flags & EF_VI_DISCARD_RX_ETH_LEN_ERR )
+    return CI_DROP_REASON_TRUNC;
+  if( discard_flags & EF_VI_DISCARD_RX_ETH_FCS_ERR )
+    return CI_DROP_REASON_CRC_BAD;
+  if( discard_flags & (EF_VI_DISCARD_RX_L3_CSUM_ERR |
+                       EF_VI_DISCARD_RX_L4_CSUM_ERR) )
+    return CI_DROP_REASON_CSUM_BAD;
+  return CI_DROP_REASON_HW_OTHER;
+}
+#endif
+
+
 static void discard_rx_multi_pkts(ci_netif* ni, struct ci_netif_poll_state* ps,
                                   int intf_i, struct oo_rx_state* s,
                                   int frame_len, unsigned discard_flags,
@@ -1209,6 +1729,10 @@ static void discard_rx_multi_pkts(ci_netif* ni, struct ci_netif_poll_state* ps,
     CITP_STATS_NETIF_INC(ni, rx_discard_other);
 
   if( !handled ) {
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+    ci_netif_drop_sample(ni, ci_drop_reason_from_discard_flags(discard_flags),
+                         intf_i, PKT_START(pkt), frame_len);
+#endif
     if( oo_tcpdump_check(ni, pkt, pkt->intf_i) ) {
         pkt->pay_len = frame_len;
         oo_tcpdump_dump_pkt(ni, pkt);
@@ -1411,6 +1935,10 @@ static void __handle_rx_discard(ci_netif* ni, struct ci_netif_poll_state* ps,
   }
 
   if( !handled ) {
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+    ci_netif_drop_sample(ni, ci_drop_reason_from_discard(discard_type),
+                         intf_i, PKT_START(pkt), frame_len);
+#endif
     /* Only dump the packet if the NIC actually delivered it */
     if( (discard_type == EF_EVENT_RX_DISCARD_CSUM_BAD ||
          discard_type == EF_EVENT_RX_DISCARD_MCAST_MISMATCH ||
@@ -1467,13 +1995,70 @@ static void ci_sock_put_on_reap_list(ci_netif* ni, ci_sock_cmn* s)
 }
 
 
+/* onload_socket_watermarks_set(): compare the registered sockets' queue
+ * depths and the stack's free packet pool against their thresholds.  A
+ * socket crossing a threshold has the corresponding bit set in wm_fired
+ * and is woken, so pollers blocked on it return and can query the
+ * pressure flags.  Bits stay set until the app clears them with
+ * onload_socket_watermarks_query(), which throttles repeat wakeups to
+ * the app's query cadence.  Called once per poll, after in_poll drops.
+ */
+static void ci_netif_mem_watermark_check(ci_netif* ni)
+{
+  ci_int32 pool_free = ni->packets->n_free;
+  struct oo_p_dllink_state list = oo_p_dllink_ptr(ni,
+                                          &ni->state->mem_watermark_socks);
+  struct oo_p_dllink_state lnk, tmp;
+
+  oo_p_dllink_for_each_safe(ni, lnk, tmp, list) {
+    ci_sock_cmn* s = CI_CONTAINER(ci_sock_cmn, wm_link, lnk.l);
+    ci_uint32 fired = 0;
+
+    if( s->wm_pool_free_pkts != 0 &&
+        pool_free < (ci_int32) s->wm_pool_free_pkts )
+      fired |= CI_SOCK_WM_POOL;
+    if( s->b.state & CI_TCP_STATE_TCP_CONN ) {
+      ci_tcp_state* ts = SOCK_TO_TCP(s);
+      if( s->wm_sendq_pkts != 0 &&
+          (ci_uint32) (ts->send.num + ts->retrans.num) > s->wm_sendq_pkts )
+        fired |= CI_SOCK_WM_SENDQ;
+      if( s->wm_rcvq_pkts != 0 &&
+          (ci_uint32) (ts->recv1.num + ts->recv2.num) > s->wm_rcvq_pkts )
+        fired |= CI_SOCK_WM_RCVQ;
+    }
+    else if( s->b.state == CI_TCP_STATE_UDP ) {
+      ci_udp_state* us = SOCK_TO_UDP(s);
+      if( s->wm_rcvq_pkts != 0 &&
+          us->recv_q.pkts_added - us->recv_q.pkts_reaped > s->wm_rcvq_pkts )
+        fired |= CI_SOCK_WM_RCVQ;
+    }
+
+    if( (fired & ~s->wm_fired) != 0 ) {
+      s->wm_fired |= fired;
+      citp_waitable_wake_possibly_not_in_poll(ni, &s->b,
+                                              CI_SB_FLAG_WAKE_RX |
+                                              CI_SB_FLAG_WAKE_TX);
+    }
+  }
+}
+
+
+/* Sockets on [post_poll_list] are gathered into an on-stack array of this
+ * size and processed a batch at a time.  Walking the list only touches the
+ * link words, so each waitable can be prefetched as it is gathered and the
+ * processing pass avoids a chain of dependent cache misses through shared
+ * state.
+ */
+#define CI_NETIF_POST_POLL_BATCH  32
+
 static void process_post_poll_list(ci_netif* ni)
 {
   struct oo_p_dllink_state lnk;
-  struct oo_p_dllink_state tmp_lnk;
   struct oo_p_dllink_state post_poll_list =
                            oo_p_dllink_ptr(ni, &ni->state->post_poll_list);
+  citp_waitable* batch[CI_NETIF_POST_POLL_BATCH];
   int need_wake = 0;
+  int n_batch, b;
   citp_waitable* sb;
 #if CI_CFG_EPOLL3
   int lists_need_wake = 0;
@@ -1481,66 +2066,103 @@ static void process_post_poll_list(ci_netif* ni)
 #if CI_CFG_EPOLL3 || defined(__KERNEL__)
   int i = 0;
 #endif
-
-  oo_p_dllink_for_each_safe(ni, lnk, tmp_lnk, post_poll_list) {
-#ifdef __KERNEL__
-    if(CI_UNLIKELY( i++ > ni->ep_tbl_n )) {
-      ci_netif_error_detected(ni, CI_NETIF_ERROR_POST_POLL_LIST, __FUNCTION__);
-      return;
-    }
+#ifndef __KERNEL__
+  int n_edges = 0;
 #endif
 
-    sb = CI_CONTAINER(citp_waitable, post_poll_link, lnk.l);
+  CITP_STATS_NETIF_INC(ni, post_poll_drains);
 
-    if( sb->sb_flags & CI_SB_FLAG_TCP_POST_POLL )
-      ci_tcp_rx_post_poll(ni, CI_CONTAINER(ci_tcp_state, s.b, sb));
-    if( sb->sb_flags & CI_SB_FLAG_RX_DELIVERED )
-      ci_sock_put_on_reap_list(ni, CI_CONTAINER(ci_sock_cmn, b, sb));
+  /* Publish this poll's batch of promoted sockets (and set the listener's
+   * wake flag) before the wakeups below are delivered. */
+  if( OO_SP_NOT_NULL(ni->state->promote_batch_listener) )
+    ci_tcp_acceptq_flush_batch(ni);
 
-    if( sb->sb_flags ) {
-      if( sb->sb_flags & CI_SB_FLAG_WAKE_RX )
-        ++sb->sleep_seq.rw.rx;
-      if( sb->sb_flags & CI_SB_FLAG_WAKE_TX )
-        ++sb->sleep_seq.rw.tx;
-      ci_mb();
+  lnk = oo_p_dllink_statep(ni, post_poll_list.l->next);
+
+  while( lnk.l != post_poll_list.l ) {
+    /* Gather a batch of waitables, issuing prefetches as we go.  The
+     * gather pass also takes us off the list's pointer chain: entries the
+     * processing pass removes or re-queues cannot invalidate our cursor,
+     * which has already moved beyond the batch.
+     */
+    n_batch = 0;
+    do {
+#ifdef __KERNEL__
+      if(CI_UNLIKELY( i++ > ni->ep_tbl_n )) {
+        ci_netif_error_detected(ni, CI_NETIF_ERROR_POST_POLL_LIST,
+                                __FUNCTION__);
+        return;
+      }
+#endif
+      sb = CI_CONTAINER(citp_waitable, post_poll_link, lnk.l);
+      ci_prefetch(sb);
+      batch[n_batch++] = sb;
+      lnk = oo_p_dllink_statep(ni, lnk.l->next);
+    } while( lnk.l != post_poll_list.l &&
+             n_batch < CI_NETIF_POST_POLL_BATCH );
+
+    CITP_STATS_NETIF_ADD(ni, post_poll_socks, n_batch);
+
+    for( b = 0; b < n_batch; ++b ) {
+      sb = batch[b];
+      if( b + 1 < n_batch )
+        ci_prefetch(batch[b + 1]);
+
+      if( sb->sb_flags & CI_SB_FLAG_TCP_POST_POLL )
+        ci_tcp_rx_post_poll(ni, CI_CONTAINER(ci_tcp_state, s.b, sb));
+      if( sb->sb_flags & CI_SB_FLAG_RX_DELIVERED )
+        ci_sock_put_on_reap_list(ni, CI_CONTAINER(ci_sock_cmn, b, sb));
+
+      if( sb->sb_flags ) {
+        if( sb->sb_flags & CI_SB_FLAG_WAKE_RX )
+          ++sb->sleep_seq.rw.rx;
+        if( sb->sb_flags & CI_SB_FLAG_WAKE_TX )
+          ++sb->sleep_seq.rw.tx;
+        ci_mb();
+
+#ifndef __KERNEL__
+        n_edges += !! (sb->sb_flags & (CI_SB_FLAG_WAKE_RX |
+                                       CI_SB_FLAG_WAKE_TX));
+#endif
 
 #if CI_CFG_EPOLL3
-      lists_need_wake |= sb->ready_lists_in_use;
+        lists_need_wake |= sb->ready_lists_in_use;
 #endif
 
-      if( ! (sb->sb_flags & sb->wake_request) ) {
-        sb->sb_flags = 0;
-      }
-      else {
-#ifdef __KERNEL__
-        /* In realtime kernel, citp_waitable_wakeup() from NAPI context is
-         * harmful */
-        if( !((ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT) && 
-              oo_avoid_wakeup_from_dl()) ) {
-          citp_waitable_wakeup(ni, sb);
+        if( ! (sb->sb_flags & sb->wake_request) ) {
+          sb->sb_flags = 0;
         }
-        else
-#endif
-        {
-          /* Leave endpoints that need waking on the post-poll list so they can
-           * be woken in the driver with a single syscall when we drop the
-           * lock.
-           */
-          /* NB. Important to leave [sb_flags] set here, as we may run
-           * process_post_poll_list() multiple times before dropping the
-           * lock.  If we cleared [sb_flags] this endpoint could be dropped
-           * from the list.
-           */
-          need_wake = 1;
-          continue;
+        else {
+#ifdef __KERNEL__
+          /* In realtime kernel, citp_waitable_wakeup() from NAPI context is
+           * harmful */
+          if( !((ni->flags & CI_NETIF_FLAG_IN_DL_CONTEXT) &&
+                oo_avoid_wakeup_from_dl()) ) {
+            citp_waitable_wakeup(ni, sb);
+          }
+          else
+#endif
+          {
+            /* Leave endpoints that need waking on the post-poll list so
+             * they can be woken in the driver with a single syscall when we
+             * drop the lock.
+             */
+            /* NB. Important to leave [sb_flags] set here, as we may run
+             * process_post_poll_list() multiple times before dropping the
+             * lock.  If we cleared [sb_flags] this endpoint could be dropped
+             * from the list.
+             */
+            need_wake = 1;
+            continue;
+          }
         }
       }
-    }
 
-    /* If there is no reason to keep the socket in the list (see above),
-     * then we can remove it now.
-     */
-    oo_p_dllink_del_init(ni, lnk);
+      /* If there is no reason to keep the socket in the list (see above),
+       * then we can remove it now.
+       */
+      oo_p_dllink_del_init(ni, oo_p_dllink_sb(ni, sb, &sb->post_poll_link));
+    }
   }
 
   CHECK_NI(ni);
@@ -1567,6 +2189,17 @@ static void process_post_poll_list(ci_netif* ni)
   if( need_wake )
     ef_eplock_holder_set_flag(&ni->state->lock, CI_EPLOCK_NETIF_NEED_WAKE);
 
+#ifndef __KERNEL__
+  /* Tell an attached eventfd bridge about this batch of readiness edges:
+   * one write for the whole batch, adding the number of endpoints that
+   * became ready to the eventfd counter.  Endpoint-level detail stays in
+   * shared state (ready lists, or the EF_RX_ORDER_TAP ring). */
+  if(CI_UNLIKELY( ni->eventfd_bridge >= 0 && n_edges != 0 )) {
+    ci_uint64 v = n_edges;
+    (void) ci_sys_write(ni->eventfd_bridge, &v, sizeof(v));
+  }
+#endif
+
 #if CI_CFG_EPOLL3
 #ifdef __KERNEL__
   /* Check whether any ready lists associated with a set need to be woken.
@@ -1716,7 +2349,7 @@ ci_inline void __ci_netif_tx_pkt_complete(ci_netif* ni,
 #if CI_CFG_TIMESTAMPING
   if( pkt->flags & CI_PKT_FLAG_TX_TIMESTAMPED ) {
     if( ev != NULL && EF_EVENT_TYPE(*ev) == EF_EVENT_TYPE_TX_WITH_TIMESTAMP ) {
-      int opt_tsf = ((NI_OPTS(ni).timestamping_reporting) &
+      int opt_tsf = ((NI_HOT_OPTS(ni).timestamping_reporting) &
                      CITP_TIMESTAMPING_RECORDING_FLAG_CHECK_SYNC) ?
                     EF_VI_SYNC_FLAG_CLOCK_IN_SYNC :
                     EF_VI_SYNC_FLAG_CLOCK_SET;
@@ -1779,8 +2412,35 @@ void ci_netif_tx_pkt_complete(ci_netif* ni, struct ci_netif_poll_state* ps,
   __ci_netif_tx_pkt_complete(ni, ps, pkt, NULL);
 }
 
-static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
-                             int intf_i, int n_evs)
+ci_inline void handle_rx_ref_ev(ci_netif* ni, struct ci_netif_poll_state* ps,
+                                int intf_i, ef_vi* evq, struct oo_rx_state* s,
+                                const ef_event* ev)
+{
+  int pay_len = ev->rx_ref.len;
+  ci_ip_pkt_fmt* pkt;
+  CITP_STATS_NETIF_INC(ni, rx_evs);
+  pkt = alloc_rx_efct_pkt(ni, intf_i, pay_len);
+  if( pkt ) {
+    __handle_rx_pkt(ni, ps, &s->rx_pkt);
+    copy_efct_to_pkt(ni, evq, ev->rx_ref.pkt_id, pkt);
+    oo_offbuf_init(&pkt->buf, pkt->dma_start, pay_len);
+    s->rx_pkt = pkt;
+  }
+  efct_vi_rxpkt_release(evq, ev->rx_ref.pkt_id);
+}
+
+
+/* The guts of the event loop, instantiated once per NIC architecture (see
+ * the wrappers below).  [arch] must be a compile-time constant so that
+ * per-event branches on the architecture fold away, and so that each
+ * instantiation's branches get their own predictor history.  Every variant
+ * handles the full set of event types: poll-in-kernel mode can rewrite
+ * events (e.g. RX_REF to RX), so excluding types by architecture would not
+ * be safe. */
+__attribute__((always_inline))
+static inline int __ci_netif_poll_evq(ci_netif* ni,
+                                      struct ci_netif_poll_state* ps,
+                                      int intf_i, int n_evs, const int arch)
 {
   struct oo_rx_state s;
   ef_vi* evq = ci_netif_vi(ni, intf_i);
@@ -1832,6 +2492,9 @@ static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
       break;
 
 have_events:
+#if CI_CFG_TIMESTAMPING
+    ci_netif_rx_tsync_refresh(ni, intf_i);
+#endif
     /* This loop is implemented with a 1 packet lag on processing (i.e.
      * __handle_rx_pkt() is called for the packet from the previous loop
      * iteration just as the next packet is being picked up, due to a
@@ -1839,19 +2502,32 @@ have_events:
      * relevant cache lines from L3. */
     s.rx_pkt = NULL;
     for( i = 0; i < n_evs; ++i ) {
-      /* Look for RX events first to minimise latency. */
-      if( EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_RX ) {
+      /* Look for RX events first to minimise latency.  On EFCT those are
+       * RX_REF events (unless poll-in-kernel has rewritten them). */
+      if( arch == EF_VI_ARCH_EFCT &&
+          EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_RX_REF ) {
+        handle_rx_ref_ev(ni, ps, intf_i, evq, &s, &ev[i]);
+      }
+
+      else if( EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_RX ) {
         CITP_STATS_NETIF_INC(ni, rx_evs);
         OO_PP_INIT(ni, pp, EF_EVENT_RX_RQ_ID(ev[i]));
         pkt = PKT_CHK(ni, pp);
         /* AF_XDP has potentially variable offset and this is taken it into account here,
          * but we shouldn't touch pkt_start_off for ef10 case as it is used to calculate
          * pkt_eth_payload_off properly. */
-        if( evq->nic_type.arch == EF_VI_ARCH_AF_XDP ) {
+        if( arch == EF_VI_ARCH_AF_XDP ) {
           pkt->pkt_start_off = ev[i].rx.ofs -
                                CI_MEMBER_OFFSET(ci_ip_pkt_fmt, dma_start);
         }
         ci_assert_equal(pkt->intf_i, intf_i);
+        /* Prefetch the socket this packet's NIC flow hash last demuxed
+         * to, one event ahead: __handle_rx_pkt() below still processes
+         * the previous iteration's packet, hiding the socket-state miss
+         * under that work. */
+        if( NI_OPTS(ni).rx_flow_hint && evq->rx_prefix_len != 0 &&
+            (ev[i].rx.flags & EF_EVENT_FLAG_SOP) )
+          ci_netif_rx_nic_hint_prefetch(ni, evq, pkt);
         __handle_rx_pkt(ni, ps, &s.rx_pkt);
         if( (ev[i].rx.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT))
                                                        == EF_EVENT_FLAG_SOP ) {
@@ -1867,17 +2543,9 @@ have_events:
         }
       }
 
-      else if( EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_RX_REF ) {
-        int pay_len = ev[i].rx_ref.len;
-        CITP_STATS_NETIF_INC(ni, rx_evs);
-        pkt = alloc_rx_efct_pkt(ni, intf_i, pay_len);
-        if( pkt ) {
-          __handle_rx_pkt(ni, ps, &s.rx_pkt);
-          copy_efct_to_pkt(ni, evq, ev[i].rx_ref.pkt_id, pkt);
-          oo_offbuf_init(&pkt->buf, pkt->dma_start, pay_len);
-          s.rx_pkt = pkt;
-        }
-        efct_vi_rxpkt_release(evq, ev[i].rx_ref.pkt_id);
+      else if( arch != EF_VI_ARCH_EFCT &&
+               EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_RX_REF ) {
+        handle_rx_ref_ev(ni, ps, intf_i, evq, &s, &ev[i]);
       }
 
       else if(CI_LIKELY( EF_EVENT_TYPE(ev[i]) == EF_EVENT_TYPE_TX )) {
@@ -1912,6 +2580,9 @@ have_events:
           ci_prefetch_ppc(pkt->dma_start);
           ci_prefetch_ppc(pkt);
           ci_assert_equal(pkt->intf_i, intf_i);
+          if( NI_OPTS(ni).rx_flow_hint && vi->rx_prefix_len != 0 &&
+              (ev[i].rx_multi.flags & EF_EVENT_FLAG_SOP) )
+            ci_netif_rx_nic_hint_prefetch(ni, vi, pkt);
           __handle_rx_pkt(ni, ps, &s.rx_pkt);
           if( (ev[i].rx_multi.flags & (EF_EVENT_FLAG_SOP | EF_EVENT_FLAG_CONT))
                == EF_EVENT_FLAG_SOP ) {
@@ -2009,7 +2680,7 @@ have_events:
     }
 
 #ifndef NDEBUG
-    if( CI_NETIF_TX_VI(ni, intf_i, 0)->nic_type.arch != EF_VI_ARCH_AF_XDP ) {
+    if( arch != EF_VI_ARCH_AF_XDP ) {
       int vi_i;
       int txq_level = 0;
       for( vi_i = 0; vi_i < ci_netif_num_vis(ni); ++vi_i)
@@ -2024,7 +2695,7 @@ have_events:
     __handle_rx_pkt(ni, ps, &s.rx_pkt);
 
     total_evs += n_evs;
-  } while( total_evs < NI_OPTS(ni).evs_per_poll );
+  } while( total_evs < NI_HOT_OPTS(ni).evs_per_poll );
 
   /* If we've drained the TXQ, we can start trying CTPIO again. */
   if( completed_tx &&
@@ -2040,9 +2711,134 @@ have_events:
 }
 
 
+/* Specialized instantiations of the event loop.  These must not be merged
+ * by the compiler, or the point of having them (constant-folded feature
+ * branches and separate branch-predictor state) is lost. */
+static int ci_netif_poll_evq_dma(ci_netif* ni, struct ci_netif_poll_state* ps,
+                                 int intf_i, int n_evs)
+{
+  return __ci_netif_poll_evq(ni, ps, intf_i, n_evs, EF_VI_ARCH_EF10);
+}
+
+
+static int ci_netif_poll_evq_efct(ci_netif* ni, struct ci_netif_poll_state* ps,
+                                  int intf_i, int n_evs)
+{
+  return __ci_netif_poll_evq(ni, ps, intf_i, n_evs, EF_VI_ARCH_EFCT);
+}
+
+
+static int ci_netif_poll_evq_af_xdp(ci_netif* ni,
+                                    struct ci_netif_poll_state* ps,
+                                    int intf_i, int n_evs)
+{
+  return __ci_netif_poll_evq(ni, ps, intf_i, n_evs, EF_VI_ARCH_AF_XDP);
+}
+
+
+static int ci_netif_poll_evq(ci_netif* ni, struct ci_netif_poll_state* ps,
+                             int intf_i, int n_evs)
+{
+  /* One well-predicted branch per poll selects the variant, instead of
+   * feature branches on every event.  The architecture is fixed for the
+   * lifetime of the VI, so this always goes the same way for a given
+   * stack and interface. */
+  switch( ci_netif_vi(ni, intf_i)->nic_type.arch ) {
+  case EF_VI_ARCH_EFCT:
+    return ci_netif_poll_evq_efct(ni, ps, intf_i, n_evs);
+  case EF_VI_ARCH_AF_XDP:
+    return ci_netif_poll_evq_af_xdp(ni, ps, intf_i, n_evs);
+  default:
+    /* EF10-like architectures with DMA delivery into packet buffers. */
+    return ci_netif_poll_evq_dma(ni, ps, intf_i, n_evs);
+  }
+}
+
+
+/* Account [prev_frc]..now to [phase] of the poll profile and return the
+** new timestamp, which the caller uses as the start of the next phase. */
+static ci_uint64 ci_netif_poll_profile_stamp(ci_netif* ni, int phase,
+                                             ci_uint64 prev_frc)
+{
+  ci_netif_state* ns = ni->state;
+  ci_uint64 now_frc, delta;
+
+  ci_frc64(&now_frc);
+  delta = now_frc - prev_frc;
+  ns->poll_profile[phase].cycles += delta;
+  if( delta > ns->poll_profile[phase].max_cycles )
+    ns->poll_profile[phase].max_cycles = delta;
+  ++ns->poll_profile[phase].n;
+  return now_frc;
+}
+
+
+/* Returns true if the high-watermark option is enabled and [intf_i]'s
+ * event queue still holds at least that many events.  Called only once a
+ * poll's budget is exhausted.  Overflowing an event queue is fatal to the
+ * stack, so when we are this far behind we drain past the budget, and arm
+ * interrupts on unlock so that the kernel polls the stack if the
+ * application stops calling in (eg. it stalls in a GC pause).
+ */
+static int ci_netif_evq_above_watermark(ci_netif* ni, int intf_i)
+{
+  unsigned watermark = NI_HOT_OPTS(ni).evq_high_watermark;
+  if(CI_LIKELY( watermark == 0 ||
+                ! ef_eventq_has_many_events(ci_netif_vi(ni, intf_i),
+                                            watermark) ))
+    return 0;
+  CITP_STATS_NETIF_INC(ni, evq_watermark_drains);
+  ef_eplock_holder_set_flag(&ni->state->lock, CI_EPLOCK_NETIF_NEED_PRIME);
+  return 1;
+}
+
+
+/* Post-poll RX ring refill.  By default every poll that leaves at least
+ * one batch of space triggers a refill, which keeps the ring as full as
+ * possible but scatters small descriptor writes across polls.  With
+ * EF_RX_REFILL_ADAPTIVE we instead let the deficit build up to roughly
+ * the drain observed over recent refill cycles - tracked as an EMA - and
+ * then post the whole stretch in one go, so descriptor writes batch into
+ * contiguous runs of the ring.  The deferral is abandoned whenever the
+ * fill level drops below half of rxq_limit, so the hysteresis can never
+ * run the ring dry.
+ */
+static void ci_netif_rx_refill_epilogue(ci_netif* ni, int intf_i)
+{
+  ci_netif_state_nic_t* nsn = &ni->state->nic[intf_i];
+  ef_vi* vi = ci_netif_vi(ni, intf_i);
+  int deficit, thresh;
+
+  if(CI_LIKELY( ! NI_OPTS(ni).rx_refill_adaptive )) {
+    ci_netif_rx_post_all_batch(ni, intf_i);
+    return;
+  }
+
+  deficit = ci_netif_rx_vi_space(ni, vi);
+  thresh = nsn->rx_refill_ema;
+  if( thresh < CI_CFG_RX_DESC_BATCH )
+    thresh = CI_CFG_RX_DESC_BATCH;
+  if( thresh > (int) ni->state->rxq_limit / 4 )
+    thresh = ni->state->rxq_limit / 4;
+
+  if( deficit < thresh &&
+      ef_vi_receive_fill_level(vi) > (int) ni->state->rxq_limit / 2 ) {
+    CITP_STATS_NETIF_INC(ni, rx_refill_deferred);
+    return;
+  }
+
+  /* Fold the deficit accumulated over this refill cycle into the
+   * drain-rate estimate; alpha = 1/4. */
+  nsn->rx_refill_ema += (deficit - (int) nsn->rx_refill_ema) / 4;
+  ci_netif_rx_post_all_batch(ni, intf_i);
+}
+
+
 static int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
 {
   struct ci_netif_poll_state ps;
+  int profile = NI_HOT_OPTS(ni).flags & CI_NETIF_HOT_POLL_PROFILE;
+  ci_uint64 profile_frc = 0;
   int total_evs = 0;
   int rc;
 
@@ -2055,15 +2851,28 @@ static int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
   ps.tx_pkt_free_list_insert = &ps.tx_pkt_free_list;
   ps.tx_pkt_free_list_n = 0;
 
+  if( profile )
+    ci_frc64(&profile_frc);
+
   do {
     rc = ci_netif_poll_evq(ni, &ps, intf_i, 0);
+    if( profile )
+      profile_frc = ci_netif_poll_profile_stamp(ni, CI_POLL_PROFILE_EVQ,
+                                                profile_frc);
     if( rc > 0 ) {
       total_evs += rc;
       process_post_poll_list(ni);
+      if( profile )
+        profile_frc = ci_netif_poll_profile_stamp(ni,
+                                                  CI_POLL_PROFILE_POST_POLL,
+                                                  profile_frc);
     }
     else
       break;
-  } while( total_evs < max_evs );
+    /* The watermark probe looks ahead in the ring, so only costs cycles
+     * in the rare case that the budget really is exhausted. */
+  } while( total_evs < max_evs ||
+           ci_netif_evq_above_watermark(ni, intf_i) );
 
   if( ps.tx_pkt_free_list_n )
     ci_netif_poll_free_pkts(ni, &ps);
@@ -2071,9 +2880,10 @@ static int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
   /* The following steps probably aren't needed if we haven't handled any
    * events, but that is a rare case and so not worth testing for.
    */
-  ci_netif_rx_post_all_batch(ni, intf_i);
+  ci_netif_rx_refill_epilogue(ni, intf_i);
 
-  if( ci_netif_dmaq_not_empty(ni, intf_i) )
+  if( ci_netif_dmaq_not_empty(ni, intf_i) ||
+      oo_pktq_not_empty(ci_netif_dmaq_urgent(ni, intf_i)) )
     ci_netif_dmaq_shove1(ni, intf_i);
 
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
@@ -2085,9 +2895,57 @@ static int ci_netif_poll_intf(ci_netif* ni, int intf_i, int max_evs)
   }
 #endif
 
+  if( profile )
+    ci_netif_poll_profile_stamp(ni, CI_POLL_PROFILE_POST, profile_frc);
+
   return total_evs;
 }
 
+/* Two-tier interface service (EF_RX_LATENCY_INTFS): drain the
+ * latency-class interfaces exhaustively - re-polling any that filled
+ * the whole event budget - before giving the bulk-class interfaces
+ * their usual single poll.  The number of drain rounds is bounded so a
+ * saturating latency feed cannot starve the bulk interfaces outright.
+ * [start] preserves the caller's rotation within each class. */
+#define CI_NETIF_POLL_PRIO_ROUNDS  8
+
+static int ci_netif_poll_intfs_prio(ci_netif* ni, ci_uint32 latency_mask,
+                                    int intf_n, int start, int max_evs)
+{
+  int rounds = CI_NETIF_POLL_PRIO_ROUNDS;
+  int i, n, again, intf_i;
+  int total = 0;
+
+  do {
+    again = 0;
+    for( i = 0; i < intf_n; ++i ) {
+      intf_i = start + i;
+      if( intf_i >= intf_n )
+        intf_i -= intf_n;
+      if( ! (latency_mask & (1u << intf_i)) )
+        continue;
+      n = ci_netif_poll_intf(ni, intf_i, max_evs);
+      ci_assert(n >= 0);
+      total += n;
+      if( n >= max_evs )
+        again = 1;
+    }
+  } while( again && --rounds > 0 );
+
+  for( i = 0; i < intf_n; ++i ) {
+    intf_i = start + i;
+    if( intf_i >= intf_n )
+      intf_i -= intf_n;
+    if( latency_mask & (1u << intf_i) )
+      continue;
+    n = ci_netif_poll_intf(ni, intf_i, max_evs);
+    ci_assert(n >= 0);
+    total += n;
+  }
+  return total;
+}
+
+
 #ifndef __KERNEL__
 int ci_netif_poll_intf_future(ci_netif* ni, int intf_i, ci_uint64 start_frc)
 {
@@ -2309,9 +3167,38 @@ void ci_netif_loopback_pkts_send(ci_netif* ni)
 }
 
 
+/* Deliver pending loopback packets without polling the NIC event queues.
+ *
+ * This is the fast path for a same-host sender that is not inside a poll:
+ * its payload is already sitting on [looppkts] in stack shared memory, so
+ * delivering it only needs the RX processing and the post-poll wakeups.
+ * Callers must hold the stack lock and must not be in a poll; if hardware
+ * events are outstanding they should fall back to ci_netif_poll() so that
+ * NIC traffic is not starved.
+ */
+void ci_netif_loopback_deliver(ci_netif* ni)
+{
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert_equal(ni->state->in_poll, 0);
+
+  ++ni->state->in_poll;
+  while( OO_PP_NOT_NULL(ni->state->looppkts) ) {
+    ci_netif_loopback_pkts_send(ni);
+    process_post_poll_list(ni);
+  }
+  ci_assert_equal(ni->state->n_looppkts, 0);
+  --ni->state->in_poll;
+}
+
+
 int ci_netif_poll_n(ci_netif* netif, int max_evs)
 {
+  int profile = NI_HOT_OPTS(netif).flags & CI_NETIF_HOT_POLL_PROFILE;
+  ci_uint64 profile_frc = 0;
   int intf_i, n_evs_handled = 0;
+#ifndef __KERNEL__
+  int tx_batch_here = 0;
+#endif
 
 #if defined(__KERNEL__) || ! defined(NDEBUG)
   if( netif->error_flags )
@@ -2332,28 +3219,90 @@ int ci_netif_poll_n(ci_netif* netif, int max_evs)
   ci_netif_handle_actions(netif);
 #endif
 
+#ifndef __KERNEL__
+  /* If a sendmmsg() batch on this thread has to wait (e.g. for sendq
+   * space) it polls the stack, so flush any deferred doorbells here lest
+   * we wait for completions the NIC has not been told to produce. */
+  if(CI_UNLIKELY( ci_tx_batch_pending != 0 && ci_tx_batch_ni == netif ))
+    ci_netif_tx_batch_flush(netif);
+
+  /* EF_POLL_TX_DOORBELL_BATCH: everything this poll transmits - ACKs,
+   * retransmits, sendqs unblocked by completions - shares one doorbell
+   * per interface, rung before we return.  A nested poll (via
+   * send_may_poll) sees ci_tx_batching already set and leaves the batch
+   * to the outermost poll. */
+  if( (NI_HOT_OPTS(netif).flags & CI_NETIF_HOT_POLL_TX_BATCH) &&
+      ci_tx_batching == 0 ) {
+    ci_tx_batching = 1;
+    ci_tx_batch_ni = netif;
+    tx_batch_here = 1;
+  }
+#endif
+
 #if CI_CFG_HW_TIMER
   if( ci_netif_need_timer_prime(netif, IPTIMER_STATE(netif)->frc) ) {
-    if( NI_OPTS(netif).timer_usec != 0 )
+    if( NI_HOT_OPTS(netif).timer_usec != 0 )
       OO_STACK_FOR_EACH_INTF_I(netif, intf_i)
         ef_eventq_timer_prime(ci_netif_vi(netif, intf_i),
-                              NI_OPTS(netif).timer_usec);
+                              NI_HOT_OPTS(netif).timer_usec);
     netif->state->evq_last_prime = IPTIMER_STATE(netif)->frc;
   }
 #endif
 
   ci_assert(netif->state->in_poll == 0);
   ++netif->state->in_poll;
-  OO_STACK_FOR_EACH_INTF_I(netif, intf_i) {
-    int n = ci_netif_poll_intf(netif, intf_i, max_evs);
-    ci_assert(n >= 0);
-    n_evs_handled += n;
+  /* Spinning threads compare [poll_gen] across their lock-free pre-checks
+   * to see whether some other thread's poll has already run since they
+   * last looked (see ci_netif_poll_uncontended()). */
+  ++netif->state->poll_gen;
+  {
+    /* Rotate the starting interface between polls.  With several RSS
+     * channels attached to one stack, always draining channel 0 first
+     * leaves the later channels with systematically staler packets; the
+     * rotation shares the head-of-poll position out evenly. */
+    int intf_n = oo_stack_intf_max(netif);
+    ci_uint32 latency_mask = NI_OPTS(netif).rx_latency_intfs &
+                             ((1u << intf_n) - 1);
+    int i, start = 0;
+    if( intf_n > 1 )
+      start = netif->state->poll_intf_rr++ % intf_n;
+    if(CI_UNLIKELY( latency_mask != 0 &&
+                    latency_mask != (1u << intf_n) - 1 )) {
+      n_evs_handled += ci_netif_poll_intfs_prio(netif, latency_mask,
+                                                intf_n, start, max_evs);
+    }
+    else {
+      for( i = 0; i < intf_n; ++i ) {
+        int n;
+        intf_i = start + i;
+        if( intf_i >= intf_n )
+          intf_i -= intf_n;
+        n = ci_netif_poll_intf(netif, intf_i, max_evs);
+        ci_assert(n >= 0);
+        n_evs_handled += n;
+      }
+    }
   }
 
-  while( OO_PP_NOT_NULL(netif->state->looppkts) ) {
-    ci_netif_loopback_pkts_send(netif);
+  /* SYNs parked by EF_TCP_SYN_DEFER are handled only now that all data
+   * packets in the batch have been processed, and within the configured
+   * budget; the rest stay queued for later polls. */
+  if( OO_PP_NOT_NULL(netif->state->syn_defer_head) ) {
+    ci_tcp_rx_deferred_syns(netif);
     process_post_poll_list(netif);
   }
+
+  if( OO_PP_NOT_NULL(netif->state->looppkts) ) {
+    if( profile )
+      ci_frc64(&profile_frc);
+    do {
+      ci_netif_loopback_pkts_send(netif);
+      process_post_poll_list(netif);
+    } while( OO_PP_NOT_NULL(netif->state->looppkts) );
+    if( profile )
+      ci_netif_poll_profile_stamp(netif, CI_POLL_PROFILE_LOOPBACK,
+                                  profile_frc);
+  }
   ci_assert_equal(netif->state->n_looppkts, 0);
   --netif->state->in_poll;
 
@@ -2368,7 +3317,7 @@ int ci_netif_poll_n(ci_netif* netif, int max_evs)
     ci_assert_gt(netif->state->kernel_packets_pending, 0);
 
     if( netif->state->kernel_packets_pending >=
-        NI_OPTS(netif).kernel_packets_batch_size ||
+        NI_HOT_OPTS(netif).kernel_packets_batch_size ||
         frc - netif->state->kernel_packets_last_forwarded >=
         netif->state->kernel_packets_cycles )
       ef_eplock_holder_set_flag(&netif->state->lock,
@@ -2378,11 +3327,34 @@ int ci_netif_poll_n(ci_netif* netif, int max_evs)
 
   /* Timer code can't use in-poll wakeup, since endpoints are out of
    * post-poll list.  So, poll timers after --in_poll. */
+  if( profile )
+    ci_frc64(&profile_frc);
+  if( (NI_HOT_OPTS(netif).flags & CI_NETIF_HOT_TCP_FAST_ACK) &&
+      netif->state->fast_ack_n > 0 )
+    ci_tcp_fast_ack_check(netif);
+  if( (NI_HOT_OPTS(netif).flags & CI_NETIF_HOT_TCP_CORK_NS) &&
+      netif->state->cork_n > 0 )
+    ci_tcp_cork_deadline_check(netif);
+  if(CI_UNLIKELY( netif->state->mem_watermark_n > 0 ))
+    ci_netif_mem_watermark_check(netif);
   ci_ip_timer_poll(netif);
+  if( profile )
+    ci_netif_poll_profile_stamp(netif, CI_POLL_PROFILE_TIMERS, profile_frc);
 
   /* Timers MUST NOT send via loopback. */
   ci_assert(OO_PP_IS_NULL(netif->state->looppkts));
 
+#ifndef __KERNEL__
+  /* Nothing below transmits, so ring the doorbells deferred by this
+   * poll's batch now. */
+  if( tx_batch_here ) {
+    ci_tx_batching = 0;
+    if( ci_tx_batch_pending != 0 )
+      ci_netif_tx_batch_flush(netif);
+    ci_tx_batch_ni = NULL;
+  }
+#endif
+
   /* Perform proactive socket allocation check.
    * Proactive packet allocation check is more expensive, so we perform it
    * from the unlock hook only.
@@ -2403,6 +3375,44 @@ int ci_netif_poll_n(ci_netif* netif, int max_evs)
 
   netif->state->poll_work_outstanding = 0;
 
+  /* Hybrid spin/interrupt mode: a long enough run of empty polls means the
+   * stack has gone quiet, so arm interrupts and let spinners block.  Any
+   * event resets the run and keeps us in pure spinning.
+   */
+  if(CI_UNLIKELY( NI_HOT_OPTS(netif).int_adaptive_empty_polls != 0 )) {
+    if( n_evs_handled != 0 ) {
+      netif->state->poll_empty_polls = 0;
+    }
+    else if( ++netif->state->poll_empty_polls >=
+             NI_HOT_OPTS(netif).int_adaptive_empty_polls ) {
+      netif->state->poll_empty_polls = 0;
+      CITP_STATS_NETIF_INC(netif, adaptive_int_primes);
+      ef_eplock_holder_set_flag(&netif->state->lock,
+                                CI_EPLOCK_NETIF_NEED_PRIME);
+    }
+  }
+
+#ifndef __KERNEL__
+  /* Refresh the shared-memory stats mirror at most once per
+   * EF_STATS_EXPORT_MS; on other polls this costs one predictable branch. */
+  if(CI_UNLIKELY( netif->stats_export != NULL ) &&
+     IPTIMER_STATE(netif)->frc - netif->stats_export_last_frc >
+     NI_OPTS(netif).stats_export_ms * (ci_uint64) IPTIMER_STATE(netif)->khz ) {
+    netif->stats_export_last_frc = IPTIMER_STATE(netif)->frc;
+    oo_stats_export_refresh(netif);
+  }
+#endif
+
+  /* Empty polls are not recorded: a spinning stack would cycle the whole
+   * flight recorder in microseconds and erase the history we keep it for. */
+  if( n_evs_handled != 0 ) {
+#ifdef __KERNEL__
+    ci_netif_fr_log(netif, CI_FR_EV_POLL, 1, n_evs_handled);
+#else
+    ci_netif_fr_log(netif, CI_FR_EV_POLL, 0, n_evs_handled);
+#endif
+  }
+
   /* returns the number of events handled */
   return n_evs_handled;
 }
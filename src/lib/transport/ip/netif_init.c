@@ -26,6 +26,8 @@
 #include <cplane/create.h>
 #include <net/if.h>
 #include <ci/internal/efabcfg.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #endif
 
 
@@ -44,6 +46,39 @@ const char* oo_uk_intf_ver = OO_UK_INTF_VER;
 
 
 
+/* Freeze the options the poll loop consults per poll or per packet into
+ * the compact read-only image in the netif; see struct ci_netif_hot_opts.
+ */
+void ci_netif_hot_opts_init(ci_netif* ni)
+{
+  const ci_netif_config_opts* opts = &NI_OPTS(ni);
+  struct ci_netif_hot_opts* hot = &ni->hot_opts;
+
+  hot->evs_per_poll = opts->evs_per_poll;
+  hot->evq_high_watermark = opts->evq_high_watermark;
+  hot->timer_usec = opts->timer_usec;
+  hot->int_adaptive_empty_polls = opts->int_adaptive_empty_polls;
+  hot->kernel_packets_batch_size = opts->kernel_packets_batch_size;
+  hot->timestamping_reporting = opts->timestamping_reporting;
+#if CI_CFG_RANDOM_DROP
+  hot->rx_drop_rate = opts->rx_drop_rate;
+#endif
+  hot->flags = 0;
+  if( opts->poll_profile )
+    hot->flags |= CI_NETIF_HOT_POLL_PROFILE;
+  if( opts->rx_latency_histogram )
+    hot->flags |= CI_NETIF_HOT_RX_LATENCY_HISTOGRAM;
+  if( opts->tcp_fast_ack )
+    hot->flags |= CI_NETIF_HOT_TCP_FAST_ACK;
+  if( opts->tcp_cork_ns )
+    hot->flags |= CI_NETIF_HOT_TCP_CORK_NS;
+  if( opts->xdp_mode != 0 )
+    hot->flags |= CI_NETIF_HOT_XDP;
+  if( opts->poll_tx_doorbell_batch )
+    hot->flags |= CI_NETIF_HOT_POLL_TX_BATCH;
+}
+
+
 #ifdef __KERNEL__
 
 #define assert_zero(x)  ci_assert_equal((x), 0)
@@ -57,12 +92,14 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
   int i;
 
   nis->opts = ni->opts;
+  ci_netif_hot_opts_init(ni);
 
   /* TX DMA overflow queue and id allocator init for nvme plugin */
   OO_STACK_FOR_EACH_INTF_I(ni, nic_i) {
     nn = &nis->nic[nic_i];
     for( i = 0; i < sizeof(nn->dmaq) / sizeof(nn->dmaq[0]); ++i )
       oo_pktq_init(&nn->dmaq[i]);
+    oo_pktq_init(&nn->dmaq_urgent);
     assert_zero(nn->tx_bytes_added);
     assert_zero(nn->tx_bytes_removed);
     assert_zero(nn->tx_dmaq_insert_seq);
@@ -87,10 +124,21 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
   assert_zero(nis->mem_pressure_pkt_pool_n);
   nis->looppkts = OO_PP_NULL;
   nis->n_looppkts = 0;
+  nis->syn_defer_head = OO_PP_NULL;
+  nis->syn_defer_tail = OO_PP_NULL;
+  assert_zero(nis->syn_defer_n);
+  for( i = 0; i < OO_UDP_REASM_CTXTS; i++ )
+    nis->udp_reasm[i].frags = OO_PP_NULL;
+  for( i = 0; i < CI_NI_RX_FLOW_HINT_SIZE; i++ ) {
+    nis->rx_flow_hint[i] = OO_SP_NULL;
+    nis->rx_nic_flow_hint[i] = OO_SP_NULL;
+  }
+  assert_zero(nis->poll_intf_rr);
 
   /* Pool of packet buffers for transmit. */
   assert_zero(nis->n_async_pkts);
   nis->nonb_pkt_pool = CI_ILL_END;
+  nis->tx_staging_q = CI_ILL_END;
 
   /* Deferred packets */
   list = oo_p_dllink_ptr(ni, &nis->deferred_list);
@@ -120,6 +168,16 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
 
   nis->timeout_tid.fn = CI_IP_TIMER_NETIF_TIMEOUT;
 
+  oo_pktq_init(&nis->pacing_q);
+  nis->pacing_next_frc = 0;
+  ci_ip_timer_init(ni, &nis->pacing_tid,
+                   oo_ptr_to_statep(ni, &nis->pacing_tid),
+                   "pace");
+  nis->pacing_tid.fn = CI_IP_TIMER_NETIF_TX_PACE;
+
+  nis->warm_state_pool = OO_SP_NULL;
+  nis->warm_state_pool_n = 0;
+
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
   ci_ip_timer_init(ni, &nis->recycle_tid,
                    oo_ptr_to_statep(ni, &nis->recycle_tid),
@@ -140,9 +198,15 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
 #endif
 
   oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &nis->reap_list));
+  oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &nis->mem_watermark_socks));
+  nis->mem_watermark_n = 0;
 
   nis->free_eps_head = OO_SP_NULL;
   nis->free_eps_num = 0;
+  nis->promote_batch_listener = OO_SP_NULL;
+  nis->promote_batch_head = OO_SP_NULL;
+  nis->promote_batch_tail = OO_SP_NULL;
+  assert_zero(nis->promote_batch_n);
   nis->deferred_free_eps_head = CI_ILL_END;
   assert_zero(nis->n_ep_bufs);
   nis->max_ep_bufs = NI_OPTS(ni).max_ep_bufs;
@@ -212,9 +276,18 @@ void ci_netif_state_init(ci_netif* ni, int cpu_khz, const char* name)
     oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &nis->ready_lists[i]));
     oo_p_dllink_init(ni, oo_p_dllink_ptr(ni, &nis->unready_lists[i]));
     nis->ready_list_flags[i] = 0;
+    nis->ready_rings[i].wr = 0;
+    nis->ready_rings[i].rd = 0;
+    nis->ready_rings[i].overflow = 0;
   }
 #endif
 
+  nis->fast_ack_n = 0;
+  nis->cork_n = 0;
+  nis->tcp_cork_cycles =
+            (ci_uint64) NI_OPTS(ni).tcp_cork_ns * cpu_khz / 1000000;
+  nis->vxlan_port_be16 = CI_BSWAP_BE16((ci_uint16) NI_OPTS(ni).vxlan_port);
+
 #if CI_CFG_TCP_SHARED_LOCAL_PORTS
   for( i = 0;
        i < nis->active_wild_table_entries_n * nis->active_wild_pools_n;
@@ -807,6 +880,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
   }
   if( (s = getenv("EF_MCAST_RECV_HW_LOOP")) )
     opts->mcast_recv_hw_loop = atoi(s);
+  if( (s = getenv("EF_POLL_TIMER_BUDGET")) )
+    opts->poll_timer_budget = atoi(s);
   if( (s = getenv("EF_EVS_PER_POLL")) )
     opts->evs_per_poll = atoi(s);
 #if CI_CFG_WANT_BPF_NATIVE
@@ -817,6 +892,8 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->msl_seconds = atoi(s);
   if( (s = getenv("EF_TCP_FIN_TIMEOUT")) )
     opts->fin_timeout = atoi(s);
+  if( (s = getenv("EF_TCP_TIME_WAIT_MAX")) )
+    opts->tcp_time_wait_max = atoi(s);
   if( (s = getenv("EF_TCP_ADV_WIN_SCALE_MAX")) )
     opts->tcp_adv_win_scale_max = atoi(s);
 
@@ -850,10 +927,14 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->prealloc_packets = atoi(s);
   if ( (s = getenv("EF_RXQ_MIN")) )
     opts->rxq_min = atoi(s);
+  if ( (s = getenv("EF_RXQ_INIT_FILL")) )
+    opts->rxq_init_fill = atoi(s);
   if ( (s = getenv("EF_MIN_FREE_PACKETS")) )
     opts->min_free_packets = atoi(s);
   if( (s = getenv("EF_PREFAULT_PACKETS")) )
     opts->prefault_packets = atoi(s);
+  if( (s = getenv("EF_PKT_SET_PREMAP")) )
+    opts->pkt_set_premap = atoi(s);
   if ( (s = getenv("EF_MAX_ENDPOINTS")) )
     opts->max_ep_bufs = atoi(s);
   if ( (s = getenv("EF_ENDPOINT_PACKET_RESERVE")) )
@@ -883,6 +964,10 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
     opts->shared_rxq_num = atoi(s);
   if ( (s = getenv("EF_TXQ_SIZE")) )
     opts->txq_size = atoi(s);
+  if ( (s = getenv("EF_RX_ETHERTYPE")) )
+    opts->rx_ethertype = strtoul(s, NULL, 0);
+  if ( (s = getenv("EF_RX_ETHERTYPE_IFINDEX")) )
+    opts->rx_ethertype_ifindex = atoi(s);
   if ( (s = getenv("EF_SEND_POLL_THRESH")) )
     opts->send_poll_thresh = atoi(s);
   if ( (s = getenv("EF_SEND_POLL_MAX_EVS")) )
@@ -1303,6 +1388,103 @@ void ci_netif_config_opts_getenv(ci_netif_config_opts* opts)
   if( (s = getenv("EF_NO_HW")) )
     opts->no_hw = atoi(s);
 
+  if( (s = getenv("EF_POLL_PROFILE")) )
+    opts->poll_profile = atoi(s);
+  if( (s = getenv("EF_STATS_EXPORT_MS")) )
+    opts->stats_export_ms = atoi(s);
+  if( (s = getenv("EF_RX_LATENCY_HISTOGRAM")) )
+    opts->rx_latency_histogram = atoi(s);
+  if( (s = getenv("EF_INT_ADAPTIVE_EMPTY_POLLS")) )
+    opts->int_adaptive_empty_polls = atoi(s);
+  if( (s = getenv("EF_EVQ_HIGH_WATERMARK")) )
+    opts->evq_high_watermark = atoi(s);
+  if( (s = getenv("EF_POLL_TX_DOORBELL_BATCH")) )
+    opts->poll_tx_doorbell_batch = atoi(s);
+
+#if CI_CFG_TCP_RACK
+  if( (s = getenv("EF_TCP_RACK")) )
+    opts->tcp_rack = atoi(s);
+#endif
+  if( (s = getenv("EF_TCP_SYN_DEFER")) )
+    opts->tcp_syn_defer = atoi(s);
+  if( (s = getenv("EF_TCP_RX_COALESCE")) )
+    opts->tcp_rx_coalesce = atoi(s);
+  if( (s = getenv("EF_TCP_FAST_ACK")) )
+    opts->tcp_fast_ack = atoi(s);
+  if( (s = getenv("EF_TCP_CORK_NS")) )
+    opts->tcp_cork_ns = atoi(s);
+  if( (s = getenv("EF_TCP_CC")) )
+    opts->tcp_cc = atoi(s);
+#if CI_CFG_DYNAMIC_ACK_RATE
+  if( (s = getenv("EF_DYNAMIC_ACK_MAX")) )
+    opts->dynack_max = atoi(s);
+#endif
+  if( (s = getenv("EF_TCP_STATE_POOL")) )
+    opts->tcp_state_pool = atoi(s);
+  if( (s = getenv("EF_TCP_RECV_SPIN_ADAPTIVE")) )
+    opts->tcp_recv_spin_adaptive = atoi(s);
+
+  if( (s = getenv("EF_UDP_TX_STAGING")) )
+    opts->udp_tx_staging = atoi(s);
+#if CI_CFG_CTPIO
+  if( (s = getenv("EF_UDP_CTPIO")) )
+    opts->udp_ctpio = atoi(s);
+#endif
+  if( (s = getenv("EF_UDP_RX_COMPACT")) )
+    opts->udp_rx_compact = atoi(s);
+  if( (s = getenv("EF_UDP_RX_REASSEMBLY")) )
+    opts->udp_rx_reassembly = atoi(s);
+  if( (s = getenv("EF_VXLAN_PORT")) )
+    opts->vxlan_port = atoi(s);
+  if( (s = getenv("EF_MCAST_DEMUX")) )
+    opts->mcast_demux = atoi(s);
+
+  if( (s = getenv("EF_PIPE_SPSC")) )
+    opts->pipe_spsc = atoi(s);
+  if( (s = getenv("EF_PIPE_FUTEX")) )
+    opts->pipe_futex = atoi(s);
+  if( (s = getenv("EF_EPOLL_READY_RING")) )
+    opts->epoll_ready_ring = atoi(s);
+  if( (s = getenv("EF_CLUSTER_RSS_POLICY")) )
+    opts->cluster_rss_policy = atoi(s);
+
+  if( (s = getenv("EF_TX_PACING_RATE")) )
+    opts->tx_pacing_rate = atoi(s);
+  if( (s = getenv("EF_TX_LATENCY_PRIO")) )
+    opts->tx_latency_prio = atoi(s);
+  if( (s = getenv("EF_RX_LATENCY_INTFS")) )
+    opts->rx_latency_intfs = strtoul(s, NULL, 0);
+  if( (s = getenv("EF_RX_REFILL_ADAPTIVE")) )
+    opts->rx_refill_adaptive = atoi(s);
+  if( (s = getenv("EF_ISO_DOMAIN_PKTS")) )
+    opts->iso_domain_pkts = atoi(s);
+
+  if( (s = getenv("EF_PACKET_BUF_NUMA_NODE")) )
+    opts->packet_buf_numa_node = atoi(s);
+  if( (s = getenv("EF_STACK_NUMA_NODE")) )
+    opts->stack_numa_node = atoi(s);
+  if( (s = getenv("EF_RXQ_INIT_FILL")) )
+    opts->rxq_init_fill = atoi(s);
+  if( (s = getenv("EF_STACK_PERSIST")) )
+    opts->stack_persist = atoi(s);
+  if( (s = getenv("EF_PKT_MAGAZINE")) )
+    opts->pkt_magazine = atoi(s);
+
+  if( (s = getenv("EF_ASYNC_FILTER_INSERT")) )
+    opts->async_filter_insert = atoi(s);
+  if( (s = getenv("EF_SW_FILTER_CUCKOO")) )
+    opts->sw_filter_cuckoo = atoi(s);
+  if( (s = getenv("EF_FILTER_SPILL")) )
+    opts->filter_spill = atoi(s);
+  if( (s = getenv("EF_RX_FLOW_HINT")) )
+    opts->rx_flow_hint = atoi(s);
+  if( (s = getenv("EF_CPLANE_NONBLOCK_RESOLVE")) )
+    opts->cplane_nonblock_resolve = atoi(s);
+#if CI_CFG_RX_ORDER_TAP
+  if( (s = getenv("EF_RX_ORDER_TAP")) )
+    opts->rx_order_tap = atoi(s);
+#endif
+
 #if CI_CFG_TCP_OFFLOAD_RECYCLER || CI_CFG_TX_CRC_OFFLOAD
   static const char* const tcp_offload_opts[] = { "off", "tcp", "ceph", "nvme", 0 };
   opts->tcp_offload_plugin = parse_enum(opts, "EF_TCP_OFFLOAD",
@@ -1704,6 +1886,9 @@ static void netif_tcp_helper_build2(ci_netif* ni)
   ni->filter_table_ext =
     (ci_netif_filter_table_entry_ext*) ((char*) ni->state +
                                         ni->state->table_ext_ofs);
+  ni->mcast_tbl =
+    (ci_netif_mcast_tbl_entry*) ((char*) ni->state +
+                                 ni->state->mcast_tbl_ofs);
 #if CI_CFG_IPV6
   ni->ip6_filter_table =
     (ci_ip6_netif_filter_table*) ((char*) ni->state + ni->state->ip6_table_ofs);
@@ -1718,6 +1903,8 @@ static void netif_tcp_helper_build2(ci_netif* ni)
                      "sw_filters",
                      (void*)((char*) ni->state + ni->state->sw_filter_ofs));
 #endif
+
+  ci_netif_hot_opts_init(ni);
 }
 
 
@@ -2305,6 +2492,9 @@ static int netif_tcp_helper_build(ci_netif* ni)
     goto fail3;
   }
 
+  if( NI_OPTS(ni).pkt_set_premap )
+    ci_netif_pkt_premap(ni);
+
   ni->eps = CI_ALLOC_ARRAY(typeof(*ni->eps), ni->state->max_ep_bufs);
   if( ni->eps == NULL ) {
     rc = -ENOMEM;
@@ -2591,6 +2781,12 @@ static void ci_netif_sanity_checks(void)
                       sizeof(((citp_waitable*)0)->sb_aflags)
                    <= CI_AUX_HEADER_SIZE );
 
+  /* The read-mostly part of the socket (options, bound addresses, header
+   * templates) must start on a cache-line boundary so that hot-path
+   * option loads never share a line with the mutable group at the head
+   * of ci_sock_cmn.  If this fires, adjust mutable_pad[]. */
+  CI_BUILD_ASSERT( offsetof(ci_sock_cmn, s_flags) % CI_CACHE_LINE_SIZE == 0 );
+
 #ifndef NDEBUG
   {
     int i = CI_MEMBER_OFFSET(ci_ip_cached_hdrs, ipx.ip4);
@@ -2758,9 +2954,96 @@ void ci_netif_cluster_prefault(ci_netif* ni)
   ni->flags |= CI_NETIF_FLAGS_PREFAULTED;
 }
 
+/* All stacks created by one process in one network namespace map identical
+ * read-mostly control plane tables, so share a single mapping between them
+ * rather than burning pagetable entries on one copy per stack.  Each cached
+ * handle owns its own driver fd (a stack's fd may be closed while other
+ * stacks still use the mapping).  Per-stack state - the fwd_cache version
+ * cursors in ci_netif - is untouched by the sharing.
+ *
+ * A stack whose namespace does not match the cached one (possible after
+ * unshare(CLONE_NEWNET)) falls back to a private mapping as before.
+ */
+struct oo_cp_shared {
+  struct oo_cplane_handle handle;
+  ino_t netns_ino;
+  int refs;
+};
+
+static pthread_mutex_t oo_cp_shared_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oo_cp_shared oo_cp_shared_local;
+static struct oo_cp_shared oo_cp_shared_init_net;
+
+static ino_t oo_cp_netns_ino(void)
+{
+  struct stat st;
+  if( stat("/proc/self/ns/net", &st) != 0 )
+    return 0;
+  return st.st_ino;
+}
+
+/* Take a reference to the process-wide cplane handle, mapping it on first
+ * use.  Returns NULL if the mapping failed or if [netns_ino] does not match
+ * the instance already cached (in which case the caller should fall back to
+ * a private mapping). */
+static struct oo_cplane_handle*
+oo_cp_shared_get(struct oo_cp_shared* sh, ino_t netns_ino, ci_uint32 flags)
+{
+  struct oo_cplane_handle* cp = NULL;
+  ef_driver_handle cp_fd;
+  int rc;
+
+  pthread_mutex_lock(&oo_cp_shared_lock);
+  if( sh->refs != 0 ) {
+    if( sh->netns_ino == netns_ino ) {
+      ++sh->refs;
+      cp = &sh->handle;
+    }
+  }
+  else if( ef_onload_driver_open(&cp_fd, OO_STACK_DEV, 1) == 0 ) {
+    rc = oo_cp_create(cp_fd, &sh->handle, CITP_OPTS.sync_cplane, flags);
+    if( rc == 0 ) {
+      sh->netns_ino = netns_ino;
+      sh->refs = 1;
+      cp = &sh->handle;
+    }
+    else {
+      ef_onload_driver_close(cp_fd);
+    }
+  }
+  pthread_mutex_unlock(&oo_cp_shared_lock);
+  return cp;
+}
+
+/* Drop a reference taken by oo_cp_shared_get().  Returns 1 if [cp] was the
+ * shared handle (and so has been dealt with), 0 if it is the caller's
+ * private mapping. */
+static int oo_cp_shared_put(struct oo_cplane_handle* cp)
+{
+  struct oo_cp_shared* sh;
+
+  if( cp == &oo_cp_shared_local.handle )
+    sh = &oo_cp_shared_local;
+  else if( cp == &oo_cp_shared_init_net.handle )
+    sh = &oo_cp_shared_init_net;
+  else
+    return 0;
+
+  pthread_mutex_lock(&oo_cp_shared_lock);
+  ci_assert_gt(sh->refs, 0);
+  if( --sh->refs == 0 ) {
+    oo_cp_destroy(&sh->handle);
+    ef_onload_driver_close(sh->handle.fd);
+  }
+  pthread_mutex_unlock(&oo_cp_shared_lock);
+  return 1;
+}
+
+
 static int ci_netif_init(ci_netif* ni, ef_driver_handle fd)
 {
   int rc;
+  int i;
   ef_driver_handle init_net_fd;
 
   ni->driver_handle = fd;
@@ -2769,20 +3052,41 @@ static int ci_netif_init(ci_netif* ni, ef_driver_handle fd)
   ni->error_flags = 0;
   ni->cplane_init_net = NULL;
 
-  ni->cplane = malloc(sizeof(struct oo_cplane_handle));
-  if( ni->cplane == NULL )
-    return -ENOMEM;
+  ni->fwd_cache = NULL;
+  ni->fwd_cache_mask = 0;
+  ni->recv_framing = NULL;
 
-  rc = oo_cp_create(fd, ni->cplane, CITP_OPTS.sync_cplane, 0);
-  if( rc != 0 ) {
-    ci_log("%s: failed to get local control plane handle: %d", __func__, rc);
-    goto fail;
+  ni->eventfd_bridge = -1;
+  ni->stats_export = NULL;
+  ni->stats_export_last_frc = 0;
+
+  ni->cplane = oo_cp_shared_get(&oo_cp_shared_local, oo_cp_netns_ino(), 0);
+  if( ni->cplane == NULL ) {
+    /* Shared handle unavailable (mapping failed, or this stack is in a
+     * different namespace from the cached handle): use a private mapping
+     * on the stack's own fd as before. */
+    ni->cplane = malloc(sizeof(struct oo_cplane_handle));
+    if( ni->cplane == NULL )
+      return -ENOMEM;
+
+    rc = oo_cp_create(fd, ni->cplane, CITP_OPTS.sync_cplane, 0);
+    if( rc != 0 ) {
+      ci_log("%s: failed to get local control plane handle: %d", __func__, rc);
+      goto fail;
+    }
   }
 
   /* If we need veth acceleration, map in the control plane for the main
    * namespace. */
   rc = oo_resource_op(fd, OO_IOC_VETH_ACCELERATION_ENABLED, NULL);
   if( rc > 0 ) {
+    /* The init_net instance is the same for every stack, so the shared
+     * handle can always be used; netns key 0 keeps all users together. */
+    ni->cplane_init_net =
+      oo_cp_shared_get(&oo_cp_shared_init_net, 0, CP_CREATE_FLAGS_INIT_NET);
+    if( ni->cplane_init_net != NULL )
+      return 0;
+
     ni->cplane_init_net = malloc(sizeof(struct oo_cplane_handle));
     if( ni->cplane_init_net == NULL )
       goto fail;
@@ -2809,25 +3113,48 @@ static int ci_netif_init(ci_netif* ni, ef_driver_handle fd)
     }
   }
 
+  if( CITP_OPTS.fwd_cache_size != 0 ) {
+    ci_uint32 entries = 1;
+    while( entries < CITP_OPTS.fwd_cache_size )
+      entries <<= 1;
+    /* Allocation failure just means sends fall back to the fwd-table
+     * lookup. */
+    ni->fwd_cache = calloc(entries, sizeof(ni->fwd_cache[0]));
+    if( ni->fwd_cache != NULL ) {
+      ni->fwd_cache_mask = entries - 1;
+      for( i = 0; (ci_uint32) i < entries; i++ )
+        ni->fwd_cache[i].verinfo.id = CICP_MAC_ROWID_BAD;
+    }
+  }
+
   return 0;
 
  fail:
-  free(ni->cplane);
+  if( ! oo_cp_shared_put(ni->cplane) )
+    free(ni->cplane);
   return rc;
 }
 
 static void ci_netif_deinit(ci_netif* ni)
 {
-  if( ni->cplane_init_net != NULL ) {
+  free(ni->fwd_cache);
+  ni->fwd_cache = NULL;
+  free(ni->recv_framing);
+  ni->recv_framing = NULL;
+
+  if( ni->cplane_init_net != NULL &&
+      ! oo_cp_shared_put(ni->cplane_init_net) ) {
     oo_cp_destroy(ni->cplane_init_net);
     ef_onload_driver_close(ni->cplane_init_net->fd);
     free(ni->cplane_init_net);
   }
 
-  /* The local cplane handle uses the stack's fd, so we don't need to close
-   * that fd now. */
-  oo_cp_destroy(ni->cplane);
-  free(ni->cplane);
+  if( ! oo_cp_shared_put(ni->cplane) ) {
+    /* A private local cplane handle uses the stack's fd, so we don't need
+     * to close that fd now. */
+    oo_cp_destroy(ni->cplane);
+    free(ni->cplane);
+  }
 }
 
 #if CI_CFG_UL_INTERRUPT_HELPER
@@ -2999,6 +3326,21 @@ int ci_netif_ctor(ci_netif* ni, ef_driver_handle fd, const char* stack_name,
   ci_netif_pkt_prefault_reserve(ni);
   ci_netif_pkt_prefault(ni);
 
+  if( NI_OPTS(ni).stack_persist ) {
+    ci_int32 enable = 1;
+    rc = oo_resource_op(ci_netif_get_driver_handle(ni), OO_IOC_STACK_PERSIST,
+                        &enable);
+    /* An old driver without the ioctl is not fatal: the stack works, it
+     * just will not survive a restart. */
+    if( rc != 0 )
+      NI_LOG(ni, RESOURCE_WARNINGS,
+             "%s: failed to make stack persistent (%d)", __FUNCTION__, rc);
+    rc = 0;
+  }
+
+  if( NI_OPTS(ni).stats_export_ms != 0 )
+    oo_stats_export_attach(ni);
+
   ci_netif_log_startup_banner(ni, "Using");
 
   return 0;
@@ -3100,7 +3442,7 @@ static int __ci_netif_init_fill_rx_rings(ci_netif* ni)
 int ci_netif_init_fill_rx_rings(ci_netif* ni)
 {
   oo_pkt_p pkt_list;
-  int lim, rc, n_reserved, n_requested, n_accounted;
+  int lim, fill_lim, rc, n_reserved, n_requested, n_accounted;
 
   /* This could legitimately fail for AF_XDP, having already allocated all
    * available buffers earlier in the initialisation process. So we check
@@ -3143,11 +3485,20 @@ int ci_netif_init_fill_rx_rings(ci_netif* ni)
     ci_netif_pkt_reserve_free(ni, pkt_list, n_reserved);
   }
 
+  /* Lazy packet commitment: only fill the rings part way during stack
+   * creation and let the normal refill path top them up once the stack is
+   * polled.  EF_PREALLOC_PACKETS demands everything up front. */
+  fill_lim = ni->state->rxq_base_limit;
+  if( NI_OPTS(ni).rxq_init_fill && ! NI_OPTS(ni).prealloc_packets ) {
+    fill_lim = CI_MAX((int) NI_OPTS(ni).rxq_min, NI_OPTS(ni).rxq_init_fill);
+    fill_lim = CI_MIN(fill_lim, (int) ni->state->rxq_base_limit);
+  }
+
   /* Fill the RX rings a little at a time.  Reason is to ensure that if we
    * are short of packet buffers, we don't fill some rings completely and
    * leave others empty.
    */
-  for( lim = CI_CFG_RX_DESC_BATCH; lim <= ni->state->rxq_base_limit;
+  for( lim = CI_CFG_RX_DESC_BATCH; lim <= fill_lim;
        lim += CI_CFG_RX_DESC_BATCH ) {
     ni->state->rxq_limit = lim;
     if( (rc = __ci_netif_init_fill_rx_rings(ni)) < 0 || ni->state->rxq_low ) {
@@ -33,6 +33,45 @@ static void* __ci_pkt_buf_map(ci_netif* ni, off_t offset)
   return CI_USER_PTR_GET(arg.addr);
 }
 
+/* Map every currently-allocated packet set with a single contiguous mmap
+ * and precompute the per-set pointers, instead of taking one lazy mmap per
+ * set on first use (see __ci_netif_pkt()).  Called at stack attach when
+ * EF_PKT_SET_PREMAP is set: for processes that repeatedly attach to a
+ * long-running stack this replaces up to sets_n mmap calls and vmas with
+ * one.  Sets allocated after the snapshot of sets_n are still mapped
+ * lazily.  Returns 0 on success; on any failure the lazy path still
+ * works, so failure here is not fatal.
+ */
+int ci_netif_pkt_premap(ci_netif* ni)
+{
+  size_t set_bytes = CI_CFG_PKT_BUF_SIZE * PKTS_PER_SET;
+  unsigned setid, sets_n = ni->packets->sets_n;
+  void* p;
+  int rc;
+
+  if( sets_n == 0 )
+    return 0;
+#if CI_CFG_PKTS_AS_HUGE_PAGES
+  for( setid = 0; setid < sets_n; ++setid )
+    if( ni->packets->set[setid].page_offset >= 0 )
+      /* Hugepage-backed sets must be mapped a hugepage at a time via
+       * OO_IOC_PKT_BUF_MMAP to avoid splitting the pages. */
+      return -EINVAL;
+#endif
+  rc = oo_resource_mmap(ci_netif_get_driver_handle(ni),
+                        OO_MMAP_TYPE_NETIF, CI_NETIF_MMAP_ID_PKTS,
+                        (size_t) sets_n * set_bytes,
+                        OO_MMAP_FLAG_POPULATE, &p);
+  if( rc < 0 ) {
+    LOG_NV(ci_log("%s: premap of %u pkt sets failed (%d)", __FUNCTION__,
+                  sets_n, rc));
+    return rc;
+  }
+  for( setid = 0; setid < sets_n; ++setid )
+    ni->pkt_bufs[setid] = (char*) p + (size_t) setid * set_bytes;
+  return 0;
+}
+
 ci_ip_pkt_fmt* __ci_netif_pkt(ci_netif* ni, unsigned id)
 {
   int rc;
@@ -98,6 +137,113 @@ ci_ip_pkt_fmt* __ci_netif_pkt(ci_netif* ni, unsigned id)
   return pkt;
 }
 
+/* Per-thread magazine of packet buffers for the non-blocking allocation
+ * path, enabled with EF_PKT_MAGAZINE.  The magazine is refilled from the
+ * stack's non-blocking pool with a single CAS per batch and drained with
+ * plain loads and stores, so threads sharing a stack stop bouncing the
+ * pool's cache line on every allocation.  Buffers are held with zero
+ * refcount, exactly as in the pool, and are pushed back when the thread
+ * exits or starts using a different stack. */
+
+#define CI_PKT_MAGAZINE_MAX 32
+
+struct ci_pkt_magazine {
+  ci_netif* ni;
+  int n;
+  ci_ip_pkt_fmt* pkt[CI_PKT_MAGAZINE_MAX];
+};
+
+static __thread struct ci_pkt_magazine pkt_magazine;
+static pthread_key_t pkt_magazine_key;
+static pthread_once_t pkt_magazine_once = PTHREAD_ONCE_INIT;
+
+
+static void ci_pkt_magazine_flush(struct ci_pkt_magazine* mag)
+{
+  int i;
+
+  if( mag->n == 0 )
+    return;
+  for( i = 0; i < mag->n - 1; ++i )
+    mag->pkt[i]->next = OO_PKT_P(mag->pkt[i + 1]);
+  ci_netif_pkt_free_nonb_list(mag->ni, OO_PKT_P(mag->pkt[0]),
+                              mag->pkt[mag->n - 1]);
+  mag->n = 0;
+}
+
+
+static void ci_pkt_magazine_thread_exit(void* arg)
+{
+  ci_pkt_magazine_flush(arg);
+}
+
+
+static void ci_pkt_magazine_key_create(void)
+{
+  pthread_key_create(&pkt_magazine_key, ci_pkt_magazine_thread_exit);
+}
+
+
+/* Grab a batch of buffers from the non-blocking pool with a single CAS.
+ * We walk the pool's next pointers optimistically; if another thread
+ * modifies the pool meanwhile the CAS fails and we start again, just as
+ * for a single-buffer pop.  Ids read from a torn walk are validated
+ * against the mapped packet sets before being dereferenced. */
+static int ci_pkt_magazine_refill(ci_netif* ni, struct ci_pkt_magazine* mag)
+{
+  volatile ci_uint64* nonb_pkt_pool_ptr = &ni->state->nonb_pkt_pool;
+  int goal = CI_MIN(NI_OPTS(ni).pkt_magazine, CI_PKT_MAGAZINE_MAX);
+  ci_uint64 link, new_link;
+  unsigned id;
+  int n;
+
+ again:
+  link = *nonb_pkt_pool_ptr;
+  id = link & 0xffffffff;
+  n = 0;
+  while( id != 0xffffffff && n < goal ) {
+    unsigned setid = id >> CI_CFG_PKTS_PER_SET_S;
+    ci_ip_pkt_fmt* pkt;
+    oo_pkt_p pp;
+    if( setid >= (unsigned) ni->packets->sets_n ||
+        ! PKT_BUFSET_U_MMAPPED(ni, setid) )
+      break;
+    OO_PP_INIT(ni, pp, id);
+    pkt = PKT(ni, pp);
+    mag->pkt[n++] = pkt;
+    id = (unsigned) OO_PP_ID(pkt->next);
+  }
+  if( n == 0 )
+    return 0;
+  new_link = id | (link & 0xffffffff00000000llu);
+  if( ci_cas64u_fail(nonb_pkt_pool_ptr, link, new_link) )
+    goto again;
+  mag->n = n;
+  return n;
+}
+
+
+ci_ip_pkt_fmt* ci_netif_pkt_alloc_nonb_mag(ci_netif* ni)
+{
+  struct ci_pkt_magazine* mag = &pkt_magazine;
+  ci_ip_pkt_fmt* pkt;
+
+  if( mag->ni != ni ) {
+    if( mag->ni != NULL )
+      ci_pkt_magazine_flush(mag);
+    pthread_once(&pkt_magazine_once, ci_pkt_magazine_key_create);
+    pthread_setspecific(pkt_magazine_key, mag);
+    mag->ni = ni;
+  }
+  if( mag->n == 0 && ci_pkt_magazine_refill(ni, mag) == 0 )
+    return NULL;
+  pkt = mag->pkt[--mag->n];
+  ci_assert_equal(pkt->refcount, 0);
+  pkt->refcount = 1;
+  CI_DEBUG(pkt->intf_i = -1);
+  return pkt;
+}
+
 #endif
 
 
@@ -266,6 +412,13 @@ void ci_netif_pkt_free(ci_netif* ni, ci_ip_pkt_fmt* pkt
 
   if( pkt->flags & CI_PKT_FLAG_RX )
     CI_NETIF_STATE_MOD(ni, *p_netif_is_locked, n_rx_pkts, -);
+  if( pkt->iso_domain != 0 ) {
+    /* Credit the isolation domain this buffer was charged to at TX
+     * allocation time.  Atomic because in-kernel frees can get here
+     * without the stack lock. */
+    ci_atomic32_dec(&ni->state->iso_dom_n_pkts[pkt->iso_domain]);
+    pkt->iso_domain = 0;
+  }
   __ci_netif_pkt_clean(pkt);
 #if CI_CFG_POISON_BUFS
   if( NI_OPTS(ni).poison_rx_buf )
@@ -684,4 +684,83 @@ ci_netif_stats_action(__NI_STRUCT__ *ni,
 
 #endif        /* CI_CFG_SUPPORT_STATS_COLLECTION */
 
+
+#ifndef __KERNEL__
+
+#include <onload/netif_stats_export.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Create and map the shared-memory stats mirror for this stack.  Called
+ * from ci_netif_ctor() when EF_STATS_EXPORT_MS is set; failure is logged
+ * and otherwise harmless, the stack just does not export its counters.
+ * See <onload/netif_stats_export.h> for the file layout. */
+void oo_stats_export_attach(ci_netif* ni)
+{
+  char path[sizeof(OO_STATS_EXPORT_PATH_FMT) + 16];
+  struct oo_stats_export_hdr* hdr;
+  size_t map_len;
+  int fd;
+
+  map_len = CI_ROUND_UP(sizeof(*hdr) + sizeof(ci_netif_stats),
+                        (size_t) CI_PAGE_SIZE);
+  snprintf(path, sizeof(path), OO_STATS_EXPORT_PATH_FMT, NI_ID(ni));
+
+  fd = open(path, O_RDWR | O_CREAT, 0644);
+  if( fd < 0 ) {
+    NI_LOG(ni, RESOURCE_WARNINGS, "%s: [%s] failed to create %s (%d)",
+           __FUNCTION__, ni->state->pretty_name, path, -errno);
+    return;
+  }
+  if( ftruncate(fd, map_len) < 0 ) {
+    NI_LOG(ni, RESOURCE_WARNINGS, "%s: [%s] failed to size %s (%d)",
+           __FUNCTION__, ni->state->pretty_name, path, -errno);
+    close(fd);
+    return;
+  }
+  hdr = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if( hdr == MAP_FAILED ) {
+    NI_LOG(ni, RESOURCE_WARNINGS, "%s: [%s] failed to map %s (%d)",
+           __FUNCTION__, ni->state->pretty_name, path, -errno);
+    return;
+  }
+
+  memset(hdr, 0, sizeof(*hdr));
+  hdr->version = OO_STATS_EXPORT_VERSION;
+  hdr->hdr_len = sizeof(*hdr);
+  hdr->stats_off = sizeof(*hdr);
+  hdr->stats_len = sizeof(ci_netif_stats);
+  hdr->stack_id = NI_ID(ni);
+  hdr->pid = getpid();
+  strncpy(hdr->stack_name, ni->state->name, sizeof(hdr->stack_name) - 1);
+  /* Publish the magic last so a reader that maps a half-initialised file
+   * rejects it. */
+  ci_wmb();
+  hdr->magic = OO_STATS_EXPORT_MAGIC;
+
+  ni->stats_export = hdr;
+  ni->stats_export_last_frc = 0;
+  oo_stats_export_refresh(ni);
+}
+
+
+/* Copy the stack's counters into the shared-memory mirror.  Called from
+ * the polling paths at most once per EF_STATS_EXPORT_MS; readers use
+ * [generation] as a seqlock to detect a copy in progress. */
+void oo_stats_export_refresh(ci_netif* ni)
+{
+  struct oo_stats_export_hdr* hdr = ni->stats_export;
+
+  ++hdr->generation;
+  ci_wmb();
+  memcpy((char*) hdr + hdr->stats_off, &ni->state->stats,
+         sizeof(ci_netif_stats));
+  ci_wmb();
+  ++hdr->generation;
+}
+
+#endif  /* ! __KERNEL__ */
+
 /*! \cidoxg_end */
@@ -82,6 +82,50 @@ set_entry_id(ci_netif_filter_table_entry_fast* entry, ci_uint32 id)
 #endif
 
 
+/* With EF_SW_FILTER_CUCKOO the table uses a two-choice (cuckoo) layout
+ * instead of double-hashed open addressing.  An entry lives either at its
+ * hash1 slot (OCCUPIED_PREFERRED) or at (hash1 + hash2) (OCCUPIED_REHASHED),
+ * so lookup inspects exactly two slots however full the table is and
+ * whatever has been deleted.  Inserts displace entries between their two
+ * candidate slots to make room, and tombstones are never needed. */
+ci_inline unsigned cuckoo_slot2(ci_netif_filter_table* tbl, unsigned hash1,
+                                unsigned hash2)
+{
+  return (hash1 + hash2) & tbl->table_size_mask;
+}
+
+
+/* Returns table entry index, or -1 if lookup failed. */
+static int
+ci_ip4_netif_filter_lookup_cuckoo(ci_netif* netif,
+                                  unsigned laddr, unsigned lport,
+                                  unsigned raddr, unsigned rport,
+                                  unsigned protocol)
+{
+  ci_netif_filter_table* tbl = netif->filter_table;
+  unsigned hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
+                                  raddr, rport, protocol);
+  unsigned hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
+  unsigned probe = hash1;
+  int i;
+
+  for( i = 0; i < 2; ++i ) {
+    ci_netif_filter_table_entry_fast* entry = &tbl->table[probe];
+    if( OCCUPIED(entry) ) {
+      ci_sock_cmn* s = ID_TO_SOCK(netif, ID(entry));
+      if( ((laddr    - entry->laddr                       ) |
+           (lport    - netif->filter_table_ext[probe].lport) |
+           (raddr    - sock_raddr_be32(s)                  ) |
+           (rport    - sock_rport_be16(s)                  ) |
+           (protocol - sock_protocol(s)                    )) == 0 )
+        return probe;
+    }
+    probe = cuckoo_slot2(tbl, hash1, hash2);
+  }
+  return -ENOENT;
+}
+
+
 /* Returns table entry index, or -1 if lookup failed. */
 static int
 ci_ip4_netif_filter_lookup(ci_netif* netif, unsigned laddr, unsigned lport,
@@ -95,6 +139,10 @@ ci_ip4_netif_filter_lookup(ci_netif* netif, unsigned laddr, unsigned lport,
   ci_assert(ci_netif_is_locked(netif));
   ci_assert(netif->filter_table);
 
+  if( NI_OPTS(netif).sw_filter_cuckoo )
+    return ci_ip4_netif_filter_lookup_cuckoo(netif, laddr, lport,
+                                             raddr, rport, protocol);
+
   tbl = netif->filter_table;
   hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
                        raddr, rport, protocol);
@@ -287,6 +335,22 @@ ci_netif_filter_for_each_match(ci_netif* ni,
                      callback_arg, 0 /*check_lport*/) )
       return 1;
   }
+  /* In the cuckoo layout the only other slot an entry can occupy is the
+   * secondary, so inspect that and we're done.  An empty preferred slot does
+   * not terminate the search: displaced entries stay in their secondary slot
+   * even if their preferred slot later frees up. */
+  if( NI_OPTS(ni).sw_filter_cuckoo ) {
+    hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
+    hash1 = cuckoo_slot2(tbl, hash1, hash2);
+    entry = &tbl->table[hash1];
+    if( OCCUPIED(entry) &&
+        handle_entry(ni, entry, &ni->filter_table_ext[hash1], laddr, lport,
+                     raddr, rport, protocol, intf_i, vlan, callback,
+                     callback_arg, 1 /*check_lport*/) )
+      return 1;
+    return 0;
+  }
+
   /* If the state of that first entry was OCCUPIED_REHASHED, it's a guaranteed
    * non-match for this lookup, because this location is the preferred bucket
    * for the query.  So we enter the loop at the point at which we've decided
@@ -319,6 +383,175 @@ ci_netif_filter_for_each_match(ci_netif* ni,
 }
 
 
+#define CUCKOO_MAX_KICKS 32
+
+/* Insert for the two-choice layout.  If both candidate slots are taken we
+ * walk the chain of displacements read-only until a free slot is found,
+ * then shift entries one place along the chain, which frees up the new
+ * entry's preferred slot.  Failure leaves the table untouched. */
+static int
+ci_ip4_netif_filter_insert_cuckoo(ci_netif_filter_table* tbl,
+                                  ci_netif* netif, oo_sp tcp_id,
+                                  unsigned laddr, unsigned lport,
+                                  unsigned raddr, unsigned rport,
+                                  unsigned protocol)
+{
+  ci_netif_filter_table_entry_fast* entry;
+  ci_netif_filter_table_entry_ext* entry_ext;
+  unsigned path[CUCKOO_MAX_KICKS + 1];
+  unsigned hash1, hash2, slot2, target;
+  int depth = 0, i;
+#if !defined(NDEBUG) || CI_CFG_STATS_NETIF
+  unsigned hops = 1;
+#endif
+
+  hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
+                         raddr, rport, protocol);
+  hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
+  slot2 = cuckoo_slot2(tbl, hash1, hash2);
+
+  if( ! OCCUPIED(&tbl->table[hash1]) ) {
+    target = hash1;
+  }
+  else if( slot2 != hash1 && ! OCCUPIED(&tbl->table[slot2]) ) {
+    target = slot2;
+  }
+  else {
+    /* Both candidates taken: find a chain of displacements ending in a
+     * free slot. */
+    path[0] = hash1;
+    while( 1 ) {
+      unsigned alt, eh1, eh2;
+      ci_sock_cmn* s;
+
+      if( depth == CUCKOO_MAX_KICKS || slot2 == hash1 )
+        goto full;
+      entry = &tbl->table[path[depth]];
+      entry_ext = &netif->filter_table_ext[path[depth]];
+      s = ID_TO_SOCK(netif, ID(entry));
+      eh1 = __onload_hash1(tbl->table_size_mask, entry->laddr,
+                           entry_ext->lport, sock_raddr_be32(s),
+                           sock_rport_be16(s), sock_protocol(s));
+      eh2 = __onload_hash2(entry->laddr, entry_ext->lport,
+                           sock_raddr_be32(s), sock_rport_be16(s),
+                           sock_protocol(s));
+      alt = STATE(entry) == OCCUPIED_PREFERRED ? cuckoo_slot2(tbl, eh1, eh2)
+                                               : eh1;
+      /* A slot revisited means the chain has cycled. */
+      for( i = 0; i <= depth; ++i )
+        if( path[i] == alt )
+          goto full;
+      ++depth;
+      path[depth] = alt;
+      if( ! OCCUPIED(&tbl->table[alt]) )
+        break;
+    }
+
+    /* Shift entries back along the chain.  Moving an entry between its two
+     * candidate slots toggles its state. */
+    for( i = depth; i > 0; --i ) {
+      ci_netif_filter_table_entry_fast* src = &tbl->table[path[i - 1]];
+      ci_netif_filter_table_entry_fast* dst = &tbl->table[path[i]];
+      CITP_STATS_NETIF(if( STATE(dst) == EMPTY )
+                         ++netif->state->stats.table_n_slots);
+      set_entry_state(dst, STATE(src) == OCCUPIED_PREFERRED ?
+                           OCCUPIED_REHASHED : OCCUPIED_PREFERRED);
+      set_entry_id(dst, ID(src));
+      dst->laddr = src->laddr;
+      netif->filter_table_ext[path[i]].lport =
+                                  netif->filter_table_ext[path[i - 1]].lport;
+    }
+    target = hash1;
+#if !defined(NDEBUG) || CI_CFG_STATS_NETIF
+    hops += depth;
+#endif
+  }
+
+  entry = &tbl->table[target];
+  entry_ext = &netif->filter_table_ext[target];
+
+  LOG_TC(ci_log(FN_FMT "%d INSERT %s %s:%u->%s:%u hash=%u:%u at=%u hops=%u",
+                FN_PRI_ARGS(netif), OO_SP_FMT(tcp_id),
+                CI_IP_PROTOCOL_STR(protocol),
+                ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+                ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+                hash1, hash2, target, hops));
+
+#if CI_CFG_STATS_NETIF
+  if( hops > netif->state->stats.table_max_hops )
+    netif->state->stats.table_max_hops = hops;
+  if( netif->state->stats.table_mean_hops == 0 )
+    netif->state->stats.table_mean_hops = 1;
+  netif->state->stats.table_mean_hops =
+    (netif->state->stats.table_mean_hops * 9 + hops) / 10;
+  if( STATE(entry) == EMPTY )
+    ++netif->state->stats.table_n_slots;
+  ++netif->state->stats.table_n_entries;
+#endif
+
+  set_entry_state(entry, target == hash1 ? OCCUPIED_PREFERRED :
+                                           OCCUPIED_REHASHED);
+  set_entry_id(entry, OO_SP_TO_INT(tcp_id));
+  entry->laddr = laddr;
+  entry_ext->lport = lport;
+  return 0;
+
+ full:
+  {
+    ci_sock_cmn *s = SP_TO_SOCK_CMN(netif, tcp_id);
+    if( ! (s->s_flags & CI_SOCK_FLAG_SW_FILTER_FULL) ) {
+      LOG_E(ci_log(FN_FMT "%d FULL %s %s:%u->%s:%u kicks=%d",
+                   FN_PRI_ARGS(netif),
+                   OO_SP_FMT(tcp_id), CI_IP_PROTOCOL_STR(protocol),
+                   ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+                   ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+                   depth));
+      s->s_flags |= CI_SOCK_FLAG_SW_FILTER_FULL;
+    }
+    CITP_STATS_NETIF_INC(netif, sw_filter_insert_table_full);
+  }
+  return -ENOBUFS;
+}
+
+
+/* Remove for the two-choice layout: the entry can only be in one of its
+ * two candidate slots, and no tombstones are needed. */
+static void
+ci_ip4_netif_filter_remove_cuckoo(ci_netif_filter_table* tbl,
+                                  ci_netif* netif, oo_sp sock_p,
+                                  unsigned laddr, unsigned lport,
+                                  unsigned raddr, unsigned rport,
+                                  unsigned protocol)
+{
+  unsigned hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
+                                  raddr, rport, protocol);
+  unsigned hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
+  unsigned probe = hash1;
+  int i;
+
+  LOG_TC(ci_log("%s: [%d:%d] REMOVE %s %s:%u->%s:%u hash=%u:%u",
+                __FUNCTION__, NI_ID(netif), OO_SP_FMT(sock_p),
+                CI_IP_PROTOCOL_STR(protocol),
+                ip_addr_str(laddr), (unsigned) CI_BSWAP_BE16(lport),
+                ip_addr_str(raddr), (unsigned) CI_BSWAP_BE16(rport),
+                hash1, hash2));
+
+  for( i = 0; i < 2; ++i ) {
+    ci_netif_filter_table_entry_fast* entry = &tbl->table[probe];
+    if( OCCUPIED(entry) && ID(entry) == (unsigned) OO_SP_TO_INT(sock_p) &&
+        entry->laddr == laddr ) {
+      CITP_STATS_NETIF(--netif->state->stats.table_n_slots);
+      CITP_STATS_NETIF(--netif->state->stats.table_n_entries);
+      set_entry_state(entry, EMPTY);
+      return;
+    }
+    probe = cuckoo_slot2(tbl, hash1, hash2);
+  }
+  /* We allow multiple removes of the same filter -- helps avoid some
+   * complexity in the filter module. */
+}
+
+
 /* Insert for either TCP or UDP */
 static int
 ci_ip4_netif_filter_insert(ci_netif_filter_table* tbl,
@@ -335,6 +568,10 @@ ci_ip4_netif_filter_insert(ci_netif_filter_table* tbl,
 #endif
   unsigned first;
 
+  if( NI_OPTS(netif).sw_filter_cuckoo )
+    return ci_ip4_netif_filter_insert_cuckoo(tbl, netif, tcp_id, laddr, lport,
+                                             raddr, rport, protocol);
+
   hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
                          raddr, rport, protocol);
   hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
@@ -464,6 +701,12 @@ ci_ip4_netif_filter_remove(ci_netif_filter_table* tbl,
 #endif
             );
 
+  if( NI_OPTS(netif).sw_filter_cuckoo ) {
+    ci_ip4_netif_filter_remove_cuckoo(tbl, netif, sock_p, laddr, lport,
+                                      raddr, rport, protocol);
+    return;
+  }
+
   hash1 = __onload_hash1(tbl->table_size_mask, laddr, lport,
                          raddr, rport, protocol);
   hash2 = __onload_hash2(laddr, lport, raddr, rport, protocol);
@@ -543,6 +786,9 @@ ci_netif_filter_insert(ci_netif* netif, oo_sp tcp_id, int af_space,
      * in the both worlds, and IPv4 fails? */
     if( rc < 0 )
       return rc;
+
+    if( protocol == IPPROTO_UDP && CI_IP_IS_MULTICAST(laddr.ip4) )
+      ci_netif_mcast_tbl_insert(netif, tcp_id, laddr.ip4, lport);
   }
 
   return 0;
@@ -579,7 +825,186 @@ ci_netif_filter_remove(ci_netif* netif, oo_sp sock_p, int af_space,
 
     ci_ip4_netif_filter_remove(ip4_tbl, netif, sock_p, laddr.ip4, lport,
                                raddr.ip4, rport, protocol);
+
+    if( protocol == IPPROTO_UDP && CI_IP_IS_MULTICAST(laddr.ip4) )
+      ci_netif_mcast_tbl_remove(netif, sock_p, laddr.ip4, lport);
+  }
+}
+
+
+/**********************************************************************
+ * Multicast demux table (EF_MCAST_DEMUX).
+ *
+ * A small hash table keyed on (multicast group, local port) with the
+ * subscribed sockets stored inline in each entry, so that RX demux of a
+ * multicast UDP packet visits just those sockets rather than probing the
+ * main software filter table.  The filter table remains the source of
+ * truth: the demux table is maintained from ci_netif_filter_insert() and
+ * ci_netif_filter_remove() and whenever it cannot answer authoritatively
+ * (disabled, overflowed entry, or table full) the caller falls back to
+ * ci_netif_filter_for_each_match().
+ */
+
+ci_inline unsigned
+ci_netif_mcast_tbl_hash(unsigned group, unsigned lport)
+{
+  return __onload_hash3(group, lport, 0, 0, IPPROTO_UDP);
+}
+
+
+/* Find the entry for (group, lport), or NULL if there has never been one.
+ * If [free_out] is non-NULL and no entry exists, it is set to the slot an
+ * insert should use (first tombstone on the probe path, else the free
+ * slot), or NULL if the table is full. */
+static ci_netif_mcast_tbl_entry*
+ci_netif_mcast_tbl_lookup(ci_netif* ni, unsigned group, unsigned lport,
+                          ci_netif_mcast_tbl_entry** free_out)
+{
+  unsigned mask = ni->state->mcast_tbl_entries_n - 1;
+  unsigned i = ci_netif_mcast_tbl_hash(group, lport) & mask;
+  unsigned first = i;
+  ci_netif_mcast_tbl_entry* tombstone = NULL;
+  ci_netif_mcast_tbl_entry* entry;
+
+  while( 1 ) {
+    entry = &ni->mcast_tbl[i];
+    if( entry->group == 0 ) {
+      if( free_out != NULL )
+        *free_out = tombstone != NULL ? tombstone : entry;
+      return NULL;
+    }
+    if( entry->group == group && entry->lport == lport )
+      return entry;
+    if( entry->n_socks == 0 && tombstone == NULL )
+      tombstone = entry;
+    i = (i + 1) & mask;
+    if( i == first ) {
+      if( free_out != NULL )
+        *free_out = tombstone;
+      return NULL;
+    }
+  }
+}
+
+
+void
+ci_netif_mcast_tbl_insert(ci_netif* ni, oo_sp sock_p,
+                          unsigned group, unsigned lport)
+{
+  ci_netif_mcast_tbl_entry* entry;
+  ci_netif_mcast_tbl_entry* free_entry;
+
+  if( ni->state->mcast_tbl_entries_n == 0 || ni->state->mcast_tbl_overflowed )
+    return;
+  ci_assert(ci_netif_is_locked(ni));
+
+  entry = ci_netif_mcast_tbl_lookup(ni, group, lport, &free_entry);
+  if( entry == NULL ) {
+    if( free_entry == NULL ) {
+      /* No free slot: give up on the table for the lifetime of the stack
+       * rather than risk missing subscriptions. */
+      ni->state->mcast_tbl_overflowed = 1;
+      LOG_E(ci_log(FN_FMT "multicast demux table full; disabling "
+                   "(EF_MCAST_DEMUX=%u)", FN_PRI_ARGS(ni),
+                   NI_OPTS(ni).mcast_demux));
+      return;
+    }
+    entry = free_entry;
+    entry->group = group;
+    entry->lport = lport;
+    entry->n_socks = 0;
+    entry->flags = 0;
+  }
+  if( entry->n_socks < CI_MCAST_TBL_ENTRY_SOCKS &&
+      ! (entry->flags & CI_MCAST_TBL_ENTRY_OVERFLOW) ) {
+    entry->socks[entry->n_socks] = OO_SP_TO_INT(sock_p);
+  }
+  else {
+    /* Too many subscribers to track: demux for this (group, port) falls
+     * back to the filter table until the last subscriber leaves. */
+    entry->flags |= CI_MCAST_TBL_ENTRY_OVERFLOW;
+  }
+  if( entry->n_socks == 0xff ) {
+    /* Counter would wrap; extremely unlikely, but stay safe. */
+    ni->state->mcast_tbl_overflowed = 1;
+    return;
+  }
+  ++entry->n_socks;
+}
+
+
+void
+ci_netif_mcast_tbl_remove(ci_netif* ni, oo_sp sock_p,
+                          unsigned group, unsigned lport)
+{
+  ci_netif_mcast_tbl_entry* entry;
+  int i;
+
+  if( ni->state->mcast_tbl_entries_n == 0 )
+    return;
+
+  entry = ci_netif_mcast_tbl_lookup(ni, group, lport, NULL);
+  /* As with the filter table, tolerate removal of a filter that is not
+   * present. */
+  if( entry == NULL || entry->n_socks == 0 )
+    return;
+
+  if( ! (entry->flags & CI_MCAST_TBL_ENTRY_OVERFLOW) ) {
+    for( i = 0; i < entry->n_socks; ++i )
+      if( entry->socks[i] == OO_SP_TO_INT(sock_p) )
+        break;
+    if( i == entry->n_socks )
+      return;
+    entry->socks[i] = entry->socks[entry->n_socks - 1];
+  }
+  if( --entry->n_socks == 0 )
+    entry->flags = 0;  /* becomes a reusable tombstone */
+}
+
+
+/* Deliver a multicast UDP packet using the demux table.  Returns the
+ * number of sockets accepted by [callback], or -1 if the table is not
+ * authoritative for this (group, port) and the caller must fall back to
+ * the software filter table.  Matching semantics follow
+ * ci_netif_filter_for_each_match(): one pass for sockets connected to
+ * (saddr, sport), then one for unconnected sockets. */
+int
+ci_netif_mcast_tbl_for_each_match(ci_netif* ni, unsigned daddr, unsigned dport,
+                                  unsigned saddr, unsigned sport,
+                                  int intf_i, int vlan,
+                                  int (*callback)(ci_sock_cmn*, void*),
+                                  void* callback_arg)
+{
+  ci_netif_mcast_tbl_entry* entry;
+  int pass, i, n_delivered = 0;
+
+  if( ni->state->mcast_tbl_entries_n == 0 || ni->state->mcast_tbl_overflowed )
+    return -1;
+
+  entry = ci_netif_mcast_tbl_lookup(ni, daddr, dport, NULL);
+  if( entry == NULL || entry->n_socks == 0 )
+    /* All multicast UDP filters are indexed here, so a miss really does
+     * mean no subscribed sockets in this stack. */
+    return 0;
+  if( entry->flags & CI_MCAST_TBL_ENTRY_OVERFLOW )
+    return -1;
+
+  for( pass = 0; pass < 2; ++pass ) {
+    unsigned raddr = pass == 0 ? saddr : 0;
+    unsigned rport = pass == 0 ? sport : 0;
+    for( i = 0; i < entry->n_socks; ++i ) {
+      ci_sock_cmn* s = ID_TO_SOCK(ni, entry->socks[i]);
+      if( ((raddr - sock_raddr_be32(s)) |
+           (rport - sock_rport_be16(s))) == 0 &&
+          CI_LIKELY(s->rx_bind2dev_ifindex == CI_IFID_BAD ||
+                    ci_sock_intf_check(ni, s, intf_i, vlan)) ) {
+        ++n_delivered;
+        if( callback(s, callback_arg) != 0 )
+          return n_delivered;
+      }
+    }
   }
+  return n_delivered;
 }
 #endif
 
@@ -20,22 +20,40 @@
 
 #if OO_DO_STACK_POLL
 
-static inline bool is_to_primary_vi(ci_ip_pkt_fmt* pkt)
+#ifndef __KERNEL__
+/* See ip.h: doorbell batching for sendmmsg() and EF_POLL_TX_DOORBELL_BATCH. */
+__thread unsigned ci_tx_batching;
+__thread unsigned ci_tx_batch_pending;
+__thread unsigned ci_tx_batch_n;
+__thread ci_netif* ci_tx_batch_ni;
+
+
+void ci_netif_tx_batch_flush(ci_netif* netif)
 {
-#if CI_CFG_TCP_OFFLOAD_RECYCLER
-  return pkt->q_id == CI_Q_ID_NORMAL;
-#else
-  return true;
-#endif
+  int intf_i;
+
+  /* Ringing the doorbell needs no lock: it publishes whatever producer
+   * index is current, and a concurrent locked sender on another thread
+   * ends its own transmit with a doorbell that covers our descriptors
+   * in any case. */
+  OO_STACK_FOR_EACH_INTF_I(netif, intf_i)
+    if( ci_tx_batch_pending & (1u << intf_i) ) {
+      ef_vi_transmit_push(ci_netif_vi(netif, intf_i));
+      CITP_STATS_NETIF_INC(netif, tx_dma_doorbells);
+    }
+  ci_tx_batch_pending = 0;
+  ci_tx_batch_n = 0;
+  ci_tx_batch_ni = NULL;
 }
+#endif
 
 
-static inline int pkt_q_id(ci_ip_pkt_fmt* pkt)
+static inline bool is_to_primary_vi(ci_ip_pkt_fmt* pkt)
 {
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
-  return pkt->q_id;
+  return pkt->q_id == CI_Q_ID_NORMAL;
 #else
-  return 0;
+  return true;
 #endif
 }
 
@@ -116,7 +134,8 @@ static void __ci_netif_dmaq_shove(ci_netif* ni, oo_pktq* dmaq, ef_vi* vi,
     pkt = PKT_CHK(ni, dmaq->head);
     ci_assert(pkt->flags & CI_PKT_FLAG_TX_PENDING);
     ci_assert_equal(intf_i, pkt->intf_i);
-    ci_assert_equal(dmaq, &ni->state->nic[intf_i].dmaq[pkt_q_id(pkt)]);
+    ci_assert(dmaq == &ni->state->nic[intf_i].dmaq[pkt_q_id(pkt)] ||
+              dmaq == ci_netif_dmaq_urgent(ni, intf_i));
     {
       ef_iovec iov[CI_IP_PKT_SEGMENTS_MAX];
       int iov_len;
@@ -161,7 +180,7 @@ static void __ci_netif_dmaq_shove(ci_netif* ni, oo_pktq* dmaq, ef_vi* vi,
           break;
 #if CI_CFG_CTPIO
         if( ctpio && (iov_len < 1 || iov_len > CI_IP_PKT_SEGMENTS_MAX ||
-                      ! ci_netif_may_ctpio(ni, intf_i, pkt->pay_len) ||
+                      ! ci_netif_may_ctpio_pkt(ni, intf_i, pkt) ||
                       pkt->flags & CI_PKT_FLAG_INDIRECT) )
           ctpio = 0;
         ctpio |= !! (ni->state->nic[pkt->intf_i].oo_vi_flags & OO_VI_FLAGS_TX_CTPIO_ONLY);
@@ -215,17 +234,34 @@ static void __ci_netif_dmaq_shove(ci_netif* ni, oo_pktq* dmaq, ef_vi* vi,
 void ci_netif_dmaq_shove1(ci_netif* ni, int intf_i)
 {
   ef_vi* vi = ci_netif_vi(ni, intf_i);
-  if( ef_vi_transmit_space(vi) >= (ef_vi_transmit_capacity(vi) >> 1) )
-    __ci_netif_dmaq_shove(ni, ci_netif_dmaq(ni, intf_i), vi, intf_i,
-                          0 /*is_fresh*/);
+  if( ef_vi_transmit_space(vi) >= (ef_vi_transmit_capacity(vi) >> 1) ) {
+    /* Latency-class packets go first; see EF_TX_LATENCY_PRIO. */
+    if( oo_pktq_not_empty(ci_netif_dmaq_urgent(ni, intf_i)) )
+      __ci_netif_dmaq_shove(ni, ci_netif_dmaq_urgent(ni, intf_i), vi, intf_i,
+                            0 /*is_fresh*/);
+    if( ci_netif_dmaq_not_empty(ni, intf_i) )
+      __ci_netif_dmaq_shove(ni, ci_netif_dmaq(ni, intf_i), vi, intf_i,
+                            0 /*is_fresh*/);
+  }
 }
 
 
 void ci_netif_dmaq_shove2(ci_netif* ni, int intf_i, int is_fresh)
 {
   ef_vi* vi = ci_netif_vi(ni, intf_i);
-  if( ef_vi_transmit_space(vi) > CI_IP_PKT_SEGMENTS_MAX )
-    __ci_netif_dmaq_shove(ni, ci_netif_dmaq(ni, intf_i), vi, intf_i, is_fresh);
+  if( ef_vi_transmit_space(vi) > CI_IP_PKT_SEGMENTS_MAX ) {
+    /* The caller has just enqueued to one of the two queues; [is_fresh]
+     * describes that packet, and the urgent queue is drained first, so
+     * credit freshness to the urgent queue when it has anything in it. */
+    if( oo_pktq_not_empty(ci_netif_dmaq_urgent(ni, intf_i)) ) {
+      __ci_netif_dmaq_shove(ni, ci_netif_dmaq_urgent(ni, intf_i), vi, intf_i,
+                            is_fresh);
+      is_fresh = 0;
+    }
+    if( ci_netif_dmaq_not_empty(ni, intf_i) )
+      __ci_netif_dmaq_shove(ni, ci_netif_dmaq(ni, intf_i), vi, intf_i,
+                            is_fresh);
+  }
 }
 
 
@@ -241,7 +277,7 @@ void ci_netif_dmaq_shove_plugin(ci_netif* ni, int intf_i, int q_id)
 #endif
 
 
-void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
+static void ci_netif_send_direct(ci_netif* netif, ci_ip_pkt_fmt* pkt)
 {
   int intf_i, rc;
   oo_pktq* dmaq;
@@ -284,7 +320,7 @@ void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
   intf_i = pkt->intf_i;
 
   ci_assert_lt(pkt->q_id, CI_MAX_VIS_PER_INTF);
-  dmaq = &netif->state->nic[intf_i].dmaq[pkt_q_id(pkt)];
+  dmaq = ci_netif_dmaq_for_pkt(netif, pkt);
   vi = &netif->nic_hw[intf_i].vis[pkt_q_id(pkt)];
 
   if( oo_pktq_is_empty(dmaq) && ! (pkt->flags & CI_PKT_FLAG_INDIRECT) ) {
@@ -341,11 +377,27 @@ void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
 
 #if CI_CFG_CTPIO
     if( (iov_len > 0) && (iov_len <= CI_IP_PKT_SEGMENTS_MAX) &&
-        ci_netif_may_ctpio(netif, intf_i, pkt->pay_len) &&
+        ci_netif_may_ctpio_pkt(netif, intf_i, pkt) &&
         is_to_primary_vi(pkt) ) {
       rc = tx_ctpio(netif, intf_i, vi, pkt, iov, iov_len);
     }
     else
+#endif
+#ifndef __KERNEL__
+    if( ci_tx_batching && is_to_primary_vi(pkt) ) {
+      /* Doorbell batch in progress (sendmmsg() or a batching poll):
+       * initialise the descriptors but do not ring the doorbell;
+       * ci_netif_tx_batch_flush() rings it once for the whole batch. */
+      if( (rc = ef_vi_transmitv_init(vi, iov, iov_len,
+                                     OO_PKT_ID(pkt))) == 0 ) {
+        ci_netif_ctpio_desist(netif, intf_i);
+        ci_tx_batch_pending |= 1u << intf_i;
+        ci_tx_batch_ni = netif;
+        if( ++ci_tx_batch_n >= CI_TX_BATCH_LIMIT )
+          ci_netif_tx_batch_flush(netif);
+      }
+    }
+    else
 #endif
     if( (rc = ef_vi_transmitv(vi, iov, iov_len, OO_PKT_ID(pkt))) == 0 ) {
       /* After a DMA send, stop attempting CTPIO sends until the TXQ has
@@ -390,6 +442,85 @@ void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
 }
 
 
+/* Cycles the pacing bucket charges for transmitting [pkt]. */
+ci_inline ci_uint64 ci_netif_tx_pace_cost(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+  return (ci_uint64) pkt->pay_len * IPTIMER_STATE(ni)->khz * 1000 /
+         NI_OPTS(ni).tx_pacing_rate;
+}
+
+
+static void ci_netif_tx_pace_arm(ci_netif* ni, ci_uint64 now_frc)
+{
+  ci_netif_state* nis = ni->state;
+  ci_iptime_t ticks = 1;
+
+  if( nis->pacing_next_frc > now_frc )
+    ticks += (ci_iptime_t) ((nis->pacing_next_frc - now_frc) >>
+                            IPTIMER_STATE(ni)->ci_ip_time_frc2tick);
+  if( ! ci_ip_timer_pending(ni, &nis->pacing_tid) )
+    ci_ip_timer_set(ni, &nis->pacing_tid, ci_ip_time_now(ni) + ticks);
+}
+
+
+/* Returns true if [pkt] has been queued for a timed release rather than
+** sent.  Packets are held whenever the pacing bucket is ahead of the
+** clock, or when earlier packets are already waiting (to preserve
+** ordering). */
+static int ci_netif_tx_pace(ci_netif* netif, ci_ip_pkt_fmt* pkt)
+{
+  ci_netif_state* nis = netif->state;
+  ci_uint64 now_frc;
+
+  ci_frc64(&now_frc);
+  if( oo_pktq_is_empty(&nis->pacing_q) && nis->pacing_next_frc <= now_frc ) {
+    /* Under the rate: send now and charge the bucket.  The bucket never
+     * drains below "now", so idle periods do not accumulate into an
+     * unbounded burst. */
+    nis->pacing_next_frc = now_frc + ci_netif_tx_pace_cost(netif, pkt);
+    return 0;
+  }
+  /* Link via [netif.tx.dmaq_next], as the dmaq does: TCP packets remain on
+   * the retransmit queue (linked via [next]) while being transmitted. */
+  __oo_pktq_put(netif, &nis->pacing_q, pkt, netif.tx.dmaq_next);
+  CITP_STATS_NETIF_INC(netif, tx_pace_delayed);
+  ci_netif_tx_pace_arm(netif, now_frc);
+  return 1;
+}
+
+
+void __ci_netif_send(ci_netif* netif, ci_ip_pkt_fmt* pkt)
+{
+  if( NI_OPTS(netif).tx_pacing_rate != 0 && ci_netif_tx_pace(netif, pkt) )
+    return;
+  ci_netif_send_direct(netif, pkt);
+}
+
+
+/* Timer callback: release any packets whose departure time has passed. */
+void ci_netif_tx_pacing_timeout(ci_netif* netif)
+{
+  ci_netif_state* nis = netif->state;
+  ci_uint64 now_frc;
+
+  ci_assert(ci_netif_is_locked(netif));
+
+  ci_frc64(&now_frc);
+  while( oo_pktq_not_empty(&nis->pacing_q) &&
+         nis->pacing_next_frc <= now_frc ) {
+    ci_ip_pkt_fmt* pkt = PKT_CHK(netif, nis->pacing_q.head);
+    __oo_pktq_next(netif, &nis->pacing_q, pkt, netif.tx.dmaq_next);
+    /* Charge the bucket from its previous deadline rather than from "now"
+     * so that timer latency does not erode the configured rate. */
+    nis->pacing_next_frc += ci_netif_tx_pace_cost(netif, pkt);
+    ci_netif_send_direct(netif, pkt);
+    ci_frc64(&now_frc);
+  }
+  if( oo_pktq_not_empty(&nis->pacing_q) )
+    ci_netif_tx_pace_arm(netif, now_frc);
+}
+
+
 /* Transmit the given packet right now, failing if it can't be done
  * (ci_netif_send() will put deferrals on to the dmaq for later). This is a
  * low-level function used by VIs which are used for communicating with
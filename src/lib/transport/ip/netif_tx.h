@@ -251,6 +251,21 @@ ci_inline int /*bool*/ ci_netif_may_ctpio(ci_netif* ni, int intf_i,
 #endif
 }
 
+/* As ci_netif_may_ctpio(), but additionally applies per-protocol policy:
+ * EF_UDP_CTPIO=0 excludes UDP datagrams from cut-through sends.  NICs on
+ * which CTPIO is the only transmit mechanism are exempt.
+ */
+ci_inline int /*bool*/ ci_netif_may_ctpio_pkt(ci_netif* ni, int intf_i,
+                                              const ci_ip_pkt_fmt* pkt)
+{
+#if CI_CFG_CTPIO
+  if( (pkt->flags & CI_PKT_FLAG_UDP) && ! NI_OPTS(ni).udp_ctpio &&
+      ! (ni->state->nic[intf_i].oo_vi_flags & OO_VI_FLAGS_TX_CTPIO_ONLY) )
+    return 0;
+#endif
+  return ci_netif_may_ctpio(ni, intf_i, pkt->pay_len);
+}
+
 ci_inline void ci_netif_ctpio_desist(ci_netif* ni, int intf_i)
 {
 #if CI_CFG_CTPIO
@@ -290,8 +305,21 @@ void ci_netif_dmaq_shove_plugin(ci_netif* ni, int intf_i, int q_id);
 #endif
 
 
+ci_inline int pkt_q_id(ci_ip_pkt_fmt* pkt)
+{
+#if CI_CFG_TCP_OFFLOAD_RECYCLER
+  return pkt->q_id;
+#else
+  return 0;
+#endif
+}
+
+
 #define ci_netif_dmaq(ni, nic_i)  (&(ni)->state->nic[nic_i].dmaq[0])
 
+#define ci_netif_dmaq_urgent(ni, nic_i)                 \
+        (&(ni)->state->nic[nic_i].dmaq_urgent)
+
 
 #define ci_netif_dmaq_is_empty(ni, nic_i)               \
         oo_pktq_is_empty(ci_netif_dmaq((ni), (nic_i)))
@@ -300,6 +328,27 @@ void ci_netif_dmaq_shove_plugin(ci_netif* ni, int intf_i, int q_id);
         oo_pktq_not_empty(ci_netif_dmaq((ni), (nic_i)))
 
 
+/* Selects the overflow queue for [pkt].  When EF_TX_LATENCY_PRIO is set,
+ * packets from sockets whose SO_PRIORITY is at least that value go to the
+ * urgent queue, which is drained ahead of the normal one.  Socketless
+ * packets (e.g. RSTs) and packets for plugin VIs always use [dmaq]. */
+ci_inline oo_pktq* ci_netif_dmaq_for_pkt(ci_netif* ni, ci_ip_pkt_fmt* pkt)
+{
+  if( NI_OPTS(ni).tx_latency_prio != 0 && pkt_q_id(pkt) == CI_Q_ID_NORMAL ) {
+    oo_sp sp = pkt->flags & CI_PKT_FLAG_UDP ?
+               pkt->pf.udp.tx_sock_id : pkt->pf.tcp_tx.sock_id;
+    if( OO_SP_NOT_NULL(sp) && IS_VALID_SOCK_P(ni, sp) ) {
+      citp_waitable* w = SP_TO_WAITABLE(ni, sp);
+      if( CI_TCP_STATE_IS_SOCKET(w->state) &&
+          CI_CONTAINER(ci_sock_cmn, b, w)->so_priority >=
+          NI_OPTS(ni).tx_latency_prio )
+        return ci_netif_dmaq_urgent(ni, pkt->intf_i);
+    }
+  }
+  return &ni->state->nic[pkt->intf_i].dmaq[pkt_q_id(pkt)];
+}
+
+
 #define __ci_netif_dmaq_put(ni, q, pkt)                         \
   do {                                                          \
     __oo_pktq_put((ni), (q), (pkt), netif.tx.dmaq_next);        \
@@ -310,7 +359,7 @@ void ci_netif_dmaq_shove_plugin(ci_netif* ni, int intf_i, int q_id);
 ci_inline void ci_netif_dmaq_and_vi_for_pkt(ci_netif* ni, ci_ip_pkt_fmt* pkt,
                                             oo_pktq** dmaq, ef_vi** vi) {
   ci_assert_equal(pkt->q_id, CI_Q_ID_NORMAL);
-  *dmaq = ci_netif_dmaq(ni, pkt->intf_i);
+  *dmaq = ci_netif_dmaq_for_pkt(ni, pkt);
   *vi = ci_netif_vi(ni, pkt->intf_i);
 }
 
@@ -11,6 +11,9 @@
 *//*
 \**************************************************************************/
 
+#define _GNU_SOURCE  /* for sched_getcpu */
+
+#include <sched.h>
 #include <ci/internal/ip.h>
 #include <onload/ul/per_thread.h>
 
@@ -24,6 +27,53 @@ __thread struct oo_per_thread oo_per_thread;
 
 citp_init_thread_callback init_thread_callback;
 
+/* Spin-placement topology tables; filled in by the unix layer at startup
+ * (citp_spin_topology_init()) from sysfs, consumed by spin loops via
+ * oo_spin_topology_enter()/oo_spin_topology_yield(). */
+int oo_spin_topology_enabled;
+ci_int16 oo_spin_cpu_sibling[OO_SPIN_TOPOLOGY_MAX_CPUS];
+ci_uint8 oo_spin_cpu_e_core[OO_SPIN_TOPOLOGY_MAX_CPUS];
+
+/* Per-CPU: nonzero while an Onload thread is spinning there.  Updated
+ * without atomics; a stale entry only mis-steers the yield heuristic. */
+static ci_uint8 oo_spinner_on_cpu[OO_SPIN_TOPOLOGY_MAX_CPUS];
+
+
+void oo_spin_topology_assess(struct oo_per_thread* pt)
+{
+  int cpu = sched_getcpu();
+  int sib;
+  ci_uint8 yield = 0;
+
+  if( cpu < 0 || cpu >= OO_SPIN_TOPOLOGY_MAX_CPUS )
+    return;
+  if( cpu + 1 == pt->spin_cpu_plus1 )
+    return;
+
+  if( pt->spin_cpu_plus1 != 0 )
+    oo_spinner_on_cpu[pt->spin_cpu_plus1 - 1] = 0;
+  pt->spin_cpu_plus1 = cpu + 1;
+  oo_spinner_on_cpu[cpu] = 1;
+
+  if( oo_spin_cpu_e_core[cpu] ) {
+    yield = 1;
+    if( ! pt->spin_yield )
+      ci_log("WARNING: spinning thread is running on efficiency core %d; "
+             "using yield-based waiting.  Check thread affinities, or set "
+             "EF_SPIN_TOPOLOGY_AWARE=0 to spin regardless.", cpu);
+  }
+  else if( (sib = oo_spin_cpu_sibling[cpu]) >= 0 &&
+           oo_spinner_on_cpu[sib] ) {
+    yield = 1;
+    if( ! pt->spin_yield )
+      ci_log("WARNING: spinning thread is running on CPU %d, an SMT sibling "
+             "of CPU %d which is also running a spinning Onload thread; "
+             "using yield-based waiting.  Check thread affinities, or set "
+             "EF_SPIN_TOPOLOGY_AWARE=0 to spin regardless.", cpu, sib);
+  }
+  pt->spin_yield = yield;
+}
+
 
 int oo_per_thread_init(void)
 {
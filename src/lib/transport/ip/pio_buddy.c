@@ -173,6 +173,76 @@ ci_pio_buddy_alloc(ci_netif* ni, ci_pio_buddy_allocator* b, ci_uint8 order)
 }
 
 
+ci_int32
+ci_pio_buddy_alloc_array(ci_netif* ni, ci_pio_buddy_allocator* b,
+                         ci_uint8 order, int n)
+{
+#if CI_CFG_PIO
+  ci_uint8 arr_order = order;
+  ci_uint32 blocks, addr, stride, i;
+  ci_int32 base;
+
+  ci_assert_gt(n, 0);
+
+  if( n == 1 )
+    return ci_pio_buddy_alloc(ni, b, order);
+
+  /* Round up to the power-of-two span that covers [n] blocks. */
+  while( (1u << (arr_order - order)) < (unsigned) n )
+    ++arr_order;
+  if( arr_order - CI_CFG_MIN_PIO_BLOCK_ORDER > CI_PIO_BUDDY_MAX_ORDER )
+    return -ENOMEM;
+
+  base = ci_pio_buddy_alloc(ni, b, arr_order);
+  if( base < 0 )
+    return base;
+
+  DEBUG_ALLOC(ci_log("buddy - alloc array %x n %d order %d span order %d",
+                     base, n, order, arr_order););
+
+  /* Record each constituent block as a separate allocation of [order] so
+   * that callers can free them individually; the usual merging in
+   * ci_pio_buddy_free() reassembles the span.  Blocks beyond [n] go
+   * straight back to the free lists.
+   */
+  blocks = 1u << (arr_order - order);
+  stride = 1u << (order - CI_CFG_MIN_PIO_BLOCK_ORDER);
+  addr = base / (1u << CI_CFG_MIN_PIO_BLOCK_ORDER);
+  for( i = 0; i < blocks; ++i )
+    b->orders[addr + i * stride] = order - CI_CFG_MIN_PIO_BLOCK_ORDER;
+  for( i = n; i < blocks; ++i )
+    ci_pio_buddy_free(ni, b, base + i * (1 << order), order);
+
+  return base;
+#else
+  return -ENOSPC;
+#endif
+}
+
+
+void
+ci_pio_buddy_stats(ci_netif* ni, ci_pio_buddy_allocator* b,
+                   ci_uint32* bytes_free_out, ci_uint32* largest_free_out)
+{
+  ci_uint32 bytes_free = 0;
+  ci_uint32 largest_free = 0;
+  ci_uint8 o;
+
+  if( b->initialised ) {
+    for( o = 0; o <= CI_PIO_BUDDY_MAX_ORDER; ++o ) {
+      struct oo_p_dllink_state l;
+      oo_p_dllink_for_each(ni, l, FREE_LIST(ni, b, o)) {
+        bytes_free += 1u << (o + CI_CFG_MIN_PIO_BLOCK_ORDER);
+        largest_free = 1u << (o + CI_CFG_MIN_PIO_BLOCK_ORDER);
+      }
+    }
+  }
+
+  *bytes_free_out = bytes_free;
+  *largest_free_out = largest_free;
+}
+
+
 void
 ci_pio_buddy_free(ci_netif* ni, ci_pio_buddy_allocator* b, ci_int32 offset,
                   ci_uint8 order)
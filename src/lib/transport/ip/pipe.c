@@ -171,6 +171,10 @@ ci_inline void __oo_pipe_wake_peer(ci_netif* ni, struct oo_pipe* p,
   if( wake & CI_SB_FLAG_WAKE_TX )
     ++p->b.sleep_seq.rw.tx;
   ci_mb();
+  /* Futex waiters (EF_PIPE_FUTEX) do not register in wake_request; ding
+   * their per-direction doorbell directly (no syscall when nobody waits).
+   */
+  citp_waitable_futex_wake(ni, &p->b, wake);
   if( p->b.wake_request & wake ) {
     p->b.sb_flags |= wake;
     citp_waitable_wakeup(ni, &p->b);
@@ -336,12 +340,20 @@ int ci_pipe_read(ci_netif* ni, struct oo_pipe* p,
   ci_ip_pkt_fmt* pkt;
   int do_wake = 0;
   ci_uint32 offset;
+  int spsc = 0;
 
   ci_assert(p);
   ci_assert(ni);
   ci_assert(iov);
   ci_assert_gt(iovlen, 0);
 
+#ifndef __KERNEL__
+  /* EF_PIPE_SPSC promises that we are the only reader, so the socket lock
+   * (which only ever excludes other readers) can be skipped.  The writer is
+   * synchronised with via bytes_added/bytes_removed, not via the lock. */
+  spsc = NI_OPTS(ni).pipe_spsc;
+#endif
+
   LOG_PIPE("%s[%u]: ENTER data_len=%d aflags=%x",
            __FUNCTION__, p->b.bufid, oo_pipe_data_len(p), p->aflags);
   pipe_dump(ni, p);
@@ -355,16 +367,19 @@ int ci_pipe_read(ci_netif* ni, struct oo_pipe* p,
       goto out;
   }
 
-  rc = ci_sock_lock(ni, &p->b);
+  if( ! spsc ) {
+    rc = ci_sock_lock(ni, &p->b);
 #ifdef __KERNEL__
-  if( rc < 0 ) {
-    CI_SET_ERROR(rc, ERESTARTSYS);
-    goto out;
-  }
+    if( rc < 0 ) {
+      CI_SET_ERROR(rc, ERESTARTSYS);
+      goto out;
+    }
 #endif
+  }
   /* Recheck available data now that we have the lock. */
   if( (bytes_available = oo_pipe_data_len(p)) == 0 ) {
-    ci_sock_unlock(ni, &p->b);
+    if( ! spsc )
+      ci_sock_unlock(ni, &p->b);
     goto again;
   }
 
@@ -413,7 +428,8 @@ int ci_pipe_read(ci_netif* ni, struct oo_pipe* p,
  wake_and_unlock_out:
   if( do_wake || bytes_available == rc )
     __oo_pipe_wake_peer(ni, p, CI_SB_FLAG_WAKE_TX);
-  ci_sock_unlock(ni, &p->b);
+  if( ! spsc )
+    ci_sock_unlock(ni, &p->b);
  out:
   LOG_PIPE("%s[%u]: EXIT return %d", __FUNCTION__, p->b.bufid, rc);
   return rc;
@@ -1750,6 +1766,58 @@ int ci_pipe_zc_move(ci_netif* ni, struct oo_pipe* pipe_src,
 #endif
 
 
+#ifndef __KERNEL__
+/* Lock-free write fast path, used when EF_PIPE_SPSC promises that we are the
+ * only thread writing to this pipe.  Handles the common case where the whole
+ * write fits in the free space of the current write buffer, so no buffer
+ * advance or allocation is needed and the stack lock can be avoided entirely.
+ * All writer-side state (write_ptr, pay_len) is private to the writing thread
+ * under the SPSC promise, and the reader already synchronises with us through
+ * the bytes_added/bytes_removed protocol rather than through a lock.
+ *
+ * Returns the number of bytes written, or -1 if the slow path must be taken
+ * (in which case no bytes have been consumed from [iov]).
+ */
+static int oo_pipe_write_fast(ci_netif* ni, struct oo_pipe* p,
+                              const struct iovec* iov, size_t iovlen)
+{
+  ci_ip_pkt_fmt* pkt;
+  ci_uint8* write_point;
+  ci_uint32 total = 0;
+  int i;
+
+  if( p->aflags & (CI_PFD_AFLAG_CLOSED << CI_PFD_AFLAG_READER_SHIFT) )
+    return -1;
+  if( ! OO_PP_NOT_NULL(p->write_ptr.pp) )
+    return -1;
+
+  for( i = 0; i < iovlen; i++ )
+    total += iov[i].iov_len;
+
+  pkt = PKT_CHK_NNL(ni, p->write_ptr.pp);
+  if( total == 0 || total > oo_pipe_buf_space(pkt) )
+    return -1;
+
+  write_point = pipe_get_point(ni, p, pkt, pkt->pf.pipe.pay_len);
+  for( i = 0; i < iovlen; i++ ) {
+    memcpy(write_point, iov[i].iov_base, iov[i].iov_len);
+    write_point += iov[i].iov_len;
+  }
+  pkt->pf.pipe.pay_len += total;
+
+  /* If we filled the pipe, mark it as full. */
+  if( oo_pipe_buf_space(pkt) == 0 &&
+      pkt->next == OO_ACCESS_ONCE(p->read_ptr.pp) )
+    p->write_ptr.pp_wait = pkt->next;
+
+  ci_wmb();
+  p->bytes_added += total;
+  __oo_pipe_wake_peer(ni, p, CI_SB_FLAG_WAKE_RX);
+  return total;
+}
+#endif
+
+
 int ci_pipe_write(ci_netif* ni, struct oo_pipe* p,
                   const struct iovec *iov,
                   size_t iovlen)
@@ -1777,6 +1845,14 @@ int ci_pipe_write(ci_netif* ni, struct oo_pipe* p,
            OO_PP_FMT(p->write_ptr.pp_wait),
            OO_PP_FMT(p->read_ptr.pp));
 
+#ifndef __KERNEL__
+  if( NI_OPTS(ni).pipe_spsc &&
+      (rc = oo_pipe_write_fast(ni, p, iov, iovlen)) >= 0 ) {
+    LOG_PIPE("%s[%u]: EXIT fast return %d", __FUNCTION__, p->b.bufid, rc);
+    return rc;
+  }
+#endif
+
   rc = ci_netif_lock(ni);
 #ifdef __KERNEL__
   if( rc < 0 ) {
@@ -87,6 +87,7 @@ void ci_sock_cmn_init(ci_netif* ni, ci_sock_cmn* s, int can_poison)
   s->rx_bind2dev_vlan = 0;
 
   s->cmsg_flags = 0u;
+  s->iso_domain = 0;
 #if CI_CFG_TIMESTAMPING
   s->timestamping_flags = 0u;
 #endif
@@ -109,6 +110,10 @@ void ci_sock_cmn_init(ci_netif* ni, ci_sock_cmn* s, int can_poison)
 
   oo_p_dllink_init(ni, oo_p_dllink_sb(ni, &s->b, &s->reap_link));
 
+  s->wm_sendq_pkts = s->wm_rcvq_pkts = s->wm_pool_free_pkts = 0;
+  s->wm_fired = 0;
+  oo_p_dllink_init(ni, oo_p_dllink_sb(ni, &s->b, &s->wm_link));
+
   /* Not functionally necessary, but avoids garbage addresses in stackdump. */
   sock_laddr_be32(s) = sock_raddr_be32(s) = 0;
   sock_lport_be16(s) = sock_rport_be16(s) = 0;
@@ -669,98 +669,111 @@ void ci_tcp_listen_shutdown_queues(ci_netif* netif, ci_tcp_socket_listen* tls)
   LOG_TV(log("%s: %d clear out accept queue (%d entries)", __FUNCTION__,
              S_FMT(tls), ci_tcp_acceptq_n(tls)));
 
-  while( ci_tcp_acceptq_not_empty(tls) ) {
-    citp_waitable* w;
-    ci_tcp_state* ats;    /* accepted ts */
+  /* Promoted-but-unpublished sockets belong on the accept queue for the
+   * drain below. */
+  if( netif->state->promote_batch_listener == S_SP(tls) )
+    ci_tcp_acceptq_flush_batch(netif);
 
-    w = ci_tcp_acceptq_get(netif, tls);
+  while( ci_tcp_acceptq_not_empty(tls) ) {
+    citp_waitable* batch[32];
+    int n_batch, b;
+
+    /* Dequeue a batch at a time: one [acceptq_n_out] update per batch,
+     * and the gather walk leaves the waitables cache-warm for the
+     * teardown work below. */
+    n_batch = ci_tcp_acceptq_get_batch(netif, tls, batch,
+                                       sizeof(batch) / sizeof(batch[0]));
+    for( b = 0; b < n_batch; ++b ) {
+      citp_waitable* w = batch[b];
+      ci_tcp_state* ats;    /* accepted ts */
 
 #if defined(__KERNEL__) && CI_CFG_ENDPOINT_MOVE
-    if( w->sb_aflags & CI_SB_AFLAG_MOVED_AWAY ) {
-      tcp_helper_resource_t *thr = NULL;
-      oo_sp sp;
-      ci_uint32 stack_id;
-      ci_netif *ani;        /* netif of the accepted socket */
+      if( w->sb_aflags & CI_SB_AFLAG_MOVED_AWAY ) {
+        tcp_helper_resource_t *thr = NULL;
+        oo_sp sp;
+        ci_uint32 stack_id;
+        ci_netif *ani;        /* netif of the accepted socket */
 
 #ifdef NDEBUG
-      if( in_interrupt() ) {
-        LOG_U(log("%s: invalid acceptq member", __FUNCTION__));
-        citp_waitable_obj_free(netif, w);
-        continue;
-      }
+        if( in_interrupt() ) {
+          LOG_U(log("%s: invalid acceptq member", __FUNCTION__));
+          citp_waitable_obj_free(netif, w);
+          continue;
+        }
 #else
-      ci_assert(!in_interrupt());
+        ci_assert(!in_interrupt());
 #endif
 
-      sp = w->moved_to_sock_id;
-      stack_id = w->moved_to_stack_id;
-      citp_waitable_obj_free(netif, w);
-      /* do not use w any more */
-
-      LOG_TV(log("%s: alien socket %d:%d in accept queue %d:%d", __FUNCTION__,
-                 stack_id, OO_SP_FMT(sp), NI_ID(netif), S_FMT(tls)));
-
-      if( efab_thr_table_lookup(NULL, NULL, stack_id,
-                                EFAB_THR_TABLE_LOOKUP_CHECK_USER,
-                                OO_THR_REF_BASE, &thr) != 0 ) {
-        LOG_U(log("%s: listening socket %d:%d can't find "
-                  "acceptq memeber %d:%d", __FUNCTION__,
-                  netif->state->stack_id, tls->s.b.bufid, stack_id, sp));
-        continue;
-      }
-      ani = &thr->netif;
-
-      if( !(SP_TO_WAITABLE(ani, sp)->state & CI_TCP_STATE_TCP) ||
-          SP_TO_WAITABLE(ani, sp)->state == CI_TCP_LISTEN ) {
-        LOG_U(log("%s: listening socket %d:%d has non-TCP "
-                  "acceptq memeber %d:%d", __FUNCTION__,
-                  netif->state->stack_id, tls->s.b.bufid, stack_id, sp));
+        sp = w->moved_to_sock_id;
+        stack_id = w->moved_to_stack_id;
+        citp_waitable_obj_free(netif, w);
+        /* do not use w any more */
+
+        LOG_TV(log("%s: alien socket %d:%d in accept queue %d:%d", __FUNCTION__,
+                   stack_id, OO_SP_FMT(sp), NI_ID(netif), S_FMT(tls)));
+
+        if( efab_thr_table_lookup(NULL, NULL, stack_id,
+                                  EFAB_THR_TABLE_LOOKUP_CHECK_USER,
+                                  OO_THR_REF_BASE, &thr) != 0 ) {
+          LOG_U(log("%s: listening socket %d:%d can't find "
+                    "acceptq memeber %d:%d", __FUNCTION__,
+                    netif->state->stack_id, tls->s.b.bufid, stack_id, sp));
+          continue;
+        }
+        ani = &thr->netif;
+
+        if( !(SP_TO_WAITABLE(ani, sp)->state & CI_TCP_STATE_TCP) ||
+            SP_TO_WAITABLE(ani, sp)->state == CI_TCP_LISTEN ) {
+          LOG_U(log("%s: listening socket %d:%d has non-TCP "
+                    "acceptq memeber %d:%d", __FUNCTION__,
+                    netif->state->stack_id, tls->s.b.bufid, stack_id, sp));
+          oo_thr_ref_drop(thr->ref, OO_THR_REF_BASE);
+          continue;
+        }
+        ats = SP_TO_TCP(ani, sp);
+
+        /* Do not remove IN_ACCEPTQ flag: ci_tcp_close should know that we
+         * are sending RST, not FIN. */
+        ci_bit_clear(&ats->s.b.sb_aflags, CI_SB_AFLAG_ORPHAN_BIT);
+        efab_tcp_helper_close_endpoint(thr, sp, 0);
         oo_thr_ref_drop(thr->ref, OO_THR_REF_BASE);
         continue;
       }
-      ats = SP_TO_TCP(ani, sp);
-
-      /* Do not remove IN_ACCEPTQ flag: ci_tcp_close should know that we
-       * are sending RST, not FIN. */
-      ci_bit_clear(&ats->s.b.sb_aflags, CI_SB_AFLAG_ORPHAN_BIT);
-      efab_tcp_helper_close_endpoint(thr, sp, 0);
-      oo_thr_ref_drop(thr->ref, OO_THR_REF_BASE);
-      continue;
-    }
 #endif
 
-    ats = &CI_CONTAINER(citp_waitable_obj, waitable, w)->tcp;
+      ats = &CI_CONTAINER(citp_waitable_obj, waitable, w)->tcp;
 
-    ci_assert(ci_tcp_is_cached(ats) ||
-              (ats->s.b.sb_aflags & CI_SB_AFLAG_ORPHAN));
-    ci_assert(ats->s.b.sb_aflags & CI_SB_AFLAG_TCP_IN_ACCEPTQ);
+      ci_assert(ci_tcp_is_cached(ats) ||
+                (ats->s.b.sb_aflags & CI_SB_AFLAG_ORPHAN));
+      ci_assert(ats->s.b.sb_aflags & CI_SB_AFLAG_TCP_IN_ACCEPTQ);
 
 #if CI_CFG_FD_CACHING
-    /* We leave the acceptq flag for cached eps - the state free will be
-     * triggered from the close once we've closed the fd.
-     */
-    if( !ci_tcp_is_cached(ats) )
+      /* We leave the acceptq flag for cached eps - the state free will be
+       * triggered from the close once we've closed the fd.
+       */
+      if( !ci_tcp_is_cached(ats) )
 #endif
-      /* Remove acceptq flag to allow state free on drop */
-        ci_bit_clear(&ats->s.b.sb_aflags, CI_SB_AFLAG_TCP_IN_ACCEPTQ_BIT);
+        /* Remove acceptq flag to allow state free on drop */
+          ci_bit_clear(&ats->s.b.sb_aflags, CI_SB_AFLAG_TCP_IN_ACCEPTQ_BIT);
 
-    if( ats->s.b.state != CI_TCP_CLOSED &&
-        ats->s.b.state != CI_TCP_TIME_WAIT ) {
-      LOG_TV(log("%s: send reset to accepted connection", __FUNCTION__));
-      ci_tcp_send_rst(netif, ats);
-    }
+      if( ats->s.b.state != CI_TCP_CLOSED &&
+          ats->s.b.state != CI_TCP_TIME_WAIT ) {
+        LOG_TV(log("%s: send reset to accepted connection", __FUNCTION__));
+        ci_tcp_send_rst(netif, ats);
+      }
 
-    ci_tcp_drop(netif, ats, ECONNRESET);
+      ci_tcp_drop(netif, ats, ECONNRESET);
 
 #if CI_CFG_FD_CACHING
-    if( ci_tcp_is_cached(ats) ) {
-      LOG_EP(ci_log ("listen_shutdown - uncache from acceptq"));
-      uncache_ep(netif, tls, ats);
+      if( ci_tcp_is_cached(ats) ) {
+        LOG_EP(ci_log ("listen_shutdown - uncache from acceptq"));
+        uncache_ep(netif, tls, ats);
 
-      /* Remove acceptq flag to allow state free on drop */
-      ci_bit_clear(&ats->s.b.sb_aflags, CI_SB_AFLAG_TCP_IN_ACCEPTQ_BIT);
-    }
+        /* Remove acceptq flag to allow state free on drop */
+        ci_bit_clear(&ats->s.b.sb_aflags, CI_SB_AFLAG_TCP_IN_ACCEPTQ_BIT);
+      }
 #endif
+    }
   }
 
   ci_assert_equal(ci_tcp_acceptq_n(tls), 0);
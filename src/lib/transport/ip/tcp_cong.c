@@ -0,0 +1,243 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2020 Xilinx, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  Pluggable TCP congestion control.
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/*! \cidoxg_lib_transport_ip */
+
+#include "ip_internal.h"
+
+#define LPF "TCP CONG "
+
+
+/*
+** NewReno.  This is the historical behaviour: RFC3465 (ABC) window growth
+** with the RFC2581 halving on loss.  The on-ack handler was moved here
+** verbatim from tcp_rx.c when congestion control became pluggable.
+*/
+
+/* function to open the congestion window following the
+** reception of an ack for new data. Implements RFC3465 (ABC)
+*/
+static void ci_tcp_cc_newreno_on_ack(ci_netif *ni, ci_tcp_state* ts,
+                                     unsigned acked)
+{
+#if CI_CFG_CONG_AVOID_NOTIFIED
+  /* If congestion has been notified (but no loss detected yet)
+     gradually scale the cwnd back */
+  if( ts->congstate == CI_TCP_CONG_NOTIFIED ){
+    if(SEQ_LE(tcp_snd_una(ts), ts->congrecover))
+      ts->congstate = CI_TCP_CONG_OPEN;
+  }
+  else
+#endif
+  if( ts->cwnd >= ts->ssthresh ) {
+    /* Hack - Increase less aggresively on small round trip times */
+#if CI_CFG_CONG_AVOID_SCALE_BACK
+    unsigned tmp = 0, cwnd_scaled;
+    /* tcp_srtt(ts) would relatively easy exceed 32 for a round trip time
+     * on longer links */
+    if( tcp_srtt(ts) < 32 )
+      tmp = NI_OPTS(ni).cong_avoid_scale_back >> tcp_srtt(ts);
+    cwnd_scaled = CI_MAX(1U, tmp) * ts->cwnd;
+#else
+    unsigned cwnd_scaled = ts->cwnd;
+#endif
+    /* Congestion avoidance.  RFC3465 says: increase the congestion window
+    ** by one segment each RTT.  i.e. wait for bytes_acked to be > cwnd
+    ** (which takes one RTT), then reset bytes_acked by subtracting the
+    ** cwnd from it, and add one segment to cwnd.
+    */
+    LOG_TV(log(LPF "%d OPENCWND: CA eff_mss=%u bytes_acked=%u cwnd=%u",
+               S_FMT(ts), tcp_eff_mss(ts), ts->bytes_acked, ts->cwnd));
+    if( ts->bytes_acked >= cwnd_scaled ) {
+      ts->bytes_acked -= cwnd_scaled;
+      ts->cwnd += tcp_eff_mss(ts);
+    }
+  }
+  else {
+    /* Slow-start. */
+    unsigned cwnd_inc;
+    LOG_TV(log(LPF "%d OPENCWND: SS eff_mss=%u bytes_acked=%u cwnd=%u",
+               S_FMT(ts), tcp_eff_mss(ts), ts->bytes_acked, ts->cwnd));
+#if CI_CFG_CONG_AVOID_SLOW_START_MODE == 2
+    cwnd_inc = CI_MIN(ts->ssthresh - ts->cwnd, ts->bytes_acked);
+    ts->cwnd += cwnd_inc;
+    ts->bytes_acked -= cwnd_inc;
+#else
+    if( CI_CFG_CONG_AVOID_SLOW_START_MODE == 0 && ts->stats.rtos == 0 )
+      /* RFC3465 sec 2.2: May only increase cwnd by more than mss if we've
+      * never had any RTOs on this connection.
+      */
+      cwnd_inc = tcp_eff_mss(ts) * CI_CFG_CONG_AVOID_RFC3465_L_VALUE;
+    else
+      cwnd_inc = tcp_eff_mss(ts);
+    cwnd_inc = CI_MIN(cwnd_inc, ts->bytes_acked);
+    ts->cwnd += cwnd_inc;
+    ts->bytes_acked = 0;
+#endif
+  }
+
+  LOG_TV(log(LPF "%d OPENCWND: end cwnd=%u", S_FMT(ts), ts->cwnd));
+
+  ci_assert_le(tcp_eff_mss(ts), CI_MAX_ETH_FRAME_LEN);
+  ci_assert_ge(ts->cwnd, tcp_eff_mss(ts));
+  ci_assert_ge(ts->ssthresh, (ci_uint32)(tcp_eff_mss(ts) << 1));
+}
+
+
+static unsigned ci_tcp_cc_newreno_losswnd(ci_netif* ni, ci_tcp_state* ts)
+{
+  return ci_tcp_losswnd(ts);
+}
+
+
+/*
+** BBR-style rate-based congestion control.
+**
+** The window is sized from a model of the path rather than from loss:
+** cwnd = 2 * BtlBw * RTprop, where BtlBw is a decaying maximum of
+** delivery-rate samples (bytes newly acked over an srtt-long epoch) and
+** RTprop is the minimum RTT seen in the last ten seconds.  One epoch in
+** every eight runs with a 5/4 window gain to probe for more bandwidth,
+** followed by one at 3/4 to drain the queue it may have built.
+**
+** This deviates from real BBRv2 in that there is no packet pacing --
+** segments are released by window only -- and no explicit loss-rate
+** ceiling.  Loss does not collapse the window: detected loss merely
+** floors ssthresh at 7/8 of the BDP (see the losswnd handler), which is
+** what makes the algorithm usable on long paths with stochastic loss.
+*/
+
+/* Window gain per probe-cycle phase, in eighths, applied on top of the
+ * standing 2*BDP window. */
+static const ci_uint8 bbr_cycle_gain_x8[8] = {10, 6, 8, 8, 8, 8, 8, 8};
+
+/* RTprop measurements older than this are forgotten, so a route change
+ * which lengthens the path is eventually noticed. */
+#define BBR_MIN_RTT_EXPIRY_MS  10000
+
+
+static ci_uint64 ci_tcp_cc_bbr_bdp(ci_tcp_state* ts)
+{
+  return ((ci_uint64) ts->cc_bw * ts->cc_min_rtt) >> CI_TCP_CC_BW_SHIFT;
+}
+
+
+static void ci_tcp_cc_bbr_init(ci_netif* ni, ci_tcp_state* ts)
+{
+  ts->cc_cycle = 0;
+  ts->cc_min_rtt = 0;
+  ts->cc_min_rtt_time = 0;
+  ts->cc_epoch_start = ci_tcp_time_now(ni);
+  ts->cc_epoch_delivered = 0;
+  ts->cc_bw = 0;
+}
+
+
+static void ci_tcp_cc_bbr_set_cwnd(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_uint64 cwnd;
+
+  if( ts->cc_bw == 0 || ts->cc_min_rtt == 0 )
+    /* No model yet: leave the slow-start behaviour of on_ack alone. */
+    return;
+
+  cwnd = (ci_tcp_cc_bbr_bdp(ts) * 2 * bbr_cycle_gain_x8[ts->cc_cycle]) >> 3;
+  cwnd = CI_MAX(cwnd, (ci_uint64) (tcp_eff_mss(ts) << 2));
+  cwnd = CI_MIN(cwnd, (ci_uint64) 0x40000000);
+  ts->cwnd = (ci_uint32) cwnd;
+}
+
+
+static void ci_tcp_cc_bbr_on_ack(ci_netif* ni, ci_tcp_state* ts,
+                                 unsigned acked)
+{
+  ci_iptime_t now = ci_tcp_time_now(ni);
+  ci_iptime_t elapsed = now - ts->cc_epoch_start;
+
+  ts->cc_epoch_delivered += acked;
+  /* ABC byte counting belongs to NewReno; don't let it accumulate. */
+  ts->bytes_acked = 0;
+
+  if( elapsed >= CI_MAX((ci_iptime_t) 1, (ci_iptime_t) tcp_srtt(ts)) ) {
+    ci_uint64 sample = ((ci_uint64) ts->cc_epoch_delivered
+                        << CI_TCP_CC_BW_SHIFT) / elapsed;
+
+    /* Decaying maximum: lose 1/32nd of the estimate per epoch so a
+     * genuine bandwidth reduction is tracked within a few dozen epochs,
+     * but take any larger sample immediately. */
+    ts->cc_bw -= ts->cc_bw >> 5;
+    if( sample > ts->cc_bw )
+      ts->cc_bw = (ci_uint32) CI_MIN(sample, (ci_uint64) 0xffffffff);
+
+    ts->cc_epoch_start = now;
+    ts->cc_epoch_delivered = 0;
+    ts->cc_cycle = (ts->cc_cycle + 1) & 7;
+  }
+
+  if( ts->cc_bw == 0 || ts->cc_min_rtt == 0 ) {
+    /* Model not primed yet (roughly the first srtt of the connection):
+     * grow exponentially like slow-start so we deliver the samples the
+     * model needs. */
+    ts->cwnd += CI_MIN(acked, (unsigned) (tcp_eff_mss(ts) << 1));
+    return;
+  }
+
+  ci_tcp_cc_bbr_set_cwnd(ni, ts);
+}
+
+
+static void ci_tcp_cc_bbr_rtt_sample(ci_netif* ni, ci_tcp_state* ts,
+                                     ci_iptime_t rtt)
+{
+  ci_iptime_t now = ci_tcp_time_now(ni);
+
+  if( ts->cc_min_rtt == 0 || rtt <= ts->cc_min_rtt ||
+      now - ts->cc_min_rtt_time >
+      ci_tcp_time_ms2ticks(ni, BBR_MIN_RTT_EXPIRY_MS) ) {
+    ts->cc_min_rtt = CI_MAX(rtt, (ci_iptime_t) 1);
+    ts->cc_min_rtt_time = now;
+  }
+}
+
+
+static unsigned ci_tcp_cc_bbr_losswnd(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_uint64 bdp;
+  unsigned floor = tcp_eff_mss(ts) << 1u;
+
+  if( ts->cc_bw == 0 || ts->cc_min_rtt == 0 )
+    return ci_tcp_losswnd(ts);
+
+  /* Loss is a signal, not a verdict: retreat to just under the estimated
+   * BDP rather than halving the flight size. */
+  bdp = ci_tcp_cc_bbr_bdp(ts);
+  return CI_MAX((unsigned) CI_MIN(bdp - (bdp >> 3), (ci_uint64) 0x40000000),
+                floor);
+}
+
+
+const struct ci_tcp_cc_ops ci_tcp_cc_tbl[CI_TCP_CC_N] = {
+  { "newreno", NULL, ci_tcp_cc_newreno_on_ack,
+    NULL, ci_tcp_cc_newreno_losswnd },
+  { "bbr", ci_tcp_cc_bbr_init, ci_tcp_cc_bbr_on_ack,
+    ci_tcp_cc_bbr_rtt_sample, ci_tcp_cc_bbr_losswnd },
+};
+
+
+/* Apply the socket's selected algorithm (EF_TCP_CC, possibly overridden
+ * via TCP_CONGESTION) to a (re-)initialised TCB. */
+void ci_tcp_cc_init(ci_netif* ni, ci_tcp_state* ts)
+{
+  ts->cc_algo = ts->c.tcp_cc;
+  if( ci_tcp_cc(ts)->init != NULL )
+    ci_tcp_cc(ts)->init(ni, ts);
+}
+
+/*! \cidoxg_end */
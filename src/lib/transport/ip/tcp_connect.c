@@ -381,6 +381,7 @@ static int ci_tcp_connect_check_dest(citp_socket* ep, ci_addr_t dst,
 
   if(CI_LIKELY( ipcache->status == retrrc_success ||
                 ipcache->status == retrrc_nomac   ||
+                ipcache->status == retrrc_pending ||
                 ipcache->status < 0 )) {
     /* Onloadable. */
     if( ipcache->encap.type & CICP_LLAP_TYPE_XMIT_HASH_LAYER4 )
@@ -467,6 +468,38 @@ ci_tcp_use_mac_filter_listen(ci_netif* ni, ci_sock_cmn* s, ci_ifid_t ifindex)
 }
 
 
+/* Returns true if the stack's scalable filter would capture traffic for an
+ * actively-opened socket with this local address, i.e. whether the socket
+ * can rely on the scalable filter plus software demux rather than a
+ * full-match hardware filter of its own.
+ */
+int
+ci_tcp_use_mac_filter_active(ci_netif* ni, ci_sock_cmn* s, ci_ifid_t ifindex)
+{
+  if( NI_OPTS(ni).scalable_filter_enable == CITP_SCALABLE_FILTERS_DISABLE )
+    return 0;
+
+  /* The app asked for this connection's receive path to be steered by an
+   * exact-match filter of its own.  See ONLOAD_TCP_RX_STEER. */
+  if( s->s_aflags & CI_SOCK_AFLAG_RX_STEER )
+    return 0;
+
+  if( (NI_OPTS(ni).scalable_filter_mode & CITP_SCALABLE_MODE_ACTIVE) == 0 )
+    return 0;
+
+  if( NI_OPTS(ni).scalable_filter_ifindex_active == CITP_SCALABLE_FILTERS_ALL )
+    return 1;
+
+  if( ifindex <= 0 ) {
+    /* Determine which ifindex the local address is on. */
+    ifindex = NI_OPTS(ni).scalable_filter_ifindex_active;
+    return cicp_find_ifindex_by_ip(ni->cplane, sock_laddr(s),
+                                   cicp_check_ipif_ifindex, &ifindex);
+  }
+  return (NI_OPTS(ni).scalable_filter_ifindex_active == ifindex);
+}
+
+
 #if !defined(__KERNEL__) || CI_CFG_ENDPOINT_MOVE
 int ci_tcp_can_set_filter_in_ul(ci_netif *ni, ci_sock_cmn* s)
 {
@@ -822,12 +855,17 @@ __ci_tcp_prev_seq_lookup(ci_netif* ni, const ci_tcp_prev_seq_t* ts_prev_seq)
 }
 
 
-ci_uint32 ci_tcp_prev_seq_lookup(ci_netif* ni, const ci_tcp_state* ts)
+ci_uint32 ci_tcp_prev_seq_lookup_tuple(ci_netif* ni,
+                                       ci_addr_t laddr, ci_uint16 lport,
+                                       ci_addr_t raddr, ci_uint16 rport)
 {
   ci_tcp_prev_seq_t ts_prev_seq;
   ci_tcp_prev_seq_t* prev_seq;
   ci_uint32 seq_no;
-  ci_tcp_prev_seq_from_ts(ni, ts, &ts_prev_seq);
+  ts_prev_seq.laddr = laddr;
+  ts_prev_seq.raddr = raddr;
+  ts_prev_seq.lport = lport;
+  ts_prev_seq.rport = rport;
   prev_seq = __ci_tcp_prev_seq_lookup(ni, &ts_prev_seq);
   if( prev_seq == NULL )
     return 0;
@@ -838,6 +876,14 @@ ci_uint32 ci_tcp_prev_seq_lookup(ci_netif* ni, const ci_tcp_state* ts)
 }
 
 
+ci_uint32 ci_tcp_prev_seq_lookup(ci_netif* ni, const ci_tcp_state* ts)
+{
+  return ci_tcp_prev_seq_lookup_tuple(ni, tcp_ipx_laddr(ts),
+                                      tcp_lport_be16(ts), tcp_ipx_raddr(ts),
+                                      tcp_rport_be16(ts));
+}
+
+
 void ci_tcp_prev_seq_remember(ci_netif* ni, ci_tcp_state* ts)
 {
   ci_tcp_prev_seq_t ts_prev_seq;
@@ -1051,15 +1097,35 @@ static int ci_tcp_connect_ul_start(ci_netif *ni, ci_tcp_state* ts, ci_fd_t fd,
                                     ts->s.cp.so_bindtodevice,
                                     active_wild)) < 0 ) {
       ci_assert_nequal(rc, -EFILTERSSOME);
-      /* Either a different error, or our efforts to free a filter did not
-       * work.
+      /* Still no hardware filter.  If the stack's scalable filter covers
+       * this flow, spill onto it: mark the socket scalable-active and
+       * retry, which installs just a software filter and relies on the
+       * scalable filter to deliver the traffic (EF_FILTER_SPILL).
        */
-      if( added_scalable )
-        ts->s.s_flags &= ~CI_SOCK_FLAG_SCALACTIVE; /* rollback scalactive flag */
-      ci_netif_pkt_release(ni, pkt);
-      CI_SET_ERROR(*fail_rc, -rc);
-      rc = CI_CONNECT_UL_FAIL;
-      goto fail;
+      if( NI_OPTS(ni).filter_spill &&
+          (rc == -EBUSY || rc == -ENOBUFS || rc == -ENOSPC) &&
+          ! (ts->s.s_flags & CI_SOCK_FLAG_SCALACTIVE) &&
+          ci_tcp_use_mac_filter_active(ni, &ts->s,
+                                       ts->s.cp.so_bindtodevice) ) {
+        ts->s.s_flags |= CI_SOCK_FLAG_SCALACTIVE;
+        rc = ci_tcp_ep_set_filters(ni, S_SP(ts), ts->s.cp.so_bindtodevice,
+                                   OO_SP_NULL);
+        if( rc == 0 )
+          CITP_STATS_NETIF(++ni->state->stats.hw_filter_spill);
+        else
+          ts->s.s_flags &= ~CI_SOCK_FLAG_SCALACTIVE;
+      }
+      if( rc < 0 ) {
+        /* Either a different error, or our efforts to free a filter did
+         * not work.
+         */
+        if( added_scalable )
+          ts->s.s_flags &= ~CI_SOCK_FLAG_SCALACTIVE; /* rollback scalactive flag */
+        ci_netif_pkt_release(ni, pkt);
+        CI_SET_ERROR(*fail_rc, -rc);
+        rc = CI_CONNECT_UL_FAIL;
+        goto fail;
+      }
     }
   }
 
@@ -1122,7 +1188,7 @@ static int ci_tcp_connect_ul_start(ci_netif *ni, ci_tcp_state* ts, ci_fd_t fd,
   ts->tcpflags |= NI_OPTS(ni).syn_opts;
 
   if( (ts->tcpflags & CI_TCPT_FLAG_WSCL) ) {
-    if( NI_OPTS(ni).tcp_rcvbuf_mode == 1 )
+    if( NI_OPTS(ni).tcp_rcvbuf_mode != 0 )
       ts->rcv_wscl =
 	ci_tcp_wscl_by_buff(ni, ci_tcp_max_rcvbuf(ni, ts->amss));
     else
@@ -2229,6 +2295,12 @@ int ci_tcp_listen(citp_socket* ep, ci_fd_t fd, int backlog)
     ci_tcp_ep_clear_filters(netif, S_SP(tls), 0);
     goto post_listen_fail;
   }
+
+  /* Pre-fill the pool of TCP state objects so that early synrecv
+   * promotions do not pay the initialisation cost. */
+  if( NI_OPTS(netif).tcp_state_pool != 0 )
+    ci_tcp_state_pool_refill(netif);
+
   ci_netif_unlock(ep->netif);
   return 0;
 
@@ -827,6 +827,21 @@ void ci_tcp_state_dump(ci_netif* ni, ci_tcp_state* ts,
   logger(log_arg, "%s  srtt=%02d rttvar=%03d rto=%d zwins=%u,%u", pf,
          tcp_srtt(ts), tcp_rttvar(ts), ts->rto, ts->zwin_probes,
          ts->zwin_acks);
+#if CI_CFG_TCP_SOCK_TELEMETRY
+  {
+    static const char* ev_str[] = { "?", "retrans", "rto", "cwnd", "zwin" };
+    ci_uint32 wr = ts->telem.wr;
+    ci_uint32 i = wr > CI_CFG_TCP_TELEM_RING_LEN ?
+                  wr - CI_CFG_TCP_TELEM_RING_LEN : 0;
+    for( ; i != wr; ++i ) {
+      const oo_tcp_telem_entry* e =
+        &ts->telem.ring[i % CI_CFG_TCP_TELEM_RING_LEN];
+      logger(log_arg, "%s  telem[%u]: frc=%"CI_PRIx64" %s val=%u", pf, i,
+             e->frc, e->ev <= OO_TCP_TELEM_ZWIN ? ev_str[e->ev] : "?",
+             e->val);
+    }
+  }
+#endif
   logger(log_arg,
          "%s  curr_retrans=%d total_retrans=%d dupacks=%u congrecover=%x",
          pf, ts->retransmits, stats.total_retrans, ts->dup_acks,
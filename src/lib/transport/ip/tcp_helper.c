@@ -220,12 +220,46 @@ int ci_tcp_helper_ep_mcast_add_del(ci_fd_t           fd,
                       &op);
 
   if( rc < 0 )
-    LOG_SV(ci_log("%s: %s failed for %d (rc=%d)", 
+    LOG_SV(ci_log("%s: %s failed for %d (rc=%d)",
                   __FUNCTION__, add ? "add" : "del", OO_SP_FMT(ep), rc));
   return rc;
 }
 
 
+int ci_tcp_helper_ep_mcast_add_batch(ci_fd_t           fd,
+                                     oo_sp             ep,
+                                     ci_ifid_t         ifindex,
+                                     const ci_uint32*  mcast_addrs,
+                                     int               count)
+{
+  oo_tcp_filter_mcast_batch_t op;
+  int done = 0;
+  int rc = 0;
+
+  op.tcp_id  = ep;
+  op.ifindex = ifindex;
+
+  VERB(ci_log("%s: id=%d count=%d", __FUNCTION__, OO_SP_FMT(ep), count));
+
+  while( done < count ) {
+    int n = CI_MIN(count - done, OO_MCAST_BATCH_MAX);
+    memcpy(op.addrs, mcast_addrs + done, n * sizeof(op.addrs[0]));
+    op.count = n;
+    rc = oo_resource_op(fd, OO_IOC_EP_FILTER_MCAST_ADD_BATCH, &op);
+    done += op.count;
+    if( rc < 0 || (int) op.count < n )
+      break;
+  }
+
+  if( rc < 0 && done == 0 ) {
+    LOG_SV(ci_log("%s: add failed for %d (rc=%d)",
+                  __FUNCTION__, OO_SP_FMT(ep), rc));
+    return rc;
+  }
+  return done;
+}
+
+
 int __ci_tcp_helper_stack_attach(ci_fd_t from_fd,
                                  efrm_nic_set_t *out_ptr_nic_set,
                                  ci_uint32 *out_map_size,
@@ -480,12 +514,14 @@ int ci_netif_evq_poll_k(ci_netif* ni, int _n)
 
 
 int ci_tcp_helper_zc_register_buffers(ci_netif* ni, void* base, int num_pages,
-                                      uint64_t* hw_addrs, uint64_t* id)
+                                      unsigned flags, uint64_t* hw_addrs,
+                                      uint64_t* id)
 {
   oo_zc_register_buffers_t arg = {
     .base_ptr = (uintptr_t)base,
     .num_pages = num_pages,
     .hw_addrs_ptr = (uintptr_t)hw_addrs,
+    .flags = flags,
   };
   int rc = oo_resource_op(ci_netif_get_driver_handle(ni),
                           OO_IOC_ZC_REGISTER_BUFFERS, &arg);
@@ -44,6 +44,9 @@ static void ci_tcp_state_setup_timers(ci_netif* ni, ci_tcp_state* ts)
   ci_tcp_setup_timer(stats,    CI_IP_TIMER_TCP_STATS,  "stat");
 #endif
   ci_tcp_setup_timer(cork,     CI_IP_TIMER_TCP_CORK,   "cork");
+#if CI_CFG_TCP_RACK
+  ci_tcp_setup_timer(rack,     CI_IP_TIMER_TCP_RACK,   "rack");
+#endif
 
 #undef ci_tcp_setup_timer
 }
@@ -136,15 +139,26 @@ void ci_tcp_state_tcb_reinit_minimal(ci_netif* netif, ci_tcp_state* ts)
   ts->dup_acks = 0;
   ts->bytes_acked = 0;
 
+#if CI_CFG_TCP_RACK
+  ts->rack_xmit_time = 0;
+  ts->rack_end_seq = 0;
+  ts->rack_rtt = 0;
+#endif
+
   /* ts->eff_mss is not cleared as might be used without lock on send path */
   ts->ssthresh = 0;
 
+  ci_tcp_cc_init(netif, ts);
+
   /* PAWs RFC1323, connections always start idle */
   ts->tspaws = ci_tcp_time_now(netif) - (NI_CONF(netif).tconst_paws_idle+1);
   ts->tsrecent = 0;
 
   /* delayed acknowledgements */
   ts->acks_pending = 0;
+#if CI_CFG_DYNAMIC_ACK_RATE
+  ts->dynack_adapt = 0;
+#endif
 
   /* Faststart */
   CITP_TCP_FASTSTART(ts->faststart_acks = 0);
@@ -190,6 +204,7 @@ static void ci_tcp_state_tcb_reinit(ci_netif* netif, ci_tcp_state* ts,
   if( ts->tcpflags & CI_TCPT_FLAG_TSO )  ts->outgoing_hdrs_len += 12;
   ts->incoming_tcp_hdr_len = (ci_uint8)sizeof(ci_tcp_hdr);
   ts->c.tcp_defer_accept = OO_TCP_DEFER_ACCEPT_OFF;
+  ts->c.tcp_cc = NI_OPTS(netif).tcp_cc;
 
   ci_tcp_state_connected_opts_init(netif, ts);
 
@@ -260,6 +275,10 @@ static void ci_tcp_state_tcb_reinit(ci_netif* netif, ci_tcp_state* ts,
 
   memset(&ts->stats, 0, sizeof(ts->stats));
 
+#if CI_CFG_TCP_SOCK_TELEMETRY
+  ts->telem.wr = 0;
+#endif
+
   ci_assert(OO_PP_IS_NULL(ts->pmtus));
 
   /* ts is in valid state now */
@@ -409,12 +428,66 @@ ci_tcp_state* ci_tcp_get_state_buf_from_cache(ci_netif *netif, int pid)
 #endif
 
 
+/* Take a pre-initialised TCP state from the stack's pool, if there is one.
+ * The pooled state was set up by ci_tcp_state_init() at refill time; only
+ * the timestamps captured then need freshening.
+ */
+static ci_tcp_state* ci_tcp_state_pool_get(ci_netif* netif)
+{
+  ci_netif_state* ns = netif->state;
+  ci_tcp_state* ts;
+
+  ci_assert(ci_netif_is_locked(netif));
+
+  if( ns->warm_state_pool_n == 0 )
+    return NULL;
+
+  ts = SP_TO_TCP(netif, ns->warm_state_pool);
+  ns->warm_state_pool = ts->s.b.wt_next;
+  --ns->warm_state_pool_n;
+
+#if CI_CFG_CONGESTION_WINDOW_VALIDATION
+  ts->t_last_sent = ci_tcp_time_now(netif);
+  ts->t_last_full = ci_tcp_time_now(netif);
+#endif
+  ts->t_last_recv_ack = ts->t_last_recv_payload = ts->t_prev_recv_payload =
+    ci_tcp_time_now(netif);
+  ts->t_last_invalid_ack = ci_tcp_time_now(netif) -
+                           NI_CONF(netif).tconst_invalid_ack_ratelimit;
+
+  CITP_STATS_NETIF(++ns->stats.tcp_state_pool_hit);
+  return ts;
+}
+
+
+void ci_tcp_state_pool_refill(ci_netif* netif)
+{
+  ci_netif_state* ns = netif->state;
+
+  ci_assert(ci_netif_is_locked(netif));
+
+  while( ns->warm_state_pool_n < NI_OPTS(netif).tcp_state_pool ) {
+    citp_waitable_obj* wo = citp_waitable_obj_alloc(netif);
+    if( wo == NULL )
+      break;
+    ci_tcp_state_init(netif, &wo->tcp, 0);
+    wo->tcp.s.b.wt_next = ns->warm_state_pool;
+    ns->warm_state_pool = S_SP(&wo->tcp);
+    ++ns->warm_state_pool_n;
+  }
+}
+
+
 ci_tcp_state* ci_tcp_get_state_buf(ci_netif* netif)
 {
   citp_waitable_obj* wo;
+  ci_tcp_state* ts;
 
   ci_assert(netif);
 
+  if( (ts = ci_tcp_state_pool_get(netif)) != NULL )
+    return ts;
+
   wo = citp_waitable_obj_alloc(netif);
   if( ! wo )  {
     LOG_TV(ci_log("%s: [%d] out of socket buffers",__FUNCTION__,NI_ID(netif)));
@@ -188,6 +188,9 @@ void ci_tcp_state_verify_no_timers(ci_netif *ni, ci_tcp_state *ts)
   chk(zwin_tid);
   chk(kalive_tid);
   chk(cork_tid);
+#if CI_CFG_TCP_RACK
+  chk(rack_tid);
+#endif
 #if CI_CFG_TCP_SOCK_STATS
   chk(stats_tid);
 #endif
@@ -222,6 +225,7 @@ static void __ci_tcp_state_free(ci_netif *ni, ci_tcp_state *ts)
   oo_p_dllink_del_init(ni, link);
   link = oo_p_dllink_sb(ni, &ts->s.b, &ts->s.reap_link);
   oo_p_dllink_del_init(ni, link);
+  ci_sock_mem_watermark_unregister(ni, &ts->s);
 
   citp_waitable_remove_from_epoll(ni, &ts->s.b, 1);
 
@@ -358,6 +362,7 @@ void ci_tcp_set_established_state(ci_netif* ni, ci_tcp_state* ts)
   ts->rcvbuf_drs.bytes = ts->rcv_wnd_advertised;
   ts->rcvbuf_drs.seq   = ts->rcv_delivered;
   ts->rcvbuf_drs.time  = ci_tcp_time_now(ni);
+  ts->rcvbuf_drs.quiet = 0;
 
 #if CI_CFG_PORT_STRIPING
   if( ts->tcpflags & CI_TCPT_FLAG_STRIPE )
@@ -571,9 +576,16 @@ void ci_tcp_stop_timers(ci_netif* netif, ci_tcp_state* ts)
 {
   ci_ip_timer_clear_ool(netif, &ts->rto_tid);
   ci_ip_timer_clear_ool(netif, &ts->delack_tid);
+  if( ts->tcpflags & CI_TCPT_FLAG_FAST_ACK_ARMED )
+    ci_tcp_fast_ack_unarm(netif, ts);
   ci_ip_timer_clear_ool(netif, &ts->zwin_tid);
   ci_ip_timer_clear_ool(netif, &ts->kalive_tid);
   ci_ip_timer_clear_ool(netif, &ts->cork_tid);
+  if( ts->tcpflags & CI_TCPT_FLAG_CORK_DEADLINE )
+    ci_tcp_cork_deadline_unarm(netif, ts);
+#if CI_CFG_TCP_RACK
+  ci_ip_timer_clear_ool(netif, &ts->rack_tid);
+#endif
   if( OO_PP_NOT_NULL(ts->pmtus) ) {
     ci_pmtu_state_t* pmtus = ci_ni_aux_p2pmtus(netif, ts->pmtus);
     ci_ip_timer_clear_ool(netif, &pmtus->tid);
@@ -777,6 +789,9 @@ void ci_tcp_drop(ci_netif* netif, ci_tcp_state* ts, int so_error)
   ci_tcp_stop_timers(netif, ts);
   ci_tcp_state_tcb_reinit_minimal(netif, ts);
   ts->acks_pending = 0;
+#if CI_CFG_DYNAMIC_ACK_RATE
+  ts->dynack_adapt = 0;
+#endif
   if( ts->s.b.state == CI_TCP_SYN_SENT ) {
     ts->tcpflags &= ~CI_TCPT_FLAG_NO_ARP;
     switch( so_error ) {
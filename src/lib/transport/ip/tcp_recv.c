@@ -19,9 +19,12 @@
 #include <onload/sleep.h>
 #include <onload/tcp-ceph.h>
 #ifndef __KERNEL__
+#include <onload/extensions.h>
 #include <onload/extensions_zc.h>
 #include <onload/extensions_zc_hlrx.h>
 #include <stddef.h>
+#include <stdlib.h>
+#include <limits.h>
 #endif
 
 
@@ -176,8 +179,33 @@ void ci_tcp_rcvbuf_drs(ci_netif* netif, ci_tcp_state* ts)
 
   /* Number of bytes delivered to user in last RTT */
   rcv_bytes = ts->rcv_delivered - ts->rcvbuf_drs.seq;
-  if( rcv_bytes <= ts->rcvbuf_drs.bytes )
+  if( rcv_bytes <= ts->rcvbuf_drs.bytes ) {
+    /* Mode 2: the drain rate is not growing, so consider shrinking.  A
+     * buffer sized for (rcv_bytes * 2 + cushion) is what the grow path
+     * would pick for this rate; if that is under half what we currently
+     * have for several consecutive RTTs, move halfway towards it.  Only
+     * future window advertisements are affected, so the right edge never
+     * retreats. */
+    if( NI_OPTS(netif).tcp_rcvbuf_mode == 2 &&
+        ! (ts->s.s_flags & CI_SOCK_FLAG_SET_RCVBUF) ) {
+      ci_uint32 target = (rcv_bytes << 1) + 16 * ts->amss;
+      if( target < (ci_uint32) ts->s.so.rcvbuf >> 1 ) {
+        if( ++ts->rcvbuf_drs.quiet >= 8 ) {
+          ci_int32 rcvbuf = CI_MAX((ts->s.so.rcvbuf + (ci_int32) target) / 2,
+                                   (ci_int32) NI_OPTS(netif).tcp_rcvbuf_min);
+          if( rcvbuf < ts->s.so.rcvbuf ) {
+            ts->s.so.rcvbuf = rcvbuf;
+            ci_tcp_set_rcvbuf(netif, ts);
+            CITP_STATS_NETIF_INC(netif, tcp_rcvbuf_shrunk);
+          }
+          ts->rcvbuf_drs.quiet = 0;
+        }
+      }
+      else
+        ts->rcvbuf_drs.quiet = 0;
+    }
     goto new_period;
+  }
 
   /* rcv_bytes gives the number of bytes received in the previous RTT.
    * The current RTT worth of data is already in flight and so we need
@@ -185,7 +213,7 @@ void ci_tcp_rcvbuf_drs(ci_netif* netif, ci_tcp_state* ts)
    * [prev RTT][current RTT][following RTT]
    */
 
-  if( ! (ts->s.s_flags & CI_SOCK_FLAG_SET_SNDBUF) ) {
+  if( ! (ts->s.s_flags & CI_SOCK_FLAG_SET_RCVBUF) ) {
     int rcv_wnd, rcvbuf;
 
     /* at least 2x factor to cope with packet loss, plus small extra cushion */
@@ -210,6 +238,7 @@ void ci_tcp_rcvbuf_drs(ci_netif* netif, ci_tcp_state* ts)
     }
   }
   ts->rcvbuf_drs.bytes = rcv_bytes;
+  ts->rcvbuf_drs.quiet = 0;
 
  new_period:
   ts->rcvbuf_drs.seq = ts->rcv_delivered;
@@ -223,7 +252,7 @@ ci_tcp_recvmsg_get_nopeek(int peek_off, ci_tcp_state *ts, ci_netif *netif,
 {
   ci_assert(peek_off == 0);
   ts->rcv_delivered += n;
-  if( NI_OPTS(netif).tcp_rcvbuf_mode == 1 )
+  if( NI_OPTS(netif).tcp_rcvbuf_mode != 0 )
     /* for now run every time we update rcv_delivered */
     ci_tcp_rcvbuf_drs(netif, ts);
   if( oo_offbuf_left(&(*pkt)->buf) == 0 ) {
@@ -539,6 +568,15 @@ ci_tcp_recvmsg_get_impl(struct tcp_recv_info *rinf)
     ci_assert(oo_offbuf_not_empty(&pkt->buf));
     ci_assert(oo_offbuf_left(&pkt->buf) > peek_off);
 
+    /* Overlap the next packet's cache misses with the current copy: on
+     * large drains of the receive queue each packet's metadata and payload
+     * are cold by the time we get to them.
+     */
+    if( OO_PP_NOT_NULL(pkt->next) ) {
+      ci_ip_pkt_fmt* next = PKT_CHK_NNL(netif, pkt->next);
+      ci_prefetch(oo_offbuf_ptr(&next->buf));
+    }
+
 #if CI_CFG_TIMESTAMPING && ! defined(__KERNEL__)
   if( fill_tstamp ) {
     ci_tcp_fill_recv_timestamp(rinf, pkt);
@@ -624,18 +662,45 @@ ci_tcp_recvmsg_get_outofline(struct tcp_recv_info *rinf)
 
 
 #ifndef __KERNEL__
+/* What "readable" means for the spin below.  A framed socket starved of a
+ * complete frame (onload_socket_recv_framing(): tcp_rcv_usr() != 0 but
+ * nothing deliverable) must spin until new data arrives rather than exit
+ * immediately on the data it cannot deliver. */
+ci_inline int/*bool*/
+ci_tcp_recv_spin_readable(ci_tcp_state* ts, int/*bool*/ framing_starved,
+                          ci_uint32 rcv_added_seen)
+{
+  return framing_starved ? ts->rcv_added != rcv_added_seen
+                         : tcp_rcv_usr(ts) != 0;
+}
+
+
 /* Returns >0 if socket is readable.  Returns 0 if spin times-out.  Returns
  * -ve error code otherwise.
  */
 static int ci_tcp_recvmsg_spin(ci_netif* ni, ci_tcp_state* ts,
-                               ci_uint64 start_frc)
+                               ci_uint64 start_frc,
+                               int/*bool*/ framing_starved,
+                               ci_uint32 rcv_added_seen)
 {
   ci_uint64 now_frc;
   ci_uint64 schedule_frc = start_frc;
+  ci_uint64 acct_frc = start_frc;
   citp_signal_info* si = citp_signal_get_specific_inited();
   ci_uint64 max_spin = ts->s.b.spin_cycles;
+  int spin_adaptive = NI_OPTS(ni).tcp_recv_spin_adaptive;
   int rc, spin_limit_by_so = 0;
 
+  /* Each consecutive spin that timed out halves the budget for the next
+   * one, so receives on a quiet connection soon fall through to sleeping
+   * almost immediately; any spin that finds data restores the full budget
+   * (see EF_TCP_RECV_SPIN_ADAPTIVE).
+   */
+#define CI_SPIN_ADAPTIVE_MISS_MAX  6
+  if( spin_adaptive )
+    max_spin >>= CI_MIN(ts->s.b.spin_misses,
+                        (ci_uint32) CI_SPIN_ADAPTIVE_MISS_MAX);
+
   /* Cache the next expected packet buffer to save work within the loop.
    * We need to update this after polling. If someone else polls, then this
    * pointer might no longer point to the expected packet. This might lead to
@@ -661,34 +726,41 @@ static int ci_tcp_recvmsg_spin(ci_netif* ni, ci_tcp_state* ts,
   now_frc = start_frc;
 
   do {
+    int n_evs = 0;
+    int lock_missed = 0;
     rc = 1;
     if( ci_netif_may_poll(ni) ) {
-      if( *future != CI_PKT_RX_POISON && ci_netif_trylock(ni) ) {
-        ci_netif_poll_intf_future(ni, intf_i, now_frc);
+      if( *future != CI_PKT_RX_POISON && ci_netif_poll_uncontended(ni) &&
+          ci_netif_trylock(ni) ) {
+        n_evs += ci_netif_poll_intf_future(ni, intf_i, now_frc);
         ci_netif_unlock(ni);
-        if( tcp_rcv_usr(ts) )
+        if( ci_tcp_recv_spin_readable(ts, framing_starved, rcv_added_seen) )
           goto out;
         future = ci_netif_intf_rx_future(ni, intf_i, &poison);
       }
 
       if( ni->state->poll_work_outstanding ||
           ci_netif_need_poll_spinning(ni, now_frc) ) {
-        if( ci_netif_trylock(ni) ) {
-          ci_netif_poll(ni);
+        if( ci_netif_poll_uncontended(ni) && ci_netif_trylock(ni) ) {
+          n_evs += ci_netif_poll(ni);
           ci_netif_unlock(ni);
         }
-        if( tcp_rcv_usr(ts) )
+        else
+          lock_missed = 1;
+        if( ci_tcp_recv_spin_readable(ts, framing_starved, rcv_added_seen) )
           goto out;
         future = ci_netif_intf_rx_future(ni, intf_i, &poison);
       }
       else if( ! ni->state->is_spinner )
         ni->state->is_spinner = 1;
     }
-    if( tcp_rcv_usr(ts) || TCP_RX_DONE(ts) )
+    if( ci_tcp_recv_spin_readable(ts, framing_starved, rcv_added_seen) ||
+        TCP_RX_DONE(ts) )
       goto out;
 
     ci_frc64(&now_frc);
-    rc = OO_SPINLOOP_PAUSE_CHECK_SIGNALS(ni, now_frc, &schedule_frc, 
+    OO_SPIN_ACCOUNT(ni, &acct_frc, now_frc, n_evs, lock_missed);
+    rc = OO_SPINLOOP_PAUSE_CHECK_SIGNALS(ni, now_frc, &schedule_frc,
                                          ts->s.so.rcvtimeo_msec, &ts->s.b, si);
     if( rc != 0 )
       goto out;
@@ -701,12 +773,23 @@ static int ci_tcp_recvmsg_spin(ci_netif* ni, ci_tcp_state* ts,
 
   rc = spin_limit_by_so ? -EAGAIN : 0;
  out:
+  if( spin_adaptive ) {
+    if( rc > 0 )
+      ts->s.b.spin_misses = 0;
+    else if( rc == 0 && ts->s.b.spin_misses < CI_SPIN_ADAPTIVE_MISS_MAX )
+      ++ts->s.b.spin_misses;
+  }
   ni->state->is_spinner = 0;
   return rc;
 }
 #endif
 
 
+#ifndef __KERNEL__
+static int/*bool*/ ci_tcp_recv_framing_apply(struct tcp_recv_info* rinf);
+#endif
+
+
 /* This macro returns true if the combination of [flags] and receive
 ** low-water-mark permit us to return given the amount of data we've
 ** received already.
@@ -754,7 +837,9 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
   ci_uint64             start_frc = 0; /* suppress compiler warning */
 #ifndef __KERNEL__
   unsigned              tcp_recv_spin = 0;
+  ci_uint32             rcv_added_seen = 0;
 #endif
+  int                   framing_starved = 0;
   ci_uint32             timeout = ts->s.so.rcvtimeo_msec;
   struct tcp_recv_info  rinf;
 
@@ -807,12 +892,25 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
   ci_frc64(&start_frc);
 
  poll_recv_queue:
-  rinf.rc += ci_tcp_recvmsg_get_inline(&rinf);
+#ifndef __KERNEL__
+  framing_starved = 0;
+  /* Captured before the framing check so that data arriving after it is
+   * guaranteed to make a subsequent spin re-assess the framing limit. */
+  rcv_added_seen = ts->rcv_added;
+  if( zc_args != NULL && ! ci_tcp_recv_framing_apply(&rinf) )
+    /* Framed socket with no complete frame queued yet: leave the data in
+     * the receive queue and wait as if it had not arrived. */
+    framing_starved = 1;
+  else
+#endif
+    rinf.rc += ci_tcp_recvmsg_get_inline(&rinf);
 
   /* Return immediately if we've filled the app's buffer(s).
    * In case of empty buffer, we should wait for socket to be readable.
+   * A framed socket starved of a complete frame has an empty piov but
+   * must carry on to the wait path below.
   */
-  if( ci_iovec_ptr_is_empty_proper(&rinf.piov) &&
+  if( ! framing_starved && ci_iovec_ptr_is_empty_proper(&rinf.piov) &&
       ( rinf.rc != 0 || TCP_RX_DONE(ts) || tcp_rcv_usr(ts) ) ) {
     if( CI_UNLIKELY(rinf.rc == 0) )  goto check_errno;
     goto success_unlock_out;
@@ -832,7 +930,7 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
     have_polled = 1;
 
     if( ci_netif_may_poll(ni) && ci_netif_need_poll_spinning(ni, start_frc) ) {
-      if( ci_netif_trylock(ni) ) {
+      if( ci_netif_poll_uncontended(ni) && ci_netif_trylock(ni) ) {
         ci_uint32 rcv_added_before = ts->rcv_added;
         int any_evs = ci_netif_poll(ni);
         if( ts->rcv_added != rcv_added_before ) {
@@ -895,7 +993,8 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
   if( tcp_recv_spin ) {
     int rc2;
 
-    if( (rc2 = ci_tcp_recvmsg_spin(ni, ts, start_frc)) ) {
+    if( (rc2 = ci_tcp_recvmsg_spin(ni, ts, start_frc,
+                                   framing_starved, rcv_added_seen)) ) {
       if( rc2 < 0 ) {
         /* -ERESTARTSYS, -EINTR or -EAGAIN */
         rinf.rc = rc2;
@@ -921,6 +1020,17 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
 
   sleep_seq = ts->s.b.sleep_seq.all;
   ci_rmb();
+#ifndef __KERNEL__
+  if( framing_starved ) {
+    /* Data is queued but none of it is deliverable, so the tcp_rcv_usr()
+     * race-breaker below would loop here forever.  Instead re-check
+     * whether the frame completed since the check at poll_recv_queue; if
+     * not, sleep until more data arrives. */
+    if( ci_tcp_recv_framing_apply(&rinf) )
+      goto poll_recv_queue;
+  }
+  else
+#endif
   if( tcp_rcv_usr(ts) )  goto poll_recv_queue;
   if( TCP_RX_DONE(ts) )  goto rx_done;
 
@@ -1041,6 +1151,7 @@ static inline int ci_tcp_recvmsg_impl(const ci_tcp_recvmsg_args* a,
        */
       if( ci_netif_may_poll(ni) &&
           ci_netif_need_poll_spinning(ni, start_frc) &&
+          ci_netif_poll_uncontended(ni) &&
           ci_netif_trylock(ni) ) {
         ci_netif_poll(ni);
         ci_netif_unlock(ni);
@@ -1612,7 +1723,7 @@ static int ci_tcp_recvmsg_recv2(struct tcp_recv_info *rinf)
     rinf->stack_locked = 0;
   }
  out:
-  if( NI_OPTS(ni).tcp_rcvbuf_mode == 1 )
+  if( NI_OPTS(ni).tcp_rcvbuf_mode != 0 )
     ci_tcp_rcvbuf_drs(ni, ts);
 
   /* Must return if we've filled the app buffer. */
@@ -1826,12 +1937,175 @@ static int zc_ceph_callback(ci_netif* netif, struct tcp_recv_info* rinf,
 #endif
 
 
+/* Length-prefixed frame delivery for onload_zc_recv(); see
+** onload_socket_recv_framing() in extensions.h.  The descriptor and the
+** enforcement are process-local: data is left in the receive queue until a
+** whole frame is present, and delivery is capped at the last complete
+** frame boundary, so a frame spanning several packets is stitched together
+** from consecutive callback invocations with nothing ever re-copied. */
+
+ci_inline struct ci_tcp_recv_framing*
+ci_tcp_recv_framing_get(ci_netif* ni, ci_tcp_state* ts)
+{
+  return ni->recv_framing == NULL ? NULL : &ni->recv_framing[S_ID(ts)];
+}
+
+
+int ci_tcp_recv_framing_set(ci_netif* ni, ci_tcp_state* ts,
+                            const struct onload_recv_framing* frm)
+{
+  struct ci_tcp_recv_framing* f;
+
+  if( ni->recv_framing == NULL ) {
+    ni->recv_framing = calloc(ni->state->n_ep_bufs,
+                              sizeof(ni->recv_framing[0]));
+    if( ni->recv_framing == NULL )
+      return -ENOMEM;
+  }
+  f = &ni->recv_framing[S_ID(ts)];
+  if( frm == NULL ) {
+    f->active = 0;
+    return 0;
+  }
+  if( frm->hdr_len == 0 || frm->hdr_len > 255 ||
+      (frm->len_width != 1 && frm->len_width != 2 &&
+       frm->len_width != 4 && frm->len_width != 8) ||
+      frm->len_offset + frm->len_width > frm->hdr_len )
+    return -EINVAL;
+  f->hdr_len = frm->hdr_len;
+  f->len_offset = frm->len_offset;
+  f->len_width = frm->len_width;
+  f->len_nbo = frm->len_nbo;
+  f->len_adjust = frm->len_adjust;
+  f->active = 1;
+  return 0;
+}
+
+
+struct tcp_framing_cursor {
+  ci_ip_pkt_fmt* pkt;
+  int            off;   /* offset beyond the offbuf read position */
+};
+
+
+/* Advance [c] by [n] bytes of queued data, copying them to [dst] if it is
+ * not NULL.  Returns 0 on success, -1 if the queue ran out first. */
+static int ci_tcp_framing_advance(ci_netif* ni, struct tcp_framing_cursor* c,
+                                  ci_uint64 n, void* dst)
+{
+  char* out = dst;
+
+  while( n > 0 ) {
+    int left;
+    if( c->pkt == NULL )
+      return -1;
+    left = oo_offbuf_left(&c->pkt->buf) - c->off;
+    if( left > 0 ) {
+      int k = CI_MIN((ci_uint64) left, n);
+      if( out != NULL ) {
+        memcpy(out, oo_offbuf_ptr(&c->pkt->buf) + c->off, k);
+        out += k;
+      }
+      c->off += k;
+      n -= k;
+    }
+    else {
+      c->pkt = OO_PP_IS_NULL(c->pkt->next) ?
+               NULL : PKT_CHK_NNL(ni, c->pkt->next);
+      c->off = 0;
+    }
+  }
+  return 0;
+}
+
+
+/* Returns the number of bytes of complete frames queued from the current
+ * extract point, or -1 if the stream turned out not to match the
+ * descriptor (framing is then abandoned).  Called with the socket locked;
+ * reads the queue without consuming anything. */
+static int ci_tcp_recv_framing_limit(ci_netif* ni, ci_tcp_state* ts,
+                                     struct ci_tcp_recv_framing* f)
+{
+  struct tcp_framing_cursor c;
+  ci_uint64 whole = 0;
+  ci_uint8 lenbuf[8];
+
+  if( OO_PP_IS_NULL(ts->recv1_extract) )
+    return 0;
+  c.pkt = PKT_CHK_NNL(ni, ts->recv1_extract);
+  c.off = 0;
+
+  while( whole < INT_MAX ) {
+    struct tcp_framing_cursor hdr = c;
+    ci_uint64 v = 0;
+    ci_int64 flen;
+    int i;
+
+    if( ci_tcp_framing_advance(ni, &hdr, f->len_offset, NULL) != 0 ||
+        ci_tcp_framing_advance(ni, &hdr, f->len_width, lenbuf) != 0 )
+      break;                              /* header not complete yet */
+    for( i = 0; i < f->len_width; i++ )
+      v |= f->len_nbo ?
+           (ci_uint64) lenbuf[i] << (8 * (f->len_width - 1 - i)) :
+           (ci_uint64) lenbuf[i] << (8 * i);
+    flen = (ci_int64) v + f->len_adjust;
+    if( flen < f->hdr_len || flen > INT_MAX ) {
+      /* The stream is not framed as described.  Reverting to unframed
+       * delivery is more useful than stalling the socket forever. */
+      ci_log(LNTS_FMT "recv framing: frame length %lld outside [%u,%d]; "
+             "reverting to unframed delivery", LNTS_PRI_ARGS(ni, ts),
+             (long long) flen, f->hdr_len, INT_MAX);
+      f->active = 0;
+      return -1;
+    }
+    if( ci_tcp_framing_advance(ni, &c, flen, NULL) != 0 )
+      break;                              /* frame body not complete yet */
+    whole += flen;
+  }
+  return CI_MIN(whole, (ci_uint64) INT_MAX);
+}
+
+
+/* Cap a framed zc receive at the last complete frame boundary by shrinking
+ * the fake 'infinite' user buffer set up in ci_tcp_recvmsg_init_piov().
+ * Returns 0 if the socket is framed and no complete frame is queued, so
+ * the caller should wait rather than deliver. */
+static int/*bool*/ ci_tcp_recv_framing_apply(struct tcp_recv_info* rinf)
+{
+  ci_netif* ni = rinf->a->ni;
+  ci_tcp_state* ts = rinf->a->ts;
+  struct ci_tcp_recv_framing* f = ci_tcp_recv_framing_get(ni, ts);
+  int limit;
+
+  if( f == NULL || ! f->active )
+    return 1;
+  limit = ci_tcp_recv_framing_limit(ni, ts, f);
+  if( limit < 0 ) {
+    /* Reverted to unframed: restore the piov an earlier pass through this
+     * function may have clobbered. */
+    ci_tcp_recvmsg_init_piov(rinf);
+    return 1;
+  }
+  /* iovlen of zero makes iovec_roll_over() end the delivery loop when the
+   * limit is exhausted rather than chasing the NULL iov pointer. */
+  rinf->piov.io.iov_len = limit;
+  rinf->piov.iovlen = 0;
+  if( limit == 0 ) {
+    if( tcp_rcv_usr(ts) != 0 )
+      CITP_STATS_NETIF_INC(ni, recv_framing_incomplete);
+    return 0;
+  }
+  return 1;
+}
+
+
 static int zc_call_callback(ci_netif* netif, struct tcp_recv_info* rinf,
                             ci_ip_pkt_fmt* pkt, int peek_off, int* ndata)
 {
   int n = oo_offbuf_left(&pkt->buf);
   enum onload_zc_callback_rc cb_rc;
   struct onload_zc_iovec iov;
+  int truncated = 0;
 
 #if CI_CFG_TCP_OFFLOAD_RECYCLER
   if( ci_tcp_is_pluginized(rinf->a->ts) )
@@ -1854,19 +2128,41 @@ static int zc_call_callback(ci_netif* netif, struct tcp_recv_info* rinf,
   iov.buf = zc_pktbuf_to_handle(pkt);
   iov.iov_base = oo_offbuf_ptr(&pkt->buf) + peek_off;
   iov.iov_len = oo_offbuf_left(&pkt->buf) - peek_off;
+  if( iov.iov_len > rinf->piov.io.iov_len ) {
+    /* Framed socket (onload_socket_recv_framing()): deliver only up to the
+     * last complete frame boundary; the rest stays in the receive queue. */
+    iov.iov_len = rinf->piov.io.iov_len;
+    n = iov.iov_len;
+    truncated = 1;
+  }
   iov.iov_flags = 0;
 
   iov.addr_space = EF_ADDRSPACE_LOCAL;
-  pkt->user_refcount = CI_ZC_USER_REFCOUNT_ONE;
+  if( ! truncated )
+    pkt->user_refcount = CI_ZC_USER_REFCOUNT_ONE;
+  else {
+    /* The tail of this packet stays at recv1_extract for re-delivery, so
+     * the recvq's reference cannot be handed over: honouring ONLOAD_ZC_KEEP
+     * would let a legal onload_zc_release() free a packet that is still
+     * queued, and setting user_refcount would clobber the app's count when
+     * the packet is delivered again.  Pass the data by pointer only, as
+     * zc_ceph_callback() does for all but the last delivery of a packet
+     * given to the callback multiple times. */
+    pkt->rx_flags &=~ CI_PKT_RX_FLAG_KEEP;
+    iov.buf = ONLOAD_ZC_HANDLE_NONZC;
+  }
   cb_rc = rinf->zc_args->cb(rinf->zc_args, 0);
 
-  ci_pkt_zc_free_clean(pkt, cb_rc);
+  if( ! truncated )
+    ci_pkt_zc_free_clean(pkt, cb_rc);
   if( cb_rc & ONLOAD_ZC_KEEP ) {
     /* The refcount ownership semantics when both peeking and keeping are too
      * horrifying to think about, so just ban it (as stated in the docs). */
     ci_assert_nflags(rinf->msg_flags, MSG_PEEK);
   }
 
+  rinf->piov.io.iov_len -= n;
+
   if( cb_rc & ONLOAD_ZC_TERMINATE ) {
     /* Make it look like the non-zc buffer is full */
     rinf->piov.io.iov_len = 0;
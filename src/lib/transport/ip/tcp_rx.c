@@ -244,6 +244,84 @@ static void ci_tcp_rx_clean_plugin_rob(ci_netif *netif, ci_tcp_state *ts,
 }
 
 
+/* Copy as much as possible of [pkt]'s payload into spare space at the end
+** of the packet at the tail of the receive queue, so that bulk readers see
+** fewer queue entries.  Returns true if the whole payload was consumed (in
+** which case [pkt] has been released); otherwise [pkt]'s offbuf has been
+** advanced past any bytes copied and it must still be enqueued.
+**
+** Called with the netif lock only: unlike ci_tcp_rx_pkt_coalesce() we may
+** race with a reader extracting from the tail packet under the socket
+** lock.  Appending beyond [buf.end] is safe because the reader never looks
+** past the end it has seen, advances [buf.off] only by bytes it has
+** copied, and cannot reap the tail while it remains the tail.  The
+** ci_wmb() in ci_tcp_rx_update_state_on_add() orders our payload writes
+** before the new bytes are advertised via [rcv_added].
+*/
+static int ci_tcp_rx_coalesce_into_tail(ci_netif *netif, ci_tcp_state *ts,
+                                        ci_ip_pkt_fmt *pkt)
+{
+  ci_ip_pkt_queue* rxq = TS_QUEUE_RX(ts);
+  ci_tcp_hdr* pkt_tcp = PKT_IPX_TCP_HDR(ipcache_af(&ts->s.pkt), pkt);
+  ci_ip_pkt_fmt* tail;
+  char* tail_buf_end;
+  int n, space;
+
+  ci_assert(ci_netif_is_locked(netif));
+  ci_assert(! ci_tcp_is_pluginized(ts));
+
+  /* Leave the urgent-data path alone. */
+  if( rxq != &ts->recv1 || OO_PP_IS_NULL(rxq->head) )
+    return 0;
+#if CI_CFG_TIMESTAMPING
+  /* Each receive queue entry carries a single hardware timestamp, so
+   * merging segments would misattribute timestamps. */
+  if( ts->s.timestamping_flags != 0 )
+    return 0;
+#endif
+  if( pkt_tcp->tcp_flags & (CI_TCP_FLAG_FIN | CI_TCP_FLAG_URG) )
+    return 0;
+
+  tail = PKT_CHK(netif, rxq->tail);
+  /* A referenced packet may be exposed to the application via zero-copy
+   * receive, and its payload must not change under the application's
+   * feet. */
+  if( tail->refcount != 1 )
+    return 0;
+  if( PKT_IPX_TCP_HDR(ipcache_af(&ts->s.pkt), tail)->tcp_flags &
+      (CI_TCP_FLAG_FIN | CI_TCP_FLAG_URG) )
+    return 0;
+  if( ! SEQ_EQ(tail->pf.tcp_rx.end_seq, tcp_rcv_nxt(ts)) )
+    return 0;
+
+  /* We must not move the tail's existing payload to make room (the reader
+   * may be copying it out), so only the space beyond the current end is
+   * usable. */
+  tail_buf_end = (char*) tail + CI_CFG_PKT_BUF_SIZE;
+  space = (int)(tail_buf_end - oo_offbuf_end(&tail->buf));
+  if( space <= 0 )
+    return 0;
+
+  n = CI_MIN(space, oo_offbuf_left(&pkt->buf));
+  memcpy(oo_offbuf_end(&tail->buf), oo_offbuf_ptr(&pkt->buf), n);
+  tail->buf.end += n;
+  tail->pf.tcp_rx.end_seq += n;
+  oo_offbuf_advance(&pkt->buf, n);
+  pkt_tcp->tcp_seq_be32 = CI_BSWAP_BE32(
+                              CI_BSWAP_BE32(pkt_tcp->tcp_seq_be32) + n);
+  tcp_rcv_nxt(ts) = tail->pf.tcp_rx.end_seq;
+  ci_tcp_rx_update_state_on_add(ts, n);
+  CITP_STATS_NETIF_INC(netif, rx_coalesced);
+  PKT_TCP_RX_BUF_ASSERT_VALID(netif, tail);
+
+  if( oo_offbuf_is_empty(&pkt->buf) ) {
+    ci_netif_pkt_release_rx(netif, pkt);
+    return 1;
+  }
+  return 0;
+}
+
+
 /** Enqueue a single packet pkt on the receive queue of [ts]. */
 static void ci_tcp_rx_enqueue_packet(ci_netif *netif, ci_tcp_state *ts,
                                      ci_ip_pkt_fmt *pkt)
@@ -264,6 +342,12 @@ static void ci_tcp_rx_enqueue_packet(ci_netif *netif, ci_tcp_state *ts,
     return;
   }
 
+  oo_rx_order_record(netif, S_SP(ts), oo_offbuf_left(&pkt->buf), pkt);
+
+  if( NI_OPTS(netif).tcp_rx_coalesce &&
+      ci_tcp_rx_coalesce_into_tail(netif, ts, pkt) )
+    return;
+
   tcp_rcv_nxt(ts) = pkt->pf.tcp_rx.end_seq;
   ci_tcp_rx_add_to_recvq(netif, ts, pkt, oo_offbuf_left(&pkt->buf));
 }
@@ -335,6 +419,10 @@ static void ci_tcp_rx_enqueue_chain(ci_netif *netif, ci_tcp_state *ts,
 
   tcp_rcv_nxt(ts) = last->pf.tcp_rx.end_seq;
 
+  /* One record covers the whole chain: it all became readable when the
+   * hole was filled, so it has a single delivery point in wire order. */
+  oo_rx_order_record(netif, S_SP(ts), bytes, last);
+
   /* move between two rx queues */
   ci_ip_queue_move(netif, from, rxq, last, num);
 
@@ -703,82 +791,14 @@ ci_inline unsigned ci_tcp_paws_check(ci_netif* netif, ci_uint32 tsval,
 }
 
 
-/* function to open the congestion window following the
-** reception of an ack for new data. Implements RFC3465 (ABC)
-*/
-ci_inline void ci_tcp_opencwnd(ci_netif *ni, ci_tcp_state* ts)
-{
-#if CI_CFG_CONG_AVOID_NOTIFIED
-  /* If congestion has been notified (but no loss detected yet)
-     gradually scale the cwnd back */
-  if( ts->congstate == CI_TCP_CONG_NOTIFIED ){
-    if(SEQ_LE(tcp_snd_una(ts), ts->congrecover))
-      ts->congstate = CI_TCP_CONG_OPEN;
-  }
-  else
-#endif
-  if( ts->cwnd >= ts->ssthresh ) {
-    /* Hack - Increase less aggresively on small round trip times */
-#if CI_CFG_CONG_AVOID_SCALE_BACK
-    unsigned tmp = 0, cwnd_scaled;
-    /* tcp_srtt(ts) would relatively easy exceed 32 for a round trip time
-     * on longer links */
-    if( tcp_srtt(ts) < 32 )
-      tmp = NI_OPTS(ni).cong_avoid_scale_back >> tcp_srtt(ts);
-    cwnd_scaled = CI_MAX(1U, tmp) * ts->cwnd;
-#else
-    unsigned cwnd_scaled = ts->cwnd;
-#endif
-    /* Congestion avoidance.  RFC3465 says: increase the congestion window
-    ** by one segment each RTT.  i.e. wait for bytes_acked to be > cwnd
-    ** (which takes one RTT), then reset bytes_acked by subtracting the
-    ** cwnd from it, and add one segment to cwnd.
-    */
-    LOG_TV(log(LPF "%d OPENCWND: CA eff_mss=%u bytes_acked=%u cwnd=%u",
-               S_FMT(ts), tcp_eff_mss(ts), ts->bytes_acked, ts->cwnd));
-    if( ts->bytes_acked >= cwnd_scaled ) {
-      ts->bytes_acked -= cwnd_scaled;
-      ts->cwnd += tcp_eff_mss(ts);
-    }
-  }
-  else {
-    /* Slow-start. */
-    unsigned cwnd_inc;
-    LOG_TV(log(LPF "%d OPENCWND: SS eff_mss=%u bytes_acked=%u cwnd=%u",
-               S_FMT(ts), tcp_eff_mss(ts), ts->bytes_acked, ts->cwnd));
-#if CI_CFG_CONG_AVOID_SLOW_START_MODE == 2
-    cwnd_inc = CI_MIN(ts->ssthresh - ts->cwnd, ts->bytes_acked);
-    ts->cwnd += cwnd_inc;
-    ts->bytes_acked -= cwnd_inc;
-#else
-    if( CI_CFG_CONG_AVOID_SLOW_START_MODE == 0 && ts->stats.rtos == 0 )
-      /* RFC3465 sec 2.2: May only increase cwnd by more than mss if we've
-      * never had any RTOs on this connection.
-      */
-      cwnd_inc = tcp_eff_mss(ts) * CI_CFG_CONG_AVOID_RFC3465_L_VALUE;
-    else
-      cwnd_inc = tcp_eff_mss(ts);
-    cwnd_inc = CI_MIN(cwnd_inc, ts->bytes_acked);
-    ts->cwnd += cwnd_inc;
-    ts->bytes_acked = 0;
-#endif
-  }
-
-  LOG_TV(log(LPF "%d OPENCWND: end cwnd=%u", S_FMT(ts), ts->cwnd));
-
-  ci_assert_le(tcp_eff_mss(ts), CI_MAX_ETH_FRAME_LEN);
-  ci_assert_ge(ts->cwnd, tcp_eff_mss(ts));
-  ci_assert_ge(ts->ssthresh, (ci_uint32)(tcp_eff_mss(ts) << 1));
-}
-
-
 static void ci_tcp_reset_cwnd_on_loss(ci_netif* ni, ci_tcp_state* ts)
 {
-  ts->ssthresh = ci_tcp_losswnd(ts);
+  ts->ssthresh = ci_tcp_cc(ts)->losswnd(ni, ts);
   ts->cwnd = ts->ssthresh + ci_tcp_base_dupack_thresh(ts) * tcp_eff_mss(ts);
   ts->cwnd = CI_MAX(ts->cwnd, NI_OPTS(ni).loss_min_cwnd);
   ts->cwnd = CI_MAX(ts->cwnd, NI_OPTS(ni).min_cwnd);
   ci_assert(ts->cwnd >= tcp_eff_mss(ts));
+  ci_tcp_telem_record(ts, OO_TCP_TELEM_CWND, ts->cwnd);
 }
 
 
@@ -839,6 +859,18 @@ int /*bool*/ ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts)
     return 0;
   }
 
+  ci_tcp_enter_fast_recovery(ni, ts);
+  return 1;
+}
+
+
+/* Unconditionally enters fast recovery.  Caller has decided that loss has
+ * occurred (dupack threshold, early retransmit or RACK) and that the
+ * retransmit queue is not empty. */
+void ci_tcp_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_assert(ci_ip_queue_not_empty(&ts->retrans));
+
   ++ts->stats.fast_recovers;
   ci_tcp_reset_cwnd_on_loss(ni, ts);
 
@@ -872,11 +904,95 @@ int /*bool*/ ci_tcp_maybe_enter_fast_recovery(ci_netif* ni, ci_tcp_state* ts)
     CI_TCP_EXT_STATS_INC_TCP_SACK_RECOVERY( ni );
   else
     CI_TCP_EXT_STATS_INC_TCP_RENO_RECOVERY( ni );
+}
 
-  return 1;
+
+#if CI_CFG_TCP_RACK
+
+/* Record delivery of [pkt] (cumulatively ACKed or newly SACKed) for RACK.
+ * Per RFC 8985 retransmitted segments are skipped (Karn's algorithm: we
+ * can't tell which transmission was delivered), and the most recently
+ * transmitted delivered segment advances the RACK point. */
+static void ci_tcp_rack_update(ci_netif* ni, ci_tcp_state* ts,
+                               ci_ip_pkt_fmt* pkt)
+{
+  ci_iptime_t tx_time = pkt->pf.tcp_tx.tx_time;
+
+  if( ! ci_tcp_rack_enabled(ni, ts) )
+    return;
+  if( pkt->flags & CI_PKT_FLAG_RTQ_RETRANS )
+    return;
+
+  if( ts->rack_rtt == 0 || TIME_GT(tx_time, ts->rack_xmit_time) ||
+      (tx_time == ts->rack_xmit_time &&
+       SEQ_LT(ts->rack_end_seq, pkt->pf.tcp_tx.end_seq)) ) {
+    ts->rack_xmit_time = tx_time;
+    ts->rack_end_seq = pkt->pf.tcp_tx.end_seq;
+    /* Clock granularity can give a zero RTT; force non-zero as zero means
+     * "nothing recorded yet". */
+    ts->rack_rtt = CI_MAX(ci_tcp_time_now(ni) - tx_time, 1u);
+  }
 }
 
 
+/* RFC 8985 loss detection.  A segment is deemed lost once a segment sent
+ * after it has been delivered and a reordering window (RTT/4) has passed
+ * since it should have arrived.  Our recovery machinery retransmits all
+ * un-SACKed holes once in fast recovery, so detection reduces to deciding
+ * when to enter recovery; if the reordering window has not yet passed for
+ * the first hole we arm [rack_tid] to re-check when it does. */
+void ci_tcp_rack_detect_loss(ci_netif* ni, ci_tcp_state* ts)
+{
+  ci_ip_pkt_fmt* pkt;
+  oo_pkt_p id;
+  ci_iptime_t reo_wnd, deadline, now;
+
+  if( ! ci_tcp_rack_enabled(ni, ts) || ts->rack_rtt == 0 )
+    return;
+  if( ts->congstate != CI_TCP_CONG_OPEN &&
+      ts->congstate != CI_TCP_CONG_NOTIFIED )
+    return;
+
+  /* Find the first segment that has not been SACKed: the head of the
+   * queue is typically the hole itself, so this loop rarely iterates. */
+  id = ts->retrans.head;
+  while( 1 ) {
+    if( OO_PP_IS_NULL(id) )
+      return;
+    pkt = PKT_CHK(ni, id);
+    if( ! (pkt->flags & CI_PKT_FLAG_RTQ_SACKED) )
+      break;
+    id = pkt->next;
+  }
+
+  /* Only segments sent before the RACK point can be declared lost. */
+  if( ! (TIME_GT(ts->rack_xmit_time, pkt->pf.tcp_tx.tx_time) ||
+         (ts->rack_xmit_time == pkt->pf.tcp_tx.tx_time &&
+          SEQ_LT(pkt->pf.tcp_tx.end_seq, ts->rack_end_seq))) )
+    return;
+
+  reo_wnd = CI_MAX(ts->rack_rtt >> 2, 1u);
+  deadline = pkt->pf.tcp_tx.tx_time + ts->rack_rtt + reo_wnd;
+  now = ci_tcp_time_now(ni);
+  if( TIME_GE(now, deadline) ) {
+    LOG_TL(log(LNT_FMT "RACK loss: tx=%x rack=%x/%08x rtt=%u reo_wnd=%u "
+               TCP_SND_FMT, LNT_PRI_ARGS(ni, ts), pkt->pf.tcp_tx.tx_time,
+               ts->rack_xmit_time, ts->rack_end_seq, ts->rack_rtt, reo_wnd,
+               TCP_SND_PRI_ARG(ts)));
+    CITP_STATS_NETIF(++ni->state->stats.tcp_rack_recovers);
+    ci_tcp_enter_fast_recovery(ni, ts);
+  }
+  else {
+    if( ci_ip_timer_pending(ni, &ts->rack_tid) )
+      ci_ip_timer_modify(ni, &ts->rack_tid, deadline);
+    else
+      ci_ip_timer_set(ni, &ts->rack_tid, deadline);
+  }
+}
+
+#endif  /* CI_CFG_TCP_RACK */
+
+
 static void ci_tcp_cwnd_extra_update(ci_netif* netif, ci_tcp_state* ts)
 {
   unsigned fack;
@@ -1039,7 +1155,7 @@ static void ci_tcp_try_cwndrecover(ci_tcp_state* ts, ci_netif* netif,
  * previously SACKed, as having now been SACKed. */
 static int /*bool*/
 ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
-                             unsigned end)
+                             unsigned end, oo_pkt_p* scan_from)
 {
   ci_ip_pkt_queue* rtq = &ts->retrans;
   ci_ip_pkt_fmt* start_block;
@@ -1068,9 +1184,11 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
   */
 
   /* Find the block the first packet covered is in.  (The packet at the
-  ** head of rtq certainly won't qualify).
+  ** head of rtq certainly won't qualify).  [scan_from] lets the caller
+  ** resume the search where the previous (lower-sequence) SACK block of
+  ** the same segment left off, rather than rescanning from the head.
   */
-  next_pp = rtq->head;
+  next_pp = *scan_from;
   while( 1 ) {
     start_block = PKT_CHK(ni, next_pp);
     if( OO_PP_IS_NULL(start_block->pf.tcp_tx.block_end) ) {
@@ -1205,12 +1323,24 @@ ci_tcp_rx_sack_process_block(ci_netif* ni, ci_tcp_state* ts, unsigned start,
     pkt = start_block;
   else
     pkt = start_pkt;
+  /* The next SACK block of this segment (if any) lies beyond this one, so
+  ** the search can resume at the head of the run we are about to mark and
+  ** skip it in a single hop. */
+  *scan_from = OO_PKT_P(pkt);
   while( pkt != end_pkt ) {
     pkt->pf.tcp_tx.block_end = next_pp;
+#if CI_CFG_TCP_RACK
+    if( ! (pkt->flags & CI_PKT_FLAG_RTQ_SACKED) )
+      ci_tcp_rack_update(ni, ts, pkt);
+#endif
     pkt->flags |= CI_PKT_FLAG_RTQ_SACKED;
     pkt = PKT_CHK(ni, pkt->next);
   }
   pkt->pf.tcp_tx.block_end = next_pp;
+#if CI_CFG_TCP_RACK
+  if( ! (pkt->flags & CI_PKT_FLAG_RTQ_SACKED) )
+    ci_tcp_rack_update(ni, ts, pkt);
+#endif
   pkt->flags |= CI_PKT_FLAG_RTQ_SACKED;
 
   /* We took early exits from this function when this SACK block was contained
@@ -1274,9 +1404,13 @@ ci_inline int ci_tcp_rx_dsack_check(ci_netif* ni, ci_tcp_state* ts,
 static void ci_tcp_rx_sack_process(ci_netif* netif, ci_tcp_state* ts,
 				   ciip_tcp_rx_pkt* rxp)
 {
-  int i;
+  int i, j;
   unsigned start;
   unsigned end;
+  unsigned starts[CI_TCP_SACK_MAX_BLOCKS];
+  unsigned ends[CI_TCP_SACK_MAX_BLOCKS];
+  int n_blocks = 0;
+  oo_pkt_p scan_from;
   int sacked = 0;
 
   if( !(ts->tcpflags & CI_TCPT_FLAG_SACK) ) {
@@ -1305,7 +1439,11 @@ static void ci_tcp_rx_sack_process(ci_netif* netif, ci_tcp_state* ts,
   /* Check for DSACK.  If it is, then skip the first block. */
   i = ci_tcp_rx_dsack_check(netif, ts, rxp);
 
-  /* Iterate over each sack block, deciding what action to take */
+  /* Gather the valid blocks sorted by start sequence, so that the
+  ** retransmit queue below is walked just once however many blocks the
+  ** segment carries.  (Senders report the most recent block first, so in
+  ** sequence terms the blocks usually arrive in reverse order.)
+  */
   for( ; i < rxp->sack_blocks; i++ ) {
     /* sequence numbers being selectively acknowledged */
     start = rxp->sack[2 * i];
@@ -1324,8 +1462,13 @@ static void ci_tcp_rx_sack_process(ci_netif* netif, ci_tcp_state* ts,
     */
     if( ! (/*1*/SEQ_LE(start, rxp->ack) | /*2*/SEQ_LT(tcp_snd_nxt(ts), end) |
            /*3*/SEQ_LE(end, start)) ) {
-      if( ci_tcp_rx_sack_process_block(netif, ts, start, end) )
-        sacked = 1;
+      for( j = n_blocks; j > 0 && SEQ_LT(start, starts[j - 1]); --j ) {
+        starts[j] = starts[j - 1];
+        ends[j] = ends[j - 1];
+      }
+      starts[j] = start;
+      ends[j] = end;
+      ++n_blocks;
     }
     else {
       /* Bad SACK block: sender is not behaving.  Prev code would clear the
@@ -1341,6 +1484,29 @@ static void ci_tcp_rx_sack_process(ci_netif* netif, ci_tcp_state* ts,
     }
   }
 
+  /* Merge overlapping blocks (possible with an inconsistent sender) so the
+  ** processed intervals are strictly increasing. */
+  for( i = j = 0; i < n_blocks; i++ ) {
+    if( j > 0 && SEQ_LE(starts[i], ends[j - 1]) ) {
+      if( SEQ_LT(ends[j - 1], ends[i]) )
+        ends[j - 1] = ends[i];
+    }
+    else {
+      starts[j] = starts[i];
+      ends[j] = ends[i];
+      ++j;
+    }
+  }
+  n_blocks = j;
+
+  /* Process the blocks in one pass over the retransmit queue: each block
+  ** resumes the scan where the previous one finished. */
+  scan_from = ts->retrans.head;
+  for( i = 0; i < n_blocks; i++ )
+    if( ci_tcp_rx_sack_process_block(netif, ts, starts[i], ends[i],
+                                     &scan_from) )
+      sacked = 1;
+
   if( sacked != 0 )
     rxp->flags |= CI_TCP_SACKED;
 }
@@ -1413,6 +1579,10 @@ static void ci_tcp_rx_free_acked_bufs(ci_netif* netif, ci_tcp_state* ts,
 
     ci_assert(p->refcount > 0);
 
+#if CI_CFG_TCP_RACK
+    ci_tcp_rack_update(netif, ts, p);
+#endif
+
 #if CI_CFG_TIMESTAMPING
     if( (p->flags & CI_PKT_FLAG_TX_TIMESTAMPED &&
          onload_timestamping_want_tx_nic(ts->s.timestamping_flags)) ||
@@ -1584,7 +1754,7 @@ static void ci_tcp_rx_handle_ack(ci_tcp_state* ts, ci_netif* netif,
 
     /* Open the congestion window. */
     ts->bytes_acked += acked;
-    ci_tcp_opencwnd(netif, ts);
+    ci_tcp_cc(ts)->on_ack(netif, ts, acked);
 
     /* New acknowledgement clears any dup_acks. */
     ts->dup_acks = 0;
@@ -1668,6 +1838,13 @@ static void ci_tcp_rx_handle_ack(ci_tcp_state* ts, ci_netif* netif,
   }
 #endif
 
+#if CI_CFG_TCP_RACK
+  /* ACK and SACK processing above may have advanced the RACK point past
+   * un-SACKed segments in the retransmit queue. */
+  if( ci_ip_queue_not_empty(&ts->retrans) )
+    ci_tcp_rack_detect_loss(netif, ts);
+#endif
+
   /* Clear keepalive counter -- it is important to clear this counter up on
    * every ACK for our keepalive request. */
   ci_tcp_kalive_reset(netif, ts);
@@ -2794,6 +2971,11 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
 
   ci_netif_put_on_post_poll(netif, &tls->s.b);
 
+  /* The syn-recv table will be searched for this 4-tuple below; start
+   * fetching the relevant chain now so the lookup runs against warm
+   * cache lines after the control-plane work. */
+  ci_tcp_listenq_prefetch(netif, tls, rxp);
+
   if( pkt->intf_i == OO_INTF_I_LOOPBACK ) {
     local_peer = pkt->pf.tcp_rx.lo.tx_sock;
     ci_assert_equal(pkt->pf.tcp_rx.lo.rx_sock, tls->s.b.bufid);
@@ -3149,7 +3331,7 @@ static void handle_rx_listen(ci_netif* netif, ci_tcp_socket_listen* tls,
   tsr->timest = ci_tcp_time_now(netif);
   tsr->rcv_nxt = rxp->seq + 1;
   if( tsr->tcpopts.flags & CI_TCPT_FLAG_WSCL ) {
-    if( NI_OPTS(netif).tcp_rcvbuf_mode == 1 ) {
+    if( NI_OPTS(netif).tcp_rcvbuf_mode != 0 ) {
       /* may overestimate MSS, but this is "OK" */
       tsr->rcv_wscl = (ci_uint8)
         ci_tcp_wscl_by_buff(netif,
@@ -3876,6 +4058,9 @@ static void handle_unacceptable_seq(ci_netif* netif, ci_tcp_state* ts,
   ci_tcp_hdr* tcp = rxp->tcp;
   int inflate;
 
+  ci_netif_fr_log(netif, CI_FR_EV_TCP_RX_BAD_SEQ,
+                  (ci_uint16) OO_SP_TO_INT(S_SP(ts)), rxp->seq);
+
   /* if we are awaiting their seq then it is likely to be unacceptable */
   if( ts->s.b.state == CI_TCP_SYN_SENT ) {
     handle_rx_syn_sent(netif, ts, rxp);
@@ -4510,6 +4695,11 @@ static void handle_rx_slow(ci_tcp_state* ts, ci_netif* netif,
   LOG_DU(ci_hex_dump(ci_log_fn, PKT_START(pkt), 64, 0));
   /* Intentional fall through... */
  drop:
+  ci_netif_fr_log(netif, CI_FR_EV_TCP_RX_DROP,
+                  (ci_uint16) CI_MIN(pkt->pf.tcp_rx.pay_len, 0xffff),
+                  rxp->seq);
+  ci_netif_drop_sample(netif, CI_DROP_REASON_TCP, pkt->intf_i,
+                       PKT_START(pkt), pkt->pf.tcp_rx.pay_len);
   ci_netif_pkt_release_rx(netif, pkt);
   return;
 }
@@ -4539,6 +4729,9 @@ static void handle_no_match(ci_netif* ni, ciip_tcp_rx_pkt* rxp)
     oo_tcpdump_dump_pkt(ni, pkt);
   }
 
+  ci_netif_drop_sample(ni, CI_DROP_REASON_NO_MATCH, pkt->intf_i,
+                       PKT_START(pkt), pkt->pay_len);
+
   LOG_TR(
     /* Do not print message in RST case: it is pretty normal for
      * just-dropped connection with some packets inflight. */
@@ -4614,6 +4807,15 @@ int ci_tcp_rx_deliver_to_conn(ci_sock_cmn* s, void* opaque_arg)
 
   ci_assert(CI_IPX_ADDR_EQ(RX_PKT_DADDR(pkt),
                              ipcache_laddr(&s->pkt)));
+
+  /* Refresh the demux hint for this flow; only write when it changes so
+   * steady state costs a read, not a dirtied cache line. */
+  if( rxp->hint_idx >= 0 &&
+      ni->state->rx_flow_hint[rxp->hint_idx] != SC_SP(s) )
+    ni->state->rx_flow_hint[rxp->hint_idx] = SC_SP(s);
+  if( rxp->nic_hint_idx >= 0 &&
+      ni->state->rx_nic_flow_hint[rxp->nic_hint_idx] != SC_SP(s) )
+    ni->state->rx_nic_flow_hint[rxp->nic_hint_idx] = SC_SP(s);
 #ifndef NDEBUG
   if( NI_OPTS(ni).tcp_rx_checks )
     ci_tcp_rx_checks(ni, ts, pkt);
@@ -4772,6 +4974,79 @@ int ci_tcp_rx_deliver_to_conn(ci_sock_cmn* s, void* opaque_arg)
 }
 
 
+/* Queue a SYN for processing after the rest of the event batch
+ * (EF_TCP_SYN_DEFER).  The packet keeps its RX reference; the target
+ * listening socket is stashed in the (otherwise unused for non-loopback
+ * packets) pf.tcp_rx.lo.rx_sock field.
+ */
+static void ci_tcp_rx_defer_syn(ci_netif* ni, ciip_tcp_rx_pkt* rxp,
+                                ci_sock_cmn* s)
+{
+  ci_ip_pkt_fmt* pkt = rxp->pkt;
+  ci_netif_state* ns = ni->state;
+
+  /* Bound the queue so that a sustained flood cannot tie up the packet
+   * pool: beyond four polls' worth of SYNs we just bin them, which is
+   * what a full listen queue would do to them anyway. */
+  if( ns->syn_defer_n >= NI_OPTS(ni).tcp_syn_defer * 4 ) {
+    CITP_STATS_NETIF_INC(ni, syn_defer_drop_overflow);
+    ci_netif_pkt_release_rx(ni, pkt);
+    return;
+  }
+
+  pkt->pf.tcp_rx.lo.rx_sock = SC_SP(s);
+  pkt->next = OO_PP_NULL;
+  if( OO_PP_IS_NULL(ns->syn_defer_head) )
+    ns->syn_defer_head = OO_PKT_P(pkt);
+  else
+    PKT_CHK(ni, ns->syn_defer_tail)->next = OO_PKT_P(pkt);
+  ns->syn_defer_tail = OO_PKT_P(pkt);
+  ++ns->syn_defer_n;
+  CITP_STATS_NETIF_INC(ni, syn_defer_queued);
+}
+
+
+void ci_tcp_rx_deferred_syns(ci_netif* ni)
+{
+  ci_netif_state* ns = ni->state;
+  ci_uint32 budget = NI_OPTS(ni).tcp_syn_defer;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  while( OO_PP_NOT_NULL(ns->syn_defer_head) && budget-- > 0 ) {
+    ci_ip_pkt_fmt* pkt = PKT_CHK(ni, ns->syn_defer_head);
+    ci_sock_cmn* s = ID_TO_SOCK_CMN(ni, pkt->pf.tcp_rx.lo.rx_sock);
+    ciip_tcp_rx_pkt rxp;
+
+    ns->syn_defer_head = pkt->next;
+    if( OO_PP_IS_NULL(ns->syn_defer_head) )
+      ns->syn_defer_tail = OO_PP_NULL;
+    --ns->syn_defer_n;
+
+    rxp.poll_state = NULL;
+    rxp.ni = ni;
+    rxp.pkt = pkt;
+    rxp.tcp = PKT_IPX_TCP_HDR(oo_pkt_af(pkt), pkt);
+    rxp.seq = CI_BSWAP_BE32(rxp.tcp->tcp_seq_be32);
+    rxp.ack = CI_BSWAP_BE32(rxp.tcp->tcp_ack_be32);
+    rxp.hash = ci_netif_filter_hash(ni, RX_PKT_DADDR(pkt),
+                                    rxp.tcp->tcp_dest_be16,
+                                    RX_PKT_SADDR(pkt),
+                                    rxp.tcp->tcp_source_be16, IPPROTO_TCP);
+
+    /* The listener can have gone away between demux and here; in that
+     * case fall back to the no-match path, which will reset the peer. */
+    if( s->b.state == CI_TCP_LISTEN ) {
+      handle_rx_listen(ni, SOCK_TO_TCP_LISTEN(s), &rxp, 0);
+      CITP_STATS_TCP_LISTEN(++SOCK_TO_TCP_LISTEN(s)->stats.n_rx_pkts);
+    }
+    else {
+      handle_no_match(ni, &rxp);
+    }
+  }
+}
+
+
 static int ci_tcp_rx_deliver_to_listen(ci_sock_cmn* s, void* opaque_arg)
 {
   ciip_tcp_rx_pkt* rxp = opaque_arg;
@@ -4784,6 +5059,17 @@ static int ci_tcp_rx_deliver_to_listen(ci_sock_cmn* s, void* opaque_arg)
     return 1;
   }
 
+  /* With EF_TCP_SYN_DEFER, fresh SYNs are parked until the data packets
+   * in this batch have been handled so that a scan or flood of a
+   * listener cannot inflate established-connection latency. */
+  if( NI_OPTS(rxp->ni).tcp_syn_defer != 0 &&
+      (rxp->tcp->tcp_flags & CI_TCP_FLAG_MASK) == CI_TCP_FLAG_SYN &&
+      rxp->pkt->intf_i != OO_INTF_I_LOOPBACK ) {
+    ci_tcp_rx_defer_syn(rxp->ni, rxp, s);
+    rxp->pkt = NULL;
+    return 1;
+  }
+
   handle_rx_listen(rxp->ni, SOCK_TO_TCP_LISTEN(s), rxp, 0);
   rxp->pkt = NULL;
   CITP_STATS_TCP_LISTEN(++SOCK_TO_TCP_LISTEN(s)->stats.n_rx_pkts);
@@ -4818,6 +5104,8 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
   rxp.poll_state = ps;
   rxp.pkt = pkt;
   rxp.tcp = tcp;
+  rxp.hint_idx = -1;
+  rxp.nic_hint_idx = -1;
   if( pkt->q_id != CI_Q_ID_TCP_RECYCLER || ! ci_tcp_plugin_elided_payload(pkt) )
     ci_assert_gt(pkt->pay_len, ip_paylen);
   pkt->pf.tcp_rx.pay_len = ip_paylen;
@@ -4955,6 +5243,32 @@ void ci_tcp_handle_rx(ci_netif* netif, struct ci_netif_poll_state* ps,
   else
 #endif
   {
+    if( NI_OPTS(netif).rx_flow_hint ) {
+      ef_vi* vi = ci_netif_vi(netif, pkt->intf_i);
+      unsigned idx = ci_netif_rx_flow_hint_idx(ip4->ip_daddr_be32,
+                                               tcp->tcp_dest_be16,
+                                               ip4->ip_saddr_be32,
+                                               tcp->tcp_source_be16);
+      ci_sock_cmn* s = ci_netif_rx_flow_hint_probe(netif,
+                                                   ip4->ip_daddr_be32,
+                                                   tcp->tcp_dest_be16,
+                                                   ip4->ip_saddr_be32,
+                                                   tcp->tcp_source_be16,
+                                                   pkt->intf_i, pkt->vlan,
+                                                   idx);
+      rxp.hint_idx = idx;
+      /* Keep the NIC flow-hash hint fresh too, so the poll loop's
+       * one-event-ahead prefetch keeps tracking this flow's socket. */
+      if( vi->rx_prefix_len != 0 )
+        rxp.nic_hint_idx = ci_netif_rx_nic_hint_idx(
+                       ef_vi_receive_prefix_flow_hash(vi, pkt->dma_start));
+      if( s != NULL ) {
+        CITP_STATS_NETIF_INC(netif, rx_flow_hint_hit);
+        ci_tcp_rx_deliver_to_conn(s, &rxp);
+        return;
+      }
+    }
+
     ci_netif_filter_for_each_match(netif,
                                    ip4->ip_daddr_be32, tcp->tcp_dest_be16,
                                    ip4->ip_saddr_be32, tcp->tcp_source_be16,
@@ -28,9 +28,12 @@ ci_inline int ci_tcp_need_ack(ci_netif* ni, ci_tcp_state* ts)
 #if CI_CFG_DYNAMIC_ACK_RATE 
     /* We only need to look at dynack_thresh, not also delack_thresh,
      * because we know dynack_thresh >= delack_thresh, and they are
-     * equal if that feature is disabled
+     * equal if that feature is disabled.  [dynack_adapt] further raises
+     * the threshold while the socket is receiving at a high rate; it is
+     * zero unless EF_DYNAMIC_ACK_MAX enables adaptation.
      */
-    ((ts->acks_pending & CI_TCP_ACKS_PENDING_MASK) > NI_OPTS(ni).dynack_thresh)
+    ((ts->acks_pending & CI_TCP_ACKS_PENDING_MASK) >
+     CI_MAX(NI_OPTS(ni).dynack_thresh, ts->dynack_adapt))
 #else
     ((ts->acks_pending & CI_TCP_ACKS_PENDING_MASK) > NI_OPTS(ni).delack_thresh)
 #endif
@@ -73,6 +76,24 @@ ci_inline void ci_tcp_rx_post_poll(ci_netif* ni, ci_tcp_state* ts)
   ts->t_prev_recv_payload = ts->t_last_recv_payload;
 #endif
 
+#if CI_CFG_DYNAMIC_ACK_RATE
+  /* Adaptive ACK thinning: track how many segments this socket received
+   * in this poll, and require about as many again before the next
+   * immediate ACK.  At a steady bulk rate this acknowledges each poll's
+   * batch with a single ACK; when the rate drops the threshold decays and
+   * the standard delayed-ack behaviour returns.  The delack-soon timer
+   * bounds how long a sub-threshold batch can go unacknowledged.
+   */
+  if( NI_OPTS(ni).dynack_max > NI_OPTS(ni).dynack_thresh ) {
+    ci_uint16 batch = ts->acks_pending & CI_TCP_ACKS_PENDING_MASK;
+    if( (ci_uint16) (batch >> 1) > ts->dynack_adapt )
+      ts->dynack_adapt = CI_MIN((ci_uint16) (batch >> 1),
+                                NI_OPTS(ni).dynack_max);
+    else
+      ts->dynack_adapt -= ts->dynack_adapt >> 2;
+  }
+#endif
+
   if( ts->acks_pending ) {
 #ifndef NDEBUG
     if( TCP_ACK_FORCED(ts) )
@@ -93,6 +114,11 @@ ci_inline void ci_tcp_rx_post_poll(ci_netif* ni, ci_tcp_state* ts)
       }
     }
 #if CI_CFG_DYNAMIC_ACK_RATE
+    /* Count the polls where only the adaptive threshold stopped us from
+     * sending an immediate ACK. */
+    if( (ts->acks_pending & CI_TCP_ACKS_PENDING_MASK) >
+        NI_OPTS(ni).dynack_thresh )
+      CITP_STATS_NETIF_INC(ni, acks_thinned);
     /* If these values are equal it implies dynamic_ack_rate is off */
     if( NI_OPTS(ni).dynack_thresh > NI_OPTS(ni).delack_thresh) {
       /* If up-to delack_thresh ACK request, then set delack timer as normal
@@ -171,6 +197,27 @@ ci_inline void ci_tcp_handle_rx_pre_future(ci_netif* netif, ci_ip_pkt_fmt* pkt,
 
   future->rxp.seq = CI_BSWAP_BE32(tcp->tcp_seq_be32);
   future->rxp.ack = CI_BSWAP_BE32(tcp->tcp_ack_be32);
+  future->rxp.hint_idx = -1;
+  future->rxp.nic_hint_idx = -1;
+
+  if( NI_OPTS(netif).rx_flow_hint ) {
+    unsigned idx = ci_netif_rx_flow_hint_idx(ip->ip_daddr_be32,
+                                             tcp->tcp_dest_be16,
+                                             ip->ip_saddr_be32,
+                                             tcp->tcp_source_be16);
+    ci_sock_cmn* s = ci_netif_rx_flow_hint_probe(netif, ip->ip_daddr_be32,
+                                                 tcp->tcp_dest_be16,
+                                                 ip->ip_saddr_be32,
+                                                 tcp->tcp_source_be16,
+                                                 pkt->intf_i, pkt->vlan, idx);
+    future->rxp.hint_idx = idx;
+    if( s != NULL ) {
+      CITP_STATS_NETIF_INC(netif, rx_flow_hint_hit);
+      future->socket = s;
+      CI_TCP_STATS_INC_IN_SEGS( netif );
+      return;
+    }
+  }
 
   ci_netif_filter_for_each_match(netif,
                                  ip->ip_daddr_be32, tcp->tcp_dest_be16,
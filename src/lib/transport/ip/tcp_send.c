@@ -26,7 +26,9 @@
 #include <sys/socket.h>
 #include <onload/extensions_zc.h>
 #include <onload/extensions_zc_hlrx.h>
+#include <onload/ul/tcp_helper.h>
 #include <limits.h>
+#include <stdlib.h>
 #endif
 #include <onload/pkt_filler.h>
 #include <onload/sleep.h>
@@ -76,6 +78,16 @@ struct tcp_send_info {
 };
 
 
+/* True if the tail of this send should be held back rather than pushed:
+ * the app asked for it (MSG_MORE or TCP_CORK), or EF_TCP_CORK_NS
+ * auto-corking is enabled for the stack. */
+ci_inline int ci_tcp_tx_corked(ci_netif* ni, ci_tcp_state* ts, int flags)
+{
+  return (flags & MSG_MORE) || (ts->s.s_aflags & CI_SOCK_AFLAG_CORK) ||
+         ni->state->tcp_cork_cycles != 0;
+}
+
+
 static void ci_tcp_tx_advance_nagle(ci_netif* ni, ci_tcp_state* ts)
 {
   /* Nagle's algorithm (rfc896).  Summary: when user pushes data, don't
@@ -401,7 +413,7 @@ ci_inline void ci_tcp_sendmsg_prep_pkt(ci_netif* ni, ci_tcp_state* ts,
   int af = ipcache_af(&ts->s.pkt);
 #endif
 
-  ci_ipcache_update_flowlabel(ni, &ts->s);
+  /* Caller has brought the ipcache flowlabel up to date. */
 
   /* Copy in the headers */
   ci_pkt_init_from_ipcache(pkt, &ts->s.pkt);
@@ -627,9 +639,91 @@ static int __ci_tcp_tmpl_normal_send(ci_netif* ni, ci_tcp_state* ts,
 }
 
 
-int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
-                      struct oo_msg_template** omt_pp,
-                      const struct iovec* initial_msg, int mlen, unsigned flags)
+/* Try to move one quiescent template to a lower PIO address.  Returns 1 if
+ * the template was moved.  A template is quiescent if it is not currently
+ * queued for transmit; moving one is safe because the packet buffer, not
+ * the PIO region, is the master copy of its contents.
+ */
+static int ci_tcp_tmpl_pio_relocate(ci_netif* ni, ci_ip_pkt_fmt* tmpl)
+{
+  ci_pio_buddy_allocator* buddy = &ni->state->nic[tmpl->intf_i].pio_buddy;
+  ci_int32 new_addr;
+
+  if( tmpl->flags & CI_PKT_FLAG_TX_PENDING )
+    return 0;
+
+  new_addr = ci_pio_buddy_alloc(ni, buddy, tmpl->pio_order);
+  if( new_addr < 0 )
+    return 0;
+  if( new_addr >= tmpl->pio_addr ) {
+    /* No better placement available. */
+    ci_pio_buddy_free(ni, buddy, new_addr, tmpl->pio_order);
+    return 0;
+  }
+
+  CI_DEBUG_TRY(ef_pio_memcpy(ci_netif_vi(ni, tmpl->intf_i), PKT_START(tmpl),
+                             new_addr, tmpl->buf_len));
+  ci_pio_buddy_free(ni, buddy, tmpl->pio_addr, tmpl->pio_order);
+  tmpl->pio_addr = new_addr;
+  return 1;
+}
+
+
+/* Compact the PIO region of [intf_i] by relocating quiescent templates
+ * towards the bottom of the region so that the space they leave behind
+ * merges into larger free blocks.  Socket churn fragments the region:
+ * without this, template allocation can fail with plenty of free space
+ * but no free block large enough.
+ *
+ * Returns the number of templates moved.  Called with the stack lock held.
+ */
+static int ci_tcp_tmpl_pio_compact(ci_netif* ni, int intf_i)
+{
+  int moved = 0;
+  int pass_moved;
+  unsigned i;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  /* Each move strictly lowers a template's address, so repeated passes
+   * terminate; in practice one or two passes suffice. */
+  do {
+    pass_moved = 0;
+    for( i = 0; i < ni->state->n_ep_bufs; ++i ) {
+      citp_waitable_obj* wo = SP_TO_WAITABLE_OBJ(ni, i);
+      citp_waitable* w = &wo->waitable;
+      if( (w->state & CI_TCP_STATE_TCP_CONN) || w->state == CI_TCP_CLOSED ) {
+        ci_tcp_state* ts = &wo->tcp;
+        oo_pkt_p pp;
+        for( pp = ts->tmpl_head; OO_PP_NOT_NULL(pp); ) {
+          ci_ip_pkt_fmt* tmpl = PKT_CHK(ni, pp);
+          if( tmpl->intf_i == intf_i && tmpl->pio_addr >= 0 )
+            pass_moved += ci_tcp_tmpl_pio_relocate(ni, tmpl);
+          pp = tmpl->next;
+        }
+      }
+    }
+    moved += pass_moved;
+  } while( pass_moved );
+
+  if( moved ) {
+    CITP_STATS_NETIF_INC(ni, pio_compactions);
+    CITP_STATS_NETIF(ni->state->stats.pio_compact_moves += moved);
+  }
+  return moved;
+}
+
+
+/* Does the work of allocating a single template.  Called with the stack
+ * lock held.  If [pio_base] is >= 0 the caller has already allocated a
+ * PIO block of [pio_order] for this template, and retains ownership of
+ * that block if we fail.
+ */
+static int __ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
+                               struct oo_msg_template** omt_pp,
+                               const struct iovec* initial_msg, int mlen,
+                               unsigned flags, ci_int32 pio_base,
+                               int pio_order)
 {
   int i, max_payload;
   int rc = 0;
@@ -643,25 +737,12 @@ int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
   struct tcp_send_info* sinf;
   int af = ipcache_af(&ts->s.pkt);
 
-#if defined(__powerpc64__)
-  LOG_U(ci_log("%s: This API is not supported on PowerPC yet.", __FUNCTION__));
-  return -ENOSYS;
-#endif
-
   /* Templated sends currently require two data structures both of
    * which are stored on the packet buffer to avoid memory
    * allocations.  They are placed at the end of the packet buffer.
   */
 
-  /* This is needed to ensure that an app written to a later version of the
-   * API gets an error if they try to use a flag we don't understand.
-   */
-  if(CI_UNLIKELY( flags & ~ONLOAD_TEMPLATE_FLAGS_PIO_RETRY )) {
-    LOG_E(ci_log("%s: called with unsupported flags=%x", __FUNCTION__, flags));
-    return -EINVAL;
-  }
-
-  ci_netif_lock(ni);
+  ci_assert(ci_netif_is_locked(ni));
 
   if(CI_UNLIKELY( (~ts->s.b.state & CI_TCP_STATE_SYNCHRONISED) )) {
     /* Only handling connected connections.
@@ -766,16 +847,26 @@ int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
    */
   ci_assert_equal(pkt->pio_addr, -1);
   pkt->intf_i = intf_i;
-  pkt->pio_order = ci_log2_ge(ts->outgoing_hdrs_len + ETH_HLEN + ETH_VLAN_HLEN
-                              + total_unsent, CI_CFG_MIN_PIO_BLOCK_ORDER);
-  pkt->pio_addr = ci_pio_buddy_alloc(ni, &nsn->pio_buddy, pkt->pio_order);
-  if( pkt->pio_addr < 0 ) {
-    pkt->pio_addr = -1;
-    if( ! (flags & ONLOAD_TEMPLATE_FLAGS_PIO_RETRY) ) {
-      ci_netif_pkt_release_1ref(ni, pkt);
-      --(ni->state->n_async_pkts);
-      rc = -ENOMEM;
-      goto out;
+  if( pio_base >= 0 ) {
+    /* The caller has carved this block out of a shared span. */
+    pkt->pio_order = pio_order;
+    pkt->pio_addr = pio_base;
+  }
+  else {
+    pkt->pio_order = ci_log2_ge(ts->outgoing_hdrs_len + ETH_HLEN
+                                + ETH_VLAN_HLEN + total_unsent,
+                                CI_CFG_MIN_PIO_BLOCK_ORDER);
+    pkt->pio_addr = ci_pio_buddy_alloc(ni, &nsn->pio_buddy, pkt->pio_order);
+    if( pkt->pio_addr < 0 && ci_tcp_tmpl_pio_compact(ni, intf_i) > 0 )
+      pkt->pio_addr = ci_pio_buddy_alloc(ni, &nsn->pio_buddy, pkt->pio_order);
+    if( pkt->pio_addr < 0 ) {
+      pkt->pio_addr = -1;
+      if( ! (flags & ONLOAD_TEMPLATE_FLAGS_PIO_RETRY) ) {
+        ci_netif_pkt_release_1ref(ni, pkt);
+        --(ni->state->n_async_pkts);
+        rc = -ENOMEM;
+        goto out;
+      }
     }
   }
 #if CI_CFG_IPV6
@@ -819,6 +910,7 @@ int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
   ++sinf->n_filled;
   CI_USER_PTR_SET(sinf->pf.pkt->pf.tcp_tx.next, sinf->fill_list);
   sinf->fill_list = sinf->pf.pkt;
+  ci_ipcache_update_flowlabel(ni, &ts->s);
   ci_tcp_sendmsg_prep_pkt(ni, ts, pkt, tcp_enq_nxt(ts));
 
   TX_PKT_IPX_TCP(af, sinf->fill_list)->tcp_flags =
@@ -826,7 +918,7 @@ int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
 
   /* Initialise the protocol headers.  We don't set those parts that will
    * always be rewritten when we do the actual send. */
-  ci_tcp_tx_finish(ni, ts, pkt);
+  ci_tcp_tx_finish(ni, ts, pkt, ci_tcp_time_now(ni));
   ci_tcp_ipx_hdr_init(af, oo_tx_ipx_hdr(af, pkt), oo_tx_l3_len(pkt));
 
   /* XXX: Do I need to ci_tcp_tx_set_urg_ptr(ts, ni, tcp);
@@ -845,6 +937,145 @@ int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
 
   ++ts->stats.tx_tmpl_active;
 
+ out:
+  return rc;
+}
+
+
+/* Checks common to the template allocation entry points that can be made
+ * before taking the stack lock.
+ */
+ci_inline int ci_tcp_tmpl_alloc_check(unsigned flags)
+{
+#if defined(__powerpc64__)
+  LOG_U(ci_log("%s: This API is not supported on PowerPC yet.", __FUNCTION__));
+  return -ENOSYS;
+#endif
+
+  /* This is needed to ensure that an app written to a later version of the
+   * API gets an error if they try to use a flag we don't understand.
+   */
+  if(CI_UNLIKELY( flags & ~ONLOAD_TEMPLATE_FLAGS_PIO_RETRY )) {
+    LOG_E(ci_log("%s: called with unsupported flags=%x", __FUNCTION__, flags));
+    return -EINVAL;
+  }
+  return 0;
+}
+
+
+int ci_tcp_tmpl_alloc(ci_netif* ni, ci_tcp_state* ts,
+                      struct oo_msg_template** omt_pp,
+                      const struct iovec* initial_msg, int mlen, unsigned flags)
+{
+  int rc;
+
+  if( (rc = ci_tcp_tmpl_alloc_check(flags)) < 0 )
+    return rc;
+
+  ci_netif_lock(ni);
+  rc = __ci_tcp_tmpl_alloc(ni, ts, omt_pp, initial_msg, mlen, flags, -1, 0);
+  ci_netif_unlock(ni);
+  return rc;
+}
+
+
+int ci_tcp_tmpl_alloc_array(ci_netif* ni, ci_tcp_state* ts,
+                            const struct onload_template_msg* msgs,
+                            int ntemplates,
+                            struct oo_msg_template** handles, unsigned flags)
+{
+  int i, j, rc;
+  int pio_order = 0;
+  ci_int32 base;
+  ci_netif_state_nic_t* nsn;
+  ci_ip_cached_hdrs* ipcache = &ts->s.pkt;
+
+  if( (rc = ci_tcp_tmpl_alloc_check(flags)) < 0 )
+    return rc;
+  if( ntemplates <= 0 )
+    return -EINVAL;
+
+  ci_netif_lock(ni);
+
+  if(CI_UNLIKELY( (~ts->s.b.state & CI_TCP_STATE_SYNCHRONISED) )) {
+    LOG_U(ci_log("%s: not synchronized\n", __FUNCTION__));
+    rc = -ENOTCONN;
+    goto out;
+  }
+
+  /* Validate cplane information once for the whole array so that we know
+   * which interface's PIO region to carve from.  As for single templates,
+   * retrrc_nomac is tolerated here and caught at update time. */
+  if(CI_UNLIKELY( ! oo_cp_ipcache_is_valid(ni, ipcache) )) {
+    oo_tcp_ipcache_update(ni, ts);
+    switch( ipcache->status ) {
+    case retrrc_success:
+    case retrrc_nomac:
+      break;
+    case retrrc_localroute:
+      goto local_route;
+    default:
+      LOG_U(ci_log("%s: cplane status=%d", __FUNCTION__, ipcache->status));
+      rc = -EHOSTUNREACH;
+      goto out;
+    }
+  }
+  if( ipcache->flags & CI_IP_CACHE_IS_LOCALROUTE ) {
+   local_route:
+    LOG_U(ci_log("%s: templated sends not supported on loopback connections",
+                 __FUNCTION__));
+    rc = -EOPNOTSUPP;
+    goto out;
+  }
+
+  nsn = &ni->state->nic[ipcache->intf_i];
+
+  /* All templates share a single span of the PIO region, carved into
+   * equal-sized blocks big enough for the largest message (with the same
+   * vlan headroom as for single templates). */
+  for( i = 0; i < ntemplates; ++i ) {
+    size_t total = 0;
+    for( j = 0; j < msgs[i].otm_mlen; ++j )
+      total += msgs[i].otm_msg[j].iov_len;
+    pio_order = CI_MAX(pio_order,
+                       ci_log2_ge(ts->outgoing_hdrs_len + ETH_HLEN +
+                                  ETH_VLAN_HLEN + total,
+                                  CI_CFG_MIN_PIO_BLOCK_ORDER));
+  }
+
+  base = ci_pio_buddy_alloc_array(ni, &nsn->pio_buddy, pio_order, ntemplates);
+  if( base < 0 && ci_tcp_tmpl_pio_compact(ni, ipcache->intf_i) > 0 )
+    base = ci_pio_buddy_alloc_array(ni, &nsn->pio_buddy, pio_order,
+                                    ntemplates);
+  if( base < 0 ) {
+    if( ! (flags & ONLOAD_TEMPLATE_FLAGS_PIO_RETRY) ) {
+      rc = -ENOMEM;
+      goto out;
+    }
+    base = -1;
+  }
+
+  rc = 0;
+  for( i = 0; i < ntemplates; ++i ) {
+    rc = __ci_tcp_tmpl_alloc(ni, ts, &handles[i], msgs[i].otm_msg,
+                             msgs[i].otm_mlen, flags,
+                             base >= 0 ? base + (i << pio_order) : -1,
+                             pio_order);
+    if( rc < 0 ) {
+      /* Unwind: free the templates created so far and return the blocks
+       * that have not been consumed. */
+      for( j = 0; j < i; ++j )
+        ci_tcp_tmpl_free(ni, ts, ci_tcp_tmpl_omt_to_pkt(handles[j]), 1);
+      if( base >= 0 )
+        for( j = i; j < ntemplates; ++j )
+          ci_pio_buddy_free(ni, &nsn->pio_buddy, base + (j << pio_order),
+                            pio_order);
+      for( j = 0; j < ntemplates; ++j )
+        handles[j] = NULL;
+      goto out;
+    }
+  }
+
  out:
   ci_netif_unlock(ni);
   return rc;
@@ -1108,6 +1339,10 @@ static int ci_tcp_sendmsg_enqueue(ci_netif* ni, ci_tcp_state* ts,
   ci_assert(ci_netif_is_locked(ni));
   ci_assert_equal(ts->s.tx_errno, 0);
 
+  /* The flowlabel is a property of the connection, not of the segment, so
+   * refresh it once for the whole list rather than per packet. */
+  ci_ipcache_update_flowlabel(ni, &ts->s);
+
   do {
     pkt = reverse_list;
     reverse_list = (ci_ip_pkt_fmt *)CI_USER_PTR_GET(pkt->pf.tcp_tx.next);
@@ -1485,7 +1720,7 @@ static int ci_tcp_sendmsg_no_pkt_buf(ci_netif* ni, ci_tcp_state* ts,
 {
   ci_ip_pkt_fmt* pkt;
   do {
-    pkt = ci_netif_pkt_alloc_nonb(ni);
+    pkt = ci_netif_pkt_alloc_nonb_cached(ni);
     if( pkt ) 
       oo_pkt_filler_add_pkt(&sinf->pf, pkt);
     else
@@ -1559,7 +1794,7 @@ static int ci_tcp_sendmsg_no_pkt_buf(ci_netif* ni, ci_tcp_state* ts,
         return -1;
       }
       do {
-        pkt = ci_netif_pkt_alloc_nonb(ni);
+        pkt = ci_netif_pkt_alloc_nonb_cached(ni);
         if( pkt ) 
           oo_pkt_filler_add_pkt(&sinf->pf, pkt);
         else
@@ -1597,6 +1832,7 @@ ci_inline int ci_tcp_sendmsg_spin(ci_netif* ni, ci_tcp_state* ts,
 {
   ci_uint64 now_frc;
   ci_uint64 schedule_frc;
+  ci_uint64 acct_frc;
   ci_uint64 max_spin = ts->s.b.spin_cycles;
   int spin_limit_by_so = 0;
 #ifndef __KERNEL__
@@ -1605,6 +1841,7 @@ ci_inline int ci_tcp_sendmsg_spin(ci_netif* ni, ci_tcp_state* ts,
 
   ci_frc64(&now_frc);
   schedule_frc = now_frc;
+  acct_frc = now_frc;
 
   if( ts->s.so.sndtimeo_msec ) {
     ci_uint64 max_so_spin = (ci_uint64)ts->s.so.sndtimeo_msec *
@@ -1616,9 +1853,19 @@ ci_inline int ci_tcp_sendmsg_spin(ci_netif* ni, ci_tcp_state* ts,
   }
 
   do {
+    int n_evs = 0;
+    int lock_missed = 0;
     if( ci_netif_may_poll(ni) ) {
-      if( ci_netif_need_poll_spinning(ni, now_frc) && si_trylock(ni, sinf) )
-        ci_netif_poll(ni);
+      if( ci_netif_need_poll_spinning(ni, now_frc) ) {
+        if( si_trylock(ni, sinf) ) {
+          n_evs = ci_netif_poll(ni);
+        }
+        else {
+          lock_missed = 1;
+          if( ! ni->state->is_spinner )
+            ni->state->is_spinner = 1;
+        }
+      }
       else if( ! ni->state->is_spinner )
         ni->state->is_spinner = 1;
     }
@@ -1637,7 +1884,8 @@ ci_inline int ci_tcp_sendmsg_spin(ci_netif* ni, ci_tcp_state* ts,
       sinf->stack_locked = 0;
     }
     ci_frc64(&now_frc);
-    sinf->rc = OO_SPINLOOP_PAUSE_CHECK_SIGNALS(ni, now_frc, &schedule_frc, 
+    OO_SPIN_ACCOUNT(ni, &acct_frc, now_frc, n_evs, lock_missed);
+    sinf->rc = OO_SPINLOOP_PAUSE_CHECK_SIGNALS(ni, now_frc, &schedule_frc,
                                                ts->s.so.sndtimeo_msec,
                                                NULL, si);
     if( sinf->rc != 0 ) {
@@ -1934,9 +2182,102 @@ static int ci_tcp_send_via_prequeue(ci_netif* ni, ci_tcp_state* ts,
 
 /* It is not safe to call this function while holding the netif lock */
 /*! \todo Confirm */
+/* Direct send fast path: when the send queue is empty and a single filled
+ * packet can go to the NIC immediately, transmit it via
+ * ci_tcp_tx_send_direct() and skip send-queue insertion entirely - the
+ * enqueue/advance round trip writes the sendq head, tail and num fields in
+ * shared state only for tx_advance to undo them a few instructions later.
+ * Any condition the generic path handles specially (corking, Nagle holding
+ * the segment back, windows too small, loopback, burst control) falls back
+ * by returning 0 with nothing consumed.
+ *
+ * Caller holds the stack lock, has checked tx_errno is clear and that
+ * [sinf->fill_list] holds all remaining data for this call.
+ */
+static int ci_tcp_sendmsg_send_direct(ci_netif* ni, ci_tcp_state* ts,
+                                      int flags, struct tcp_send_info* sinf)
+{
+#if CI_CFG_CONG_AVOID_NOTIFIED
+  /* The notified-congestion state machine lives in tx_advance. */
+  return 0;
+#else
+  ci_ip_pkt_fmt* pkt = sinf->fill_list;
+  unsigned end_seq;
+
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert_equal(ts->s.tx_errno, 0);
+  ci_assert_equal(sinf->total_unsent, sinf->fill_list_bytes);
+
+#ifdef MSG_SENDPAGE_NOTLAST
+  if( flags & MSG_SENDPAGE_NOTLAST )
+    return 0;
+#endif
+  if( CI_USER_PTR_GET(pkt->pf.tcp_tx.next) != NULL )
+    return 0;
+  if( ! ci_ip_queue_is_empty(&ts->send) )
+    return 0;
+  if( ci_tcp_tx_corked(ni, ts, flags) )
+    return 0;
+  if( ts->tcpflags & (CI_TCPT_FLAG_NO_TX_ADVANCE | CI_TCPT_FLAG_MSG_WARM |
+                      CI_TCPT_FLAG_LIMITED_TRANSMIT) )
+    return 0;
+  if( OO_SP_NOT_NULL(ts->local_peer) ||
+      (ts->s.pkt.flags & CI_IP_CACHE_IS_LOCALROUTE) )
+    return 0;
+#if CI_CFG_BURST_CONTROL
+  if( NI_OPTS(ni).burst_control_limit != 0 )
+    return 0;
+#endif
+  if( sinf->fill_list_bytes > tcp_eff_mss(ts) )
+    return 0;
+
+  /* Nagle: hold a sub-MSS segment back while data is in flight, unless
+   * urgent data is pending or TCP_NODELAY applies (mirroring the
+   * single-segment case in ci_tcp_tx_advance_nagle()). */
+  if( sinf->fill_list_bytes < tcp_eff_mss(ts) &&
+      ci_tcp_inflight(ts) != 0 &&
+      ! SEQ_LT(tcp_snd_una(ts), tcp_snd_up(ts)) ) {
+    if( ! (ts->s.s_aflags & CI_SOCK_AFLAG_NODELAY) )
+      return 0;
+    if( ts->retrans.num >= NI_OPTS(ni).nonagle_inflight_max &&
+        ts->eff_mss * ts->retrans.num >= ci_tcp_inflight(ts) * 2 )
+      return 0;
+  }
+
+  /* The whole segment must fit both the receive window and the congestion
+   * window; partial fits need the splitting logic in tx_advance. */
+  end_seq = tcp_enq_nxt(ts) + sinf->fill_list_bytes;
+  if( SEQ_GT(end_seq, ts->snd_max) ||
+      SEQ_GT(end_seq, tcp_snd_nxt(ts) + ts->cwnd + ts->cwnd_extra
+                      - ci_tcp_inflight(ts)) )
+    return 0;
+
+  ci_ipcache_update_flowlabel(ni, &ts->s);
+  ci_tcp_sendmsg_prep_pkt(ni, ts, pkt, tcp_enq_nxt(ts));
+  TX_PKT_IPX_TCP(ipcache_af(&ts->s.pkt), pkt)->tcp_flags =
+      CI_TCP_FLAG_PSH | CI_TCP_FLAG_ACK;
+  tcp_enq_nxt(ts) += sinf->fill_list_bytes;
+  --ni->state->n_async_pkts;
+
+  /* NB. We send before polling to get best latency. */
+  ci_ip_time_resync(IPTIMER_STATE(ni));
+  ci_tcp_tx_send_direct(ni, ts, pkt);
+
+  sinf->total_sent += sinf->fill_list_bytes;
+  sinf->total_unsent = 0;
+  sinf->fill_list = 0;
+  CITP_STATS_NETIF(++ni->state->stats.tcp_send_direct);
+
+  if( ci_netif_may_poll(ni) && ci_netif_has_event(ni) )
+    ci_netif_poll(ni);
+  return 1;
+#endif
+}
+
+
 int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
                    const ci_iovec* iov, unsigned long iovlen,
-                   int flags 
+                   int flags
                    CI_KERNEL_ARG(ci_addr_spc_t addr_spc))
 {
   ci_ip_pkt_queue* sendq = &ts->send;
@@ -2029,7 +2370,7 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
     /* This is last packet.  Set PUSH flag and MORE flag.
      * Send it if possible. */
     pkt = PKT_CHK(ni, sendq->tail);
-    if( (flags & MSG_MORE) || (ts->s.s_aflags & CI_SOCK_AFLAG_CORK) ) {
+    if( ci_tcp_tx_corked(ni, ts, flags) ) {
       pkt->flags |= CI_PKT_FLAG_TX_MORE;
       pkt->flags &=~ CI_PKT_FLAG_TX_PSH_ON_ACK;
     }
@@ -2088,7 +2429,7 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
     ci_tcp_send_fill_pkts(ni, ts, &sinf, &piov, m CI_KERNEL_ARG(addr_spc));
     m = 0;
     /* Look on MSG_MORE: do not send the last packet if it is not full */
-    if( (flags & MSG_MORE) || (ts->s.s_aflags & CI_SOCK_AFLAG_CORK) ) {
+    if( ci_tcp_tx_corked(ni, ts, flags) ) {
       sinf.pf.pkt->flags |= CI_PKT_FLAG_TX_MORE;
       sinf.pf.pkt->flags &=~ CI_PKT_FLAG_TX_PSH_ON_ACK;
     }
@@ -2105,6 +2446,14 @@ int ci_tcp_sendmsg(ci_netif* ni, ci_tcp_state* ts,
         return sinf.rc;
       }
 
+      if( sinf.total_unsent == sinf.fill_list_bytes &&
+          ci_tcp_sendmsg_send_direct(ni, ts, flags, &sinf) ) {
+        /* Assert that there's no need to free unused packets */
+        ci_assert_equal(sinf.pf.alloc_pkt, NULL);
+        if( sinf.stack_locked ) ci_netif_unlock(ni);
+        return sinf.total_sent;
+      }
+
       /* eff_mss may now be != ts->eff_mss */
       ts->send_in += ci_tcp_sendmsg_enqueue(ni, ts,
                                             sinf.fill_list,
@@ -2467,6 +2816,61 @@ static inline bool ci_tcp_tx_has_room_for_zc(ci_netif* ni, ci_ip_pkt_fmt* pkt,
 }
 
 
+/* Register the chunk(s) of an ONLOAD_ZC_REGISTER_ON_DEMAND region
+ * covering [ptr, ptr+len) with the NIC, if not already registered.  The
+ * kernel hands back per-NIC-page hardware addresses laid out per chunk,
+ * which we scatter into the region-wide hw_addrs[] layout that
+ * zc_usermem_dma_addr() expects.  Caller must hold the stack lock.
+ */
+static int ci_zc_usermem_demand_register(ci_netif* ni,
+                                         struct ci_zc_usermem* um,
+                                         uint64_t ptr, uint64_t len)
+{
+  uint64_t chunk_bytes =
+      (uint64_t)um->lazy_chunk_pages << EF_VI_NIC_PAGE_SHIFT;
+  uint32_t c0 = (ptr - um->base) / chunk_bytes;
+  uint32_t c1 = (ptr + len - 1 - um->base) / chunk_bytes;
+  uint32_t region_pages = um->size >> EF_VI_NIC_PAGE_SHIFT;
+  uint32_t c;
+
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert_lt(c1, um->lazy_n_chunks);
+
+  for( c = c0; c <= c1; ++c ) {
+    uint64_t chunk_base = um->base + (uint64_t)c * chunk_bytes;
+    uint32_t chunk_pages = CI_MIN(chunk_bytes, um->base + um->size -
+                                  chunk_base) >> EF_VI_NIC_PAGE_SHIFT;
+    uint64_t* hw_addrs;
+    int intf_i, rc;
+
+    if( um->chunk_kernel_ids[c] != CI_ZC_USERMEM_CHUNK_UNREG )
+      continue;
+
+    hw_addrs = malloc(sizeof(hw_addrs[0]) * chunk_pages *
+                      oo_stack_intf_max(ni));
+    if( hw_addrs == NULL )
+      return -ENOMEM;
+    rc = ci_tcp_helper_zc_register_buffers(ni,
+                                           (void*)(uintptr_t)chunk_base,
+                                           chunk_pages, um->lazy_reg_flags,
+                                           hw_addrs,
+                                           &um->chunk_kernel_ids[c]);
+    if( rc < 0 ) {
+      um->chunk_kernel_ids[c] = CI_ZC_USERMEM_CHUNK_UNREG;
+      free(hw_addrs);
+      return rc;
+    }
+    for( intf_i = 0; intf_i < oo_stack_intf_max(ni); ++intf_i )
+      memcpy(um->hw_addrs + (uint64_t)intf_i * region_pages +
+             ((chunk_base - um->base) >> EF_VI_NIC_PAGE_SHIFT),
+             hw_addrs + (uint64_t)intf_i * chunk_pages,
+             sizeof(hw_addrs[0]) * chunk_pages);
+    free(hw_addrs);
+  }
+  return 0;
+}
+
+
 int ci_tcp_zc_send(ci_netif* ni, ci_tcp_state* ts, struct onload_zc_mmsg* msg,
                    int flags)
 {
@@ -2639,6 +3043,11 @@ int ci_tcp_zc_send(ci_netif* ni, ci_tcp_state* ts, struct onload_zc_mmsg* msg,
       ci_assert_le(msg->msg.iov[j].iov_ptr + msg->msg.iov[j].iov_len,
                    um->base + um->size);
 
+      if( um->lazy_chunk_pages != 0 &&
+          ci_zc_usermem_demand_register(ni, um, msg->msg.iov[j].iov_ptr,
+                                        msg->msg.iov[j].iov_len) < 0 )
+        goto bad_buffer;
+
       if( !pkt && ci_ip_queue_not_empty(&ts->send) ) {
         ci_ip_pkt_fmt *tail_pkt = PKT_CHK(ni, ts->send.tail);
         if( NI_OPTS(ni).tcp_combine_sends_mode == 0 ||
@@ -2825,7 +3234,7 @@ int ci_tcp_zc_send(ci_netif* ni, ci_tcp_state* ts, struct onload_zc_mmsg* msg,
       break;
   }
 
-  if( ((flags & MSG_MORE) || (ts->s.s_aflags & CI_SOCK_AFLAG_CORK)) ) {
+  if( ci_tcp_tx_corked(ni, ts, flags) ) {
     pkt->flags |= CI_PKT_FLAG_TX_MORE;
     pkt->flags &=~ CI_PKT_FLAG_TX_PSH_ON_ACK;
   }
@@ -3344,6 +3753,289 @@ send_q_full:
 
 }
 
+
+/* Zero-copy variant of ci_tcp_ds_done().  The delegated bytes live in zc
+ * pktbufs owned by the application, so rather than copying them into fresh
+ * packet buffers we take ownership of the pktbufs and place them straight
+ * on the retransmit queue.  A retransmit can then be serviced by the stack
+ * without the data ever being copied back through the complete() call.
+ *
+ * Each iovec must refer to a buffer allocated from this stack with
+ * onload_zc_alloc_buffers(), laid out as for onload_zc_send(), carrying at
+ * most eff_mss bytes; the payload must match what was put on the wire.
+ * On success all the buffers are owned by the stack; on failure the
+ * application keeps ownership of all of them.
+ */
+int ci_tcp_ds_done_zc(ci_netif* ni, ci_tcp_state* ts,
+                      const struct onload_zc_iovec* iov, int iovlen,
+                      int flags)
+{
+  ci_ip_pkt_fmt* fill_list = NULL;
+  ci_ip_pkt_fmt* pkt;
+  int i, n_pkts, skip;
+  int total_bytes = 0;
+  int fill_list_bytes = 0;
+  int already_acked;
+  unsigned eff_mss;
+  int af = ipcache_af(&ts->s.pkt);
+#if ! CI_CFG_IPV6
+  (void)af;
+#endif
+
+  if( flags & ONLOAD_MSG_WARM )
+    RET_WITH_ERRNO(EINVAL);
+
+  for( i = 0; i < iovlen; ++i )
+    total_bytes += iov[i].iov_len;
+  if( total_bytes == 0 )
+    return 0;
+  /* snd_delegated is not protected by the stack lock - the caller must
+   * care about it. */
+  if( total_bytes > ts->snd_delegated )
+    RET_WITH_ERRNO(EMSGSIZE);
+
+  ci_netif_lock(ni);
+
+  if( ts->s.tx_errno ) {
+    /* The caller raises SIGPIPE on EPIPE, as for ci_tcp_ds_done(). */
+    ci_netif_unlock(ni);
+    RET_WITH_ERRNO(ts->s.tx_errno);
+  }
+
+  eff_mss = tcp_eff_mss(ts);
+
+  /* Validate everything before consuming anything, so that on failure the
+   * application still owns all of its buffers. */
+  for( i = 0; i < iovlen; ++i ) {
+    if( iov[i].buf == ONLOAD_ZC_HANDLE_NONZC || ! zc_is_pktbuf(iov[i].buf) )
+      goto bad_buffer;
+    pkt = zc_handle_to_pktbuf(iov[i].buf);
+    if( pkt->stack_id != ni->state->stack_id ||
+        iov[i].iov_len <= 0 ||
+        iov[i].iov_len > eff_mss ||
+        (char*)iov[i].iov_base < PKT_START(pkt) + ts->outgoing_hdrs_len ||
+        (char*)iov[i].iov_base + iov[i].iov_len >
+        ((char*)pkt) + CI_CFG_PKT_BUF_SIZE )
+      goto bad_buffer;
+  }
+
+  /* One packet per iovec; don't overfill the send pipe. */
+  if( ci_tcp_tx_send_space(ni, ts) < iovlen ) {
+    ci_netif_unlock(ni);
+    RET_WITH_ERRNO(EAGAIN);
+  }
+
+  /* Bytes that were ACKed before completion need no retransmit
+   * protection; their buffers can be released immediately. */
+  already_acked = SEQ_SUB(ts->snd_una, ts->snd_nxt);
+  if( already_acked < 0 )
+    already_acked = 0;
+  already_acked = CI_MIN(already_acked, total_bytes);
+
+  skip = already_acked;
+  n_pkts = 0;
+  for( i = 0; i < iovlen; ++i ) {
+    char* base = (char*) iov[i].iov_base;
+    int len = iov[i].iov_len;
+
+    pkt = zc_handle_to_pktbuf(iov[i].buf);
+    if( skip >= len ) {
+      /* Wholly ACKed: we own the buffer now, and it is done with. */
+      skip -= len;
+      ci_netif_pkt_release(ni, pkt);
+      continue;
+    }
+    /* Partially ACKed buffers are trimmed at the front so that the
+     * enqueued sequence space starts at snd_una. */
+    base += skip;
+    len -= skip;
+    skip = 0;
+
+    pkt->pio_addr = -1;
+    oo_pkt_af_set(pkt, af);
+    __ci_tcp_tx_pkt_init(pkt, ((uint8_t*) base -
+                              (uint8_t*) oo_tx_l3_hdr(pkt)), eff_mss);
+    pkt->n_buffers = 1;
+    pkt->buf_len += len;
+    pkt->pay_len += len;
+    oo_offbuf_advance(&pkt->buf, len);
+    pkt->pf.tcp_tx.end_seq = len;
+    CI_USER_PTR_SET(pkt->pf.tcp_tx.next, fill_list);
+    fill_list = pkt;
+    fill_list_bytes += len;
+    ++n_pkts;
+  }
+
+  if( already_acked > 0 ) {
+    ts->snd_delegated -= already_acked;
+    ts->snd_nxt += already_acked;
+    tcp_enq_nxt(ts) += already_acked;
+  }
+  if( fill_list != NULL ) {
+    ci_tcp_sendmsg_enqueue(ni, ts, fill_list, fill_list_bytes, &ts->retrans);
+    ts->snd_nxt += fill_list_bytes;
+    ts->snd_delegated -= fill_list_bytes;
+    if( ci_netif_may_poll(ni) && ci_netif_need_poll(ni) )
+      ci_netif_poll(ni);
+    if( ! ci_ip_queue_is_empty(&ts->retrans) )
+      ci_tcp_rto_check_and_set(ni, ts);
+  }
+
+  ci_netif_unlock(ni);
+  return total_bytes;
+
+ bad_buffer:
+  ci_netif_unlock(ni);
+  RET_WITH_ERRNO(EINVAL);
+}
+
+
+/* Move received packet buffers from [ts_in]'s receive queue straight onto
+ * [ts_out]'s send queue, for proxies that would otherwise copy every byte
+ * through userspace.  The payload stays where the NIC delivered it: each
+ * buffer is converted from RX to TX accounting and reframed in place, with
+ * ci_tcp_sendmsg_prep_pkt() reflowing the payload if [ts_out]'s headers
+ * need more or less room than the received ones.
+ *
+ * A buffer can only move wholesale, so a packet is eligible only if it is
+ * wholly unread, wanted in full, fits in one outgoing segment, has a
+ * single fragment and no other references (MSG_PEEK or zero-copy receives
+ * can take extra references).  We stop at the first ineligible packet and
+ * return the bytes moved so far; the caller is expected to fall back to
+ * copying when we return -EOPNOTSUPP.
+ *
+ * Caller must hold the stack lock and both socket locks.
+ */
+int ci_tcp_splice(ci_netif* ni, ci_tcp_state* ts_in, ci_tcp_state* ts_out,
+                  int len)
+{
+  ci_ip_pkt_queue* rxq = &ts_in->recv1;
+  ci_ip_pkt_fmt* fill_list = NULL;
+  ci_ip_pkt_fmt* pkt;
+  int af = ipcache_af(&ts_out->s.pkt);
+  int n_pkts = 0;
+  int total = 0;
+  int sendq_credit;
+  unsigned eff_mss;
+#if ! CI_CFG_IPV6
+  (void)af;
+#endif
+
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert(ci_sock_is_locked(ni, &ts_in->s.b));
+  ci_assert(ci_sock_is_locked(ni, &ts_out->s.b));
+
+  if( ts_out->s.tx_errno )
+    return -ts_out->s.tx_errno;
+
+  /* Urgent data would be reordered ahead of the normal stream. */
+  if( ci_ip_queue_not_empty(&ts_in->recv2) )
+    return -EOPNOTSUPP;
+
+  if( tcp_rcv_usr(ts_in) == 0 || OO_PP_IS_NULL(ts_in->recv1_extract) ) {
+    if( TCP_RX_DONE(ts_in) )
+      return -TCP_RX_ERRNO(ts_in);  /* 0 at EOF */
+    return -EAGAIN;
+  }
+
+  pkt = PKT_CHK_NNL(ni, ts_in->recv1_extract);
+  if( oo_offbuf_is_empty(&pkt->buf) ) {
+    if( OO_PP_IS_NULL(pkt->next) )
+      return -EAGAIN;
+    /* See ci_tcp_recvmsg_get_nopeek() for barrier discussion. */
+    ci_wmb();
+    ts_in->recv1_extract = pkt->next;
+  }
+
+  /* Dequeueing below requires the head of recv1 and the extract pointer to
+   * coincide, so release any already-consumed buffers first. */
+  ci_tcp_rx_reap_rxq_bufs(ni, ts_in);
+  ci_assert(OO_PP_EQ(rxq->head, ts_in->recv1_extract));
+
+  eff_mss = tcp_eff_mss(ts_out);
+  sendq_credit = ci_tcp_tx_send_space(ni, ts_out);
+
+  /* Keep spliced bytes ordered behind anything a concurrent sender put on
+   * the prequeue before we took [ts_out]'s socket lock. */
+  ci_tcp_sendmsg_enqueue_prequeue(ni, ts_out, CI_FALSE);
+
+  while( total < len && sendq_credit > 0 &&
+         OO_PP_NOT_NULL(ts_in->recv1_extract) ) {
+    char* base;
+    int n;
+
+    pkt = PKT_CHK_NNL(ni, ts_in->recv1_extract);
+    base = oo_offbuf_ptr(&pkt->buf);
+    n = oo_offbuf_left(&pkt->buf);
+    if( n == 0 )
+      break;
+
+    /* The buffer moves wholesale, so the unread payload must be wanted in
+     * full, form at most one outgoing segment, live in a single fragment
+     * with room for [ts_out]'s headers in front of it, and have no other
+     * users.  The headroom test uses the TX layout: PKT_START() is not
+     * valid until the packet is relaid below. */
+    if( n > len - total || n > (int) eff_mss ||
+        pkt->refcount != 1 || pkt->n_buffers != 1 ||
+        base < (char*) pkt->dma_start + ETH_HLEN + ts_out->outgoing_hdrs_len )
+      break;
+
+    /* Take the packet off the receive queue.  [recv1_extract] normally
+     * trails the head, but with both locks held we can collapse the two;
+     * the RX path re-inits a NULL extract pointer when data next arrives. */
+    ts_in->recv1_extract = pkt->next;
+    ci_tcp_rx_queue_dequeue(ni, ts_in, rxq, pkt);
+    ts_in->rcv_delivered += n;
+
+    /* Convert to a TX packet.  [refcount] is 1, so this is in-place and
+     * cannot fail, and the payload is preserved. */
+    pkt = ci_netif_pkt_rx_to_tx(ni, pkt);
+    ci_assert(pkt != NULL);
+    pkt->flags &= CI_PKT_FLAG_IS_IP6;
+
+    /* Frame as for a zero-copy send: see onload_zc_send() pktbuf handling
+     * in ci_tcp_sendmsg(). */
+    pkt->pio_addr = -1;
+    oo_pkt_af_set(pkt, af);
+    oo_tx_pkt_layout_init(pkt);
+    __ci_tcp_tx_pkt_init(pkt, (int) (base - (char*) oo_tx_l3_hdr(pkt)),
+                         eff_mss);
+    pkt->n_buffers = 1;
+    pkt->buf_len += n;
+    pkt->pay_len += n;
+    oo_offbuf_advance(&pkt->buf, n);
+    pkt->pf.tcp_tx.end_seq = n;
+    CI_USER_PTR_SET(pkt->pf.tcp_tx.next, fill_list);
+    fill_list = pkt;
+    ++n_pkts;
+    total += n;
+    --sendq_credit;
+    CITP_STATS_NETIF_INC(ni, tcp_splice_pkts);
+  }
+
+  if( fill_list != NULL ) {
+    fill_list->flags |= CI_PKT_FLAG_TX_PSH;
+    /* These buffers did not come through the send path's allocator, so
+     * compensate for ci_tcp_sendmsg_enqueue() decrementing n_async_pkts. */
+    ni->state->n_async_pkts += n_pkts;
+    ci_tcp_sendmsg_enqueue(ni, ts_out, fill_list, total, &ts_out->send);
+    ci_tcp_tx_advance(ts_out, ni);
+
+    /* Mirror ci_tcp_recvmsg_send_wnd_update(): we may have opened the
+     * receive window, and already hold the stack lock. */
+    if( ! (ts_in->s.b.state & CI_TCP_STATE_NOT_CONNECTED) &&
+        CI_UNLIKELY(SEQ_LE(ts_in->ack_trigger, ts_in->rcv_delivered)) &&
+        ! ci_tcp_send_wnd_update(ni, ts_in, CI_TRUE) )
+      ts_in->ack_trigger = ts_in->rcv_delivered
+                           + ci_tcp_ack_trigger_delta(ts_in);
+
+    return total;
+  }
+
+  /* Nothing moved: data is present but not movable as whole buffers. */
+  return -EOPNOTSUPP;
+}
+
 #endif
 #endif
 
@@ -17,6 +17,11 @@
 
 #ifndef __KERNEL__
 # include <ci/internal/ip_signal.h>
+# include <linux/futex.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+# include <errno.h>
+# include <limits.h>
 # define HANDLE_SIGNALS 1
 #else
 # define HANDLE_SIGNALS 0
@@ -31,6 +36,71 @@
 
 #ifndef __KERNEL__
 
+/* Wakeups originating in the kernel cannot ding the futex, so a futex-wait
+ * is bounded and the caller's sleep loop re-checks the waitable.  See
+ * EF_PIPE_FUTEX.
+ */
+#define OO_FUTEX_POLL_NS  100000000
+
+
+void citp_waitable_futex_wake(ci_netif* ni, citp_waitable* w, unsigned why)
+{
+  unsigned b;
+  for( b = 0; b < 2; ++b )
+    if( (why & (1u << b)) && OO_ACCESS_ONCE(w->futex_waiters[b]) != 0 ) {
+      ci_atomic32_inc(&w->futex_word[b]);
+      syscall(__NR_futex, &w->futex_word[b], FUTEX_WAKE, INT_MAX,
+              NULL, NULL, 0);
+      CITP_STATS_NETIF(++ni->state->stats.futex_wakes);
+    }
+}
+
+
+/* Block on the waitable's futex word for the direction we care about,
+ * rather than in the driver.  Safe only when the wakeup will come from
+ * another user-level thread (or from the caller's bounded re-check); used
+ * for pipes under EF_PIPE_FUTEX.  As with the driver path, the caller
+ * re-checks its condition on return, so spurious returns are harmless.
+ */
+static int oo_sock_sleep_futex(ci_netif* ni, citp_waitable* w, ci_bits why,
+                               citp_signal_info* si, ci_uint64 sleep_seq)
+{
+  struct timespec timeout = { 0, OO_FUTEX_POLL_NS };
+  unsigned dirn = (why & CI_SB_FLAG_WAKE_RX) ? CI_SB_FLAG_WAKE_RX_B :
+                                               CI_SB_FLAG_WAKE_TX_B;
+  ci_uint32 fval;
+  int rc;
+
+ again:
+  fval = OO_ACCESS_ONCE(w->futex_word[dirn]);
+  ci_atomic32_inc(&w->futex_waiters[dirn]);
+  /* Pairs with the barrier in the waker between bumping sleep_seq and
+   * testing futex_waiters: either we see the new sleep_seq, or the waker
+   * sees us and dings the futex.
+   */
+  ci_mb();
+  if( w->sleep_seq.all != sleep_seq ) {
+    ci_atomic32_dec(&w->futex_waiters[dirn]);
+    return 0;
+  }
+  rc = syscall(__NR_futex, &w->futex_word[dirn], FUTEX_WAIT, fval, &timeout,
+               NULL, 0);
+  ci_atomic32_dec(&w->futex_waiters[dirn]);
+  if( rc < 0 && errno == EINTR ) {
+    if( si->c.aflags & OO_SIGNAL_FLAG_HAVE_PENDING ) {
+      /* Call oo_spinloop_run_pending_sigs() with w=NULL because the socket
+       * is not locked. */
+      rc = oo_spinloop_run_pending_sigs(ni, NULL, si, 0);
+      if( rc < 0 )
+        return rc;
+    }
+    if( w->sleep_seq.all == sleep_seq )
+      goto again;
+  }
+  return 0;
+}
+
+
 int ci_sock_sleep(ci_netif* ni, citp_waitable* w, ci_bits why,
                   unsigned lock_flags, ci_uint64 sleep_seq,
                   ci_uint32 *timeout_ms_p)
@@ -54,6 +124,15 @@ int ci_sock_sleep(ci_netif* ni, citp_waitable* w, ci_bits why,
   ci_assert(!(lock_flags & CI_SLEEP_NETIF_LOCKED) || ci_netif_is_locked(ni));
   ci_assert(!(lock_flags & CI_SLEEP_SOCK_LOCKED) || ci_sock_is_locked(ni, w));
 
+  /* Pipe sleeps can block on the futex doorbell in shared state instead of
+   * in the driver: pipe wakeups come from the peer end at user-level, which
+   * dings the futex directly.  Pipes sleep with no locks held and no
+   * timeout, so anything else falls through to the driver.
+   */
+  if( NI_OPTS(ni).pipe_futex && w->state == CI_TCP_STATE_PIPE &&
+      lock_flags == 0 && timeout_ms_p == NULL )
+    return oo_sock_sleep_futex(ni, w, why, si, sleep_seq);
+
 #if CI_CFG_UL_INTERRUPT_HELPER
   if( lock_flags & CI_SLEEP_NETIF_LOCKED ) {
     ci_netif_unlock(ni);
@@ -215,15 +294,22 @@ int ci_sock_lock_slow(ci_netif* ni, citp_waitable* w)
   /* Limit to user-level for now.  Could allow spinning in kernel if we did
    * not rely on user-level accessible state for spin timeout.
    */
-  if( oo_per_thread_get()->spinstate & (1 << ONLOAD_SPIN_SOCK_LOCK) ) {
-    CITP_STATS_NETIF(++ni->state->stats.sock_lock_buzz);
-    ci_frc64(&now_frc);
-    start_frc = now_frc;
-    while( now_frc - start_frc < ni->state->buzz_cycles ) {
+  {
+    struct oo_per_thread* pt = oo_per_thread_get();
+    if( pt->spinstate & (1 << ONLOAD_SPIN_SOCK_LOCK) ) {
+      CITP_STATS_NETIF(++ni->state->stats.sock_lock_buzz);
       ci_frc64(&now_frc);
-      if( ci_sock_trylock(ni, w) )
-        return 0;
-      ci_spinloop_pause();
+      start_frc = now_frc;
+      oo_spin_topology_enter(pt, now_frc, IPTIMER_STATE(ni)->khz);
+      while( now_frc - start_frc < ni->state->buzz_cycles ) {
+        ci_frc64(&now_frc);
+        if( ci_sock_trylock(ni, w) )
+          return 0;
+        if( oo_spin_topology_yield(pt) )
+          CITP_STATS_NETIF(++ni->state->stats.spin_topology_yield);
+        else
+          ci_spinloop_pause();
+      }
     }
   }
 #endif
@@ -299,19 +385,26 @@ void ci_sock_unlock_slow(ci_netif* ni, citp_waitable* w)
 static int ci_netif_pkt_wait_spin(ci_netif* ni, ci_sock_cmn* s,
                                   int* lock_flags, int* done)
 {
-  ci_uint64 start_frc, now_frc;
+  ci_uint64 start_frc, now_frc, acct_frc;
   int rc = 1;
 
   ci_frc64(&start_frc);
   now_frc = start_frc;
+  acct_frc = start_frc;
   ni->state->is_spinner = 1;
   CITP_STATS_NETIF(++ni->state->stats.pkt_wait_spin);
 
   do {
-    if( ci_netif_may_poll(ni) && ci_netif_need_poll_spinning(ni, now_frc) &&
-        ((*lock_flags & CI_SLEEP_NETIF_LOCKED) || ci_netif_trylock(ni)) ) {
-      *lock_flags |= CI_SLEEP_NETIF_LOCKED;
-      ci_netif_poll(ni);
+    int n_evs = 0;
+    int lock_missed = 0;
+    if( ci_netif_may_poll(ni) && ci_netif_need_poll_spinning(ni, now_frc) ) {
+      if( (*lock_flags & CI_SLEEP_NETIF_LOCKED) ||
+          (ci_netif_poll_uncontended(ni) && ci_netif_trylock(ni)) ) {
+        *lock_flags |= CI_SLEEP_NETIF_LOCKED;
+        n_evs = ci_netif_poll(ni);
+      }
+      else
+        lock_missed = 1;
     }
     if( ci_netif_pkt_tx_can_alloc_now(ni) ) {
       rc = 0;
@@ -329,6 +422,7 @@ static int ci_netif_pkt_wait_spin(ci_netif* ni, ci_sock_cmn* s,
       *lock_flags &=~ CI_SLEEP_NETIF_LOCKED;
     }
     ci_frc64(&now_frc);
+    OO_SPIN_ACCOUNT(ni, &acct_frc, now_frc, n_evs, lock_missed);
     ci_spinloop_pause();
     /* NB: we do not handle signals here, since memory allocation is
      * considered non-interruptible. */
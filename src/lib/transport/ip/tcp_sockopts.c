@@ -141,7 +141,7 @@ ci_tcp_info_get(ci_netif* netif, ci_sock_cmn* s, struct ci_tcp_info* uinfo,
     if( ts->tcpflags & CI_TCPT_FLAG_TSO )
       info.tcpi_advmss -= 12;
 
-    if ( NI_OPTS(netif).tcp_rcvbuf_mode == 1 ) {
+    if ( NI_OPTS(netif).tcp_rcvbuf_mode != 0 ) {
       info.tcpi_rcv_rtt = info.tcpi_rtt; /* we currently use same measure */
       info.tcpi_rcv_space = ts->rcvbuf_drs.bytes;
     }
@@ -231,6 +231,20 @@ int ci_get_sol_tcp(ci_netif* netif, ci_sock_cmn* s, int optname, void *optval,
       }
       goto u_out;
     }
+#ifdef TCP_CONGESTION
+  case TCP_CONGESTION:
+    {
+      /* name of the congestion control algorithm in use */
+      const char* name = ci_tcp_cc_tbl[c->tcp_cc].name;
+      socklen_t len = CI_MIN(*optlen, (socklen_t) (strlen(name) + 1));
+      if( len > 0 ) {
+        memcpy(optval, name, len);
+        ((char*) optval)[len - 1] = '\0';
+      }
+      *optlen = len;
+      return 0;
+    }
+#endif
   case TCP_QUICKACK:
     {
       u = 0;
@@ -395,6 +409,40 @@ static int ci_tcp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, int level,
     return ci_set_sol_ip6(netif, s, optname, optval, optlen);
   }
   else if( level == IPPROTO_TCP ) {
+#ifdef TCP_CONGESTION
+    if( optname == TCP_CONGESTION ) {
+      /* Select the congestion control algorithm; takes a name string. */
+      char name[16];
+      socklen_t len;
+      int i;
+      if( optval == NULL || optlen == 0 ) {
+        rc = -EINVAL;
+        goto fail_inval;
+      }
+      len = CI_MIN(optlen, (socklen_t) (sizeof(name) - 1));
+      memcpy(name, optval, len);
+      name[len] = '\0';
+      for( i = 0; i < CI_TCP_CC_N; ++i )
+        if( strcmp(name, ci_tcp_cc_tbl[i].name) == 0 ||
+            (i == CI_TCP_CC_NEWRENO && strcmp(name, "reno") == 0) )
+          break;
+      if( i == CI_TCP_CC_N )
+        RET_WITH_ERRNO(ENOENT);
+      /* The preference lives in the common state so that it survives the
+       * CLOSED <-> LISTEN transforms and is inherited by accepted sockets;
+       * connected sockets switch algorithm immediately. */
+      c->tcp_cc = i;
+      if( s->b.state != CI_TCP_LISTEN ) {
+        ci_tcp_state* ts = SOCK_TO_TCP(s);
+        if( ts->cc_algo != i ) {
+          ts->cc_algo = i;
+          if( ci_tcp_cc(ts)->init != NULL )
+            ci_tcp_cc(ts)->init(netif, ts);
+        }
+      }
+      return 0;
+    }
+#endif
     /* These are ints values */
     if( (rc = opt_not_ok(optval, optlen, int)) )
       goto fail_inval;
@@ -532,6 +580,30 @@ static int ci_tcp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, int level,
       }
       break;
 #endif
+    case ONLOAD_TCP_RX_STEER:
+      if( *(int*) optval == 0 ) {
+        ci_bit_clear(&s->s_aflags, CI_SOCK_AFLAG_RX_STEER_BIT);
+        break;
+      }
+      ci_bit_set(&s->s_aflags, CI_SOCK_AFLAG_RX_STEER_BIT);
+      /* An established connection relying on the stack's scalable filter
+       * gets its exact-match filter installed right away; sockets not yet
+       * connected pick the filter type up at connect time. */
+      if( (s->b.state & CI_TCP_STATE_TCP_CONN) &&
+          (s->s_flags & (CI_SOCK_FLAG_SCALACTIVE |
+                         CI_SOCK_FLAG_SCALPASSIVE)) ) {
+        ci_uint32 prev_flags = s->s_flags;
+        s->s_flags &= ~(CI_SOCK_FLAG_SCALACTIVE | CI_SOCK_FLAG_SCALPASSIVE);
+        rc = ci_tcp_ep_set_filters(netif, SC_SP(s), s->cp.so_bindtodevice,
+                                   OO_SP_NULL);
+        if( rc < 0 ) {
+          s->s_flags = prev_flags;
+          ci_bit_clear(&s->s_aflags, CI_SOCK_AFLAG_RX_STEER_BIT);
+          goto fail_inval;
+        }
+      }
+      break;
+
     default:
       LOG_TC(log("%s: "NSS_FMT" option %i unimplemented (ENOPROTOOPT)", 
              __FUNCTION__, NSS_PRI_ARGS(netif,s), optname));
@@ -302,6 +302,10 @@ ci_tcp_listenq_bucket_lookup(ci_netif* ni, ci_tcp_listen_bucket* bucket,
 
   tsr = &aux->u.synrecv;
   do {
+    /* Start fetching the next entry's aux buffer while this one is
+     * compared. */
+    if( OO_P_NOT_NULL(tsr->bucket_link) )
+      ci_prefetch(ci_ni_aux_p2aux(ni, tsr->bucket_link));
     if( sport == tsr->r_port &&
         dport == tsr->l_port &&
         CI_IPX_ADDR_EQ(saddr, tsr->r_addr) &&
@@ -477,6 +481,21 @@ ci_tcp_listenq_lookup(ci_netif* netif, ci_tcp_socket_listen* tls,
 }
 
 
+/* Start fetching the syn-recv state this segment will be matched against,
+ * so that ci_tcp_listenq_lookup() does not stall on a cold aux buffer.
+ * Called early in listen processing, before the control-plane work that
+ * precedes the lookup. */
+void ci_tcp_listenq_prefetch(ci_netif* ni, ci_tcp_socket_listen* tls,
+                             ciip_tcp_rx_pkt* rxp)
+{
+  ci_tcp_listen_bucket* bucket = ci_ni_aux_p2bucket(ni, tls->bucket);
+  int idx = ci_tcp_listenq_hash2idx(rxp->hash, 0);
+
+  if( OO_P_NOT_NULL(bucket->bucket[idx]) )
+    ci_prefetch(ci_ni_aux_p2aux(ni, bucket->bucket[idx]));
+}
+
+
 void ci_tcp_listenq_drop_oldest(ci_netif* ni, ci_tcp_socket_listen* tls)
 {
   ci_tcp_state_synrecv* tsr;
@@ -527,10 +546,33 @@ get_ts_from_cache(ci_netif *netif,
   }
 
   if( ! oo_p_dllink_is_empty(netif, cache_list) ) {
-    /* Take the entry from the cache */
-    struct oo_p_dllink_state link = oo_p_dllink_statep(netif,
-                                                       cache_list.l->next);
-    ts = CI_CONTAINER (ci_tcp_state, epcache_link, link.l);
+    struct oo_p_dllink_state link;
+
+    /* Prefer an EP whose previous connection was from this same peer: a
+     * reconnecting peer then gets back the endpoint it used last time,
+     * with all of its state and buffers still warm.  The cached EP's
+     * addresses are preserved until ci_tcp_state_init() below, so they
+     * can be compared here.  The walk is bounded by
+     * EF_PER_SOCKET_CACHE_MAX.
+     */
+    ts = NULL;
+    oo_p_dllink_for_each(netif, link, cache_list) {
+      ci_tcp_state* cached = CI_CONTAINER(ci_tcp_state, epcache_link, link.l);
+      if( CI_IPX_ADDR_EQ(tcp_ipx_raddr(cached), tsr->r_addr) &&
+          sock_rport_be16(&cached->s) == tsr->r_port &&
+          CI_IPX_ADDR_EQ(cached->s.laddr, tsr->l_addr) &&
+          sock_lport_be16(&cached->s) == tsr->l_port ) {
+        ts = cached;
+        CITP_STATS_NETIF(++netif->state->stats.sockcache_hit_samepeer);
+        break;
+      }
+    }
+
+    if( ts == NULL ) {
+      /* No affinity match: take the entry at the head of the cache. */
+      link = oo_p_dllink_statep(netif, cache_list.l->next);
+      ts = CI_CONTAINER (ci_tcp_state, epcache_link, link.l);
+    }
     ci_assert (ts);
     oo_p_dllink_del_init(netif, link);
 
@@ -648,6 +690,11 @@ static void ci_tcp_inherit_options(ci_netif* ni, ci_sock_cmn* s,
   ts->c.t_ka_intvl         = c->t_ka_intvl;
   ts->c.t_ka_intvl_in_secs = c->t_ka_intvl_in_secs;
   ts->c.ka_probe_th        = c->ka_probe_th;
+  /* TCP_CONGESTION */
+  if( ts->c.tcp_cc != c->tcp_cc ) {
+    ts->c.tcp_cc = c->tcp_cc;
+    ci_tcp_cc_init(ni, ts);
+  }
   {
     int af = ipcache_af(&ts->s.pkt);
     ci_ipx_hdr_init_fixed(&ts->s.pkt.ipx, af, IPPROTO_TCP,
@@ -737,7 +784,11 @@ int ci_tcp_listenq_try_promote(ci_netif* netif, ci_tcp_socket_listen* tls,
     return -ENOMEM;
   }
   else
-  if( (int) ci_tcp_acceptq_n(tls) < tls->acceptq_max ) {
+  /* Sockets already promoted in this poll but not yet published count
+   * against the backlog limit too. */
+  if( (int) (ci_tcp_acceptq_n(tls) +
+             (netif->state->promote_batch_listener == S_SP(tls) ?
+              netif->state->promote_batch_n : 0)) < tls->acceptq_max ) {
     ci_tcp_state* ts;
     int scalable = (tls->s.s_flags & CI_SOCK_FLAG_SCALPASSIVE) != 0;
 #if CI_CFG_FD_CACHING
@@ -988,7 +1039,30 @@ int ci_tcp_listenq_try_promote(ci_netif* netif, ci_tcp_socket_listen* tls,
 #endif
 
     ci_bit_set(&ts->s.b.sb_aflags, CI_SB_AFLAG_TCP_IN_ACCEPTQ_BIT);
-    ci_tcp_acceptq_put(netif, tls, &ts->s.b);
+    if( netif->state->in_poll ) {
+      /* Defer publication: sockets promoted during this poll are chained
+       * up and spliced onto the acceptq in a single shared-state update
+       * (with a single listener wake) when post-poll processing runs.
+       * The chain only ever holds sockets for one listener, so flush it
+       * if a different listener starts promoting. */
+      ci_netif_state* ns = netif->state;
+      if( OO_SP_NOT_NULL(ns->promote_batch_listener) &&
+          ns->promote_batch_listener != S_SP(tls) )
+        ci_tcp_acceptq_flush_batch(netif);
+      ci_assert(OO_SP_IS_NULL(ts->s.b.wt_next));
+      ts->s.b.wt_next = ns->promote_batch_head;
+      ns->promote_batch_head = S_SP(ts);
+      if( OO_SP_IS_NULL(ns->promote_batch_tail) ) {
+        ns->promote_batch_tail = S_SP(ts);
+        ns->promote_batch_listener = S_SP(tls);
+      }
+      ++ns->promote_batch_n;
+    }
+    else {
+      ci_tcp_acceptq_put(netif, tls, &ts->s.b);
+      citp_waitable_wake_possibly_not_in_poll(netif, &tls->s.b,
+                                              CI_SB_FLAG_WAKE_RX);
+    }
 
     LOG_TC(log(LNT_FMT "new ts=%d SYN-RECV->ESTABLISHED flags=0x%x",
                LNT_PRI_ARGS(netif, tls), S_FMT(ts), ts->tcpflags);
@@ -997,7 +1071,6 @@ int ci_tcp_listenq_try_promote(ci_netif* netif, ci_tcp_socket_listen* tls,
                tcp_snd_una(ts),
                tcp_snd_nxt(ts), ts->snd_max, tcp_enq_nxt(ts)));
 
-    citp_waitable_wake(netif, &tls->s.b, CI_SB_FLAG_WAKE_RX);
     *ts_out = ts;
     return 0;
   }
@@ -1009,5 +1082,46 @@ int ci_tcp_listenq_try_promote(ci_netif* netif, ci_tcp_socket_listen* tls,
   return -ENOSPC;
 }
 
+
+/* Publish the poll's batch of promoted sockets to the owning listener's
+** accept queue.  The batch is chained via wt_next in the same LIFO order
+** as the acceptq put list, so one splice preserves overall FIFO order at
+** swizzle time.  Called with the stack lock held, before the post-poll
+** wakeups are processed.
+*/
+void ci_tcp_acceptq_flush_batch(ci_netif* ni)
+{
+  ci_netif_state* ns = ni->state;
+  ci_tcp_socket_listen* tls;
+  citp_waitable* tail;
+  ci_int32 put;
+
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert(OO_SP_NOT_NULL(ns->promote_batch_listener));
+  ci_assert(OO_SP_NOT_NULL(ns->promote_batch_head));
+  ci_assert_gt(ns->promote_batch_n, 0);
+
+  tls = SP_TO_TCP_LISTEN(ni, ns->promote_batch_listener);
+  ci_assert_equal(tls->s.b.state, CI_TCP_LISTEN);
+  tail = SP_TO_WAITABLE(ni, ns->promote_batch_tail);
+
+  do {
+    put = tls->acceptq_put;
+    tail->wt_next = OO_SP_FROM_INT(ni, put);
+  } while( ci_cas32_fail(&tls->acceptq_put, put,
+                         OO_SP_TO_INT(ns->promote_batch_head)) );
+  tls->acceptq_n_in += ns->promote_batch_n;
+
+  CITP_STATS_NETIF_ADD(ni, acceptq_batch_socks, ns->promote_batch_n);
+  CITP_STATS_NETIF_INC(ni, acceptq_batch_flush);
+
+  ns->promote_batch_listener = OO_SP_NULL;
+  ns->promote_batch_head = OO_SP_NULL;
+  ns->promote_batch_tail = OO_SP_NULL;
+  ns->promote_batch_n = 0;
+
+  citp_waitable_wake_possibly_not_in_poll(ni, &tls->s.b, CI_SB_FLAG_WAKE_RX);
+}
+
 #endif
 /*! \cidoxg_end */
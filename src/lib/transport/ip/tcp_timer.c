@@ -256,6 +256,11 @@ void ci_tcp_timeout_listen(ci_netif* netif, ci_tcp_socket_listen* tls)
     NI_LOG(netif, CONN_DROP, "%s: [%d] %d half-open timeouts\n", __func__,
            NI_ID(netif), synrecv_timeout);
 
+  /* Top up the pool of pre-initialised TCP states here, off the accept
+   * path, so promotions during a connection storm find one ready. */
+  if( NI_OPTS(netif).tcp_state_pool != 0 )
+    ci_tcp_state_pool_refill(netif);
+
   /* if still any pending connectings */
   if(  out_of_packets || next_timeout != ci_tcp_time_now(netif) ) {
     /* If out-of-packets, we should return here soon to send the synacks
@@ -402,6 +407,33 @@ void ci_tcp_timeout_delack(ci_netif* netif, ci_tcp_state* ts)
 }
 
 
+/* Fire any expired deadlines in the fast-ack array (EF_TCP_FAST_ACK).
+ * Called inline from the poll loop, so designated sockets pay no wheel
+ * timer insert/cancel per received segment. */
+void ci_tcp_fast_ack_check(ci_netif* netif)
+{
+  ci_netif_state* ns = netif->state;
+  ci_iptime_t now = ci_tcp_time_now(netif);
+  ci_uint32 i = 0;
+
+  while( i < ns->fast_ack_n ) {
+    ci_tcp_state* ts;
+    if( TIME_LT(now, ns->fast_ack_deadline[i]) ) {
+      ++i;
+      continue;
+    }
+    ts = SP_TO_TCP(netif, ns->fast_ack_sock[i]);
+    --ns->fast_ack_n;
+    ns->fast_ack_sock[i] = ns->fast_ack_sock[ns->fast_ack_n];
+    ns->fast_ack_deadline[i] = ns->fast_ack_deadline[ns->fast_ack_n];
+    ci_assert(ts->tcpflags & CI_TCPT_FLAG_FAST_ACK_ARMED);
+    ts->tcpflags &=~ CI_TCPT_FLAG_FAST_ACK_ARMED;
+    if( (ts->acks_pending & CI_TCP_ACKS_PENDING_MASK) > 0 )
+      ci_tcp_timeout_delack(netif, ts);
+  }
+}
+
+
 static void ci_tcp_drop_due_to_rto(ci_netif *ni, ci_tcp_state *ts,
                                    int max_retrans)
 {
@@ -416,8 +448,40 @@ static void ci_tcp_drop_due_to_rto(ci_netif *ni, ci_tcp_state *ts,
 }
 
 
+/* Fire any expired flush deadlines in the auto-cork array
+ * (EF_TCP_CORK_NS).  Called inline from the poll loop, so held segments
+ * go out within the configured bound without any wheel timer
+ * involvement. */
+void ci_tcp_cork_deadline_check(ci_netif* netif)
+{
+  ci_netif_state* ns = netif->state;
+  ci_uint64 now_frc;
+  ci_uint32 i = 0;
+
+  ci_frc64(&now_frc);
+  while( i < ns->cork_n ) {
+    ci_tcp_state* ts;
+    if( now_frc < ns->cork_deadline_frc[i] ) {
+      ++i;
+      continue;
+    }
+    ts = SP_TO_TCP(netif, ns->cork_sock[i]);
+    --ns->cork_n;
+    ns->cork_sock[i] = ns->cork_sock[ns->cork_n];
+    ns->cork_deadline_frc[i] = ns->cork_deadline_frc[ns->cork_n];
+    ci_assert(ts->tcpflags & CI_TCPT_FLAG_CORK_DEADLINE);
+    ts->tcpflags &=~ CI_TCPT_FLAG_CORK_DEADLINE;
+    ci_tcp_send_corked_packets(netif, ts);
+  }
+}
+
+
 void ci_tcp_send_corked_packets(ci_netif* netif, ci_tcp_state* ts)
 {
+  /* Any pending auto-cork deadline is satisfied by this flush. */
+  if( ts->tcpflags & CI_TCPT_FLAG_CORK_DEADLINE )
+    ci_tcp_cork_deadline_unarm(netif, ts);
+
   /* Remove CI_PKT_FLAG_TX_MORE flag flag to ensure that we no more defer
    * sending unnecessarily.  Set PSH flag in the last packet.
    *
@@ -445,6 +509,20 @@ void ci_tcp_timeout_cork(ci_netif* netif, ci_tcp_state* ts)
 }
 
 
+#if CI_CFG_TCP_RACK
+/* Called when the RACK reordering window for the first un-SACKed segment
+ * expires.  Re-runs detection: the segment may have been delivered (or
+ * recovery entered by other means) since the timer was armed, in which
+ * case this does nothing. */
+void ci_tcp_timeout_rack(ci_netif* netif, ci_tcp_state* ts)
+{
+  if( ci_tcp_retransq_is_empty(ts) )
+    return;
+  ci_tcp_rack_detect_loss(netif, ts);
+}
+#endif
+
+
 /* Called as action on a retransmission timer timeout (RTO) */
 void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
 {
@@ -564,7 +642,7 @@ void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
       ts->ssthresh = CI_MAX(x, y);
     }
     else
-      ts->ssthresh = ci_tcp_losswnd(ts);
+      ts->ssthresh = ci_tcp_cc(ts)->losswnd(netif, ts);
 
     ts->congstate = CI_TCP_CONG_RTO;
     ts->cwnd_extra = 0;
@@ -580,8 +658,10 @@ void ci_tcp_timeout_rto(ci_netif* netif, ci_tcp_state* ts)
 
   /* Backoff RTO timer and restart. */
   ts->rto <<= 1u;
-  ts->rto = CI_MIN(ts->rto, NI_CONF(netif).tconst_rto_max);    
+  ts->rto = CI_MIN(ts->rto, NI_CONF(netif).tconst_rto_max);
   ci_tcp_rto_set(netif, ts);
+  ci_tcp_telem_record(ts, OO_TCP_TELEM_RTO, ts->rto);
+  ci_tcp_telem_record(ts, OO_TCP_TELEM_CWND, ts->cwnd);
   ci_assert(!(ts->tcpflags & CI_TCPT_FLAG_TAIL_DROP_TIMING));
 
   /* Delete all SACK marks (RFC2018 p6).  The reason is that the receiver
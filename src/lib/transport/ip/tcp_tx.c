@@ -228,8 +228,20 @@ static void ci_ip_send_tcp_list_loopback(ci_netif* ni, ci_tcp_state* ts,
      * Loopback in-packet ACK value is ignored - deliver it now! */
     if( SEQ_LE(ts->ack_trigger, ts->rcv_delivered) )
       ci_tcp_send_ack_loopback(ni, ts);
-    if( !ni->state->in_poll )
-      ci_netif_poll(ni);
+    if( !ni->state->in_poll ) {
+      int intf_i, hw_evs = 0;
+      OO_STACK_FOR_EACH_INTF_I(ni, intf_i)
+        if( ci_netif_intf_has_event(ni, intf_i) ) {
+          hw_evs = 1;
+          break;
+        }
+      /* No hardware events outstanding: deliver straight to the peer
+       * rather than paying for a full event queue poll. */
+      if( hw_evs )
+        ci_netif_poll(ni);
+      else
+        ci_netif_loopback_deliver(ni);
+    }
   }
 }
 
@@ -956,7 +968,7 @@ int ci_tcp_retrans_one(ci_tcp_state* ts, ci_netif* netif, ci_ip_pkt_fmt* pkt)
                     oo_tx_l3_len(pkt));
 
   /* place TCP options, ECN, and take RTT on outgoing packet */
-  ci_tcp_tx_finish(netif, ts, pkt);
+  ci_tcp_tx_finish(netif, ts, pkt, ci_tcp_time_now(netif));
 
   /* set the urgent pointer */
   ci_tcp_tx_set_urg_ptr(ts, netif, tcp);
@@ -1065,6 +1077,8 @@ int ci_tcp_retrans(ci_netif* ni, ci_tcp_state* ts, int seq_limit,
   /* Mustn't call this when there's nothing to send. */
   ci_assert(OO_PP_NOT_NULL(ts->retrans_ptr));
 
+  ci_tcp_telem_record(ts, OO_TCP_TELEM_RETRANS, tcp_snd_una(ts));
+
   *seq_used = 0;
   pkt = PKT_CHK(ni, ts->retrans_ptr);
   LOG_TV(log(LPF "rtq: %d -> %d ->...-> %d, %d packets", OO_PKT_FMT(pkt),
@@ -1258,6 +1272,30 @@ static int ci_tcp_tx_handle_cork(ci_netif* ni, ci_tcp_state* ts,
     TX_PKT_IPX_TCP(ipcache_af(&ts->s.pkt), pkt)->tcp_flags |= CI_TCP_FLAG_PSH;
     return 0;
   }
+  else if( ni->state->tcp_cork_cycles != 0 ) {
+    /* EF_TCP_CORK_NS auto-corking: push the frame once the segment is
+     * full, else hold it and let the poll loop's deadline check flush it
+     * within the configured bound.
+     */
+    ci_uint64 now_frc;
+    if( PKT_TCP_TX_SEQ_SPACE(pkt) >= tcp_eff_mss(ts) ) {
+      TX_PKT_IPX_TCP(ipcache_af(&ts->s.pkt), pkt)->tcp_flags |=
+                                                            CI_TCP_FLAG_PSH;
+      return 0;
+    }
+    ci_frc64(&now_frc);
+    if( ci_tcp_cork_deadline_arm(ni, ts,
+                                 now_frc + ni->state->tcp_cork_cycles) )
+      return 1;
+    /* Cork array is full: fall back to the wheel timer below. */
+    if( ! ci_tcp_inflight(ts) ) {
+      ci_iptime_t timeout;
+      timeout = ci_tcp_time_now(ni) + (NI_CONF(ni).tconst_delack << 1);
+      ci_ip_timer_clear(ni, &ts->cork_tid);
+      ci_ip_timer_set(ni, &ts->cork_tid, timeout);
+    }
+    return 1;
+  }
   else {
     /* Don't send yet, but ensure packet will be sent eventually.  If there
      * are packets in-flight, rely on the ACK, else set the CORK timer.
@@ -1360,6 +1398,11 @@ void ci_tcp_tx_advance_to(ci_netif* ni, ci_tcp_state* ts,
   oo_pkt_p id = sendq->head;
   int sent_num = 0;
   int af = ipcache_af(&ts->s.pkt);
+  int rcv_wnd_calculated = 0;
+  /* One header template serves the whole burst: the receive window and the
+   * timestamp option value cannot change while we hold the lock and only
+   * transmit, so compute them once rather than per segment. */
+  ci_uint32 tsval_now = ci_tcp_time_now(ni);
 
   while( 1 ) {
     ci_ip_pkt_fmt* pkt = PKT_CHK(ni, id);
@@ -1404,17 +1447,20 @@ void ci_tcp_tx_advance_to(ci_netif* ni, ci_tcp_state* ts,
     }
 #endif
 
-    /* Update window (with silly window avoidance).  FIXME: No need to do
-     * this each time around the loop.
+    /* Update window (with silly window avoidance).  Its inputs are fixed
+     * for the duration of the loop, so calculate it once per burst.
      *
      * We don't want to do this when sending a syn, as we don't scale that
      * window so must calculate it differently.
      */
-    if( CI_LIKELY(!(tcp->tcp_flags & CI_TCP_FLAG_SYN)) )
+    if( CI_LIKELY(!(tcp->tcp_flags & CI_TCP_FLAG_SYN)) &&
+        ! rcv_wnd_calculated ) {
       ci_tcp_calc_rcv_wnd(ts, "tx_advance");
+      rcv_wnd_calculated = 1;
+    }
 
     /* place TCP options into outgoing packet */
-    ci_tcp_tx_finish(ni, ts, pkt);
+    ci_tcp_tx_finish(ni, ts, pkt, tsval_now);
 
     /* Finish-off the IP header.  We increment the ID field for payload
      * segments because some old versions of Linux GRO require incrementing
@@ -1554,6 +1600,82 @@ void ci_tcp_tx_advance_to(ci_netif* ni, ci_tcp_state* ts,
 }
 
 
+/* Transmit a single freshly-filled packet straight from ci_tcp_sendmsg(),
+ * bypassing the send queue.  The caller holds the lock, has prepped the
+ * packet with its final sequence numbers, and has established that the send
+ * queue is empty and that the whole segment fits both the receive and
+ * congestion windows.  This is the per-packet tail of
+ * ci_tcp_tx_advance_to() without the queue walk: the packet goes to the
+ * wire and straight onto the retransmit queue, so the sendq head/tail/num
+ * fields in shared state are never touched.
+ */
+void ci_tcp_tx_send_direct(ci_netif* ni, ci_tcp_state* ts, ci_ip_pkt_fmt* pkt)
+{
+  int af = ipcache_af(&ts->s.pkt);
+  ci_tcp_hdr* tcp = TX_PKT_IPX_TCP(af, pkt);
+
+  ci_assert(ci_netif_is_locked(ni));
+  ci_assert(ci_ip_queue_is_empty(&ts->send));
+  ci_assert(! (tcp->tcp_flags & CI_TCP_FLAG_SYN));
+  ci_assert(SEQ_LE(pkt->pf.tcp_tx.end_seq, ts->snd_max));
+  ci_assert(! (ts->s.pkt.flags & CI_IP_CACHE_IS_LOCALROUTE));
+  ci_assert(! (pkt->flags & CI_PKT_FLAG_TX_PENDING));
+  ci_assert_equal(tcp_enq_nxt(ts), pkt->pf.tcp_tx.end_seq);
+
+  ci_tcp_tx_cwv_idle(ni, ts);
+
+  ci_tcp_calc_rcv_wnd(ts, "send_direct");
+
+  ci_tcp_tx_finish(ni, ts, pkt, ci_tcp_time_now(ni));
+  ci_tcp_ipx_hdr_init(af, oo_tx_ipx_hdr(af, pkt), oo_tx_l3_len(pkt));
+  ci_tcp_tx_set_urg_ptr(ts, ni, tcp);
+  tcp->tcp_ack_be32 = CI_BSWAP_BE32(tcp_rcv_nxt(ts));
+  tcp->tcp_window_be16 = TS_IPX_TCP(ts)->tcp_window_be16;
+  ci_tcp_tx_maybe_do_striping(pkt, ts);
+
+  tcp_snd_nxt(ts) = pkt->pf.tcp_tx.end_seq;
+  CI_TCP_STATS_INC_OUT_SEGS(ni);
+  CI_IP_SOCK_STATS_ADD_TXBYTE(ts, TX_PKT_LEN(pkt));
+
+  pkt->next = OO_PP_NULL;
+  ci_ip_send_tcp_list(ni, ts, OO_PKT_P(pkt), pkt);
+
+  ci_ip_queue_enqueue(ni, &ts->retrans, pkt);
+  ++ts->send_in;
+  ++ts->send_out;
+
+  /* Wake up TX if necessary */
+  if( NI_OPTS(ni).tcp_sndbuf_mode == 0 &&
+      ci_tcp_tx_advertise_space(ni, ts) )
+    ci_tcp_wake_possibly_not_in_poll(ni, ts, CI_SB_FLAG_WAKE_TX);
+
+#if CI_CFG_CONGESTION_WINDOW_VALIDATION
+  ts->t_last_sent = ci_tcp_time_now(ni);
+#endif
+
+  ci_tcp_kalive_check_and_clear(ni, ts);
+  ci_tcp_delack_clear(ni, ts);
+  ts->acks_pending = 0;
+
+  /* Start the RTO/TLP timer (if not already running). */
+  if( ! ci_ip_timer_pending(ni, &(ts->rto_tid)) ) {
+    ci_iptime_t timeout;
+    if( ci_tcp_taildrop_probe_enabled(ni, ts) ) {
+      timeout = ci_tcp_taildrop_timeout(ni, ts);
+      ts->tcpflags |= CI_TCPT_FLAG_TAIL_DROP_TIMING;
+    }
+    else {
+      timeout = ts->rto;
+      ts->tcpflags &=~ CI_TCPT_FLAG_TAIL_DROP_TIMING;
+    }
+    ci_tcp_rto_set_with_timeout(ni, ts, timeout);
+  }
+
+  /* congestion window validation rfc2861 */
+  ci_tcp_tx_cwv_app_lmtd(ni, ts);
+}
+
+
 
 /* Most callers should use ci_tcp_send_rst(), to send a RST-ACK.  This function
  * allows customisation of the flags for the exceptional cases. */
@@ -1887,6 +2009,8 @@ void ci_tcp_send_zwin_probe(ci_netif* netif, ci_tcp_state* ts)
 
   ci_ip_send_tcp(netif, pkt, ts);
 
+  ci_tcp_telem_record(ts, OO_TCP_TELEM_ZWIN, ts->zwin_probes);
+
   CI_IP_SOCK_STATS_ADD_TXBYTE(ts,  pkt->buf_len);
 
   ci_netif_pkt_release(netif, pkt);
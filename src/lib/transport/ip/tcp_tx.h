@@ -24,22 +24,31 @@ ci_inline int ci_tcp_tx_opt_tso(ci_uint8** opt,
 ** could be a place to deal with ECN.
 ** We could not deal with outgoing SACK here, because it will change packet
 ** length.
+**
+** [tsval_now] is the timestamp option value; callers finishing a burst of
+** segments read the clock once and use it for the whole burst.
 */
 ci_inline void ci_tcp_tx_finish(ci_netif* netif, ci_tcp_state* ts,
-                                ci_ip_pkt_fmt* pkt)
+                                ci_ip_pkt_fmt* pkt, ci_uint32 tsval_now)
 {
   ci_tcp_hdr* tcp = TX_PKT_IPX_TCP(ipcache_af(&ts->s.pkt), pkt);
   ci_uint8* opt = CI_TCP_HDR_OPTS(tcp);
   int seq = pkt->pf.tcp_tx.start_seq;
 
+#if CI_CFG_TCP_RACK
+  /* All callers pass the current tick in [tsval_now], so it serves as the
+   * per-segment transmit timestamp for RACK.  Retransmits come through
+   * here too, keeping this the time of the most recent transmission. */
+  pkt->pf.tcp_tx.tx_time = tsval_now;
+#endif
+
   /* Decrement the faststart counter by the number of bytes acked */
   ci_tcp_reduce_faststart(ts, SEQ_SUB(tcp_rcv_nxt(ts),ts->tslastack));
 
   /* put in the TSO & SACK options if needed */
   ts->tslastack = tcp_rcv_nxt(ts); /* also used for faststart */
   if( ts->tcpflags & CI_TCPT_FLAG_TSO ) {
-    unsigned now =  ci_tcp_time_now(netif);
-    ci_tcp_tx_opt_tso(&opt, now, ts->tsrecent);
+    ci_tcp_tx_opt_tso(&opt, tsval_now, ts->tsrecent);
   } else {
     /* do snarf for RTT timing if not using timestamps */
     if( CI_LIKELY((ts->congstate == CI_TCP_CONG_OPEN) |
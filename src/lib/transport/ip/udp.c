@@ -84,10 +84,24 @@ static void ci_udp_state_init(ci_netif* netif, ci_udp_state* us)
 #if CI_CFG_ZC_RECV_FILTER
   us->recv_q_filter = 0;
   us->recv_q_filter_arg = 0;
+  us->recv_q_filter_n_rules = 0;
+  us->recv_q_filter_flags = 0;
 #endif
   ci_udp_recv_q_init(&us->recv_q);
+  {
+    int i;
+    for( i = 0; i < CI_UDP_RX_MAILBOXES_MAX - 1; ++i )
+      ci_udp_recv_q_init(&us->mailbox_q[i]);
+  }
+  us->mailbox_busy = 0;
+  us->n_mailboxes = 0;
+  us->mailbox_rr = 0;
   us->zc_kernel_datagram = OO_PP_NULL;
   us->zc_kernel_datagram_count = 0;
+  us->zc_key = 0;
+  us->zc_comp_lo = 0;
+  us->zc_comp_hi = 0;
+  us->zc_comp_pending = 0;
   us->tx_async_q = CI_ILL_END;
   oo_atomic_set(&us->tx_async_q_level, 0);
   us->tx_count = 0;
@@ -243,7 +257,8 @@ void ci_udp_state_dump(ci_netif* ni, ci_udp_state* us, const char* pf,
   ci_udp_socket_stats uss = us->stats;
   unsigned rx_added = us->recv_q.pkts_added;
   unsigned rx_os = uss.n_rx_os + uss.n_rx_os_slow;
-  unsigned rx_total = rx_added + uss.n_rx_mem_drop + uss.n_rx_overflow + rx_os;
+  unsigned rx_total = rx_added + uss.n_rx_mem_drop + uss.n_rx_overflow +
+                      uss.n_rx_filter_drop + rx_os;
   unsigned n_tx_onload = uss.n_tx_onload_uc + uss.n_tx_onload_c;
   unsigned tx_total = n_tx_onload + uss.n_tx_os;
   ci_ip_cached_hdrs* ipcache;
@@ -263,12 +278,18 @@ void ci_udp_state_dump(ci_netif* ni, ci_udp_state* us, const char* pf,
 
   /* Receive path. */
   ci_udp_recvq_dump(ni, &us->recv_q, pf, "  rcv:", logger, log_arg);
+  if( us->n_mailboxes ) {
+    int i;
+    for( i = 1; i < us->n_mailboxes; ++i )
+      ci_udp_recvq_dump(ni, ci_udp_rx_q(us, i), pf, "  rcv mbox:",
+                        logger, log_arg);
+  }
   logger(log_arg,
-         "%s  rcv: oflow_drop=%u(%u%%) mem_drop=%u eagain=%u pktinfo=%u "
-         "q_max_pkts=%u", pf, uss.n_rx_overflow,
+         "%s  rcv: oflow_drop=%u(%u%%) mem_drop=%u filter_drop=%u eagain=%u "
+         "pktinfo=%u compact=%u q_max_pkts=%u", pf, uss.n_rx_overflow,
          percent(uss.n_rx_overflow, rx_total),
-         uss.n_rx_mem_drop, uss.n_rx_eagain, uss.n_rx_pktinfo, 
-         uss.max_recvq_pkts);
+         uss.n_rx_mem_drop, uss.n_rx_filter_drop, uss.n_rx_eagain,
+         uss.n_rx_pktinfo, uss.n_rx_compact, uss.max_recvq_pkts);
   logger(log_arg, "%s  rcv: os=%u(%u%%) os_slow=%u os_error=%u", pf,
          rx_os, percent(rx_os, rx_total), uss.n_rx_os_slow, uss.n_rx_os_error);
 
@@ -319,6 +340,9 @@ void ci_udp_state_dump(ci_netif* ni, ci_udp_state* us, const char* pf,
          uss.n_tx_eagain, uss.n_tx_spin, uss.n_tx_block);
   logger(log_arg, "%s  snd: poll_avoids_full=%d fragments=%d confirm=%d", pf,
          uss.n_tx_poll_avoids_full, uss.n_tx_fragments, uss.n_tx_msg_confirm);
+  if( uss.n_tx_fanout | uss.n_tx_fanout_drop )
+    logger(log_arg, "%s  snd: fanout=%u fanout_drop=%u", pf,
+           uss.n_tx_fanout, uss.n_tx_fanout_drop);
   logger(log_arg,
          "%s  snd: os_slow=%d os_late=%d unconnect_late=%d nomac=%u(%u%%)", pf,
          uss.n_tx_os_slow, uss.n_tx_os_late, uss.n_tx_unconnect_late,
@@ -500,6 +500,7 @@ int ci_udp_connect_conclude(citp_socket* ep, ci_fd_t fd,
   switch( us->s.pkt.status ) {
   case retrrc_success:
   case retrrc_nomac:
+  case retrrc_pending:
     onloadable = 1;
     break;
   default:
@@ -758,8 +759,13 @@ void ci_udp_all_fds_gone(ci_netif* netif, oo_sp sock_id, int do_free)
   ci_assert_equal(ci_netif_get_valid_ep(netif, sock_id)->
                   oofilter.sf_local_port, NULL);
 #endif
-  ci_udp_recv_q_drop(netif, &us->recv_q);
+  {
+    int q;
+    for( q = 0; q < ci_udp_rx_q_count(us); ++q )
+      ci_udp_recv_q_drop(netif, ci_udp_rx_q(us, q));
+  }
   oo_p_dllink_del(netif, oo_p_dllink_sb(netif, &us->s.b, &us->s.reap_link));
+  ci_sock_mem_watermark_unregister(netif, &us->s);
 
   if( OO_PP_NOT_NULL(us->zc_kernel_datagram) ) {
     ci_ip_pkt_fmt* pkt = PKT_CHK(netif, us->zc_kernel_datagram);
@@ -43,7 +43,11 @@ ci_inline int ci_udp_rx_deliver_to_future(ci_sock_cmn* s, void* opaque_arg)
   struct ci_udp_rx_future* future = opaque_arg;
   ci_udp_state* us = SOCK_TO_UDP(s);
 
+  /* The future path delivers straight to recv_q, so bail out to the
+   * ordinary delivery path when RX mailbox demux or a receive filter
+   * chain is enabled. */
   if( ci_udp_recv_q_pkts(&us->recv_q) >= us->stats.max_recvq_pkts ||
+      us->n_mailboxes != 0 || us->recv_q_filter_n_rules != 0 ||
       future->socket != NULL ) {
     future->socket = NULL;
     return 1;
@@ -134,4 +138,82 @@ ci_inline void ci_udp_handle_rx_post_future(ci_netif* ni, ci_ip_pkt_fmt* pkt,
 }
 
 
+/*********************************************************************
+ ********** Small-datagram compaction (EF_UDP_RX_COMPACT) ************
+ *********************************************************************/
+
+/* Per-datagram record in a compact arena packet (CI_PKT_RX_FLAG_COMPACT).
+ * Records are written back-to-back into the arena's DMA area, each
+ * followed by the UDP payload and padded so the next record is aligned.
+ * They carry the little per-datagram state that the receive path needs
+ * and that normally lives in the packet's own metadata and headers.
+ */
+struct ci_udp_compact_rec {
+  ci_uint16  pay_len;     /* UDP payload bytes following this header */
+  ci_uint16  sport_be16;  /* source port, for msg_name */
+  ci_uint32  saddr_be32;  /* IPv4 source address, for msg_name */
+  ci_uint64  tstamp_frc;  /* software timestamp of the datagram */
+};
+
+#define CI_UDP_COMPACT_REC_BYTES(pay_len)                                 \
+  CI_ROUND_UP((unsigned) sizeof(struct ci_udp_compact_rec) + (pay_len), 8u)
+
+#define CI_UDP_COMPACT_ARENA_BYTES                                        \
+  (CI_CFG_PKT_BUF_SIZE - CI_MEMBER_OFFSET(ci_ip_pkt_fmt, dma_start))
+
+
+ci_inline struct ci_udp_compact_rec*
+ci_udp_compact_rec_at(ci_ip_pkt_fmt* pkt, unsigned off)
+{
+  return (struct ci_udp_compact_rec*) (pkt->dma_start + off);
+}
+
+
+/* Point the consumer view ([buf], pay_len, tstamp_frc) at the record at
+ * [off].  The generic extraction code then treats a compact arena just
+ * like any other single-fragment datagram. */
+ci_inline void ci_udp_compact_set_view(ci_ip_pkt_fmt* pkt, unsigned off)
+{
+  struct ci_udp_compact_rec* rec = ci_udp_compact_rec_at(pkt, off);
+  oo_offbuf_init(&pkt->buf, (char*) (rec + 1), rec->pay_len);
+  pkt->pf.udp.pay_len = rec->pay_len;
+  pkt->tstamp_frc = rec->tstamp_frc;
+}
+
+
+/* Does the arena at the queue's extract point hold an unconsumed record?
+ * Returns 1 if so (with the consumer view freshened), 0 if it is drained
+ * and closed (mark it consumed and step past), or -EAGAIN if drained but
+ * the producer may still append.  Socket lock required. */
+ci_inline int ci_udp_compact_ready(ci_ip_pkt_fmt* pkt)
+{
+  if( pkt->pf.udp.compact_rd_idx == OO_ACCESS_ONCE(pkt->pf.udp.compact_n_recs) ) {
+    if( ! OO_ACCESS_ONCE(pkt->pf.udp.compact_closed) )
+      return -EAGAIN;
+    /* Closing happens after the final append, so re-read to pick up
+     * records appended between the reads above. */
+    ci_rmb();
+    if( pkt->pf.udp.compact_rd_idx ==
+        OO_ACCESS_ONCE(pkt->pf.udp.compact_n_recs) )
+      return 0;
+  }
+  ci_rmb();  /* record contents were written before compact_n_recs */
+  ci_udp_compact_set_view(pkt, pkt->pf.udp.compact_rd);
+  return 1;
+}
+
+
+/* Consume the current record of a compact arena.  Socket lock required.
+ * Each record was accounted to the queue individually when appended, so
+ * this stands in for ci_udp_recv_q_deliver(). */
+ci_inline void ci_udp_compact_consume(ci_udp_recv_q* q, ci_ip_pkt_fmt* pkt)
+{
+  struct ci_udp_compact_rec* rec =
+    ci_udp_compact_rec_at(pkt, pkt->pf.udp.compact_rd);
+  pkt->pf.udp.compact_rd += CI_UDP_COMPACT_REC_BYTES(rec->pay_len);
+  ++pkt->pf.udp.compact_rd_idx;
+  ++q->pkts_delivered;
+}
+
+
 #endif  /* __UDP_INTERNAL_H__ */
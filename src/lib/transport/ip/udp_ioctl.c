@@ -40,6 +40,7 @@ void ci_synchronise_clock(ci_netif *ni, struct oo_timesync* oo_ts_local)
       oo_ts_local->mono_clock.tv_sec = oo_ts->mono_clock.tv_sec;
       oo_ts_local->mono_clock.tv_nsec = oo_ts->mono_clock.tv_nsec;
       oo_ts_local->clock_made = oo_ts->clock_made;
+      oo_ts_local->max_error_ns = oo_ts->max_error_ns;
       ci_rmb();
     } while (gc & 1 || gc != oo_ts->generation_count);
     oo_ts_local->generation_count = gc;
@@ -209,22 +210,26 @@ static int ci_udp_ioctl_locked(ci_netif* ni, ci_udp_state* us,
       return -EFAULT;
     rc = 1;
     if( rc ) {
-      /* Return the size of the datagram at the head of the receive queue.
+      /* Return the size of the datagram at the head of the receive queue
+       * (the first non-empty mailbox when RX demux is enabled).
        *
        * Careful: extract side of receive queue is owned by sock lock,
        * which we don't have.  However, freeing of bufs is owned by netif
        * lock, which we do have.  So we're safe so long as we only read
        * [extract] once.
        */
-      oo_pkt_p extract = OO_ACCESS_ONCE(us->recv_q.extract);
-      if( OO_PP_NOT_NULL(extract) ) {
-        ci_ip_pkt_fmt* pkt = PKT_CHK(ni, extract);
-        if( (pkt->rx_flags & CI_PKT_RX_FLAG_RECV_Q_CONSUMED) &&
-            OO_PP_NOT_NULL(pkt->udp_rx_next) )
-          pkt = PKT_CHK(ni, pkt->udp_rx_next);
-        if( !(pkt->rx_flags & CI_PKT_RX_FLAG_RECV_Q_CONSUMED) ) {
-          *(int*) arg = pkt->pf.udp.pay_len;
-          return 0;
+      int q;
+      for( q = 0; q < ci_udp_rx_q_count(us); ++q ) {
+        oo_pkt_p extract = OO_ACCESS_ONCE(ci_udp_rx_q(us, q)->extract);
+        if( OO_PP_NOT_NULL(extract) ) {
+          ci_ip_pkt_fmt* pkt = PKT_CHK(ni, extract);
+          if( (pkt->rx_flags & CI_PKT_RX_FLAG_RECV_Q_CONSUMED) &&
+              OO_PP_NOT_NULL(pkt->udp_rx_next) )
+            pkt = PKT_CHK(ni, pkt->udp_rx_next);
+          if( !(pkt->rx_flags & CI_PKT_RX_FLAG_RECV_Q_CONSUMED) ) {
+            *(int*) arg = pkt->pf.udp.pay_len;
+            return 0;
+          }
         }
       }
     }
@@ -16,6 +16,7 @@
 #define _GNU_SOURCE  /* for recvmmsg */
 
 #include "ip_internal.h"
+#include "udp_internal.h"
 #include "ip_tx_cmsg.h"
 #include <onload/osfile.h>
 #ifndef __KERNEL__
@@ -77,9 +78,75 @@ typedef struct {
 #if HAVE_MSG_FLAGS
   int msg_flags;
 #endif
+  /* Queue to consume from: us->recv_q normally, or the mailbox this
+   * reader has claimed when RX mailbox demux is enabled. */
+  ci_udp_recv_q* q;
+  int q_claimed;
 } ci_udp_recv_info;
 
 
+#ifndef __KERNEL__
+/* Mailbox most recently claimed by this thread: a steady reader keeps
+ * returning to the same mailbox, giving single-producer/single-consumer
+ * behaviour in the common case. */
+static __thread int udp_mailbox_hint;
+#endif
+
+ci_inline int ci_udp_mailbox_hint(void)
+{
+#ifndef __KERNEL__
+  return udp_mailbox_hint;
+#else
+  return 0;
+#endif
+}
+
+ci_inline void ci_udp_mailbox_hint_set(int q)
+{
+#ifndef __KERNEL__
+  udp_mailbox_hint = q;
+#endif
+}
+
+
+/* Point [rinf] at a queue with data to consume, claiming a mailbox if
+ * demux is enabled.  Returns 0 on success or -EAGAIN if there is nothing
+ * to consume (in which case no mailbox is held). */
+static int ci_udp_recv_q_claim(ci_udp_recv_info* rinf)
+{
+  ci_udp_state* us = rinf->a->us;
+  int q;
+
+  if( us->n_mailboxes == 0 )
+    return ci_udp_recv_q_not_empty(&us->recv_q) ? 0 : -EAGAIN;
+
+  if( rinf->q_claimed >= 0 ) {
+    if( ci_udp_recv_q_not_empty(rinf->q) )
+      return 0;
+    ci_udp_rx_q_release(us, rinf->q_claimed);
+    rinf->q_claimed = -1;
+    rinf->q = &us->recv_q;
+  }
+
+  q = ci_udp_rx_q_claim_not_empty(us, ci_udp_mailbox_hint());
+  if( q < 0 )
+    return -EAGAIN;
+  rinf->q = ci_udp_rx_q(us, q);
+  rinf->q_claimed = q;
+  ci_udp_mailbox_hint_set(q);
+  return 0;
+}
+
+
+static void ci_udp_recv_q_unclaim(ci_udp_recv_info* rinf)
+{
+  if( rinf->q_claimed >= 0 ) {
+    ci_udp_rx_q_release(rinf->a->us, rinf->q_claimed);
+    rinf->q_claimed = -1;
+  }
+}
+
+
 ci_inline void ci_udp_recvmsg_fill_msghdr(ci_netif* ni, ci_msghdr* msg,
 					  const ci_ip_pkt_fmt* pkt,
 					  ci_sock_cmn* s)
@@ -91,6 +158,18 @@ ci_inline void ci_udp_recvmsg_fill_msghdr(ci_netif* ni, ci_msghdr* msg,
       const ci_udp_hdr* udp;
       ci_addr_t saddr;
 
+      if( pkt->rx_flags & CI_PKT_RX_FLAG_COMPACT ) {
+        /* Compact arenas carry no headers; the record holds the source. */
+        const struct ci_udp_compact_rec* rec =
+          ci_udp_compact_rec_at((ci_ip_pkt_fmt*) pkt, pkt->pf.udp.compact_rd);
+        saddr = CI_ADDR_FROM_IP4(rec->saddr_be32);
+        ci_addr_to_user(CI_SA(msg->msg_name), &msg->msg_namelen, AF_INET,
+                        s->domain, rec->sport_be16,
+                        CI_IPX_ADDR_PTR(AF_INET, saddr),
+                        s->cp.so_bindtodevice);
+        return;
+      }
+
       if( pkt->flags & CI_PKT_FLAG_INDIRECT )
         pkt = PKT_CHK_NNL(ni, pkt->frag_next);
       af = oo_pkt_af(pkt);
@@ -191,6 +270,30 @@ static void ci_udp_pkt_to_zc_msg(ci_netif* ni, ci_ip_pkt_fmt* pkt,
   zc_msg->msghdr.msg_iovlen = i;
 }
 
+
+/* As ci_udp_pkt_to_zc_msg(), but for the current record of a compact arena
+ * (CI_PKT_RX_FLAG_COMPACT).  All records in an arena share one packet
+ * buffer and hence one zc handle; [was_kept] says whether the app already
+ * retained an earlier record, in which case we add a reference for this
+ * one rather than resetting the count.
+ */
+static void ci_udp_compact_to_zc_msg(ci_ip_pkt_fmt* pkt,
+                                     struct onload_zc_msg* zc_msg,
+                                     int was_kept)
+{
+  ci_assert_nequal(zc_msg->iov, NULL);
+  zc_msg->iov[0].iov_len = pkt->pf.udp.pay_len;
+  zc_msg->iov[0].iov_base = oo_offbuf_ptr(&pkt->buf);
+  zc_msg->iov[0].buf = zc_pktbuf_to_handle(pkt);
+  zc_msg->iov[0].iov_flags = 0;
+  zc_msg->iov[0].addr_space = EF_ADDRSPACE_LOCAL;
+  zc_msg->msghdr.msg_iovlen = 1;
+  if( ! was_kept )
+    pkt->user_refcount = CI_ZC_USER_REFCOUNT_ONE;
+  else
+    ++pkt->user_refcount;
+}
+
 # if CI_CFG_ZC_RECV_FILTER
 static void ci_udp_filter_kernel_pkt(ci_netif* ni, ci_udp_state* us,
                                      struct msghdr* msg, int *bytes)
@@ -244,12 +347,30 @@ static int ci_udp_recvmsg_get(ci_udp_recv_info* rinf, ci_iovec_ptr* piov)
 
   /* NB. [msg] can be NULL for async recv. */
 
-  if( (pkt = ci_udp_recv_q_get(ni, &us->recv_q)) == NULL )
+  if( ci_udp_recv_q_claim(rinf) < 0 )
     goto recv_q_is_empty;
+  if( (pkt = ci_udp_recv_q_get(ni, rinf->q)) == NULL )
+    goto recv_q_is_empty;
+
+  while( pkt->rx_flags & CI_PKT_RX_FLAG_COMPACT ) {
+    rc = ci_udp_compact_ready(pkt);
+    if( rc > 0 )
+      break;
+    if( rc < 0 )
+      goto recv_q_is_empty;
+    /* Drained and closed: step past it to the next packet. */
+    pkt->rx_flags |= CI_PKT_RX_FLAG_RECV_Q_CONSUMED;
+    if( (pkt = ci_udp_recv_q_get(ni, rinf->q)) == NULL )
+      goto recv_q_is_empty;
+  }
 
 #ifndef __KERNEL__
   if( msg != NULL ) {
-    if( CI_UNLIKELY(us->s.cmsg_flags != 0 ) )
+    /* Compact arenas have no headers to build ancillary data from; sockets
+     * that enable cmsg options stop being packed, but an already-queued
+     * arena can still be seen here. */
+    if( CI_UNLIKELY(us->s.cmsg_flags != 0) &&
+        ! (pkt->rx_flags & CI_PKT_RX_FLAG_COMPACT) )
       ci_ip_cmsg_recv(ni, us, pkt, msg, 0, &rinf->msg_flags);
     else
       msg->msg_controllen = 0;
@@ -273,7 +394,8 @@ static int ci_udp_recvmsg_get(ci_udp_recv_info* rinf, ci_iovec_ptr* piov)
     if( ! (rinf->flags & MSG_PEEK) ) {
 #ifndef __KERNEL__
 # if CI_CFG_ZC_RECV_FILTER
-      if( us->recv_q_filter ) {
+      if( us->recv_q_filter &&
+          ! (pkt->rx_flags & CI_PKT_RX_FLAG_COMPACT) ) {
         struct onload_zc_msg zc_msg;
         struct onload_zc_iovec zc_iovec[CI_UDP_ZC_IOVEC_MAX];
         unsigned cb_flags;
@@ -298,7 +420,10 @@ static int ci_udp_recvmsg_get(ci_udp_recv_info* rinf, ci_iovec_ptr* piov)
 # endif
 #endif
 
-      ci_udp_recv_q_deliver(ni, &us->recv_q, pkt);
+      if( pkt->rx_flags & CI_PKT_RX_FLAG_COMPACT )
+        ci_udp_compact_consume(rinf->q, pkt);
+      else
+        ci_udp_recv_q_deliver(ni, rinf->q, pkt);
     }
     us->udpflags |= CI_UDPF_LAST_RECV_ON;
   }
@@ -468,6 +593,45 @@ static int ci_udp_recvmsg_socklocked_slowpath(ci_udp_recv_info* rinf,
       return rc;
     }
 #endif
+    /* MSG_ZEROCOPY completion notifications; see ci_udp_zc_send_complete().
+     * Onload always sends from a copy, so every range is reported as
+     * "copied", telling well-behaved applications to stop pinning. */
+    if( us->zc_comp_pending ) {
+      struct cmsg_state cmsg_state;
+      struct {
+        struct oo_sock_extended_err ee;
+        union {
+          struct sockaddr_in        offender;
+#if CI_CFG_IPV6
+          struct sockaddr_in6       offender6;
+#endif
+        };
+      } __attribute__((packed, aligned(sizeof(ci_uint32)))) errhdr;
+
+      cmsg_state.msg = rinf->msg;
+      cmsg_state.cm = rinf->msg->msg_control;
+      cmsg_state.cmsg_bytes_used = 0;
+      cmsg_state.p_msg_flags = &rinf->msg_flags;
+
+      memset(&errhdr, 0, sizeof(errhdr));
+      errhdr.ee.ee_origin = SO_EE_ORIGIN_ZEROCOPY;
+      errhdr.ee.ee_code = SO_EE_CODE_ZEROCOPY_COPIED;
+      errhdr.ee.ee_info = us->zc_comp_lo;
+      errhdr.ee.ee_data = us->zc_comp_hi;
+      us->zc_comp_pending = 0;
+
+#if CI_CFG_IPV6
+      if( IS_AF_INET6(us->s.domain) )
+        ci_put_cmsg(&cmsg_state, SOL_IPV6, IPV6_RECVERR,
+                    sizeof(errhdr.ee) + sizeof(errhdr.offender6), &errhdr);
+      else
+#endif
+        ci_put_cmsg(&cmsg_state, SOL_IP, IP_RECVERR,
+                    sizeof(errhdr.ee) + sizeof(errhdr.offender), &errhdr);
+      ci_ip_cmsg_finish(&cmsg_state);
+      rinf->msg_flags |= MSG_ERRQUEUE_CHK;
+      return SLOWPATH_RET_ZERO;
+    }
     /* ICMP is handled via OS, so get OS error */
     rc = oo_os_sock_recvmsg(ni, SC_SP(&us->s), rinf->msg, rinf->flags);
     if( rc < 0 ) {
@@ -510,6 +674,11 @@ struct recvmsg_spinstate {
   ci_uint64 start_frc;
   ci_uint64 schedule_frc;
   ci_uint64 max_spin;
+  /* Spin-cycle accounting: time of the last accounted round, and how to
+   * classify the round in progress (see OO_SPIN_ACCOUNT()). */
+  ci_uint64 acct_frc;
+  int acct_n_evs;
+  int acct_lock_missed;
   int do_spin;
   int spin_limit_by_so;
   ci_uint32 timeout;
@@ -598,13 +767,21 @@ ci_udp_recvmsg_socklocked_spin(ci_netif* ni, ci_udp_state* us,
 #if CI_CFG_SPIN_STATS
     ni->state->stats.spin_udp_recv++;
 #endif
+    /* Attribute the cycles since the last round was accounted using that
+     * round's classification; this round's outcome is recorded below and
+     * accounted on the next call. */
+    OO_SPIN_ACCOUNT(ni, &spin_state->acct_frc, now_frc,
+                    spin_state->acct_n_evs, spin_state->acct_lock_missed);
+    spin_state->acct_n_evs = 0;
+    spin_state->acct_lock_missed = 0;
     if( ci_netif_may_poll(ni) ) {
 #ifndef __KERNEL__
       if( spin_state->future == &spin_state->poison )
         spin_state->future = ci_netif_intf_rx_future(ni, us->future_intf_i,
                                                      &spin_state->poison);
 
-      if( *spin_state->future != CI_PKT_RX_POISON && ci_netif_trylock(ni) ) {
+      if( *spin_state->future != CI_PKT_RX_POISON &&
+          ci_netif_poll_uncontended(ni) && ci_netif_trylock(ni) ) {
         if( ! ci_netif_poll_intf_future(ni, us->future_intf_i, now_frc) ) {
           /* If PftF failed (e.g. IPv6) then we still need to be able to
            * consume the packet (it might not be in the evq just yet, but it
@@ -613,18 +790,22 @@ ci_udp_recvmsg_socklocked_spin(ci_netif* ni, ci_udp_state* us,
         }
         ci_netif_unlock(ni);
         spin_state->future = &spin_state->poison;
+        spin_state->acct_n_evs = 1;
         return 0;
       }
 #endif
       if( ni->state->poll_work_outstanding ||
-          ci_netif_need_poll_spinning(ni, now_frc) )
-        if( ci_netif_trylock(ni) ) {
-          ci_netif_poll(ni);
+          ci_netif_need_poll_spinning(ni, now_frc) ) {
+        if( ci_netif_poll_uncontended(ni) && ci_netif_trylock(ni) ) {
+          spin_state->acct_n_evs = ci_netif_poll(ni);
           ci_netif_unlock(ni);
 #ifndef __KERNEL__
           spin_state->future = &spin_state->poison;
 #endif
         }
+        else
+          spin_state->acct_lock_missed = 1;
+      }
       if( ! ni->state->is_spinner )
         ni->state->is_spinner = 1;
     }
@@ -714,15 +895,17 @@ ci_udp_recvmsg_common(ci_udp_recv_info *rinf)
   if( ! have_polled ) {
     have_polled = 1;
     ci_frc64(&spin_state.start_frc);
+    spin_state.acct_frc = spin_state.start_frc;
 
     if( ci_netif_may_poll(ni) &&
         ci_netif_need_poll_spinning(ni, spin_state.start_frc) &&
+        ci_netif_poll_uncontended(ni) &&
         ci_netif_trylock(ni) ) {
       int any_evs = ci_netif_poll(ni);
-      if( ci_udp_recv_q_is_empty(&us->recv_q) && any_evs )
+      if( ! ci_udp_rx_q_any_not_empty(us) && any_evs )
         ci_netif_poll(ni);
       ci_netif_unlock(ni);
-      if( ci_udp_recv_q_not_empty(&us->recv_q) )
+      if( ci_udp_rx_q_any_not_empty(us) )
         goto check_ul_recv_q;
     }
   }
@@ -840,8 +1023,11 @@ int ci_udp_recvmsg(ci_udp_iomsg_args *a, ci_msghdr* msg, int flags)
   rinf.msg = msg;
   rinf.sock_locked = 0;
   rinf.flags = flags;
+  rinf.q = &us->recv_q;
+  rinf.q_claimed = -1;
 
   rc = ci_udp_recvmsg_common(&rinf);
+  ci_udp_recv_q_unclaim(&rinf);
   if( rinf.sock_locked )
     ci_sock_unlock(ni, &us->s.b);
 #if HAVE_MSG_FLAGS
@@ -868,6 +1054,8 @@ int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
   rinf.a = a;
   rinf.sock_locked = 0;
   rinf.flags = flags;
+  rinf.q = &us->recv_q;
+  rinf.q_claimed = -1;
 
   if( timeout ) {
     timeout_msec = timeout->tv_sec * 1000 + timeout->tv_nsec / 1000000;
@@ -887,6 +1075,7 @@ int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
     else {
       if( i != 0 && errno != EAGAIN )
         us->s.so_error = errno;
+      ci_udp_recv_q_unclaim(&rinf);
       if( rinf.sock_locked )
         ci_sock_unlock(ni, &us->s.b);
       if( i != 0 )
@@ -917,9 +1106,10 @@ int ci_udp_recvmmsg(ci_udp_iomsg_args *a, struct mmsghdr* mmsg,
     }
   }
 
+  ci_udp_recv_q_unclaim(&rinf);
   if( rinf.sock_locked )
     ci_sock_unlock(ni, &us->s.b);
-  
+
   return i;
 }
 #endif
@@ -1111,6 +1301,11 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
   spin_state.si = citp_signal_get_specific_inited();
   spin_state.timeout = us->s.so.rcvtimeo_msec;
 
+  /* Zero-copy receives consume us->recv_q directly and so cannot be mixed
+   * with RX mailbox demux; see ONLOAD_UDP_RX_MAILBOXES. */
+  if(CI_UNLIKELY( us->n_mailboxes != 0 ))
+    return -EINVAL;
+
   rc = ci_sock_lock(ni, &us->s.b);
   if(CI_UNLIKELY( rc != 0 ))
     return rc;
@@ -1133,6 +1328,22 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
     cb_flags = 0;
 
     while( (pkt = ci_udp_recv_q_get(ni, &us->recv_q)) != NULL ) {
+      int compact = 0;
+      int was_kept = 0;
+
+      if( pkt->rx_flags & CI_PKT_RX_FLAG_COMPACT ) {
+        int ready = ci_udp_compact_ready(pkt);
+        if( ready < 0 )
+          break;  /* drained but still open: nothing ready right now */
+        if( ready == 0 ) {
+          /* Drained and closed: step past it to the next packet. */
+          pkt->rx_flags |= CI_PKT_RX_FLAG_RECV_Q_CONSUMED;
+          continue;
+        }
+        compact = 1;
+        was_kept = (pkt->rx_flags & CI_PKT_RX_FLAG_KEEP) != 0;
+      }
+
       /* Reinitialise our own state within [args] each time around the loop, as
        * the app's callback might have changed it. */
       args->msg.iov = iovec;
@@ -1140,7 +1351,7 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
       args->msg.msghdr.msg_namelen = supplied_namelen;
       args->msg.msghdr.msg_flags = 0;
 
-      if( CI_UNLIKELY(us->s.cmsg_flags != 0 ) ) {
+      if( CI_UNLIKELY(us->s.cmsg_flags != 0) && ! compact ) {
         args->msg.msghdr.msg_controllen = supplied_controllen;
         args->msg.msghdr.msg_control = supplied_control;
         ci_ip_cmsg_recv(ni, us, pkt, &args->msg.msghdr, 0,
@@ -1149,15 +1360,21 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
       else
         args->msg.msghdr.msg_controllen = 0;
 
-      ci_udp_recvmsg_fill_msghdr(ni, &args->msg.msghdr, pkt, 
+      ci_udp_recvmsg_fill_msghdr(ni, &args->msg.msghdr, pkt,
                                  &us->s);
 
-      ci_udp_pkt_to_zc_msg(ni, pkt, &args->msg);
+      if( compact )
+        ci_udp_compact_to_zc_msg(pkt, &args->msg, was_kept);
+      else
+        ci_udp_pkt_to_zc_msg(ni, pkt, &args->msg);
 
       us->stamp = pkt->tstamp_frc;
       us->udpflags |= CI_UDPF_LAST_RECV_ON;
-    
-      cb_flags = CI_IP_IS_MULTICAST(oo_ip_hdr(pkt)->ip_daddr_be32) ? 
+
+      /* Compact arenas hold unicast datagrams only (and carry no headers
+       * to check). */
+      cb_flags = ! compact &&
+        CI_IP_IS_MULTICAST(oo_ip_hdr(pkt)->ip_daddr_be32) ?
         ONLOAD_ZC_MSG_SHARED : 0;
       if( (ci_udp_recv_q_pkts(&us->recv_q) == 1) &&
           ((us->s.os_sock_status & OO_OS_STATUS_RX) == 0) )
@@ -1171,9 +1388,21 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
 
       cb_rc = (*args->cb)(args, cb_flags);
 
-      ci_pkt_zc_free_clean(pkt, cb_rc);
-
-      ci_udp_recv_q_deliver(ni, &us->recv_q, pkt);
+      if( compact ) {
+        if( ! (cb_rc & ONLOAD_ZC_KEEP) ) {
+          if( was_kept )
+            /* Drop only the reference we added for this record; an earlier
+             * record of the arena is still retained by the app. */
+            --pkt->user_refcount;
+          else
+            ci_pkt_zc_free_clean(pkt, cb_rc);
+        }
+        ci_udp_compact_consume(&us->recv_q, pkt);
+      }
+      else {
+        ci_pkt_zc_free_clean(pkt, cb_rc);
+        ci_udp_recv_q_deliver(ni, &us->recv_q, pkt);
+      }
 
       done_callback = 1;
 
@@ -1195,11 +1424,14 @@ int ci_udp_zc_recv(ci_udp_iomsg_args* a, struct onload_zc_recv_args* args)
   return rc;
 
  empty:
-  if( spin_state.start_frc == 0 )
+  if( spin_state.start_frc == 0 ) {
     ci_frc64(&spin_state.start_frc);
+    spin_state.acct_frc = spin_state.start_frc;
+  }
 
   if( ci_netif_may_poll(ni) &&
-      ci_netif_need_poll_spinning(ni, spin_state.start_frc) && 
+      ci_netif_need_poll_spinning(ni, spin_state.start_frc) &&
+      ci_netif_poll_uncontended(ni) &&
       ci_netif_trylock(ni) ) {
     /* If only a few events, we don't need to bother with the full poll */
     if( ci_netif_poll(ni) <
@@ -89,6 +89,7 @@ int ci_udp_recv_q_reap(ci_netif* ni, ci_udp_recv_q* q)
 void ci_udp_recv_q_drop(ci_netif* ni, ci_udp_recv_q* q)
 {
   ci_ip_pkt_fmt* pkt;
+  q->compact_arena = OO_PP_NULL;
   while( OO_PP_NOT_NULL(q->head) ) {
     pkt = PKT_CHK(ni, q->head);
     q->head = pkt->udp_rx_next;
@@ -119,6 +120,118 @@ int ci_udp_csum_correct(ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp)
 }
 
 
+#if CI_CFG_ZC_RECV_FILTER
+/* Evaluate the socket's receive filter chain against the datagram payload
+ * while it is still cache-hot.  Returns true if the datagram should be
+ * queued on the socket.  Only the first packet buffer is inspected: rules
+ * referring to bytes beyond it (or beyond the datagram) do not match.
+ */
+static int ci_udp_recv_filter_chain_accept(ci_udp_state* us,
+                                           ci_ip_pkt_fmt* pkt)
+{
+  const ci_uint8* pay = (const ci_uint8*) oo_offbuf_ptr(&pkt->buf);
+  int pay_len = CI_MIN(pkt->pf.udp.pay_len, oo_offbuf_left(&pkt->buf));
+  int match = 1;
+  int i, j;
+
+  for( i = 0; i < us->recv_q_filter_n_rules; ++i ) {
+    ci_uint64 v = 0;
+    unsigned off = us->recv_q_filter_rules[i].offset;
+    unsigned len = us->recv_q_filter_rules[i].len;
+
+    if( off + len > (unsigned) pay_len ) {
+      match = 0;
+      break;
+    }
+    /* Wire-order load; a plain byte loop keeps this portable and is
+     * trivially vectorised by the compiler. */
+    for( j = 0; j < (int) len; ++j )
+      v = (v << 8) | pay[off + j];
+    if( (v & us->recv_q_filter_rules[i].mask) !=
+        us->recv_q_filter_rules[i].value ) {
+      match = 0;
+      break;
+    }
+  }
+
+  if( us->recv_q_filter_flags & CI_UDP_RECV_FILTER_F_DROP_MATCH )
+    return ! match;
+  return match;
+}
+#endif
+
+
+/* Small-datagram compaction (EF_UDP_RX_COMPACT): copy the payload of a
+ * small datagram into a densely packed arena packet while it is still
+ * cache-hot in the poll loop, so the 2KB RX buffer recycles immediately
+ * and the receive queue holds many datagrams per buffer.  Returns the
+ * arena the datagram was packed into, or NULL if it must be queued the
+ * ordinary way.
+ */
+static ci_ip_pkt_fmt* ci_udp_rx_compact(ci_netif* ni, ci_udp_recv_q* q,
+                                        ci_ip_pkt_fmt* pkt)
+{
+  unsigned rec_bytes = CI_UDP_COMPACT_REC_BYTES(pkt->pf.udp.pay_len);
+  const ci_udp_hdr* udp = oo_ipx_data(AF_INET, pkt);
+  ci_ip_pkt_fmt* arena = NULL;
+  struct ci_udp_compact_rec* rec;
+  int fresh = 0;
+
+  if( OO_PP_NOT_NULL(q->compact_arena) ) {
+    arena = PKT_CHK(ni, q->compact_arena);
+    if( arena->pf.udp.compact_wr + rec_bytes > CI_UDP_COMPACT_ARENA_BYTES ) {
+      /* Full: close it and start afresh. */
+      ci_udp_compact_close(ni, q);
+      arena = NULL;
+    }
+  }
+
+  if( arena == NULL ) {
+    if( ni->state->n_rx_pkts > NI_OPTS(ni).max_rx_packets ||
+        (arena = ci_netif_pkt_alloc(ni, 0)) == NULL )
+      return NULL;
+    ++ni->state->n_rx_pkts;
+    arena->flags = CI_PKT_FLAG_UDP | CI_PKT_FLAG_RX;
+    arena->rx_flags |= CI_PKT_RX_FLAG_COMPACT;
+    arena->intf_i = pkt->intf_i;
+    arena->pf.udp.compact_wr = 0;
+    arena->pf.udp.compact_rd = 0;
+    arena->pf.udp.compact_n_recs = 0;
+    arena->pf.udp.compact_rd_idx = 0;
+    arena->pf.udp.compact_closed = 0;
+    fresh = 1;
+  }
+
+  rec = ci_udp_compact_rec_at(arena, arena->pf.udp.compact_wr);
+  rec->pay_len = pkt->pf.udp.pay_len;
+  rec->sport_be16 = udp->udp_source_be16;
+  rec->saddr_be32 = oo_ip_hdr(pkt)->ip_saddr_be32;
+  rec->tstamp_frc = pkt->tstamp_frc;
+  memcpy(rec + 1, oo_offbuf_ptr(&pkt->buf), rec->pay_len);
+  arena->pf.udp.compact_wr += rec_bytes;
+
+  if( fresh ) {
+    /* Establish the consumer view on the first record, then make the
+     * arena visible; the put accounts the record to the queue.  Hook it
+     * up as the open arena only afterwards, as the put itself closes any
+     * arena it queues behind. */
+    ci_udp_compact_set_view(arena, 0);
+    arena->pf.udp.compact_n_recs = 1;
+    ci_udp_recv_q_put(ni, q, arena);
+    q->compact_arena = OO_PKT_P(arena);
+  }
+  else {
+    /* Appended records are accounted one each so that readiness tracks
+     * datagrams, not buffers; n_buffers balances the reap side. */
+    ++arena->n_buffers;
+    ci_wmb();
+    ++arena->pf.udp.compact_n_recs;
+    ci_udp_recv_q_put_complete(q, 1);
+  }
+  return arena;
+}
+
+
 int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
 {
   /* Deliver a received packet to a socket. */
@@ -128,7 +241,16 @@ int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
   ci_ip_pkt_fmt* q_pkt;
   ci_udp_state* us = SOCK_TO_UDP(s);
   ci_netif* ni = state->ni;
-  int recvq_depth = ci_udp_recv_q_pkts(&us->recv_q) + pkt->n_buffers;
+  ci_udp_recv_q* recvq = &us->recv_q;
+  int recvq_depth;
+
+  /* With RX mailboxes enabled, distribute datagrams round-robin; each
+   * mailbox gets the full SO_RCVBUF allowance. */
+  if( us->n_mailboxes ) {
+    recvq = ci_udp_rx_q(us, us->mailbox_rr);
+    us->mailbox_rr = (us->mailbox_rr + 1) % us->n_mailboxes;
+  }
+  recvq_depth = ci_udp_recv_q_pkts(recvq) + pkt->n_buffers;
 
   LOG_UV(log("%s: "NS_FMT "pay_len=%d "CI_IP_PRINTF_FORMAT" -> "
              CI_IP_PRINTF_FORMAT, __FUNCTION__,
@@ -138,15 +260,54 @@ int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
 
   state->delivered = 1;
 
+#if CI_CFG_ZC_RECV_FILTER
+  if(CI_UNLIKELY( us->recv_q_filter_n_rules != 0 &&
+                  ! ci_udp_recv_filter_chain_accept(us, pkt) )) {
+    /* The app asked for this datagram to be discarded; it still counts as
+     * delivered to this socket. */
+    ++us->stats.n_rx_filter_drop;
+    return CI_IP_IS_MULTICAST(oo_ip_hdr(pkt)->ip_daddr_be32) ||
+           oo_ip_hdr(pkt)->ip_daddr_be32 == CI_IP_ALL_BROADCAST ? 0 : 1;
+  }
+#endif
+
   if( (recvq_depth <= us->stats.max_recvq_pkts) &&
       ! (ni->state->mem_pressure & OO_MEM_PRESSURE_CRITICAL) ) {
     int multi_destination_pkt;
+    ci_ip_pkt_fmt* arena = NULL;
 
   fast_receive:
     multi_destination_pkt =
       CI_IP_IS_MULTICAST(oo_ip_hdr(pkt)->ip_daddr_be32) ||
       oo_ip_hdr(pkt)->ip_daddr_be32 == CI_IP_ALL_BROADCAST;
 
+    /* Small unicast datagrams can be packed into a compact arena while
+     * cache-hot, releasing the RX buffer immediately.  Anything needing
+     * per-packet metadata on the consumer side (ancillary data, receive
+     * filters, fragments, IPv6) is queued the ordinary way.
+     */
+    if( NI_OPTS(ni).udp_rx_compact != 0 &&
+        pkt->pf.udp.pay_len <= NI_OPTS(ni).udp_rx_compact &&
+        ! multi_destination_pkt && ! state->queued &&
+        pkt->n_buffers == 1 &&
+        ! (pkt->flags & (CI_PKT_FLAG_IS_IP6
+#if CI_CFG_TIMESTAMPING
+                         | CI_PKT_FLAG_TX_TIMESTAMPED
+#endif
+                         )) &&
+        us->s.cmsg_flags == 0
+#if CI_CFG_ZC_RECV_FILTER
+        && us->recv_q_filter == 0
+#endif
+        )
+      arena = ci_udp_rx_compact(ni, recvq, pkt);
+
+    if( arena != NULL ) {
+      ++us->stats.n_rx_compact;
+      oo_rx_order_record(ni, SC_SP(s), pkt->pf.udp.pay_len, arena);
+      goto queued;
+    }
+
     /* The same queue link is used for both the TX timestamp_q and the
      * udp recv_q, so we need to use an indirect packet if this is
      * timestamped.  This can only occur in the loopback case, where the
@@ -185,7 +346,9 @@ int ci_udp_rx_deliver(ci_sock_cmn* s, void* opaque_arg)
       pkt = q_pkt;
     }
     ci_assert_nflags(pkt->rx_flags, CI_PKT_RX_FLAG_KEEP);
-    ci_udp_recv_q_put(ni, &us->recv_q, pkt);
+    ci_udp_recv_q_put(ni, recvq, pkt);
+    oo_rx_order_record(ni, SC_SP(s), pkt->pf.udp.pay_len, pkt);
+  queued:
     us->s.b.sb_flags |= CI_SB_FLAG_RX_DELIVERED;
     ci_netif_put_on_post_poll(ni, &us->s.b);
     ci_udp_wake_possibly_not_in_poll(ni, us, CI_SB_FLAG_WAKE_RX);
@@ -287,20 +450,43 @@ void ci_udp_handle_rx(ci_netif* ni, ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp,
   else
 #endif
   {
-    dealt_with =
-      ci_netif_filter_for_each_match(ni,
-                                     ipx->ip4.ip_daddr_be32,
-                                     udp->udp_dest_be16,
-                                     ipx->ip4.ip_saddr_be32,
-                                     udp->udp_source_be16,
-                                     IPPROTO_UDP, pkt->intf_i, pkt->vlan,
-                                     ci_udp_rx_deliver, &state, NULL);
-    if( ! dealt_with ) {
-      ci_netif_filter_for_each_match(ni,
-                                     ipx->ip4.ip_daddr_be32,
-                                     udp->udp_dest_be16, 0, 0,
-                                     IPPROTO_UDP, pkt->intf_i, pkt->vlan,
-                                     ci_udp_rx_deliver, &state, NULL);
+    int mcast_rc = -1;
+
+    /* Multicast packets can usually be demuxed via the dedicated
+     * (group, port) table; fall back to the filter table when it is not
+     * authoritative (see EF_MCAST_DEMUX). */
+    if( ni->state->mcast_tbl_entries_n != 0 &&
+        CI_IP_IS_MULTICAST(ipx->ip4.ip_daddr_be32) ) {
+      mcast_rc =
+        ci_netif_mcast_tbl_for_each_match(ni,
+                                          ipx->ip4.ip_daddr_be32,
+                                          udp->udp_dest_be16,
+                                          ipx->ip4.ip_saddr_be32,
+                                          udp->udp_source_be16,
+                                          pkt->intf_i, pkt->vlan,
+                                          ci_udp_rx_deliver, &state);
+      if( mcast_rc >= 0 )
+        CITP_STATS_NETIF_INC(ni, mcast_tbl_rx);
+      else
+        CITP_STATS_NETIF_INC(ni, mcast_tbl_rx_fallback);
+    }
+
+    if( mcast_rc < 0 ) {
+      dealt_with =
+        ci_netif_filter_for_each_match(ni,
+                                       ipx->ip4.ip_daddr_be32,
+                                       udp->udp_dest_be16,
+                                       ipx->ip4.ip_saddr_be32,
+                                       udp->udp_source_be16,
+                                       IPPROTO_UDP, pkt->intf_i, pkt->vlan,
+                                       ci_udp_rx_deliver, &state, NULL);
+      if( ! dealt_with ) {
+        ci_netif_filter_for_each_match(ni,
+                                       ipx->ip4.ip_daddr_be32,
+                                       udp->udp_dest_be16, 0, 0,
+                                       IPPROTO_UDP, pkt->intf_i, pkt->vlan,
+                                       ci_udp_rx_deliver, &state, NULL);
+      }
     }
   }
 
@@ -338,6 +524,8 @@ void ci_udp_handle_rx(ci_netif* ni, ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp,
                  (unsigned) CI_BSWAP_BE16(udp->udp_dest_be16)));
 #endif
     CITP_STATS_NETIF_INC(ni, udp_rx_no_match_drops);
+    ci_netif_drop_sample(ni, CI_DROP_REASON_NO_MATCH, pkt->intf_i,
+                         PKT_START(pkt), pkt->pay_len);
     if( ! CI_IPX_IS_MULTICAST(ipx_hdr_daddr(af, ipx)) ) {
       CI_UDP_STATS_INC_NO_PORTS(ni);
       ci_icmp_send_port_unreach(ni, pkt);
@@ -349,6 +537,8 @@ void ci_udp_handle_rx(ci_netif* ni, ci_ip_pkt_fmt* pkt, ci_udp_hdr* udp,
   CI_UDP_STATS_INC_IN_ERRS(ni);
   LOG_U(CI_RLLOG(10, "%s: ip_paylen=%d udp_len=%d",
                  __FUNCTION__, ip_paylen, pkt->pf.udp.pay_len));
+  ci_netif_drop_sample(ni, CI_DROP_REASON_UDP, pkt->intf_i,
+                       PKT_START(pkt), pkt->pay_len);
   goto drop_out;
 
  drop_out:
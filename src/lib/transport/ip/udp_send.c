@@ -12,7 +12,9 @@
 \**************************************************************************/
   
 /*! \cidoxg_lib_transport_ip */
-  
+
+#define _GNU_SOURCE  /* for sendmmsg */
+
 #include "ip_internal.h"
 #include "udp_internal.h"
 #include "ip_tx.h"
@@ -76,6 +78,9 @@ struct udp_send_info {
   int                   stack_locked;
   ci_uint32             timeout;
   int                   old_ipcache_updated;
+  /* Set by ci_udp_fanout_send(): make ci_udp_sendmsg_fill() keep the
+   * payload out of the header buffer so it can be shared by reference. */
+  int                   fanout;
 };
 
 static bool ci_ipx_is_first_frag(int af, ci_ipx_hdr_t* ipx)
@@ -948,6 +953,93 @@ static void ci_udp_sendmsg_async_q_enqueue(ci_netif* ni, ci_udp_state* us,
 }
 
 
+/* Drain the per-stack TX staging queue (EF_UDP_TX_STAGING).  Called by the
+ * lock holder, either from the unlock path or when a stager manages to get
+ * the lock itself.
+ */
+void ci_udp_sendmsg_drain_staged(ci_netif* ni)
+{
+  oo_pkt_p pp, send_list;
+  ci_ip_pkt_fmt* pkt;
+  ci_udp_state* us;
+  int flags;
+
+  ci_assert(ci_netif_is_locked(ni));
+
+  /* Grab the contents of [tx_staging_q]. */
+  do {
+    OO_PP_INIT(ni, pp, ni->state->tx_staging_q);
+    if( OO_PP_IS_NULL(pp) )  return;
+  } while( ci_cas32_fail(&ni->state->tx_staging_q, OO_PP_ID(pp),
+                         OO_PP_ID_NULL) );
+
+  /* Reverse the list to restore push order, which preserves per-socket
+   * ordering. */
+  send_list = OO_PP_NULL;
+  do {
+    pkt = PKT_CHK(ni, pp);
+    pp = pkt->netif.tx.dmaq_next;
+    pkt->netif.tx.dmaq_next = send_list;
+    send_list = OO_PKT_P(pkt);
+  }
+  while( OO_PP_NOT_NULL(pp) );
+
+  /* Send each datagram on behalf of the socket it was staged from. */
+  while( 1 ) {
+    pp = pkt->netif.tx.dmaq_next;
+    us = SP_TO_UDP(ni, pkt->pf.udp.tx_sock_id);
+    oo_atomic_add(&us->tx_async_q_level,
+                  -ci_udp_tx_datagram_level(ni, pkt, CI_TRUE));
+    if( pkt->flags & CI_PKT_FLAG_MSG_CONFIRM )
+      flags = MSG_CONFIRM;
+    else
+      flags = 0;
+    ++us->stats.n_tx_lock_defer;
+    ci_udp_sendmsg_send(ni, us, pkt, flags, NULL);
+    ci_netif_pkt_release(ni, pkt);
+    if( OO_PP_IS_NULL(pp) )  break;
+    pkt = PKT_CHK(ni, pp);
+  }
+}
+
+
+/* Stage a fully-formed datagram on the per-stack lock-free MPSC queue
+ * (EF_UDP_TX_STAGING).  Unlike ci_udp_sendmsg_async_q_enqueue() this never
+ * blocks on the stack lock and does not touch the lock word unless it is
+ * uncontended.
+ */
+static void ci_udp_sendmsg_stage(ci_netif* ni, ci_udp_state* us,
+                                 ci_ip_pkt_fmt* pkt, int flags)
+{
+  if( flags & MSG_CONFIRM )
+    pkt->flags |= CI_PKT_FLAG_MSG_CONFIRM;
+
+  /* The drain side recovers the owning socket from the packet; on this
+   * path prep_send_pkt() has not run yet, so set the id here. */
+  pkt->pf.udp.tx_sock_id = S_SP(us);
+
+  oo_atomic_add(&us->tx_async_q_level,
+                ci_udp_tx_datagram_level(ni, pkt, CI_FALSE));
+  do
+    OO_PP_INIT(ni, pkt->netif.tx.dmaq_next, ni->state->tx_staging_q);
+  while( ci_cas32_fail(&ni->state->tx_staging_q,
+                       OO_PP_ID(pkt->netif.tx.dmaq_next), OO_PKT_ID(pkt)) );
+
+  /* Ensure somebody notices the staged packet: either the current lock
+   * holder (who will drain on unlock) or ourselves. */
+  while( 1 ) {
+    if( ef_eplock_set_flag_if_locked(&ni->state->lock,
+                                     CI_EPLOCK_NETIF_STAGED_TX) )
+      return;
+    if( ci_netif_trylock(ni) ) {
+      ci_udp_sendmsg_drain_staged(ni);
+      ci_netif_unlock(ni);
+      return;
+    }
+  }
+}
+
+
 #ifndef __KERNEL__
 /* Check if provided address struct/content is OK for us. */
 static int ci_udp_name_is_ok(int af, ci_udp_state* us, const struct msghdr* msg)
@@ -1226,6 +1318,11 @@ int ci_udp_sendmsg_fill(ci_netif* ni, ci_udp_state* us,
   oo_pkt_filler_init(pf, first_pkt, (uint8_t*) udp + sizeof(ci_udp_hdr));
   first_pkt->pay_len = ((char*) udp + sizeof(ci_udp_hdr) - PKT_START(first_pkt));
 
+  if(CI_UNLIKELY( sinf->fanout && bytes_to_send > 0 ))
+    /* Force the payload into its own buffer(s), so that the header-only
+     * clones built by ci_udp_fanout_send() can share them by reference. */
+    pf->buf_end = pf->buf_start;
+
   oo_pkt_af_set(first_pkt, af);
 
   payload_bytes = pmtu - CI_IPX_HDR_SIZE(af) - sizeof(ci_udp_hdr);
@@ -1464,6 +1561,9 @@ void ci_udp_sendmsg_onload(ci_netif* ni, ci_udp_state* us,
       ci_netif_unlock(ni);
       sinf->stack_locked = 0;
     }
+    else if( NI_OPTS(ni).udp_tx_staging ) {
+      ci_udp_sendmsg_stage(ni, us, pf.pkt, flags);
+    }
     else {
       ci_udp_sendmsg_async_q_enqueue(ni, us, pf.pkt, flags);
     }
@@ -1524,6 +1624,25 @@ static int ci_udp_sendmsg_control_os(ci_fd_t fd, ci_udp_state *us,
 }
 #endif
 
+#ifndef __KERNEL__
+/* Record completion of a MSG_ZEROCOPY send.  Onload always transmits from
+ * a copy of the payload, so each send completes (as "copied") as soon as
+ * the datagram is queued.  Completions for consecutive sends are coalesced
+ * into a single [zc_comp_lo, zc_comp_hi] range, as the kernel does, and
+ * picked up by recvmsg(MSG_ERRQUEUE); see ci_udp_recvmsg_socklocked_slowpath().
+ */
+static void ci_udp_zc_send_complete(ci_udp_state* us)
+{
+  ci_uint32 id = us->zc_key++;
+  if( us->zc_comp_pending && id == us->zc_comp_hi + 1 )
+    us->zc_comp_hi = id;
+  else
+    us->zc_comp_lo = us->zc_comp_hi = id;
+  us->zc_comp_pending = 1;
+}
+#endif
+
+
 int ci_udp_sendmsg(ci_udp_iomsg_args *a,
                    const ci_msghdr* msg, int flags)
 {
@@ -1541,6 +1660,7 @@ int ci_udp_sendmsg(ci_udp_iomsg_args *a,
   sinf.used_ipcache = 0;
   sinf.old_ipcache_updated = 0;
   sinf.timeout = us->s.so.sndtimeo_msec;
+  sinf.fanout = 0;
 
 #ifndef __KERNEL__
 #ifdef __i386__
@@ -1743,6 +1863,13 @@ int ci_udp_sendmsg(ci_udp_iomsg_args *a,
   ci_udp_sendmsg_onload(ni, us, msg, flags, &sinf);
   if( sinf.stack_locked )
     ci_netif_unlock(ni);
+#ifndef __KERNEL__
+  /* Without SO_ZEROCOPY, MSG_ZEROCOPY silently degrades to a plain copied
+   * send with no notification, matching the kernel's UDP behaviour. */
+  if( CI_UNLIKELY(flags & MSG_ZEROCOPY) && sinf.rc >= 0 &&
+      (us->s.so.so_debug & CI_SOCKOPT_FLAG_SO_ZEROCOPY) )
+    ci_udp_zc_send_complete(us);
+#endif
   if( sinf.rc < 0 )
       CI_SET_ERROR(sinf.rc, -sinf.rc);
   return sinf.rc;
@@ -1768,5 +1895,246 @@ int ci_udp_sendmsg(ci_udp_iomsg_args *a,
     RET_WITH_ERRNO(-rc);
 }
 
+
+#ifndef __KERNEL__
+
+/* Build a header-only clone of [pkt] for another fanout destination.  The
+ * clone gets a copy of the header buffer and shares the payload buffers
+ * via [frag_next]; the payload references are taken by the caller.
+ */
+static ci_ip_pkt_fmt*
+ci_udp_fanout_clone(ci_netif* ni, ci_udp_state* us, struct udp_send_info* sinf,
+                    int can_block, ci_ip_pkt_fmt* pkt, int af)
+{
+  ci_ip_pkt_fmt* c;
+  int rc;
+
+  rc = ci_netif_pkt_alloc_block(ni, &us->s, &sinf->stack_locked,
+                                can_block, &c);
+  if( rc != 0 )
+    return NULL;
+  oo_tx_pkt_layout_init(c);
+  memcpy(PKT_START(c), PKT_START(pkt), pkt->buf_len);
+  c->buf_len = pkt->buf_len;
+  c->pay_len = pkt->pay_len;
+  c->n_buffers = pkt->n_buffers;
+  c->frag_next = pkt->frag_next;
+  c->next = OO_PP_NULL;
+  c->pf.udp.tx_length = pkt->pf.udp.tx_length;
+  oo_pkt_af_set(c, af);
+  /* This refcount is used later by ci_netif_send(), as in
+   * ci_udp_sendmsg_fill(). */
+  ci_netif_pkt_hold(ni, c);
+  return c;
+}
+
+
+int ci_udp_fanout_send(ci_udp_iomsg_args* a, const ci_msghdr* msg,
+                       int flags, const ci_addr_t* daddrs,
+                       const ci_uint16* dports_be16, int n_dests)
+{
+  ci_netif* ni = a->ni;
+  ci_udp_state* us = a->us;
+  struct udp_send_info sinf;
+  struct oo_pkt_filler pf;
+  ci_ip_pkt_fmt* clones[CI_UDP_FANOUT_SEND_MAX];
+  ci_iovec_ptr piov;
+  unsigned long bytes_to_send;
+  int af = ipcache_af(&us->s.pkt);
+  int rc, i, n_built, can_block;
+  oo_pkt_p pp;
+
+  ci_assert(msg != NULL);
+  if( n_dests <= 0 || n_dests > CI_UDP_FANOUT_SEND_MAX )
+    return -EINVAL;
+
+  sinf.rc = 0;
+  sinf.stack_locked = 0;
+  sinf.used_ipcache = 0;
+  sinf.old_ipcache_updated = 0;
+  sinf.timeout = us->s.so.sndtimeo_msec;
+  sinf.fanout = 1;
+
+  /* Conditions the fanout fast path does not handle; the caller falls
+   * back to one plain sendmsg per destination. */
+  if( (flags & (MSG_MORE | MSG_OOB)) ||
+      (us->s.so_error | us->s.tx_errno) ||
+      udp_lport_be16(us) == 0 ||
+      CI_ADDR_AF(daddrs[0]) != af )
+    return -EOPNOTSUPP;
+  /* Local loopback delivery mutates the shared payload buffers, so take
+   * the slow path when it may be needed. */
+  if( (us->udpflags & CI_UDPF_MCAST_LOOP) &&
+      (NI_OPTS(ni).mcast_send & CITP_MCAST_SEND_FLAG_LOCAL) )
+    return -EOPNOTSUPP;
+
+  bytes_to_send = 0;
+  for( i = 0; i < (int) msg->msg_iovlen; ++i ) {
+    if( CI_IOVEC_BASE(&msg->msg_iov[i]) == NULL &&
+        CI_IOVEC_LEN(&msg->msg_iov[i]) > 0 )
+      return -EFAULT;
+    bytes_to_send += CI_IOVEC_LEN(&msg->msg_iov[i]);
+  }
+  if( msg->msg_iovlen > 0 )
+    ci_iovec_ptr_init_nz(&piov, msg->msg_iov, msg->msg_iovlen);
+  else
+    ci_iovec_ptr_init(&piov, NULL, 0);
+
+  /* Resolve the first destination to prime the MTU and header template,
+   * as the unconnected sendmsg path does.  The per-destination routing is
+   * redone by ci_udp_sendmsg_send() from each clone's headers. */
+  ci_ipcache_set_daddr(&sinf.ipcache, daddrs[0]);
+  sinf.ipcache.dport_be16 = dports_be16[0];
+#if CI_CFG_IPV6
+  sinf.ipcache.ether_type = us->s.pkt.ether_type;
+#endif
+  if( si_trylock_and_inc(ni, &sinf, us->stats.n_tx_lock_cp) ) {
+    if( !( us->ephemeral_pkt.dport_be16 == dports_be16[0] &&
+           CI_IPX_ADDR_EQ(daddrs[0], ipcache_raddr(&us->ephemeral_pkt)) ) ) {
+      ci_ipcache_set_daddr(&us->ephemeral_pkt, daddrs[0]);
+      us->ephemeral_pkt.dport_be16 = dports_be16[0];
+      ci_ip_cache_invalidate(&us->ephemeral_pkt);
+    }
+    if(CI_UNLIKELY( ! oo_cp_ipcache_is_valid(ni, &us->ephemeral_pkt) )) {
+      ++us->stats.n_tx_cp_uc_lookup;
+      cicp_user_retrieve(ni, &us->ephemeral_pkt, &us->s.cp);
+    }
+    if( us->ephemeral_pkt.status != retrrc_success &&
+        us->ephemeral_pkt.status != retrrc_nomac )
+      goto unlock_unsupported;
+    sinf.ipcache.mtu = us->ephemeral_pkt.mtu;
+  }
+  else {
+    sinf.used_ipcache = 1;
+    ++us->stats.n_tx_cp_a_lookup;
+    ci_ip_cache_invalidate(&sinf.ipcache);
+    cicp_user_retrieve(ni, &sinf.ipcache, &us->s.cp);
+    if( sinf.ipcache.status != retrrc_success &&
+        sinf.ipcache.status != retrrc_nomac )
+      goto unlock_unsupported;
+    sinf.old_ipcache_updated = 1;
+  }
+  ci_assert_gt(sinf.ipcache.mtu, 0);
+
+  /* Fragmented fanout would need per-fragment clones; punt.  Likewise
+   * when the sendq can't absorb the whole fanout. */
+  if( bytes_to_send > sinf.ipcache.mtu - CI_IPX_HDR_SIZE(af) -
+                      sizeof(ci_udp_hdr) ||
+      ! UDP_HAS_SENDQ_SPACE(us, bytes_to_send * n_dests) )
+    goto unlock_unsupported;
+
+  pf.alloc_pkt = NULL;
+  rc = ci_udp_sendmsg_fill(ni, us, &piov, bytes_to_send, flags, &pf, &sinf,
+                           false);
+  if( rc < 0 )
+    goto unlock_rc;
+
+  can_block = ! ((NI_OPTS(ni).udp_nonblock_no_pkts_mode) &&
+                 ((flags & MSG_DONTWAIT) ||
+                  (us->s.b.sb_aflags &
+                   (CI_SB_AFLAG_O_NONBLOCK | CI_SB_AFLAG_O_NDELAY))));
+  clones[0] = pf.pkt;
+  for( n_built = 1; n_built < n_dests; ++n_built ) {
+    clones[n_built] = ci_udp_fanout_clone(ni, us, &sinf, can_block,
+                                          pf.pkt, af);
+    if( clones[n_built] == NULL ) {
+      /* Out of packet buffers: drop the remaining destinations rather
+       * than unpicking the clones already built. */
+      us->stats.n_tx_fanout_drop += n_dests - n_built;
+      break;
+    }
+  }
+
+  if( n_built > 1 ) {
+    /* Take one payload reference per clone.  The buffers are exclusively
+     * ours until the first send below, so plain increments are safe. */
+    pp = pf.pkt->frag_next;
+    while( OO_PP_NOT_NULL(pp) ) {
+      ci_ip_pkt_fmt* buf = PKT_CHK_NML(ni, pp, sinf.stack_locked);
+      buf->refcount += n_built - 1;
+      pp = buf->frag_next;
+    }
+  }
+
+  for( i = 0; i < n_built; ++i ) {
+    ci_ip_pkt_fmt* pkt = clones[i];
+    TX_PKT_SET_DADDR(af, pkt, daddrs[i]);
+    TX_PKT_IPX_UDP(af, pkt, false)->udp_dest_be16 = dports_be16[i];
+#if CI_CFG_TIMESTAMPING
+    if( us->s.timestamping_flags & ONLOAD_SOF_TIMESTAMPING_OPT_ID ) {
+      pkt->ts_key = us->s.ts_key;
+      ci_atomic32_inc(&us->s.ts_key);
+    }
+#endif
+    if( si_trylock_and_inc(ni, &sinf, us->stats.n_tx_lock_snd) ) {
+      ci_udp_sendmsg_send(ni, us, pkt, flags, &sinf);
+      ci_netif_pkt_release(ni, pkt);
+    }
+    else if( NI_OPTS(ni).udp_tx_staging )
+      ci_udp_sendmsg_stage(ni, us, pkt, flags);
+    else
+      ci_udp_sendmsg_async_q_enqueue(ni, us, pkt, flags);
+  }
+  us->stats.n_tx_fanout += n_built;
+
+  /* prep_send_pkt() subtracts [n_buffers] from [n_async_pkts] for every
+   * clone, but the shared payload buffers were only allocated (and
+   * counted) once; compensate. */
+  if( n_built > 1 && pf.pkt->n_buffers > 1 ) {
+    i = (n_built - 1) * (pf.pkt->n_buffers - 1);
+    while( i-- )
+      CI_NETIF_STATE_MOD(ni, sinf.stack_locked, n_async_pkts, +);
+  }
+
+  if( sinf.stack_locked )
+    ci_netif_unlock(ni);
+  return bytes_to_send;
+
+ unlock_unsupported:
+  rc = -EOPNOTSUPP;
+ unlock_rc:
+  if( sinf.stack_locked )
+    ci_netif_unlock(ni);
+  return rc;
+}
+
+int ci_udp_sendmmsg(ci_udp_iomsg_args* a, struct mmsghdr* mmsg,
+                    unsigned int vlen, int flags)
+{
+  int i, rc;
+
+  if( vlen == 0 )
+    return 0;
+
+  /* Post the whole batch before ringing any doorbell.  Each message still
+   * goes through ci_udp_sendmsg(), so every slow path (unconnected sends,
+   * fragmentation, OS fallback, blocking for sendq space) keeps working;
+   * only the per-message descriptor push is deferred, and
+   * ci_netif_tx_batch_flush() issues one push per interface at the end.
+   * ci_netif_poll_n() flushes early if a message has to block. */
+  if( vlen > 1 ) {
+    ci_tx_batching = 1;
+    ci_tx_batch_ni = a->ni;
+  }
+
+  i = 0;
+  do {
+    rc = ci_udp_sendmsg(a, &mmsg[i].msg_hdr, flags);
+    if(CI_LIKELY( rc >= 0 ))
+      mmsg[i].msg_len = rc;
+    ++i;
+  } while( rc >= 0 && i < vlen );
+
+  if( vlen > 1 ) {
+    ci_tx_batching = 0;
+    if( ci_tx_batch_pending != 0 )
+      ci_netif_tx_batch_flush(a->ni);
+    ci_tx_batch_ni = NULL;
+  }
+  return (rc >= 0) ? i : rc;
+}
+
+#endif  /* ! __KERNEL__ */
+
 #endif
 /*! \cidoxg_end */
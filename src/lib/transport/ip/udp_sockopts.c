@@ -208,7 +208,82 @@ static int ci_mcast_join_leave(ci_netif* ni, ci_udp_state* us,
 }
 
 
-ci_inline int __get_socket_opt(citp_socket* ep, ci_fd_t sock, int level, 
+/* Join an array of multicast groups on one interface, programming the
+ * hardware filters in batches rather than one ioctl per group.  Joins
+ * the groups on the OS socket first so that IGMP membership is
+ * reported, and drops OS membership again for any group that cannot be
+ * accelerated.  Returns the number of groups joined (groups beyond
+ * that are not joined at all), or negative error if none could be.
+ */
+int ci_udp_mcast_join_batch(citp_socket* ep, ci_fd_t fd, ci_ifid_t ifindex,
+                            const ci_uint32* maddrs, int count)
+{
+  ci_netif* ni = ep->netif;
+  ci_udp_state* us = SOCK_TO_UDP(ep->s);
+  cicp_hwport_mask_t hwports = 0;
+  struct ip_mreqn mreqn;
+  ci_fd_t os_sock;
+  int i, j, n, rc;
+
+  if( ifindex == 0 || count <= 0 )
+    return -EINVAL;
+
+  us->udpflags |= CI_UDPF_MCAST_JOIN;
+
+  /* Unlike the setsockopt() path there is no OS socket to hand this
+   * socket over to: un-accelerated configurations get an error.
+   */
+  if( NI_OPTS(ni).mcast_join_handover == 2 || ! NI_OPTS(ni).mcast_recv )
+    return -EOPNOTSUPP;
+
+  rc = oo_cp_find_llap(ni->cplane, ifindex, NULL, NULL, &hwports, NULL,
+                       NULL);
+  if( rc != 0 || hwports == 0 )
+    return -EADDRNOTAVAIL;
+
+  os_sock = ci_get_os_sock_fd(fd);
+  if( ! CI_IS_VALID_SOCKET(os_sock) )
+    return -EINVAL;
+
+  memset(&mreqn, 0, sizeof(mreqn));
+  mreqn.imr_ifindex = ifindex;
+  for( i = 0; i < count; ++i ) {
+    mreqn.imr_multiaddr.s_addr = maddrs[i];
+    if( ci_sys_setsockopt(os_sock, SOL_IP, IP_ADD_MEMBERSHIP,
+                          &mreqn, sizeof(mreqn)) != 0 )
+      break;
+  }
+  rc = i > 0 ? 0 : -errno;
+
+  n = 0;
+  if( i > 0 ) {
+    n = ci_tcp_helper_ep_mcast_add_batch(ci_netif_get_driver_handle(ni),
+                                         S_SP(us), ifindex, maddrs, i);
+    if( n < 0 ) {
+      rc = n;
+      n = 0;
+    }
+  }
+
+  /* Roll back the OS joins for groups we did not accelerate. */
+  for( j = n; j < i; ++j ) {
+    mreqn.imr_multiaddr.s_addr = maddrs[j];
+    ci_sys_setsockopt(os_sock, SOL_IP, IP_DROP_MEMBERSHIP,
+                      &mreqn, sizeof(mreqn));
+  }
+  ci_rel_os_sock_fd(os_sock);
+
+  if( n > 0 ) {
+    us->udpflags |= CI_UDPF_MCAST_FILTER;
+    LOG_UC(log(FNS_FMT "joined %d/%d groups on ifindex=%d",
+               FNS_PRI_ARGS(ni, &us->s), n, count, (int) ifindex));
+    return n;
+  }
+  return rc;
+}
+
+
+ci_inline int __get_socket_opt(citp_socket* ep, ci_fd_t sock, int level,
                                int name, void* v, socklen_t* len )
 {
   return CI_IS_VALID_SOCKET(sock) ? 
@@ -295,6 +370,10 @@ int ci_udp_getsockopt(citp_socket* ep, ci_fd_t fd, int level,
 #endif
 
   } else if (level == IPPROTO_UDP) {
+    if( optname == ONLOAD_UDP_RX_MAILBOXES ) {
+      u = us->n_mailboxes;
+      return ci_getsockopt_final(optval, optlen, SOL_UDP, &u, sizeof(u));
+    }
     /* We definitely don't support this */
     RET_WITH_ERRNO(ENOPROTOOPT);
   } else {
@@ -632,6 +711,26 @@ static int ci_udp_setsockopt_lk(citp_socket* ep, ci_fd_t fd, ci_fd_t os_sock,
 #endif
 
   } else if (level == IPPROTO_UDP) {
+    if( optname == ONLOAD_UDP_RX_MAILBOXES ) {
+      if( (rc = opt_not_ok(optval, optlen, int)) )
+        goto fail_inval;
+      v = *(int*) optval;
+      if( v != 0 && (v < 2 || v > CI_UDP_RX_MAILBOXES_MAX) ) {
+        rc = -EINVAL;
+        goto fail_inval;
+      }
+      /* The queue count may only change while no datagrams are queued and
+       * no reader holds a mailbox claim, else datagrams could be stranded
+       * in a queue the consumers no longer look at. */
+      if( ci_udp_rx_q_any_not_empty(us) ||
+          OO_ACCESS_ONCE(us->mailbox_busy) != 0 ) {
+        rc = -EBUSY;
+        RET_WITH_ERRNO(-rc);
+      }
+      us->n_mailboxes = v;
+      us->mailbox_rr = 0;
+      return 0;
+    }
     RET_WITH_ERRNO(ENOPROTOOPT);
   }
   else {
@@ -24,6 +24,7 @@ void citp_waitable_reinit(ci_netif* ni, citp_waitable* w)
   w->sleep_seq.all = 0;
   w->sigown = 0;
   w->spin_cycles = ni->state->sock_spin_cycles;
+  w->spin_misses = 0;
 }
 
 
@@ -33,6 +34,8 @@ void citp_waitable_init(ci_netif* ni, citp_waitable* w, int id)
 
   w->bufid = OO_SP_FROM_INT(ni, id);
   w->sb_flags = 0;
+  w->futex_word[0] = w->futex_word[1] = 0;
+  w->futex_waiters[0] = w->futex_waiters[1] = 0;
   w->sb_aflags = CI_SB_AFLAG_ORPHAN | CI_SB_AFLAG_NOT_READY;
   w->epoll = OO_PP_NULL;
   w->ready_lists_in_use = 0;
@@ -419,8 +422,11 @@ void citp_waitable_print_to_logger(ci_netif* ni, citp_waitable* w,
       rq = wo->tcp.recv1.num + wo->tcp.recv2.num;
     }
     else if( w->state == CI_TCP_STATE_UDP ) {
+      int q;
       tq = wo->udp.tx_count + oo_atomic_read(&wo->udp.tx_async_q_level);
-      rq = ci_udp_recv_q_pkts(&wo->udp.recv_q);
+      rq = 0;
+      for( q = 0; q < ci_udp_rx_q_count(&wo->udp); ++q )
+        rq += ci_udp_recv_q_pkts(ci_udp_rx_q(&wo->udp, q));
     }
 
     /* For compatibility with netstat, we report pre-DNAT addresses. */
@@ -453,6 +459,13 @@ void citp_waitable_print_to_logger(ci_netif* ni, citp_waitable* w,
 void citp_waitable_wakeup(ci_netif* ni, citp_waitable* w)
 {
   oo_waitable_wake_t op;
+
+  /* Preferred path: enqueue the wake on the slow-path command ring and
+   * avoid a syscall per wakeup.  Fall back to the synchronous ioctl if
+   * the ring is full. */
+  if( ci_netif_slowpath_req(ni, OO_SLOWPATH_WAITABLE_WAKE, w->bufid) == 0 )
+    return;
+
   op.sock_id = w->bufid;
   oo_resource_op(ci_netif_get_driver_handle(ni),
                  OO_IOC_WAITABLE_WAKE, &op);
@@ -1,6 +1,6 @@
 # SPDX-License-Identifier: GPL-2.0
 # X-SPDX-Copyright-Text: (c) Copyright 2002-2019 Xilinx, Inc.
-SUBDIRS	:= ip common unix
+SUBDIRS	:= ip common direct unix
 DRIVER_SUBDIRS := ip
 
 
@@ -238,6 +238,18 @@ static int citp_closedfd_zc_recv_filter(citp_fdinfo* fdi,
 #endif
 }
 
+static int
+citp_closedfd_zc_recv_filter_chain(citp_fdinfo* fdi,
+                                   const struct onload_zc_recv_filter_rule*
+                                   rules, int rules_len, int flags)
+{
+#if CI_CFG_ZC_RECV_FILTER
+  return -EBADF;
+#else
+  return -ENOSYS;
+#endif
+}
+
 
 #if CI_CFG_FD_CACHING
 static int citp_closedfd_cache(citp_fdinfo* fdi)
@@ -276,6 +288,7 @@ citp_protocol_impl citp_closed_protocol_impl = {
     .zc_send     = citp_closedfd_zc_send,
     .zc_recv     = citp_closedfd_zc_recv,
     .zc_recv_filter = citp_closedfd_zc_recv_filter,
+    .zc_recv_filter_chain = citp_closedfd_zc_recv_filter_chain,
     .recvmsg_kernel = citp_closedfd_recvmsg_kernel,
 #if CI_CFG_FD_CACHING
     .cache       = citp_closedfd_cache,
@@ -0,0 +1,182 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  onload_cq: batched submission/completion rings (see
+**          onload/extensions.h for the API contract).
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+#include "internal.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <onload/extensions.h>
+
+/* Poison for msghdr fields the callee must not read; see
+ * sockcall_intercept.c */
+#define CI_NOT_NULL     ((void *)-1)
+
+
+/* Pending submissions are kept as a simple FIFO in [pending]; harvest
+ * compacts survivors back to the front, which preserves submission order
+ * and keeps the common all-complete case a straight walk.  The object is
+ * single-threaded by contract, so there is no locking here: the only
+ * synchronization paid is whatever the attempted operations themselves
+ * take, once per harvest rather than once per call.
+ */
+struct onload_cq {
+  unsigned capacity;
+  unsigned n_pending;
+  struct onload_cq_sqe* pending;
+};
+
+
+int onload_cq_create(unsigned sq_entries, struct onload_cq** cq_out)
+{
+  struct onload_cq* cq;
+
+  Log_CALL(ci_log("%s(%u, %p)", __FUNCTION__, sq_entries, cq_out));
+
+  if( sq_entries == 0 || cq_out == NULL )
+    return -EINVAL;
+  if( (cq = malloc(sizeof(*cq))) == NULL )
+    return -ENOMEM;
+  cq->capacity = sq_entries;
+  cq->n_pending = 0;
+  cq->pending = malloc(sq_entries * sizeof(cq->pending[0]));
+  if( cq->pending == NULL ) {
+    free(cq);
+    return -ENOMEM;
+  }
+  *cq_out = cq;
+  return 0;
+}
+
+
+int onload_cq_destroy(struct onload_cq* cq)
+{
+  Log_CALL(ci_log("%s(%p)", __FUNCTION__, cq));
+
+  if( cq == NULL )
+    return -EINVAL;
+  free(cq->pending);
+  free(cq);
+  return 0;
+}
+
+
+int onload_cq_submit(struct onload_cq* cq, const struct onload_cq_sqe* sqes,
+                     int n)
+{
+  int queued;
+
+  Log_CALL(ci_log("%s(%p, %p, %d)", __FUNCTION__, cq, sqes, n));
+
+  if( cq == NULL || (sqes == NULL && n > 0) || n < 0 )
+    return -EINVAL;
+  queued = CI_MIN((unsigned) n, cq->capacity - cq->n_pending);
+  memcpy(cq->pending + cq->n_pending, sqes, queued * sizeof(sqes[0]));
+  cq->n_pending += queued;
+  return queued;
+}
+
+
+/* Attempt one pending operation.  Returns the operation's result in
+ * io_uring style: >= 0 on success, -errno on failure, with -EAGAIN
+ * meaning "not ready, keep pending".
+ */
+static int oo_cq_attempt(struct onload_cq_sqe* sqe,
+                         citp_lib_context_t* lib_context)
+{
+  citp_fdinfo* fdi = citp_fdtable_lookup(sqe->fd);
+  struct msghdr m;
+  struct iovec iov;
+  int rc;
+
+  if( fdi == NULL )
+    return -ESOCKTNOSUPPORT;
+
+  switch( sqe->op ) {
+  case ONLOAD_CQ_OP_SEND:
+  case ONLOAD_CQ_OP_RECV:
+    iov.iov_base = sqe->buf;
+    iov.iov_len = sqe->len;
+    /* See note about convertions in sockcall_intercept.c */
+    CI_DEBUG(m.msg_name = CI_NOT_NULL);
+    m.msg_namelen = 0;
+    m.msg_iov = &iov;
+    m.msg_iovlen = 1;
+    CI_DEBUG(m.msg_control = CI_NOT_NULL);
+    m.msg_controllen = 0;
+    /* msg_flags is output only */
+    if( sqe->op == ONLOAD_CQ_OP_SEND )
+      rc = citp_fdinfo_get_ops(fdi)->send(fdi, &m,
+                                          sqe->flags | MSG_DONTWAIT);
+    else
+      rc = citp_fdinfo_get_ops(fdi)->recv(fdi, &m,
+                                          sqe->flags | MSG_DONTWAIT);
+    break;
+  case ONLOAD_CQ_OP_ACCEPT:
+    /* The listener must be nonblocking per the API contract; there is no
+     * MSG_DONTWAIT equivalent to force it here.
+     */
+    rc = citp_fdinfo_get_ops(fdi)->accept(fdi, NULL, NULL, sqe->flags,
+                                          lib_context);
+    break;
+  default:
+    citp_fdinfo_release_ref(fdi, 0);
+    return -EINVAL;
+  }
+
+  citp_fdinfo_release_ref(fdi, 0);
+  if( rc < 0 )
+    rc = -errno;
+  return rc;
+}
+
+
+int onload_cq_harvest(struct onload_cq* cq, struct onload_cq_cqe* cqes,
+                      int max)
+{
+  citp_lib_context_t lib_context;
+  unsigned i, kept = 0;
+  int out = 0;
+
+  Log_CALL(ci_log("%s(%p, %p, %d)", __FUNCTION__, cq, cqes, max));
+
+  if( cq == NULL || (cqes == NULL && max > 0) || max < 0 )
+    return -EINVAL;
+
+  citp_enter_lib(&lib_context);
+
+  for( i = 0; i < cq->n_pending; ++i ) {
+    struct onload_cq_sqe* sqe = &cq->pending[i];
+    int res = -EAGAIN;
+
+    if( out < max )
+      res = oo_cq_attempt(sqe, &lib_context);
+    if( res == -EAGAIN ) {
+      /* Not ready (or no completion space): keep for the next harvest. */
+      if( kept != i )
+        cq->pending[kept] = *sqe;
+      ++kept;
+    }
+    else {
+      cqes[out].user_data = sqe->user_data;
+      cqes[out].res = res;
+      cqes[out].flags = 0;
+      ++out;
+    }
+  }
+  cq->n_pending = kept;
+
+  citp_exit_lib(&lib_context, TRUE);
+
+  Log_CALL_RESULT(out);
+  return out;
+}
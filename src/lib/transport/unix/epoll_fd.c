@@ -270,6 +270,96 @@ static void citp_epoll_sb_state_set(struct citp_epoll_member* eitem,
 }
 
 
+/* Attach a non-home member to a ready list in its own stack, so that its
+ * readiness edges are aggregated through that stack's ready ring
+ * (EF_EPOLL_MULTI_STACK).  The member stays on oo_sockets and in the
+ * kernel epoll set, so blocking behaviour is unchanged; only the spin
+ * loop consumes the attachment.
+ *
+ * This is best effort: if the stack table or its ready lists are
+ * exhausted the member is simply polled linearly as before.
+ */
+static void citp_epoll_attach_secondary(struct citp_epoll_fd* ep,
+                                        struct citp_epoll_member* eitem,
+                                        citp_socket* sock)
+{
+  ci_netif* ni = sock->netif;
+  ci_sb_epoll_state* epoll;
+  struct oo_p_dllink_state link;
+  int i, rl;
+
+  for( i = 0; i < ep->n_sec_stacks; ++i )
+    if( ep->sec_stack[i] == ni )
+      break;
+  if( i == ep->n_sec_stacks ) {
+    if( i == CITP_EPOLL_MAX_SEC_STACKS )
+      return;
+    rl = ci_netif_get_ready_list(ni);
+    if( rl < 0 )
+      return;
+    citp_netif_add_ref(ni);
+    ep->sec_stack[i] = ni;
+    ep->sec_ready_list[i] = rl;
+    ep->n_sec_stacks = i + 1;
+    Log_POLL(ci_log("%s: attach stack %s using ready list %d", __FUNCTION__,
+                    ni->state->pretty_name, rl));
+  }
+  rl = ep->sec_ready_list[i];
+
+  /* This epoll set owns the ready list id, so the bit being set already
+   * means this socket is already attached (eg. re-add). */
+  if( sock->s->b.ready_lists_in_use & (1 << rl) ) {
+    eitem->sec_stack_i = i;
+    return;
+  }
+
+  epoll = ci_ni_aux_p2epoll(ni, sock->s->b.epoll);
+  link = ci_sb_epoll_ready_link(ni, epoll, rl);
+  CI_USER_PTR_SET(epoll->e[rl].eitem, eitem);
+
+  ci_netif_lock(ni);
+  sock->s->b.ready_lists_in_use |= 1 << rl;
+  oo_p_dllink_add_tail(ni,
+                       oo_p_dllink_ptr(ni, &ni->state->unready_lists[rl]),
+                       link);
+  ci_netif_unlock(ni);
+  eitem->sec_stack_i = i;
+}
+
+
+/* Undo citp_epoll_attach_secondary() for one member.  The ready list
+ * itself remains claimed until the epoll set is destroyed. */
+static void citp_epoll_detach_secondary(struct citp_epoll_fd* ep,
+                                        struct citp_epoll_member* eitem,
+                                        citp_socket* sock)
+{
+  ci_netif* ni = sock->netif;
+  int rl = ep->sec_ready_list[(int) eitem->sec_stack_i];
+
+  ci_assert_ge(rl, 0);
+  eitem->sec_stack_i = -1;
+
+  /* The stack clears the shared state itself when the socket is freed, so
+   * it may already be gone. */
+  if( sock->s->b.ready_lists_in_use & (1 << rl) ) {
+    ci_netif_lock(ni);
+    if( sock->s->b.ready_lists_in_use & (1 << rl) ) {
+      ci_sb_epoll_state* epoll = ci_ni_aux_p2epoll(ni, sock->s->b.epoll);
+      struct oo_p_dllink_state link = ci_sb_epoll_ready_link(ni, epoll, rl);
+
+      sock->s->b.ready_lists_in_use &=~ (1 << rl);
+      oo_p_dllink_del(ni, link);
+      oo_p_dllink_init(ni, link);
+      /* Edges for this socket may still be queued in the ring; force the
+       * next drain down the linear-scan path, which resets it. */
+      if( NI_OPTS(ni).epoll_ready_ring )
+        ni->state->ready_rings[rl].overflow = 1;
+    }
+    ci_netif_unlock(ni);
+  }
+}
+
+
 static void
 citp_epoll_promote_to_home(struct citp_epoll_member* eitem, citp_fdinfo* fd_fdi,
                            citp_socket* sock, struct citp_epoll_fd* ep)
@@ -278,6 +368,8 @@ citp_epoll_promote_to_home(struct citp_epoll_member* eitem, citp_fdinfo* fd_fdi,
   /* Sockets from the oo_sockets list are added to the OS epoll set.
    * We'll handle it when deleting them, see citp_epoll_ctl_onload_del().
    */
+  if( eitem->sec_stack_i >= 0 )
+    citp_epoll_detach_secondary(ep, eitem, sock);
   ci_dllist_remove_safe(&eitem->dllink);
   ep->oo_sockets_n--;
   eitem->item_list = &ep->oo_stack_sockets;
@@ -377,6 +469,10 @@ static void citp_remove_home_member(struct citp_epoll_fd* epoll_fd,
       sock->s->b.ready_lists_in_use &=~ (1 << eitem->ready_list_id);
       oo_p_dllink_del(ni, link);
       oo_p_dllink_init(ni, link);
+      /* Edges for this socket may still be queued in the ready ring; force
+       * the next harvest through the locked path, which resets the ring. */
+      if( NI_OPTS(ni).epoll_ready_ring )
+        ni->state->ready_rings[eitem->ready_list_id].overflow = 1;
     }
     ci_netif_unlock(ni);
   }
@@ -486,6 +582,19 @@ static void citp_epoll_dtor(citp_fdinfo* fdi, int fdt_locked)
   ci_assert(ci_dllist_is_empty(&ep->oo_stack_sockets));
   ci_assert(ci_dllist_is_empty(&ep->oo_stack_not_ready_sockets));
   ci_assert(ci_dllist_is_empty(&ep->dead_stack_sockets));
+
+  /* Release any secondary-stack ready lists; this also clears the
+   * per-socket attachment state in the stacks. */
+  {
+    int i;
+    for( i = 0; i < ep->n_sec_stacks; ++i ) {
+      ci_netif_put_ready_list(ep->sec_stack[i], ep->sec_ready_list[i]);
+      citp_netif_release_ref(ep->sec_stack[i], fdt_locked);
+      ep->sec_stack[i] = NULL;
+      ep->sec_ready_list[i] = -1;
+    }
+    ep->n_sec_stacks = 0;
+  }
 #endif
 
   citp_epoll_purge_other_socks(ep);
@@ -563,8 +672,10 @@ citp_protocol_impl citp_epoll_protocol_impl = {
     .zc_send     = citp_nonsock_zc_send,
     .zc_recv     = citp_nonsock_zc_recv,
     .zc_recv_filter = citp_nonsock_zc_recv_filter,
+    .zc_recv_filter_chain = citp_nonsock_zc_recv_filter_chain,
     .recvmsg_kernel = citp_nonsock_recvmsg_kernel,
     .tmpl_alloc     = citp_nonsock_tmpl_alloc,
+    .tmpl_alloc_array = citp_nonsock_tmpl_alloc_array,
     .tmpl_update    = citp_nonsock_tmpl_update,
     .tmpl_abort     = citp_nonsock_tmpl_abort,
 #if CI_CFG_TIMESTAMPING
@@ -636,6 +747,14 @@ int citp_epoll_create(int size, int flags)
   ci_dllist_init(&ep->dead_stack_sockets);
   ep->home_stack = NULL;
   ep->ready_list = -1;
+  {
+    int i;
+    for( i = 0; i < CITP_EPOLL_MAX_SEC_STACKS; ++i ) {
+      ep->sec_stack[i] = NULL;
+      ep->sec_ready_list[i] = -1;
+    }
+  }
+  ep->n_sec_stacks = 0;
 #endif
   ci_dllist_init(&ep->oo_sockets);
   ep->oo_sockets_n = 0;
@@ -651,6 +770,9 @@ int citp_epoll_create(int size, int flags)
   ep->avoid_spin_once = 0;
   ep->closing = 0;
   ep->phase = 0;
+  ep->timer_deadline_frc = 0;
+  ep->timer_interval_frc = 0;
+  ep->timer_data = 0;
   citp_fdtable_insert(fdi, fd, 0);
   Log_POLL(ci_log("%s: fd=%d driver_fd=%d epfd=%d", __FUNCTION__,
                   fd, ep->epfd_os, (int) ep->shared->epfd));
@@ -787,8 +909,11 @@ static void citp_eitem_init(struct citp_epoll_member* eitem,
   eitem->fdi_seq = fd_fdi->seq;
 #if CI_CFG_EPOLL3
   eitem->ready_list_id = -1;
+  eitem->sec_stack_i = -1;
   ci_dllink_self_link(&eitem->dead_stack_link);
 #endif
+  eitem->poll_interval = 1;
+  eitem->poll_countdown = 1;
   eitem->flags = 0;
 }
 
@@ -950,6 +1075,12 @@ static int citp_epoll_ctl_onload_add_new(struct citp_epoll_member** eitem_out,
     citp_epoll_ctl_onload_add_other(*eitem_out, ep, sync_kernel, fd_fdi,
                                     epoll_fd, epoll_fd_seq);
     CITP_STATS_NETIF_INC(ni, epoll_add_non_home);
+#if CI_CFG_EPOLL3
+    if( CITP_OPTS.ul_epoll == 3 && CITP_OPTS.ul_epoll_multi_stack &&
+        NI_OPTS(ni).epoll_ready_ring &&
+        citp_epoll_sb_state_alloc(sock) == 0 )
+      citp_epoll_attach_secondary(ep, *eitem_out, sock);
+#endif
   }
 
   return 0;
@@ -1090,6 +1221,10 @@ static int citp_epoll_ctl_onload_del(struct citp_epoll_member* eitem,
     else
 #endif
     {
+#if CI_CFG_EPOLL3
+      if( eitem->sec_stack_i >= 0 && citp_fdinfo_is_socket(fd_fdi) )
+        citp_epoll_detach_secondary(ep, eitem, fdi_to_socket(fd_fdi));
+#endif
       ci_dllist_remove(&eitem->dllink);
       ep->oo_sockets_n--;
       if( eitem->epfd_event.events == EP_NOT_REGISTERED ) {
@@ -1261,6 +1396,7 @@ citp_epoll_ctl_try_defer_to_lock_holder(struct citp_epoll_fd* ep, int op,
     return 0;
   }
   dec->work.fn = citp_epoll_deferred_do;
+  dec->work.type = OO_WQLOCK_WORK_EPOLL_CTL;
   dec->ep = ep;
   dec->op = op;
   if( event != NULL )  /* NB. We've already checked op... */
@@ -1322,6 +1458,38 @@ static int citp_epoll_ctl_onload(citp_fdinfo* fdi, int op,
 }
 
 
+/* Implementation of onload_epoll_set_priority(): sets how frequently a
+ * member of this epoll set is polled while spinning.  Only non-home
+ * accelerated members are scanned uniformly, so the setting has no effect
+ * on home-stack members (which are ready-list driven) or on kernel fds. */
+int citp_epoll_set_priority(citp_fdinfo* fdi, int fd, int priority)
+{
+  struct citp_epoll_fd* ep = fdi_to_epoll(fdi);
+  struct citp_epoll_member* eitem;
+  citp_fdinfo* fd_fdi;
+  int rc = 0;
+
+  if( priority < 1 || priority > 0xffff )
+    return -EINVAL;
+
+  if( (fd_fdi = citp_fdtable_lookup(fd)) == NULL )
+    return -EBADF;
+
+  CITP_EPOLL_EP_LOCK(ep);
+  if( citp_epoll_find(ep, fd_fdi, &eitem, fdi->fd) < 0 ) {
+    rc = -ENOENT;
+  }
+  else {
+    eitem->poll_interval = priority;
+    /* Poll on the next pass whatever the old countdown was. */
+    eitem->poll_countdown = 1;
+  }
+  CITP_EPOLL_EP_UNLOCK(ep, 0);
+  citp_fdinfo_release_ref(fd_fdi, 0);
+  return rc;
+}
+
+
 static int citp_epoll_ctl_os(citp_fdinfo* fdi, int op, int fd,
                              struct epoll_event *event)
 {
@@ -1374,6 +1542,91 @@ int citp_epoll_ctl(citp_fdinfo* fdi, int op, int fd, struct epoll_event *event)
 }
 
 
+/* Implementation of onload_epoll_ctl_batch(): applies an array of ctl ops
+ * under a single acquisition of the set's lock.  Per-op results go to
+ * ops[i].rc; the return value is the number of ops that succeeded. */
+int citp_epoll_ctl_batch(citp_fdinfo* fdi, struct onload_epoll_ctl_op* ops,
+                         int n_ops)
+{
+  struct citp_epoll_fd* ep = fdi_to_epoll(fdi);
+  struct epoll_event event;
+  citp_fdinfo* fd_fdi;
+  int i, rc, n_ok = 0;
+
+  if( ops == NULL || n_ops <= 0 )
+    return -EINVAL;
+
+  /* Unlike single-op epoll_ctl() we do not hand ops off to a lock-holding
+   * epoll_wait() spinner: the batch caller wants the per-op results, and
+   * holding the lock for the whole batch is the point of the call.  The
+   * spinner drops the lock between passes, so this does not block for
+   * long. */
+  CITP_EPOLL_EP_LOCK(ep);
+
+  for( i = 0; i < n_ops; ++i ) {
+    event.events = ops[i].events;
+    event.data.u64 = ops[i].data;
+    if( (fd_fdi = citp_fdtable_lookup(ops[i].fd)) != NULL ) {
+      if( citp_fdinfo_get_ops(fd_fdi)->epoll != NULL )
+        rc = citp_epoll_ctl_onload2(ep, ops[i].op, &event, fd_fdi,
+                                    fdi->fd, fdi->seq, 0);
+      else
+        rc = citp_epoll_ctl_os(fdi, ops[i].op, ops[i].fd, &event);
+      citp_fdinfo_release_ref(fd_fdi, 0);
+    }
+    else {
+      rc = citp_epoll_ctl_os(fdi, ops[i].op, ops[i].fd, &event);
+    }
+    ops[i].rc = rc == 0 ? 0 : -errno;
+    if( rc == 0 )
+      ++n_ok;
+  }
+
+  CITP_EPOLL_EP_UNLOCK(ep, 0);
+  return n_ok;
+}
+
+
+/* Implementation of onload_epoll_timer_arm(): arms (or re-arms) the set's
+ * user-space timer.  The deadline is kept in frc ticks so epoll_wait()
+ * can check it against the timestamps it already takes on each spin
+ * pass; no timerfd and no syscall are involved. */
+int citp_epoll_timer_arm(citp_fdinfo* fdi, ci_int64 timeout_us,
+                         ci_int64 interval_us, ci_uint64 data)
+{
+  struct citp_epoll_fd* ep = fdi_to_epoll(fdi);
+  ci_uint64 now_frc;
+
+  if( timeout_us <= 0 || interval_us < 0 )
+    return -EINVAL;
+
+  ci_frc64(&now_frc);
+  CITP_EPOLL_EP_LOCK(ep);
+  ep->timer_data = data;
+  ep->timer_interval_frc = oo_epoll_us_to_frc(interval_us);
+  ep->timer_deadline_frc = now_frc + oo_epoll_us_to_frc(timeout_us);
+  /* Zero is the disarmed sentinel; dodge it on the (cosmic) frc wrap. */
+  if( ep->timer_deadline_frc == 0 )
+    ep->timer_deadline_frc = 1;
+  CITP_EPOLL_EP_UNLOCK(ep, 0);
+  return 0;
+}
+
+
+/* Implementation of onload_epoll_timer_cancel(). */
+int citp_epoll_timer_cancel(citp_fdinfo* fdi)
+{
+  struct citp_epoll_fd* ep = fdi_to_epoll(fdi);
+  int was_armed;
+
+  CITP_EPOLL_EP_LOCK(ep);
+  was_armed = ep->timer_deadline_frc != 0;
+  ep->timer_deadline_frc = 0;
+  CITP_EPOLL_EP_UNLOCK(ep, 0);
+  return was_armed ? 0 : -ENOENT;
+}
+
+
 static void citp_ul_epoll_ctl_sync_fd(int epfd, struct citp_epoll_fd* ep,
                                       struct citp_epoll_member* eitem)
 {
@@ -1516,7 +1769,10 @@ static int citp_ul_epoll_one(struct oo_ul_epoll_state*__restrict__ eps,
 #if CI_CFG_EPOLL3
       &&
       ci_dllink_is_self_linked(&eitem->dead_stack_link) &&
-      eitem->ready_list_id < 0
+      eitem->ready_list_id < 0 &&
+      /* A secondary-stack attachment may still reference this eitem from
+       * the shared state until the socket itself is freed. */
+      eitem->sec_stack_i < 0
 #endif
       ) {
     Log_POLL(ci_log("%s: auto remove fd %d from epoll set",
@@ -1532,6 +1788,47 @@ static int citp_ul_epoll_one(struct oo_ul_epoll_state*__restrict__ eps,
 
 
 #if CI_CFG_EPOLL3
+/* Drain readiness edges from the shared ring without taking the stack
+ * lock.  Returns 1 on success, 0 if the ring has overflowed and the
+ * caller must harvest the ready list under the lock instead. */
+static int citp_epoll_drain_ready_ring(struct oo_ul_epoll_state*
+                                       __restrict__ eps)
+{
+  ci_netif* ni = eps->ep->home_stack;
+  struct oo_ready_ring* ring = &ni->state->ready_rings[eps->ep->ready_list];
+  struct citp_epoll_member* eitem = NULL;
+  ci_uint32 wr;
+
+  if( ring->overflow )
+    return 0;
+
+  wr = ring->wr;
+  ci_rmb();
+  while( ring->rd != wr ) {
+    ci_int32 id = ring->sock_id[ring->rd % CI_READY_RING_SIZE];
+    ring->rd = ring->rd + 1;
+    if( (ci_uint32) id < ni->state->n_ep_bufs ) {
+      citp_waitable* w = ID_TO_WAITABLE(ni, id);
+      if( ! OO_PP_IS_NULL(w->epoll) &&
+          (w->ready_lists_in_use & (1 << eps->ep->ready_list)) ) {
+        ci_sb_epoll_state* epoll = ci_ni_aux_p2epoll(ni, w->epoll);
+        eitem = CI_USER_PTR_GET(epoll->e[eps->ep->ready_list].eitem);
+        /* Duplicate edges are possible; moving an eitem that is already
+         * on oo_stack_sockets is harmless. */
+        if( eitem != NULL ) {
+          ci_dllist_remove(&eitem->dllink);
+          eitem->flags &=~ CITP_EITEM_FLAG_POLL_END;
+          ci_dllist_push_tail(&eps->ep->oo_stack_sockets, &eitem->dllink);
+        }
+      }
+    }
+  }
+  if( eitem != NULL )
+    eitem->flags |= CITP_EITEM_FLAG_POLL_END;
+  return 1;
+}
+
+
 static void citp_epoll_get_ready_list(struct oo_ul_epoll_state*
                                       __restrict__ eps)
 {
@@ -1551,6 +1848,12 @@ static void citp_epoll_get_ready_list(struct oo_ul_epoll_state*
     stack_locked = __citp_poll_if_needed(ni, eps->this_poll_frc,
                                          eps->ul_epoll_spin);
 
+  /* With EF_EPOLL_READY_RING we can usually gather ready sockets from the
+   * shared ring without the stack lock. */
+  if( NI_OPTS(ni).epoll_ready_ring && ! stack_locked &&
+      citp_epoll_drain_ready_ring(eps) )
+    return;
+
   if( ! stack_locked )
     ci_netif_lock(ni);
   oo_p_dllink_for_each_safe(ni, lnk, tmp, ready_list) {
@@ -1577,6 +1880,13 @@ static void citp_epoll_get_ready_list(struct oo_ul_epoll_state*
      * other as well as os fds */
     eitem->flags |= CITP_EITEM_FLAG_POLL_END;
   }
+  if( NI_OPTS(ni).epoll_ready_ring ) {
+    /* Everything on the ready list has been harvested, so any edges in
+     * the ring are now stale.  Reset it under the lock. */
+    struct oo_ready_ring* ring = &ni->state->ready_rings[eps->ep->ready_list];
+    ring->rd = ring->wr;
+    ring->overflow = 0;
+  }
   ci_netif_unlock(ni);
 }
 
@@ -1639,6 +1949,68 @@ static void citp_epoll_poll_ul_home_stack(struct oo_ul_epoll_state*
 #endif
 
 
+#if CI_CFG_EPOLL3
+/* Poll each secondary stack and handle members whose readiness edges have
+ * been posted to the per-stack ready rings (EF_EPOLL_MULTI_STACK).  Sets
+ * a bit in [eps->sec_ring_ok] for each ring drained cleanly; members of
+ * those stacks can then be skipped by the linear scan on later spin
+ * passes. */
+static void citp_epoll_poll_secondary_stacks(struct oo_ul_epoll_state*
+                                             __restrict__ eps)
+{
+  struct citp_epoll_fd* ep = eps->ep;
+  int i;
+
+  if( citp_fdtable_not_mt_safe() )
+    CITP_FDTABLE_LOCK_RD();
+
+  for( i = 0; i < ep->n_sec_stacks && eps->events < eps->events_top; ++i ) {
+    ci_netif* ni = ep->sec_stack[i];
+    int rl = ep->sec_ready_list[i];
+    struct oo_ready_ring* ring = &ni->state->ready_rings[rl];
+    ci_uint32 wr;
+
+    /* If we're ordering then a poll to determine the limiting timestamp
+     * has only just been done; see citp_epoll_get_ready_list(). */
+    if( ! eps->ordering_info )
+      citp_poll_if_needed(ni, eps->this_poll_frc, eps->ul_epoll_spin);
+
+    if( ring->overflow ) {
+      /* Too many edges: reset the ring and leave this stack to the
+       * linear scan.  The scan follows the reset, so nothing that is
+       * already ready can be missed. */
+      ring->rd = ring->wr;
+      ring->overflow = 0;
+      continue;
+    }
+
+    wr = ring->wr;
+    ci_rmb();
+    while( ring->rd != wr && eps->events < eps->events_top ) {
+      ci_int32 id = ring->sock_id[ring->rd % CI_READY_RING_SIZE];
+      ring->rd = ring->rd + 1;
+      if( (ci_uint32) id < ni->state->n_ep_bufs ) {
+        citp_waitable* w = ID_TO_WAITABLE(ni, id);
+        if( ! OO_PP_IS_NULL(w->epoll) &&
+            (w->ready_lists_in_use & (1 << rl)) ) {
+          ci_sb_epoll_state* epoll = ci_ni_aux_p2epoll(ni, w->epoll);
+          struct citp_epoll_member* eitem =
+                                        CI_USER_PTR_GET(epoll->e[rl].eitem);
+          if( eitem != NULL )
+            citp_ul_epoll_one(eps, eitem);
+        }
+      }
+    }
+    eps->sec_ring_ok |= 1u << i;
+  }
+
+  if( citp_fdtable_not_mt_safe() )
+    CITP_FDTABLE_UNLOCK_RD();
+  FDTABLE_ASSERT_VALID();
+}
+#endif
+
+
 static void citp_epoll_poll_ul_other(struct oo_ul_epoll_state* __restrict__ eps)
 {
   struct citp_epoll_member* eitem;
@@ -1659,7 +2031,20 @@ static void citp_epoll_poll_ul_other(struct oo_ul_epoll_state* __restrict__ eps)
       if( eitem->flags & CITP_EITEM_FLAG_POLL_END )
         eps->phase |= EPOLL_PHASE_DONE_OTHER;
       next = next->next;
-      citp_ul_epoll_one(eps, eitem);
+      /* Low-priority members are only polled on every Nth spin pass; the
+       * first pass of each call polls everything.  Members attached to a
+       * secondary stack whose ready ring drained cleanly on this pass
+       * have already been handled via the ring. */
+      if( (eitem->poll_interval <= 1 || eps->poll_pass <= 1 ||
+           --eitem->poll_countdown == 0)
+#if CI_CFG_EPOLL3
+          && ! (eitem->sec_stack_i >= 0 && eps->poll_pass > 1 &&
+                (eps->sec_ring_ok & (1u << eitem->sec_stack_i)))
+#endif
+          ) {
+        eitem->poll_countdown = eitem->poll_interval;
+        citp_ul_epoll_one(eps, eitem);
+      }
     } while( eps->events < eps->events_top && &eitem->dllink != last );
 
     if( &eitem->dllink == last )
@@ -1676,10 +2061,17 @@ static void citp_epoll_poll_ul_other(struct oo_ul_epoll_state* __restrict__ eps)
 
 static void citp_epoll_poll_ul(struct oo_ul_epoll_state*__restrict__ eps)
 {
+  ++eps->poll_pass;
+
 #if CI_CFG_EPOLL3
   /* First check any sockets in our home stack */
   if( eps->ep->home_stack )
     citp_epoll_poll_ul_home_stack(eps);
+
+  /* Gather readiness edges from any attached secondary stacks */
+  eps->sec_ring_ok = 0;
+  if( eps->ep->n_sec_stacks != 0 && eps->events < eps->events_top )
+    citp_epoll_poll_secondary_stacks(eps);
 #endif
 
   /* Then check any other accelerated sockets if we still have space */
@@ -1764,6 +2156,43 @@ static ci_uint64 timeout_hr_to_us(ci_int64 hr)
 }
 
 
+/* If the user-space timer is armed and has expired, write its event to
+ * [ev], then step (periodic) or disarm (one-shot) it.  Returns 1 if an
+ * event was written.  Caller holds the ep lock. */
+static int citp_epoll_timer_check(struct citp_epoll_fd* ep, ci_uint64 now_frc,
+                                  struct epoll_event* ev)
+{
+  if( ep->timer_deadline_frc == 0 ||
+      (ci_int64) (now_frc - ep->timer_deadline_frc) < 0 )
+    return 0;
+  ev->events = EPOLLIN;
+  ev->data.u64 = ep->timer_data;
+  if( ep->timer_interval_frc != 0 ) {
+    /* Periodic: step the deadline forward, but do not build up a backlog
+     * of expiries if we were descheduled well past it. */
+    ep->timer_deadline_frc += ep->timer_interval_frc;
+    if( (ci_int64) (now_frc - ep->timer_deadline_frc) >= 0 )
+      ep->timer_deadline_frc = now_frc + ep->timer_interval_frc;
+  }
+  else {
+    ep->timer_deadline_frc = 0;
+  }
+  return 1;
+}
+
+
+/* Clamp a wait timeout so that spinning or blocking returns in time to
+ * service the user-space timer. */
+static ci_int64 citp_epoll_timer_clamp_hr(struct citp_epoll_fd* ep,
+                                          ci_uint64 now_frc,
+                                          ci_int64 timeout_hr)
+{
+  ci_int64 remaining = ep->timer_deadline_frc - now_frc;
+  remaining = CI_MAX(remaining, 0);
+  return CI_MIN(timeout_hr, remaining);
+}
+
+
 /* Synchronise state to kernel if:
    - EF_EPOLL_CTL_FAST=0;
    - or we are going to block (timeout != 0 && rc == 0) */
@@ -1815,6 +2244,14 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
 
   CITP_EPOLL_EP_LOCK(ep);
 
+  /* A user-space timer must cut both the spin budget and any kernel block
+   * short; expiry itself is detected on the poll paths below. */
+  if( ep->timer_deadline_frc != 0 ) {
+    ci_uint64 now_frc;
+    ci_frc64(&now_frc);
+    timeout_hr = citp_epoll_timer_clamp_hr(ep, now_frc, timeout_hr);
+  }
+
   if( ((CITP_OPTS.ul_epoll == 1 || ! ep->not_mt_safe) &&
 #if CI_CFG_EPOLL3
        ci_dllist_is_empty(&ep->oo_stack_sockets) &&
@@ -1843,6 +2280,22 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
       memset(ordering->ordering_info, 0,
             (sizeof(struct citp_ordering_info)) * rc);
 
+    /* The kernel wait was cut short for a user-space timer; deliver its
+     * event if it is now due. */
+    if( rc == 0 && ep->timer_deadline_frc != 0 &&
+        events != NULL && maxevents > 0 ) {
+      ci_uint64 now_frc;
+      ci_frc64(&now_frc);
+      CITP_EPOLL_EP_LOCK(ep);
+      if( citp_epoll_timer_check(ep, now_frc, events) ) {
+        rc = 1;
+        if( ordering )
+          memset(ordering->ordering_info, 0,
+                 sizeof(struct citp_ordering_info));
+      }
+      CITP_EPOLL_EP_UNLOCK(ep, 0);
+    }
+
     ep->blocking = 0;
     return rc;
   }
@@ -1858,6 +2311,10 @@ int citp_epoll_wait(citp_fdinfo* fdi, struct epoll_event*__restrict__ events,
   eps.events_top = events + maxevents;
   eps.ordering_info = ordering ? ordering->ordering_info : NULL;
   eps.has_epollet = 0;
+  eps.poll_pass = 0;
+#if CI_CFG_EPOLL3
+  eps.sec_ring_ok = 0;
+#endif
   eps.phase = ep->phase;
   /* NB. We do need to call oo_per_thread_get() here (despite having
    * [lib_context] in scope) to ensure [spinstate] is initialised.
@@ -2003,6 +2460,12 @@ no_events:
   /* poll OS fds: */
   rc = citp_epoll_os_fds(fdi_to_epoll_fdi(fdi), events,
                          ordering ?  ordering->ordering_info : NULL, maxevents);
+  if( rc == 0 && ep->timer_deadline_frc != 0 &&
+      citp_epoll_timer_check(ep, eps.this_poll_frc, events) ) {
+    rc = 1;
+    if( ordering )
+      memset(ordering->ordering_info, 0, sizeof(struct citp_ordering_info));
+  }
   if( rc != 0 || timeout_hr == 0 ) {
     Log_VPOLL(ci_log("%s(%d): %d kernel events", __FUNCTION__, fdi->fd, rc));
     goto unlock_release_exit_ret;
@@ -2037,6 +2500,18 @@ no_events:
       CITP_EPOLL_EP_LOCK(ep);
     }
 
+    /* User-space timer expiry while spinning?  Deliver its event from
+     * here: no syscall, and the spin streak survives a periodic timer. */
+    if( ep->timer_deadline_frc != 0 &&
+        citp_epoll_timer_check(ep, eps.this_poll_frc, events) ) {
+      Log_VPOLL(ci_log("%s(%d): u/l timer during spin", __FUNCTION__,
+                       fdi->fd));
+      rc = 1;
+      if( ordering )
+        memset(ordering->ordering_info, 0, sizeof(struct citp_ordering_info));
+      goto unlock_release_exit_ret;
+    }
+
     /* Timeout while spinning? */
     if( timeout_hr > 0 &&
         (eps.this_poll_frc - poll_start_frc >= timeout_hr) ) {
@@ -2055,6 +2530,12 @@ no_events:
 
     have_spin = 1;
 
+    /* Yield instead of busy-spinning if this thread is badly placed (SMT
+     * sibling of another spinner, or an efficiency core). */
+    oo_spin_topology_enter(lib_context->thread, eps.this_poll_frc,
+                           citp.cpu_khz);
+    oo_spin_topology_yield(lib_context->thread);
+
     /* When we're WODAing we can't return anything we find with later polls,
      * so we don't poll on individual sockets.  However, we do need to ensure
      * that the stack continues to be polled, so if we've looked at everything
@@ -2192,6 +2673,25 @@ no_events:
     }
   }
 
+  /* The kernel block was cut short for a user-space timer; deliver its
+   * event if it is now due. */
+  if( rc == 0 && ep->timer_deadline_frc != 0 ) {
+    ci_uint64 now_frc;
+    ci_frc64(&now_frc);
+    if( ordering ) {
+      /* Leave the timer armed and just flag an event: the re-poll that
+       * ordered waits make on rc != 0 delivers it with the set locked. */
+      if( (ci_int64) (now_frc - ep->timer_deadline_frc) >= 0 )
+        rc = 1;
+    }
+    else {
+      CITP_EPOLL_EP_LOCK(ep);
+      if( citp_epoll_timer_check(ep, now_frc, events) )
+        rc = 1;
+      CITP_EPOLL_EP_UNLOCK(ep, 0);
+    }
+  }
+
   if( rc && ordering ) {
     ordering->poll_again = 1;
     citp_epoll_find_timeout(&timeout_hr, &poll_start_frc);
@@ -2386,6 +2886,7 @@ static void __citp_epoll_on_smth(citp_fdinfo* epoll_fdi, citp_fdinfo* fd_fdi,
     return;
   }
   deh->work.fn = citp_epoll_on_handover_work;
+  deh->work.type = OO_WQLOCK_WORK_EPOLL_HANDOVER;
   deh->epoll_fdi = epoll_fdi;
   deh->fd_fdi = fd_fdi;
   deh->new_fdi = new_fdi;
@@ -523,6 +523,9 @@ int citp_fdtable_ctor()
     return -1;
   }
 
+  /* Failure just leaves EF_FDTABLE_RCU inactive; not fatal. */
+  citp_fdtable_rcu_ctor();
+
   rc = patch_libc_close_nocancel();
   if( rc < 0 ) {
     Log_E(log("%s: Didn't intercept libc internal close %d", __FUNCTION__, rc));
@@ -709,6 +712,8 @@ citp_fdtable_probe_restore(int fd, ci_ep_info_t * info, int print_banner,
 
     sock_fdi->sock.s = SP_TO_SOCK_CMN(ni, info->sock_id);
     sock_fdi->sock.netif = ni;
+    sock_fdi->udp_dests = NULL;
+    sock_fdi->udp_dests_n = 0;
   }
   else if( info->fd_flags & OO_FDFLAG_EP_PASSTHROUGH ) {
     citp_waitable* w = SP_TO_WAITABLE(ni, info->sock_id);
@@ -750,6 +755,8 @@ citp_fdtable_probe_restore(int fd, ci_ep_info_t * info, int print_banner,
     }
     sock_fdi->sock.s = SP_TO_SOCK_CMN(alien_ni, w->moved_to_sock_id);
     sock_fdi->sock.netif = alien_ni;
+    sock_fdi->udp_dests = NULL;
+    sock_fdi->udp_dests_n = 0;
     citp_netif_release_ref(ni, 1);
 
     /* Replace the file under this fd if possible */
@@ -985,6 +992,15 @@ citp_fdtable_lookup(unsigned fd)
 
     if( fdip_is_normal(fdip) ) {
       if( citp_fdtable_not_mt_safe() ) {
+        if( citp_fdtable_rcu_active ) {
+          fdi = citp_fdtable_rcu_acquire(p_fdip, fdip);
+          if(CI_LIKELY( fdi != NULL )) {
+            if( ! citp_fdinfo_is_consistent(fdi) )
+              fdi = citp_reprobe_moved(fdi, CI_FALSE, CI_FALSE);
+            return fdi;
+          }
+          /* Entry changed underfoot: fall back to the busy marker. */
+        }
 	if( fdip_cas_succeed(p_fdip, fdip, fdip_busy) ) {
 	  fdi = fdip_to_fdi(fdip);
 	  ci_assert(fdi);
@@ -1091,6 +1107,15 @@ citp_fdtable_lookup_fast(citp_lib_context_t* ctx, unsigned fd)
 	return fdi;
       }
       else {
+        if( citp_fdtable_rcu_active ) {
+          fdi = citp_fdtable_rcu_acquire(p_fdip, fdip);
+          if(CI_LIKELY( fdi != NULL )) {
+            if(CI_UNLIKELY( ! citp_fdinfo_is_consistent(fdi) ))
+              fdi = citp_reprobe_moved(fdi, CI_FALSE, CI_FALSE);
+            return fdi;
+          }
+          /* Entry changed underfoot: fall back to the busy marker. */
+        }
         /* Swap in the busy marker. */
 	if( fdip_cas_succeed(p_fdip, fdip, fdip_busy) ) {
 	  fdi = fdip_to_fdi(fdip);
@@ -0,0 +1,307 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  Deferred reclamation for lockless fdtable lookup.
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/*! \cidoxg_lib_transport_unix */
+
+#include "internal.h"
+#include <ci/internal/syscall.h>
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+
+/* The read side lives in internal.h (citp_fdtable_rcu_acquire) and uses
+ * only compiler barriers: a per-thread counter is made odd for the few
+ * instructions between loading a table entry and taking a reference on
+ * the fdinfo it points at.  This file supplies the write side: fdinfo
+ * memory whose refcount has reached zero is not returned to the
+ * allocator until no reader can still be dereferencing a stale pointer
+ * to it.
+ *
+ * To observe the reader counters safely without fencing the read side we
+ * use membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED), which IPIs every
+ * running thread of the process and so acts as a full barrier on each of
+ * them.  After the membarrier, any reader whose counter we observe as
+ * even is guaranteed not to hold a pointer loaded before the fdinfo was
+ * unhooked from the table; readers observed odd are snapshotted and the
+ * free is deferred until their counter moves on.
+ *
+ * Read-side sections never span a system call, so grace periods are
+ * bounded by a handful of instructions and in practice almost every
+ * deferred free completes on the spot.
+ */
+
+#ifndef MEMBARRIER_CMD_PRIVATE_EXPEDITED
+# define MEMBARRIER_CMD_PRIVATE_EXPEDITED           (1 << 3)
+#endif
+#ifndef MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED
+# define MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED  (1 << 4)
+#endif
+
+
+int citp_fdtable_rcu_active;
+
+/* Protects the reader list and the pending-free list. */
+static pthread_mutex_t rcu_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct citp_fdtable_rcu_reader* rcu_readers;
+static pthread_key_t rcu_key;
+
+struct rcu_reader_snap {
+  struct citp_fdtable_rcu_reader* rd;
+  ci_uint32                       ctr;
+};
+
+/* An fdinfo whose free is deferred, together with the set of readers
+ * that were inside a read-side section when it was retired. */
+struct rcu_pending_free {
+  struct rcu_pending_free* next;
+  citp_fdinfo*             fdi;
+  int                      n_snaps;
+  struct rcu_reader_snap   snaps[1];  /* [n_snaps] entries really */
+};
+
+static struct rcu_pending_free* rcu_pending;
+
+
+static int rcu_membarrier(int cmd)
+{
+#ifdef __NR_membarrier
+  return my_syscall3(membarrier, cmd, 0, 0);
+#else
+  errno = ENOSYS;
+  return -1;
+#endif
+}
+
+
+static void rcu_key_destructor(void* arg)
+{
+  struct citp_fdtable_rcu_reader* rd = arg;
+  /* The thread is exiting, so it cannot be inside a read-side section.
+   * The node may still be referenced by pending snapshots, so just mark
+   * it; it is unlinked and freed by rcu_reclaim() once nothing pends. */
+  pthread_mutex_lock(&rcu_lock);
+  ci_assert_equal(rd->ctr & 1, 0);
+  rd->dead = 1;
+  pthread_mutex_unlock(&rcu_lock);
+}
+
+
+int citp_fdtable_rcu_ctor(void)
+{
+  int rc;
+
+  if( ! CITP_OPTS.fdtable_rcu )
+    return 0;
+  if( CITP_OPTS.fds_mt_safe ) {
+    /* The MT-safe lookup path takes no references; nothing to win. */
+    Log_S(ci_log("EF_FDTABLE_RCU ignored: EF_FDS_MT_SAFE=1"));
+    return 0;
+  }
+
+  rc = rcu_membarrier(MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED);
+  if( rc != 0 ) {
+    Log_S(ci_log("EF_FDTABLE_RCU disabled: membarrier() not supported "
+                 "(errno=%d)", errno));
+    return -errno;
+  }
+
+  rc = pthread_key_create(&rcu_key, rcu_key_destructor);
+  if( rc != 0 ) {
+    Log_E(ci_log("%s: pthread_key_create %d", __FUNCTION__, rc));
+    return -rc;
+  }
+
+  citp_fdtable_rcu_active = 1;
+  return 0;
+}
+
+
+struct citp_fdtable_rcu_reader* citp_fdtable_rcu_register(void)
+{
+  struct citp_fdtable_rcu_reader* rd;
+
+  if( ! citp_fdtable_rcu_active )
+    return NULL;
+
+  rd = malloc(sizeof(*rd));
+  if( rd == NULL )
+    return NULL;
+  rd->ctr = 0;
+  rd->dead = 0;
+
+  pthread_mutex_lock(&rcu_lock);
+  rd->next = rcu_readers;
+  rcu_readers = rd;
+  pthread_mutex_unlock(&rcu_lock);
+
+  pthread_setspecific(rcu_key, rd);
+  return rd;
+}
+
+
+/* True if every reader snapshotted when [p] was retired has since left
+ * its read-side section (or exited). */
+static int rcu_pending_is_quiescent(const struct rcu_pending_free* p)
+{
+  int i;
+  for( i = 0; i < p->n_snaps; ++i )
+    if( p->snaps[i].rd->ctr == p->snaps[i].ctr && ! p->snaps[i].rd->dead )
+      return 0;
+  return 1;
+}
+
+
+/* Free any pending fdinfos whose grace period has elapsed, and reap dead
+ * reader nodes once nothing references them.  Called with rcu_lock held. */
+static void rcu_reclaim(void)
+{
+  struct rcu_pending_free** pp = &rcu_pending;
+  struct citp_fdtable_rcu_reader** prd;
+
+  while( *pp != NULL ) {
+    struct rcu_pending_free* p = *pp;
+    if( rcu_pending_is_quiescent(p) ) {
+      *pp = p->next;
+      CI_FREE_OBJ(p->fdi);
+      free(p);
+    }
+    else {
+      pp = &p->next;
+    }
+  }
+
+  if( rcu_pending != NULL )
+    return;
+  prd = &rcu_readers;
+  while( *prd != NULL ) {
+    struct citp_fdtable_rcu_reader* rd = *prd;
+    if( rd->dead ) {
+      *prd = rd->next;
+      free(rd);
+    }
+    else {
+      prd = &rd->next;
+    }
+  }
+}
+
+
+void citp_fdtable_rcu_defer_free(citp_fdinfo* fdi)
+{
+  struct citp_fdtable_rcu_reader* rd;
+  struct citp_fdtable_rcu_reader* self = __oo_per_thread_get()->fdtable_rcu;
+  struct rcu_pending_free* p;
+  int n_readers;
+
+  pthread_mutex_lock(&rcu_lock);
+
+  if( ! ci_is_multithreaded() ) {
+    /* No concurrent readers are possible; everything is quiescent. */
+    for( p = rcu_pending; p != NULL; ) {
+      struct rcu_pending_free* next = p->next;
+      CI_FREE_OBJ(p->fdi);
+      free(p);
+      p = next;
+    }
+    rcu_pending = NULL;
+    rcu_reclaim();
+    CI_FREE_OBJ(fdi);
+    pthread_mutex_unlock(&rcu_lock);
+    return;
+  }
+
+  /* Make every thread's read-side counter updates visible before we
+   * sample them.  This is the fence the read side omits. */
+  rcu_membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED);
+
+  n_readers = 0;
+  for( rd = rcu_readers; rd != NULL; rd = rd->next )
+    ++n_readers;
+
+  p = n_readers ? malloc(sizeof(*p) + (n_readers - 1) * sizeof(p->snaps[0]))
+                : NULL;
+  if( p != NULL ) {
+    /* Snapshot every reader currently inside a section.  Sections that
+     * began after the membarrier cannot hold a stale pointer to [fdi]
+     * (its table entry was replaced before the refcount could reach
+     * zero), so over-sampling here is merely conservative. */
+    p->fdi = fdi;
+    p->n_snaps = 0;
+    for( rd = rcu_readers; rd != NULL; rd = rd->next ) {
+      ci_uint32 ctr = rd->ctr;
+      if( rd != self && ! rd->dead && (ctr & 1) ) {
+        p->snaps[p->n_snaps].rd = rd;
+        p->snaps[p->n_snaps].ctr = ctr;
+        ++p->n_snaps;
+      }
+    }
+    if( p->n_snaps == 0 ) {
+      free(p);
+      CI_FREE_OBJ(fdi);
+    }
+    else {
+      p->next = rcu_pending;
+      rcu_pending = p;
+    }
+  }
+  else {
+    /* Can't defer; waiting is the only safe fallback.  Grace periods
+     * are tiny, so this cannot spin for long. */
+    for( rd = rcu_readers; rd != NULL; rd = rd->next ) {
+      ci_uint32 ctr = rd->ctr;
+      if( rd == self || ! (ctr & 1) )
+        continue;
+      while( rd->ctr == ctr && ! rd->dead )
+        ci_spinloop_pause();
+    }
+    CI_FREE_OBJ(fdi);
+  }
+
+  rcu_reclaim();
+  pthread_mutex_unlock(&rcu_lock);
+}
+
+
+/* Fork hook: the child is single-threaded, so all grace periods have
+ * trivially elapsed and other threads' reader nodes are garbage. */
+void citp_fdtable_rcu_fork_child(void)
+{
+  struct citp_fdtable_rcu_reader* self;
+  struct rcu_pending_free* p;
+
+  if( ! citp_fdtable_rcu_active )
+    return;
+
+  pthread_mutex_init(&rcu_lock, NULL);
+
+  for( p = rcu_pending; p != NULL; ) {
+    struct rcu_pending_free* next = p->next;
+    CI_FREE_OBJ(p->fdi);
+    free(p);
+    p = next;
+  }
+  rcu_pending = NULL;
+
+  self = __oo_per_thread_get()->fdtable_rcu;
+  while( rcu_readers != NULL ) {
+    struct citp_fdtable_rcu_reader* rd = rcu_readers;
+    rcu_readers = rd->next;
+    if( rd == self ) {
+      rd->next = NULL;
+      continue;
+    }
+    free(rd);
+  }
+  if( self != NULL ) {
+    rcu_readers = self;
+    ci_assert_equal(self->ctr & 1, 0);
+  }
+}
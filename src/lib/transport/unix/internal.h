@@ -38,6 +38,7 @@
 #include <sys/uio.h>
 #include <pthread.h>
 
+#include <onload/extensions.h>
 #include <onload/extensions_zc.h>
 #include <ci/internal/efabcfg.h>
 
@@ -175,9 +176,14 @@ typedef struct {
   int  (*zc_recv     )(citp_fdinfo*, struct onload_zc_recv_args*);
   int  (*zc_recv_filter)(citp_fdinfo*, onload_zc_recv_filter_callback,
                          void*, int);
+  int  (*zc_recv_filter_chain)(citp_fdinfo*,
+                               const struct onload_zc_recv_filter_rule*,
+                               int, int);
   int  (*recvmsg_kernel)(citp_fdinfo*, struct msghdr*, int);
   int  (*tmpl_alloc)(citp_fdinfo*, const struct iovec*, int,
                      struct oo_msg_template**, unsigned);
+  int  (*tmpl_alloc_array)(citp_fdinfo*, const struct onload_template_msg*,
+                           int, struct oo_msg_template**, unsigned);
   int  (*tmpl_update)(citp_fdinfo*, struct oo_msg_template*,
                       const struct onload_template_msg_update_iovec*, int,
                       unsigned);
@@ -199,7 +205,16 @@ typedef struct {
                         struct onload_delegated_send* out);
   int  (*dsend_complete)(citp_fdinfo*, const ci_iovec *iov, int iovlen,
                          int flags);
+  int  (*dsend_complete_zc)(citp_fdinfo*, const struct onload_zc_iovec* iov,
+                            int iovlen, int flags);
   int  (*dsend_cancel)(citp_fdinfo*);
+  int  (*udp_dest_register)(citp_fdinfo*, const struct sockaddr* addr,
+                            socklen_t addrlen);
+  int  (*udp_send_batch)(citp_fdinfo*,
+                         struct onload_udp_send_batch_entry* entries,
+                         int n, int flags);
+  int  (*udp_fanout_send)(citp_fdinfo*, const struct iovec* iov, int iovlen,
+                          const int* dests, int n_dests, int flags);
 } citp_fdops;
 
 
@@ -409,8 +424,62 @@ ci_inline void citp_fdinfo_ref_fast(citp_fdinfo* fdinfo) {
     citp_fdinfo_ref(fdinfo);
 }
 
+/**********************************************************************
+ ** RCU-style lockless fdtable lookup (EF_FDTABLE_RCU).
+ **
+ ** Readers take a reference optimistically inside a short read-side
+ ** section delimited by a per-thread counter, instead of locking the
+ ** table entry with the busy marker.  To make that safe, fdinfo memory
+ ** is not returned to the allocator until a grace period has elapsed:
+ ** the reclaimer forces ordering with membarrier() and then waits for
+ ** every reader that was inside a section to leave it.
+ */
+
+struct citp_fdtable_rcu_reader {
+  /* Odd while the owning thread is inside a read-side section. */
+  volatile ci_uint32 ctr;
+  /* Set (by the pthread key destructor) when the owning thread exits. */
+  ci_uint32          dead;
+  struct citp_fdtable_rcu_reader* next;
+};
+
+/* Non-zero once EF_FDTABLE_RCU is enabled and membarrier() is usable. */
+extern int citp_fdtable_rcu_active CI_HV;
+
+extern int citp_fdtable_rcu_ctor(void) CI_HF;
+extern struct citp_fdtable_rcu_reader* citp_fdtable_rcu_register(void) CI_HF;
+extern void citp_fdtable_rcu_defer_free(citp_fdinfo*) CI_HF;
+extern void citp_fdtable_rcu_fork_child(void) CI_HF;
+
+ci_inline struct citp_fdtable_rcu_reader* citp_fdtable_rcu_reader_get(void) {
+  struct oo_per_thread* pt = __oo_per_thread_get();
+  if(CI_UNLIKELY( pt->fdtable_rcu == NULL ))
+    pt->fdtable_rcu = citp_fdtable_rcu_register();
+  return pt->fdtable_rcu;
+}
+
+/*! Take a reference iff the count is not already zero.  A zero count
+** means the ref-count-zero actions have run (or are running), so the
+** fdinfo must not be resurrected. */
+ci_inline int citp_fdinfo_ref_not_zero(citp_fdinfo* fdi) {
+  ci_uint32 n;
+  do {
+    n = fdi->ref_count.n;
+    if( n == 0 )
+      return 0;
+  } while( ci_cas32u_fail(&fdi->ref_count.n, n, n + 1) );
+  if( ci_is_multithreaded() )
+    fdi->thread_id = pthread_self();
+  return 1;
+}
+
 /* Called when refcount reaches zero. */
-# define citp_fdinfo_free	CI_FREE_OBJ
+ci_inline void citp_fdinfo_free(citp_fdinfo* fdi) {
+  if( citp_fdtable_rcu_active )
+    citp_fdtable_rcu_defer_free(fdi);
+  else
+    CI_FREE_OBJ(fdi);
+}
 
 
 /* Hands-over the socket to the kernel.  That is, it replaces the
@@ -446,6 +515,16 @@ extern int citp_ep_dup3(unsigned oldfd, unsigned newfd, int flags) CI_HF;
 extern int citp_ep_close(unsigned fd) CI_HF;
 
 
+/**********************************************************************
+ ** TCP connection pre-warming (EF_TCP_PREWARM; tcp_prewarm.c).
+ */
+extern int citp_tcp_prewarm_enabled CI_HV;
+extern void citp_tcp_prewarm_poke(citp_lib_context_t* lib_context) CI_HF;
+extern int citp_tcp_prewarm_handoff(citp_fdinfo* fdinfo,
+                                    const struct sockaddr* sa,
+                                    socklen_t sa_len) CI_HF;
+
+
 /**********************************************************************
  ** exec() support
  */
@@ -467,9 +546,55 @@ extern citp_protocol_impl citp_pipe_write_protocol_impl CI_HV;
 extern citp_protocol_impl citp_passthrough_protocol_impl;
 
 
+/* Dispatch helpers for the hot data ops.  With CI_CFG_STATIC_INTERCEPT the
+ * protocol is resolved by comparing the impl pointer and the TCP/UDP
+ * implementation is called directly, replacing the dependent indirect call
+ * through the ops table with a predictable compare-and-branch.  Other fd
+ * types (pipes, epoll, passthrough) keep the vtable path. */
+#if CI_CFG_STATIC_INTERCEPT
+
+extern int citp_tcp_recv(citp_fdinfo*, struct msghdr*, int flags) CI_HF;
+extern int citp_tcp_send(citp_fdinfo*, const struct msghdr*, int flags) CI_HF;
+extern int citp_udp_recv(citp_fdinfo*, struct msghdr*, int flags) CI_HF;
+extern int citp_udp_send(citp_fdinfo*, const struct msghdr*, int flags) CI_HF;
+
+ci_inline int citp_fdinfo_recv(citp_fdinfo* fdi, struct msghdr* msg,
+                               int flags)
+{
+  if(CI_LIKELY( fdi->protocol == &citp_tcp_protocol_impl ))
+    return citp_tcp_recv(fdi, msg, flags);
+  if( fdi->protocol == &citp_udp_protocol_impl )
+    return citp_udp_recv(fdi, msg, flags);
+  return citp_fdinfo_get_ops(fdi)->recv(fdi, msg, flags);
+}
+
+ci_inline int citp_fdinfo_send(citp_fdinfo* fdi, const struct msghdr* msg,
+                               int flags)
+{
+  if(CI_LIKELY( fdi->protocol == &citp_tcp_protocol_impl ))
+    return citp_tcp_send(fdi, msg, flags);
+  if( fdi->protocol == &citp_udp_protocol_impl )
+    return citp_udp_send(fdi, msg, flags);
+  return citp_fdinfo_get_ops(fdi)->send(fdi, msg, flags);
+}
+
+#else
+
+#define citp_fdinfo_recv(fdi, msg, flags)  \
+  (citp_fdinfo_get_ops(fdi)->recv((fdi), (msg), (flags)))
+#define citp_fdinfo_send(fdi, msg, flags)  \
+  (citp_fdinfo_get_ops(fdi)->send((fdi), (msg), (flags)))
+
+#endif
+
+
 typedef struct {
   citp_fdinfo  fdinfo;
   citp_socket  sock;
+  /* Destination slots for onload_udp_send_batch(); UDP only, allocated on
+   * first registration.  See udp_fd.c. */
+  struct citp_udp_dest* udp_dests;
+  int          udp_dests_n;
 } citp_sock_fdi;
 
 #define fdi_to_sock_fdi(fdi)    CI_CONTAINER(citp_sock_fdi, fdinfo, (fdi))
@@ -634,6 +759,49 @@ ci_inline void citp_fdtable_busy_clear(unsigned fd, citp_fdinfo_p fdip,
 extern citp_fdinfo_p citp_fdtable_busy_wait(unsigned fd, int fdt_locked) CI_HF;
 
 
+/*! Attempt to take a reference on [fdip]'s fdinfo without locking the
+** table entry with the busy marker.  [fdip] is the caller's (possibly
+** stale) reading of [*p_fdip], and must be normal.  Returns the fdinfo
+** with a reference taken, or NULL if the entry changed underfoot, in
+** which case the caller should fall back to the busy-marker protocol.
+**
+** Only compiler barriers are used on the read side; the hardware
+** ordering needed to make the read-side counter trustworthy is supplied
+** by the reclaimer via membarrier() (see fdtable_rcu.c).  The reference
+** count update is a locked operation, so the subsequent re-validation
+** load cannot be reordered before it.
+*/
+ci_inline citp_fdinfo* citp_fdtable_rcu_acquire(volatile citp_fdinfo_p* p_fdip,
+                                                citp_fdinfo_p fdip) {
+  struct citp_fdtable_rcu_reader* rd = citp_fdtable_rcu_reader_get();
+  citp_fdinfo* fdi = NULL;
+
+  if(CI_UNLIKELY( rd == NULL ))
+    return NULL;
+
+  ++rd->ctr;              /* odd: inside read-side section */
+  ci_compiler_barrier();
+  /* Re-read the entry inside the section: the caller's value may predate
+   * it, and only pointers loaded inside the section are protected. */
+  if(CI_LIKELY( *p_fdip == fdip )) {
+    fdi = fdip_to_fdi(fdip);
+    if( ! citp_fdinfo_ref_not_zero(fdi) )
+      fdi = NULL;
+  }
+  ci_compiler_barrier();
+  ++rd->ctr;              /* even: quiescent */
+
+  if( fdi == NULL )
+    return NULL;
+  /* With the reference held the fdinfo cannot be freed, but it may no
+   * longer be what [p_fdip] maps to; re-validate. */
+  if(CI_LIKELY( *p_fdip == fdip ))
+    return fdi;
+  citp_fdinfo_release_ref(fdi, 0);
+  return NULL;
+}
+
+
 
 
 /**********************************************************************
@@ -1090,6 +1258,7 @@ static inline int __citp_poll_if_needed(ci_netif* ni, ci_uint64 recent_frc,
 {
   if( ci_netif_may_poll(ni) &&
       ci_netif_need_poll_maybe_spinning(ni, recent_frc, is_spinning) &&
+      ( ! is_spinning || ci_netif_poll_uncontended(ni) ) &&
       ci_netif_trylock(ni) ) {
     ci_netif_poll(ni);
     if( is_spinning )
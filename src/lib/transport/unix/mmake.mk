@@ -24,14 +24,17 @@ LIB_SRCS	:=			\
 		sockcall_intercept.c	\
 		onload_ext_intercept.c	\
 		zc_intercept.c          \
+		cq_intercept.c          \
 		zc_hlrx.c          \
 		tmpl_intercept.c	\
 		stackname.c		\
 		stackopt.c		\
 		fdtable.c		\
+		fdtable_rcu.c		\
 		protocol_manager.c	\
 		closed_fd.c		\
 		tcp_fd.c		\
+		tcp_prewarm.c		\
 		udp_fd.c		\
 		pipe_fd.c		\
 		nonsock.c		\
@@ -199,6 +199,7 @@ static void citp_netif_child_fork_hook(void)
 setup_fdtable:
   /* Allow the fdtable to make itself safe across the fork(). */
   citp_fdtable_fork_hook();
+  citp_fdtable_rcu_fork_child();
 
   CITP_FDTABLE_UNLOCK();
   citp_exit_lib(&citp_lib_context_across_fork, 0);
@@ -160,6 +160,18 @@ int citp_nonsock_zc_recv_filter(citp_fdinfo* fdi,
 # endif
 }
 
+int citp_nonsock_zc_recv_filter_chain(citp_fdinfo* fdi,
+                                      const struct onload_zc_recv_filter_rule*
+                                      rules, int rules_len, int flags)
+{
+  Log_V(log(LPF "zc_recv_filter_chain(%d)", fdi->fd));
+# if CI_CFG_ZC_RECV_FILTER
+  return -ESOCKTNOSUPPORT;
+# else
+  return -ENOSYS;
+# endif
+}
+
 int citp_nonsock_tmpl_alloc(citp_fdinfo* fdi, const struct iovec* initial_msg,
                             int mlen, struct oo_msg_template** omt_pp,
                             unsigned flags)
@@ -169,6 +181,17 @@ int citp_nonsock_tmpl_alloc(citp_fdinfo* fdi, const struct iovec* initial_msg,
 }
 
 
+int
+citp_nonsock_tmpl_alloc_array(citp_fdinfo* fdi,
+                              const struct onload_template_msg* msgs,
+                              int ntemplates, struct oo_msg_template** handles,
+                              unsigned flags)
+{
+  Log_V(log(LPF "tmpl_alloc_array(%d)", fdi->fd));
+  return -EOPNOTSUPP;
+}
+
+
 int
 citp_nonsock_tmpl_update(citp_fdinfo* fdi, struct oo_msg_template* omt,
                          const struct onload_template_msg_update_iovec* updates,
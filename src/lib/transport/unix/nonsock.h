@@ -71,10 +71,19 @@ int citp_nonsock_zc_recv_filter(citp_fdinfo* fdi,
                                 onload_zc_recv_filter_callback filter,
                                 void* cb_arg, int flags);
 extern
+int citp_nonsock_zc_recv_filter_chain(citp_fdinfo* fdi,
+                                      const struct onload_zc_recv_filter_rule*
+                                      rules, int rules_len, int flags);
+extern
 int citp_nonsock_tmpl_alloc(citp_fdinfo* fdi, const struct iovec* initial_msg,
                             int mlen, struct oo_msg_template** omt_pp,
                             unsigned flags);
 extern int
+citp_nonsock_tmpl_alloc_array(citp_fdinfo* fdi,
+                              const struct onload_template_msg* msgs,
+                              int ntemplates, struct oo_msg_template** handles,
+                              unsigned flags);
+extern int
 citp_nonsock_tmpl_update(citp_fdinfo* fdi, struct oo_msg_template* omt,
                          const struct onload_template_msg_update_iovec* updates,
                          int ulen, unsigned flags);
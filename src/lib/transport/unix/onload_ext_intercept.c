@@ -163,6 +163,13 @@ int onload_thread_get_spin(unsigned* state)
   return 0;
 }
 
+int onload_thread_set_poll_priority(int enable)
+{
+  struct oo_per_thread* pt = oo_per_thread_get();
+  pt->poll_prio = !!enable;
+  return 0;
+}
+
 int onload_move_fd(int fd)
 {
 #if CI_CFG_ENDPOINT_MOVE
@@ -199,6 +206,245 @@ out:
 #endif
 }
 
+int onload_move_fd_batch(const int* fds, int* rcs, int n)
+{
+#if CI_CFG_ENDPOINT_MOVE
+  ef_driver_handle fd_ni;
+  oo_move_fd_batch_t op;
+  int i, rc;
+  ci_netif* ni;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%p, %p, %d)", __func__, fds, rcs, n));
+  citp_enter_lib(&lib_context);
+
+  rc = citp_netif_alloc_and_init(&fd_ni, &ni);
+  if( rc != 0 )
+    goto out;
+
+  CI_USER_PTR_SET(op.fds, fds);
+  CI_USER_PTR_SET(op.rcs, rcs);
+  op.n = n;
+  rc = oo_resource_op(ci_netif_get_driver_handle(ni),
+                      OO_IOC_MOVE_FD_BATCH, &op);
+  if( rc != 0 )
+    goto out;
+
+  for( i = 0; i < n; ++i ) {
+    citp_fdinfo *fdi;
+    if( rcs[i] != 0 )
+      continue;
+    fdi = citp_fdtable_lookup(fds[i]);
+    fdi = citp_reprobe_moved(fdi, CI_FALSE, CI_FALSE);
+    citp_fdinfo_release_ref(fdi, CI_FALSE);
+  }
+
+out:
+  citp_exit_lib(&lib_context, CI_TRUE);
+  Log_CALL_RESULT(rc);
+  return rc;
+#else
+  return -ENOSYS;
+#endif
+}
+
+
+int onload_socket_isolation_domain(int fd, int domain)
+{
+  citp_fdinfo* fdi;
+  int rc;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %d)", __func__, fd, domain));
+
+  if( domain < 0 || domain >= OO_ISO_DOMAIN_MAX )
+    return -EINVAL;
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL && citp_fdinfo_is_socket(fdi) ) {
+    fdi_to_socket(fdi)->s->iso_domain = domain;
+    rc = 0;
+  }
+  else {
+    rc = -ENOTTY;
+  }
+
+  citp_exit_lib(&lib_context, 0);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_socket_watermarks_set(int fd,
+                                 const struct onload_socket_watermarks* wm)
+{
+  citp_fdinfo* fdi;
+  int rc;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, {%u, %u, %u})", __func__, fd,
+                  (unsigned) wm->sendq_pkts, (unsigned) wm->rcvq_pkts,
+                  (unsigned) wm->pool_free_pkts));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL && citp_fdinfo_is_socket(fdi) ) {
+    citp_socket* ep = fdi_to_socket(fdi);
+    ci_netif* ni = ep->netif;
+    ci_sock_cmn* s = ep->s;
+
+    ci_netif_lock(ni);
+    /* Thresholds are stored in 16 bits; saturate rather than reject. */
+    s->wm_sendq_pkts = CI_MIN(wm->sendq_pkts, 0xffffu);
+    s->wm_rcvq_pkts = CI_MIN(wm->rcvq_pkts, 0xffffu);
+    s->wm_pool_free_pkts = CI_MIN(wm->pool_free_pkts, 0xffffu);
+    if( (wm->sendq_pkts | wm->rcvq_pkts | wm->pool_free_pkts) != 0 ) {
+      ci_sock_mem_watermark_register(ni, s);
+    }
+    else {
+      ci_sock_mem_watermark_unregister(ni, s);
+      s->wm_fired = 0;
+    }
+    ci_netif_unlock(ni);
+    rc = 0;
+  }
+  else {
+    rc = -ENOTTY;
+  }
+
+  citp_exit_lib(&lib_context, 0);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_socket_watermarks_query(int fd, unsigned* fired_out)
+{
+  citp_fdinfo* fdi;
+  int rc;
+  citp_lib_context_t lib_context;
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL && citp_fdinfo_is_socket(fdi) ) {
+    citp_socket* ep = fdi_to_socket(fdi);
+    ci_netif_lock(ep->netif);
+    *fired_out = ep->s->wm_fired;
+    ep->s->wm_fired = 0;
+    ci_netif_unlock(ep->netif);
+    rc = 0;
+  }
+  else {
+    rc = -ENOTTY;
+  }
+
+  citp_exit_lib(&lib_context, 0);
+  return rc;
+}
+
+
+int onload_udp_mcast_join_batch(int fd, int ifindex, int count,
+                                const uint32_t* groups)
+{
+  citp_fdinfo* fdi;
+  int rc;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %d, %d, %p)", __func__, fd, ifindex, count,
+                  groups));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL && citp_fdinfo_is_socket(fdi) &&
+      fdi_to_socket(fdi)->s->b.state == CI_TCP_STATE_UDP ) {
+    rc = ci_udp_mcast_join_batch(fdi_to_socket(fdi), fd,
+                                 (ci_ifid_t) ifindex, groups, count);
+  }
+  else {
+    rc = -ENOTTY;
+  }
+
+  citp_exit_lib(&lib_context, rc >= 0);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_stack_clock_get(int fd, struct onload_stack_clock* clock_out)
+{
+  citp_fdinfo* fdi;
+  int rc;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %p)", __func__, fd, clock_out));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL && citp_fdinfo_is_socket(fdi) &&
+      fdi_to_socket(fdi)->netif->timesync != NULL ) {
+    struct oo_timesync* oo_ts = fdi_to_socket(fdi)->netif->timesync;
+    ci_uint32 gc;
+
+    do {
+      gc = oo_ts->generation_count;
+      ci_rmb();
+      clock_out->frc_base = oo_ts->clock_made;
+      clock_out->frc_ticks = oo_ts->smoothed_ticks;
+      clock_out->frc_ns = oo_ts->smoothed_ns;
+      clock_out->wall_sec = oo_ts->wall_clock.tv_sec;
+      clock_out->wall_nsec = oo_ts->wall_clock.tv_nsec;
+      clock_out->max_error_ns = oo_ts->max_error_ns;
+      ci_rmb();
+    } while( gc & 1 || gc != oo_ts->generation_count );
+    clock_out->generation = gc;
+    rc = 0;
+  }
+  else {
+    rc = -ENOTTY;
+  }
+
+  citp_exit_lib(&lib_context, 0);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_socket_recv_framing(int fd,
+                               const struct onload_recv_framing* framing)
+{
+  citp_fdinfo* fdi;
+  int rc;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %p)", __func__, fd, framing));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL && citp_fdinfo_is_socket(fdi) &&
+      (fdi_to_socket(fdi)->s->b.state & CI_TCP_STATE_TCP) &&
+      fdi_to_socket(fdi)->s->b.state != CI_TCP_LISTEN ) {
+    citp_socket* ep = fdi_to_socket(fdi);
+    ci_netif* ni = ep->netif;
+    ci_tcp_state* ts = SOCK_TO_TCP(ep->s);
+
+    /* Take the socket lock so the descriptor never changes under a
+     * receive in progress. */
+    rc = ci_sock_lock(ni, &ts->s.b);
+    if( rc == 0 ) {
+      rc = ci_tcp_recv_framing_set(ni, ts, framing);
+      ci_sock_unlock(ni, &ts->s.b);
+    }
+  }
+  else {
+    rc = -ENOTTY;
+  }
+
+  citp_exit_lib(&lib_context, rc == 0);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
 
 static int onload_fd_check_msg_warm(int fd)
 {
@@ -235,6 +481,47 @@ int onload_fd_check_feature(int fd, enum onload_fd_feature feature)
 }
 
 
+static onload_rx_prefilter_callback rx_prefilter_cb;
+static void* rx_prefilter_cb_arg;
+
+static int rx_prefilter_thunk(void* arg, const void* frame, int frame_len)
+{
+  (void) arg;
+  return rx_prefilter_cb(rx_prefilter_cb_arg, frame, frame_len) ==
+         ONLOAD_RX_PREFILTER_DROP;
+}
+
+int onload_rx_prefilter_set(onload_rx_prefilter_callback filter, void* cb_arg)
+{
+  if( filter == NULL ) {
+    oo_rx_prefilter_set(NULL, NULL);
+    return 0;
+  }
+  rx_prefilter_cb = filter;
+  rx_prefilter_cb_arg = cb_arg;
+  oo_rx_prefilter_set(rx_prefilter_thunk, NULL);
+  return 0;
+}
+
+
+int onload_feed_arbiter_set(onload_feed_seq_extractor extract, void* cb_arg)
+{
+  /* The internal and public extractor signatures match, so no thunk is
+   * needed. */
+  oo_feed_arbiter_set((oo_feed_seq_fn) extract, cb_arg);
+  return 0;
+}
+
+
+int onload_feed_arbiter_get_stats(struct onload_feed_arbiter_stats* stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  oo_feed_arbiter_get_stats(stats->wins, ONLOAD_FEED_ARBITER_MAX_ARMS,
+                            &stats->duplicates_dropped, &stats->gaps);
+  return 0;
+}
+
+
 int onload_ordered_epoll_wait(int epfd, struct epoll_event *events,
                               struct onload_ordered_epoll_event *oo_events,
                               int maxevents, int timeout)
@@ -267,6 +554,192 @@ int onload_ordered_epoll_wait(int epfd, struct epoll_event *events,
 }
 
 
+int onload_epoll_set_priority(int epfd, int fd, int priority)
+{
+  int rc = -EINVAL;
+  citp_fdinfo* fdi;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %d, %d)", __FUNCTION__, epfd, fd, priority));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(epfd)) != NULL ) {
+    if( fdi->protocol->type == CITP_EPOLL_FD )
+      rc = citp_epoll_set_priority(fdi, fd, priority);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+
+  citp_exit_lib(&lib_context, rc == 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_epoll_ctl_batch(int epfd, struct onload_epoll_ctl_op* ops,
+                           int n_ops)
+{
+  int rc = -ENOTSUP;
+  citp_fdinfo* fdi;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %p, %d)", __FUNCTION__, epfd, ops, n_ops));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(epfd)) != NULL ) {
+    if( fdi->protocol->type == CITP_EPOLL_FD )
+      rc = citp_epoll_ctl_batch(fdi, ops, n_ops);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+
+  citp_exit_lib(&lib_context, rc >= 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_epoll_timer_arm(int epfd, int64_t timeout_us, int64_t interval_us,
+                           uint64_t data)
+{
+  int rc = -ENOTSUP;
+  citp_fdinfo* fdi;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d, %lld, %lld)", __FUNCTION__, epfd,
+                  (long long) timeout_us, (long long) interval_us));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(epfd)) != NULL ) {
+    if( fdi->protocol->type == CITP_EPOLL_FD )
+      rc = citp_epoll_timer_arm(fdi, timeout_us, interval_us, data);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+
+  citp_exit_lib(&lib_context, rc == 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_epoll_timer_cancel(int epfd)
+{
+  int rc = -ENOTSUP;
+  citp_fdinfo* fdi;
+  citp_lib_context_t lib_context;
+
+  Log_CALL(ci_log("%s(%d)", __FUNCTION__, epfd));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(epfd)) != NULL ) {
+    if( fdi->protocol->type == CITP_EPOLL_FD )
+      rc = citp_epoll_timer_cancel(fdi);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+
+  citp_exit_lib(&lib_context, rc == 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_rx_order_read(int fd, struct onload_rx_order_event* events,
+                         int n, uint32_t* dropped)
+{
+#if CI_CFG_RX_ORDER_TAP
+  int rc = -ESOCKTNOSUPPORT;
+  citp_fdinfo* fdi;
+  citp_lib_context_t lib_context;
+
+  if( events == NULL || n <= 0 )
+    return -EINVAL;
+
+  Log_CALL(ci_log("%s(%d, %p, %d, %p)", __FUNCTION__,
+                  fd, events, n, dropped));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL ) {
+    if( citp_fdinfo_is_socket(fdi) ) {
+      ci_netif* ni = fdi_to_socket(fdi)->netif;
+      ci_netif_state* ns = ni->state;
+
+      if( ! NI_OPTS(ni).rx_order_tap ) {
+        rc = -ENOTSUP;
+      }
+      else {
+        /* Single reader: read_i is only advanced here.  The producer
+         * issues a write barrier before bumping write_i, so a read
+         * barrier after sampling write_i makes the records visible. */
+        ci_uint16 write_i = ns->rx_order_write_i;
+        ci_uint16 read_i = ns->rx_order_read_i;
+        int n_got = 0;
+
+        ci_rmb();
+        while( n_got < n && read_i != write_i ) {
+          const struct oo_rx_order_ev* ev =
+            &ns->rx_order_q[read_i % CI_CFG_RX_ORDER_TAP_LEN];
+          events[n_got].endpoint_id = ev->sock_id;
+          events[n_got].bytes = ev->bytes;
+          events[n_got].hw_stamp.tv_sec = ev->hw_stamp.tv_sec;
+          events[n_got].hw_stamp.tv_nsec = ev->hw_stamp.tv_nsec;
+          ++n_got;
+          ++read_i;
+        }
+        ns->rx_order_read_i = read_i;
+        if( dropped != NULL )
+          *dropped = ns->rx_order_drops;
+        rc = n_got;
+      }
+    }
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+
+  citp_exit_lib(&lib_context, rc >= 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+#else
+  return -EOPNOTSUPP;
+#endif
+}
+
+
+int onload_stack_eventfd(int fd, int evfd)
+{
+  int rc = -ESOCKTNOSUPPORT;
+  citp_fdinfo* fdi;
+  citp_lib_context_t lib_context;
+
+  if( evfd < -1 )
+    return -EINVAL;
+
+  Log_CALL(ci_log("%s(%d, %d)", __FUNCTION__, fd, evfd));
+
+  citp_enter_lib(&lib_context);
+
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL ) {
+    if( citp_fdinfo_is_socket(fdi) ) {
+      ci_netif* ni = fdi_to_socket(fdi)->netif;
+      ni->eventfd_bridge = evfd;
+      rc = 0;
+    }
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+
+  citp_exit_lib(&lib_context, rc == 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
 int onload_timestamping_request(int fd, unsigned flags)
 {
 #if CI_CFG_TIMESTAMPING
@@ -408,6 +881,34 @@ onload_delegated_send_complete(int fd, const struct iovec* iov, int iovlen,
   return rc;
 }
 
+int
+onload_delegated_send_complete_zc(int fd, const struct onload_zc_iovec* iov,
+                                  int iovlen, int flags)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  int rc;
+
+  Log_CALL(ci_log("%s(%d, %p, %d, 0x%x)", __FUNCTION__,
+                  fd, iov, iovlen, flags));
+
+  citp_enter_lib(&lib_context);
+  fdi = citp_fdtable_lookup(fd);
+  if( fdi != NULL && citp_fdinfo_get_ops(fdi)->dsend_complete_zc != NULL ) {
+    rc = citp_fdinfo_get_ops(fdi)->dsend_complete_zc(fdi, iov, iovlen, flags);
+  }
+  else {
+    errno = ENOTTY;
+    rc = -1;
+  }
+  if( fdi != NULL )
+    citp_fdinfo_release_ref(fdi, 0);
+  citp_exit_lib(&lib_context, rc == 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
 int
 onload_delegated_send_cancel(int fd)
 {
@@ -434,6 +935,78 @@ onload_delegated_send_cancel(int fd)
   return rc;
 }
 
+int
+onload_udp_dest_register(int fd, const struct sockaddr* addr,
+                         socklen_t addrlen)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  int rc = -ENOTTY;
+
+  Log_CALL(ci_log("%s(%d, %p, %d)", __FUNCTION__, fd, addr, addrlen));
+
+  citp_enter_lib(&lib_context);
+  fdi = citp_fdtable_lookup(fd);
+  if( fdi != NULL ) {
+    if( citp_fdinfo_get_ops(fdi)->udp_dest_register != NULL )
+      rc = citp_fdinfo_get_ops(fdi)->udp_dest_register(fdi, addr, addrlen);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+  citp_exit_lib(&lib_context, rc >= 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+int
+onload_udp_send_batch(int fd, struct onload_udp_send_batch_entry* entries,
+                      int n, int flags)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  int rc = -ENOTTY;
+
+  Log_CALL(ci_log("%s(%d, %p, %d, 0x%x)", __FUNCTION__,
+                  fd, entries, n, flags));
+
+  citp_enter_lib(&lib_context);
+  fdi = citp_fdtable_lookup(fd);
+  if( fdi != NULL ) {
+    if( citp_fdinfo_get_ops(fdi)->udp_send_batch != NULL )
+      rc = citp_fdinfo_get_ops(fdi)->udp_send_batch(fdi, entries, n, flags);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+  citp_exit_lib(&lib_context, rc >= 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+int
+onload_udp_fanout_send(int fd, const struct iovec* iov, int iovlen,
+                       const int* dests, int n_dests, int flags)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  int rc = -ENOTTY;
+
+  Log_CALL(ci_log("%s(%d, %p, %d, %p, %d, 0x%x)", __FUNCTION__,
+                  fd, iov, iovlen, dests, n_dests, flags));
+
+  citp_enter_lib(&lib_context);
+  fdi = citp_fdtable_lookup(fd);
+  if( fdi != NULL ) {
+    if( citp_fdinfo_get_ops(fdi)->udp_fanout_send != NULL )
+      rc = citp_fdinfo_get_ops(fdi)->udp_fanout_send(fdi, iov, iovlen,
+                                                     dests, n_dests, flags);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+  citp_exit_lib(&lib_context, rc >= 0);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
 int
 oo_raw_send(int fd, int hwport, const struct iovec *iov, int iovcnt)
 {
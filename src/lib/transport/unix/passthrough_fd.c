@@ -158,8 +158,10 @@ citp_protocol_impl citp_passthrough_protocol_impl = {
     .zc_send     = citp_nonsock_zc_send,
     .zc_recv     = citp_nonsock_zc_recv,
     .zc_recv_filter = citp_nonsock_zc_recv_filter,
+    .zc_recv_filter_chain = citp_nonsock_zc_recv_filter_chain,
     .recvmsg_kernel = citp_nonsock_recvmsg_kernel,
     .tmpl_alloc     = citp_nonsock_tmpl_alloc,
+    .tmpl_alloc_array = citp_nonsock_tmpl_alloc_array,
     .tmpl_update    = citp_nonsock_tmpl_update,
     .tmpl_abort     = citp_nonsock_tmpl_abort,
 #if CI_CFG_TIMESTAMPING
@@ -282,6 +282,13 @@ OO_INTERCEPT(int, socket,
     Log_PT(log("PT: sys_socket(%d, %d, %d) = %d", domain, type, protocol, rc));
   }
 
+  /* The application's first TCP socket marks a good moment to start
+   * pre-warming connections: the library is up, and the first
+   * latency-critical connect() is still ahead of us. */
+  if(CI_UNLIKELY( rc >= 0 && domain == AF_INET &&
+                  (type & ~(SOCK_NONBLOCK | SOCK_CLOEXEC)) == SOCK_STREAM ))
+    citp_tcp_prewarm_poke(&lib_context);
+
   FDTABLE_ASSERT_VALID();
   citp_exit_lib(&lib_context, rc >= 0);
   Log_CALL_RESULT(rc);
@@ -773,7 +780,7 @@ OO_INTERCEPT(ssize_t, recv,
     CI_DEBUG(m.msg_control = CI_NOT_NULL);
     m.msg_controllen = 0;
     /* msg_flags is output only */
-    rc = citp_fdinfo_get_ops(fdi)->recv(fdi, &m, flags);
+    rc = citp_fdinfo_recv(fdi, &m, flags);
     citp_fdinfo_release_ref_fast(fdi);
     citp_exit_lib(&lib_context, rc >= 0);
   }
@@ -830,7 +837,7 @@ OO_INTERCEPT(ssize_t, recvfrom,
     CI_DEBUG(m.msg_control = CI_NOT_NULL);
     m.msg_controllen = 0;
     /* msg_flags is output only */
-    rc = citp_fdinfo_get_ops(fdi)->recv(fdi, &m, flags);
+    rc = citp_fdinfo_recv(fdi, &m, flags);
     if (fromlen != NULL && from != NULL) {
       *fromlen = m.msg_namelen;
     } else if (CI_UNLIKELY(rc >= 0 && fromlen == NULL && from != NULL)) {
@@ -880,7 +887,7 @@ OO_INTERCEPT(ssize_t, recvmsg,
     if( msg->msg_iov == NULL && msg->msg_iovlen != 0 )
       CI_SET_ERROR(rc, EFAULT);
     else
-      rc = citp_fdinfo_get_ops(fdi)->recv(fdi, msg, flags);
+      rc = citp_fdinfo_recv(fdi, msg, flags);
     citp_fdinfo_release_ref_fast(fdi);
     citp_exit_lib(&lib_context, rc >= 0);
   }
@@ -961,7 +968,7 @@ OO_INTERCEPT(ssize_t, send,
     CI_DEBUG(m.msg_control = CI_NOT_NULL);
     m.msg_controllen = 0;
     /* msg_flags is output only */
-    rc = citp_fdinfo_get_ops(fdi)->send(fdi, &m, flags);
+    rc = citp_fdinfo_send(fdi, &m, flags);
     citp_fdinfo_release_ref_fast(fdi);
     citp_exit_lib(&lib_context, rc >= 0);
   }
@@ -1010,7 +1017,7 @@ OO_INTERCEPT(ssize_t, sendto,
     CI_DEBUG(m.msg_control = CI_NOT_NULL);
     m.msg_controllen = 0;
     m.msg_flags = 0;
-    rc = citp_fdinfo_get_ops(fdi)->send(fdi, &m, flags);
+    rc = citp_fdinfo_send(fdi, &m, flags);
     citp_fdinfo_release_ref_fast(fdi);
     citp_exit_lib(&lib_context, rc >= 0);
   }
@@ -1046,7 +1053,7 @@ OO_INTERCEPT(ssize_t, sendmsg,
 
   if( (fdi = citp_fdtable_lookup_fast(&lib_context, fd)) ) {
     if(CI_LIKELY( msg != NULL ))
-      rc = citp_fdinfo_get_ops(fdi)->send(fdi, msg, flags);
+      rc = citp_fdinfo_send(fdi, msg, flags);
     else
       CI_SET_ERROR(rc, EFAULT);
     citp_fdinfo_release_ref_fast(fdi);
@@ -1603,7 +1610,7 @@ OO_INTERCEPT(ssize_t, read,
     if( count == 0 )
       rc = 0;
     else
-      rc = citp_fdinfo_get_ops(fdi)->recv(fdi, &m, 0);
+      rc = citp_fdinfo_recv(fdi, &m, 0);
     citp_fdinfo_release_ref_fast(fdi);
     FDTABLE_ASSERT_VALID();
     citp_exit_lib(&lib_context, rc >= 0);
@@ -1654,7 +1661,7 @@ OO_INTERCEPT(ssize_t, write,
     CI_DEBUG(m.msg_control = CI_NOT_NULL);
     m.msg_controllen = 0;
     /* msg_flags is output only */
-    rc = citp_fdinfo_get_ops(fdi)->send(fdi, &m, 0);
+    rc = citp_fdinfo_send(fdi, &m, 0);
     citp_fdinfo_release_ref_fast(fdi);
     FDTABLE_ASSERT_VALID();
     citp_exit_lib(&lib_context, rc >= 0);
@@ -1712,7 +1719,7 @@ OO_INTERCEPT(ssize_t, readv,
       if( len_is_zero )
         rc = 0;
       else
-        rc = citp_fdinfo_get_ops(fdi)->recv(fdi, &m, 0);
+        rc = citp_fdinfo_recv(fdi, &m, 0);
     }
     citp_fdinfo_release_ref_fast(fdi);
     citp_exit_lib(&lib_context, rc >= 0);
@@ -1751,7 +1758,7 @@ OO_INTERCEPT(ssize_t, writev,
     CI_DEBUG(m.msg_control = CI_NOT_NULL);
     m.msg_controllen = 0;
     /* msg_flags is output only */
-    rc = citp_fdinfo_get_ops(fdi)->send(fdi, &m, 0);
+    rc = citp_fdinfo_send(fdi, &m, 0);
     citp_fdinfo_release_ref_fast(fdi);
     citp_exit_lib(&lib_context, rc >= 0);
   }
@@ -171,12 +171,14 @@ static void citp_dump_opts(citp_opts_t *o)
   DUMP_OPT_INT("EF_EPOLL_CTL_FAST",     ul_epoll_ctl_fast);
   DUMP_OPT_INT("EF_EPOLL_CTL_HANDOFF",  ul_epoll_ctl_handoff);
   DUMP_OPT_INT("EF_EPOLL_MT_SAFE",      ul_epoll_mt_safe);
+  DUMP_OPT_INT("EF_EPOLL_MULTI_STACK",  ul_epoll_multi_stack);
   DUMP_OPT_INT("EF_FDTABLE_SIZE",	fdtable_size);
   DUMP_OPT_INT("EF_SPIN_USEC",		ul_spin_usec);
   DUMP_OPT_INT("EF_SLEEP_SPIN_USEC",	sleep_spin_usec);
   DUMP_OPT_INT("EF_STACK_PER_THREAD",	stack_per_thread);
   DUMP_OPT_INT("EF_DONT_ACCELERATE",	dont_accelerate);
   DUMP_OPT_INT("EF_FDTABLE_STRICT",	fdtable_strict);
+  DUMP_OPT_INT("EF_FDTABLE_RCU",	fdtable_rcu);
   DUMP_OPT_INT("EF_FDS_MT_SAFE",	fds_mt_safe);
   DUMP_OPT_INT("EF_FORK_NETIF",		fork_netif);
   DUMP_OPT_INT("EF_NETIF_DTOR",		netif_dtor);
@@ -401,6 +403,9 @@ static void citp_opts_getenv(citp_opts_t* opts)
     opts->stack_lock_buzz = 1;
   }
 
+  GET_ENV_OPT_INT("EF_SPIN_TOPOLOGY_AWARE", spin_topology_aware);
+  GET_ENV_OPT_INT("EF_FWD_CACHE_SIZE",	fwd_cache_size);
+
   GET_ENV_OPT_HEX("EF_UNIX_LOG",	log_level);
   GET_ENV_OPT_INT("EF_PROBE",		probe);
   GET_ENV_OPT_INT("EF_TCP",		ul_tcp);
@@ -433,6 +438,7 @@ static void citp_opts_getenv(citp_opts_t* opts)
   GET_ENV_OPT_INT("EF_EPOLL_CTL_FAST",  ul_epoll_ctl_fast);
   GET_ENV_OPT_INT("EF_EPOLL_CTL_HANDOFF",ul_epoll_ctl_handoff);
   GET_ENV_OPT_INT("EF_EPOLL_MT_SAFE",   ul_epoll_mt_safe);
+  GET_ENV_OPT_INT("EF_EPOLL_MULTI_STACK", ul_epoll_multi_stack);
   GET_ENV_OPT_INT("EF_WODA_SINGLE_INTERFACE", woda_single_if);
   GET_ENV_OPT_INT("EF_FDTABLE_SIZE",	fdtable_size);
   GET_ENV_OPT_INT("EF_SPIN_USEC",	ul_spin_usec);
@@ -440,6 +446,7 @@ static void citp_opts_getenv(citp_opts_t* opts)
   GET_ENV_OPT_INT("EF_STACK_PER_THREAD",stack_per_thread);
   GET_ENV_OPT_INT("EF_DONT_ACCELERATE",	dont_accelerate);
   GET_ENV_OPT_INT("EF_FDTABLE_STRICT",	fdtable_strict);
+  GET_ENV_OPT_INT("EF_FDTABLE_RCU",	fdtable_rcu);
   GET_ENV_OPT_INT("EF_FDS_MT_SAFE",	fds_mt_safe);
   GET_ENV_OPT_INT("EF_NO_FAIL",		no_fail);
   GET_ENV_OPT_INT("EF_SA_ONSTACK_INTERCEPT",	sa_onstack_intercept);
@@ -559,6 +566,102 @@ static void citp_opts_validate_env(void)
 }
 
 
+/* Read a small sysfs file into [buf]; returns length or -1. */
+static int citp_sysfs_read(const char* path, char* buf, int buf_len)
+{
+  int fd, n;
+
+  fd = ci_sys_open(path, O_RDONLY);
+  if( fd < 0 )
+    return -1;
+  n = ci_sys_read(fd, buf, buf_len - 1);
+  ci_sys_close(fd);
+  if( n <= 0 )
+    return -1;
+  buf[n] = '\0';
+  return n;
+}
+
+
+/* Invoke [fn] for each CPU id in a sysfs list such as "0-3,8,10-11". */
+static void citp_cpu_list_foreach(const char* list,
+                                  void (*fn)(int cpu, void* arg), void* arg)
+{
+  const char* s = list;
+  char* end;
+  long lo, hi;
+
+  while( *s != '\0' ) {
+    lo = strtol(s, &end, 10);
+    if( end == s )
+      break;
+    hi = lo;
+    if( *end == '-' ) {
+      s = end + 1;
+      hi = strtol(s, &end, 10);
+      if( end == s )
+        break;
+    }
+    for( ; lo <= hi; ++lo )
+      if( lo >= 0 && lo < OO_SPIN_TOPOLOGY_MAX_CPUS )
+        fn(lo, arg);
+    if( *end != ',' )
+      break;
+    s = end + 1;
+  }
+}
+
+
+static void citp_cpu_mark_e_core(int cpu, void* arg)
+{
+  oo_spin_cpu_e_core[cpu] = 1;
+}
+
+static void citp_cpu_note_sibling(int cpu, void* arg)
+{
+  int self = *(int*) arg;
+  if( cpu != self && oo_spin_cpu_sibling[self] < 0 )
+    oo_spin_cpu_sibling[self] = cpu;
+}
+
+static void citp_cpu_scan_siblings(int cpu, void* arg)
+{
+  char path[80];
+  char buf[256];
+
+  snprintf(path, sizeof(path),
+           "/sys/devices/system/cpu/cpu%d/topology/thread_siblings_list",
+           cpu);
+  if( citp_sysfs_read(path, buf, sizeof(buf)) > 0 )
+    citp_cpu_list_foreach(buf, citp_cpu_note_sibling, &cpu);
+}
+
+
+/* Build the per-CPU tables behind EF_SPIN_TOPOLOGY_AWARE: for each
+ * online CPU the id of an SMT sibling (if any), and whether it is an
+ * efficiency core (enumerated under cpu_atom on hybrid x86 parts).
+ * Only enables the feature once the tables are populated.
+ */
+static void citp_spin_topology_init(void)
+{
+  char buf[4096];
+  int i;
+
+  for( i = 0; i < OO_SPIN_TOPOLOGY_MAX_CPUS; ++i )
+    oo_spin_cpu_sibling[i] = -1;
+
+  if( citp_sysfs_read("/sys/devices/cpu_atom/cpus", buf, sizeof(buf)) > 0 )
+    citp_cpu_list_foreach(buf, citp_cpu_mark_e_core, NULL);
+
+  if( citp_sysfs_read("/sys/devices/system/cpu/online",
+                      buf, sizeof(buf)) <= 0 )
+    return;
+  citp_cpu_list_foreach(buf, citp_cpu_scan_siblings, NULL);
+
+  oo_spin_topology_enabled = 1;
+}
+
+
 static int
 citp_cfg_init(void)
 {
@@ -599,6 +702,9 @@ citp_transport_init(void)
     citp_usec_to_cycles64(CITP_OPTS.ul_select_nonblock_fast_usec);
   citp.select_fast_cycles = 
     citp_usec_to_cycles64(CITP_OPTS.ul_select_fast_usec);
+  if( CITP_OPTS.spin_topology_aware )
+    citp_spin_topology_init();
+
   ci_tp_init(__oo_per_thread_init_thread, oo_signal_terminate);
 
   citp_update_and_crosscheck(&ci_cfg_opts.netif_opts, &CITP_OPTS);
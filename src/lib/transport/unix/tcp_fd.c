@@ -340,6 +340,9 @@ citp_fdinfo* citp_tcp_dup(citp_fdinfo* orig_fdi)
   if( sock_fdi ) {
     citp_fdinfo_init(&sock_fdi->fdinfo, orig_fdi->protocol);
     sock_fdi->sock = *orig_sock;
+    /* onload_udp_send_batch() registrations do not follow dup(). */
+    sock_fdi->udp_dests = NULL;
+    sock_fdi->udp_dests_n = 0;
     citp_netif_add_ref(orig_sock->netif);
     return &sock_fdi->fdinfo;
   }
@@ -977,7 +980,7 @@ check_ul_accept_q:
       ni->state->stats.spin_tcp_accept++;
 #endif
       if( ci_netif_may_poll(ni) && ci_netif_need_poll_frc(ni, now_frc) ) {
-	if( ci_netif_trylock(ni) ) {
+	if( ci_netif_poll_uncontended(ni) && ci_netif_trylock(ni) ) {
 	  ci_netif_poll(ni);
           ci_netif_unlock(ni);
 	}
@@ -1086,6 +1089,17 @@ static int citp_tcp_connect(citp_fdinfo* fdinfo,
 #endif
 
 
+  /* A fresh, unbound socket connecting to a pre-warmed destination can
+   * be handed the connection we established in the background at
+   * start-up (EF_TCP_PREWARM). */
+  if(CI_UNLIKELY( citp_tcp_prewarm_enabled ) &&
+      s->b.state == CI_TCP_CLOSED &&
+      ! (s->s_flags & (CI_SOCK_FLAG_BOUND | CI_SOCK_FLAG_TPROXY)) &&
+      citp_tcp_prewarm_handoff(fdinfo, sa, sa_len) == 0 ) {
+    citp_fdinfo_release_ref(fdinfo, 0);
+    return 0;
+  }
+
   /* We do not support implicit bind of sockets with IP_TRANSPARENT set.
    * These sockets are expected to be used in one of 2 ways:
    * - active connects using a specific local address and port
@@ -1691,7 +1705,10 @@ static int citp_tcp_setsockopt(citp_fdinfo* fdinfo, int level,
 }
 
 
-static int citp_tcp_recv(citp_fdinfo* fdinfo, struct msghdr* msg, int flags)
+#if ! CI_CFG_STATIC_INTERCEPT
+static
+#endif
+int citp_tcp_recv(citp_fdinfo* fdinfo, struct msghdr* msg, int flags)
 {
   citp_sock_fdi* epi = fdi_to_sock_fdi(fdinfo);
   ci_tcp_recvmsg_args a;
@@ -1751,7 +1768,10 @@ static int citp_tcp_sendmmsg(citp_fdinfo* fdinfo, struct mmsghdr* msg,
   return -1;
 }
 
-static int citp_tcp_send(citp_fdinfo* fdinfo, const struct msghdr* msg,
+#if ! CI_CFG_STATIC_INTERCEPT
+static
+#endif
+int citp_tcp_send(citp_fdinfo* fdinfo, const struct msghdr* msg,
                          int flags)
 {
   citp_sock_fdi* epi = fdi_to_sock_fdi(fdinfo);
@@ -2075,6 +2095,18 @@ static int citp_tcp_zc_recv_filter(citp_fdinfo* fdi,
 #endif
 }
 
+static int
+citp_tcp_zc_recv_filter_chain(citp_fdinfo* fdi,
+                              const struct onload_zc_recv_filter_rule* rules,
+                              int rules_len, int flags)
+{
+#if CI_CFG_ZC_RECV_FILTER
+  return -EOPNOTSUPP;
+#else
+  return -ENOSYS;
+#endif
+}
+
 int citp_tcp_tmpl_alloc(citp_fdinfo* fdi, const struct iovec* initial_msg,
                         int mlen, struct oo_msg_template** omt_pp,
                         unsigned flags)
@@ -2095,6 +2127,27 @@ int citp_tcp_tmpl_alloc(citp_fdinfo* fdi, const struct iovec* initial_msg,
 }
 
 
+int citp_tcp_tmpl_alloc_array(citp_fdinfo* fdi,
+                              const struct onload_template_msg* msgs,
+                              int ntemplates, struct oo_msg_template** handles,
+                              unsigned flags)
+{
+#if CI_CFG_PIO
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  ci_tcp_state* ts = SOCK_TO_TCP(epi->sock.s);
+  ci_netif* ni = epi->sock.netif;
+
+  ci_assert(ts->s.b.state != CI_TCP_LISTEN);
+  return ci_tcp_tmpl_alloc_array(ni, ts, msgs, ntemplates, handles, flags);
+#else
+  /* Return different error to other failures (e.g. no licence, no
+   * more PIO buffer space) to allow caller to distinguish the cause
+   */
+  return -EOPNOTSUPP;
+#endif
+}
+
+
 int
 citp_tcp_tmpl_update(citp_fdinfo* fdi, struct oo_msg_template* omt,
                      const struct onload_template_msg_update_iovec* updates,
@@ -2284,6 +2337,29 @@ int citp_tcp_ds_complete(citp_fdinfo* fdi, const ci_iovec *iov, int iovlen,
   return rc;
 }
 
+int citp_tcp_ds_complete_zc(citp_fdinfo* fdi,
+                            const struct onload_zc_iovec* iov, int iovlen,
+                            int flags)
+{
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  ci_netif* ni = epi->sock.netif;
+  ci_sock_cmn* s = epi->sock.s;
+  int rc;
+
+  if( (~s->b.state & CI_TCP_STATE_TCP) || s->b.state == CI_TCP_LISTEN ) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  rc = ci_tcp_ds_done_zc(ni, SOCK_TO_TCP(epi->sock.s), iov, iovlen, flags);
+
+  if( rc == -1 && errno == EPIPE && ! (flags & MSG_NOSIGNAL) ) {
+    oo_resource_op(ci_netif_get_driver_handle(epi->sock.netif),
+                   OO_IOC_KILL_SELF_SIGPIPE, NULL);
+  }
+  return rc;
+}
+
 int citp_tcp_ds_cancel(citp_fdinfo* fdi)
 {
   citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
@@ -2330,8 +2406,10 @@ citp_protocol_impl citp_tcp_protocol_impl = {
     .zc_send            = citp_tcp_zc_send,
     .zc_recv            = citp_tcp_zc_recv,
     .zc_recv_filter     = citp_tcp_zc_recv_filter,
+    .zc_recv_filter_chain = citp_tcp_zc_recv_filter_chain,
     .recvmsg_kernel     = citp_tcp_recvmsg_kernel,
     .tmpl_alloc         = citp_tcp_tmpl_alloc,
+    .tmpl_alloc_array   = citp_tcp_tmpl_alloc_array,
     .tmpl_update        = citp_tcp_tmpl_update,
     .tmpl_abort         = citp_tcp_tmpl_abort,
 #if CI_CFG_TIMESTAMPING
@@ -2343,6 +2421,7 @@ citp_protocol_impl citp_tcp_protocol_impl = {
 #endif
     .dsend_prepare      = citp_tcp_ds_prepare,
     .dsend_complete     = citp_tcp_ds_complete,
+    .dsend_complete_zc  = citp_tcp_ds_complete_zc,
     .dsend_cancel       = citp_tcp_ds_cancel,
   }
 };
@@ -0,0 +1,239 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/**************************************************************************\
+*//*! \file
+** <L5_PRIVATE L5_SOURCE>
+**  \brief  TCP connection pre-warming (EF_TCP_PREWARM).
+** </L5_PRIVATE>
+*//*
+\**************************************************************************/
+
+/* EF_TCP_PREWARM holds a comma-separated list of up to
+ * CITP_TCP_PREWARM_MAX "a.b.c.d:port" destinations.  When the
+ * application creates its first TCP socket we quietly open one hidden
+ * non-blocking socket per destination and start connecting it, so the
+ * route resolution, ARP exchange, hardware filter insertion and TCP
+ * handshake all happen at application start rather than on the
+ * latency-critical first connect().  When the application later
+ * connect()s to one of the listed destinations with a fresh, unbound
+ * socket, the warmed connection is handed over by dup'ing it onto the
+ * application's fd and the connect() returns already established.
+ *
+ * Limitations, by design:
+ *  - only literal IPv4 "addr:port" destinations are understood;
+ *  - a socket that has been bound, or that has IP_TRANSPARENT set, is
+ *    never handed a warmed connection;
+ *  - socket options set on the application's socket before connect() do
+ *    not carry over to the warmed connection, which has default options;
+ *  - congestion window ramp-up would need application-protocol data to
+ *    flow, so a warmed connection starts with the stack's usual initial
+ *    cwnd (see EF_TCP_INITIAL_CWND).
+ */
+
+#include <internal.h>
+
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <ci/internal/ip.h>
+
+
+#define CITP_TCP_PREWARM_MAX  8
+
+struct citp_tcp_prewarm_dest {
+  ci_uint32 addr_be32;
+  ci_uint16 port_be16;
+  int       fd;           /* hidden warmed socket, or -1 once consumed */
+};
+
+static struct citp_tcp_prewarm_dest prewarm_dests[CITP_TCP_PREWARM_MAX];
+static int prewarm_dests_n;
+static volatile ci_int32 prewarm_state;  /* 0 idle, 1 running, 2 done */
+static pthread_mutex_t prewarm_lock = PTHREAD_MUTEX_INITIALIZER;
+
+int citp_tcp_prewarm_enabled;
+
+
+static int citp_tcp_prewarm_parse(char* list)
+{
+  char* tok;
+  char* save = NULL;
+  int n = 0;
+
+  for( tok = strtok_r(list, ",", &save); tok != NULL && n < CITP_TCP_PREWARM_MAX;
+       tok = strtok_r(NULL, ",", &save) ) {
+    char* colon = strrchr(tok, ':');
+    struct in_addr ia;
+    int port;
+    if( colon == NULL )
+      goto bad;
+    *colon = '\0';
+    port = atoi(colon + 1);
+    if( inet_aton(tok, &ia) == 0 || port <= 0 || port > 0xffff )
+      goto bad;
+    prewarm_dests[n].addr_be32 = ia.s_addr;
+    prewarm_dests[n].port_be16 = CI_BSWAP_BE16(port);
+    prewarm_dests[n].fd = -1;
+    ++n;
+    continue;
+  bad:
+    Log_U(ci_log("EF_TCP_PREWARM: cannot parse destination \"%s\"", tok));
+  }
+  return n;
+}
+
+
+/* Open and start connecting the hidden socket for one destination.  Any
+ * failure just leaves the entry unwarmed; the application's connect()
+ * then proceeds as normal. */
+static void citp_tcp_prewarm_start_one(struct citp_tcp_prewarm_dest* dest,
+                                       citp_lib_context_t* lib_context)
+{
+  struct sockaddr_in sin;
+  citp_fdinfo* fdi;
+  int fd, rc;
+
+  fd = citp_tcp_protocol_impl.ops.socket(AF_INET,
+                                         SOCK_STREAM | SOCK_NONBLOCK |
+                                         SOCK_CLOEXEC, 0);
+  if( fd < 0 )
+    return;
+  fdi = citp_fdtable_lookup(fd);
+  if( fdi == NULL || fdi->protocol->type != CITP_TCP_SOCKET ) {
+    if( fdi != NULL )
+      citp_fdinfo_release_ref(fdi, 0);
+    citp_ep_close(fd);
+    return;
+  }
+
+  memset(&sin, 0, sizeof(sin));
+  sin.sin_family = AF_INET;
+  sin.sin_addr.s_addr = dest->addr_be32;
+  sin.sin_port = dest->port_be16;
+  /* The fdinfo ref is consumed by the connect op. */
+  rc = citp_fdinfo_get_ops(fdi)->connect(fdi, (struct sockaddr*) &sin,
+                                         sizeof(sin), lib_context);
+  if( rc < 0 && errno != EINPROGRESS ) {
+    citp_ep_close(fd);
+    return;
+  }
+  dest->fd = fd;
+}
+
+
+/* One-shot: called when the application creates its first TCP socket.
+ * By then the library is fully initialised and the application is still
+ * in its start-up phase, well before the first latency-critical
+ * connect(). */
+void citp_tcp_prewarm_poke(citp_lib_context_t* lib_context)
+{
+  char* s;
+  char* list;
+  int i;
+
+  if( prewarm_state != 0 )
+    return;
+  /* Racing threads or re-entry via our own socket creation: first one
+   * in does the work, everyone else backs off. */
+  if( ci_cas32_fail(&prewarm_state, 0, 1) )
+    return;
+
+  s = getenv("EF_TCP_PREWARM");
+  if( s == NULL || (list = strdup(s)) == NULL ) {
+    prewarm_state = 2;
+    return;
+  }
+  prewarm_dests_n = citp_tcp_prewarm_parse(list);
+  free(list);
+
+  for( i = 0; i < prewarm_dests_n; ++i )
+    citp_tcp_prewarm_start_one(&prewarm_dests[i], lib_context);
+
+  citp_tcp_prewarm_enabled = prewarm_dests_n != 0;
+  ci_wmb();
+  prewarm_state = 2;
+}
+
+
+/* If [sa] names a warmed, established destination, hand the warmed
+ * connection over by dup'ing it onto the application's fd.  Returns 0
+ * on success with [fdinfo]'s fd connected, or -1 to fall back to a
+ * normal connect(). */
+int citp_tcp_prewarm_handoff(citp_fdinfo* fdinfo, const struct sockaddr* sa,
+                             socklen_t sa_len)
+{
+  const struct sockaddr_in* sin = (const struct sockaddr_in*) sa;
+  struct citp_tcp_prewarm_dest* dest = NULL;
+  citp_fdinfo* wfdi;
+  citp_fdinfo* newfdi;
+  ci_sock_cmn* ws;
+  int i, rc, fd_flags, warm_fd, app_nonblock;
+
+  if( sa == NULL || sa_len < sizeof(*sin) || sin->sin_family != AF_INET )
+    return -1;
+
+  pthread_mutex_lock(&prewarm_lock);
+  for( i = 0; i < prewarm_dests_n; ++i )
+    if( prewarm_dests[i].fd >= 0 &&
+        prewarm_dests[i].addr_be32 == sin->sin_addr.s_addr &&
+        prewarm_dests[i].port_be16 == sin->sin_port ) {
+      dest = &prewarm_dests[i];
+      break;
+    }
+  if( dest == NULL ) {
+    pthread_mutex_unlock(&prewarm_lock);
+    return -1;
+  }
+  warm_fd = dest->fd;
+  /* Consume the entry whatever happens below; a half-handed-over
+   * connection must never be offered twice. */
+  dest->fd = -1;
+  pthread_mutex_unlock(&prewarm_lock);
+
+  /* The hidden fd must still be our warmed socket (the application may
+   * have closed it blindly, e.g. when daemonising) and the handshake
+   * must have completed. */
+  wfdi = citp_fdtable_lookup(warm_fd);
+  if( wfdi == NULL )
+    return -1;
+  if( wfdi->protocol->type != CITP_TCP_SOCKET )
+    goto fail_release;
+  ws = fdi_to_sock_fdi(wfdi)->sock.s;
+  if( ws->b.state != CI_TCP_ESTABLISHED ||
+      sock_raddr_be32(ws) != sin->sin_addr.s_addr ||
+      sock_rport_be16(ws) != sin->sin_port )
+    goto fail_release;
+
+  app_nonblock = fdi_to_sock_fdi(fdinfo)->sock.s->b.sb_aflags &
+                 CI_SB_AFLAG_O_NONBLOCK;
+  fd_flags = ci_sys_fcntl(fdinfo->fd, F_GETFD);
+  citp_fdinfo_release_ref(wfdi, 0);
+
+  rc = citp_ep_dup3(warm_fd, fdinfo->fd,
+                    (fd_flags > 0 && (fd_flags & FD_CLOEXEC)) ? O_CLOEXEC : 0);
+  if( rc < 0 )
+    return -1;
+  citp_ep_close(warm_fd);
+
+  /* The warmed socket was created non-blocking; restore the blocking
+   * mode the application's socket had. */
+  newfdi = citp_fdtable_lookup(fdinfo->fd);
+  if( newfdi != NULL ) {
+    if( ! app_nonblock ) {
+      int fl = citp_fdinfo_get_ops(newfdi)->fcntl(newfdi, F_GETFL, 0);
+      if( fl >= 0 )
+        citp_fdinfo_get_ops(newfdi)->fcntl(newfdi, F_SETFL,
+                                           fl & ~O_NONBLOCK);
+    }
+    if( newfdi->protocol->type == CITP_TCP_SOCKET ) {
+      citp_sock_fdi* nepi = fdi_to_sock_fdi(newfdi);
+      CITP_STATS_NETIF(++nepi->sock.netif->state->stats.tcp_prewarm_handoffs);
+    }
+    citp_fdinfo_release_ref(newfdi, 0);
+  }
+  return 0;
+
+ fail_release:
+  citp_fdinfo_release_ref(wfdi, 0);
+  return -1;
+}
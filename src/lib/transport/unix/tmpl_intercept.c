@@ -48,6 +48,34 @@ int onload_msg_template_alloc(int fd, const struct iovec* initial_msg,
 }
 
 
+int onload_msg_template_alloc_array(int fd,
+                                    const struct onload_template_msg* msgs,
+                                    int ntemplates,
+                                    onload_template_handle* handles,
+                                    unsigned flags)
+{
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi = NULL;
+  struct oo_msg_template** omt_pp = handles;
+  int rc = 0;
+
+  Log_CALL(ci_log("%s(%d, %p, %d, %p, %d)", __FUNCTION__, fd, msgs,
+                  ntemplates, handles, flags));
+  citp_enter_lib(&lib_context);
+  if( (fdi = citp_fdtable_lookup(fd)) != NULL ) {
+    rc = citp_fdinfo_get_ops(fdi)->
+      tmpl_alloc_array(fdi, msgs, ntemplates, omt_pp, flags);
+    citp_fdinfo_release_ref(fdi, 0);
+  }
+  else {
+    rc = -ESOCKTNOSUPPORT;
+  }
+  citp_exit_lib(&lib_context, TRUE);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
 int
 onload_msg_template_update(int fd, onload_template_handle handle,
                            const struct onload_template_msg_update_iovec* updates,
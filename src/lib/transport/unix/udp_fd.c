@@ -96,6 +96,8 @@ static int citp_udp_socket(int domain, int type, int protocol)
   }
   fdi = &epi->fdinfo;
   citp_fdinfo_init(fdi, &citp_udp_protocol_impl);
+  epi->udp_dests = NULL;
+  epi->udp_dests_n = 0;
 
   rc = citp_netif_alloc_and_init(&fd, &ni);
   if( rc != 0 ) {
@@ -152,7 +154,10 @@ static int citp_udp_socket(int domain, int type, int protocol)
 
 static void citp_udp_dtor(citp_fdinfo* fdinfo, int fdt_locked)
 {
-  citp_netif_release_ref(fdi_to_socket(fdinfo)->netif, fdt_locked);
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdinfo);
+
+  free(epi->udp_dests);
+  citp_netif_release_ref(epi->sock.netif, fdt_locked);
 }
 
 
@@ -394,7 +399,10 @@ static int citp_udp_recvmmsg(citp_fdinfo* fdinfo, struct mmsghdr* msg,
   return ci_udp_recvmmsg(&a, msg, vlen, flags, timeout);
 }
 
-static int citp_udp_recv(citp_fdinfo* fdinfo, struct msghdr* msg, int flags)
+#if ! CI_CFG_STATIC_INTERCEPT
+static
+#endif
+int citp_udp_recv(citp_fdinfo* fdinfo, struct msghdr* msg, int flags)
 {
   citp_sock_fdi* epi = fdi_to_sock_fdi(fdinfo);
   ci_udp_iomsg_args a;
@@ -410,7 +418,10 @@ static int citp_udp_recv(citp_fdinfo* fdinfo, struct msghdr* msg, int flags)
 }
 
 
-static int citp_udp_send(citp_fdinfo* fdinfo, const struct msghdr * msg,
+#if ! CI_CFG_STATIC_INTERCEPT
+static
+#endif
+int citp_udp_send(citp_fdinfo* fdinfo, const struct msghdr * msg,
 			 int flags)
 {
   citp_sock_fdi *epi = fdi_to_sock_fdi(fdinfo);
@@ -441,12 +452,11 @@ static int citp_udp_sendmmsg(citp_fdinfo* fdinfo, struct mmsghdr* mmsg,
 {
   citp_sock_fdi* epi = fdi_to_sock_fdi(fdinfo);
   ci_udp_iomsg_args a;
-  int i, rc;
 
-  Log_V(log(LPF "sendmmsg(%d, msg, %u, %#x)", fdinfo->fd, vlen, 
+  Log_V(log(LPF "sendmmsg(%d, msg, %u, %#x)", fdinfo->fd, vlen,
             (unsigned) flags));
 
-  if( vlen == 0 ) 
+  if( vlen == 0 )
     return 0;
 
   a.ep = &epi->sock;
@@ -454,15 +464,7 @@ static int citp_udp_sendmmsg(citp_fdinfo* fdinfo, struct mmsghdr* mmsg,
   a.ni = epi->sock.netif;
   a.us = SOCK_TO_UDP(epi->sock.s);
 
-  i = 0;
-
-  do {
-    rc = ci_udp_sendmsg(&a, &mmsg[i].msg_hdr, flags);
-    if(CI_LIKELY( rc >= 0 ) )
-      mmsg[i].msg_len = rc;
-    ++i;
-  } while( rc >= 0 && i < vlen );
-  return (rc>=0) ? i : rc;
+  return ci_udp_sendmmsg(&a, mmsg, vlen, flags);
 }
 
 
@@ -616,7 +618,7 @@ static int citp_udp_accept(citp_fdinfo* fdinfo,
 }
 
 
-static int citp_udp_zc_send(citp_fdinfo* fdi, struct onload_zc_mmsg* msg, 
+static int citp_udp_zc_send(citp_fdinfo* fdi, struct onload_zc_mmsg* msg,
                             int flags)
 {
   msg->rc = -EOPNOTSUPP;
@@ -624,6 +626,196 @@ static int citp_udp_zc_send(citp_fdinfo* fdi, struct onload_zc_mmsg* msg,
 }
 
 
+#define CITP_UDP_DEST_MAX  64
+
+/* One pre-registered destination for onload_udp_send_batch().  [ipcache]
+ * holds a snapshot of the socket's [ephemeral_pkt] taken after a send to
+ * this destination: the resolved route plus the prebuilt headers.  It is
+ * copied back in before the next send to the same slot, so that a batch
+ * alternating between registered destinations does not thrash the
+ * socket's single-entry destination cache. */
+struct citp_udp_dest {
+  struct sockaddr_storage addr;
+  socklen_t               addrlen;
+  ci_addr_t               daddr;
+  ci_uint16               dport_be16;
+  int /*bool*/            have_cache;
+  ci_ip_cached_hdrs       ipcache;
+};
+
+
+static int/*bool*/
+citp_udp_dest_matches(ci_udp_state* us, struct citp_udp_dest* dest)
+{
+  return us->ephemeral_pkt.dport_be16 == dest->dport_be16 &&
+         CI_IPX_ADDR_EQ(ipcache_raddr(&us->ephemeral_pkt), dest->daddr);
+}
+
+
+static int citp_udp_dest_register(citp_fdinfo* fdi,
+                                  const struct sockaddr* addr,
+                                  socklen_t addrlen)
+{
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  struct citp_udp_dest* dest;
+
+  if( addr == NULL || addrlen < sizeof(struct sockaddr_in) ||
+      addrlen > sizeof(dest->addr) )
+    return -EINVAL;
+  if( ! (addr->sa_family == AF_INET ||
+         (addr->sa_family == AF_INET6 &&
+          epi->sock.s->domain == AF_INET6)) )
+    return -EAFNOSUPPORT;
+  if( addr->sa_family == AF_INET6 && addrlen < SIN6_LEN_RFC2133 )
+    return -EINVAL;
+
+  if( epi->udp_dests == NULL ) {
+    epi->udp_dests = malloc(sizeof(epi->udp_dests[0]) * CITP_UDP_DEST_MAX);
+    if( epi->udp_dests == NULL )
+      return -ENOMEM;
+    epi->udp_dests_n = 0;
+  }
+  if( epi->udp_dests_n == CITP_UDP_DEST_MAX )
+    return -ENOSPC;
+
+  dest = &epi->udp_dests[epi->udp_dests_n];
+  memset(dest, 0, sizeof(*dest));
+  memcpy(&dest->addr, addr, addrlen);
+  dest->addrlen = addrlen;
+  dest->daddr = ci_get_addr(addr);
+  dest->dport_be16 = ci_get_port(addr);
+  dest->have_cache = 0;
+  return epi->udp_dests_n++;
+}
+
+
+static int citp_udp_send_batch(citp_fdinfo* fdi,
+                               struct onload_udp_send_batch_entry* entries,
+                               int n, int flags)
+{
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  ci_udp_state* us = SOCK_TO_UDP(epi->sock.s);
+  ci_udp_iomsg_args a;
+  int i;
+
+  if( n < 0 || (n > 0 && entries == NULL) )
+    return -EINVAL;
+
+  a.ep = &epi->sock;
+  a.fd = fdi->fd;
+  a.ni = epi->sock.netif;
+  a.us = us;
+
+  for( i = 0; i < n; ++i ) {
+    struct citp_udp_dest* dest;
+    struct msghdr m;
+    int rc;
+
+    if( entries[i].dest < 0 || entries[i].dest >= epi->udp_dests_n ) {
+      entries[i].rc = -EINVAL;
+      break;
+    }
+    dest = &epi->udp_dests[entries[i].dest];
+
+    /* Restore this destination's cached route and header template, so
+     * that ci_udp_sendmsg() hits its destination-cache path even when
+     * the batch alternates between destinations. */
+    if( dest->have_cache && ! citp_udp_dest_matches(us, dest) )
+      us->ephemeral_pkt = dest->ipcache;
+
+    memset(&m, 0, sizeof(m));
+    m.msg_name = &dest->addr;
+    m.msg_namelen = dest->addrlen;
+    m.msg_iov = &entries[i].iov;
+    m.msg_iovlen = 1;
+
+    rc = ci_udp_sendmsg(&a, &m, flags);
+    entries[i].rc = rc >= 0 ? rc : -errno;
+
+    /* Snapshot the (possibly refreshed) destination cache back into the
+     * slot for the next batch. */
+    if( citp_udp_dest_matches(us, dest) ) {
+      dest->ipcache = us->ephemeral_pkt;
+      dest->have_cache = 1;
+    }
+
+    if( rc < 0 )
+      break;
+  }
+
+  if( i == 0 && n > 0 )
+    return entries[0].rc;
+  return i;
+}
+
+
+static int citp_udp_fanout_send(citp_fdinfo* fdi, const struct iovec* iov,
+                                int iovlen, const int* dests, int n_dests,
+                                int flags)
+{
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  ci_udp_state* us = SOCK_TO_UDP(epi->sock.s);
+  ci_addr_t daddrs[CI_UDP_FANOUT_SEND_MAX];
+  ci_uint16 dports[CI_UDP_FANOUT_SEND_MAX];
+  struct citp_udp_dest* slots[CI_UDP_FANOUT_SEND_MAX];
+  ci_udp_iomsg_args a;
+  ci_msghdr m;
+  int i, rc;
+
+  if( iovlen < 0 || (iovlen > 0 && iov == NULL) )
+    return -EINVAL;
+  if( n_dests == 0 && dests == NULL )
+    n_dests = epi->udp_dests_n;
+  if( n_dests <= 0 || n_dests > CI_UDP_FANOUT_SEND_MAX ||
+      (dests == NULL && n_dests > epi->udp_dests_n) )
+    return -EINVAL;
+
+  for( i = 0; i < n_dests; ++i ) {
+    int slot = dests != NULL ? dests[i] : i;
+    if( slot < 0 || slot >= epi->udp_dests_n )
+      return -EINVAL;
+    slots[i] = &epi->udp_dests[slot];
+    daddrs[i] = slots[i]->daddr;
+    dports[i] = slots[i]->dport_be16;
+  }
+
+  a.ep = &epi->sock;
+  a.fd = fdi->fd;
+  a.ni = epi->sock.netif;
+  a.us = us;
+
+  memset(&m, 0, sizeof(m));
+  m.msg_iov = (struct iovec*) iov;
+  m.msg_iovlen = iovlen;
+
+  rc = ci_udp_fanout_send(&a, &m, flags, daddrs, dports, n_dests);
+  if( rc != -EOPNOTSUPP )
+    return rc;
+
+  /* Slow path: one sendmsg per destination, reusing the per-slot route
+   * cache as onload_udp_send_batch() does. */
+  for( i = 0; i < n_dests; ++i ) {
+    struct citp_udp_dest* dest = slots[i];
+
+    if( dest->have_cache && ! citp_udp_dest_matches(us, dest) )
+      us->ephemeral_pkt = dest->ipcache;
+
+    m.msg_name = &dest->addr;
+    m.msg_namelen = dest->addrlen;
+
+    rc = ci_udp_sendmsg(&a, &m, flags);
+    if( rc < 0 )
+      return -errno;
+
+    if( citp_udp_dest_matches(us, dest) ) {
+      dest->ipcache = us->ephemeral_pkt;
+      dest->have_cache = 1;
+    }
+  }
+  return rc;
+}
+
+
 static int citp_udp_zc_recv(citp_fdinfo* fdi, struct onload_zc_recv_args* args)
 {
   citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
@@ -661,6 +853,49 @@ static int citp_udp_zc_recv_filter(citp_fdinfo* fdi,
 }
 
 
+static int
+citp_udp_zc_recv_filter_chain(citp_fdinfo* fdi,
+                              const struct onload_zc_recv_filter_rule* rules,
+                              int rules_len, int flags)
+{
+#if CI_CFG_ZC_RECV_FILTER
+  citp_sock_fdi* epi = fdi_to_sock_fdi(fdi);
+  ci_udp_state* us = SOCK_TO_UDP(epi->sock.s);
+  int i;
+
+  if( rules_len < 0 || rules_len > CI_UDP_RECV_FILTER_RULES_MAX ||
+      (flags & ~ONLOAD_ZC_RECV_FILTER_CHAIN_DROP_MATCH) != 0 )
+    return -EINVAL;
+  if( rules_len > 0 && rules == NULL )
+    return -EINVAL;
+  for( i = 0; i < rules_len; ++i )
+    if( rules[i].onzcfr_len < 1 || rules[i].onzcfr_len > 8 ||
+        rules[i].onzcfr_reserved != 0 ||
+        (rules[i].onzcfr_value & ~rules[i].onzcfr_mask) != 0 )
+      return -EINVAL;
+
+  /* Disable the chain while it is rewritten: the stack may be polled
+   * concurrently by another thread or from the kernel. */
+  us->recv_q_filter_n_rules = 0;
+  ci_wmb();
+  for( i = 0; i < rules_len; ++i ) {
+    us->recv_q_filter_rules[i].offset = rules[i].onzcfr_offset;
+    us->recv_q_filter_rules[i].len = rules[i].onzcfr_len;
+    us->recv_q_filter_rules[i].mask = rules[i].onzcfr_mask;
+    us->recv_q_filter_rules[i].value = rules[i].onzcfr_value;
+  }
+  us->recv_q_filter_flags =
+    (flags & ONLOAD_ZC_RECV_FILTER_CHAIN_DROP_MATCH) ?
+    CI_UDP_RECV_FILTER_F_DROP_MATCH : 0;
+  ci_wmb();
+  us->recv_q_filter_n_rules = rules_len;
+  return 0;
+#else
+  return -ENOSYS;
+#endif
+}
+
+
 static int citp_udp_recvmsg_kernel(citp_fdinfo* fdi, struct msghdr* msg, 
                                    int flags)
 {
@@ -680,6 +915,15 @@ int citp_udp_tmpl_alloc(citp_fdinfo* fdi, const struct iovec* initial_msg,
 }
 
 
+int citp_udp_tmpl_alloc_array(citp_fdinfo* fdi,
+                              const struct onload_template_msg* msgs,
+                              int ntemplates, struct oo_msg_template** handles,
+                              unsigned flags)
+{
+  return -EOPNOTSUPP;
+}
+
+
 int citp_udp_tmpl_update(citp_fdinfo* fdi, struct oo_msg_template* omt,
                          const struct onload_template_msg_update_iovec* updates,
                          int ulen, unsigned flags)
@@ -764,8 +1008,10 @@ citp_protocol_impl citp_udp_protocol_impl = {
     .zc_send     = citp_udp_zc_send,
     .zc_recv     = citp_udp_zc_recv,
     .zc_recv_filter = citp_udp_zc_recv_filter,
+    .zc_recv_filter_chain = citp_udp_zc_recv_filter_chain,
     .recvmsg_kernel = citp_udp_recvmsg_kernel,
     .tmpl_alloc     = citp_udp_tmpl_alloc,
+    .tmpl_alloc_array = citp_udp_tmpl_alloc_array,
     .tmpl_update    = citp_udp_tmpl_update,
     .tmpl_abort     = citp_udp_tmpl_abort,
 #if CI_CFG_TIMESTAMPING
@@ -775,6 +1021,9 @@ citp_protocol_impl citp_udp_protocol_impl = {
 #if CI_CFG_FD_CACHING
     .cache          = citp_nonsock_cache,
 #endif
+    .udp_dest_register = citp_udp_dest_register,
+    .udp_send_batch    = citp_udp_send_batch,
+    .udp_fanout_send   = citp_udp_fanout_send,
   }
 };
 
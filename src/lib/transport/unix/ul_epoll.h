@@ -108,6 +108,10 @@ struct citp_epoll_member {
 #if CI_CFG_EPOLL3
   ci_dllink             dead_stack_link; /*!< Link for dead stack list */
   int                   ready_list_id;
+  /*!< Index into the epoll set's secondary stack table for a non-home
+   * member attached for ready-ring aggregation (EF_EPOLL_MULTI_STACK);
+   * -1 if not attached. */
+  ci_int8               sec_stack_i;
 #endif
   struct epoll_event    epoll_data;
   struct epoll_event    epfd_event; /*!< event synchronised to kernel */
@@ -115,6 +119,12 @@ struct citp_epoll_member {
   int                   fd;         /*!< Onload fd */
   ci_sleep_seq_t        reported_sleep_seq;
 
+  /*!< Poll this member on every Nth poll pass when spinning; 1 polls it on
+   * every pass.  See onload_epoll_set_priority(). */
+  ci_uint16             poll_interval;
+  /*!< Passes remaining until this member is next polled. */
+  ci_uint16             poll_countdown;
+
   int                   flags;
 /*!< indicates after which eitem on ready list socket we should look
  * on other and os sockets */
@@ -188,12 +198,31 @@ struct citp_epoll_fd {
 #if CI_CFG_EPOLL3
   ci_netif* home_stack;
   int ready_list;
+
+  /* Non-home stacks attached for readiness aggregation
+   * (EF_EPOLL_MULTI_STACK).  Each attached stack donates a ready list
+   * whose shared ring lets one spin loop cover all stacks without
+   * polling every non-home member linearly.
+   */
+#define CITP_EPOLL_MAX_SEC_STACKS 4
+  ci_netif* sec_stack[CITP_EPOLL_MAX_SEC_STACKS];
+  ci_int8   sec_ready_list[CITP_EPOLL_MAX_SEC_STACKS];
+  int       n_sec_stacks;
 #endif
 
   /*!< phase of the poll to ensure fairness between groups of sockets
    * value of highest bit matters */
   int phase;
 
+  /* User-space timer (onload_epoll_timer_arm()).  [timer_deadline_frc] is
+   * the expiry time in frc ticks, 0 when disarmed.  Expiry is noticed by
+   * epoll_wait() from the timestamps it already takes and delivered as an
+   * EPOLLIN event carrying [timer_data]; blocking waits clamp their
+   * timeout to the deadline.  No timerfd is involved. */
+  ci_uint64 timer_deadline_frc;
+  ci_uint64 timer_interval_frc; /* 0 => one-shot */
+  ci_uint64 timer_data;
+
 #if CI_CFG_TIMESTAMPING
   /* When using WODA with large numbers of sockets performance can be harmed
    * by repeated large alloc/free calls, so we cache memory allocated for this
@@ -250,6 +279,18 @@ struct oo_ul_epoll_state {
   /* Whether or not this call should spin */
   unsigned              ul_epoll_spin;
 
+  /* Number of poll passes made by this call.  Members with
+   * [poll_interval] > 1 are only polled on every Nth pass after the
+   * first, so a non-spinning call still polls every member. */
+  ci_uint32             poll_pass;
+
+#if CI_CFG_EPOLL3
+  /* Bitmap of secondary stacks whose ready ring was drained cleanly on
+   * this poll pass; members of those stacks need not be polled linearly.
+   */
+  ci_uint32             sec_ring_ok;
+#endif
+
   /* We have found some EPOLLET or EPOLLONESHOT events, and they can not be
    * dropped. */
   int                   has_epollet;
@@ -276,10 +317,25 @@ static inline ci_int64 oo_epoll_ms_to_frc(int ms_timeout)
     return (ci_int64)ms_timeout * citp.cpu_khz;
 }
 
+static inline ci_uint64 oo_epoll_us_to_frc(ci_int64 us)
+{
+  return (ci_uint64)us * citp.cpu_khz / 1000;
+}
+
 
 extern int citp_epoll_create(int size, int flags) CI_HF;
 extern int citp_epoll_ctl(citp_fdinfo* fdi, int op, int fd,
                           struct epoll_event *event) CI_HF;
+extern int citp_epoll_set_priority(citp_fdinfo* fdi, int fd,
+                                   int priority) CI_HF;
+struct onload_epoll_ctl_op;
+extern int citp_epoll_ctl_batch(citp_fdinfo* fdi,
+                                struct onload_epoll_ctl_op* ops,
+                                int n_ops) CI_HF;
+extern int citp_epoll_timer_arm(citp_fdinfo* fdi, ci_int64 timeout_us,
+                                ci_int64 interval_us,
+                                ci_uint64 data) CI_HF;
+extern int citp_epoll_timer_cancel(citp_fdinfo* fdi) CI_HF;
 extern int citp_epoll_wait(citp_fdinfo*, struct epoll_event*,
                            struct citp_ordered_wait* ordering, int maxev,
                            ci_int64 timeout_hr, const sigset_t *sigmask,
@@ -21,10 +21,16 @@ void oo_wqlock_init(struct oo_wqlock* wql)
   pthread_cond_init(&wql->cond, NULL);
 }
 
+static struct oo_wqlock_work_stats oo_wqlock_stats;
+
+
 void oo_wqlock_work_do(struct oo_wqlock_work* work_list, void *unlock_param)
 {
+  struct oo_wqlock_work* head[OO_WQLOCK_WORK_NTYPES];
+  struct oo_wqlock_work* tail[OO_WQLOCK_WORK_NTYPES];
   struct oo_wqlock_work* work;
   struct oo_wqlock_work* work_rev = NULL;
+  int type;
 
   /* Reverse the list */
   do {
@@ -34,13 +40,40 @@ void oo_wqlock_work_do(struct oo_wqlock_work* work_list, void *unlock_param)
     work_rev = work;
   } while( work_list != NULL );
 
+  /* Partition into per-type lists, preserving queueing order within each
+   * type.  Each type's handler then runs back-to-back over its whole
+   * batch rather than interleaving with other handlers. */
+  for( type = 0; type < OO_WQLOCK_WORK_NTYPES; ++type )
+    head[type] = tail[type] = NULL;
   do {
     work = work_rev;
     work_rev = work->next;
-    /* work->fn() call can free the "work" structure or spoil it in any
-     * other way, so we save work->next pointer above. */
-    work->fn(work, unlock_param);
+    type = work->type;
+    ci_assert_lt((unsigned) type, OO_WQLOCK_WORK_NTYPES);
+    work->next = NULL;
+    if( head[type] == NULL )
+      head[type] = work;
+    else
+      tail[type]->next = work;
+    tail[type] = work;
+    ++oo_wqlock_stats.items[type];
   } while( work_rev != NULL );
+  ++oo_wqlock_stats.batches;
+
+  for( type = 0; type < OO_WQLOCK_WORK_NTYPES; ++type )
+    for( work = head[type]; work != NULL; ) {
+      struct oo_wqlock_work* next = work->next;
+      /* work->fn() call can free the "work" structure or spoil it in any
+       * other way, so we save work->next pointer above. */
+      work->fn(work, unlock_param);
+      work = next;
+    }
+}
+
+
+void oo_wqlock_work_stats_get(struct oo_wqlock_work_stats* stats)
+{
+  *stats = oo_wqlock_stats;
 }
 
 void oo_wqlock_lock_slow(struct oo_wqlock* wql)
@@ -656,3 +656,190 @@ onload_zc_hlrx_recv_oob(struct onload_zc_hlrx* hlrx,
   memcpy(buf, hlrx->oob_buffer, len);
   return len;
 }
+
+
+/* *********************************************************************** */
+
+/* Pool of per-socket hlrx states, keyed by fd.  A simple chained hash
+ * table: fd churn is rare relative to recv calls, so lookup cost is what
+ * matters. */
+
+struct hlrx_pool_entry {
+  int fd;
+  struct onload_zc_hlrx* hlrx;
+  struct hlrx_pool_entry* next;
+};
+
+struct onload_zc_hlrx_pool {
+  struct hlrx_pool_entry** buckets;
+  unsigned nbuckets;   /* always a power of two */
+  unsigned nentries;
+};
+
+#define HLRX_POOL_MIN_BUCKETS 16
+
+static inline unsigned hlrx_pool_bucket(const struct onload_zc_hlrx_pool* pool,
+                                        int fd)
+{
+  return (unsigned)fd & (pool->nbuckets - 1);
+}
+
+
+int onload_zc_hlrx_pool_alloc(int flags,
+                              struct onload_zc_hlrx_pool** pool_out)
+{
+  struct onload_zc_hlrx_pool* pool;
+  int rc = 0;
+
+  Log_CALL(ci_log("%s(%d, %p)", __FUNCTION__, flags, pool_out));
+
+  if( flags != 0 ) {
+    rc = -EINVAL;
+  }
+  else {
+    pool = calloc(1, sizeof(*pool));
+    if( pool )
+      pool->buckets = calloc(HLRX_POOL_MIN_BUCKETS, sizeof(*pool->buckets));
+    if( ! pool || ! pool->buckets ) {
+      free(pool);
+      rc = -ENOMEM;
+    }
+    else {
+      pool->nbuckets = HLRX_POOL_MIN_BUCKETS;
+      *pool_out = pool;
+    }
+  }
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_zc_hlrx_pool_free(struct onload_zc_hlrx_pool* pool)
+{
+  struct hlrx_pool_entry* entry;
+  unsigned i;
+  int rc;
+
+  Log_CALL(ci_log("%s(%p)", __FUNCTION__, pool));
+
+  /* Free the member states only once we know they can all be freed, so
+   * that failure leaves the pool intact. */
+  for( i = 0; i < pool->nbuckets; ++i )
+    for( entry = pool->buckets[i]; entry; entry = entry->next ) {
+      struct hlrx_remote_ring* ring = &entry->hlrx->remote_ring;
+      size_t r;
+      for( r = ring->removed; r != ring->added;
+           r = remote_ring_inc(ring, r) )
+        if( ! (*remote_ring_entry(ring, r) & HLRX_REMOTE_PTR_DONE_FLAG) ) {
+          Log_E(ci_log("%s: remote ZC blocks remain unfreed", __FUNCTION__));
+          Log_CALL_RESULT(-EBUSY);
+          return -EBUSY;
+        }
+    }
+
+  rc = 0;
+  for( i = 0; i < pool->nbuckets; ++i ) {
+    while( (entry = pool->buckets[i]) != NULL ) {
+      pool->buckets[i] = entry->next;
+      rc = onload_zc_hlrx_free(entry->hlrx);
+      ci_assert_equal(rc, 0);
+      free(entry);
+    }
+  }
+  free(pool->buckets);
+  free(pool);
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+static int hlrx_pool_grow(struct onload_zc_hlrx_pool* pool)
+{
+  unsigned nbuckets = pool->nbuckets * 2;
+  struct hlrx_pool_entry** buckets;
+  unsigned i;
+
+  buckets = calloc(nbuckets, sizeof(*buckets));
+  if( ! buckets )
+    return -ENOMEM;
+  for( i = 0; i < pool->nbuckets; ++i ) {
+    struct hlrx_pool_entry* entry;
+    while( (entry = pool->buckets[i]) != NULL ) {
+      unsigned b = (unsigned)entry->fd & (nbuckets - 1);
+      pool->buckets[i] = entry->next;
+      entry->next = buckets[b];
+      buckets[b] = entry;
+    }
+  }
+  free(pool->buckets);
+  pool->buckets = buckets;
+  pool->nbuckets = nbuckets;
+  return 0;
+}
+
+
+int onload_zc_hlrx_pool_get(struct onload_zc_hlrx_pool* pool, int fd,
+                            struct onload_zc_hlrx** hlrx_out)
+{
+  struct hlrx_pool_entry* entry;
+  int rc = 0;
+
+  for( entry = pool->buckets[hlrx_pool_bucket(pool, fd)]; entry;
+       entry = entry->next )
+    if( entry->fd == fd ) {
+      *hlrx_out = entry->hlrx;
+      return 0;
+    }
+
+  Log_CALL(ci_log("%s(%p, %d, %p)", __FUNCTION__, pool, fd, hlrx_out));
+
+  if( pool->nentries >= pool->nbuckets &&
+      (rc = hlrx_pool_grow(pool)) < 0 ) {
+    Log_CALL_RESULT(rc);
+    return rc;
+  }
+
+  entry = malloc(sizeof(*entry));
+  if( ! entry )
+    rc = -ENOMEM;
+  else if( (rc = onload_zc_hlrx_alloc(fd, 0, &entry->hlrx)) < 0 )
+    free(entry);
+  else {
+    unsigned b = hlrx_pool_bucket(pool, fd);
+    entry->fd = fd;
+    entry->next = pool->buckets[b];
+    pool->buckets[b] = entry;
+    ++pool->nentries;
+    *hlrx_out = entry->hlrx;
+  }
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
+int onload_zc_hlrx_pool_put(struct onload_zc_hlrx_pool* pool, int fd)
+{
+  struct hlrx_pool_entry** pentry;
+  struct hlrx_pool_entry* entry;
+  int rc = -ENOENT;
+
+  Log_CALL(ci_log("%s(%p, %d)", __FUNCTION__, pool, fd));
+
+  for( pentry = &pool->buckets[hlrx_pool_bucket(pool, fd)];
+       (entry = *pentry) != NULL; pentry = &entry->next )
+    if( entry->fd == fd ) {
+      rc = onload_zc_hlrx_free(entry->hlrx);
+      if( rc == 0 ) {
+        *pentry = entry->next;
+        free(entry);
+        --pool->nentries;
+      }
+      break;
+    }
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
@@ -338,6 +338,67 @@ int onload_zc_recv(int fd, struct onload_zc_recv_args* args)
 }
 
 
+struct zc_recv_many_state {
+  struct onload_zc_recv_args args;
+  onload_zc_recv_many_callback cb;
+  int cur_fd;
+  int terminated;
+};
+
+
+static enum onload_zc_callback_rc
+zc_recv_many_trampoline(struct onload_zc_recv_args* args, int flags)
+{
+  struct zc_recv_many_state* state =
+    CI_CONTAINER(struct zc_recv_many_state, args, args);
+  enum onload_zc_callback_rc rc = state->cb(args, state->cur_fd, flags);
+  if( rc & ONLOAD_ZC_TERMINATE )
+    state->terminated = 1;
+  return rc;
+}
+
+
+int onload_zc_recv_many(struct onload_zc_recv_many_sock* socks, int n_socks,
+                        struct onload_zc_recv_args* args,
+                        onload_zc_recv_many_callback cb)
+{
+  struct zc_recv_many_state state;
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+  int i, done = 0;
+
+  Log_CALL(ci_log("%s(%p, %d, %p, %p)", __FUNCTION__, socks, n_socks,
+                  args, cb));
+
+  state.args = *args;
+  state.args.cb = zc_recv_many_trampoline;
+  state.args.flags |= ONLOAD_MSG_DONTWAIT;
+  state.cb = cb;
+  state.terminated = 0;
+
+  citp_enter_lib(&lib_context);
+
+  for( i = 0; i < n_socks; ++i ) {
+    state.cur_fd = socks[i].fd;
+    fdi = citp_fdtable_lookup(socks[i].fd);
+    if( fdi != NULL ) {
+      socks[i].rc = citp_fdinfo_get_ops(fdi)->zc_recv(fdi, &state.args);
+      citp_fdinfo_release_ref(fdi, 0);
+    }
+    else {
+      socks[i].rc = -ESOCKTNOSUPPORT;
+    }
+    ++done;
+    if( state.terminated )
+      break;
+  }
+
+  citp_exit_lib(&lib_context, TRUE);
+
+  Log_CALL_RESULT(done);
+  return done;
+}
+
 
 int onload_zc_send(struct onload_zc_mmsg* msgs, int mlen, int flags)
 {
@@ -410,6 +471,32 @@ int onload_set_recv_filter(int fd, onload_zc_recv_filter_callback filter,
 }
 
 
+int onload_set_recv_filter_chain(int fd,
+                                 const struct onload_zc_recv_filter_rule*
+                                 rules, int rules_len, int flags)
+{
+  int rc;
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi;
+
+  Log_CALL(ci_log("%s(%d, %p, %d, %x)", __FUNCTION__, fd, rules,
+                  rules_len, flags));
+
+  if( (fdi = citp_fdtable_lookup_fast(&lib_context, fd)) ) {
+    rc = citp_fdinfo_get_ops(fdi)->zc_recv_filter_chain(fdi, rules,
+                                                        rules_len, flags);
+    citp_fdinfo_release_ref_fast(fdi);
+    citp_exit_lib(&lib_context, rc >= 0);
+  } else {
+    citp_exit_lib_if(&lib_context, TRUE);
+    rc = -ESOCKTNOSUPPORT;
+  }
+
+  Log_CALL_RESULT(rc);
+  return rc;
+}
+
+
 static bool is_page_aligned(uint64_t v)
 {
   return (v & (CI_PAGE_SIZE - 1)) == 0;
@@ -469,7 +556,10 @@ int onload_zc_register_buffers(int fd, ef_addrspace addr_space,
 
   citp_enter_lib(&lib_context);
 
-  if( flags )
+  if( flags & ~(ONLOAD_ZC_REGISTER_SEND_ONLY | ONLOAD_ZC_REGISTER_ON_DEMAND) )
+    rc = -EINVAL;
+  else if( (flags & ONLOAD_ZC_REGISTER_ON_DEMAND) &&
+           addr_space != EF_ADDRSPACE_LOCAL )
     rc = -EINVAL;
   else if( addr_space == EF_ADDRSPACE_LOCAL &&
            (base_ptr == 0 || ! is_page_aligned(base_ptr)) )
@@ -498,11 +588,35 @@ int onload_zc_register_buffers(int fd, ef_addrspace addr_space,
       um->addr_space = addr_space;
       um->base = base_ptr;
       um->size = len;
-
-      if( addr_space == EF_ADDRSPACE_LOCAL )
+      um->lazy_chunk_pages = 0;
+      um->chunk_kernel_ids = NULL;
+
+      if( flags & ONLOAD_ZC_REGISTER_ON_DEMAND ) {
+        /* Declare only: each 2MB chunk gets its own memreg the first time
+         * a send references it (see ci_zc_usermem_demand_register()). */
+        uint32_t c;
+        um->lazy_chunk_pages =
+            CI_ZC_USERMEM_CHUNK_BYTES >> EF_VI_NIC_PAGE_SHIFT;
+        um->lazy_n_chunks = (len + CI_ZC_USERMEM_CHUNK_BYTES - 1) /
+                            CI_ZC_USERMEM_CHUNK_BYTES;
+        um->lazy_reg_flags = (flags & ONLOAD_ZC_REGISTER_SEND_ONLY) ?
+                             OO_ZC_REGISTER_BUFFERS_SEND_ONLY : 0;
+        um->chunk_kernel_ids = malloc(sizeof(um->chunk_kernel_ids[0]) *
+                                      um->lazy_n_chunks);
+        if( um->chunk_kernel_ids == NULL )
+          rc = -ENOMEM;
+        else
+          for( c = 0; c < um->lazy_n_chunks; ++c )
+            um->chunk_kernel_ids[c] = CI_ZC_USERMEM_CHUNK_UNREG;
+      }
+      else if( addr_space == EF_ADDRSPACE_LOCAL )
         rc = ci_tcp_helper_zc_register_buffers(ni, (void*)(uintptr_t)base_ptr,
-                                               num_pages, um->hw_addrs,
-                                               &um->kernel_id);
+                                               num_pages,
+                                               (flags &
+                                                ONLOAD_ZC_REGISTER_SEND_ONLY) ?
+                                               OO_ZC_REGISTER_BUFFERS_SEND_ONLY
+                                               : 0,
+                                               um->hw_addrs, &um->kernel_id);
 
       if( rc == 0 )
         *handle = zc_usermem_to_handle(um);
@@ -537,11 +651,27 @@ int onload_zc_unregister_buffers(int fd, onload_zc_handle handle, int flags)
   else if( (rc = fd_to_stack(fd, &ni, &fdi)) == 0 ) {
     struct ci_zc_usermem* um = zc_handle_to_usermem(handle);
 
-    if( um->addr_space == EF_ADDRSPACE_LOCAL )
-      rc = ci_tcp_helper_zc_unregister_buffers(ni, um->kernel_id);
+    if( um->addr_space == EF_ADDRSPACE_LOCAL ) {
+      if( um->lazy_chunk_pages != 0 ) {
+        /* Unregister whichever chunks got registered on demand, keeping
+         * the first error but still attempting the rest. */
+        uint32_t c;
+        for( c = 0; c < um->lazy_n_chunks; ++c )
+          if( um->chunk_kernel_ids[c] != CI_ZC_USERMEM_CHUNK_UNREG ) {
+            int rc1 = ci_tcp_helper_zc_unregister_buffers(
+                                                ni, um->chunk_kernel_ids[c]);
+            if( rc1 < 0 && rc == 0 )
+              rc = rc1;
+          }
+      }
+      else
+        rc = ci_tcp_helper_zc_unregister_buffers(ni, um->kernel_id);
+    }
 
-    if( rc == 0 )
+    if( rc == 0 ) {
+      free(um->chunk_kernel_ids);
       free(um);
+    }
 
     citp_fdinfo_release_ref(fdi, 0);
   }
@@ -609,3 +739,88 @@ int onload_zc_buffer_decref(int fd, onload_zc_handle buf)
   Log_CALL_RESULT(rc);
   return rc;
 }
+
+
+int onload_zc_splice(int fd_in, int fd_out, size_t len, int flags)
+{
+  int rc;
+  citp_lib_context_t lib_context;
+  citp_fdinfo* fdi_in;
+  citp_fdinfo* fdi_out;
+  citp_sock_fdi* epi_in;
+  citp_sock_fdi* epi_out;
+  ci_netif* ni;
+  ci_netif* ni_out;
+  ci_tcp_state* ts_in;
+  ci_tcp_state* ts_out;
+  ci_tcp_state* lock_first;
+  ci_tcp_state* lock_second;
+
+  Log_CALL(ci_log("%s(%d, %d, %zu, %x)", __FUNCTION__, fd_in, fd_out, len,
+                  flags));
+
+  if( flags != 0 )
+    return -EINVAL;
+  if( len > INT_MAX )
+    len = INT_MAX;
+
+  citp_enter_lib(&lib_context);
+
+  rc = fd_to_stack(fd_in, &ni, &fdi_in);
+  if( rc != 0 )
+    goto out;
+  rc = fd_to_stack(fd_out, &ni_out, &fdi_out);
+  if( rc != 0 )
+    goto release_in;
+
+  epi_in = fdi_to_sock_fdi(fdi_in);
+  epi_out = fdi_to_sock_fdi(fdi_out);
+
+  if( ni != ni_out ) {
+    /* Only intra-stack moves are possible: packet buffers belong to their
+     * stack's buffer pool. */
+    rc = -EXDEV;
+    goto release_both;
+  }
+  if( ! (epi_in->sock.s->b.state & CI_TCP_STATE_TCP_CONN) ||
+      ! (epi_out->sock.s->b.state & CI_TCP_STATE_TCP_CONN) ) {
+    rc = -ENOTCONN;
+    goto release_both;
+  }
+
+  ts_in = SOCK_TO_TCP(epi_in->sock.s);
+  ts_out = SOCK_TO_TCP(epi_out->sock.s);
+  if( ts_in == ts_out ) {
+    rc = -EINVAL;
+    goto release_both;
+  }
+
+  /* Take the socket locks in a consistent order so that two threads
+   * splicing in opposite directions cannot deadlock. */
+  if( S_SP(ts_in) < S_SP(ts_out) ) {
+    lock_first = ts_in;
+    lock_second = ts_out;
+  }
+  else {
+    lock_first = ts_out;
+    lock_second = ts_in;
+  }
+  ci_sock_lock(ni, &lock_first->s.b);
+  ci_sock_lock(ni, &lock_second->s.b);
+  ci_netif_lock(ni);
+
+  rc = ci_tcp_splice(ni, ts_in, ts_out, len);
+
+  ci_netif_unlock(ni);
+  ci_sock_unlock(ni, &lock_second->s.b);
+  ci_sock_unlock(ni, &lock_first->s.b);
+
+ release_both:
+  citp_fdinfo_release_ref(fdi_out, 0);
+ release_in:
+  citp_fdinfo_release_ref(fdi_in, 0);
+ out:
+  citp_exit_lib(&lib_context, TRUE);
+  Log_CALL_RESULT(rc);
+  return rc;
+}
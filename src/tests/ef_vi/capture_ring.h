@@ -0,0 +1,317 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* capture_ring.h
+ *
+ * Library for a memory-mapped, recycled capture ring file.
+ *
+ * Writing captured packets out with write(2) cannot keep up with a
+ * packed-stream capture at high line rates: the per-packet (or even
+ * per-buffer) syscall and copy-to-kernel cost dominates.  This library
+ * defines an on-disk format that lets a capture tool (e.g. efcapture)
+ * land packed-stream buffers in the file with plain memcpy() into a
+ * shared mapping -- every write is a page-cache write and the kernel
+ * does the flushing asynchronously.
+ *
+ * Two files make up a capture:
+ *
+ *  - the data file: a header page, a chunk generation table, then a ring
+ *    of fixed-size chunks.  Each chunk holds the verbatim contents of
+ *    one packed-stream buffer, so intra-buffer packet layout (and hence
+ *    packet payload offsets) are preserved.  The ring recycles: chunk
+ *    [seq % n_chunks] is overwritten when the writer wraps.
+ *
+ *  - the index file ("<data-file>.idx"): a header page then a ring of
+ *    fixed 32-byte records, one per captured packet, carrying everything
+ *    a pcapng Enhanced Packet Block needs (timestamp, captured and
+ *    original lengths, flags) plus the payload's offset in the data
+ *    file.  A converter (e.g. efcapture_dump) can emit pcapng without
+ *    parsing packed-stream headers.
+ *
+ * Consistency follows the efrink.h generation-counter scheme.  Each
+ * chunk has a generation counter in the data file: odd while the writer
+ * is filling the chunk, even once it is complete.  Each index record
+ * stores the even generation its chunk will have when complete; a
+ * record is valid iff the chunk's counter equals the record's.  Readers
+ * re-check the counter after copying payload out to detect recycling
+ * races.  The index header's wr_record counter is published with a
+ * write barrier after the records it covers.
+ *
+ * Only packets in completed chunks are visible to readers: the index
+ * trails the capture by at most one packed-stream buffer.
+ */
+#ifndef __CAPTURE_RING_H__
+#define __CAPTURE_RING_H__
+
+#include <ci/tools.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+
+#define CAPTURE_RING_MAGIC      0x52704143u   /* "CApR" */
+#define CAPTURE_INDEX_MAGIC     0x49704143u   /* "CApI" */
+#define CAPTURE_RING_VERSION    1u
+
+#define CAPTURE_PAGE_SIZE       4096u
+
+
+/* Data file header; resides in the file's first page. */
+struct capture_ring_hdr {
+  uint32_t  magic;          /* CAPTURE_RING_MAGIC */
+  uint32_t  version;        /* CAPTURE_RING_VERSION */
+  uint32_t  chunk_size;     /* bytes per chunk (the packed-stream
+                               buffer size) */
+  uint32_t  n_chunks;       /* chunks in the ring */
+  uint64_t  gen_off;        /* file offset of the generation table */
+  uint64_t  data_off;       /* file offset of chunk 0 */
+  /* Sequence number of the chunk the writer will fill next; chunks
+   * [wr_chunk - n_chunks, wr_chunk) may hold data. */
+  volatile uint64_t  wr_chunk;
+};
+
+
+/* Index file header; resides in the file's first page. */
+struct capture_index_hdr {
+  uint32_t  magic;          /* CAPTURE_INDEX_MAGIC */
+  uint32_t  version;        /* CAPTURE_RING_VERSION */
+  uint32_t  record_size;    /* sizeof(struct capture_record) */
+  uint32_t  n_records;      /* records in the ring */
+  uint64_t  records_off;    /* file offset of record 0 */
+  /* Sequence number of the next record to be written; records
+   * [wr_record - n_records, wr_record) may be valid. */
+  volatile uint64_t  wr_record;
+};
+
+
+/* One captured packet.  Field for field this is what a pcapng Enhanced
+ * Packet Block needs, plus the location and validity information. */
+struct capture_record {
+  uint64_t  data_off;       /* payload offset in the data file */
+  uint32_t  cap_len;        /* bytes captured */
+  uint32_t  orig_len;       /* original wire length */
+  uint32_t  ts_sec;         /* hardware timestamp (if enabled) */
+  uint32_t  ts_nsec;
+  uint16_t  flags;          /* EF_VI_PS_FLAG_* */
+  uint16_t  pad;
+  /* Generation the payload's chunk holds while this record is valid */
+  uint32_t  chunk_gen;
+};
+
+
+struct capture_ring {
+  struct capture_ring_hdr*   hdr;
+  struct capture_index_hdr*  idx_hdr;
+  volatile uint64_t*         chunk_gen;  /* [n_chunks] */
+  char*                      data;       /* chunk 0 */
+  struct capture_record*     records;    /* record 0 */
+  size_t                     data_map_len;
+  size_t                     idx_map_len;
+};
+
+
+static inline uint64_t capture_round_up(uint64_t v, uint64_t align)
+{
+  return (v + align - 1) & ~(align - 1);
+}
+
+
+/* Lay out and map a capture: the data file at [path] and its index at
+ * "[path].idx".  Both are truncated to their full size up front so the
+ * writer never extends them.  Returns 0 on success, -1 with a message on
+ * stderr otherwise. */
+static inline int capture_ring_create(struct capture_ring* cr,
+                                      const char* path,
+                                      unsigned chunk_size, unsigned n_chunks,
+                                      unsigned n_records)
+{
+  char idx_path[512];
+  uint64_t gen_off, data_off, records_off;
+  int fd, idx_fd;
+
+  gen_off = capture_round_up(sizeof(struct capture_ring_hdr),
+                             sizeof(uint64_t));
+  data_off = capture_round_up(gen_off + n_chunks * sizeof(uint64_t),
+                              CAPTURE_PAGE_SIZE);
+  cr->data_map_len = data_off + (uint64_t) n_chunks * chunk_size;
+
+  records_off = CAPTURE_PAGE_SIZE;
+  cr->idx_map_len = records_off +
+                    (uint64_t) n_records * sizeof(struct capture_record);
+
+  if( snprintf(idx_path, sizeof(idx_path), "%s.idx", path) >=
+      (int) sizeof(idx_path) ) {
+    fprintf(stderr, "ERROR: capture path too long\n");
+    return -1;
+  }
+
+  fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  idx_fd = open(idx_path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if( fd < 0 || idx_fd < 0 ||
+      ftruncate(fd, cr->data_map_len) < 0 ||
+      ftruncate(idx_fd, cr->idx_map_len) < 0 ) {
+    fprintf(stderr, "ERROR: failed to create %s (+.idx)\n", path);
+    return -1;
+  }
+
+  cr->hdr = mmap(NULL, cr->data_map_len, PROT_READ | PROT_WRITE,
+                 MAP_SHARED, fd, 0);
+  cr->idx_hdr = mmap(NULL, cr->idx_map_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED, idx_fd, 0);
+  close(fd);
+  close(idx_fd);
+  if( cr->hdr == MAP_FAILED || cr->idx_hdr == MAP_FAILED ) {
+    fprintf(stderr, "ERROR: failed to map %s (+.idx)\n", path);
+    return -1;
+  }
+
+  cr->chunk_gen = (volatile uint64_t*) ((char*) cr->hdr + gen_off);
+  cr->data = (char*) cr->hdr + data_off;
+  cr->records = (struct capture_record*) ((char*) cr->idx_hdr + records_off);
+
+  cr->hdr->version = CAPTURE_RING_VERSION;
+  cr->hdr->chunk_size = chunk_size;
+  cr->hdr->n_chunks = n_chunks;
+  cr->hdr->gen_off = gen_off;
+  cr->hdr->data_off = data_off;
+  cr->hdr->wr_chunk = 0;
+
+  cr->idx_hdr->version = CAPTURE_RING_VERSION;
+  cr->idx_hdr->record_size = sizeof(struct capture_record);
+  cr->idx_hdr->n_records = n_records;
+  cr->idx_hdr->records_off = records_off;
+  cr->idx_hdr->wr_record = 0;
+
+  /* Publish the magics last so a reader never sees a half-written
+   * header. */
+  ci_wmb();
+  cr->hdr->magic = CAPTURE_RING_MAGIC;
+  cr->idx_hdr->magic = CAPTURE_INDEX_MAGIC;
+  return 0;
+}
+
+
+/* Map an existing capture read-only (for converters/readers). */
+static inline int capture_ring_open_ro(struct capture_ring* cr,
+                                       const char* path)
+{
+  struct capture_ring_hdr hdr;
+  struct capture_index_hdr idx_hdr;
+  char idx_path[512];
+  int fd, idx_fd;
+
+  if( snprintf(idx_path, sizeof(idx_path), "%s.idx", path) >=
+      (int) sizeof(idx_path) ) {
+    fprintf(stderr, "ERROR: capture path too long\n");
+    return -1;
+  }
+
+  fd = open(path, O_RDONLY);
+  idx_fd = open(idx_path, O_RDONLY);
+  if( fd < 0 || idx_fd < 0 ||
+      read(fd, &hdr, sizeof(hdr)) != sizeof(hdr) ||
+      read(idx_fd, &idx_hdr, sizeof(idx_hdr)) != sizeof(idx_hdr) ) {
+    fprintf(stderr, "ERROR: failed to open %s (+.idx)\n", path);
+    return -1;
+  }
+  if( hdr.magic != CAPTURE_RING_MAGIC ||
+      idx_hdr.magic != CAPTURE_INDEX_MAGIC ||
+      hdr.version != CAPTURE_RING_VERSION ||
+      idx_hdr.record_size != sizeof(struct capture_record) ) {
+    fprintf(stderr, "ERROR: %s is not a capture ring (or wrong version)\n",
+            path);
+    return -1;
+  }
+
+  cr->data_map_len = hdr.data_off + (uint64_t) hdr.n_chunks * hdr.chunk_size;
+  cr->idx_map_len = idx_hdr.records_off +
+                    (uint64_t) idx_hdr.n_records *
+                    sizeof(struct capture_record);
+
+  cr->hdr = mmap(NULL, cr->data_map_len, PROT_READ, MAP_SHARED, fd, 0);
+  cr->idx_hdr = mmap(NULL, cr->idx_map_len, PROT_READ, MAP_SHARED, idx_fd, 0);
+  close(fd);
+  close(idx_fd);
+  if( cr->hdr == MAP_FAILED || cr->idx_hdr == MAP_FAILED ) {
+    fprintf(stderr, "ERROR: failed to map %s (+.idx)\n", path);
+    return -1;
+  }
+
+  cr->chunk_gen = (volatile uint64_t*) ((char*) cr->hdr + cr->hdr->gen_off);
+  cr->data = (char*) cr->hdr + cr->hdr->data_off;
+  cr->records = (struct capture_record*)
+                ((char*) cr->idx_hdr + cr->idx_hdr->records_off);
+  return 0;
+}
+
+
+/* Writer: start filling the next chunk.  Returns a pointer to the
+ * chunk's bytes; [gen_out] is the generation to store in the chunk's
+ * index records (the even value the chunk takes when completed). */
+static inline char* capture_chunk_open(struct capture_ring* cr,
+                                       uint32_t* gen_out)
+{
+  unsigned i = cr->hdr->wr_chunk % cr->hdr->n_chunks;
+  assert( ! (cr->chunk_gen[i] & 1) );
+  ++cr->chunk_gen[i];
+  /* Invalidate the chunk before overwriting its data */
+  ci_wmb();
+  *gen_out = cr->chunk_gen[i] + 1;
+  return cr->data + (uint64_t) i * cr->hdr->chunk_size;
+}
+
+
+/* Writer: the current chunk is complete; make its records valid. */
+static inline void capture_chunk_close(struct capture_ring* cr)
+{
+  unsigned i = cr->hdr->wr_chunk % cr->hdr->n_chunks;
+  assert( cr->chunk_gen[i] & 1 );
+  /* Complete the data before validating the chunk */
+  ci_wmb();
+  ++cr->chunk_gen[i];
+  ++cr->hdr->wr_chunk;
+}
+
+
+/* Writer: append one index record.  Call capture_index_publish() once
+ * the records for a batch are in place. */
+static inline void capture_index_append(struct capture_ring* cr,
+                                        uint64_t seq,
+                                        const struct capture_record* rec)
+{
+  cr->records[seq % cr->idx_hdr->n_records] = *rec;
+}
+
+static inline void capture_index_publish(struct capture_ring* cr,
+                                         uint64_t wr_record)
+{
+  /* Complete the records before publishing them */
+  ci_wmb();
+  cr->idx_hdr->wr_record = wr_record;
+}
+
+
+/* Reader: copy the payload for [rec] into [dst].  Returns 0 on success,
+ * -1 if the chunk was recycled (before or during the copy). */
+static inline int capture_read_payload(const struct capture_ring* cr,
+                                       const struct capture_record* rec,
+                                       void* dst)
+{
+  unsigned i = (rec->data_off - cr->hdr->data_off) / cr->hdr->chunk_size;
+
+  if( cr->chunk_gen[i] != rec->chunk_gen )
+    return -1;
+  ci_rmb();
+  memcpy(dst, (char*) cr->hdr + rec->data_off, rec->cap_len);
+  /* Check the data we copied was not overwritten while copying */
+  ci_rmb();
+  if( cr->chunk_gen[i] != rec->chunk_gen )
+    return -1;
+  return 0;
+}
+
+#endif  /* __CAPTURE_RING_H__ */
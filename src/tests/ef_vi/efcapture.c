@@ -0,0 +1,334 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* efcapture
+ *
+ * Capture packets to a memory-mapped ring file using "packed stream"
+ * mode.
+ *
+ * This is efsink_packed with a sink that writes: each packed-stream
+ * buffer is copied verbatim into a recycled chunk of a memory-mapped
+ * capture file, and a fixed-size index record is written per packet on
+ * the side (see capture_ring.h for the format).  All output is plain
+ * memcpy() into shared mappings -- page-cache writes with no per-packet
+ * syscalls -- so a single core can sustain capture at high line rates.
+ * Use efcapture_dump to convert a capture to pcapng.
+ */
+
+#include <etherfabric/vi.h>
+#include <etherfabric/pd.h>
+#include <etherfabric/memreg.h>
+#include <etherfabric/packedstream.h>
+
+#include "capture_ring.h"
+#include "utils.h"
+
+
+struct buf {
+  ef_addr     ef_addr;
+  struct buf* next;
+};
+
+
+struct thread {
+  ef_driver_handle         dh;
+  struct ef_pd             pd;
+  struct ef_vi             vi;
+  struct ef_memreg         memreg;
+  int                      psp_start_offset;
+  struct buf*              current_buf;
+  struct buf*              posted_bufs;
+  struct buf**             posted_bufs_tail;
+  ef_packed_stream_packet* ps_pkt_iter;
+  uint64_t                 n_rx_pkts;
+  uint64_t                 n_rx_bytes;
+
+  /* Capture state */
+  struct capture_ring      ring;
+  char*                    chunk;      /* chunk being filled, or NULL */
+  uint32_t                 chunk_gen;
+  uint64_t                 n_records;
+};
+
+
+static int cfg_timestamping;
+static int cfg_max_fill;
+static int cfg_n_chunks = 2048;
+
+
+static inline void posted_buf_put(struct thread* t, struct buf* buf)
+{
+  buf->next = NULL;
+  *(t->posted_bufs_tail) = buf;
+  t->posted_bufs_tail = &buf->next;
+}
+
+
+static inline struct buf* posted_buf_get(struct thread* t)
+{
+  struct buf* buf = t->posted_bufs;
+  if( buf != NULL ) {
+    t->posted_bufs = buf->next;
+    if( t->posted_bufs == NULL )
+      t->posted_bufs_tail = &(t->posted_bufs);
+  }
+  return buf;
+}
+
+
+static inline void handle_rx_ps(struct thread* t, const ef_event* pev)
+{
+  ef_packed_stream_packet* ps_pkt;
+  int i, n_pkts, n_bytes;
+
+  if( EF_EVENT_RX_PS_NEXT_BUFFER(*pev) ) {
+    if( t->current_buf != NULL ) {
+      TRY(ef_vi_receive_post(&t->vi, t->current_buf->ef_addr, 0));
+      posted_buf_put(t, t->current_buf);
+      capture_chunk_close(&t->ring);
+    }
+    t->current_buf = posted_buf_get(t);
+    t->ps_pkt_iter = ef_packed_stream_packet_first(t->current_buf,
+                                                   t->psp_start_offset);
+    t->chunk = capture_chunk_open(&t->ring, &t->chunk_gen);
+  }
+
+  ps_pkt = t->ps_pkt_iter;
+  (void) ef_vi_packed_stream_unbundle(&t->vi, pev, &t->ps_pkt_iter,
+                                      &n_pkts, &n_bytes);
+  t->n_rx_pkts += n_pkts;
+  t->n_rx_bytes += n_bytes;
+
+  if( n_pkts == 0 )
+    return;
+
+  /* Land this event's span of the packed-stream buffer in the chunk at
+   * the same offset, preserving intra-buffer layout. */
+  {
+    char* src = (char*) ps_pkt;
+    uint64_t off = src - (char*) t->current_buf;
+    memcpy(t->chunk + off, src, (char*) t->ps_pkt_iter - src);
+  }
+
+  for( i = 0; i < n_pkts; ++i ) {
+    struct capture_record rec;
+    rec.data_off = (t->chunk - (char*) t->ring.hdr) +
+      ((char*) ef_packed_stream_packet_payload(ps_pkt) -
+       (char*) t->current_buf);
+    rec.cap_len = ps_pkt->ps_cap_len;
+    rec.orig_len = ps_pkt->ps_orig_len;
+    rec.ts_sec = ps_pkt->ps_ts_sec;
+    rec.ts_nsec = ps_pkt->ps_ts_nsec;
+    rec.flags = ps_pkt->ps_flags;
+    rec.pad = 0;
+    rec.chunk_gen = t->chunk_gen;
+    capture_index_append(&t->ring, t->n_records + i, &rec);
+    ps_pkt = ef_packed_stream_packet_next(ps_pkt);
+  }
+  t->n_records += n_pkts;
+  capture_index_publish(&t->ring, t->n_records);
+}
+
+
+static void thread_main_loop(struct thread* t)
+{
+  ef_event evs[16];
+  const int max_evs = sizeof(evs) / sizeof(evs[0]);
+  int i, n_ev;
+
+  while( 1 ) {
+    n_ev = ef_eventq_poll(&t->vi, evs, max_evs);
+
+    for( i = 0; i < n_ev; ++i ) {
+      switch( EF_EVENT_TYPE(evs[i]) ) {
+      case EF_EVENT_TYPE_RX_PACKED_STREAM:
+        handle_rx_ps(t, &(evs[i]));
+        break;
+      default:
+        LOGE("ERROR: unexpected event type=%d\n", (int) EF_EVENT_TYPE(evs[i]));
+        break;
+      }
+    }
+  }
+}
+
+/**********************************************************************/
+
+static void monitor(struct thread* thread)
+{
+  /* Print approx packet rate and bandwidth every second. */
+
+  uint64_t now_bytes, prev_bytes;
+  struct timeval start, end;
+  uint64_t prev_pkts, now_pkts;
+  int ms, pkt_rate, mbps;
+
+  printf("# pkt-rate  bandwidth(Mbps)  pkts\n");
+
+  prev_pkts = thread->n_rx_pkts;
+  prev_bytes = thread->n_rx_bytes;
+  gettimeofday(&start, NULL);
+
+  while( 1 ) {
+    sleep(1);
+    now_pkts = thread->n_rx_pkts;
+    now_bytes = thread->n_rx_bytes;
+    gettimeofday(&end, NULL);
+    ms = (end.tv_sec - start.tv_sec) * 1000;
+    ms += (end.tv_usec - start.tv_usec) / 1000;
+    pkt_rate = (int) ((now_pkts - prev_pkts) * 1000 / ms);
+    mbps = (int) ((now_bytes - prev_bytes) * 8 / 1000 / ms);
+    printf("%10d %16d %16"PRIu64"\n", pkt_rate, mbps, now_pkts);
+    fflush(stdout);
+    prev_pkts = now_pkts;
+    prev_bytes = now_bytes;
+    start = end;
+  }
+}
+
+
+static void* monitor_fn(void* arg)
+{
+  struct thread* thread = arg;
+  monitor(thread);
+  return NULL;
+}
+
+
+static __attribute__ ((__noreturn__)) void usage(void)
+{
+  fprintf(stderr, "usage:\n");
+  fprintf(stderr, "  efcapture [options] <capture-file> <interface> "
+          "<filter-spec>...\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "filter-spec:\n");
+  fprintf(stderr, "  {udp|tcp}:[mcastloop-rx,][vid=<vlan>,]<local-host>:"
+          "<local-port>[,<remote-host>:<remote-port>]\n");
+  fprintf(stderr, "  eth:[vid=<vlan>,]<local-mac>\n");
+  fprintf(stderr, "  {unicast-all,multicast-all}\n");
+  fprintf(stderr, "  {unicast-mis,multicast-mis}:[vid=<vlan>]\n");
+  fprintf(stderr, "  {sniff}:[promisc|no-promisc]\n");
+  fprintf(stderr, "  {tx-sniff}\n");
+  fprintf(stderr, "  {block-kernel|block-kernel-unicast|"
+          "block-kernel-multicast}\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "options:\n");
+  fprintf(stderr, "  -t     Request hardware timestamping of packets\n");
+  fprintf(stderr, "  -F FL  set max fill level for RX ring\n");
+  fprintf(stderr, "  -n N   capture ring size in chunks "
+          "(chunk = one packed-stream buffer)\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char* capture_path;
+  const char* interface;
+  pthread_t thread_id;
+  struct thread* t;
+  unsigned vi_flags;
+  int c, i;
+
+  while( (c = getopt (argc, argv, "tF:n:")) != -1 )
+    switch( c ) {
+    case 't':
+      cfg_timestamping = 1;
+      break;
+    case 'F':
+      cfg_max_fill = atoi(optarg);
+      break;
+    case 'n':
+      cfg_n_chunks = atoi(optarg);
+      TEST(cfg_n_chunks > 1);
+      break;
+    case '?':
+      usage();
+    default:
+      TEST(0);
+    }
+
+  argc -= optind;
+  argv += optind;
+  if( argc < 3 )
+    usage();
+  capture_path = argv[0];
+  ++argv; --argc;
+  interface = argv[0];
+  ++argv; --argc;
+
+  TEST((t = calloc(1, sizeof(*t))) != NULL);
+  t->current_buf = NULL;
+  t->posted_bufs = NULL;
+  t->posted_bufs_tail = &(t->posted_bufs);
+
+  TRY(ef_driver_open(&t->dh));
+  TRY(ef_pd_alloc_by_name(&t->pd, t->dh, interface, EF_PD_RX_PACKED_STREAM));
+  vi_flags = EF_VI_RX_PACKED_STREAM | EF_VI_RX_PS_BUF_SIZE_64K;
+  if( cfg_timestamping )
+    vi_flags |= EF_VI_RX_TIMESTAMPS;
+  TRY(ef_vi_alloc_from_pd(&t->vi, t->dh, &t->pd, t->dh,
+                          -1, -1, -1, NULL, -1, vi_flags));
+
+  ef_packed_stream_params psp;
+  TRY(ef_vi_packed_stream_get_params(&t->vi, &psp));
+  if( cfg_max_fill == 0 )
+    cfg_max_fill = psp.psp_max_usable_buffers;
+  fprintf(stderr, "rxq_size=%d\n", ef_vi_receive_capacity(&t->vi));
+  fprintf(stderr, "evq_size=%d\n", ef_eventq_capacity(&t->vi));
+  fprintf(stderr, "max_fill=%d\n", cfg_max_fill);
+  fprintf(stderr, "psp_buffer_size=%d\n", psp.psp_buffer_size);
+  fprintf(stderr, "psp_buffer_align=%d\n", psp.psp_buffer_align);
+  fprintf(stderr, "psp_start_offset=%d\n", psp.psp_start_offset);
+  fprintf(stderr, "psp_max_usable_buffers=%d\n", psp.psp_max_usable_buffers);
+  t->psp_start_offset = psp.psp_start_offset;
+
+  TEST( cfg_max_fill <= ef_vi_receive_capacity(&t->vi) );
+
+  /* One chunk per packed-stream buffer; size the index for the worst
+   * case of minimum-footprint packets filling every chunk. */
+  TEST(capture_ring_create(&t->ring, capture_path, psp.psp_buffer_size,
+                           cfg_n_chunks,
+                           cfg_n_chunks * (psp.psp_buffer_size / 64)) == 0);
+  fprintf(stderr, "capture_file=%s size=%"PRIu64"M index=%"PRIu64"M\n",
+          capture_path, (uint64_t) t->ring.data_map_len >> 20,
+          (uint64_t) t->ring.idx_map_len >> 20);
+
+  /* Packed stream mode requires large contiguous buffers, so allocate huge
+   * pages.  (Also makes consuming packets more efficient of course).
+   */
+  int n_bufs = cfg_max_fill;
+  size_t buf_size = psp.psp_buffer_size;
+  size_t alloc_size = n_bufs * buf_size;
+  alloc_size = ROUND_UP(alloc_size, huge_page_size);
+  void* p;
+  p = mmap(NULL, alloc_size, PROT_READ | PROT_WRITE,
+           MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+  if( p == MAP_FAILED ) {
+    fprintf(stderr, "ERROR: mmap failed.  You probably need to allocate some "
+            "huge pages.\n");
+    exit(2);
+  }
+  TEST(p != MAP_FAILED);
+  TEST(((uintptr_t) p & (psp.psp_buffer_align - 1)) == 0);
+  TRY(ef_memreg_alloc(&t->memreg, t->dh, &t->pd, t->dh, p, alloc_size));
+  for( i = 0; i < n_bufs; ++i ) {
+    struct buf* buf = (void*) ((char*) p + i * buf_size);
+    buf->ef_addr = ef_memreg_dma_addr(&t->memreg, i * buf_size);
+    TRY(ef_vi_receive_post(&t->vi, buf->ef_addr, 0));
+    posted_buf_put(t, buf);
+  }
+
+  while( argc > 0 ) {
+    ef_filter_spec filter_spec;
+    if( filter_parse(&filter_spec, argv[0], NULL, EF_FILTER_FLAG_NONE) != 0 ) {
+      LOGE("ERROR: Bad filter spec '%s'\n", argv[0]);
+      exit(1);
+    }
+    TRY(ef_vi_filter_add(&t->vi, t->dh, &filter_spec, NULL));
+    ++argv; --argc;
+  }
+
+  TEST(pthread_create(&thread_id, NULL, monitor_fn, t) == 0);
+  thread_main_loop(t);
+  return 0;
+}
@@ -0,0 +1,137 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* efcapture_dump
+ *
+ * Convert an efcapture ring file to pcapng.
+ *
+ * Takes a consistent snapshot of the capture's index window and emits
+ * one pcapng Enhanced Packet Block per packet whose data chunk has not
+ * been recycled (see capture_ring.h).  Safe to run while efcapture is
+ * still writing: torn or recycled records are detected via the chunk
+ * generation counters and skipped.
+ */
+
+#include "capture_ring.h"
+#include "utils.h"
+
+
+/* pcapng block types */
+#define PCAPNG_SHB  0x0a0d0d0au
+#define PCAPNG_IDB  0x00000001u
+#define PCAPNG_EPB  0x00000006u
+
+
+static void put_u32(FILE* f, uint32_t v)
+{
+  TEST(fwrite(&v, 4, 1, f) == 1);
+}
+
+
+static void write_shb(FILE* f)
+{
+  put_u32(f, PCAPNG_SHB);
+  put_u32(f, 28);              /* block total length */
+  put_u32(f, 0x1a2b3c4d);      /* byte-order magic */
+  put_u32(f, 0x00010000);      /* version 1.0 */
+  put_u32(f, 0xffffffff);      /* section length: unspecified */
+  put_u32(f, 0xffffffff);
+  put_u32(f, 28);
+}
+
+
+static void write_idb(FILE* f)
+{
+  put_u32(f, PCAPNG_IDB);
+  put_u32(f, 32);              /* block total length */
+  put_u32(f, 1);               /* linktype: Ethernet */
+  put_u32(f, 0);               /* snaplen: no limit */
+  put_u32(f, 0x00010009);      /* option: if_tsresol, length 1 */
+  put_u32(f, 9);               /* 10^-9: nanosecond timestamps */
+  put_u32(f, 0);               /* opt_endofopt */
+  put_u32(f, 32);
+}
+
+
+static void write_epb(FILE* f, const struct capture_record* rec,
+                      const void* payload)
+{
+  uint64_t ts_ns = (uint64_t) rec->ts_sec * 1000000000ull + rec->ts_nsec;
+  uint32_t cap_pad = capture_round_up(rec->cap_len, 4);
+  uint32_t block_len = 32 + cap_pad;
+  static const char pad[4];
+
+  put_u32(f, PCAPNG_EPB);
+  put_u32(f, block_len);
+  put_u32(f, 0);               /* interface id */
+  put_u32(f, ts_ns >> 32);
+  put_u32(f, (uint32_t) ts_ns);
+  put_u32(f, rec->cap_len);
+  put_u32(f, rec->orig_len);
+  TEST(fwrite(payload, 1, rec->cap_len, f) == rec->cap_len);
+  if( cap_pad != rec->cap_len )
+    TEST(fwrite(pad, 1, cap_pad - rec->cap_len, f) == cap_pad - rec->cap_len);
+  put_u32(f, block_len);
+}
+
+
+static __attribute__ ((__noreturn__)) void usage(void)
+{
+  fprintf(stderr, "usage:\n");
+  fprintf(stderr, "  efcapture_dump <capture-file> <out.pcapng | ->\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  struct capture_ring ring;
+  uint64_t seq, wr, start, n_out = 0, n_skipped = 0;
+  char* payload;
+  FILE* out;
+
+  if( argc != 3 )
+    usage();
+
+  if( capture_ring_open_ro(&ring, argv[1]) != 0 )
+    exit(1);
+
+  if( strcmp(argv[2], "-") == 0 )
+    out = stdout;
+  else
+    TEST((out = fopen(argv[2], "w")) != NULL);
+
+  TEST((payload = malloc(ring.hdr->chunk_size)) != NULL);
+
+  write_shb(out);
+  write_idb(out);
+
+  /* Snapshot the index window.  Records behind the window, and records
+   * whose chunks get recycled while we run, are detected and skipped by
+   * the generation checks below. */
+  wr = ring.idx_hdr->wr_record;
+  ci_rmb();
+  start = wr > ring.idx_hdr->n_records ? wr - ring.idx_hdr->n_records : 0;
+
+  for( seq = start; seq < wr; ++seq ) {
+    /* Copy the record out: the writer may overwrite it under us, so
+     * validate before trusting any field. */
+    struct capture_record rec =
+      ring.records[seq % ring.idx_hdr->n_records];
+    if( rec.data_off < ring.hdr->data_off ||
+        rec.data_off + rec.cap_len >
+        ring.hdr->data_off +
+        (uint64_t) ring.hdr->n_chunks * ring.hdr->chunk_size ||
+        rec.cap_len > ring.hdr->chunk_size ||
+        capture_read_payload(&ring, &rec, payload) != 0 ) {
+      ++n_skipped;
+      continue;
+    }
+    write_epb(out, &rec, payload);
+    ++n_out;
+  }
+
+  TEST(fflush(out) == 0);
+  fprintf(stderr, "wrote %"PRIu64" packets (%"PRIu64" recycled/skipped)\n",
+          n_out, n_skipped);
+  return 0;
+}
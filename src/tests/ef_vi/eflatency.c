@@ -45,6 +45,9 @@ static int              cfg_payload_step = 1;
 static int              cfg_ctpio_no_poison;
 static unsigned         cfg_ctpio_thresh = 64;
 static const char*      cfg_save_file = NULL;
+static const char*      cfg_json_file = NULL;
+static const char*      cfg_csv_file = NULL;
+static int              cfg_n_flows = 1;
 enum mode {
   MODE_DMA = 1,
   MODE_PIO = 2,
@@ -57,7 +60,8 @@ static enum ef_vi_flags cfg_vi_flags = 0;
 
 
 #define N_RX_BUFS	256u
-#define N_TX_BUFS	1u
+#define N_TX_BUFS	16u
+#define MAX_FLOWS       N_TX_BUFS
 #define N_BUFS          (N_RX_BUFS + N_TX_BUFS)
 #define FIRST_TX_BUF    N_RX_BUFS
 #define BUF_SIZE        2048
@@ -98,7 +102,7 @@ const uint32_t raddr_he = 0xac010203;  /* 172.1.2.3 */
 const uint16_t port_he = 8080;
 
 
-static void init_udp_pkt(void* pkt_buf, int paylen)
+static void init_udp_pkt(void* pkt_buf, int paylen, int flow)
 {
   int ip_len = sizeof(ci_ip4_hdr) + sizeof(ci_udp_hdr) + paylen;
   ci_ether_hdr* eth;
@@ -119,7 +123,11 @@ static void init_udp_pkt(void* pkt_buf, int paylen)
   eth->ether_type = htons(0x0800);
   ci_ip4_hdr_init(ip4, CI_NO_OPTS, ip_len, 0, IPPROTO_UDP, htonl(laddr_he),
                   htonl(raddr_he), 0);
-  ci_udp_hdr_init(udp, ip4, htons(port_he), htons(port_he), udp + 1, paylen, 0);
+  /* Each flow gets its own source port so that multi-flow runs exercise
+   * distinct flows on the wire; the destination port (and hence the RX
+   * filter) is shared. */
+  ci_udp_hdr_init(udp, ip4, htons(port_he + flow), htons(port_he),
+                  udp + 1, paylen, 0);
 
   iov.iov_base = udp + 1;
   iov.iov_len = paylen;
@@ -147,6 +155,73 @@ static int cmp_u64(const void* ap, const void* bp)
 }
 
 
+/* Percentile of the sorted cycle-count sample set. */
+static uint64_t percentile_cycles(double p)
+{
+  int ix = (int) ((double) cfg_iter * p / 100.0);
+  if( ix >= cfg_iter )
+    ix = cfg_iter - 1;
+  return timings[ix];
+}
+
+
+static FILE*       csv_fp;
+static FILE*       json_fp;
+static int         json_n_rows;
+static const char* results_mode_name = "";
+
+static void results_write(double mean, double min, double p50, double p95,
+                          double p99, double p99_99, double max)
+{
+  if( cfg_csv_file ) {
+    if( csv_fp == NULL ) {
+      csv_fp = fopen(cfg_csv_file, "wt");
+      TEST(csv_fp != NULL);
+      fprintf(csv_fp, "paylen,iterations,warmups,flows,mode,mean_usec,"
+              "min_usec,p50_usec,p95_usec,p99_usec,p99.99_usec,max_usec\n");
+    }
+    fprintf(csv_fp, "%d,%d,%d,%d,%s,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\n",
+            cfg_payload_len, cfg_iter, cfg_warmups, cfg_n_flows,
+            results_mode_name, mean, min, p50, p95, p99, p99_99, max);
+    fflush(csv_fp);
+  }
+  if( cfg_json_file ) {
+    if( json_fp == NULL ) {
+      json_fp = fopen(cfg_json_file, "wt");
+      TEST(json_fp != NULL);
+      fprintf(json_fp,
+              "{\n"
+              "  \"version\": \"%s\",\n"
+              "  \"mode\": \"%s\",\n"
+              "  \"iterations\": %d,\n"
+              "  \"warmups\": %d,\n"
+              "  \"flows\": %d,\n"
+              "  \"results\": [",
+              ef_vi_version_str(), results_mode_name, cfg_iter, cfg_warmups,
+              cfg_n_flows);
+    }
+    fprintf(json_fp,
+            "%s\n"
+            "    { \"paylen\": %d, \"mean_usec\": %.3f,"
+            " \"min_usec\": %.3f, \"p50_usec\": %.3f,"
+            " \"p95_usec\": %.3f, \"p99_usec\": %.3f,"
+            " \"p99.99_usec\": %.3f, \"max_usec\": %.3f }",
+            json_n_rows++ ? "," : "", cfg_payload_len, mean, min, p50, p95,
+            p99, p99_99, max);
+  }
+}
+
+static void results_close(void)
+{
+  if( json_fp != NULL ) {
+    fprintf(json_fp, "\n  ]\n}\n");
+    fclose(json_fp);
+  }
+  if( csv_fp != NULL )
+    fclose(csv_fp);
+}
+
+
 static void output_results(struct timeval start, struct timeval end)
 {
   unsigned freq = 0;
@@ -181,14 +256,22 @@ static void output_results(struct timeval start, struct timeval end)
   }
 
   qsort(timings, cfg_iter, sizeof(timings[0]), cmp_u64);
-  printf("%d\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\n",
+  printf("%d\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\t%0.3lf\n",
          cfg_payload_len,
          (double) usec / cfg_iter,
          timings[0] / div,
-         timings[cfg_iter / 2] / div,
-         timings[cfg_iter - cfg_iter / 20] / div,
-         timings[cfg_iter - cfg_iter / 100] / div,
+         percentile_cycles(50) / div,
+         percentile_cycles(95) / div,
+         percentile_cycles(99) / div,
+         percentile_cycles(99.99) / div,
          timings[cfg_iter - 1] / div);
+  results_write((double) usec / cfg_iter,
+                timings[0] / div,
+                percentile_cycles(50) / div,
+                percentile_cycles(95) / div,
+                percentile_cycles(99) / div,
+                percentile_cycles(99.99) / div,
+                timings[cfg_iter - 1] / div);
   last_mean_latency_usec = (double) usec / cfg_iter;
 }
 
@@ -267,9 +350,17 @@ static void handle_rx_ref(ef_vi* vi, unsigned pkt_id, int len)
  * DMA
  */
 
+/* Round-robin over the per-flow TX buffers.  With the default single flow
+ * this always yields the same buffer. */
+static inline struct pkt_buf* next_tx_buf(void)
+{
+  static unsigned tx_flow;
+  return pkt_bufs[FIRST_TX_BUF + tx_flow++ % cfg_n_flows];
+}
+
 static inline void dma_send(struct eflatency_vi* vi)
 {
-  struct pkt_buf* pb = pkt_bufs[FIRST_TX_BUF];
+  struct pkt_buf* pb = next_tx_buf();
   TRY(ef_vi_transmit(&vi->vi, pb->dma_buf_addr, tx_frame_len, 0));
 }
 
@@ -417,7 +508,7 @@ static inline void ctpio_send(struct eflatency_vi* vi)
   /* TODO: May be desirable to compute cut-through threshold from frame
    * length.
    */
-  struct pkt_buf* pb = pkt_bufs[FIRST_TX_BUF];
+  struct pkt_buf* pb = next_tx_buf();
   ef_vi_transmit_ctpio(&vi->vi, pb->dma_buf, tx_frame_len, cfg_ctpio_thresh);
   for( ; ; ) {
     int rc = ef_vi_transmit_ctpio_fallback(&vi->vi, pb->dma_buf_addr, tx_frame_len, 0);
@@ -566,6 +657,7 @@ static const test_t* do_init(int ifindex, int mode,
   ef_filter_spec filter_spec;
   enum ef_vi_flags vi_flags = cfg_vi_flags;
   int rc;
+  int flow;
   const test_t* t;
   unsigned long capability_val;
 
@@ -631,7 +723,9 @@ static const test_t* do_init(int ifindex, int mode,
   /* Build the UDP packet inside the DMA buffer.  As well as being used for
    * straightforward DMA sends, it will also be used to fill alternatives, and
    * as a source buffer to populate the PIO region. */
-  init_udp_pkt(pkt_bufs[FIRST_TX_BUF]->dma_buf, cfg_payload_len);
+  for( flow = 0; flow < cfg_n_flows; ++flow )
+    init_udp_pkt(pkt_bufs[FIRST_TX_BUF + flow]->dma_buf, cfg_payload_len,
+                 flow);
   tx_frame_len = cfg_payload_len + HEADER_SIZE;
 
   /* Other modes don't work with X3 */
@@ -699,6 +793,10 @@ static CI_NORETURN usage(const char* fmt, ...)
   fprintf(stderr, "                        [pio], [a]lternatives, [d]ma\n");
   fprintf(stderr, "  -t <modes>          - set TX_PUSH: [a]lways, [d]isable\n");
   fprintf(stderr, "  -o <filename>       - save raw timings to file\n");
+  fprintf(stderr, "  -N <flows>          - number of UDP flows to cycle over "
+                  "(1-%u; CTPIO/DMA only)\n", MAX_FLOWS);
+  fprintf(stderr, "  -j <filename>       - write results as JSON\n");
+  fprintf(stderr, "  -C <filename>       - write results as CSV\n");
   fprintf(stderr, "\n");
   exit(1);
 }
@@ -736,7 +834,7 @@ int main(int argc, char* argv[])
     p = (unsigned int)__v;                                   \
   } while( 0 );
 
-  while( (c = getopt (argc, argv, "n:s:w:c:pm:t:o:")) != -1 )
+  while( (c = getopt (argc, argv, "n:s:w:c:pm:t:o:N:j:C:")) != -1 )
     switch( c ) {
     case 'n':
       OPT_INT(optarg, cfg_iter);
@@ -767,6 +865,17 @@ int main(int argc, char* argv[])
     case 'o':
       cfg_save_file = optarg;
       break;
+    case 'N':
+      OPT_INT(optarg, cfg_n_flows);
+      if( cfg_n_flows < 1 || cfg_n_flows > MAX_FLOWS )
+        usage("Flow count must be between 1 and %u", MAX_FLOWS);
+      break;
+    case 'j':
+      cfg_json_file = optarg;
+      break;
+    case 'C':
+      cfg_csv_file = optarg;
+      break;
     case 'm':
       cfg_mode = 0;
       for( i = 0; i < strlen(optarg); ++i ) {
@@ -821,6 +930,14 @@ int main(int argc, char* argv[])
     usage("Max payload size not reachable from min");
   }
 
+  if( cfg_n_flows > 1 ) {
+    /* PIO and alternatives pre-stage a single packet, so they cannot vary
+     * the flow per send. */
+    cfg_mode &= ~(MODE_PIO | MODE_ALT);
+    if( cfg_mode == 0 )
+      usage("Multi-flow runs need CTPIO or DMA sends");
+  }
+
   if( strcmp(argv[0], "ping") == 0 )
     ping = true;
   else if( strcmp(argv[0], "pong") != 0 )
@@ -888,9 +1005,11 @@ int main(int argc, char* argv[])
   printf("# iterations: %d\n", cfg_iter);
   printf("# warmups: %d\n", cfg_warmups);
   printf("# frame len: %d\n", tx_frame_len);
+  printf("# flows: %d\n", cfg_n_flows);
   printf("# mode: %s\n", t->name);
+  results_mode_name = t->name;
   if( ping )
-    printf("paylen\tmean\tmin\t50%%\t95%%\t99%%\tmax\n");
+    printf("paylen\tmean\tmin\t50%%\t95%%\t99%%\t99.99%%\tmax\n");
 
   for( ; ; ) {
     ++iters_run;
@@ -906,12 +1025,14 @@ int main(int argc, char* argv[])
     }
     else if( cfg_payload_len >= cfg_payload_end )
       break;
-    init_udp_pkt(pkt_bufs[FIRST_TX_BUF]->dma_buf, cfg_payload_len);
+    for( i = 0; i < cfg_n_flows; ++i )
+      init_udp_pkt(pkt_bufs[FIRST_TX_BUF + i]->dma_buf, cfg_payload_len, i);
     tx_frame_len = cfg_payload_len + HEADER_SIZE;
   }
   if( ping && iters_run == 1 )
     printf("mean round-trip time: %.3lf usec\n", last_mean_latency_usec);
 
+  results_close();
   return 0;
 }
 
@@ -0,0 +1,288 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* efsink_packed_mt
+ *
+ * Receive packets using "packed stream" mode, with per-packet processing
+ * distributed over worker threads.
+ *
+ * A dispatcher thread owns the VI: it polls the event queue, hands batches
+ * of packets to the workers via the splitter in ps_splitter.h, and
+ * re-posts buffers in fill order once the workers have finished with
+ * them.  See ps_splitter.h for the ownership protocol.
+ */
+
+#include <etherfabric/vi.h>
+#include <etherfabric/pd.h>
+#include <etherfabric/memreg.h>
+#include <etherfabric/packedstream.h>
+
+#include "utils.h"
+#include "ps_splitter.h"
+
+#include <pthread.h>
+
+
+struct worker {
+  pthread_t        thread_id;
+  struct ps_split* split;
+  uint64_t         n_rx_pkts;
+  uint64_t         n_rx_bytes;
+  uint64_t         n_work_units;
+};
+
+
+struct dispatcher {
+  ef_driver_handle  dh;
+  struct ef_pd      pd;
+  struct ef_vi      vi;
+  struct ef_memreg  memreg;
+  struct ps_split   split;
+};
+
+
+static int cfg_n_workers = 2;
+static int cfg_timestamping;
+static int cfg_max_fill;
+static int cfg_touch_payload;
+
+static struct worker* workers;
+
+
+static void* worker_main(void* arg)
+{
+  struct worker* w = arg;
+  struct ps_work work;
+  int i;
+
+  while( 1 ) {
+    if( ! ps_work_get(w->split, &work) ) {
+      ci_spinloop_pause();
+      continue;
+    }
+    ef_packed_stream_packet* ps_pkt = work.ps_pkt;
+    for( i = 0; i < work.n_pkts; ++i ) {
+      /* Do something useful with the received packet!  Anything that
+       * needs the payload after this iteration must copy it out before
+       * ps_work_done() allows the buffer back to the adapter. */
+      if( cfg_touch_payload ) {
+        const volatile uint8_t* p =
+          ef_packed_stream_packet_payload(ps_pkt);
+        (void) p[0];
+      }
+      ps_pkt = ef_packed_stream_packet_next(ps_pkt);
+    }
+    w->n_rx_pkts += work.n_pkts;
+    w->n_rx_bytes += work.n_bytes;
+    ++w->n_work_units;
+    ps_work_done(&work);
+  }
+  return NULL;
+}
+
+
+static void dispatcher_main_loop(struct dispatcher* d)
+{
+  ef_event evs[16];
+  const int max_evs = sizeof(evs) / sizeof(evs[0]);
+  int i, n_ev;
+
+  while( 1 ) {
+    ps_split_release(&d->split, &d->vi);
+    n_ev = ef_eventq_poll(&d->vi, evs, max_evs);
+    for( i = 0; i < n_ev; ++i ) {
+      switch( EF_EVENT_TYPE(evs[i]) ) {
+      case EF_EVENT_TYPE_RX_PACKED_STREAM:
+        ps_split_event(&d->split, &d->vi, &evs[i]);
+        break;
+      default:
+        LOGE("ERROR: unexpected event type=%d\n",
+             (int) EF_EVENT_TYPE(evs[i]));
+        break;
+      }
+    }
+  }
+}
+
+/**********************************************************************/
+
+static void monitor(void)
+{
+  /* Print approx packet rate and bandwidth every second. */
+
+  uint64_t now_bytes, prev_bytes;
+  struct timeval start, end;
+  uint64_t prev_pkts, now_pkts;
+  int i, ms, pkt_rate, mbps;
+
+  printf("# pkt-rate  bandwidth(Mbps)  pkts\n");
+
+  prev_pkts = prev_bytes = 0;
+  gettimeofday(&start, NULL);
+
+  while( 1 ) {
+    sleep(1);
+    now_pkts = now_bytes = 0;
+    for( i = 0; i < cfg_n_workers; ++i ) {
+      now_pkts += workers[i].n_rx_pkts;
+      now_bytes += workers[i].n_rx_bytes;
+    }
+    gettimeofday(&end, NULL);
+    ms = (end.tv_sec - start.tv_sec) * 1000;
+    ms += (end.tv_usec - start.tv_usec) / 1000;
+    pkt_rate = (int) ((now_pkts - prev_pkts) * 1000 / ms);
+    mbps = (int) ((now_bytes - prev_bytes) * 8 / 1000 / ms);
+    printf("%10d %16d %16"PRIu64"\n", pkt_rate, mbps, now_pkts);
+    fflush(stdout);
+    prev_pkts = now_pkts;
+    prev_bytes = now_bytes;
+    start = end;
+  }
+}
+
+
+static void* monitor_fn(void* arg)
+{
+  (void) arg;
+  monitor();
+  return NULL;
+}
+
+
+static __attribute__ ((__noreturn__)) void usage(void)
+{
+  fprintf(stderr, "usage:\n");
+  fprintf(stderr, "  efsink_packed_mt [options] <interface> "
+          "<filter-spec>...\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "filter-spec:\n");
+  fprintf(stderr, "  {udp|tcp}:[mcastloop-rx,][vid=<vlan>,]<local-host>:"
+          "<local-port>[,<remote-host>:<remote-port>]\n");
+  fprintf(stderr, "  eth:[vid=<vlan>,]<local-mac>\n");
+  fprintf(stderr, "  {unicast-all,multicast-all}\n");
+  fprintf(stderr, "  {unicast-mis,multicast-mis}:[vid=<vlan>]\n");
+  fprintf(stderr, "  {sniff}:[promisc|no-promisc]\n");
+  fprintf(stderr, "  {tx-sniff}\n");
+  fprintf(stderr, "  {block-kernel|block-kernel-unicast|"
+          "block-kernel-multicast}\n");
+  fprintf(stderr, "\n");
+  fprintf(stderr, "options:\n");
+  fprintf(stderr, "  -n NUM set number of worker threads (default 2)\n");
+  fprintf(stderr, "  -t     Request hardware timestamping of packets\n");
+  fprintf(stderr, "  -F FL  set max fill level for RX ring\n");
+  fprintf(stderr, "  -T     touch packet payload in workers\n");
+  exit(1);
+}
+
+
+int main(int argc, char* argv[])
+{
+  const char* interface;
+  pthread_t monitor_id;
+  struct dispatcher* d;
+  unsigned vi_flags;
+  int c, i;
+
+  while( (c = getopt (argc, argv, "n:tTF:")) != -1 )
+    switch( c ) {
+    case 'n':
+      cfg_n_workers = atoi(optarg);
+      break;
+    case 't':
+      cfg_timestamping = 1;
+      break;
+    case 'T':
+      cfg_touch_payload = 1;
+      break;
+    case 'F':
+      cfg_max_fill = atoi(optarg);
+      break;
+    case '?':
+      usage();
+    default:
+      TEST(0);
+    }
+
+  argc -= optind;
+  argv += optind;
+  if( argc < 2 || cfg_n_workers < 1 )
+    usage();
+  interface = argv[0];
+  ++argv; --argc;
+
+  TEST((d = calloc(1, sizeof(*d))) != NULL);
+
+  TRY(ef_driver_open(&d->dh));
+  TRY(ef_pd_alloc_by_name(&d->pd, d->dh, interface, EF_PD_RX_PACKED_STREAM));
+  vi_flags = EF_VI_RX_PACKED_STREAM | EF_VI_RX_PS_BUF_SIZE_64K;
+  if( cfg_timestamping )
+    vi_flags |= EF_VI_RX_TIMESTAMPS;
+  TRY(ef_vi_alloc_from_pd(&d->vi, d->dh, &d->pd, d->dh,
+                          -1, -1, -1, NULL, -1, vi_flags));
+
+  ef_packed_stream_params psp;
+  TRY(ef_vi_packed_stream_get_params(&d->vi, &psp));
+  if( cfg_max_fill == 0 )
+    cfg_max_fill = psp.psp_max_usable_buffers;
+  fprintf(stderr, "rxq_size=%d\n", ef_vi_receive_capacity(&d->vi));
+  fprintf(stderr, "evq_size=%d\n", ef_eventq_capacity(&d->vi));
+  fprintf(stderr, "max_fill=%d\n", cfg_max_fill);
+  fprintf(stderr, "psp_buffer_size=%d\n", psp.psp_buffer_size);
+  fprintf(stderr, "psp_buffer_align=%d\n", psp.psp_buffer_align);
+  fprintf(stderr, "psp_start_offset=%d\n", psp.psp_start_offset);
+  fprintf(stderr, "psp_max_usable_buffers=%d\n", psp.psp_max_usable_buffers);
+  fprintf(stderr, "n_workers=%d\n", cfg_n_workers);
+
+  TEST( cfg_max_fill <= ef_vi_receive_capacity(&d->vi) );
+
+  ps_split_init(&d->split, psp.psp_start_offset);
+
+  /* Packed stream mode requires large contiguous buffers, so allocate huge
+   * pages.  (Also makes consuming packets more efficient of course).
+   */
+  int n_bufs = cfg_max_fill;
+  size_t buf_size = psp.psp_buffer_size;
+  size_t alloc_size = n_bufs * buf_size;
+  alloc_size = ROUND_UP(alloc_size, huge_page_size);
+  void* p;
+  p = mmap(NULL, alloc_size, PROT_READ | PROT_WRITE,
+           MAP_ANONYMOUS | MAP_PRIVATE | MAP_HUGETLB, -1, 0);
+  if( p == MAP_FAILED ) {
+    fprintf(stderr, "ERROR: mmap failed.  You probably need to allocate some "
+            "huge pages.\n");
+    exit(2);
+  }
+  TEST(((uintptr_t) p & (psp.psp_buffer_align - 1)) == 0);
+  TRY(ef_memreg_alloc(&d->memreg, d->dh, &d->pd, d->dh, p, alloc_size));
+
+  /* Buffer bookkeeping lives outside the buffers themselves: the splitter
+   * must not write into memory the adapter owns. */
+  struct ps_split_buf* bufs;
+  TEST((bufs = calloc(n_bufs, sizeof(*bufs))) != NULL);
+  for( i = 0; i < n_bufs; ++i ) {
+    bufs[i].mem = (char*) p + i * buf_size;
+    bufs[i].ef_addr = ef_memreg_dma_addr(&d->memreg, i * buf_size);
+    TRY(ef_vi_receive_post(&d->vi, bufs[i].ef_addr, 0));
+    ps_split_buf_posted(&d->split, &bufs[i]);
+  }
+
+  while( argc > 0 ) {
+    ef_filter_spec filter_spec;
+    if( filter_parse(&filter_spec, argv[0], NULL, EF_FILTER_FLAG_NONE) != 0 ) {
+      LOGE("ERROR: Bad filter spec '%s'\n", argv[0]);
+      exit(1);
+    }
+    TRY(ef_vi_filter_add(&d->vi, d->dh, &filter_spec, NULL));
+    ++argv; --argc;
+  }
+
+  TEST((workers = calloc(cfg_n_workers, sizeof(*workers))) != NULL);
+  for( i = 0; i < cfg_n_workers; ++i ) {
+    workers[i].split = &d->split;
+    TEST(pthread_create(&workers[i].thread_id, NULL, worker_main,
+                        &workers[i]) == 0);
+  }
+
+  TEST(pthread_create(&monitor_id, NULL, monitor_fn, NULL) == 0);
+  dispatcher_main_loop(d);
+  return 0;
+}
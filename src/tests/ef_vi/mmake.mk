@@ -3,7 +3,9 @@
 
 EFSEND_APPS := efsend efsend_pio efsend_timestamping efsend_pio_warm
 TEST_APPS	:= efforward efrss efsink \
-		   efsink_packed efforward_packed eflatency efexclusivity stats \
+		   efsink_packed efsink_packed_mt efforward_packed eflatency \
+		   efexclusivity stats \
+		   efcapture efcapture_dump \
 		   efjumborx $(EFSEND_APPS)
 
 ifeq (${PLATFORM},gnu_x86_64)
@@ -35,8 +37,14 @@ efjumborx: efjumborx.o utils.o
 
 efsink_packed: efsink_packed.o utils.o
 
+efsink_packed_mt: efsink_packed_mt.o utils.o
+
 efforward_packed: efforward_packed.o utils.o
 
+efcapture: efcapture.o utils.o
+
+efcapture_dump: efcapture_dump.o utils.o
+
 efpingpong: MMAKE_LIBS     := $(LINK_CITOOLS_LIB) $(MMAKE_LIBS)
 efpingpong: MMAKE_LIB_DEPS := $(CITOOLS_LIB_DEPEND) $(MMAKE_LIB_DEPS)
 
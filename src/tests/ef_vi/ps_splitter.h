@@ -0,0 +1,237 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2026 Advanced Micro Devices, Inc. */
+/* ps_splitter.h
+ *
+ * Library for distributing packed-stream buffers over worker threads.
+ *
+ * At high line rates packed-stream mode can deliver packets faster than a
+ * single core can process them.  The splitter lets one dispatcher thread
+ * own the ef_vi -- ef_vi is not thread-safe, so all event-queue polling
+ * and buffer posting must stay on one thread -- while per-packet work is
+ * fanned out to worker threads:
+ *
+ *  - the dispatcher calls ps_split_event() for each
+ *    EF_EVENT_TYPE_RX_PACKED_STREAM event; this unbundles the event and
+ *    publishes a work unit (a run of packets within one packed-stream
+ *    buffer) on a single-producer / multi-consumer ring
+ *
+ *  - workers call ps_work_get() to claim a unit, process the packets, and
+ *    call ps_work_done() when they no longer reference the packet data
+ *
+ *  - the dispatcher calls ps_split_release() regularly; this re-posts
+ *    buffers to the RX ring strictly in the order the adapter filled
+ *    them, and only once every work unit referencing them is done
+ *
+ * Buffer ownership is tracked with one reference count per packed-stream
+ * buffer: the dispatcher holds a reference while the adapter is still
+ * appending packets to the buffer, and each published work unit holds one
+ * until its worker is finished.  Because the RX ring is FIFO, releasing
+ * buffers in fill order means a slow worker stalls re-posting, but never
+ * lets the adapter overwrite data another worker is still reading.
+ */
+#ifndef __PS_SPLITTER_H__
+#define __PS_SPLITTER_H__
+
+#include <etherfabric/ef_vi.h>
+#include <etherfabric/packedstream.h>
+#include <ci/tools.h>
+
+#include <string.h>
+#include <assert.h>
+
+
+struct ps_split_buf {
+  ef_addr               ef_addr;
+  void*                 mem;       /* start of the packed-stream buffer */
+  /* Number of outstanding references: work units not yet done, plus one
+   * while the adapter is still filling this buffer. */
+  volatile ci_uint32    refs;
+  /* Links the dispatcher's posted and in-flight FIFOs. */
+  struct ps_split_buf*  next;
+};
+
+
+/* One unit of work for a worker thread: a run of packets within a single
+ * packed-stream buffer. */
+struct ps_work {
+  struct ps_split_buf*      buf;
+  ef_packed_stream_packet*  ps_pkt;
+  int                       n_pkts;
+  int                       n_bytes;
+};
+
+
+/* Must be a power of two.  Bounds the number of work units in flight; the
+ * dispatcher spins when the ring is full, which in turn stalls event
+ * processing until a worker catches up. */
+#define PS_SPLIT_WORK_RING_SIZE  512
+
+struct ps_work_slot {
+  /* Free-running sequence number (Vyukov-style bounded queue): equal to
+   * the producer cursor when the slot is free, cursor+1 once published,
+   * and advanced by ring-size by the consumer that drains it. */
+  volatile ci_uint32  seq;
+  struct ps_work      w;
+};
+
+
+struct ps_split {
+  /* Dispatcher-private state. */
+  struct ps_split_buf*      current;       /* buffer the NIC is filling */
+  struct ps_split_buf*      posted_head;   /* posted, not yet current */
+  struct ps_split_buf**     posted_tail;
+  struct ps_split_buf*      inflight_head; /* filled, awaiting workers */
+  struct ps_split_buf**     inflight_tail;
+  ef_packed_stream_packet*  pkt_iter;
+  int                       psp_start_offset;
+  ci_uint32                 wr;            /* producer cursor */
+
+  /* Shared with workers. */
+  volatile ci_uint32        rd_claim;      /* consumer claim cursor */
+  struct ps_work_slot       ring[PS_SPLIT_WORK_RING_SIZE];
+};
+
+
+static inline void ps_split_init(struct ps_split* sp, int psp_start_offset)
+{
+  ci_uint32 i;
+  memset(sp, 0, sizeof(*sp));
+  sp->posted_tail = &sp->posted_head;
+  sp->inflight_tail = &sp->inflight_head;
+  sp->psp_start_offset = psp_start_offset;
+  for( i = 0; i < PS_SPLIT_WORK_RING_SIZE; ++i )
+    sp->ring[i].seq = i;
+}
+
+
+/* Dispatcher: account for a buffer just given to ef_vi_receive_post(). */
+static inline void ps_split_buf_posted(struct ps_split* sp,
+                                       struct ps_split_buf* buf)
+{
+  buf->next = NULL;
+  buf->refs = 0;
+  *(sp->posted_tail) = buf;
+  sp->posted_tail = &buf->next;
+}
+
+
+static inline struct ps_split_buf* ps_split_posted_get(struct ps_split* sp)
+{
+  struct ps_split_buf* buf = sp->posted_head;
+  if( buf != NULL ) {
+    sp->posted_head = buf->next;
+    if( sp->posted_head == NULL )
+      sp->posted_tail = &sp->posted_head;
+  }
+  return buf;
+}
+
+
+/* Dispatcher: publish one work unit.  Spins while the work ring is full. */
+static inline void ps_split_publish(struct ps_split* sp,
+                                    struct ps_split_buf* buf,
+                                    ef_packed_stream_packet* ps_pkt,
+                                    int n_pkts, int n_bytes)
+{
+  struct ps_work_slot* s =
+    &sp->ring[sp->wr & (PS_SPLIT_WORK_RING_SIZE - 1)];
+  ci_atomic32_inc(&buf->refs);
+  while( s->seq != sp->wr )
+    ci_spinloop_pause();
+  s->w.buf = buf;
+  s->w.ps_pkt = ps_pkt;
+  s->w.n_pkts = n_pkts;
+  s->w.n_bytes = n_bytes;
+  /* Make the payload visible before publishing the slot. */
+  ci_wmb();
+  s->seq = sp->wr + 1;
+  ++sp->wr;
+}
+
+
+/* Dispatcher: handle an EF_EVENT_TYPE_RX_PACKED_STREAM event, publishing
+ * the packets it describes as a work unit.  Returns the unbundle result:
+ * 0, or a negative timestamping error code (the work unit is published
+ * either way; see ef_vi_packed_stream_unbundle()). */
+static inline int ps_split_event(struct ps_split* sp, ef_vi* vi,
+                                 const ef_event* ev)
+{
+  ef_packed_stream_packet* ps_pkt;
+  int n_pkts, n_bytes, rc;
+
+  if( EF_EVENT_RX_PS_NEXT_BUFFER(*ev) ) {
+    if( sp->current != NULL ) {
+      /* Adapter has moved on: drop the filling reference and queue for
+       * ordered release once the workers are done with it. */
+      sp->current->next = NULL;
+      *(sp->inflight_tail) = sp->current;
+      sp->inflight_tail = &sp->current->next;
+      ci_atomic32_dec(&sp->current->refs);
+    }
+    sp->current = ps_split_posted_get(sp);
+    sp->current->refs = 1;
+    sp->pkt_iter = ef_packed_stream_packet_first(sp->current->mem,
+                                                 sp->psp_start_offset);
+  }
+
+  ps_pkt = sp->pkt_iter;
+  rc = ef_vi_packed_stream_unbundle(vi, ev, &sp->pkt_iter,
+                                    &n_pkts, &n_bytes);
+  if( n_pkts > 0 )
+    ps_split_publish(sp, sp->current, ps_pkt, n_pkts, n_bytes);
+  return rc;
+}
+
+
+/* Dispatcher: re-post buffers that the workers have finished with, in the
+ * order the adapter filled them.  Returns the number re-posted. */
+static inline int ps_split_release(struct ps_split* sp, ef_vi* vi)
+{
+  int n = 0, rc;
+  struct ps_split_buf* buf;
+  while( (buf = sp->inflight_head) != NULL && buf->refs == 0 ) {
+    sp->inflight_head = buf->next;
+    if( sp->inflight_head == NULL )
+      sp->inflight_tail = &sp->inflight_head;
+    /* Ensure packet reads by workers complete before the adapter can
+     * overwrite the buffer. */
+    ci_mb();
+    /* Cannot fail: we only ever re-post a slot we have just vacated. */
+    rc = ef_vi_receive_post(vi, buf->ef_addr, 0);
+    assert(rc == 0);
+    (void) rc;
+    ps_split_buf_posted(sp, buf);
+    ++n;
+  }
+  return n;
+}
+
+
+/* Worker: claim the next work unit.  Returns 1 and fills [w_out] on
+ * success, or 0 if no work is available. */
+static inline int ps_work_get(struct ps_split* sp, struct ps_work* w_out)
+{
+  ci_uint32 pos;
+  struct ps_work_slot* s;
+  do {
+    pos = sp->rd_claim;
+    s = &sp->ring[pos & (PS_SPLIT_WORK_RING_SIZE - 1)];
+    if( (ci_int32) (s->seq - (pos + 1)) < 0 )
+      return 0;
+  } while( ! ci_cas32u_succeed(&sp->rd_claim, pos, pos + 1) );
+  ci_rmb();
+  *w_out = s->w;
+  /* Hand the slot back to the producer. */
+  ci_wmb();
+  s->seq = pos + PS_SPLIT_WORK_RING_SIZE;
+  return 1;
+}
+
+
+/* Worker: release a work unit once the packet data is no longer needed. */
+static inline void ps_work_done(struct ps_work* w)
+{
+  ci_atomic32_dec(&w->buf->refs);
+}
+
+#endif  /* __PS_SPLITTER_H__ */
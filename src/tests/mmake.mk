@@ -38,6 +38,10 @@ DRIVER_SUBDIRS	:=
 all:
 	+@$(MakeSubdirs)
 
+# Build and run the microbenchmark suite (debug builds only; see unit/).
+bench:
+	+@subdirs=unit; $(MakeSubdirs)
+
 clean:
 	@$(MakeClean)
 
@@ -75,6 +75,14 @@ int efrm_filter_redirect(struct efrm_client * client, int filter_id,
 }
 
 
+int efrm_filter_query_hits(struct efrm_client* client, int filter_id,
+                           uint64_t* hits)
+{
+  /* The test harness models no hardware match counters. */
+  return -EOPNOTSUPP;
+}
+
+
 int efrm_vi_set_get_rss_context(struct efrm_vi_set *vi_set, unsigned rss_id)
 {
   return 0;
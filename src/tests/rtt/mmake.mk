@@ -11,8 +11,10 @@ clean:
 	@$(MakeClean)
 
 
-MMAKE_LIBS	:= $(LINK_CIAPP_LIB) $(LINK_CITOOLS_LIB) $(LINK_CIUL_LIB)
-MMAKE_LIB_DEPS	:= $(CIAPP_LIB_DEPEND) $(CITOOLS_LIB_DEPEND) $(CIUL_LIB_DEPEND)
+MMAKE_LIBS	:= $(LINK_CIAPP_LIB) $(LINK_CITOOLS_LIB) $(LINK_CIUL_LIB) \
+		   $(LINK_ONLOAD_EXT_LIB)
+MMAKE_LIB_DEPS	:= $(CIAPP_LIB_DEPEND) $(CITOOLS_LIB_DEPEND) \
+		   $(CIUL_LIB_DEPEND) $(ONLOAD_EXT_LIB_DEPEND)
 
 
-rtt: rtt.o rtt_socket.o rtt_efvi.o
+rtt: rtt.o rtt_socket.o rtt_efvi.o rtt_onload.o
@@ -50,6 +50,8 @@ static const struct endpoint_type ep_types[] = {
   { "tcp", rtt_tcp_build_endpoint },
   { "udp", rtt_udp_build_endpoint },
   { "efvi", rtt_efvi_build_endpoint },
+  { "ods", rtt_ods_build_endpoint },
+  { "template", rtt_template_build_endpoint },
 };
 
 static int ep_types_n = sizeof(ep_types) / sizeof(ep_types[0]);
@@ -74,6 +74,8 @@ typedef int rtt_constructor_fn(struct rtt_endpoint** ep_out,
 extern rtt_constructor_fn rtt_tcp_build_endpoint;
 extern rtt_constructor_fn rtt_udp_build_endpoint;
 extern rtt_constructor_fn rtt_efvi_build_endpoint;
+extern rtt_constructor_fn rtt_ods_build_endpoint;
+extern rtt_constructor_fn rtt_template_build_endpoint;
 
 
 extern int rtt_err(const char* fmt, ...);
@@ -0,0 +1,454 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2016-2020 Xilinx, Inc. */
+
+/* Transports that exercise Onload's accelerated TCP send paths:
+ *
+ *   ods       - TCP connection managed by Onload, with the send critical
+ *               path taken over using the delegated sends API and the raw
+ *               packet put on the wire with ef_vi (DMA or CTPIO).
+ *   template  - TCP connection managed by Onload, sending with the
+ *               templated sends (onload_msg_template_*) API.
+ *
+ * Both require the process to be running under Onload.  Plain intercepted
+ * TCP sockets need no new code: run the existing "tcp" transport under
+ * the onload launcher.
+ */
+
+#include "rtt.h"
+
+#include <onload/extensions.h>
+#include <onload/extensions_zc.h>
+
+#include <etherfabric/vi.h>
+#include <etherfabric/pd.h>
+#include <etherfabric/memreg.h>
+
+#include <stdbool.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+
+
+#define BUF_SIZE  2048
+
+/* Same convention as the socket transports: frame lengths include
+ * Ethernet, IP and TCP-sized headers. */
+#define HEADERS   (14 + 20 + 8)
+
+
+static int lookup_and(int (*op)(int, const struct sockaddr*, socklen_t),
+                      const char* op_s, int sock,
+                      const char* node, const char* service)
+{
+  struct addrinfo hints, *ai;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_flags = AI_PASSIVE;
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+  int rc = getaddrinfo(node, service, &hints, &ai);
+  if( rc != 0 )
+    return rtt_err("ERROR: getaddrinfo(%s, %s) failed: %s\n",
+                   node, service, gai_strerror(rc));
+
+  rc = op(sock, ai->ai_addr, ai->ai_addrlen);
+  freeaddrinfo(ai);
+  if( rc < 0 )
+    return rtt_err("ERROR: %s(%s, %s) failed: %s\n",
+                   op_s, node, service, strerror(errno));
+  return 0;
+}
+
+
+/* Establish the TCP connection that Onload manages for us.  Either
+ * connects out or listens and accepts, as for the "tcp" transport. */
+static int tcp_sock_setup(const char* bind_host, const char* bind_port,
+                          const char* connect_host, const char* connect_port)
+{
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if( sock < 0 )
+    return rtt_err("ERROR: socket() failed: %s\n", strerror(errno));
+
+  int one = 1;
+  RTT_TRY( setsockopt(sock, SOL_TCP, TCP_NODELAY, &one, sizeof(one)) );
+
+  if( bind_port || bind_host )
+    if( lookup_and(bind, "bind", sock, bind_host, bind_port) < 0 )
+      return -1;
+
+  if( connect_port ) {
+    if( lookup_and(connect, "connect", sock, connect_host, connect_port) < 0 )
+      return -1;
+  }
+  else {
+    RTT_TRY( listen(sock, 1) );
+    int conn;
+    RTT_TRY( conn = accept(sock, NULL, NULL) );
+    close(sock);
+    sock = conn;
+  }
+  return sock;
+}
+
+
+/**********************************************************************
+ * Delegated sends (headers from Onload, wire send via ef_vi).
+ */
+
+#define ODS_ENDPOINT(pep)                       \
+  CONTAINER_OF(struct ods_endpoint, ep, (pep))
+
+
+struct ods_endpoint {
+  struct rtt_endpoint  ep;
+  int                  sock;
+  char*                msg_buf;
+  ssize_t              ping_len;
+  ssize_t              pong_len;
+
+  ef_driver_handle     dh;
+  ef_pd                pd;
+  ef_vi                vi;
+  ef_memreg            memreg;
+  uint8_t*             pkt_buf;
+  ef_addr              pkt_dma_addr;
+
+  bool                 use_ctpio;
+  int                  ctpio_thresh;
+
+  struct onload_delegated_send ods;
+  uint8_t              headers[128];
+  bool                 prepared;
+
+  unsigned             n_delegated;
+  unsigned             n_fallback;
+};
+
+
+static inline int min3(int a, int b, int c)
+{
+  int m = a < b ? a : b;
+  return m < c ? m : c;
+}
+
+
+static void ods_poll_tx(struct ods_endpoint* oep)
+{
+  ef_request_id ids[EF_VI_TRANSMIT_BATCH];
+  ef_event evs[EF_VI_EVENT_POLL_MIN_EVS];
+  const int max_evs = sizeof(evs) / sizeof(evs[0]);
+  int i;
+
+  int n_ev = ef_eventq_poll(&(oep->vi), evs, max_evs);
+  for( i = 0; i < n_ev; ++i )
+    switch( EF_EVENT_TYPE(evs[i]) ) {
+    case EF_EVENT_TYPE_TX:
+      ef_vi_transmit_unbundle(&(oep->vi), &(evs[i]), ids);
+      break;
+    default:
+      RTT_TEST( 0 );
+      break;
+    }
+}
+
+
+static void ods_prepare(struct ods_endpoint* oep)
+{
+  enum onload_delegated_send_rc rc;
+
+  oep->ods.headers = oep->headers;
+  oep->ods.headers_len = sizeof(oep->headers);
+  rc = onload_delegated_send_prepare(oep->sock, oep->ping_len, 0, &(oep->ods));
+  if( rc == ONLOAD_DELEGATED_SEND_RC_OK &&
+      min3(oep->ods.send_wnd, oep->ods.cong_wnd, oep->ods.mss) >=
+        oep->ping_len ) {
+    oep->prepared = true;
+  }
+  else {
+    if( rc == ONLOAD_DELEGATED_SEND_RC_OK )
+      RTT_TRY( onload_delegated_send_cancel(oep->sock) );
+    oep->prepared = false;
+  }
+}
+
+
+static void ods_ping(struct rtt_endpoint* ep)
+{
+  struct ods_endpoint* oep = ODS_ENDPOINT(ep);
+
+  if( oep->prepared ) {
+    onload_delegated_send_tcp_update(&(oep->ods), oep->ping_len, 1);
+    memcpy(oep->pkt_buf, oep->headers, oep->ods.headers_len);
+    memcpy(oep->pkt_buf + oep->ods.headers_len, oep->msg_buf, oep->ping_len);
+    int frame_len = oep->ods.headers_len + oep->ping_len;
+    if( oep->use_ctpio ) {
+      ef_vi_transmit_ctpio(&(oep->vi), oep->pkt_buf, frame_len,
+                           oep->ctpio_thresh);
+      RTT_TRY( ef_vi_transmit_ctpio_fallback(&(oep->vi), oep->pkt_dma_addr,
+                                             frame_len, 0) );
+    }
+    else {
+      RTT_TRY( ef_vi_transmit(&(oep->vi), oep->pkt_dma_addr, frame_len, 0) );
+    }
+    ods_poll_tx(oep);
+    struct iovec iov = { oep->msg_buf, oep->ping_len };
+    RTT_TRY( onload_delegated_send_complete(oep->sock, &iov, 1, 0) );
+    ++(oep->n_delegated);
+  }
+  else {
+    /* Windows closed (or delegated send otherwise unavailable): fall back
+     * to a normal intercepted send. */
+    RTT_TEST( send(oep->sock, oep->msg_buf, oep->ping_len, 0)
+              == oep->ping_len );
+    ++(oep->n_fallback);
+  }
+
+  /* Prepare the next send now so its cost is accounted against this
+   * iteration, as a real application would take it off the critical path. */
+  ods_prepare(oep);
+}
+
+
+static void ods_pong(struct rtt_endpoint* ep)
+{
+  struct ods_endpoint* oep = ODS_ENDPOINT(ep);
+  RTT_TEST( recv(oep->sock, oep->msg_buf, oep->pong_len, MSG_WAITALL)
+            == oep->pong_len );
+}
+
+
+static void ods_cleanup(struct rtt_endpoint* ep)
+{
+  struct ods_endpoint* oep = ODS_ENDPOINT(ep);
+  if( oep->prepared ) {
+    RTT_TRY( onload_delegated_send_cancel(oep->sock) );
+    oep->prepared = false;
+  }
+}
+
+
+static void ods_reset_stats(struct rtt_endpoint* ep)
+{
+  struct ods_endpoint* oep = ODS_ENDPOINT(ep);
+  oep->n_delegated = 0;
+  oep->n_fallback = 0;
+}
+
+
+static void ods_dump_info(struct rtt_endpoint* ep, FILE* f)
+{
+  struct ods_endpoint* oep = ODS_ENDPOINT(ep);
+  fprintf(f, "# ods_delegated_sends: %u\n", oep->n_delegated);
+  fprintf(f, "# ods_fallback_sends: %u\n", oep->n_fallback);
+}
+
+
+int rtt_ods_build_endpoint(struct rtt_endpoint** ep_out,
+                           const struct rtt_options* opts, unsigned dirs,
+                           const char** args, int n_args)
+{
+  const char* bind_port = NULL;
+  const char* bind_host = NULL;
+  const char* connect_port = NULL;
+  const char* connect_host = NULL;
+  const char* interface = NULL;
+  bool use_ctpio = false;
+  unsigned u;
+  char dummy;
+
+  int arg_i;
+  for( arg_i = 0; arg_i < n_args; ++arg_i ) {
+    const char* arg = args[arg_i];
+    if( ! strcmp(arg, "help") ) {
+      fprintf(stdout, "  intf=INTERFACE       - Ethernet interface name\n");
+      fprintf(stdout, "  bind_host=HOST       - local address to bind\n");
+      fprintf(stdout, "  bind_port=PORT       - local port to bind\n");
+      fprintf(stdout, "  connect_host=HOST    - remote address\n");
+      fprintf(stdout, "  connect_port=PORT    - remote port (else listen)\n");
+      fprintf(stdout, "  tx=dma               - DMA transmit (default)\n");
+      fprintf(stdout, "  tx=ctpio             - CTPIO transmit\n");
+      fprintf(stdout, "    ctpio_thresh=BYTES - set cut-through threshold\n");
+      exit(0);
+    }
+    else if( ! strncmp(arg, "bind_host=", 10) )
+      bind_host = arg + 10;
+    else if( ! strncmp(arg, "bind_port=", 10) )
+      bind_port = arg + 10;
+    else if( ! strncmp(arg, "connect_host=", 13) )
+      connect_host = arg + 13;
+    else if( ! strncmp(arg, "connect_port=", 13) )
+      connect_port = arg + 13;
+    else if( ! strncmp(arg, "intf=", 5) )
+      interface = arg + 5;
+    else if( ! strcmp(arg, "tx=dma") )
+      use_ctpio = false;
+    else if( ! strcmp(arg, "tx=ctpio") )
+      use_ctpio = true;
+    else if( sscanf(arg, "ctpio_thresh=%u%c", &u, &dummy) == 1 )
+      ;  /* handled below once use_ctpio is known */
+    else
+      return rtt_err("ERROR: bad arg: %s\n", arg);
+  }
+
+  if( ! onload_is_present() )
+    return rtt_err("ERROR: ods transport requires running under Onload\n");
+  if( (dirs & RTT_DIR_TX) && interface == NULL )
+    return rtt_err("ERROR: no intf= given for ods:\n");
+
+  struct ods_endpoint* oep = calloc(1, sizeof(*oep));
+  oep->ep.ping = ods_ping;
+  oep->ep.pong = ods_pong;
+  oep->ep.cleanup = ods_cleanup;
+  oep->ep.reset_stats = ods_reset_stats;
+  oep->ep.dump_info = ods_dump_info;
+  oep->use_ctpio = use_ctpio;
+  oep->ctpio_thresh = 64;
+  for( arg_i = 0; arg_i < n_args; ++arg_i )
+    if( sscanf(args[arg_i], "ctpio_thresh=%u%c", &u, &dummy) == 1 ) {
+      RTT_TEST( use_ctpio );
+      oep->ctpio_thresh = u;
+    }
+
+  oep->sock = tcp_sock_setup(bind_host, bind_port, connect_host, connect_port);
+  if( oep->sock < 0 )
+    return -1;
+
+  RTT_TEST( opts->ping_frame_len >= HEADERS );
+  RTT_TEST( opts->pong_frame_len >= HEADERS );
+  oep->ping_len = opts->ping_frame_len - HEADERS;
+  oep->pong_len = opts->pong_frame_len - HEADERS;
+  int max_len = oep->ping_len > oep->pong_len ? oep->ping_len : oep->pong_len;
+  RTT_TEST( (oep->msg_buf = malloc(max_len)) != NULL );
+  memset(oep->msg_buf, 0x5a, max_len);
+
+  if( dirs & RTT_DIR_TX ) {
+    unsigned vi_flags = use_ctpio ? EF_VI_TX_CTPIO : 0;
+    RTT_TRY( ef_driver_open(&(oep->dh)) );
+    RTT_TRY( ef_pd_alloc_by_name(&(oep->pd), oep->dh, interface, 0) );
+    RTT_TRY( ef_vi_alloc_from_pd(&(oep->vi), oep->dh, &(oep->pd), oep->dh,
+                                 -1, 0, -1, NULL, -1, vi_flags) );
+    void* p;
+    RTT_TEST( posix_memalign(&p, 4096, BUF_SIZE) == 0 );
+    RTT_TRY( ef_memreg_alloc(&(oep->memreg), oep->dh, &(oep->pd), oep->dh,
+                             p, BUF_SIZE) );
+    oep->pkt_buf = p;
+    oep->pkt_dma_addr = ef_memreg_dma_addr(&(oep->memreg), 0);
+
+    ods_prepare(oep);
+  }
+
+  *ep_out = &(oep->ep);
+  return 0;
+}
+
+
+/**********************************************************************
+ * Templated sends.
+ */
+
+#define TMPL_ENDPOINT(pep)                      \
+  CONTAINER_OF(struct tmpl_endpoint, ep, (pep))
+
+
+struct tmpl_endpoint {
+  struct rtt_endpoint    ep;
+  int                    sock;
+  char*                  msg_buf;
+  ssize_t                ping_len;
+  ssize_t                pong_len;
+  onload_template_handle tmpl;
+};
+
+
+static void tmpl_alloc(struct tmpl_endpoint* tep)
+{
+  struct iovec iov = { tep->msg_buf, tep->ping_len };
+  RTT_TRY( onload_msg_template_alloc(tep->sock, &iov, 1, &(tep->tmpl),
+                                     ONLOAD_TEMPLATE_FLAGS_PIO_RETRY) );
+}
+
+
+static void tmpl_ping(struct rtt_endpoint* ep)
+{
+  struct tmpl_endpoint* tep = TMPL_ENDPOINT(ep);
+  RTT_TRY( onload_msg_template_update(tep->sock, tep->tmpl, NULL, 0,
+                                      ONLOAD_TEMPLATE_FLAGS_SEND_NOW) );
+  /* Ownership of the template passed to Onload with the send, so allocate
+   * the next one here, as a real application would between messages. */
+  tmpl_alloc(tep);
+}
+
+
+static void tmpl_pong(struct rtt_endpoint* ep)
+{
+  struct tmpl_endpoint* tep = TMPL_ENDPOINT(ep);
+  RTT_TEST( recv(tep->sock, tep->msg_buf, tep->pong_len, MSG_WAITALL)
+            == tep->pong_len );
+}
+
+
+static void tmpl_cleanup(struct rtt_endpoint* ep)
+{
+  struct tmpl_endpoint* tep = TMPL_ENDPOINT(ep);
+  RTT_TRY( onload_msg_template_abort(tep->sock, tep->tmpl) );
+}
+
+
+int rtt_template_build_endpoint(struct rtt_endpoint** ep_out,
+                                const struct rtt_options* opts, unsigned dirs,
+                                const char** args, int n_args)
+{
+  const char* bind_port = NULL;
+  const char* bind_host = NULL;
+  const char* connect_port = NULL;
+  const char* connect_host = NULL;
+
+  int arg_i;
+  for( arg_i = 0; arg_i < n_args; ++arg_i ) {
+    const char* arg = args[arg_i];
+    if( ! strcmp(arg, "help") ) {
+      fprintf(stdout, "  bind_host=HOST       - local address to bind\n");
+      fprintf(stdout, "  bind_port=PORT       - local port to bind\n");
+      fprintf(stdout, "  connect_host=HOST    - remote address\n");
+      fprintf(stdout, "  connect_port=PORT    - remote port (else listen)\n");
+      exit(0);
+    }
+    else if( ! strncmp(arg, "bind_host=", 10) )
+      bind_host = arg + 10;
+    else if( ! strncmp(arg, "bind_port=", 10) )
+      bind_port = arg + 10;
+    else if( ! strncmp(arg, "connect_host=", 13) )
+      connect_host = arg + 13;
+    else if( ! strncmp(arg, "connect_port=", 13) )
+      connect_port = arg + 13;
+    else
+      return rtt_err("ERROR: bad arg: %s\n", arg);
+  }
+
+  if( ! onload_is_present() )
+    return rtt_err("ERROR: template transport requires running under "
+                   "Onload\n");
+
+  struct tmpl_endpoint* tep = calloc(1, sizeof(*tep));
+  tep->ep.ping = tmpl_ping;
+  tep->ep.pong = tmpl_pong;
+  tep->ep.cleanup = tmpl_cleanup;
+  tep->ep.reset_stats = NULL;
+  tep->ep.dump_info = NULL;
+
+  tep->sock = tcp_sock_setup(bind_host, bind_port, connect_host, connect_port);
+  if( tep->sock < 0 )
+    return -1;
+
+  RTT_TEST( opts->ping_frame_len >= HEADERS );
+  RTT_TEST( opts->pong_frame_len >= HEADERS );
+  tep->ping_len = opts->ping_frame_len - HEADERS;
+  tep->pong_len = opts->pong_frame_len - HEADERS;
+  int max_len = tep->ping_len > tep->pong_len ? tep->ping_len : tep->pong_len;
+  RTT_TEST( (tep->msg_buf = malloc(max_len)) != NULL );
+  memset(tep->msg_buf, 0x5a, max_len);
+
+  if( dirs & RTT_DIR_TX )
+    tmpl_alloc(tep);
+
+  *ep_out = &(tep->ep);
+  return 0;
+}
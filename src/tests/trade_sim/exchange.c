@@ -29,6 +29,9 @@
 #define INTERESTING_MSG    "hit me 0 0"
 #define BORING_MSG         "boring"
 
+/* Each "instrument" is published on its own multicast group. */
+#define MAX_INSTRUMENTS    32
+
 
 static const char* cfg_port = "8122";
 static const char* cfg_mcast_addr = "224.1.2.3";
@@ -38,14 +41,17 @@ static bool        cfg_hw_ts = true;
 static int         cfg_send_rate = 100000;
 static int         cfg_iter;
 static int         cfg_warm_n;
+static int         cfg_n_instruments = 1;
+static const char* cfg_out_file;
 
 
 struct server_state {
   int      epoll;
   int      listen_sock;
   int      tcp_sock;
-  int      udp_sock;
-  int      udp_sock_ts;
+  int      udp_socks[MAX_INSTRUMENTS];
+  int      udp_socks_ts[MAX_INSTRUMENTS];
+  int      tx_instr;
   bool     have_sent;
   bool     have_rx_ts;
   bool     have_tx_ts;
@@ -56,7 +62,7 @@ struct server_state {
   char*    tx_buf_ts;
   int      inter_tx_gap_ns;
   uint64_t rtt_sum;
-  unsigned rtt_min, rtt_max;
+  unsigned* samples;
   int      rtt_n;
   unsigned n_lost_msgs;
 };
@@ -151,9 +157,12 @@ static void wait_for_client(struct server_state* ss)
   TRY( epoll_ctl(ss->epoll, EPOLL_CTL_ADD, ss->tcp_sock, &e) );
 
   if( cfg_hw_ts ) {
-    e.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLPRI;
-    e.data.fd = ss->udp_sock_ts;
-    TRY( epoll_ctl(ss->epoll, EPOLL_CTL_ADD, ss->udp_sock_ts, &e) );
+    int i;
+    for( i = 0; i < cfg_n_instruments; ++i ) {
+      e.events = EPOLLIN | EPOLLHUP | EPOLLERR | EPOLLPRI;
+      e.data.fd = ss->udp_socks_ts[i];
+      TRY( epoll_ctl(ss->epoll, EPOLL_CTL_ADD, ss->udp_socks_ts[i], &e) );
+    }
   }
 
   if( cfg_hw_ts ) {
@@ -189,9 +198,52 @@ static void wait_for_client(struct server_state* ss)
       cfg_warm_n = 2;
   }
   ss->rtt_sum = 0;
-  ss->rtt_min = -1;
-  ss->rtt_max = 0;
   ss->rtt_n = -cfg_warm_n;
+  TEST( (ss->samples = malloc(cfg_iter * sizeof(ss->samples[0]))) != NULL );
+}
+
+
+static int cmp_unsigned(const void* pa, const void* pb)
+{
+  unsigned a = *(const unsigned*) pa, b = *(const unsigned*) pb;
+  return a < b ? -1 : a > b;
+}
+
+
+static unsigned percentile(const unsigned* sorted, int n, double frac)
+{
+  int i = (int) (frac * n);
+  return sorted[i < n ? i : n - 1];
+}
+
+
+static void report(struct server_state* ss)
+{
+  qsort(ss->samples, ss->rtt_n, sizeof(ss->samples[0]), cmp_unsigned);
+  unsigned mean = ss->rtt_sum / ss->rtt_n;
+  unsigned p50 = percentile(ss->samples, ss->rtt_n, 0.5);
+  unsigned p90 = percentile(ss->samples, ss->rtt_n, 0.9);
+  unsigned p99 = percentile(ss->samples, ss->rtt_n, 0.99);
+  unsigned p999 = percentile(ss->samples, ss->rtt_n, 0.999);
+  printf("n_lost_msgs:  %u\n", ss->n_lost_msgs);
+  printf("n_samples:    %d\n", ss->rtt_n);
+  printf("latency_mean: %u\n", mean);
+  printf("latency_min:  %u\n", ss->samples[0]);
+  printf("latency_p50:  %u\n", p50);
+  printf("latency_p90:  %u\n", p90);
+  printf("latency_p99:  %u\n", p99);
+  printf("latency_p999: %u\n", p999);
+  printf("latency_max:  %u\n", ss->samples[ss->rtt_n - 1]);
+  if( cfg_out_file != NULL ) {
+    FILE* f = fopen(cfg_out_file, "w");
+    TEST( f != NULL );
+    fprintf(f, "n_samples,n_lost_msgs,mean_ns,min_ns,"
+            "p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n");
+    fprintf(f, "%d,%u,%u,%u,%u,%u,%u,%u,%u\n", ss->rtt_n, ss->n_lost_msgs,
+            mean, ss->samples[0], p50, p90, p99, p999,
+            ss->samples[ss->rtt_n - 1]);
+    fclose(f);
+  }
 }
 
 
@@ -204,16 +256,9 @@ static void measured_rtt(struct server_state* ss, struct timespec tx_ts,
   msg(2, "rtt: %d\n", (int) ns);
   if( ++(ss->rtt_n) > 0 ) {
     ss->rtt_sum += ns;
-    if( ns <= ss->rtt_min )
-      ss->rtt_min = ns;
-    else if( ns >= ss->rtt_max )
-      ss->rtt_max = ns;
+    ss->samples[ss->rtt_n - 1] = ns;
     if( ss->rtt_n == cfg_iter ) {
-      printf("n_lost_msgs:  %u\n", ss->n_lost_msgs);
-      printf("n_samples:    %d\n", ss->rtt_n);
-      printf("latency_mean: %u\n", (unsigned) (ss->rtt_sum / ss->rtt_n));
-      printf("latency_min:  %u\n", ss->rtt_min);
-      printf("latency_max:  %u\n", ss->rtt_max);
+      report(ss);
       exit(0);
     }
   }
@@ -243,9 +288,10 @@ static void event_loop(struct server_state* ss)
         continue;
       timespec_add_ns(&next_tx_ts, ss->inter_tx_gap_ns);
       if( ++send_i >= cfg_measure_nth && ! ss->have_sent ) {
-        msg(3, "Send message (timed)\n");
-        TEST( send(ss->udp_sock_ts, ss->tx_buf_ts, ss->tx_msg_size, 0)
-                == ss->tx_msg_size );
+        msg(3, "Send message (timed, instrument %d)\n", ss->tx_instr);
+        TEST( send(ss->udp_socks_ts[ss->tx_instr], ss->tx_buf_ts,
+                   ss->tx_msg_size, 0) == ss->tx_msg_size );
+        ss->tx_instr = (ss->tx_instr + 1) % cfg_n_instruments;
         if( ! cfg_hw_ts ) {
           ss->have_tx_ts = true;
           tx_ts = now;
@@ -255,8 +301,9 @@ static void event_loop(struct server_state* ss)
       }
       else {
         msg(3, "Send message\n");
-        TEST( send(ss->udp_sock, ss->tx_buf, ss->tx_msg_size, 0)
+        TEST( send(ss->udp_socks[ss->tx_instr], ss->tx_buf, ss->tx_msg_size, 0)
                 == ss->tx_msg_size );
+        ss->tx_instr = (ss->tx_instr + 1) % cfg_n_instruments;
         if( send_i >= cfg_measure_nth ) {
           /* Not had a reply to last timed message.  Try to detect lost
            * messages.
@@ -309,10 +356,13 @@ static void event_loop(struct server_state* ss)
       }
     }
 
-    else if( e.data.fd == ss->udp_sock_ts ) {
+    else {
+      /* TX timestamp on one of the timestamping UDP sockets.  Only the
+       * socket the last timed message went out on can have one queued.
+       */
       assert( cfg_hw_ts );
       assert( ! ss->have_tx_ts );
-      TEST( recv_ts(ss->udp_sock_ts, ss->rx_buf, 1,
+      TEST( recv_ts(e.data.fd, ss->rx_buf, 1,
                     MSG_ERRQUEUE | MSG_DONTWAIT, &tx_ts) == 1 );
       msg(3, "TX timestamp %d.%09d\n", (int) tx_ts.tv_sec,
              (int) tx_ts.tv_nsec);
@@ -329,7 +379,8 @@ static void event_loop(struct server_state* ss)
 
 /**********************************************************************/
 
-static int mk_udp_sock(const char* mcast_intf, bool enable_timestamping)
+static int mk_udp_sock(const char* mcast_addr, const char* mcast_intf,
+                       bool enable_timestamping)
 {
   int sock;
   TRY( sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP) );
@@ -344,7 +395,7 @@ static int mk_udp_sock(const char* mcast_intf, bool enable_timestamping)
    * the wrong local address.
    */
   struct sockaddr_storage sas;
-  TRY( getaddrinfo_storage(AF_INET, cfg_mcast_addr, cfg_port, &sas) );
+  TRY( getaddrinfo_storage(AF_INET, mcast_addr, cfg_port, &sas) );
   TRY( connect(sock, (void*) &sas, sizeof(sas)) );
   if( enable_timestamping ) {
     int tsm = SOF_TIMESTAMPING_TX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
@@ -358,9 +409,15 @@ static int mk_udp_sock(const char* mcast_intf, bool enable_timestamping)
 
 static void init(struct server_state* ss, const char* mcast_intf)
 {
+  int i;
   TRY( ss->listen_sock = mk_socket(0, SOCK_STREAM, bind, NULL, cfg_port) );
-  TRY( ss->udp_sock = mk_udp_sock(mcast_intf, false) );
-  TRY( ss->udp_sock_ts = mk_udp_sock(mcast_intf, cfg_hw_ts) );
+  for( i = 0; i < cfg_n_instruments; ++i ) {
+    char addr[INET_ADDRSTRLEN];
+    TRY( mcast_addr_nth(cfg_mcast_addr, i, addr, sizeof(addr)) );
+    TRY( ss->udp_socks[i] = mk_udp_sock(addr, mcast_intf, false) );
+    TRY( ss->udp_socks_ts[i] = mk_udp_sock(addr, mcast_intf, cfg_hw_ts) );
+  }
+  ss->tx_instr = 0;
   TRY( ss->epoll = epoll_create(10) );
   ss->inter_tx_gap_ns = 1000000000 / cfg_send_rate;
   ss->n_lost_msgs = 0;
@@ -380,6 +437,8 @@ static void usage_msg(FILE* f)
   fprintf(f, "  -s                - use software timestamps\n");
   fprintf(f, "  -l <log-level>    - set log level\n");
   fprintf(f, "  -p <port>         - set TCP/UDP port number\n");
+  fprintf(f, "  -N <n>            - number of instruments (mcast groups)\n");
+  fprintf(f, "  -o <file>         - write CSV summary of results to file\n");
   fprintf(f, "\n");
 }
 
@@ -395,7 +454,7 @@ int main(int argc, char* argv[])
 {
   int c;
 
-  while( (c = getopt(argc, argv, "hr:n:i:w:sl:p:")) != -1 )
+  while( (c = getopt(argc, argv, "hr:n:i:w:sl:p:N:o:")) != -1 )
     switch( c ) {
     case 'h':
       usage_msg(stdout);
@@ -422,6 +481,12 @@ int main(int argc, char* argv[])
     case 'p':
       cfg_port = optarg;
       break;
+    case 'N':
+      cfg_n_instruments = atoi(optarg);
+      break;
+    case 'o':
+      cfg_out_file = optarg;
+      break;
     case '?':
       usage_err();
       break;
@@ -433,6 +498,8 @@ int main(int argc, char* argv[])
   argv += optind;
   if( argc != 1 )
     usage_err();
+  if( cfg_n_instruments < 1 || cfg_n_instruments > MAX_INSTRUMENTS )
+    usage_err();
   const char* mcast_intf = argv[0];
 
   if( onload_is_present() ) {
@@ -33,6 +33,12 @@
  *
  *   onload -p latency-best ./exchange <mcast-intf>
  *   onload -p latency-best ./trader_onload_ds_efvi -d <mcast-intf> <server>
+ *
+ * For "templated" sends (Onload's templated sends API, which preloads the
+ * packet into the adapter's PIO buffer), run as follows:
+ *
+ *   onload -p latency-best ./exchange <mcast-intf>
+ *   onload -p latency-best ./trader_onload_ds_efvi -t <mcast-intf> <server>
  */
 
 #include <etherfabric/vi.h>
@@ -43,6 +49,7 @@
 #include <etherfabric/checksum.h>
 #include <ci/net/ethernet.h>
 #include <onload/extensions.h>
+#include <onload/extensions_zc.h>
 #include "utils.h"
 
 #include <stddef.h>
@@ -71,6 +78,8 @@ static const char* cfg_mcast_addr = "224.1.2.3";
 static bool        cfg_ctpio_no_poison = 0;
 static unsigned    cfg_ctpio_thresh = 64;
 static int         cfg_pio_only = 0;
+static int         cfg_templated = 0;
+static int         cfg_n_instruments = 1;
 
 struct pkt_buf {
   ef_addr           dma_addr;
@@ -97,12 +106,17 @@ struct client_state {
   bool                         use_ctpio;
   bool                         send_is_delegated;
   struct onload_delegated_send ods;
+  /* tmpl_ready: Non-zero means [tmpl] holds a prepared templated send. */
+  onload_template_handle       tmpl;
+  bool                         tmpl_ready;
+  bool                         tmpl_warned;
   struct pkt_buf*              pkt_bufs[N_TX_BUFS];
   ef_memreg                    memreg;
   char                         recv_buf[MTU];
   unsigned                     n_normal_sends;
   unsigned                     n_delegated_sends;
   unsigned                     n_ctpio_sends;
+  unsigned                     n_templated_sends;
 };
 
 
@@ -280,6 +294,49 @@ static void delegated_send(struct client_state* cs)
 }
 
 
+/* Prepare a templated send.  As with delegated sends, the preparation is
+ * done off the critical path: Onload copies the message into the adapter's
+ * PIO buffer now, so that the trigger-time work is just a doorbell write.
+ */
+static void templated_prepare(struct client_state* cs)
+{
+  struct iovec iov = { cs->msg_buf, cs->msg_len };
+  int rc = onload_msg_template_alloc(cs->tcp_sock, &iov, 1, &cs->tmpl, 0);
+  if( rc == 0 ) {
+    cs->tmpl_ready = true;
+  }
+  else if( ! cs->tmpl_warned ) {
+    /* Typically means no PIO buffer is available (or the adapter does not
+     * support PIO).  Fall back to normal sends.
+     */
+    fprintf(stderr, "WARNING: onload_msg_template_alloc failed (rc=%d); "
+            "using normal sends\n", rc);
+    cs->tmpl_warned = true;
+  }
+}
+
+
+static void templated_send(struct client_state* cs)
+{
+  /* In this app the response payload does not change, so there are no
+   * updates to apply; just send the template as-is.
+   */
+  int rc = onload_msg_template_update(cs->tcp_sock, cs->tmpl, NULL, 0,
+                                      ONLOAD_TEMPLATE_FLAGS_SEND_NOW);
+  cs->tmpl_ready = false;
+  if( rc == 0 ) {
+    ++(cs->n_templated_sends);
+  }
+  else {
+    /* Template was invalidated (eg. by NIC reset).  Make sure the exchange
+     * still gets its response.
+     */
+    onload_msg_template_abort(cs->tcp_sock, cs->tmpl);
+    normal_send(cs);
+  }
+}
+
+
 static void ev_loop_sock(struct client_state* cs)
 {
   while( 1 ) {
@@ -320,6 +377,35 @@ static void ev_loop_sock(struct client_state* cs)
 }
 
 
+static void ev_loop_templated(struct client_state* cs)
+{
+  while( 1 ) {
+    int i;
+    for( i = 0; i < 100; ++i )
+      if( poll_udp_rx(cs) > 0 ) {
+        if( cs->tmpl_ready )
+          templated_send(cs);
+        else
+          normal_send(cs);
+      }
+
+    /* Off the critical path: get the next template ready. */
+    if( ! cs->tmpl_ready && ! cs->tmpl_warned )
+      templated_prepare(cs);
+    if( recv(cs->tcp_sock, cs->recv_buf,
+             sizeof(cs->recv_buf), MSG_DONTWAIT) == 0 )
+      break;
+  }
+
+  if( cs->tmpl_ready )
+    TRY( onload_msg_template_abort(cs->tcp_sock, cs->tmpl) );
+  close(cs->tcp_sock);
+
+  printf("n_normal_sends: %u\n", cs->n_normal_sends);
+  printf("n_templated_sends: %u\n", cs->n_templated_sends);
+}
+
+
 /**********************************************************************
  * The alarm thread just sets a flag periodically to remind the event loop
  * to refresh the headers.
@@ -414,22 +500,37 @@ static void init(struct client_state* cs, const char* mcast_intf,
   sock_put_int(cs->tcp_sock, cfg_tx_size);
   sock_put_int(cs->tcp_sock, cfg_rx_size);
 
-  /* Create UDP socket, bind, join multicast group. */
+  /* Create UDP socket, bind, join multicast group(s).  With multiple
+   * instruments we have to bind to the wildcard address to receive all of
+   * the groups on one socket.
+   */
   TRY( cs->udp_sock = mk_socket(0, SOCK_DGRAM, bind,
-                                cfg_mcast_addr, cfg_port) );
+                                cfg_n_instruments > 1 ? NULL : cfg_mcast_addr,
+                                cfg_port) );
   if( mcast_intf != NULL ) {
-    struct ip_mreqn mreqn;
-    TEST( inet_aton(cfg_mcast_addr, &mreqn.imr_multiaddr) );
-    mreqn.imr_address.s_addr = htonl(INADDR_ANY);
-    TEST( (mreqn.imr_ifindex = if_nametoindex(mcast_intf)) != 0 );
-    TRY( setsockopt(cs->udp_sock, SOL_IP, IP_ADD_MEMBERSHIP,
-                    &mreqn, sizeof(mreqn)) );
+    int i;
+    for( i = 0; i < cfg_n_instruments; ++i ) {
+      char addr[INET_ADDRSTRLEN];
+      struct ip_mreqn mreqn;
+      TRY( mcast_addr_nth(cfg_mcast_addr, i, addr, sizeof(addr)) );
+      TEST( inet_aton(addr, &mreqn.imr_multiaddr) );
+      mreqn.imr_address.s_addr = htonl(INADDR_ANY);
+      TEST( (mreqn.imr_ifindex = if_nametoindex(mcast_intf)) != 0 );
+      TRY( setsockopt(cs->udp_sock, SOL_IP, IP_ADD_MEMBERSHIP,
+                      &mreqn, sizeof(mreqn)) );
+    }
   }
 
-  ef_vi_init(cs);
   cs->msg_len = cfg_tx_size;
-  cs->msg_buf = cs->pkt_bufs[FIRST_TX_BUF]->dma_start + MAX_ETH_HEADERS +
-    MAX_IP_TCP_HEADERS;
+  if( cfg_templated ) {
+    /* Templated sends use Onload's own PIO buffer, so no ef_vi needed. */
+    TEST( (cs->msg_buf = calloc(1, cfg_tx_size)) != NULL );
+  }
+  else {
+    ef_vi_init(cs);
+    cs->msg_buf = cs->pkt_bufs[FIRST_TX_BUF]->dma_start + MAX_ETH_HEADERS +
+      MAX_IP_TCP_HEADERS;
+  }
 }
 
 
@@ -446,6 +547,8 @@ static void usage_msg(FILE* f)
   fprintf(f, "  -c <threshold>    - CTPIO cut-through threshold\n");
   fprintf(f, "  -n                - CTPIO no-poison mode\n");
   fprintf(f, "  -P                - use PIO (rather than CTPIO)\n");
+  fprintf(f, "  -t                - use templated sends API to send\n");
+  fprintf(f, "  -N <n>            - number of instruments (mcast groups)\n");
   fprintf(f, "\n");
 }
 
@@ -461,7 +564,7 @@ int main(int argc, char* argv[])
 {
   int c;
 
-  while( (c = getopt(argc, argv, "hs:r:dp:c:nP")) != -1 )
+  while( (c = getopt(argc, argv, "hs:r:dp:c:nPtN:")) != -1 )
     switch( c ) {
     case 'h':
       usage_msg(stdout);
@@ -488,6 +591,12 @@ int main(int argc, char* argv[])
     case 'P':
       cfg_pio_only = 1;
       break;
+    case 't':
+      cfg_templated = 1;
+      break;
+    case 'N':
+      cfg_n_instruments = atoi(optarg);
+      break;
     case '?':
       usage_err();
       break;
@@ -499,19 +608,29 @@ int main(int argc, char* argv[])
   argv += optind;
   if( argc != 2 )
     usage_err();
+  if( cfg_templated && (cfg_delegated || cfg_pio_only) )
+    usage_err();
+  if( cfg_n_instruments < 1 )
+    usage_err();
   const char* mcast_intf = argv[0];
   const char* server = argv[1];
 
-  if( cfg_delegated && ! onload_is_present() ) {
-    fprintf(stderr, "ERROR: Must run with Onload to use delegated sends\n");
+  if( (cfg_delegated || cfg_templated) && ! onload_is_present() ) {
+    fprintf(stderr, "ERROR: Must run with Onload to use delegated or "
+            "templated sends\n");
     exit(1);
   }
 
   struct client_state* cs = calloc(1, sizeof(*cs));
   init(cs, mcast_intf, server, cfg_port);
-  pthread_t tid;
-  TEST( pthread_create(&tid, NULL, alarm_thread, cs) == 0 );
-  ev_loop_sock(cs);
+  if( cfg_templated ) {
+    ev_loop_templated(cs);
+  }
+  else {
+    pthread_t tid;
+    TEST( pthread_create(&tid, NULL, alarm_thread, cs) == 0 );
+    ev_loop_sock(cs);
+  }
   return 0;
 }
 
@@ -84,6 +84,18 @@ int getaddrinfo_storage(int family, const char* host, const char* port,
 }
 
 
+int mcast_addr_nth(const char* base, int n, char* buf, size_t buf_len)
+{
+  struct in_addr ia;
+  if( ! inet_aton(base, &ia) )
+    return -1;
+  ia.s_addr = htonl(ntohl(ia.s_addr) + n);
+  if( inet_ntop(AF_INET, &ia, buf, buf_len) == NULL )
+    return -1;
+  return 0;
+}
+
+
 int mk_socket(int family, int socktype,
               int op(int sockfd, const struct sockaddr *addr,
                      socklen_t addrlen),
@@ -81,6 +81,11 @@ extern int getaddrinfo_storage(int family,
                                const char* host, const char* port,
                                struct sockaddr_storage* sas);
 
+/* Format the n-th address of a run of consecutive multicast addresses
+ * starting at [base].
+ */
+extern int mcast_addr_nth(const char* base, int n, char* buf, size_t buf_len);
+
 extern int mk_socket(int family, int socktype,
                      int op(int sockfd, const struct sockaddr *addr,
                             socklen_t addrlen),
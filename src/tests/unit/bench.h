@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2023 Advanced Micro Devices, Inc. */
+
+/* Microbenchmark infrastructure.
+ *
+ * A benchmark suite is an executable program built like the unit tests
+ * (same stubbing and library-object linkage; see mmake.mk) but run via the
+ * 'bench' target rather than as part of 'all', since timings are not
+ * pass/fail and should not gate builds.
+ *
+ * Each case is a function which runs its operation [iters] times; the
+ * harness times whole runs with the cycle counter, repeats them, and
+ * reports the best and median cycles per operation.  The best of several
+ * runs is the least-disturbed measurement and is the number to track
+ * across Onload versions; the median shows how noisy the machine was.
+ *
+ * Results are cycle counts on whatever machine runs them, so comparisons
+ * are only meaningful between runs on the same (ideally quiesced) host.
+ */
+#ifndef ONLOAD_UNIT_BENCH_H
+#define ONLOAD_UNIT_BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <ci/tools.h>
+
+/* Run a single benchmark case defined by a function */
+#define BENCH_RUN(BENCH_FN, ITERS) \
+  ub_bench_run(#BENCH_FN, BENCH_FN, ITERS)
+
+/* End a benchmark suite.  Unlike TEST_END() there is no failure state;
+ * exiting non-zero is reserved for setup errors via ub_fail(). */
+#define BENCH_END() \
+  return 0
+
+/* Number of timed repetitions of each case */
+#define UB_ROUNDS 9
+
+typedef void (*ub_bench_fn)(long iters);
+
+static inline void ub_fail(const char* msg)
+{
+  fprintf(stderr, "bench setup failed: %s\n", msg);
+  exit(1);
+}
+
+static int ub_cmp_u64(const void* a, const void* b)
+{
+  ci_uint64 l = *(const ci_uint64*) a, r = *(const ci_uint64*) b;
+  return l < r ? -1 : l > r;
+}
+
+static inline void ub_bench_run(const char* name, ub_bench_fn fn, long iters)
+{
+  ci_uint64 cycles[UB_ROUNDS];
+  ci_uint64 start, stop;
+  int i;
+
+  /* Warm code and data before the timed rounds */
+  fn(iters);
+
+  for( i = 0; i < UB_ROUNDS; ++i ) {
+    ci_frc64(&start);
+    fn(iters);
+    ci_frc64(&stop);
+    cycles[i] = stop - start;
+  }
+
+  qsort(cycles, UB_ROUNDS, sizeof(cycles[0]), ub_cmp_u64);
+  printf("%-40s %8.1f cycles/op best, %8.1f median (%ld iters)\n",
+         name, (double) cycles[0] / iters,
+         (double) cycles[UB_ROUNDS / 2] / iters, iters);
+}
+
+#endif
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2023 Advanced Micro Devices, Inc. */
+
+/* Functions under benchmark: the inline eplock fast paths.  The contended
+ * paths (__ef_eplock_lock_slow and the unlock wake ioctl) need a driver
+ * and are not measurable here. */
+#include <ci/internal/ip.h>
+
+/* Benchmark infrastructure */
+#include "bench.h"
+
+/* Dependencies */
+#include <onload/ul/per_thread.h>
+__thread struct oo_per_thread oo_per_thread;
+
+#include <ci/internal/efabcfg.h>
+ci_cfg_opts_t ci_cfg_opts;
+
+static ci_netif ni;
+
+/* Uncontended lock/unlock pair, as on every stack poll */
+static void bench_lock_unlock(long iters)
+{
+  ci_eplock_t* l = &ni.state->lock;
+  ci_uint64 lv;
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    (void) ef_eplock_lock(&ni);
+    ef_eplock_try_unlock(l, &lv, CI_EPLOCK_CALLBACK_FLAGS);
+  }
+}
+
+/* Trylock on an already-locked lock, as when a second thread finds the
+ * stack busy and falls back to spinning */
+static void bench_trylock_contended(long iters)
+{
+  ci_eplock_t* l = &ni.state->lock;
+  long n;
+
+  l->lock = CI_EPLOCK_LOCKED;
+  for( n = 0; n < iters; ++n )
+    (void) ef_eplock_trylock(l);
+  l->lock = 0;
+}
+
+/* Setting an unlock flag while holding the lock, as done to defer work */
+static void bench_set_clear_flag(long iters)
+{
+  ci_eplock_t* l = &ni.state->lock;
+  long n;
+
+  l->lock = CI_EPLOCK_LOCKED;
+  for( n = 0; n < iters; ++n ) {
+    ef_eplock_holder_set_flag(l, CI_EPLOCK_NETIF_NEED_POLL);
+    ef_eplock_clear_flags(l, CI_EPLOCK_NETIF_NEED_POLL);
+  }
+  l->lock = 0;
+}
+
+int main(void)
+{
+  ni.state = calloc(1, sizeof(ci_netif_state));
+  if( ni.state == NULL )
+    ub_fail("state allocation");
+
+  BENCH_RUN(bench_lock_unlock, 1000000);
+  BENCH_RUN(bench_trylock_contended, 1000000);
+  BENCH_RUN(bench_set_clear_flag, 1000000);
+
+  BENCH_END();
+}
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2023 Advanced Micro Devices, Inc. */
+
+/* Functions under benchmark */
+#include <ci/internal/ip.h>
+
+/* Benchmark infrastructure */
+#include "bench.h"
+
+/* Dependencies */
+#include <onload/ul/per_thread.h>
+__thread struct oo_per_thread oo_per_thread;
+
+#include <ci/internal/efabcfg.h>
+ci_cfg_opts_t ci_cfg_opts;
+
+/* The timer wheels live in the stack's shared state and the timers
+ * themselves must be addressable by oo_p (an offset from ni->state), so
+ * fabricate a state block with the benchmark's timers placed after the
+ * netif state.  We initialise only the wheel fields that
+ * ci_ip_timer_set/clear/modify touch; full calibration
+ * (ci_ip_timer_state_init()) pulls in objects we do not link. */
+
+#define N_TIMERS  1024
+
+/* Start time: multiple of the wheel-0 span so wheel-0 deltas stay in it */
+#define BASE_TICKS  0x40000u
+
+static ci_netif ni;
+static ci_ip_timer* timers;
+
+static void make_netif(void)
+{
+  unsigned timers_off = CI_ROUND_UP(sizeof(ci_netif_state),
+                                    (unsigned) CI_PAGE_SIZE);
+  char* blk = calloc(1, timers_off + N_TIMERS * sizeof(ci_ip_timer));
+  ci_ip_timer_state* ipts;
+  int i;
+
+  if( blk == NULL )
+    ub_fail("state block allocation");
+  ni.state = (ci_netif_state*) blk;
+  ipts = IPTIMER_STATE(&ni);
+
+  ipts->sched_ticks = BASE_TICKS;
+  ipts->closest_timer = BASE_TICKS + 2 * CI_IPTIME_BUCKETS;
+  oo_p_dllink_init(&ni, oo_p_dllink_ptr(&ni, &ipts->fire_list));
+  for( i = 0; i < CI_IPTIME_WHEELSIZE; ++i )
+    oo_p_dllink_init(&ni, oo_p_dllink_ptr(&ni, &ipts->warray[i]));
+
+  timers = (ci_ip_timer*) (blk + timers_off);
+  for( i = 0; i < N_TIMERS; ++i )
+    ci_ip_timer_init(&ni, &timers[i],
+                     timers_off + i * sizeof(ci_ip_timer), "bnch");
+}
+
+/* Insert and cancel a wheel-0 timer (the RTO/delack case: the timer is
+ * nearly always cancelled before it fires) */
+static void bench_set_clear_wheel0(long iters)
+{
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    ci_ip_timer* ts = &timers[n % N_TIMERS];
+    ci_ip_timer_set(&ni, ts, BASE_TICKS + 1 + (n % CI_IPTIME_BUCKETMASK));
+    ci_ip_timer_clear(&ni, ts);
+  }
+}
+
+/* As above but landing in an outer wheel (long timeouts: keepalive etc.) */
+static void bench_set_clear_outer_wheel(long iters)
+{
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    ci_ip_timer* ts = &timers[n % N_TIMERS];
+    ci_ip_timer_set(&ni, ts, BASE_TICKS + (1u << 20) + (n % N_TIMERS));
+    ci_ip_timer_clear(&ni, ts);
+  }
+}
+
+/* Re-arm a pending timer (the common RTO restart on ACK receipt) */
+static void bench_modify(long iters)
+{
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    ci_ip_timer* ts = &timers[n % N_TIMERS];
+    ci_ip_timer_modify(&ni, ts, BASE_TICKS + 1 + (n % CI_IPTIME_BUCKETMASK));
+  }
+}
+
+int main(void)
+{
+  int i;
+
+  make_netif();
+
+  BENCH_RUN(bench_set_clear_wheel0, 1000000);
+  BENCH_RUN(bench_set_clear_outer_wheel, 1000000);
+
+  for( i = 0; i < N_TIMERS; ++i )
+    ci_ip_timer_set(&ni, &timers[i], BASE_TICKS + 1 + (i % CI_IPTIME_BUCKETMASK));
+  BENCH_RUN(bench_modify, 1000000);
+
+  BENCH_END();
+}
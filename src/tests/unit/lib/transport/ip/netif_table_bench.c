@@ -0,0 +1,179 @@
+/* SPDX-License-Identifier: GPL-2.0 OR BSD-2-Clause */
+/* X-SPDX-Copyright-Text: (c) Copyright 2023 Advanced Micro Devices, Inc. */
+
+/* Functions under benchmark */
+#include <ci/internal/ip.h>
+
+/* Benchmark infrastructure */
+#include "bench.h"
+
+/* Dependencies */
+#include <onload/ul/per_thread.h>
+__thread struct oo_per_thread oo_per_thread;
+
+#include <ci/internal/efabcfg.h>
+ci_cfg_opts_t ci_cfg_opts;
+
+/* The software filter table and the socket buffers it points at normally
+ * live in driver-initialised shared state.  Fabricate just enough of both
+ * in ordinary memory: a block laid out like the shared state (socket
+ * buffers at [ep_ofs], so oo_p resolution works) and an empty table which
+ * we populate through ci_netif_filter_insert(). */
+
+#define TBL_SIZE_LG2  16
+#define TBL_SIZE      (1u << TBL_SIZE_LG2)
+#define N_SOCKS       512
+
+/* EMPTY entry encoding; must match the enum in netif_table.c.  The table
+ * is normally initialised by the driver (ci_netif_filter_init()), which is
+ * not part of the object under benchmark. */
+#define BENCH_ENTRY_EMPTY (2u << 30)
+
+static ci_netif ni;
+
+static ci_uint32 bench_raddr(int i) { return CI_BSWAP_BE32(0x0a020000 + i); }
+static ci_uint16 bench_rport(int i) { return CI_BSWAP_BE16(0x4000 + i); }
+
+/* Local addresses and ports are chosen per socket at populate() time: an
+ * insert can legitimately fail on an unlucky key (e.g. a cuckoo
+ * displacement dead-end), in which case we perturb the port and retry. */
+static ci_uint32 bench_laddr_tbl[N_SOCKS];
+static ci_uint16 bench_lport_tbl[N_SOCKS];
+
+static void make_netif(void)
+{
+  unsigned ep_ofs = CI_ROUND_UP(sizeof(ci_netif_state),
+                                (unsigned) CI_PAGE_SIZE);
+  char* blk = calloc(1, ep_ofs + N_SOCKS * EP_BUF_SIZE);
+  unsigned i;
+
+  if( blk == NULL )
+    ub_fail("state block allocation");
+  ni.state = (ci_netif_state*) blk;
+  /* CI_ULCONST fields: writable only by the driver, cast away here */
+  *(ci_uint32*) &ni.state->ep_ofs = ep_ofs;
+  *(ci_uint32*) &ni.state->n_ep_bufs = N_SOCKS;
+  /* Satisfy ci_netif_is_locked() asserts */
+  ni.state->lock.lock = CI_EPLOCK_LOCKED;
+
+  ni.filter_table = calloc(1, sizeof(ci_netif_filter_table) +
+                              (TBL_SIZE - 1) *
+                              sizeof(ci_netif_filter_table_entry_fast));
+  ni.filter_table_ext = calloc(TBL_SIZE,
+                               sizeof(ci_netif_filter_table_entry_ext));
+  if( ni.filter_table == NULL || ni.filter_table_ext == NULL )
+    ub_fail("filter table allocation");
+  *(unsigned*) &ni.filter_table->table_size_mask = TBL_SIZE - 1;
+  for( i = 0; i < TBL_SIZE; ++i )
+    ni.filter_table->table[i].__id_and_state = BENCH_ENTRY_EMPTY;
+}
+
+static void populate(void)
+{
+  int i, attempt;
+
+  for( i = 0; i < N_SOCKS; ++i ) {
+    ci_sock_cmn* s = SP_TO_SOCK(&ni, OO_SP_FROM_INT(&ni, i));
+    sock_raddr_be32(s) = bench_raddr(i);
+    sock_rport_be16(s) = bench_rport(i);
+    sock_protocol(s) = IPPROTO_TCP;
+
+    bench_laddr_tbl[i] = CI_BSWAP_BE32(0x0a010000 + i);
+    for( attempt = 0; attempt < 16; ++attempt ) {
+      bench_lport_tbl[i] = CI_BSWAP_BE16(0x2000 + i + (attempt << 10));
+      if( ci_netif_filter_insert(&ni, OO_SP_FROM_INT(&ni, i),
+                                 AF_SPACE_FLAG_IP4,
+                                 CI_ADDR_FROM_IP4(bench_laddr_tbl[i]),
+                                 bench_lport_tbl[i],
+                                 CI_ADDR_FROM_IP4(bench_raddr(i)),
+                                 bench_rport(i), IPPROTO_TCP) == 0 )
+        break;
+      s->s_flags &= ~CI_SOCK_FLAG_SW_FILTER_FULL;
+    }
+    if( attempt == 16 )
+      ub_fail("filter insert");
+  }
+}
+
+static void depopulate(void)
+{
+  int i;
+
+  for( i = 0; i < N_SOCKS; ++i )
+    ci_netif_filter_remove(&ni, OO_SP_FROM_INT(&ni, i), AF_SPACE_FLAG_IP4,
+                           CI_ADDR_FROM_IP4(bench_laddr_tbl[i]), bench_lport_tbl[i],
+                           CI_ADDR_FROM_IP4(bench_raddr(i)), bench_rport(i),
+                           IPPROTO_TCP);
+}
+
+/* Accumulator so the lookup result is consumed and cannot be optimised out */
+static volatile long sink;
+
+static void bench_lookup_hit(long iters)
+{
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    int i = n % N_SOCKS;
+    sink += ci_netif_filter_lookup(&ni, AF_SPACE_FLAG_IP4,
+                                   CI_ADDR_FROM_IP4(bench_laddr_tbl[i]),
+                                   bench_lport_tbl[i],
+                                   CI_ADDR_FROM_IP4(bench_raddr(i)),
+                                   bench_rport(i), IPPROTO_TCP);
+  }
+}
+
+static void bench_lookup_miss(long iters)
+{
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    int i = n % N_SOCKS;
+    sink += ci_netif_filter_lookup(&ni, AF_SPACE_FLAG_IP4,
+                                   CI_ADDR_FROM_IP4(bench_laddr_tbl[i] ^ 0xff0000),
+                                   bench_lport_tbl[i],
+                                   CI_ADDR_FROM_IP4(bench_raddr(i)),
+                                   bench_rport(i), IPPROTO_TCP);
+  }
+}
+
+static void bench_insert_remove(long iters)
+{
+  long n;
+
+  for( n = 0; n < iters; ++n ) {
+    int i = n % N_SOCKS;
+    ci_netif_filter_remove(&ni, OO_SP_FROM_INT(&ni, i), AF_SPACE_FLAG_IP4,
+                           CI_ADDR_FROM_IP4(bench_laddr_tbl[i]), bench_lport_tbl[i],
+                           CI_ADDR_FROM_IP4(bench_raddr(i)), bench_rport(i),
+                           IPPROTO_TCP);
+    ci_netif_filter_insert(&ni, OO_SP_FROM_INT(&ni, i), AF_SPACE_FLAG_IP4,
+                           CI_ADDR_FROM_IP4(bench_laddr_tbl[i]), bench_lport_tbl[i],
+                           CI_ADDR_FROM_IP4(bench_raddr(i)), bench_rport(i),
+                           IPPROTO_TCP);
+  }
+}
+
+int main(void)
+{
+  make_netif();
+
+  /* Linear-probing table (the default) */
+  puts("# linear probing (default)");
+  NI_OPTS(&ni).sw_filter_cuckoo = 0;
+  populate();
+  BENCH_RUN(bench_lookup_hit, 1000000);
+  BENCH_RUN(bench_lookup_miss, 1000000);
+  BENCH_RUN(bench_insert_remove, 100000);
+  depopulate();
+
+  /* Cuckoo table */
+  puts("# cuckoo (EF_SW_FILTER_CUCKOO=1)");
+  NI_OPTS(&ni).sw_filter_cuckoo = 1;
+  populate();
+  BENCH_RUN(bench_lookup_hit, 1000000);
+  BENCH_RUN(bench_lookup_miss, 1000000);
+  BENCH_RUN(bench_insert_remove, 100000);
+
+  BENCH_END();
+}
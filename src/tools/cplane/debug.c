@@ -98,14 +98,4 @@ void cp_mibs_verify_identical(struct cp_session* s, bool llap_only)
   }
 }
 
-void cp_fwd_verify_identical(struct cp_fwd_row* s)
-{
-  if( ~s->flags & CICP_FWD_FLAG_DATA_VALID )
-    return;
-  ci_assert_nflags(s->flags, CICP_FWD_FLAG_CHANGES_STARTED);
-  ci_assert_flags(s->flags, CICP_FWD_FLAG_OCCUPIED);
-  /* memcmp exploits the fact that the data in fwd table is 0 padded */
-  ci_assert(memcmp(&s->data[0], &s->data[1], sizeof(s->data[0])) == 0);
-}
-
 #endif
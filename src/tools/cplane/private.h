@@ -517,6 +517,17 @@ struct cp_session {
   /* How long to we keep fwd entries in cache? */
   uint64_t frc_fwd_cache_ttl;
 
+  /* Minimum interval between full fwd-cache refreshes while netlink
+   * updates keep arriving, so that a routing flap is applied as a few
+   * batched refreshes instead of one per socketful of messages.  Zero
+   * means refresh on every main-loop iteration.  See
+   * --fwd-refresh-holdoff. */
+  uint64_t frc_fwd_refresh_holdoff;
+
+  /* When non-zero, a deferred fwd-cache refresh is pending and must
+   * happen no later than this timestamp. */
+  uint64_t frc_fwd_refresh_deadline;
+
   /* Private per-fwd-table data.  These are initialised lazily in
    * cp_get_fwd_state(), which should ordinarily be used to access this array.
    */
@@ -606,12 +617,9 @@ static inline struct cp_mibs* cp_get_scratch_mib(struct cp_session* s)
 
 #ifndef NDEBUG
 extern void cp_mibs_verify_identical(struct cp_session* s, bool llap_only);
-extern void cp_fwd_verify_identical(struct cp_fwd_row* s);
 #else
 static inline void cp_mibs_verify_identical(struct cp_session* s, bool llap_only)
 {}
-static inline void cp_fwd_verify_identical(struct cp_fwd_row* s)
-{}
 #endif
 
 static inline struct cp_ip_prefix_list*
@@ -740,20 +748,42 @@ cp_get_fwd_data_scratch(struct cp_fwd_row* r)
   return &r->data[(*cp_fwd_version(r) & 1) ^ 1];
 }
 
+/* Re-publish a row's current data, unchanged, under a new version.  This
+ * is used where we want to force clients to re-validate cached verinfos
+ * (e.g. when a more specific route has been inserted elsewhere in the
+ * table): the data must be copied across so that the snapshot which
+ * becomes current holds a complete row. */
+static inline void cp_fwd_row_republish(struct cp_fwd_row* fwd)
+{
+  *cp_get_fwd_data_scratch(fwd) = *cp_get_fwd_data_current(fwd);
+  ci_wmb();
+  ++fwd->version;
+}
+
+/* Update a fwd row by publishing a complete new epoch: the current data is
+ * copied into the scratch (inactive) snapshot, the body of the loop
+ * applies its changes there, and FWD_UPDATE_LOOP_END() makes that snapshot
+ * current with a single version increment (cp_fwd_change_done()).  The
+ * current snapshot is never written in place, so a reader always finds a
+ * complete row under the version it sampled; it can only see a version
+ * change if a further update was published while it was copying the row.
+ *
+ * The body must call cp_fwd_under_change() if it modifies anything; if it
+ * does not, no new epoch is published.  [ver_i_] is retained from the old
+ * two-pass updating scheme to avoid churning the callers. */
 #define FWD_UPDATE_LOOP(fwd_data_, fwd_, ver_i_) \
   { \
-    cp_fwd_verify_identical((fwd_)); \
     ci_assert_nflags((fwd_)->flags, CICP_FWD_FLAG_CHANGES_STARTED); \
-    for( (ver_i_) = 0; (ver_i_) < 2; ++(ver_i_) ) { \
-      (fwd_data_) = cp_get_fwd_data_scratch((fwd_)); \
-      do {
+    (ver_i_) = 0; \
+    (void) (ver_i_); \
+    (fwd_data_) = cp_get_fwd_data_scratch((fwd_)); \
+    if( (fwd_)->flags & CICP_FWD_FLAG_DATA_VALID ) \
+      *(fwd_data_) = *cp_get_fwd_data_current((fwd_)); \
+    do {
 
 #define FWD_UPDATE_LOOP_END(fwd_) \
-      } while(0); \
-      if( ! cp_fwd_change_done((fwd_)) ) \
-        break; /* no work has been done */ \
-    } \
-    cp_fwd_verify_identical((fwd_)); \
+    } while(0); \
+    cp_fwd_change_done((fwd_)); \
   }
 
 
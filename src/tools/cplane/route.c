@@ -19,7 +19,8 @@
  *    table entry; no external reference is allowed.
  * 3. Each forward entry is protected by a version-lock.  In case of even
  *    verlock value, user should use fwd->data[0], and fwd->data[1]
- *    otherwise.  Start again if verlock changes under feet.
+ *    otherwise.  Each update publishes a complete row and moves the
+ *    verlock once.
  * 4. Fwd cache is a hash table; size is set from command line.
  * 5. Bitmap of all prefixes in use: fwd_prefix.
  * 6. How client uses it: cp_fwd_find_match() in English.
@@ -109,13 +110,21 @@
  * and check that verlock value does not change under their feet.
  *
  * When cplane updates a fwd entry, it performs it in following sequence:
- * - update non-active data structure;
- * - move verlock;
- * - update another data structure;
- * - move verlock again.
- * The last step does not look necessary, but it is easier to code this
- * all.  For example in some cases cplane updates verlock without any
- * update to the data itself (see sections 1 and 7).
+ * - copy the active data structure into the non-active one;
+ * - apply the changes to the non-active data structure;
+ * - move verlock once.
+ * The active data structure is never written in place, so whichever
+ * snapshot the verlock selected when the user sampled it holds a complete
+ * row.  The user re-checks the verlock after copying the data out, but a
+ * mismatch means a strictly newer route was published in that window; the
+ * user never observes a half-written row.  (The old scheme updated both
+ * snapshots one after another, moving the verlock twice, which doubled
+ * the invalidations and left a long window in which readers would retry.)
+ *
+ * In some cases cplane moves the verlock without any change to the data
+ * itself (see sections 1 and 7); the active data must then be copied
+ * across so that the newly-selected snapshot is complete - see
+ * cp_fwd_row_republish().
  *
  *
  * 4. Hash table
@@ -822,8 +831,8 @@ fwd_remove_old_multipath(struct cp_fwd_table* fwd_table,
   struct cp_fwd_state* fwd_state = CI_CONTAINER(struct cp_fwd_state, fwd_table,
                                                 fwd_table);
 
-  if( fwd->data->weight.end < arg->w->end &&
-      fwd->data->weight.end > arg->w->end - arg->w->val )
+  if( cp_get_fwd_data_current(fwd)->weight.end < arg->w->end &&
+      cp_get_fwd_data_current(fwd)->weight.end > arg->w->end - arg->w->val )
     fwd_row_del(arg->s, fwd_state, &fwd->key, fwd_id);
   return false; /* continue iterating */
 }
@@ -835,8 +844,8 @@ fwd_find_old_last_multipath(struct cp_fwd_table* fwd_table,
   struct fwd_iterate_weight_arg* arg = arg_void;
   struct cp_fwd_row* fwd = cp_get_fwd_by_id(fwd_table, fwd_id);
 
-  if( fwd->data->weight.flag & CP_FWD_MULTIPATH_FLAG_LAST &&
-      fwd->data->weight.end != arg->w->end )
+  if( cp_get_fwd_data_current(fwd)->weight.flag & CP_FWD_MULTIPATH_FLAG_LAST &&
+      cp_get_fwd_data_current(fwd)->weight.end != arg->w->end )
     return true;
   return false;
 }
@@ -850,7 +859,7 @@ fwd_remove_larger_multipath(struct cp_fwd_table* fwd_table,
   struct cp_fwd_state* fwd_state = CI_CONTAINER(struct cp_fwd_state, fwd_table,
                                                 fwd_table);
 
-  if( fwd->data->weight.end > arg->w->end )
+  if( cp_get_fwd_data_current(fwd)->weight.end > arg->w->end )
     fwd_row_del(arg->s, fwd_state, &fwd->key, fwd_id);
   return false; /* continue iterating */
 }
@@ -863,7 +872,7 @@ fwd_remove_multipath(struct cp_fwd_table* fwd_table,
   struct cp_fwd_state* fwd_state = CI_CONTAINER(struct cp_fwd_state, fwd_table,
                                                 fwd_table);
 
-  if( fwd->data->weight.end != 0 )
+  if( cp_get_fwd_data_current(fwd)->weight.end != 0 )
     fwd_row_del(session, fwd_state, &fwd->key, fwd_id);
   return false; /* continue iterating */
 }
@@ -1575,8 +1584,8 @@ arp_request_update(struct cp_session* s, struct cp_fwd_state* fwd_state,
   op.verinfo.version = *cp_fwd_version(fwd);
   op.fwd_table_id = cp_fwd_state_id(s, fwd_state);
   ci_assert_flags(fwd->flags, CICP_FWD_FLAG_OCCUPIED);
-  ci_assert_nequal(fwd->data->base.ifindex, CI_IFID_BAD);
-  ci_assert_nequal(fwd->data->base.ifindex, CI_IFID_LOOP);
+  ci_assert_nequal(cp_get_fwd_data_current(fwd)->base.ifindex, CI_IFID_BAD);
+  ci_assert_nequal(cp_get_fwd_data_current(fwd)->base.ifindex, CI_IFID_LOOP);
   cplane_ioctl(s->oo_fd, OO_IOC_CP_ARP_RESOLVE, &op);
 }
 
@@ -1762,6 +1771,7 @@ fwd_cache_refresh(struct cp_session* s, struct cp_fwd_state* fwd_state)
 void cp_fwd_cache_refresh(struct cp_session* s)
 {
   struct cp_fwd_state* fwd_state = NULL;
+  s->frc_fwd_refresh_deadline = 0;
   while( (fwd_state = cp_fwd_state_iterate_mapped(s, fwd_state)) != NULL )
     fwd_cache_refresh(s, fwd_state);
 }
@@ -1961,8 +1971,8 @@ fwd_weight_is_before_new(struct cp_fwd_table* fwd_table,
 {
   struct cp_fwd_row* fwd = cp_get_fwd_by_id(fwd_table, fwd_id);
   struct cp_fwd_multipath_weight* new = arg_new;
-  return fwd->data->weight.end == 0 ||
-         new->end - new->val < fwd->data->weight.end;
+  return cp_get_fwd_data_current(fwd)->weight.end == 0 ||
+         new->end - new->val < cp_get_fwd_data_current(fwd)->weight.end;
 }
 
 static void
@@ -2091,8 +2101,8 @@ cp_fwd_row_update(struct cp_session* s, struct cp_fwd_state* fwd_state,
          * specific) than the old one. */
         fwd->key_ext.src_prefix >= key_ext_wide.src_prefix &&
         fwd->key_ext.dst_prefix >= key_ext_wide.dst_prefix &&
-        fwd->data->weight.val == weight->val &&
-        fwd->data->weight.flag == weight->flag ) {
+        cp_get_fwd_data_current(fwd)->weight.val == weight->val &&
+        cp_get_fwd_data_current(fwd)->weight.flag == weight->flag ) {
       /* Nothing changed, we do not re-check the data fields which are
        * copied from other tables. */
       /* Note: potentially the key could be widened, we we'll do that only
@@ -2200,7 +2210,7 @@ cp_fwd_row_update(struct cp_session* s, struct cp_fwd_state* fwd_state,
     generic_key.tos = 0;
     cicp_mac_rowid_t generic_id = cp_fwd_find_row(fwd_table, &generic_key);
     if( generic_id != CICP_MAC_ROWID_BAD )
-      cp_get_fwd_by_id(fwd_table, generic_id)->version++;
+      cp_fwd_row_republish(cp_get_fwd_by_id(fwd_table, generic_id));
   }
   /* Same for PMTU-specific */
   if( old_id != id && (flags & CICP_FWD_FLAG_MTU_EXPIRES) ) {
@@ -2215,7 +2225,7 @@ cp_fwd_row_update(struct cp_session* s, struct cp_fwd_state* fwd_state,
                       fwd_table->prefix[CP_FWD_PREFIX_SRC],
                       dst_pref);
     if( generic_id != CICP_MAC_ROWID_BAD )
-      cp_get_fwd_by_id(fwd_table, generic_id)->version++;
+      cp_fwd_row_republish(cp_get_fwd_by_id(fwd_table, generic_id));
   }
 
  delete_old_id:
@@ -2580,7 +2590,7 @@ fwd_row_refresh(struct cp_session* s, struct cp_fwd_state* fwd_state,
 
   /* Is ARP fresh enough? */
   cicp_mac_rowid_t macid = fwd_state->priv_rows[id].macid;
-  struct cp_fwd_data* data = cp_get_fwd_data_scratch(fwd);
+  struct cp_fwd_data* data = cp_get_fwd_data_current(fwd);
   if( ! CICP_MAC_ROWID_IS_VALID(macid) ||
       !CI_IPX_ADDR_EQ(mac[macid].addr, data->base.next_hop) ||
       mac[macid].ifindex != fwd_state->priv_rows[id].ifindex ) {
@@ -58,6 +58,7 @@ static int cfg_fwd_sec = 5;
 static int ci_ver = false;
 static int /*bool*/ cfg_nolisten = false;
 static int cfg_fwd_cache_ttl = 300;
+static int cfg_fwd_holdoff_msec = 20;
 static char* cfg_ns_file = NULL;
 static int /*bool*/ cfg_daemonise = false;
 static int /*bool*/ ci_cfg_log_to_kern = false;
@@ -101,6 +102,11 @@ static ci_cfg_desc cfg_opts[] = {
     "interval between fwd cache housekeeping, in seconds" },
   { 't', "time-to-live", CI_CFG_UINT, &cfg_fwd_cache_ttl,
     "time-to-live for forward cache entries, in seconds" },
+  { 0, "fwd-refresh-holdoff", CI_CFG_UINT, &cfg_fwd_holdoff_msec,
+    "minimum interval between fwd cache refreshes while netlink updates "
+    "keep arriving, in milliseconds; bursts of updates are batched into "
+    "one refresh per interval, and a final refresh is done as soon as the "
+    "burst ends.  0 refreshes after every burst of messages read" },
   { 0, CPLANE_SERVER_NS_CMDLINE_OPT, CI_CFG_STR, &cfg_ns_file,
     "path to a file specifying the network namespace to manage"
     "; when the Onload drivers launch the control plane server, by default "
@@ -1117,6 +1123,8 @@ int main(int argc, char** argv)
 
   init_files(s);
   s->frc_fwd_cache_ttl = cfg_fwd_cache_ttl * s->khz * 1000ULL;
+  s->frc_fwd_refresh_holdoff = cfg_fwd_holdoff_msec * s->khz;
+  s->frc_fwd_refresh_deadline = 0;
   s->team_dump = NULL;
   s->bond_max = cfg_bond_max;
   s->mac_max_ln2 = ci_log2_ge(cfg_mac_max, 1);
@@ -1166,6 +1174,12 @@ int main(int argc, char** argv)
       /* handle all signals */;
 
     if( rc == 0 ) {
+      /* The queues are drained, so any refresh we have been holding off
+       * is due now, before we go to sleep. */
+      if( s->flags & CP_SESSION_FLAG_FWD_REFRESH_NEEDED &&
+          s->state == CP_DUMP_IDLE )
+        cp_fwd_cache_refresh(s);
+
       /* We are going to sleep.  Make idle_version even and notify user */
       ci_assert((*s->mib[0].idle_version) & 1);
       (*s->mib[0].idle_version)++;
@@ -1191,10 +1205,23 @@ int main(int argc, char** argv)
     }
 
     /* If we are dumping something then we'll call cp_fwd_cache_refresh() at the
-     * end.  Otherwise we should call it now. */
+     * end.  Otherwise we should call it now - except that while netlink
+     * updates keep arriving (eg. a routing flap) we batch them, doing the
+     * full-table refresh at most once per holdoff interval rather than
+     * once per socketful of messages.  The pre-sleep check above performs
+     * the final refresh as soon as the burst ends. */
     if( s->flags & CP_SESSION_FLAG_FWD_REFRESH_NEEDED &&
         s->state == CP_DUMP_IDLE ) {
-      cp_fwd_cache_refresh(s);
+      if( s->frc_fwd_refresh_holdoff == 0 ) {
+        cp_fwd_cache_refresh(s);
+      }
+      else {
+        uint64_t now = cp_frc64_get();
+        if( s->frc_fwd_refresh_deadline == 0 )
+          s->frc_fwd_refresh_deadline = now + s->frc_fwd_refresh_holdoff;
+        if( ci_frc64_after(s->frc_fwd_refresh_deadline, now) )
+          cp_fwd_cache_refresh(s);
+      }
     }
     if( s->flags & CP_SESSION_LADDR_REFRESH_NEEDED )
       cp_laddr_refresh(s);
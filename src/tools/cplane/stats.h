@@ -49,6 +49,10 @@ CP_STAT_GROUP_START("IPIF table", ipif)
 CP_STAT("Number of times when the table was full", int, full)
 CP_STAT_GROUP_END(ipif)
 
+CP_STAT_GROUP_START("Bonding", team)
+CP_STAT("Number of active-backup active-slave changes", int, ab_flips)
+CP_STAT_GROUP_END(team)
+
 CP_STAT_GROUP_START("Notifications", notify)
 CP_STAT("Number of OOF_CP_LLAP_MOD notifications", int, llap_mod)
 CP_STAT("Number of OOF_CP_LLAP_UPDATE_FILTERS notifications",
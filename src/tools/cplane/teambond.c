@@ -263,6 +263,17 @@ activebackup_set_active(struct cp_session* s, cicp_rowid_t team_id,
       s->bond[id].slave.flags &=~ CICP_BOND_ROW_FLAG_ACTIVE;
   }
 
+  /* This is the failover "flag flip": updating the LLAP's tx_hwports
+   * rewrites all affected fwd rows in place under their verlocks, so
+   * stacks pick up the new active slave on their next send without any
+   * per-row resolution round trips.  RX filters are installed on all
+   * slaves (rx_hwports) up front and do not need to move.  Log the flip
+   * so that failover latency can be measured against the bond driver's
+   * own log. */
+  s->stats.team.ab_flips++;
+  ci_log("Bond ifindex %d: active slave now ifindex %d",
+         s->bond[team_id].ifid, s->bond[port_id].ifid);
+
   cp_team_update_hwports_bothmibs(s, team_id);
 }
 
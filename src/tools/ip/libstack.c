@@ -89,6 +89,8 @@ int		cfg_watch_msec = 1000;
 unsigned	cfg_usec = 10000;
 unsigned	cfg_samples = 1000;
 int             cfg_notable;
+int             cfg_rates;
+unsigned        cfg_rate_thresh;
 int             cfg_zombie = 0;
 int             cfg_nopids = 0;
 const char*     cfg_filter = NULL;
@@ -928,7 +930,7 @@ static void watch_stats(const stat_desc_t* stats_fields, int n_stats_fields,
 {
   unsigned line_len = n_stats_fields * 20;
   char* line = malloc(line_len);
-  unsigned time_msec = 0, target_msec = 0;
+  unsigned time_msec = 0, prev_msec, target_msec = 0, interval_msec;
   struct timeval start, now;
   void* p = malloc(stats_len_bytes);
   void* c = malloc(stats_len_bytes);
@@ -940,11 +942,17 @@ static void watch_stats(const stat_desc_t* stats_fields, int n_stats_fields,
 
   for( line_i = 0; ; ++line_i ) {
     memcpy(p, c, stats_len_bytes);
+    prev_msec = time_msec;
     target_msec += cfg_watch_msec;
     ci_sleep(target_msec - time_msec);
     get_stats(c, stats_src, stats_len_bytes);
     gettimeofday(&now, 0);
     time_msec = tv_delta(&now, &start);
+    /* Rates are computed over the interval we actually slept, not the
+     * nominal one, so oversleeping doesn't inflate them. */
+    interval_msec = time_msec - prev_msec;
+    if( interval_msec == 0 )
+      interval_msec = 1;
     if( ! cfg_notable ) {
       if( (line_i & 0xf) == 0 )
         print_stats_header_line(stats_fields, n_stats_fields);
@@ -954,6 +962,8 @@ static void watch_stats(const stat_desc_t* stats_fields, int n_stats_fields,
       ci_log("=====================================================");
     for( s = stats_fields; s < stats_fields + n_stats_fields; ++s ) {
       unsigned long long v = 0; /* placate compiler */
+      double rate;
+      const char* flag;
       switch(s->size) {
         case sizeof(ci_uint32):
           v = *(ci_uint32*) ((char*) c + s->offset);
@@ -968,11 +978,23 @@ static void watch_stats(const stat_desc_t* stats_fields, int n_stats_fields,
         default:
           assert(0);
       }
+      rate = (double) v * 1000.0 / interval_msec;
+      /* Mark counters whose per-second rate crossed the configured
+       * threshold so they stand out in a long dump.  Gauges are always
+       * compared against the threshold directly. */
+      flag = cfg_rate_thresh != 0 &&
+             ((s->flags & STAT_COUNT) ? rate : (double) v) >=
+             (double) cfg_rate_thresh ? "*" : "";
       if( ! cfg_notable ) {
-        lo += ci_scnprintf(line+lo, line_len-lo, "\t %llu", v);
+        if( cfg_rates && (s->flags & STAT_COUNT) )
+          lo += ci_scnprintf(line+lo, line_len-lo, "\t %.1f%s", rate, flag);
+        else
+          lo += ci_scnprintf(line+lo, line_len-lo, "\t %llu%s", v, flag);
       }
+      else if( cfg_rates && (s->flags & STAT_COUNT) )
+        ci_log("%30s: %.1f/s%s", s->name, rate, flag);
       else
-        ci_log("%30s: %llu", s->name, v);
+        ci_log("%30s: %llu%s", s->name, v, flag);
     }
     if( ! cfg_notable ) {
       ci_log("%s", line);
@@ -1186,7 +1208,11 @@ void zombie_stack_lots(int id, void *arg)
                 __CI_DEBUG_OP_TCP_STATS__, __CI_DEBUG_OP_TCP_EXT_STATS__,
                 __CI_DEBUG_OP_UDP_STATS__,
                 __CI_DEBUG_OP_NETIF_CONFIG_OPTS_DUMP__,
-                __CI_DEBUG_OP_STACK_TIME__ };
+                __CI_DEBUG_OP_STACK_TIME__,
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+                __CI_DEBUG_OP_FLIGHT_RECORDER__,
+#endif
+  };
 
   for( i = 0; i < sizeof(ops) / sizeof(ops[0]); ++i ) {
     args.op = ops[i];
@@ -1259,6 +1285,12 @@ static void stack_netif_extra(ci_netif* ni)
 }
 
 
+static void stack_tuning_advice(ci_netif* ni)
+{
+  ci_netif_dump_tuning_advice(ni);
+}
+
+
 static void stack_netstat(ci_netif* ni)
 {
   ci_netif_print_sockets(ni);
@@ -1480,6 +1512,20 @@ static void stack_time(ci_netif* ni)
   ci_stack_time_dump(ni, NULL, NULL);
 }
 
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+static void stack_flight_recorder(ci_netif* ni)
+{
+  ci_netif_dump_flight_recorder_to_logger(ni, ci_log_dump_fn, NULL);
+}
+#endif
+
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+static void stack_drops(ci_netif* ni)
+{
+  ci_netif_dump_drops_to_logger(ni, ci_log_dump_fn, NULL);
+}
+#endif
+
 static void stack_time_init(ci_netif* ni)
 {
   ci_ip_timer_state* ipts = IPTIMER_STATE(ni);
@@ -2345,6 +2391,8 @@ static const stack_op_t stack_ops[] = {
   STACK_OP(vi_info,            "show vi information per-stack state"),
 #endif
   STACK_OP(netif_extra,        "show extra per-stack state"),
+  STACK_OP(tuning_advice,      "suggest EF_ option settings from observed "
+                               "pressure"),
   STACK_OP(netstat,            "show netstat like output for sockets"),
   STACK_OP(dmaq,               "show state of DMA queue"),
   STACK_OP(timeoutq,           "show state of timeout queue"),
@@ -2368,6 +2416,12 @@ static const stack_op_t stack_ops[] = {
   STACK_OP(time,               "show stack timers"),
   STACK_OP(time_init,          "(re-)initialize stack timers"),
   STACK_OP(timers,             "dump state of stack timers"),
+#if CI_CFG_FLIGHT_RECORDER_ENTRIES
+  STACK_OP(flight_recorder,    "dump flight recorder trace ring"),
+#endif
+#if CI_CFG_DROP_SAMPLES_PER_REASON
+  STACK_OP(drops,              "dump per-reason drop sample rings"),
+#endif
   STACK_OP(filter_table,       "show stack software filter table"),
   STACK_OP_F(filters,          "show stack hardware filters", FL_ONCE),
 #if CI_CFG_ENDPOINT_MOVE
@@ -2390,7 +2444,8 @@ static const stack_op_t stack_ops[] = {
   STACK_OP(rxpost,             "refill RX ring"),
   STACK_OP(sizeof,             "sizes of datastructures"),
   STACK_OP(ev,                 "post a h/w event to stack"),
-  STACK_OP(watch_stats,        "show running statistics"),
+  STACK_OP(watch_stats,        "show running statistics (-r for per-second "
+                               "rates, --thresh=N to flag busy counters)"),
   STACK_OP(watch_more_stats,   "show more statistics"),
   STACK_OP_AU(leak_pkts,       "drain allocation of packet buffers",
                                  "<pkt-id>"),
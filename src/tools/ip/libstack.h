@@ -64,6 +64,8 @@ extern int		cfg_watch_msec;
 extern unsigned		cfg_usec;
 extern unsigned		cfg_samples;
 extern int		cfg_notable;
+extern int		cfg_rates;
+extern unsigned		cfg_rate_thresh;
 extern int		cfg_zombie;
 extern int              cfg_nopids;
 extern int		ci_cfg_verbose;
@@ -46,6 +46,10 @@ static ci_cfg_desc cfg_opts[] = {
   {   0, "msec",      CI_CFG_UINT, &cfg_watch_msec,"set other interval"     },
   {   0, "samples",   CI_CFG_UINT, &cfg_samples, "number of samples"        },
   { 't', "notable",   CI_CFG_FLAG, &cfg_notable, "toggle table mode"},
+  { 'r', "rates",     CI_CFG_FLAG, &cfg_rates,
+                                   "watch_* ops show per-second rates"     },
+  {   0, "thresh",    CI_CFG_UINT, &cfg_rate_thresh,
+                                   "watch_* ops flag counters at/above this"},
   { 'z', "zombie",    CI_CFG_FLAG, &cfg_zombie,  "force dump of orphan stacks"},
   {   0, "nopids",    CI_CFG_FLAG, &cfg_nopids,  "disable dumping of PIDs"},
   {   0, "filter",    CI_CFG_STR,  &cfg_filter,
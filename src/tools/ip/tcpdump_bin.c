@@ -47,6 +47,7 @@ struct oo_pcap_pkthdr {
 #define MAXIMUM_SNAPLEN 65535
 static int cfg_snaplen = MAXIMUM_SNAPLEN;
 static int cfg_dump_os = 1;
+static int cfg_sample = 1;
 static int cfg_if_is_loop = 0;
 static int cfg_dump_no_match_only = 0;
 
@@ -87,6 +88,8 @@ static ci_cfg_desc cfg_opts[] = {
                            "dump only packets not matching onload sockets"},
   {  2, "time-stamp-precision", CI_CFG_STR, &cfg_precision,
                  "set the timestamp precision, default to \"micro\", man tcpdump"},
+  {  3, "sample",    CI_CFG_UINT, &cfg_sample,
+                "capture only one in every N matched packets, default 1"},
 };
 #define N_CFG_OPTS (sizeof(cfg_opts) / sizeof(cfg_opts[0]))
 
@@ -298,6 +301,8 @@ static void stack_dump_on(ci_netif *ni)
   }
   ni->state->dump_intf[OO_INTF_I_SEND_VIA_OS] = cfg_dump_os ?
                                                 OO_INTF_I_DUMP_ALL : 0;
+  ni->state->dump_sample = cfg_sample;
+  ni->state->dump_sample_n = 0;
   libstack_netif_unlock(ni);
 }
 
@@ -305,6 +310,7 @@ static void stack_dump_on(ci_netif *ni)
 static void stack_dump_off(ci_netif *ni)
 {
   memset(ni->state->dump_intf, 0, sizeof(ni->state->dump_intf));
+  ni->state->dump_sample = 0;
   libstack_netif_lock(ni);
   oo_tcpdump_free_pkts(ni, ni->state->dump_read_i);
   ni->state->dump_read_i = ni->state->dump_write_i;
@@ -458,6 +464,7 @@ static void stack_dump(ci_netif *ni)
 static void stack_pre_detach(ci_netif *ni)
 {
   memset(ni->state->dump_intf, 0, sizeof(ni->state->dump_intf));
+  ni->state->dump_sample = 0;
   ci_wmb();
   stack_dump(ni);
 
@@ -691,6 +698,10 @@ int main(int argc, char* argv[])
   cfg_snaplen = CI_MAX(cfg_snaplen, 80);
   cfg_snaplen = CI_MIN(cfg_snaplen, MAXIMUM_SNAPLEN);
 
+  /* Fix cfg_sample value. */
+  cfg_sample = CI_MAX(cfg_sample, 1);
+  cfg_sample = CI_MIN(cfg_sample, 65535);
+
   /* Parse interfaces */
   parse_interface();
 
@@ -542,6 +542,10 @@ typedef struct oo_p_dllink oo_p_dllink_t;
   FTL_TFIELD_INT(ctx, ci_uint32, ep_ofs, ORM_OUTPUT_STACK)                \
   FTL_TFIELD_STRUCT(ctx, oo_p_dllink_t, free_aux_mem, ORM_OUTPUT_STACK)           \
   FTL_TFIELD_INT(ctx, ci_uint32, n_free_aux_bufs, ORM_OUTPUT_STACK)       \
+  FTL_TFIELD_ARRAYOFSTRUCT(ctx, oo_p_dllink_t, \
+                           free_aux_typed, CI_TCP_AUX_TYPE_NUM, ORM_OUTPUT_STACK, 1)      \
+  FTL_TFIELD_ARRAYOFINT(ctx, ci_uint32, n_free_aux_typed,                 \
+                        CI_TCP_AUX_TYPE_NUM, ORM_OUTPUT_STACK)            \
   FTL_TFIELD_ARRAYOFINT(ctx, ci_uint32, n_aux_bufs, CI_TCP_AUX_TYPE_NUM,  \
                                                              ORM_OUTPUT_STACK)            \
   FTL_TFIELD_ARRAYOFINT(ctx, ci_uint32, max_aux_bufs, CI_TCP_AUX_TYPE_NUM,\
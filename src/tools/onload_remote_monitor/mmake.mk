@@ -41,7 +41,7 @@ all: $(APPS)
 orm_json: $(DEPS)
 	(libs="$(LIBS)"; $(MMakeLinkCApp))
 
-orm_zmq_publisher: orm_zmq_publisher.o orm_json_lib.o
+orm_zmq_publisher: orm_zmq_publisher.o orm_json_lib.o orm_binary_lib.o
 	(libs="$(LIBS)"; $(MMakeLinkCApp))
 
 zmq_subscriber: zmq_subscriber.o
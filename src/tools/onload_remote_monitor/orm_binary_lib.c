@@ -0,0 +1,253 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2020 Xilinx, Inc. */
+
+/* Binary delta publisher for Onload stack statistics.  See
+ * orm_binary_lib.h for the wire format. */
+
+#define _GNU_SOURCE
+
+#include <ci/internal/ip.h>
+#include <ci/internal/more_stats.h>
+#include <czmq.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include "orm_json_lib.h"
+#include "orm_binary_lib.h"
+
+
+#define LOG(...) fprintf(stderr, __VA_ARGS__)
+
+
+/**********************************************************/
+/* Stat tables, generated from the stats definitions */
+/**********************************************************/
+
+struct orm_stat_field {
+  const char* group;
+  const char* name;
+  ci_uint16   offset;
+  ci_uint8    size;
+};
+
+#define OO_STAT(desc, type, name, kind)                                 \
+  { "stats", #name, CI_MEMBER_OFFSET(ci_netif_stats, name), sizeof(type) },
+static const struct orm_stat_field netif_stats_fields[] = {
+#include <ci/internal/stats_def.h>
+};
+#undef OO_STAT
+#define N_NETIF_STATS_FIELDS                                    \
+  (sizeof(netif_stats_fields) / sizeof(netif_stats_fields[0]))
+
+#define OO_STAT(desc, type, name, kind)                                 \
+  { "more_stats", #name, CI_MEMBER_OFFSET(more_stats_t, name), sizeof(type) },
+static const struct orm_stat_field more_stats_fields[] = {
+#include <ci/internal/more_stats_def.h>
+};
+#undef OO_STAT
+#define N_MORE_STATS_FIELDS                                     \
+  (sizeof(more_stats_fields) / sizeof(more_stats_fields[0]))
+
+#define N_ALL_FIELDS  (N_NETIF_STATS_FIELDS + N_MORE_STATS_FIELDS)
+
+
+static ci_uint64 orm_stat_read(const struct orm_stat_field* f,
+                               const void* base)
+{
+  const void* p = (const char*) base + f->offset;
+  switch( f->size ) {
+  case 1:  return *(const ci_uint8*) p;
+  case 2:  return *(const ci_uint16*) p;
+  case 4:  return *(const ci_uint32*) p;
+  case 8:  return *(const ci_uint64*) p;
+  default:
+    LOG("ERROR: %s.%s has unexpected size %d\n", f->group, f->name, f->size);
+    return 0;
+  }
+}
+
+
+/**********************************************************/
+/* Delta state */
+/**********************************************************/
+
+struct orm_binary_stack_state {
+  int       stack_id;
+  ci_uint64 prev[N_ALL_FIELDS];
+};
+
+struct orm_binary_state {
+  struct orm_binary_stack_state** stacks;
+  int n_stacks;
+};
+
+
+struct orm_binary_state* orm_binary_state_alloc(void)
+{
+  return calloc(1, sizeof(struct orm_binary_state));
+}
+
+
+void orm_binary_state_free(struct orm_binary_state* bs)
+{
+  int i;
+  if( bs == NULL )
+    return;
+  for( i = 0; i < bs->n_stacks; ++i )
+    free(bs->stacks[i]);
+  free(bs->stacks);
+  free(bs);
+}
+
+
+/* Find the delta state for [stack_id], creating it if this is the first
+ * time the stack has been seen.  *first_out is set in the latter case. */
+static struct orm_binary_stack_state*
+orm_binary_stack_state_get(struct orm_binary_state* bs, int stack_id,
+                           int* first_out)
+{
+  struct orm_binary_stack_state* ss;
+  struct orm_binary_stack_state** new_stacks;
+  int i;
+
+  *first_out = 0;
+  for( i = 0; i < bs->n_stacks; ++i )
+    if( bs->stacks[i]->stack_id == stack_id )
+      return bs->stacks[i];
+
+  new_stacks = realloc(bs->stacks,
+                       (bs->n_stacks + 1) * sizeof(*bs->stacks));
+  if( new_stacks == NULL )
+    return NULL;
+  bs->stacks = new_stacks;
+  if( (ss = calloc(1, sizeof(*ss))) == NULL )
+    return NULL;
+  ss->stack_id = stack_id;
+  bs->stacks[bs->n_stacks++] = ss;
+  *first_out = 1;
+  return ss;
+}
+
+
+/**********************************************************/
+/* Publishing */
+/**********************************************************/
+
+static int orm_binary_send(zsock_t* publisher, const char* kind,
+                           const struct orm_stat_field* f,
+                           const void* payload, size_t paylen)
+{
+  char topic[128];
+  snprintf(topic, sizeof(topic), "orm.%s.%s.%s", kind, f->group, f->name);
+  return zsock_send(publisher, "sb", topic, payload, paylen);
+}
+
+
+int orm_binary_publish_schema(zsock_t* publisher)
+{
+  struct orm_binary_schema schema;
+  unsigned i;
+  int rc;
+
+  schema.version = ORM_BINARY_VERSION;
+  for( i = 0; i < N_NETIF_STATS_FIELDS; ++i ) {
+    schema.index = i;
+    schema.size = netif_stats_fields[i].size;
+    rc = orm_binary_send(publisher, "schema", &netif_stats_fields[i],
+                         &schema, sizeof(schema));
+    if( rc != 0 )
+      return rc;
+  }
+  for( i = 0; i < N_MORE_STATS_FIELDS; ++i ) {
+    schema.index = i;
+    schema.size = more_stats_fields[i].size;
+    rc = orm_binary_send(publisher, "schema", &more_stats_fields[i],
+                         &schema, sizeof(schema));
+    if( rc != 0 )
+      return rc;
+  }
+  return 0;
+}
+
+
+/* Publish the counters from [base] described by [fields], skipping those
+ * unchanged since the previous poll. */
+static int orm_binary_publish_group(zsock_t* publisher, int stack_id,
+                                    const struct orm_stat_field* fields,
+                                    unsigned n_fields, const void* base,
+                                    ci_uint64* prev, int force)
+{
+  struct orm_binary_update update;
+  unsigned i;
+  int rc, n_sent = 0;
+
+  update.stack_id = stack_id;
+  for( i = 0; i < n_fields; ++i ) {
+    ci_uint64 value = orm_stat_read(&fields[i], base);
+    if( ! force && value == prev[i] )
+      continue;
+    prev[i] = value;
+    update.value = value;
+    rc = orm_binary_send(publisher, "stat", &fields[i],
+                         &update, sizeof(update));
+    if( rc != 0 )
+      return rc;
+    ++n_sent;
+  }
+  return n_sent;
+}
+
+
+int orm_binary_publish(struct orm_binary_state* bs, zsock_t* publisher,
+                       const char* stackname, int force)
+{
+  orm_state_t state = { };
+  int i, rc, n_sent = 0;
+
+  if( orm_map_stacks(&state) != 0 )
+    return -EFAULT;
+
+  for( i = 0; i < state.n_stacks; ++i ) {
+    ci_netif* ni = &state.stacks[i]->os_ni;
+    struct orm_binary_stack_state* ss;
+    more_stats_t more_stats;
+    int first;
+
+    if( stackname != NULL && strcmp(stackname, ni->state->name) != 0 )
+      continue;
+
+    if( (ss = orm_binary_stack_state_get(bs, state.stacks[i]->os_id,
+                                         &first)) == NULL ) {
+      rc = -ENOMEM;
+      goto out;
+    }
+
+    /* A stack seen for the first time publishes everything so that
+     * subscribers do not have to wait for each counter to change. */
+    rc = orm_binary_publish_group(publisher, ss->stack_id,
+                                  netif_stats_fields, N_NETIF_STATS_FIELDS,
+                                  &ni->state->stats, ss->prev,
+                                  force || first);
+    if( rc < 0 )
+      goto out;
+    n_sent += rc;
+
+    get_more_stats(ni, &more_stats);
+    rc = orm_binary_publish_group(publisher, ss->stack_id,
+                                  more_stats_fields, N_MORE_STATS_FIELDS,
+                                  &more_stats,
+                                  ss->prev + N_NETIF_STATS_FIELDS,
+                                  force || first);
+    if( rc < 0 )
+      goto out;
+    n_sent += rc;
+  }
+  rc = n_sent;
+
+ out:
+  orm_unmap_stacks(&state);
+  return rc;
+}
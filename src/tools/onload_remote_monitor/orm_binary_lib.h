@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* X-SPDX-Copyright-Text: (c) Copyright 2020 Xilinx, Inc. */
+
+/* Binary delta wire format for orm_zmq_publisher.
+ *
+ * Each message is a two-frame ZMQ message: a topic string followed by a
+ * fixed-size binary payload.  ZMQ matches subscriptions against a prefix
+ * of the first frame, so clients subscribe per stat (or per group) by
+ * topic prefix and never receive stats they did not ask for.
+ *
+ * Topics:
+ *   orm.schema.<group>.<stat>  - payload struct orm_binary_schema
+ *   orm.stat.<group>.<stat>    - payload struct orm_binary_update
+ *
+ * <group> is "stats" (ci_netif_stats) or "more_stats" (more_stats_t).
+ * Schema messages describe every stat the publisher knows about and are
+ * re-sent periodically so that late-joining subscribers converge.
+ *
+ * Counter updates carry absolute values, not differences, so a missed
+ * message is corrected by the next update; "delta" refers to publishing
+ * only the counters whose values changed since the previous poll.
+ * Payload integers are in the publisher host's byte order; the schema
+ * version must be bumped if that ever needs to change.
+ */
+
+#ifndef __ORM_BINARY_LIB_H__
+#define __ORM_BINARY_LIB_H__
+
+#define ORM_BINARY_VERSION 1
+
+struct orm_binary_schema {
+  ci_uint16 version;     /* ORM_BINARY_VERSION */
+  ci_uint16 index;       /* stable index of this stat within its group */
+  ci_uint8  size;        /* sizeof the stat counter in the shared state */
+} __attribute__((packed));
+
+struct orm_binary_update {
+  ci_uint32 stack_id;
+  ci_uint64 value;       /* absolute counter value */
+} __attribute__((packed));
+
+#ifdef CZMQ_VERSION  /* publisher API; include czmq.h first */
+
+/* Per-publisher delta state: remembers the last value published for every
+ * stat of every stack. */
+struct orm_binary_state;
+
+extern struct orm_binary_state* orm_binary_state_alloc(void);
+extern void orm_binary_state_free(struct orm_binary_state* bs);
+
+/* Publish a schema message for every known stat. */
+extern int orm_binary_publish_schema(zsock_t* publisher);
+
+/* Publish updates for counters that changed since the last call (all
+ * counters when [force] is set or a stack is seen for the first time).
+ * Returns the number of messages sent, or negative error. */
+extern int orm_binary_publish(struct orm_binary_state* bs, zsock_t* publisher,
+                              const char* stackname, int force);
+
+#endif
+
+#endif  /* __ORM_BINARY_LIB_H__ */
@@ -77,17 +77,6 @@
 /* Manage stack mappings */
 /**********************************************************/
 
-struct orm_stack {
-  ci_netif os_ni;
-  int      os_id;
-};
-
-typedef struct {
-  struct orm_stack** stacks;
-  int n_stacks;
-} orm_state_t;
-
-
 static int orm_map_stack(orm_state_t* state, unsigned stack_id)
 {
   int rc;
@@ -116,7 +105,7 @@ static int orm_map_stack(orm_state_t* state, unsigned stack_id)
 }
 
 
-static int orm_map_stacks(orm_state_t* state)
+int orm_map_stacks(orm_state_t* state)
 {
   int rc, i;
   oo_fd fd;
@@ -159,7 +148,7 @@ static int orm_map_stacks(orm_state_t* state)
 }
 
 
-static void orm_unmap_stacks(orm_state_t* state)
+void orm_unmap_stacks(orm_state_t* state)
 {
   int i;
   for( i = 0; i < state->n_stacks; ++i ) {
@@ -25,6 +25,20 @@ struct orm_cfg {
   bool flat;
 };
 
+/* A mapped set of Onload stacks, shared by the JSON and binary dumpers */
+struct orm_stack {
+  ci_netif os_ni;
+  int      os_id;
+};
+
+typedef struct {
+  struct orm_stack** stacks;
+  int n_stacks;
+} orm_state_t;
+
+extern int orm_map_stacks(orm_state_t* state);
+extern void orm_unmap_stacks(orm_state_t* state);
+
 /* Convert argv[] to output_flags for orm_do_dump()
  * Returns -EINVAL if any unrecognised options are provided
  */
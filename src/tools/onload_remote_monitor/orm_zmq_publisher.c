@@ -11,11 +11,15 @@
 #include <czmq.h>
 
 #include "orm_json_lib.h"
+#include "orm_binary_lib.h"
 
 
 static struct orm_cfg cfg;
 static int cfg_interval = 10;
+static int cfg_interval_msec;
 static char* cfg_endpoint = "tcp://*:5556";
+static bool cfg_binary;
+static int cfg_resync = 6;
 
 static ci_cfg_desc cfg_opts[] = {
   { 'h', "help", CI_CFG_USAGE, 0, "this message" },
@@ -32,6 +36,15 @@ static ci_cfg_desc cfg_opts[] = {
     "ZMQ endpoint to publish stats (default tcp://*:5556)" },
   { 0, "interval",  CI_CFG_INT,  &cfg_interval,
     "Interval between stats in seconds (default 10s)" },
+  { 0, "interval-ms",  CI_CFG_INT,  &cfg_interval_msec,
+    "Interval between stats in milliseconds (overrides --interval)" },
+  { 0, "binary", CI_CFG_FLAG, &cfg_binary,
+    "publish stats in the binary delta format (see orm_binary_lib.h); "
+    "only counters that changed since the last poll are sent, each on "
+    "its own topic so clients can subscribe per stat" },
+  { 0, "resync",  CI_CFG_INT,  &cfg_resync,
+    "with --binary, publish the schema and all counters every N "
+    "intervals so late subscribers converge (default 6)" },
 };
 #define N_CFG_OPTS (sizeof(cfg_opts) / sizeof(cfg_opts[0]))
 
@@ -51,6 +64,16 @@ int main(int argc, char** argv)
     return EXIT_FAILURE;
   }
   unsigned int n = 0;
+  struct orm_binary_state* bs = NULL;
+
+  if( cfg_binary && (bs = orm_binary_state_alloc()) == NULL ) {
+    printf("Failed to allocate delta state\n");
+    return EXIT_FAILURE;
+  }
+  if( cfg_interval_msec <= 0 )
+    cfg_interval_msec = cfg_interval * 1000;
+  if( cfg_resync <= 0 )
+    cfg_resync = 1;
 
   printf("Publishing stats to ZMQ endpoint: %s\n", cfg_endpoint);
   zsock_t* publisher = zsock_new_pub(cfg_endpoint);
@@ -61,29 +84,42 @@ int main(int argc, char** argv)
     if( zsys_interrupted )
       break;
 
-    char* data = NULL;
-    size_t datalen = 0;
-    FILE* output_stream = open_memstream(&data, &datalen);
-
-    int rc = orm_do_dump(&cfg, output_flags, output_stream);
-    fclose(output_stream);
-
-    if( rc == 0 ) {
-      // data generated OK
-      zstr_send(publisher, data);
-      printf("Stats published #%u\n", ++n);
+    if( cfg_binary ) {
+      int force = n % cfg_resync == 0;
+      int rc = force ? orm_binary_publish_schema(publisher) : 0;
+      if( rc == 0 )
+        rc = orm_binary_publish(bs, publisher, cfg.stackname, force);
+      if( rc >= 0 )
+        printf("Stats published #%u (%d messages)\n", ++n, rc);
+      else
+        printf("Not able to publish stats rc=%d\n", rc);
     }
     else {
-      printf("Not able to generate JSON rc=%d\n", rc);
+      char* data = NULL;
+      size_t datalen = 0;
+      FILE* output_stream = open_memstream(&data, &datalen);
+
+      int rc = orm_do_dump(&cfg, output_flags, output_stream);
+      fclose(output_stream);
+
+      if( rc == 0 ) {
+        // data generated OK
+        zstr_send(publisher, data);
+        printf("Stats published #%u\n", ++n);
+      }
+      else {
+        printf("Not able to generate JSON rc=%d\n", rc);
+      }
+
+      free(data);
     }
 
     fflush(stdout);
-    free(data);
-
-    sleep(cfg_interval);
+    usleep((useconds_t) cfg_interval_msec * 1000);
   }
 
   // clean up
+  orm_binary_state_free(bs);
   zsock_destroy(&publisher);
   return 0;
 }
@@ -11,16 +11,49 @@
 
 #include <czmq.h>
 
+#include "orm_binary_lib.h"
+
 static char* cfg_endpoint = "tcp://localhost:5556";
+static bool cfg_binary;
+static char* cfg_subscribe = "";
 
 static ci_cfg_desc cfg_opts[] = {
   { 'h', "help", CI_CFG_USAGE, 0, "this message" },
   { 0, "endpoint",  CI_CFG_STR,  &cfg_endpoint,
     "ZMQ endpoint to subscribe to stats (default tcp://localhost:5556)" },
+  { 0, "binary", CI_CFG_FLAG, &cfg_binary,
+    "decode the binary delta format from 'orm_zmq_publisher --binary'" },
+  { 0, "subscribe",  CI_CFG_STR,  &cfg_subscribe,
+    "topic prefix to subscribe to, e.g. orm.stat.stats.rx_evs "
+    "(default: everything)" },
 };
 #define N_CFG_OPTS (sizeof(cfg_opts) / sizeof(cfg_opts[0]))
 
 
+/* Decode and print one message in the binary delta format */
+static void binary_update_print(const char* topic,
+                                const void* data, size_t size)
+{
+  if( strncmp(topic, "orm.stat.", strlen("orm.stat.")) == 0 &&
+      size == sizeof(struct orm_binary_update) ) {
+    const struct orm_binary_update* update = data;
+    printf("%s stack=%u value=%llu\n", topic + strlen("orm.stat."),
+           update->stack_id, (unsigned long long) update->value);
+  }
+  else if( strncmp(topic, "orm.schema.", strlen("orm.schema.")) == 0 &&
+           size == sizeof(struct orm_binary_schema) ) {
+    const struct orm_binary_schema* schema = data;
+    printf("schema %s version=%u index=%u size=%u\n",
+           topic + strlen("orm.schema."), schema->version, schema->index,
+           schema->size);
+  }
+  else {
+    fprintf(stderr, "Unrecognised message on topic '%s' (%zu bytes)\n",
+            topic, size);
+  }
+}
+
+
 int main (int argc, char *argv [])
 {
   ci_app_standard_opts = 0;
@@ -34,18 +67,35 @@ int main (int argc, char *argv [])
   zsys_catch_interrupts();
 
   fprintf(stderr, "Subscribing to ZMQ endpoint: %s\n", cfg_endpoint);
-  zsock_t* subscriber = zsock_new_sub(cfg_endpoint, "");
+  zsock_t* subscriber = zsock_new_sub(cfg_endpoint, cfg_subscribe);
 
   fprintf(stderr, "Waiting for update from publisher...\n");
 
   while( 1 ) {
-    buffer = zstr_recv(subscriber);
-    if( zsys_interrupted )
-      break;
-    ++update_n;
-    fprintf(stderr, "Received update #%u :\n", update_n);
-    printf("%s\n", buffer);
-    zstr_free(&buffer);
+    if( cfg_binary ) {
+      zmsg_t* msg = zmsg_recv(subscriber);
+      if( zsys_interrupted )
+        break;
+      if( msg == NULL )
+        continue;
+      char* topic = zmsg_popstr(msg);
+      zframe_t* payload = zmsg_pop(msg);
+      if( topic != NULL && payload != NULL )
+        binary_update_print(topic, zframe_data(payload),
+                            zframe_size(payload));
+      zframe_destroy(&payload);
+      zstr_free(&topic);
+      zmsg_destroy(&msg);
+    }
+    else {
+      buffer = zstr_recv(subscriber);
+      if( zsys_interrupted )
+        break;
+      ++update_n;
+      fprintf(stderr, "Received update #%u :\n", update_n);
+      printf("%s\n", buffer);
+      zstr_free(&buffer);
+    }
   }
 
   zsock_destroy(&subscriber);